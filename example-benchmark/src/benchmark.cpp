@@ -0,0 +1,433 @@
+#include <thread>
+
+#include "CX.h"
+
+/*
+This example is a benchmark suite. It runs a set of standard scenarios without needing any input, writes
+the results to a file, and exits. The results are meant to be compared across computers and versions of CX,
+for example before deploying a new lab computer or a new version of an experiment.
+
+The scenarios are:
++ Slide presentation with CX_SlidePresenter in each of its swapping modes.
++ Drawing many gabor patches, both one at a time with Draw::Gabor and all at once with Draw::GaborArray.
++ Drawing many of the primitives in CX::Draw.
++ Rendering many Synth voices.
++ Writing and reading CX_DataFrames in text and binary formats.
++ Logging throughput, for both the normal logger and a real-time logging channel.
+
+The results are written to "benchmark_<date>.csv" in the data directory, with one row per scenario and these columns:
++ scenario, variant, count: What was run. count is the number of stimuli, voices, rows, etc.
++ framesMissed: The number of frames that were skipped (frames that took longer than one frame period).
++ frameTimeP50, frameTimeP99: The median and 99th percentile of the time between buffer swaps, in milliseconds.
++ renderTimeP99: The 99th percentile of the CPU time spent submitting drawing commands for each frame, in milliseconds.
++ callbackLoad: For audio, the mean time to render a buffer as a fraction of the duration of the buffer
+(i.e. the load that the work would put on an audio callback). Above 1 means the work could not be done in real time.
++ callbackLoadP99: The 99th percentile of the per-buffer load.
++ opsPerSecond: For non-visual scenarios, the number of operations (rows, messages, etc.) per second.
+Cells that do not apply to a scenario are "NA".
+
+Information about the computer is written to "benchmark_<date>_info.txt" alongside the results.
+
+The benchmark takes a few minutes. The window should stay visible on the main monitor while it runs, and
+vertical sync should be on (it is by default), otherwise the frame timing results are meaningless.
+*/
+
+const unsigned int framesPerScenario = 600;
+
+CX_DataFrame results;
+std::string dateString;
+
+void runSlidePresenterBenchmarks(void);
+void runGaborBenchmarks(void);
+void runDrawingBenchmarks(void);
+void runSynthBenchmarks(void);
+void runDataFrameBenchmarks(void);
+void runLoggerBenchmarks(void);
+
+void writeSystemInformation(std::string filename);
+
+void runExperiment(void) {
+	Disp.setWindowResolution(800, 600);
+	ofSetWindowTitle("CX Benchmark");
+
+	dateString = Clock.getDateTimeString("%Y-%m-%d_%H-%M-%S");
+
+	Log.notice() << "Running benchmarks. This takes a few minutes.";
+	Log.flush();
+
+	runSlidePresenterBenchmarks();
+	runGaborBenchmarks();
+	runDrawingBenchmarks();
+	runSynthBenchmarks();
+	runDataFrameBenchmarks();
+	runLoggerBenchmarks();
+
+	std::string resultsFile = "benchmark_" + dateString + ".csv";
+	results.printToFile(resultsFile, ",");
+	writeSystemInformation("benchmark_" + dateString + "_info.txt");
+
+	Log.notice() << "Benchmark results:" << endl << results.print("\t");
+	Log.notice() << "The results were written to " << ofToDataPath(resultsFile);
+	Log.flush();
+}
+
+//Gets the value below which proportion p of the values are, interpolating between values.
+double percentile(std::vector<double> values, double p) {
+	if (values.empty()) {
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+	std::sort(values.begin(), values.end());
+	double position = p * (values.size() - 1);
+	size_t below = (size_t)std::floor(position);
+	size_t above = std::min(below + 1, values.size() - 1);
+	double fraction = position - below;
+	return values[below] * (1 - fraction) + values[above] * fraction;
+}
+
+double mean(const std::vector<double>& values) {
+	double sum = 0;
+	for (double v : values) {
+		sum += v;
+	}
+	return sum / values.size();
+}
+
+//Adds a row to the results. Metrics that are left as NaN are stored as NA.
+void addResult(std::string scenario, std::string variant, unsigned int count,
+	double framesMissed, double frameTimeP50, double frameTimeP99, double renderTimeP99,
+	double callbackLoad, double callbackLoadP99, double opsPerSecond)
+{
+	CX_DataFrame::rowIndex_t row = results.getRowCount();
+
+	results(row, "scenario") = scenario;
+	results(row, "variant") = variant;
+	results(row, "count") = count;
+
+	auto setMetric = [&](std::string column, double value) {
+		if (std::isnan(value)) {
+			results(row, column) = "NA";
+		} else {
+			results(row, column) = value;
+		}
+	};
+
+	setMetric("framesMissed", framesMissed);
+	setMetric("frameTimeP50", frameTimeP50);
+	setMetric("frameTimeP99", frameTimeP99);
+	setMetric("renderTimeP99", renderTimeP99);
+	setMetric("callbackLoad", callbackLoad);
+	setMetric("callbackLoadP99", callbackLoadP99);
+	setMetric("opsPerSecond", opsPerSecond);
+
+	Log.notice() << "Finished " << scenario << " (" << variant << ", " << count << ")";
+	Log.flush();
+}
+
+const double NA = std::numeric_limits<double>::quiet_NaN();
+
+//Counts the frames that were skipped, given the times between swaps.
+unsigned int countMissedFrames(const std::vector<double>& frameTimes) {
+	double period = Disp.getFramePeriod().millis();
+	unsigned int missed = 0;
+	for (double t : frameTimes) {
+		int frames = (int)std::round(t / period);
+		if (frames > 1) {
+			missed += frames - 1;
+		}
+	}
+	return missed;
+}
+
+//Draws with drawFunction on every frame, swapping after each one, and records the time between swaps
+//and the time needed to submit the drawing commands.
+void runFrameScenario(std::string scenario, std::string variant, unsigned int count, std::function<void(void)> drawFunction) {
+	std::vector<double> frameTimes;
+	std::vector<double> renderTimes;
+	frameTimes.reserve(framesPerScenario);
+	renderTimes.reserve(framesPerScenario);
+
+	//A few warmup frames, so that shaders are compiled and buffers are allocated before timing starts.
+	for (unsigned int i = 0; i < 10; i++) {
+		Disp.beginDrawingToBackBuffer();
+		drawFunction();
+		Disp.endDrawingToBackBuffer();
+		Disp.swapBuffers();
+	}
+	Disp.waitForOpenGL();
+	CX_Millis lastSwap = Clock.now();
+
+	for (unsigned int i = 0; i < framesPerScenario; i++) {
+		CX_Millis renderStart = Clock.now();
+		Disp.beginDrawingToBackBuffer();
+		drawFunction();
+		Disp.endDrawingToBackBuffer();
+		renderTimes.push_back((Clock.now() - renderStart).millis());
+
+		Disp.swapBuffers();
+		Disp.waitForOpenGL(); //Wait for the swap to really happen before taking the time.
+		CX_Millis swapTime = Clock.now();
+		frameTimes.push_back((swapTime - lastSwap).millis());
+		lastSwap = swapTime;
+	}
+
+	addResult(scenario, variant, count, countMissedFrames(frameTimes), percentile(frameTimes, 0.5), percentile(frameTimes, 0.99),
+		percentile(renderTimes, 0.99), NA, NA, NA);
+}
+
+void runSlidePresenterBenchmarks(void) {
+	std::vector<std::pair<CX_SlidePresenter::SwappingMode, std::string>> modes = {
+		{ CX_SlidePresenter::SwappingMode::SINGLE_CORE_BLOCKING_SWAPS, "SINGLE_CORE_BLOCKING_SWAPS" },
+		{ CX_SlidePresenter::SwappingMode::MULTI_CORE, "MULTI_CORE" }
+	};
+
+	const unsigned int slideCount = 300;
+
+	for (auto& mode : modes) {
+		CX_SlidePresenter::Configuration config;
+		config.swappingMode = mode.first;
+
+		CX_SlidePresenter sp;
+		sp.setup(config);
+
+		//Each slide is one frame long, so every slide that lasts longer than a frame is a missed frame.
+		for (unsigned int i = 0; i < slideCount; i++) {
+			sp.beginDrawingNextSlide(Disp.getFramePeriod(), "slide" + ofToString(i));
+			ofBackground(i % 2 == 0 ? 0 : 50);
+			ofSetColor(255);
+			ofCircle(100 + (i % 600), 300, 50);
+		}
+		sp.endDrawingCurrentSlide();
+
+		sp.startSlidePresentation();
+		while (sp.isPresentingSlides()) {
+			sp.update();
+		}
+
+		std::vector<CX_SlidePresenter::Slide>& slides = sp.getSlides();
+		std::vector<double> frameTimes;
+		unsigned int missed = 0;
+
+		//The last slide has no end, so it is not counted.
+		for (size_t i = 0; i + 1 < slides.size(); i++) {
+			const CX_SlidePresenter::Slide& slide = slides[i];
+			frameTimes.push_back(slide.actual.duration.millis());
+			if (slide.actual.frameCount > slide.intended.frameCount) {
+				missed += slide.actual.frameCount - slide.intended.frameCount;
+			}
+		}
+
+		addResult("slidePresenter", mode.second, slideCount, missed, percentile(frameTimes, 0.5), percentile(frameTimes, 0.99),
+			NA, NA, NA, NA);
+	}
+
+	//MULTI_CORE leaves automatic swapping on, which would swap alongside the manual swaps of the later benchmarks.
+	Disp.setAutomaticSwapping(false);
+}
+
+void runGaborBenchmarks(void) {
+	for (unsigned int count : { 10, 100 }) {
+		Draw::Gabor gabor;
+		gabor.setup(Draw::Gabor::Wave::sine, Draw::Gabor::Envelope::gaussian);
+		gabor.color1 = ofColor::white;
+		gabor.color2 = ofColor::black;
+		gabor.envelope.controlParameter = 8;
+		gabor.wave.wavelength = 10;
+		gabor.radius = 30;
+
+		runFrameScenario("gabors", "Gabor", count, [&]() {
+			ofBackground(127);
+			for (unsigned int i = 0; i < count; i++) {
+				gabor.wave.angle = (i * 37) % 180;
+				gabor.draw(50 + (i * 67) % 700, 50 + (i * 41) % 500);
+			}
+		});
+	}
+
+	for (unsigned int count : { 100, 1000 }) {
+		Draw::GaborArray gabors(Draw::Gabor::Wave::sine, Draw::Gabor::Envelope::gaussian);
+		gabors.color1 = ofColor::white;
+		gabors.color2 = ofColor::black;
+		for (unsigned int i = 0; i < count; i++) {
+			Draw::GaborArray::Instance inst;
+			inst.center = ofPoint(50 + (i * 67) % 700, 50 + (i * 41) % 500);
+			inst.angle = (i * 37) % 180;
+			inst.wavelength = 10;
+			inst.controlParameter = 8;
+			inst.radius = 30;
+			gabors.addInstance(inst);
+		}
+
+		runFrameScenario("gabors", "GaborArray", count, [&]() {
+			ofBackground(127);
+			gabors.draw();
+		});
+	}
+}
+
+void runDrawingBenchmarks(void) {
+	for (unsigned int count : { 100, 1000 }) {
+		runFrameScenario("drawPrimitives", "mixed", count, [count]() {
+			ofBackground(50);
+			for (unsigned int i = 0; i < count; i++) {
+				ofPoint p(20 + (i * 67) % 760, 20 + (i * 41) % 560);
+				ofSetColor((i * 50) % 256, (i * 90) % 256, (i * 130) % 256);
+				switch (i % 5) {
+				case 0: ofCircle(p, 10); break;
+				case 1: Draw::ring(p, 10, 3, 20); break;
+				case 2: Draw::line(p, p + ofPoint(20, 15), 3); break;
+				case 3: Draw::star(p, 5, 5, 12); break;
+				case 4: Draw::arc(p, 10, 10, 3, 0, 270, 20); break;
+				}
+			}
+		});
+	}
+
+	runFrameScenario("drawPrimitives", "bitmapText", 100, []() {
+		ofBackground(50);
+		ofSetColor(255);
+		for (unsigned int i = 0; i < 100; i++) {
+			ofDrawBitmapString("Benchmark text " + ofToString(i), 20 + (i % 4) * 190, 20 + (i / 4) * 22);
+		}
+	});
+}
+
+void runSynthBenchmarks(void) {
+	using namespace CX::Synth;
+
+	const float sampleRate = 48000;
+	const unsigned int blockSize = 256;
+	const unsigned int blockCount = 1000;
+	const double blockPeriod = 1000.0 * blockSize / sampleRate; //ms
+
+	ModuleControlData_t controlData;
+	controlData.sampleRate = sampleRate;
+
+	for (unsigned int voiceCount : { 16, 64, 256 }) {
+		//Each voice is an oscillator through a filter and an envelope.
+		std::vector<std::unique_ptr<Oscillator>> oscs;
+		std::vector<std::unique_ptr<Filter>> filters;
+		std::vector<std::unique_ptr<Envelope>> envs;
+		Mixer mixer;
+		GenericOutput output;
+
+		for (unsigned int i = 0; i < voiceCount; i++) {
+			oscs.emplace_back(new Oscillator);
+			filters.emplace_back(new Filter);
+			envs.emplace_back(new Envelope);
+
+			oscs.back()->setGeneratorFunction(Oscillator::saw);
+			oscs.back()->frequency = 100 + 10 * i;
+			filters.back()->setType(Filter::FilterType::LOW_PASS);
+			filters.back()->cutoff = 2000;
+			envs.back()->a = 0.01;
+			envs.back()->d = 0.1;
+			envs.back()->s = 0.5;
+			envs.back()->r = 0.1;
+
+			*oscs.back() >> *filters.back() >> *envs.back() >> mixer;
+		}
+		mixer >> output;
+		output.setData(controlData);
+
+		for (auto& env : envs) {
+			env->attack();
+		}
+
+		std::vector<float> block(blockSize);
+		std::vector<double> loads;
+		loads.reserve(blockCount);
+
+		for (unsigned int i = 0; i < blockCount; i++) {
+			CX_Millis start = Clock.now();
+			output.processBlock(block.data(), blockSize);
+			loads.push_back((Clock.now() - start).millis() / blockPeriod);
+		}
+
+		addResult("synthVoices", "osc+filter+envelope", voiceCount, NA, NA, NA, NA, mean(loads), percentile(loads, 0.99), NA);
+	}
+}
+
+void runDataFrameBenchmarks(void) {
+	for (unsigned int rowCount : { 1000, 100000 }) {
+		CX_DataFrame df;
+		for (unsigned int i = 0; i < rowCount; i++) {
+			df(i, "trial") = i;
+			df(i, "condition") = (i % 2 == 0) ? "congruent" : "incongruent";
+			df(i, "rt") = 300 + (i * 7919) % 500;
+			df(i, "correct") = (i % 7) != 0;
+			df(i, "stimulusTime") = Clock.now();
+		}
+
+		auto timeOperation = [&](std::string variant, std::function<void(void)> op) {
+			CX_Millis start = Clock.now();
+			op();
+			CX_Millis elapsed = Clock.now() - start;
+			addResult("dataFrameIO", variant, rowCount, NA, NA, NA, NA, NA, NA, rowCount / elapsed.seconds());
+		};
+
+		std::string textFile = "benchmark_df.txt";
+		std::string binaryFile = "benchmark_df.cxdf";
+
+		timeOperation("printToFile", [&]() { df.printToFile(textFile); });
+		timeOperation("readFromFile", [&]() { CX_DataFrame in; in.readFromFile(textFile); });
+		timeOperation("writeBinary", [&]() { df.writeBinary(binaryFile); });
+		timeOperation("readBinary", [&]() { CX_DataFrame in; in.readBinary(binaryFile); });
+
+		ofFile::removeFile(textFile);
+		ofFile::removeFile(binaryFile);
+	}
+}
+
+void runLoggerBenchmarks(void) {
+	const unsigned int messageCount = 100000;
+	const std::string logFile = "benchmark_log.txt";
+
+	//Only the file is written, so that the speed of the console does not matter.
+	Log.levelForConsole(CX_Logger::Level::LOG_NONE);
+	Log.levelForFile(CX_Logger::Level::LOG_ALL, logFile);
+
+	CX_Millis start = Clock.now();
+	for (unsigned int i = 0; i < messageCount; i++) {
+		Log.notice("benchmark") << "Message number " << i << " at " << Clock.now();
+	}
+	Log.flush();
+	CX_Millis normalElapsed = Clock.now() - start;
+
+	//Real-time messages are stored in a fixed size queue, so they are flushed in batches that fit in it.
+	const unsigned int batchSize = 1000;
+	Log.setRealTimeQueueCapacity(batchSize);
+	CX_Logger::RealTimeChannel channel = Log.realTimeChannel("benchmark");
+
+	start = Clock.now();
+	for (unsigned int i = 0; i < messageCount; i++) {
+		channel.notice("Message number {} at {}", i, Clock.now());
+		if ((i + 1) % batchSize == 0) {
+			Log.flush();
+		}
+	}
+	Log.flush();
+	CX_Millis realTimeElapsed = Clock.now() - start;
+
+	Log.levelForFile(CX_Logger::Level::LOG_NONE, logFile);
+	Log.levelForConsole(CX_Logger::Level::LOG_NOTICE);
+	ofFile::removeFile(logFile);
+
+	addResult("logger", "normal", messageCount, NA, NA, NA, NA, NA, NA, messageCount / normalElapsed.seconds());
+	addResult("logger", "realTimeChannel", messageCount, NA, NA, NA, NA, NA, NA, messageCount / realTimeElapsed.seconds());
+}
+
+void writeSystemInformation(std::string filename) {
+	std::stringstream info;
+	info << "date = " << dateString << endl;
+	info << "openFrameworks = " << OF_VERSION_MAJOR << "." << OF_VERSION_MINOR << "." << OF_VERSION_PATCH << endl;
+	info << "glVendor = " << (const char*)glGetString(GL_VENDOR) << endl;
+	info << "glRenderer = " << (const char*)glGetString(GL_RENDERER) << endl;
+	info << "glVersion = " << (const char*)glGetString(GL_VERSION) << endl;
+	info << "resolution = " << Disp.getResolution().x << "x" << Disp.getResolution().y << endl;
+	info << "framePeriod = " << Disp.getFramePeriod() << endl;
+	info << "framePeriodStandardDeviation = " << Disp.getFramePeriodStandardDeviation() << endl;
+	info << "hardwareThreads = " << std::thread::hardware_concurrency() << endl;
+	info << "clock = " << Clock.getImplementation()->getName() << endl;
+
+	Util::writeToFile(filename, info.str(), false);
+}
@@ -0,0 +1,97 @@
+#include "CX.h"
+
+/*
+This is not an experiment, but a benchmark of two ways of randomly placing the objects of a
+change detection array so that no two objects are too close together. It uses the units of the
+advancedChangeDetection example: degrees of visual angle, with circles that are 1.5 degrees across
+in a region around the center of the screen.
+
+The first way is CX::Algo::generateSeparatedValues(), which works with any type of value and any
+distance function. The second is CX::Algo::generateSeparatedPoints(), which only works with ofPoints
+and Euclidean distance, but is much faster, especially when the objects are packed closely together.
+
+For each array size, the benchmark generates a number of layouts with each function and reports
+the average time per layout and how many times the function gave up.
+*/
+
+struct BenchmarkResult {
+	CX_Millis totalTime;
+	int failures;
+};
+
+BenchmarkResult benchmarkGeneric(int layouts, int count, float minDistance, ofRectangle bounds);
+BenchmarkResult benchmarkPoints(int layouts, int count, float minDistance, ofRectangle bounds);
+
+void runExperiment(void) {
+
+	//The same conversion from degrees of visual angle to pixels that is used in advancedChangeDetection.
+	Util::CX_DegreeToPixelConverter d2p(35, 60);
+
+	float minDistance = d2p(2); //Circles are 1.5 degrees across and have at least half a degree between their edges.
+	float regionSize = d2p(8); //The objects are placed in an 8 by 8 degree square.
+	ofRectangle bounds(Disp.getCenter().x - regionSize / 2, Disp.getCenter().y - regionSize / 2, regionSize, regionSize);
+
+	const int layouts = 100;
+
+	CX_DataFrame results;
+	for (int count = 4; count <= 16; count += 2) {
+		BenchmarkResult generic = benchmarkGeneric(layouts, count, minDistance, bounds);
+		BenchmarkResult points = benchmarkPoints(layouts, count, minDistance, bounds);
+
+		CX_DataFrame::rowIndex_t row = results.getRowCount();
+		results(row, "arraySize") = count;
+		results(row, "genericMsPerLayout") = generic.totalTime.millis() / layouts;
+		results(row, "genericFailures") = generic.failures;
+		results(row, "pointsMsPerLayout") = points.totalTime.millis() / layouts;
+		results(row, "pointsFailures") = points.failures;
+
+		Log.notice() << "Array size " << count << " done.";
+		Log.flush();
+	}
+
+	cout << results.print() << endl;
+	results.printToFile("separated locations benchmark.txt");
+
+	Log.notice() << "Benchmark complete: exiting...";
+	Log.flush();
+}
+
+BenchmarkResult benchmarkGeneric(int layouts, int count, float minDistance, ofRectangle bounds) {
+	auto pointDistance = [](ofPoint a, ofPoint b) -> float {
+		return a.distance(b);
+	};
+
+	auto randomPoint = [&]() -> ofPoint {
+		return ofPoint(RNG.randomDouble(bounds.x, bounds.x + bounds.width), RNG.randomDouble(bounds.y, bounds.y + bounds.height));
+	};
+
+	BenchmarkResult result;
+	result.failures = 0;
+
+	CX_Millis start = Clock.now();
+	for (int i = 0; i < layouts; i++) {
+		std::vector<ofPoint> locations = Algo::generateSeparatedValues<ofPoint, float>(count, minDistance, pointDistance, randomPoint, 1000, 100);
+		if (locations.empty()) {
+			result.failures++;
+		}
+	}
+	result.totalTime = Clock.now() - start;
+
+	return result;
+}
+
+BenchmarkResult benchmarkPoints(int layouts, int count, float minDistance, ofRectangle bounds) {
+	BenchmarkResult result;
+	result.failures = 0;
+
+	CX_Millis start = Clock.now();
+	for (int i = 0; i < layouts; i++) {
+		std::vector<ofPoint> locations = Algo::generateSeparatedPoints(count, minDistance, bounds, 1000, 100);
+		if (locations.empty()) {
+			result.failures++;
+		}
+	}
+	result.totalTime = Clock.now() - start;
+
+	return result;
+}
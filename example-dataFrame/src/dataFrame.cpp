@@ -7,9 +7,9 @@ The idea behind the CX_DataFrame is that it is a way to
 1) Easily store data from an experiment using a clear, concise syntax, and
 2) Easily output that data to a spreadsheet-style file that can be used by analysis software.
 
-You should not use a CX_DataFrame as part of a series of calculations. Data is stored as a 
-string internally so it would be really, really slow because every time data is stored or retrieved, 
-it has to be converted to/from a string.
+You should not use a CX_DataFrame as part of a series of calculations. Numbers, bools, and strings are
+stored in typed columns, but every access looks the column up by name and checks the type of the data,
+which is much slower than using a plain variable or vector.
 
 See the contents of the "myType.h" header file (included with the dataFrame example) for an example of how you can use your
 own types (classes, structs) with CX_DataFrame in a way that will allow you to easily insert and extract data from
@@ -50,7 +50,7 @@ void runExperiment(void) {
 	vector<int> intVector = df("vect", 1);
 
 	//The one thing that is tricky to extract are strings, which require a function call to be extracted
-	string house = df("dwellings", 1).toString(); //which is ironic, given that the data is stored as a string internally...
+	string house = df("dwellings", 1).toString(); //Any stored data can be extracted as a string.
 
 	//To explicitly extract a particular type of data, use to<T>()
 	double explicitDouble = df("double", 2).to<double>();
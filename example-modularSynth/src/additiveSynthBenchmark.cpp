@@ -0,0 +1,40 @@
+#include "CX.h"
+
+/*
+This is not an example of how to make sounds, but a benchmark of how quickly an AdditiveSynth with a
+large number of harmonics can be rendered. The result is given as the number of voices that a single
+core could render in real time. No sound is played, so no sound stream is needed.
+*/
+
+using namespace CX::Synth;
+
+void runExperiment(void) {
+	const float sampleRate = 48000;
+	const unsigned int blockSize = 256;
+	const unsigned int blockCount = 2000;
+
+	ModuleControlData_t controlData;
+	controlData.sampleRate = sampleRate;
+
+	for (unsigned int harmonicCount : { 16, 64, 128 }) {
+		AdditiveSynth synth;
+		synth.setStandardHarmonicSeries(harmonicCount);
+		synth.setAmplitudes(AdditiveSynth::AmplitudePresets::SAW);
+		synth.fundamental = 100;
+		synth.setData(controlData);
+
+		std::vector<float> block(blockSize);
+
+		CX_Millis start = Clock.now();
+		for (unsigned int i = 0; i < blockCount; i++) {
+			synth.processBlock(block.data(), blockSize);
+		}
+		CX_Millis elapsed = Clock.now() - start;
+
+		double secondsRendered = (double)(blockSize * blockCount) / sampleRate;
+		double voicesPerCore = secondsRendered / elapsed.seconds();
+
+		cout << "AdditiveSynth with " << harmonicCount << " harmonics: " << elapsed << " ms to render " << 
+			secondsRendered << " s of sound (" << voicesPerCore << " voices per core)" << endl;
+	}
+}
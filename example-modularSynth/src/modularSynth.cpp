@@ -251,4 +251,4 @@ void modularSynthInternals(void) {
 	for (int i = 0; i < 40; i++) {
 		cout << osc.getNextSample() << endl;
 	}
-}
\ No newline at end of file
+}
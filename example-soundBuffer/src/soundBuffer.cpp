@@ -135,7 +135,7 @@ void runExperiment (void) {
 
 	compoundSound = rightCow; //Set the compound sound equal to the rightCow sound (a copy operation).
 	compoundSound.addSound(leftDuck, 0); //Bring on the ducks!
-	compoundSound.addSound(leftDuck, CX_Seconds(4)); //Because addSound() takes a copy of a CX_SoundBuffer,
+	compoundSound.addSound(leftDuck, CX_Seconds(4)); //Because addSound() does not change the added CX_SoundBuffer,
 		//you can add the same sound to another sound buffer multiple times (you can even add a sound
 		//to itself!).
 	
@@ -5,10 +5,18 @@
 
 #include "CX_Clock.h" //Includes CX::Instances::Clock
 #include "CX_TimeUtilities.h"
+#include "CX_EventTrace.h" //Includes CX::Instances::EventTrace
 
 #include "CX_Display.h" //Includes CX::Instances::Disp
 #include "CX_Draw.h"
+#include "CX_RandomDotKinematogram.h"
 #include "CX_SlidePresenter.h"
+#include "CX_TextureLoader.h"
+#include "CX_FrameCapture.h"
+#include "CX_VideoRecorder.h"
+#include "CX_TrialPipeline.h"
+#include "CX_LatencyCalibration.h"
+#include "CX_TriggerOutput.h"
 
 #include "CX_InputManager.h" //Includes CX::Instances::Input
 #include "CX_Logger.h" //Includes CX::Instances::Log
@@ -16,11 +24,17 @@
 
 #include "CX_SoundBufferPlayer.h"
 #include "CX_SoundBufferRecorder.h"
+#include "CX_SoundStreamFileRecorder.h"
+#include "CX_SoundMixer.h"
 #include "CX_Synth.h"
 
 #include "CX_DataFrame.h"
+#include "CX_DataFrameWriter.h"
+#include "CX_DataFrameGroups.h"
+#include "CX_MarkerStream.h"
 #include "CX_Algorithm.h"
 #include "CX_Utilities.h"
+#include "CX_MemoryUsage.h"
 #include "CX_UnitConversion.h"
 
 #include "CX_Private.h"
@@ -1,10 +1,14 @@
 #include "CX_Algorithm.h"
 
+#include <cmath>
+#include <algorithm>
+
 namespace CX {
 namespace Algo {
 
 /*! \brief Construct a LatinSquare with no contents. */
 LatinSquare::LatinSquare(void) :
+	_rows(0),
 	_columns(0)
 {}
 
@@ -21,114 +25,107 @@ LatinSquare::LatinSquare(unsigned int dimensions) {
 /*! \copydoc CX::Algo::LatinSquare::LatinSquare
 \note This deletes any previous contents of the latin square. */
 void LatinSquare::generate(unsigned int dimensions) {
-	square.resize(dimensions);
+	_rows = dimensions;
 	_columns = dimensions;
-	for (unsigned int i = 0; i < dimensions; i++) {
-		square[i].resize(dimensions);
-		for (unsigned int j = 0; j < dimensions; j++) {
-			square[i][j] = (i + j) % dimensions;
+	_values.resize(_rows * _columns);
+	for (size_t i = 0; i < _rows; i++) {
+		unsigned int* row = &_values[i * _columns];
+		for (size_t j = 0; j < _columns; j++) {
+			row[j] = (unsigned int)((i + j) % dimensions);
 		}
 	}
 }
 
 /*! Creates a latin square that is balanced in the sense that each condition
-precedes each other condition an equal number of times.
+precedes each other condition an equal number of times. This is the Williams design.
 
 If `dimensions` is even, the number of rows of the latin square will be
 equal to `dimensions`. If `dimensions` is odd, the number of rows will
-be `2 * dimensions`.
+be `2 * dimensions`: The second half of the rows are the first half with the
+columns reversed.
 
 \param dimensions The number of conditions in the experiment.
 
 */
 void LatinSquare::generateBalanced(unsigned int dimensions) {
-
-	vector<unsigned int> currentRow(dimensions);
-	deque<unsigned int> firstHelper;
-	for (unsigned int i = 1; i < dimensions; i++) {
-		firstHelper.push_back(i);
-	}
-
-	currentRow[0] = 0;
-	for (unsigned int i = 1; i < dimensions; i++) {
-		if (i % 2 == 0) {
-			currentRow[i] = firstHelper.back();
-			firstHelper.pop_back();
-		} else {
-			currentRow[i] = firstHelper.front();
-			firstHelper.pop_front();
-		}
+	//The first row is 0, 1, n - 1, 2, n - 2, ... and each following row adds 1 to the row before it, modulo n.
+	std::vector<unsigned int> firstRow(dimensions);
+	for (unsigned int j = 0; j < dimensions; j++) {
+		firstRow[j] = (j % 2 == 1) ? (j + 1) / 2 : (dimensions - j / 2) % dimensions;
 	}
 
-	square.resize(dimensions);
+	bool isOdd = (dimensions % 2) == 1;
+	_rows = isOdd ? 2 * (size_t)dimensions : dimensions;
 	_columns = dimensions;
-	for (unsigned int i = 0; i < dimensions; i++) {
-		square[i].resize(dimensions);
-		for (unsigned int j = 0; j < dimensions; j++) {
-			square[i][j] = currentRow[j];
+	_values.resize(_rows * _columns);
 
-			currentRow[j] = (currentRow[j] + 1) % dimensions;
+	for (size_t i = 0; i < dimensions; i++) {
+		unsigned int* row = &_values[i * _columns];
+		for (size_t j = 0; j < _columns; j++) {
+			row[j] = (unsigned int)((firstRow[j] + i) % dimensions);
 		}
 
-	}
-
-	bool isOdd = (dimensions % 2) == 1;
-	if (isOdd) {
-		LatinSquare ls2 = *this;
-		ls2.reverseColumns();
-		this->appendBelow(ls2);
+		if (isOdd) {
+			unsigned int* reversed = &_values[(i + dimensions) * _columns];
+			for (size_t j = 0; j < _columns; j++) {
+				reversed[j] = row[_columns - 1 - j];
+			}
+		}
 	}
 }
 
 /*! This function shifts the columns to the right and the last column is moved
 to be the first column. */
 void LatinSquare::reorderRight(void) {
-	for (size_t i = 0; i < square.size(); i++) {
-		for (size_t j = square[i].size() - 1; j > 0; j--) {
-			std::swap(square[i][j], square[i][j - 1]);
-		}
+	if (_columns == 0) {
+		return;
+	}
+	for (size_t i = 0; i < _rows; i++) {
+		auto row = _values.begin() + i * _columns;
+		std::rotate(row, row + (_columns - 1), row + _columns);
 	}
 }
 
 /*! This function shifts the columns to the left and the first column is moved
 to be the last column. */
 void LatinSquare::reorderLeft(void) {
-	for (size_t i = 0; i < square.size(); i++) {
-		for (size_t j = 0; j < square[i].size() - 1; j++) {
-			std::swap(square[i][j], square[i][j + 1]);
-		}
+	if (_columns == 0) {
+		return;
+	}
+	for (size_t i = 0; i < _rows; i++) {
+		auto row = _values.begin() + i * _columns;
+		std::rotate(row, row + 1, row + _columns);
 	}
 }
 
 /*! This function moves all of the rows up one place, then moves the topmost row to the bottom. */
 void LatinSquare::reorderUp(void) {
-	for (size_t i = 0; i < square.size() - 1; i++) {
-		std::swap(square[i], square[i + 1]);
+	if (_rows == 0) {
+		return;
 	}
+	std::rotate(_values.begin(), _values.begin() + _columns, _values.end());
 }
 
 /*! This function moves all of the rows down one place, then moves the bottommost row to the top. */
 void LatinSquare::reorderDown(void) {
-	for (size_t i = square.size() - 1; i > 0; i--) {
-		std::swap(square[i], square[i - 1]);
+	if (_rows == 0) {
+		return;
 	}
+	std::rotate(_values.begin(), _values.end() - _columns, _values.end());
 }
 
 /*! Reverses the order of the columns in the latin square. */
 void LatinSquare::reverseColumns(void) {
-	std::vector< std::vector<unsigned int> > copy = square;
-	for (size_t i = 0; i < square.size(); i++) {
-		for (size_t j = 0, k = square[i].size() - 1; j < square[i].size(); j++, k--) {
-			square[i][j] = copy[i][k];
-		}
+	for (size_t i = 0; i < _rows; i++) {
+		auto row = _values.begin() + i * _columns;
+		std::reverse(row, row + _columns);
 	}
 }
 
 /*! Reverses the order of the rows in the latin square. */
 void LatinSquare::reverseRows(void) {
-	std::vector< std::vector<unsigned int> > copy = square;
-	for (unsigned int i = 0, j = rows() - 1; i < rows(); i++, j--) {
-		square[i] = copy[j];
+	for (size_t i = 0, j = _rows - 1; i < _rows / 2; i++, j--) {
+		std::swap_ranges(_values.begin() + i * _columns, _values.begin() + (i + 1) * _columns, _values.begin() + j * _columns);
 	}
 }
 
@@ -138,18 +135,18 @@ void LatinSquare::swapColumns(unsigned int c1, unsigned int c2) {
 		return;
 	}
 
-	for (unsigned int i = 0; i < rows(); i++) {
-		std::swap(square[i][c1], square[i][c2]);
+	for (size_t i = 0; i < _rows; i++) {
+		std::swap(_values[i * _columns + c1], _values[i * _columns + c2]);
 	}
 }
 
 /*! Swap the given rows. If either row is out of range, this function has no effect. */
 void LatinSquare::swapRows(unsigned int r1, unsigned int r2) {
-	if (r1 >= rows() || r2 >= rows()) {
+	if (r1 >= rows() || r2 >= rows() || r1 == r2) {
 		return;
 	}
 
-	std::swap(square[r1], square[r2]);
+	std::swap_ranges(_values.begin() + r1 * _columns, _values.begin() + (r1 + 1) * _columns, _values.begin() + r2 * _columns);
 }
 
 /*! Appends another LatinSquare (ls) to the right of this one. If the number of 
@@ -159,14 +156,16 @@ bool LatinSquare::appendRight(const LatinSquare& ls) {
 		return false;
 	}
 
-	_columns += ls.square.front().size();
-
-	for (unsigned int i = 0; i < rows(); i++) {
-		for (unsigned int j = 0; j < ls.columns(); j++) {
-			square[i].push_back(ls.square[i][j]);
-		}
+	size_t newColumns = _columns + ls._columns;
+	std::vector<unsigned int> values(_rows * newColumns);
+	for (size_t i = 0; i < _rows; i++) {
+		std::copy(_values.begin() + i * _columns, _values.begin() + (i + 1) * _columns, values.begin() + i * newColumns);
+		std::copy(ls._values.begin() + i * ls._columns, ls._values.begin() + (i + 1) * ls._columns, values.begin() + i * newColumns + _columns);
 	}
 
+	_values.swap(values);
+	_columns = newColumns;
+
 	return true;
 }
 
@@ -177,19 +176,18 @@ bool LatinSquare::appendBelow(const LatinSquare& ls) {
 		return false;
 	}
 
-	for (unsigned int i = 0; i < ls.rows(); i++) {
-		square.push_back(ls.square[i]);
-	}
+	//Copied first so that a square can be appended below itself.
+	std::vector<unsigned int> below = ls._values;
+	_values.insert(_values.end(), below.begin(), below.end());
+	_rows += ls._rows;
 
 	return true;
 }
 
 /*! Adds the given value to all of the values in the latin square. */
 LatinSquare& LatinSquare::operator+=(unsigned int value) {
-	for (unsigned int i = 0; i < rows(); i++) {
-		for (unsigned int j = 0; j < columns(); j++) {
-			square[i][j] += value;
-		}
+	for (unsigned int& v : _values) {
+		v += value;
 	}
 	return *this;
 }
@@ -198,10 +196,10 @@ LatinSquare& LatinSquare::operator+=(unsigned int value) {
 elements of the latin square. */
 std::string LatinSquare::print(std::string delim) {
 	stringstream s;
-	for (unsigned int i = 0; i < rows(); i++) {
-		for (unsigned int j = 0; j < columns(); j++) {
-			s << square[i][j];
-			if (j != square[i].size() - 1) {
+	for (size_t i = 0; i < _rows; i++) {
+		for (size_t j = 0; j < _columns; j++) {
+			s << _values[i * _columns + j];
+			if (j != _columns - 1) {
 				s << delim;
 			}
 		}
@@ -212,35 +210,40 @@ std::string LatinSquare::print(std::string delim) {
 
 /*! Checks to make sure that the latin square held by this instance is a valid latin square. */
 bool LatinSquare::validate(void) const {
-	if (columns() != rows()) {
+	if (columns() != rows() || _rows == 0) {
 		return false;
 	}
 
-	vector<unsigned int> firstRow = square.front();
-	std::sort(firstRow.begin(), firstRow.end());
-
-	vector<unsigned int>::iterator logicalEnd = std::unique(firstRow.begin(), firstRow.end());
-	if (logicalEnd != firstRow.end()) { //No duplicates allowed!
+	std::vector<unsigned int> symbols(_values.begin(), _values.begin() + _columns);
+	std::sort(symbols.begin(), symbols.end());
+	if (std::adjacent_find(symbols.begin(), symbols.end()) != symbols.end()) { //No duplicates allowed!
 		return false;
 	}
 
-	for (unsigned int i = 1; i < rows(); i++) {
-		vector<unsigned int> thisRow = square[i];
-		std::sort(thisRow.begin(), thisRow.end());
-		for (unsigned int j = 0; j < columns(); j++) {
-			if (thisRow[j] != firstRow[j]) {
+	//Each row and each column must contain each symbol once. The last row or column that each symbol was seen in
+	//is recorded, so a symbol that is seen twice in the same row or column is found without clearing anything between them.
+	std::vector<size_t> seenInRow(_columns, (size_t)-1);
+	std::vector<size_t> seenInColumn(_columns * _columns, (size_t)-1);
+
+	for (size_t i = 0; i < _rows; i++) {
+		for (size_t j = 0; j < _columns; j++) {
+			unsigned int v = _values[i * _columns + j];
+			auto it = std::lower_bound(symbols.begin(), symbols.end(), v);
+			if (it == symbols.end() || *it != v) {
 				return false;
 			}
-		}
-	}
+			size_t symbol = it - symbols.begin();
+
+			if (seenInRow[symbol] == i) {
+				return false;
+			}
+			seenInRow[symbol] = i;
 
-	for (unsigned int j = 0; j < columns(); j++) {
-		vector<unsigned int> thisColumn = getColumn(j);
-		std::sort(thisColumn.begin(), thisColumn.end());
-		for (unsigned int i = 0; i < rows(); i++) {
-			if (thisColumn[i] != firstRow[i]) {
+			size_t& column = seenInColumn[j * _columns + symbol];
+			if (column != (size_t)-1) {
 				return false;
 			}
+			column = i;
 		}
 	}
 
@@ -254,7 +257,7 @@ unsigned int LatinSquare::columns(void) const {
 
 /*! Returns the number of rows. */
 unsigned int LatinSquare::rows(void) const {
-	return (unsigned int)square.size();
+	return (unsigned int)_rows;
 }
 
 /*! Returns a copy of the given column. Throws std::out_of_range if the column is out of range. */
@@ -263,10 +266,9 @@ std::vector<unsigned int> LatinSquare::getColumn(unsigned int col) const {
 		throw std::out_of_range("Latin square column index out of range.");
 	}
 
-
-	std::vector<unsigned int> column(rows());
-	for (unsigned int i = 0; i < rows(); i++) {
-		column[i] = square[i][col];
+	std::vector<unsigned int> column(_rows);
+	for (size_t i = 0; i < _rows; i++) {
+		column[i] = _values[i * _columns + col];
 	}
 	return column;
 };
@@ -277,7 +279,372 @@ std::vector<unsigned int> LatinSquare::getRow(unsigned int row) const {
 		throw std::out_of_range("Latin square row index out of range.");
 	}
 
-	return square[row];
+	return std::vector<unsigned int>(_values.begin() + row * _columns, _values.begin() + (row + 1) * _columns);
+}
+
+/*! Returns a copy of the square as a vector of rows. */
+std::vector< std::vector<unsigned int> > LatinSquare::getSquare(void) const {
+	std::vector< std::vector<unsigned int> > square(_rows);
+	for (size_t i = 0; i < _rows; i++) {
+		square[i].assign(_values.begin() + i * _columns, _values.begin() + (i + 1) * _columns);
+	}
+	return square;
+}
+
+/*! Makes a counterbalancing table that assigns a row of the square to each participant, cycling through
+the rows: Participant `p` gets row `p % rows()`. The table has one row per participant.
+
+\param participants The number of participants.
+\param positionColumnPrefix The value that participant `p` gets in position `j` of their condition order is in column
+`positionColumnPrefix + j`, e.g. "position0".
+\param participantColumn The name of the column that holds the participant index. The index of the row of the square that
+each participant got is in the column "squareRow".
+\return The table. If the square is empty, the returned data frame is empty and an error is logged.
+*/
+CX_DataFrame LatinSquare::toDataFrame(unsigned int participants, std::string positionColumnPrefix, std::string participantColumn) const {
+	CX_DataFrame df;
+	if (_rows == 0 || _columns == 0) {
+		CX::Instances::Log.error("CX::Algo::LatinSquare") << "toDataFrame(): The latin square is empty.";
+		return df;
+	}
+
+	CX_DataFrameColumnHandle<unsigned int> participantHandle = df.columnHandle<unsigned int>(participantColumn);
+	CX_DataFrameColumnHandle<unsigned int> rowHandle = df.columnHandle<unsigned int>("squareRow");
+	std::vector<CX_DataFrameColumnHandle<unsigned int>> positions;
+	positions.reserve(_columns);
+	for (size_t j = 0; j < _columns; j++) {
+		positions.push_back(df.columnHandle<unsigned int>(positionColumnPrefix + ofToString(j)));
+	}
+	df.setRowCount(participants);
+
+	for (CX_DataFrame::rowIndex_t p = 0; p < participants; p++) {
+		participantHandle[p] = (unsigned int)p;
+		rowHandle[p] = (unsigned int)(p % _rows);
+	}
+
+	//Filling one column at a time keeps the writes to each column sequential.
+	for (size_t j = 0; j < _columns; j++) {
+		for (CX_DataFrame::rowIndex_t p = 0; p < participants; p++) {
+			positions[j][p] = _values[(p % _rows) * _columns + j];
+		}
+	}
+
+	return df;
+}
+
+
+namespace Private {
+
+	//A grid over the bounds. Each cell lists the points in it so that a new point only has to be compared
+	//with the points in the nearby cells. The cells that are not yet known to be fully covered are kept in a list
+	//so that new points are only drawn from places where they might fit.
+	class SeparatedPointGrid {
+	public:
+
+		SeparatedPointGrid(float minDistance, const ofRectangle& bounds, size_t count) :
+			_minDistance(minDistance),
+			_minDistanceSquared(minDistance * minDistance),
+			_bounds(bounds)
+		{
+			//Small cells are more often entirely covered, which lets the sampler find out sooner that there is no room
+			//left, but each candidate point must then be checked against more cells. If there would be too many cells,
+			//they are made bigger and can hold more than one point.
+			const double maxCells = std::max<double>(1 << 16, 64.0 * count);
+
+			_cellSize = minDistance / 4;
+			double cells = std::ceil(bounds.width / _cellSize) * std::ceil(bounds.height / _cellSize);
+			if (cells > maxCells) {
+				_cellSize = (float)std::sqrt((double)bounds.width * bounds.height / maxCells);
+			}
+
+			_columns = std::max(1, (int)std::ceil(bounds.width / _cellSize));
+			_rows = std::max(1, (int)std::ceil(bounds.height / _cellSize));
+			_reach = (int)std::ceil(minDistance / _cellSize);
+
+			_cellPoints.resize(_columns * _rows);
+			_freeSlot.resize(_columns * _rows);
+		}
+
+		void clear(void) {
+			_points.clear();
+			for (std::vector<size_t>& c : _cellPoints) {
+				c.clear();
+			}
+
+			_freeCells.resize(_cellPoints.size());
+			for (size_t i = 0; i < _freeCells.size(); i++) {
+				_freeCells[i] = i;
+				_freeSlot[i] = i;
+			}
+		}
+
+		bool full(void) const {
+			return _freeCells.empty();
+		}
+
+		const std::vector<ofPoint>& points(void) const {
+			return _points;
+		}
+
+		//Returns true if the candidate was far enough from every other point and was added.
+		bool tryAdd(CX_RandomNumberGenerator* rng) {
+			size_t cell = _freeCells[(size_t)rng->randomInt(0, _freeCells.size() - 1)];
+			int cx = (int)(cell % _columns);
+			int cy = (int)(cell / _columns);
+
+			ofPoint p(_bounds.x + (cx + rng->randomDouble(0, 1)) * _cellSize, _bounds.y + (cy + rng->randomDouble(0, 1)) * _cellSize);
+			if (p.x >= _bounds.x + _bounds.width || p.y >= _bounds.y + _bounds.height) {
+				return false; //Cells on the right and bottom edges can stick out of the bounds.
+			}
+
+			for (int y = std::max(0, cy - _reach); y <= std::min(_rows - 1, cy + _reach); y++) {
+				for (int x = std::max(0, cx - _reach); x <= std::min(_columns - 1, cx + _reach); x++) {
+					for (size_t i : _cellPoints[y * _columns + x]) {
+						if (_distanceSquared(_points[i], p) < _minDistanceSquared) {
+							if (_cellCovered(cx, cy)) {
+								_removeFreeCell(cell);
+							}
+							return false;
+						}
+					}
+				}
+			}
+
+			_cellPoints[cell].push_back(_points.size());
+			_points.push_back(p);
+
+			//Cells that are entirely within minDistance of the new point can never hold another point.
+			for (int y = std::max(0, cy - _reach); y <= std::min(_rows - 1, cy + _reach); y++) {
+				for (int x = std::max(0, cx - _reach); x <= std::min(_columns - 1, cx + _reach); x++) {
+					if (_covers(p, _cellLeft(x), _cellTop(y), _cellRight(x), _cellBottom(y))) {
+						_removeFreeCell(y * _columns + x);
+					}
+				}
+			}
+
+			return true;
+		}
+
+	private:
+		float _minDistance;
+		float _minDistanceSquared;
+		ofRectangle _bounds;
+
+		float _cellSize;
+		int _columns;
+		int _rows;
+		int _reach; //How many cells away a point can be and still be too close to a point in this cell.
+
+		std::vector<ofPoint> _points;
+		std::vector<std::vector<size_t>> _cellPoints;
+
+		std::vector<size_t> _freeCells;
+		std::vector<size_t> _freeSlot; //Where each cell is in _freeCells, if it is there.
+
+		std::vector<size_t> _nearby;
+
+		static float _distanceSquared(const ofPoint& a, const ofPoint& b) {
+			float dx = a.x - b.x;
+			float dy = a.y - b.y;
+			return dx * dx + dy * dy;
+		}
+
+		float _cellLeft(int cx) const { return _bounds.x + cx * _cellSize; };
+		float _cellTop(int cy) const { return _bounds.y + cy * _cellSize; };
+		float _cellRight(int cx) const { return std::min(_cellLeft(cx) + _cellSize, _bounds.x + _bounds.width); };
+		float _cellBottom(int cy) const { return std::min(_cellTop(cy) + _cellSize, _bounds.y + _bounds.height); };
+
+		//A rectangle is covered by a point if every corner of the rectangle is too close to the point.
+		bool _covers(const ofPoint& p, float left, float top, float right, float bottom) const {
+			return _distanceSquared(p, ofPoint(left, top)) < _minDistanceSquared &&
+				_distanceSquared(p, ofPoint(right, top)) < _minDistanceSquared &&
+				_distanceSquared(p, ofPoint(left, bottom)) < _minDistanceSquared &&
+				_distanceSquared(p, ofPoint(right, bottom)) < _minDistanceSquared;
+		}
+
+		//Checks whether the part of a cell within the bounds is covered by the points near it, together. The cell is split
+		//into quarters, down to a few levels, and each piece must be covered by one point. When this returns false, the cell
+		//might still be covered, but when it returns true, there is certainly no room in it.
+		bool _cellCovered(int cx, int cy) {
+			_nearby.clear();
+			for (int y = std::max(0, cy - _reach); y <= std::min(_rows - 1, cy + _reach); y++) {
+				for (int x = std::max(0, cx - _reach); x <= std::min(_columns - 1, cx + _reach); x++) {
+					for (size_t i : _cellPoints[y * _columns + x]) {
+						_nearby.push_back(i);
+					}
+				}
+			}
+			return _rectCovered(_cellLeft(cx), _cellTop(cy), _cellRight(cx), _cellBottom(cy), 3);
+		}
+
+		bool _rectCovered(float left, float top, float right, float bottom, int depth) const {
+			for (size_t i : _nearby) {
+				if (_covers(_points[i], left, top, right, bottom)) {
+					return true;
+				}
+			}
+			if (depth == 0) {
+				return false;
+			}
+
+			float midX = (left + right) / 2;
+			float midY = (top + bottom) / 2;
+			return _rectCovered(left, top, midX, midY, depth - 1) &&
+				_rectCovered(midX, top, right, midY, depth - 1) &&
+				_rectCovered(left, midY, midX, bottom, depth - 1) &&
+				_rectCovered(midX, midY, right, bottom, depth - 1);
+		}
+
+		void _removeFreeCell(size_t cell) {
+			size_t slot = _freeSlot[cell];
+			if (slot >= _freeCells.size() || _freeCells[slot] != cell) {
+				return;
+			}
+			size_t last = _freeCells.back();
+			_freeCells[slot] = last;
+			_freeSlot[last] = slot;
+			_freeCells.pop_back();
+		}
+	};
+
+} //namespace Private
+
+/*! This function generates random points within a rectangle that are each at least some distance from every other point.
+It does the same thing as \ref CX::Algo::generateSeparatedValues() with Euclidean distance between `ofPoint`s and points
+drawn uniformly from the rectangle, but much faster, especially when the points are packed closely together.
+
+The rectangle is covered by a grid of cells, so each new point only has to be compared with points in nearby cells. Parts
+of the rectangle that are too close to an existing point to hold another point are not drawn from again, so most draws give
+usable points even when there is little room left. The points have the same distribution as with generateSeparatedValues():
+each point is drawn uniformly from the part of the rectangle that is far enough from the previous points.
+
+\param count The number of points you want to be generated.
+\param minDistance The minimum distance between any two points.
+\param bounds The rectangle that the points should be in. The x and y coordinates of the points are in
+`[bounds.x, bounds.x + bounds.width)` and `[bounds.y, bounds.y + bounds.height)`. The z coordinate is 0.
+\param maxSequentialFailures The maximum number of times in a row that a newly-generated point can be too close to
+a previous point before the process is restarted. If there is no room left for another point, the process is restarted immediately.
+\param maxRestarts If non-negative, the number of times that the algorithm will restart before giving up. If negative,
+the algorithm will never give up. Note that this may result in an infinite loop if it is impossible to get enough points.
+\param rng The random number generator to use.
+\return A vector of points. If the function gave up, the returned vector will have 0 elements.
+
+\code{.cpp}
+//Get 12 locations for objects with 60 pixels between the centers of every pair of objects.
+std::vector<ofPoint> locations = Algo::generateSeparatedPoints(12, 60, ofRectangle(100, 100, 400, 400));
+\endcode
+*/
+std::vector<ofPoint> generateSeparatedPoints(int count, float minDistance, ofRectangle bounds, unsigned int maxSequentialFailures,
+											 int maxRestarts, CX_RandomNumberGenerator* rng)
+{
+	bounds.standardize();
+
+	if (count <= 0) {
+		return std::vector<ofPoint>();
+	}
+
+	if (bounds.width <= 0 || bounds.height <= 0) {
+		CX::Instances::Log.error("CX::Algo::generateSeparatedPoints") << "The bounds have no area. Returning an empty vector.";
+		return std::vector<ofPoint>();
+	}
+
+	if (minDistance <= 0) {
+		std::vector<ofPoint> points(count);
+		for (ofPoint& p : points) {
+			p = ofPoint(rng->randomDouble(bounds.x, bounds.x + bounds.width), rng->randomDouble(bounds.y, bounds.y + bounds.height));
+		}
+		return points;
+	}
+
+	Private::SeparatedPointGrid grid(minDistance, bounds, count);
+
+	while (true) {
+		grid.clear();
+
+		unsigned int sequentialFailures = 0;
+		while (grid.points().size() < (size_t)count && !grid.full() && sequentialFailures < maxSequentialFailures) {
+			if (grid.tryAdd(rng)) {
+				sequentialFailures = 0;
+			} else {
+				sequentialFailures++;
+			}
+		}
+
+		if (grid.points().size() == (size_t)count) {
+			return grid.points();
+		}
+
+		//If maxRestarts is greater than 0, restart. If it's less than 0, restart continuously.
+		if (maxRestarts == 0) {
+			CX::Instances::Log.error("CX::Algo::generateSeparatedPoints") << "Maximum number of restarts reached. Returning an empty vector.";
+			return std::vector<ofPoint>();
+		}
+		if (maxRestarts > 0) {
+			maxRestarts--;
+		}
+	}
+}
+
+/*! Constructs a BlockIndexSampler with no indices to sample. */
+BlockIndexSampler::BlockIndexSampler(void) :
+	_rng(nullptr),
+	_count(0),
+	_blockPosition(0),
+	_blockNumber(0)
+{}
+
+/*! Constructs a BlockIndexSampler with the given settings. See setup() for the meaning of the parameters. */
+BlockIndexSampler::BlockIndexSampler(CX_RandomNumberGenerator* rng, uint64_t count) :
+	BlockIndexSampler()
+{
+	setup(rng, count);
+}
+
+/*! Set up the BlockIndexSampler.
+\param rng A pointer to a CX_RandomNumberGenerator that will be used to randomize the order of the indices.
+\param count The number of indices in each block. The indices that are sampled go from `0` to `count - 1`.
+*/
+void BlockIndexSampler::setup(CX_RandomNumberGenerator* rng, uint64_t count) {
+	_rng = rng;
+	_count = count;
+	restartSampling();
+}
+
+/*! Get the next index in the current block. When every index in the block has been returned, a new block is started.
+\return An index from `0` to `getBlockSize() - 1`. If there are no indices to sample, an error is logged and 0 is returned. */
+uint64_t BlockIndexSampler::getNextIndex(void) {
+	if (_count == 0 || _rng == nullptr) {
+		CX::Instances::Log.error("BlockIndexSampler") << "getNextIndex: Index requested but there are no indices to sample from. Did you call setup()?";
+		return 0;
+	}
+
+	//One step of a Fisher-Yates shuffle of the positions at or after the current position.
+	//Positions that are not in _swapped still hold their own index.
+	uint64_t j = (uint64_t)_rng->randomInt((CX_RandomInt_t)_blockPosition, (CX_RandomInt_t)(_count - 1));
+
+	auto swappedJ = _swapped.find(j);
+	uint64_t index = (swappedJ == _swapped.end()) ? j : swappedJ->second;
+
+	if (j != _blockPosition) {
+		auto swappedPos = _swapped.find(_blockPosition);
+		_swapped[j] = (swappedPos == _swapped.end()) ? _blockPosition : swappedPos->second;
+	}
+	_swapped.erase(_blockPosition);
+
+	if (++_blockPosition == _count) {
+		_swapped.clear();
+		_blockPosition = 0;
+		_blockNumber++;
+	}
+
+	return index;
+}
+
+/*! Restarts sampling to be at the beginning of a block of samples. Also resets the block number to 0. */
+void BlockIndexSampler::restartSampling(void) {
+	_swapped.clear();
+	_blockPosition = 0;
+	_blockNumber = 0;
 }
 
 } //namespace Algo
@@ -6,6 +6,12 @@
 #include <utility> //pair
 #include <string>
 #include <functional>
+#include <memory>
+#include <limits>
+#include <iterator>
+#include <type_traits>
+#include <unordered_map>
+#include <cstdint>
 
 #include "CX_Logger.h"
 #include "CX_RandomNumberGenerator.h"
@@ -19,6 +25,9 @@ namespace CX {
 		std::vector<dataT> generateSeparatedValues(int count, distT minDistance, std::function<distT(dataT, dataT)> distanceFunction,
 												std::function<dataT(void)> randomDeviate, unsigned int maxSequentialFailures, int maxRestarts);
 
+		std::vector<ofPoint> generateSeparatedPoints(int count, float minDistance, ofRectangle bounds, unsigned int maxSequentialFailures = 1000,
+													 int maxRestarts = 100, CX_RandomNumberGenerator* rng = &CX::Instances::RNG);
+
 		template <typename T> 
 		std::vector< std::vector<T> > fullyCross (std::vector< std::vector<T> > factors);
 
@@ -57,6 +66,16 @@ namespace CX {
 			cout << "The latin square is no longer valid, but it is still useful (8 counterbalancing conditions, both forward and backward ordering)." << endl;
 		}
 		\endcode
+
+		The values are stored in one contiguous array (see getValues()), so squares with hundreds of conditions can be generated
+		and rearranged quickly. To assign condition orders to participants, use toDataFrame():
+
+		\code{.cpp}
+		Algo::LatinSquare ls;
+		ls.generateBalanced(120);
+		CX_DataFrame schedule = ls.toDataFrame(480); //One row per participant, with columns position0 to position119.
+		schedule.printToFile("counterbalancing.txt");
+		\endcode
 		*/
 		class LatinSquare {
 		public:
@@ -92,13 +111,72 @@ namespace CX {
 			std::vector<unsigned int> getColumn(unsigned int col) const;
 			std::vector<unsigned int> getRow(unsigned int row) const;
 
-			std::vector< std::vector<unsigned int> > square; //!< The Latin square.
-			
+			/*! Returns a reference to the value at the given row and column. The indices are not checked. */
+			unsigned int& operator()(unsigned int row, unsigned int col) { return _values[row * _columns + col]; };
+			/*! Returns the value at the given row and column. The indices are not checked. */
+			unsigned int operator()(unsigned int row, unsigned int col) const { return _values[row * _columns + col]; };
+
+			/*! Returns the values of the square, one row after another. Row `r` is in `[r * columns(), (r + 1) * columns())`. */
+			const std::vector<unsigned int>& getValues(void) const { return _values; };
+			std::vector< std::vector<unsigned int> > getSquare(void) const;
+
+			CX_DataFrame toDataFrame(unsigned int participants, std::string positionColumnPrefix = "position",
+									 std::string participantColumn = "participant") const;
+
 		private:
+			std::vector<unsigned int> _values; //Stored by row.
+			size_t _rows;
 			size_t _columns;
 		};
 
 
+		/*! This class produces the indices `0` to `count - 1` in random order, one block of `count` indices at a time.
+		The order is drawn as the indices are requested with a Fisher-Yates shuffle that only remembers the positions that
+		have been swapped, so the memory used depends on how many indices have been drawn in the current block, not on `count`.
+		This makes it possible to sample from a set of values that is too large to shuffle, such as the rows of a large
+		CX::Algo::CrossedDesign, without storing the set.
+
+		\code{.cpp}
+		Algo::CrossedDesign<int> design({ Util::intVector(1, 100), Util::intVector(1, 100), Util::intVector(1, 100) });
+
+		Algo::BlockIndexSampler sampler(&RNG, design.size());
+		for (int trial = 0; trial < 1000; trial++) {
+			std::vector<int> levels = design.getRow(sampler.getNextIndex());
+			//Set up the trial with the levels...
+		}
+		\endcode
+		*/
+		class BlockIndexSampler {
+		public:
+
+			BlockIndexSampler(void);
+			BlockIndexSampler(CX_RandomNumberGenerator* rng, uint64_t count);
+
+			void setup(CX_RandomNumberGenerator* rng, uint64_t count);
+
+			uint64_t getNextIndex(void);
+			void restartSampling(void);
+
+			/*! Returns the number of indices in each block. */
+			uint64_t getBlockSize(void) const { return _count; };
+
+			/*! Returns the index of the block that is currently being sampled. Because it is zero-indexed,
+			you can alternately think of the value as the number of completed blocks. */
+			unsigned int getBlockNumber(void) const { return _blockNumber; };
+
+			/*! Returns the position in the current block of the index that will be returned the next time getNextIndex() is called. */
+			uint64_t getBlockPosition(void) const { return _blockPosition; };
+
+		private:
+			CX_RandomNumberGenerator* _rng;
+			uint64_t _count;
+
+			std::unordered_map<uint64_t, uint64_t> _swapped; //The values at the positions that have been swapped in this block.
+			uint64_t _blockPosition;
+			unsigned int _blockNumber;
+		};
+
+
 		/*! This class helps with the case where a set of V values must be sampled randomly
 		with the constraint that each block of V samples should have each value in the set.
 		For example, if you want to	present a number of trials in four different conditions, 
@@ -122,15 +200,15 @@ namespace CX {
 		}
 		\endcode
 
+		The order of the values within each block is drawn as the values are sampled (see CX::Algo::BlockIndexSampler).
+
 		\note Another way of getting blocked random samples is to use CX::CX_RandomNumberGenerator::sampleBlocks().
 		*/
 		template <typename T>
 		class BlockSampler {
 		public:
 
-			BlockSampler(void) :
-				_rng(nullptr)
-			{}
+			BlockSampler(void) {}
 
 			/*! Constructs a BlockSampler with the given settings. See setup() for the meaning of the parameters. */
 			BlockSampler(CX_RandomNumberGenerator* rng, const std::vector<T>& values) {
@@ -142,76 +220,277 @@ namespace CX {
 			\param values A vector of values from which to sample.
 			*/
 			void setup(CX_RandomNumberGenerator* rng, const std::vector<T>& values) {
-				_rng = rng;
+				_df.reset();
 				_values = values;
-				_blockIndices = Util::intVector<unsigned int>(0, _values.size() - 1);
-				restartSampling();
+				_indices.setup(rng, _values.size());
 			}
 
 			/*! Set up the BlockSampler from a CX_DataFrame. This only works if the
-			BlockSampler is templated to use CX_DataFrameRow as its type. Each row
-			of the CX_DataFrame will be copied into the BlockSampler.
+			BlockSampler is templated to use CX_DataFrameRow as its type. The CX_DataFrame
+			is copied into the BlockSampler and each sampled row is copied out of it when it is sampled.
 			
 			\param rng A pointer to a CX_RandomNumberGenerator that will be used to randomize the sampled data.
 			\param df A CX_DataFrame.
 			*/
 			void setup(CX_RandomNumberGenerator* rng, const CX_DataFrame& df) {
-				std::vector<CX_DataFrameRow> allRows(df.getRowCount());
-				for (CX_DataFrame::rowIndex_t i = 0; i < df.getRowCount(); i++) {
-					allRows[i] = df.copyRow(i);
-				}
-				this->setup(rng, allRows);
+				static_assert(std::is_same<T, CX_DataFrameRow>::value, "BlockSampler::setup(): Only a BlockSampler<CX_DataFrameRow> can be set up from a CX_DataFrame.");
+				_values.clear();
+				_df = std::make_shared<CX_DataFrame>(df);
+				_indices.setup(rng, _df->getRowCount());
 			}
 
 			/*! Get the next value sampled from the provided data.
 			\return An element sampled from the provided values, or, if there were no values provided, 
 			a warning will be logged and a default-constructed instance of T will be returned. */
 			T getNextValue(void) {
-				if (_values.size() == 0) {
+				if (_indices.getBlockSize() == 0) {
 					CX::Instances::Log.warning("BlockSampler") << "getNextValue: Value requested but no values avaiable to sample from."
 						"Did you provide a vector of values to the BlockSampler?";
 					return T();
 				}
 
-				T rval = _values[_blockIndices[_blockPosition]];
-				if (++_blockPosition >= _blockIndices.size()) {
-					_blockPosition = 0;
-					_rng->shuffleVector(&_blockIndices);
-					_blockNumber++;
-				}
-				return rval;
+				return _valueAt((size_t)_indices.getNextIndex(), std::is_same<T, CX_DataFrameRow>());
 			}
 
-			/*! Restarts sampling to be at the beginning of a block of samples. Also resets the block number (  */
+			/*! Restarts sampling to be at the beginning of a block of samples. Also resets the block number to 0. */
 			void restartSampling(void) {
-				_blockPosition = 0;
-				_blockNumber = 0;
-				_rng->shuffleVector(&_blockIndices);
+				_indices.restartSampling();
 			}
 
 			/*! Returns the index of the block that is currently being sampled. Because it is zero-indexed, 
 			you can alternately think of the value as the number of completed blocks. */
 			unsigned int getBlockNumber(void) const {
-				return _blockNumber;
+				return _indices.getBlockNumber();
 			}
 
 			/*! Returns the index of the sample that will be taken the next time getNextValue() is called. If 0,
 			it means that a block of samples was just finished. 
 			If within the current block 4 samples had already been taken, this will return 4 */
 			unsigned int getBlockPosition(void) const {
-				return _blockPosition;
+				return (unsigned int)_indices.getBlockPosition();
 			}
 
 		private:
-			CX_RandomNumberGenerator* _rng;
-
 			std::vector<T> _values;
+			std::shared_ptr<CX_DataFrame> _df;
 
-			std::vector<unsigned int> _blockIndices;
-			unsigned int _blockPosition;
-			unsigned int _blockNumber;
+			BlockIndexSampler _indices;
+
+			T _valueAt(size_t index, std::true_type) const { return _df ? _df->copyRow(index) : _values[index]; };
+			T _valueAt(size_t index, std::false_type) const { return _values[index]; };
+		};
+
+
+		/*! This class represents all of the combinations of the levels of the factors of a design, as would be returned by
+		CX::Algo::fullyCross(), without storing them. Each combination (i.e. row of the crossed design) is decoded from its
+		index when it is requested, so it takes no more memory to represent a design with millions of combinations than it
+		takes to store the levels of the factors. The combinations are in the same order as they are in the result of fullyCross():
+		the levels of the last factor change the fastest.
+
+		\code{.cpp}
+		std::map<std::string, std::vector<int>> factors;
+		factors["contrast"] = Util::intVector(1, 20);
+		factors["orientation"] = Util::intVector(0, 179);
+		factors["size"] = Util::intVector(1, 10);
+
+		Algo::CrossedDesign<int> design(factors); //36,000 combinations, but none of them are stored.
+
+		//Sample 200 of the combinations, without replacement, into a data frame of trials.
+		std::vector<Algo::CrossedDesign<int>::index_t> rows;
+		Algo::BlockIndexSampler sampler(&RNG, design.size());
+		for (int i = 0; i < 200; i++) {
+			rows.push_back(sampler.getNextIndex());
+		}
+		CX_DataFrame trials = design.toDataFrame(rows);
+		\endcode
+
+		\tparam T The type of the levels of the factors.
+		*/
+		template <typename T>
+		class CrossedDesign {
+		public:
+
+			typedef uint64_t index_t; //!< The type of the index of a combination of levels.
+
+			/*! An iterator over the combinations of a CrossedDesign. Dereferencing it gives the levels of the combination. */
+			class const_iterator {
+			public:
+				typedef std::input_iterator_tag iterator_category;
+				typedef std::vector<T> value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef const std::vector<T>* pointer;
+				typedef std::vector<T> reference;
+
+				std::vector<T> operator*(void) const { return _design->getRow(_index); };
+				const_iterator& operator++(void) { _index++; return *this; };
+				const_iterator operator++(int) { const_iterator old = *this; _index++; return old; };
+				bool operator==(const const_iterator& other) const { return _index == other._index && _design == other._design; };
+				bool operator!=(const const_iterator& other) const { return !(*this == other); };
+
+				/*! Returns the index of the combination that the iterator refers to. */
+				index_t index(void) const { return _index; };
+
+			private:
+				friend class CrossedDesign<T>;
+				const_iterator(const CrossedDesign<T>* design, index_t index) : _design(design), _index(index) {};
+
+				const CrossedDesign<T>* _design;
+				index_t _index;
+			};
+
+			CrossedDesign(void);
+			CrossedDesign(std::vector<std::vector<T>> factors, std::vector<std::string> names = std::vector<std::string>());
+			CrossedDesign(const std::map<std::string, std::vector<T>>& factors);
+
+			/*! Returns the number of combinations of levels, which is the product of the number of levels of each factor. */
+			index_t size(void) const { return _size; };
+
+			/*! Returns the number of factors. */
+			size_t getFactorCount(void) const { return _factors.size(); };
+
+			/*! Returns the names of the factors. */
+			const std::vector<std::string>& getFactorNames(void) const { return _names; };
+
+			const T& getLevel(index_t row, size_t factor) const;
+			size_t getLevelIndex(index_t row, size_t factor) const;
+			std::vector<T> getRow(index_t row) const;
+
+			CX_DataFrameRow getDataFrameRow(index_t row) const;
+			CX_DataFrame toDataFrame(void) const;
+			CX_DataFrame toDataFrame(const std::vector<index_t>& rows) const;
+
+			const_iterator begin(void) const { return const_iterator(this, 0); };
+			const_iterator end(void) const { return const_iterator(this, _size); };
+
+		private:
+			std::vector<std::vector<T>> _factors;
+			std::vector<std::string> _names;
+			std::vector<index_t> _strides; //The number of combinations between each change of level of each factor.
+			index_t _size;
+
+			void _setup(void);
 		};
 
+		/*! Constructs a design with no factors. */
+		template <typename T>
+		CrossedDesign<T>::CrossedDesign(void) :
+			_size(0)
+		{}
+
+		/*! Constructs a design from a vector of factors.
+		\param factors A vector of factors, each factor being a vector containing all the levels of that factor.
+		\param names The names of the factors, which are used as the names of columns by getDataFrameRow() and toDataFrame().
+		If empty, the factors are named "factor0", "factor1", etc. */
+		template <typename T>
+		CrossedDesign<T>::CrossedDesign(std::vector<std::vector<T>> factors, std::vector<std::string> names) :
+			_factors(std::move(factors)),
+			_names(std::move(names))
+		{
+			if (_names.size() != _factors.size()) {
+				if (!_names.empty()) {
+					CX::Instances::Log.error("CrossedDesign") << "The number of names (" << _names.size() << ") did not match the number of factors (" <<
+						_factors.size() << "). The factors will be given default names.";
+				}
+				_names.clear();
+				for (size_t f = 0; f < _factors.size(); f++) {
+					_names.push_back("factor" + ofToString(f));
+				}
+			}
+			_setup();
+		}
+
+		/*! Constructs a design from a map that uses the name of a factor as the key and a vector of factor levels as the value.
+		The factors are in the order of the map, i.e. sorted by name. */
+		template <typename T>
+		CrossedDesign<T>::CrossedDesign(const std::map<std::string, std::vector<T>>& factors) {
+			for (const std::pair<const std::string, std::vector<T>>& f : factors) {
+				_names.push_back(f.first);
+				_factors.push_back(f.second);
+			}
+			_setup();
+		}
+
+		template <typename T>
+		void CrossedDesign<T>::_setup(void) {
+			_strides.assign(_factors.size(), 1);
+			_size = 1;
+			for (size_t f = _factors.size(); f-- > 0; ) {
+				_strides[f] = _size;
+
+				index_t levels = _factors[f].size();
+				if (levels != 0 && _size > std::numeric_limits<index_t>::max() / levels) {
+					CX::Instances::Log.error("CrossedDesign") << "The design has too many combinations of levels to be represented.";
+					_size = 0;
+					return;
+				}
+				_size *= levels;
+			}
+		}
+
+		/*! Returns the level of the given factor in the given combination. The combination must be less than size(). */
+		template <typename T>
+		const T& CrossedDesign<T>::getLevel(index_t row, size_t factor) const {
+			return _factors[factor][getLevelIndex(row, factor)];
+		}
+
+		/*! Returns the index of the level of the given factor in the given combination. The combination must be less than size(). */
+		template <typename T>
+		size_t CrossedDesign<T>::getLevelIndex(index_t row, size_t factor) const {
+			return (size_t)((row / _strides[factor]) % _factors[factor].size());
+		}
+
+		/*! Returns the levels of each factor in the given combination. The combination must be less than size(). */
+		template <typename T>
+		std::vector<T> CrossedDesign<T>::getRow(index_t row) const {
+			std::vector<T> levels;
+			levels.reserve(_factors.size());
+			for (size_t f = 0; f < _factors.size(); f++) {
+				levels.push_back(getLevel(row, f));
+			}
+			return levels;
+		}
+
+		/*! Returns the levels of each factor in the given combination in a CX_DataFrameRow, with the names of the factors as the column names. */
+		template <typename T>
+		CX_DataFrameRow CrossedDesign<T>::getDataFrameRow(index_t row) const {
+			CX_DataFrameRow r;
+			for (size_t f = 0; f < _factors.size(); f++) {
+				r[_names[f]] = getLevel(row, f);
+			}
+			return r;
+		}
+
+		/*! Returns all of the combinations in a CX_DataFrame, with the names of the factors as the column names. This stores the whole design,
+		so for large designs, you should use toDataFrame(const std::vector<index_t>&) to get only the combinations you need. */
+		template <typename T>
+		CX_DataFrame CrossedDesign<T>::toDataFrame(void) const {
+			std::vector<index_t> rows(_size);
+			for (index_t i = 0; i < _size; i++) {
+				rows[i] = i;
+			}
+			return toDataFrame(rows);
+		}
+
+		/*! Returns the given combinations in a CX_DataFrame, with the names of the factors as the column names.
+		\param rows The indices of the combinations. Each must be less than size(). */
+		template <typename T>
+		CX_DataFrame CrossedDesign<T>::toDataFrame(const std::vector<index_t>& rows) const {
+			CX_DataFrame df;
+
+			std::vector<CX_DataFrameColumnHandle<T>> columns;
+			for (const std::string& name : _names) {
+				columns.push_back(df.columnHandle<T>(name));
+			}
+			df.setRowCount(rows.size());
+
+			for (size_t f = 0; f < _factors.size(); f++) {
+				for (CX_DataFrame::rowIndex_t i = 0; i < rows.size(); i++) {
+					columns[f][i] = getLevel(rows[i], f);
+				}
+			}
+			return df;
+		}
+
 
 		/*! This algorithm is designed to deal with the situation in which a number
 		of random values must be generated that are each at least some distance from every other
@@ -266,6 +545,8 @@ namespace CX {
 		//Call of example function
 		vector<ofPoint> v = getObjectLocations(5, 50, ofPoint(0, 0), ofPoint(400, 400));
 		\endcode
+
+		\note For `ofPoint`s with Euclidean distance, as in the example, CX::Algo::generateSeparatedPoints() does the same thing much faster.
 		*/
 		template <typename dataT, typename distT>
 		std::vector<dataT> generateSeparatedValues(int count, distT minDistance, std::function<distT(dataT, dataT)> distanceFunction,
@@ -288,15 +569,15 @@ namespace CX {
 				if (sampleRejected) {
 					if (++sequentialFailures >= maxSequentialFailures) {
 						//If maxRestarts is greater than 0, restart. If it's less than 0, restart continuously.
-						if (maxRestarts != 0) {
-							if (maxRestarts < 0) {
-								maxRestarts++;
-							}
-							return generateSeparatedValues(count, minDistance, distanceFunction, randomDeviate, maxSequentialFailures, maxRestarts - 1);
-						} else {
+						if (maxRestarts == 0) {
 							CX::Instances::Log.error("CX::Algo::generateSeparatedValues") << "Maximum number of restarts reached. Returning an empty vector.";
 							return std::vector<dataT>();
 						}
+						if (maxRestarts > 0) {
+							maxRestarts--;
+						}
+						samples.clear();
+						sequentialFailures = 0;
 					}
 				} else {
 					sequentialFailures = 0;
@@ -335,42 +616,19 @@ namespace CX {
 		crossed[3][1] == 3
 		crossed[0][1] == 3
 		\endcode
+
+		Every combination is stored in the result. For designs with many combinations, use CX::Algo::CrossedDesign instead,
+		which gives the same combinations without storing them.
 		*/
 		template <typename T>
 		std::vector< std::vector<T> > fullyCross (std::vector< std::vector<T> > factors) {
+			CrossedDesign<T> design(std::move(factors));
 
-			unsigned int crossedLevels = 1;
-			for (unsigned int factor = 0; factor < factors.size(); factor++) {
-				crossedLevels *= factors[factor].size();
-			}
-
-			std::vector< std::vector<T> > formatOne(factors.size());
-			unsigned int lback = 1;
-			for (unsigned int factor = 0; factor < factors.size(); factor++) {
-
-				unsigned int lcurrent = factors[factor].size();
-				unsigned int lforward = crossedLevels / (lback * lcurrent);
-
-				for (unsigned int b = 0; b < lback; b++) {
-					for (unsigned int c = 0; c < lcurrent; c++) {
-						for (unsigned int f = 0; f < lforward; f++) {
-							formatOne[factor].push_back(factors[factor][c]);
-						}
-					}
-				}
-
-				lback *= lcurrent;
+			std::vector< std::vector<T> > rval;
+			rval.reserve((size_t)design.size());
+			for (std::vector<T> row : design) {
+				rval.push_back(std::move(row));
 			}
-
-			//Now we have the data, but in wrong format, so transpose it.
-			std::vector< std::vector<T> > rval(crossedLevels);
-			for (unsigned int level = 0; level < crossedLevels; level++) {
-				rval[level].resize( factors.size() );
-				for (unsigned int factor = 0; factor < factors.size(); factor++) {
-					rval[level][factor] = formatOne[factor][level];
-				}
-			}
-
 			return rval;
 		}
 
@@ -404,26 +662,7 @@ namespace CX {
 		*/
 		template <typename T>
 		CX_DataFrame fullyCross(std::map<std::string, std::vector<T>>& factors) {
-	
-			std::vector< std::string > factorNames;
-			std::vector< std::vector<T> > vFactors;
-
-			for (std::pair<std::string, std::vector<T>> f : factors) {
-				factorNames.push_back(f.first);
-				vFactors.push_back(f.second);
-			}
-
-			std::vector< std::vector<T> > crossed = fullyCross(vFactors);
-
-			CX::CX_DataFrame rval;
-
-			for (unsigned int i = 0; i < crossed.size(); i++) {
-				for (unsigned int f = 0; f < crossed.at(i).size(); f++) {
-					rval(i, factorNames.at(f)) = crossed.at(i).at(f);
-				}
-			}
-
-			return rval;
+			return CrossedDesign<T>(factors).toDataFrame();
 		}
 
 
@@ -98,6 +98,8 @@ void CompatGLReadyCallback(bool checkGLSLVersion) {
 CX_AppWindow::CX_AppWindow():ofAppBaseWindow(){
 	ofLogVerbose("CX_AppWindow") << "creating GLFW window";
 	bEnableSetupScreen	= true;
+	bLeanRenderLoop		= false;
+	bNoErrorContext		= false;
 	buttonInUse			= 0;
 	buttonPressed		= false;
     bMultiWindowFullscreen  = false;
@@ -150,6 +152,30 @@ void CX_AppWindow::setMultiDisplayFullscreen(bool bMultiFullscreen){
     bMultiWindowFullscreen = bMultiFullscreen;
 }
 
+//------------------------------------------------------------
+void CX_AppWindow::setNoErrorContext(bool noError){
+	bNoErrorContext = noError;
+}
+
+//------------------------------------------------------------
+bool CX_AppWindow::isNoErrorContext(){
+#ifdef GLFW_CONTEXT_NO_ERROR
+	return windowP != NULL && glfwGetWindowAttrib(windowP, GLFW_CONTEXT_NO_ERROR) == GL_TRUE;
+#else
+	return false;
+#endif
+}
+
+//------------------------------------------------------------
+void CX_AppWindow::setLeanRenderLoop(bool lean){
+	bLeanRenderLoop = lean;
+}
+
+//------------------------------------------------------------
+bool CX_AppWindow::isLeanRenderLoop(){
+	return bLeanRenderLoop;
+}
+
 //------------------------------------------------------------
 void CX_AppWindow::setDoubleBuffering(bool doubleBuff){
 	bDoubleBuffered = doubleBuff;
@@ -264,6 +290,14 @@ void CX_AppWindow::setupOpenGL(int w, int h, int screenMode, std::function<void(
 
 	}
 
+#ifdef GLFW_CONTEXT_NO_ERROR
+	glfwWindowHint(GLFW_CONTEXT_NO_ERROR, bNoErrorContext ? GL_TRUE : GL_FALSE);
+#else
+	if(bNoErrorContext){
+		ofLogWarning("CX_AppWindow") << "A no error context was requested, but this version of GLFW does not support it.";
+	}
+#endif
+
 	if (preOpeningUserFunction != nullptr) {
 		preOpeningUserFunction();
 	}
@@ -384,7 +418,9 @@ void CX_AppWindow::runAppViaInfiniteLoop(ofBaseApp * appPtr){
 
 	ofNotifySetup();
 	while(true){
-		ofNotifyUpdate();
+		if(!bLeanRenderLoop){
+			ofNotifyUpdate();
+		}
 		display();
 	}
 }
@@ -392,6 +428,17 @@ void CX_AppWindow::runAppViaInfiniteLoop(ofBaseApp * appPtr){
 //------------------------------------------------------------
 void CX_AppWindow::display(void){
 
+	if(bLeanRenderLoop){
+		// The user draws directly with CX_Display, so all that is left to do is present and handle input.
+		if(bDoubleBuffered){
+			glfwSwapBuffers(windowP);
+		} else {
+			glFlush();
+		}
+		glfwPollEvents();
+		return;
+	}
+
 	ofPtr<ofGLProgrammableRenderer> renderer = ofGetGLProgrammableRenderer();
 	if(renderer){
 		renderer->startRender();
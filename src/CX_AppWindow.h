@@ -55,6 +55,11 @@ public:
 	bool isWindowResizeable();
 	void iconify(bool bIconify);
 	void setMultiDisplayFullscreen(bool bMultiFullscreen); //note this just enables the mode, you have to toggle fullscreen to activate it.
+	void setNoErrorContext(bool noError); //request a GL_KHR_no_error context. Must be called before setupOpenGL.
+	bool isNoErrorContext();
+
+	void setLeanRenderLoop(bool lean); //lean loop: no update/draw events and no per-frame state setup, just swap and poll.
+	bool isLeanRenderLoop();
 
 
 	// this functions are only meant to be called from inside OF don't call them from your code
@@ -154,6 +159,8 @@ private:
 	int				windowMode;	
 
 	bool			bEnableSetupScreen;
+	bool			bLeanRenderLoop;
+	bool			bNoErrorContext;
 
 	int				requestedWidth;
 	int				requestedHeight;
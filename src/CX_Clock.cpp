@@ -4,10 +4,28 @@
 
 #include "CX_Private.h"
 
+#include <algorithm>
+#include <limits>
+
+#if defined(TARGET_LINUX) || defined(TARGET_OSX)
+#include <time.h>
+#include <errno.h>
+#endif
+
 namespace CX {
 
 CX_Clock CX::Instances::Clock;
 
+CX_Clock::CX_Clock(void) :
+	_tsc(nullptr),
+#ifdef TARGET_WIN32
+	_sleepOvershootNanos(2000000)
+#else
+	_sleepOvershootNanos(1000000)
+#endif
+{
+}
+
 /*! Set up the CX_Clock with the given clock implementation or choose the best available implementation.
 
 Instances of CX_Clock are not constructed in a usable state. This function must be called before using a
@@ -83,7 +101,7 @@ precision on your system. This is unlikely because several clock implementations
 during setup and the best one chosen.
 
 The clock implementations built into CX are `CX_ofMonotonicTimeClock`, 
-`CX_WIN32_PerformanceCounterClock` (Windows only), and `CX_StdClockWrapper`, which wraps
+`CX_WIN32_PerformanceCounterClock` (Windows only), `CX_TSCClock` (x86 processors only), and `CX_StdClockWrapper`, which wraps
 clocks from the `std::chrono` namespace, including `steady_clock`, `high_resolution_clock`, 
 and `system_clock`.
 You can use any clock that implements CX_BaseClockInterface, including implementing your own 
@@ -109,6 +127,10 @@ Clock.setImplementation(implB);
 void CX_Clock::setImplementation(std::shared_ptr<CX_BaseClockInterface> impl) {
 	_impl = impl;
 	_impl->resetStartTime();
+
+#ifdef CX_HAS_TSC_CLOCK
+	_tsc = dynamic_cast<CX_TSCClock*>(_impl.get());
+#endif
 }
 
 std::shared_ptr<CX_BaseClockInterface> CX_Clock::getImplementation(void) const {
@@ -127,17 +149,6 @@ void CX_Clock::resetExperimentStartTime(void) {
 	}
 }
 
-/*! Returns the current time relative to the start of the experiment in milliseconds.
-The start of the experiment is defined by default as when the CX_Clock instance named `CX::Instances::Clock`
-is set up during the beginning of program execution. See also `resetExperimentStartTime()`.
-
-\return A `CX_Millis` object containing the time.
-
-\note This cannot be converted to current date/time in any meaningful way. Use getDateTimeString() for that.*/
-CX_Millis CX_Clock::now(void) const {
-	return CX_Nanos(_impl->nanos());
-}
-
 /*! Sleeps for the requested period of time. This can be somewhat
 imprecise because it requests a specific sleep duration from the operating system,
 but the operating system may not provide the exact sleep time.
@@ -170,6 +181,72 @@ void CX_Clock::delay(CX_Millis t) const {
 }
 
 
+/*! Blocks until `deadline`, sleeping for as much of the wait as possible and spinning for only the last part of it.
+This is about as precise as delay(), but leaves the CPU free for most of the wait.
+
+The operating system is asked to sleep with its highest resolution timer (a high resolution waitable timer on
+Windows, `clock_nanosleep()` on Linux) until a little before the deadline. How long before the deadline to wake up is
+based on how much previous sleeps overslept, which is measured each time this function is called, so it adapts to
+the operating system and the current load. The remaining time is spent in a spinloop. See getSleepOvershoot().
+
+\param deadline The time to wait until, which can be compared to the result of now(). If the deadline has
+already passed, this returns immediately.
+*/
+void CX_Clock::sleepUntil(CX_Millis deadline) const {
+	CX_Millis remaining = deadline - this->now();
+	if (remaining <= CX_Millis(0)) {
+		return;
+	}
+
+	//Wake up early enough that most sleeps finish before the deadline, even when they overslept more than usual.
+	CX_Millis overshoot = CX_Nanos(_sleepOvershootNanos.load(std::memory_order_relaxed));
+	CX_Millis spinTail = overshoot * 1.5 + CX_Millis(0.1);
+
+	CX_Millis sleepDuration = remaining - spinTail;
+	if (sleepDuration > CX_Millis(0)) {
+		CX_Millis sleepStart = this->now();
+		_platformSleep(sleepDuration);
+		CX_Millis overslept = (this->now() - sleepStart) - sleepDuration;
+
+		//Increase the estimate quickly after a long oversleep and decrease it slowly after short ones.
+		int64_t estimate = _sleepOvershootNanos.load(std::memory_order_relaxed);
+		int64_t measured = std::max<int64_t>(overslept.nanos(), 0);
+		if (measured > estimate) {
+			estimate += (measured - estimate) / 2;
+		} else {
+			estimate -= (estimate - measured) / 32;
+		}
+		_sleepOvershootNanos.store(std::max<int64_t>(estimate, 10000), std::memory_order_relaxed);
+	}
+
+	while (this->now() < deadline)
+		;
+}
+
+/*! Returns the current estimate of how much the operating system oversleeps when sleepUntil() asks
+it to sleep. sleepUntil() spins for a little more than this amount of time before each deadline. */
+CX_Millis CX_Clock::getSleepOvershoot(void) const {
+	return CX_Nanos(_sleepOvershootNanos.load(std::memory_order_relaxed));
+}
+
+#ifndef TARGET_WIN32
+void CX_Clock::_platformSleep(CX_Millis duration) {
+#if defined(TARGET_LINUX)
+	//An absolute deadline means that being interrupted by a signal does not extend the sleep.
+	timespec wake;
+	clock_gettime(CLOCK_MONOTONIC, &wake);
+	int64_t wakeNanos = (int64_t)wake.tv_nsec + duration.nanos();
+	wake.tv_sec += wakeNanos / 1000000000LL;
+	wake.tv_nsec = wakeNanos % 1000000000LL;
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, nullptr) == EINTR)
+		;
+#else
+	std::this_thread::sleep_for(std::chrono::nanoseconds(duration.nanos()));
+#endif
+}
+#endif
+
 /*! Get a string representing the date/time of the start of the experiment encoded according to a format.
 \param format See getDateTimeString() for the definition of the format. */
 std::string CX_Clock::getExperimentStartDateTimeString(const std::string& format) const {
@@ -187,13 +264,25 @@ std::string CX_Clock::getDateTimeString(const std::string& format) const {
 	return Poco::DateTimeFormatter::format(localTime, format);
 }
 
+/*! Returns a string containing the local date/time at a time given relative to the start of the experiment,
+such as a time returned by now().
+\param experimentTime The time since the start of the experiment.
+\param format See getDateTimeString(const std::string&) for the definition of the format. */
+std::string CX_Clock::getDateTimeString(CX_Millis experimentTime, const std::string& format) const {
+	Poco::LocalDateTime localTime = *_pocoExperimentStart + Poco::Timespan((Poco::Timespan::TimeDiff)experimentTime.micros());
+	return Poco::DateTimeFormatter::format(localTime, format);
+}
+
 /*! Tests the precision, with `testPrecision()`, of all of the clock implementations that are built-in to CX and chooses the 
 best one on the basis of the following criteria:
 
 1. If `excludeUnstable == true`, clock implementations that are unstable/not monotonic are excluded.
 2. If `excludeWorseThanMs == true`, clock implmentations with precision worse than 1 ms are excluded.
 3. Of the remaining clock implementations, the one with the lowest mean precision for non-zero length
-time intervals.
+time intervals. If two implementations have the same precision, the one that takes less time per call is chosen.
+
+If the processor has a time stamp counter, a CX_TSCClock is included. It is calibrated against the best of the
+other implementations, so if it is chosen, it keeps time with that implementation.
 
 \note This function is used during CX initialization to select the best clock implementation to use
 for the given session. This means that different sessions on the same computer may use different
@@ -284,24 +373,46 @@ std::pair<std::shared_ptr<CX_BaseClockInterface>, CX_Clock::PrecisionTestResults
 	}
 #endif
 
-	// Select best based on 1) monotonicity and 2) mean nonnzero latency
-	TestRes bestImpl;
-	bestImpl.first = nullptr; // Explicitly nullptr unless updated
-	bestImpl.second.withoutZeros.mean = CX_Millis::max();
-
-	for (const auto& res : results) {
-		if (excludeUnstable && !res.second.second.isMonotonic) {
-			continue; // ignore unstable clocks
+	// Select best based on 1) monotonicity, 2) mean nonnzero latency, and 3) cost per call
+	auto selectBest = [&](void) -> TestRes {
+		TestRes bestImpl;
+		bestImpl.first = nullptr; // Explicitly nullptr unless updated
+		bestImpl.second.withoutZeros.mean = CX_Millis::max();
+		bestImpl.second.costPerCall = CX_Millis::max();
+
+		for (const auto& res : results) {
+			if (excludeUnstable && !res.second.second.isMonotonic) {
+				continue; // ignore unstable clocks
+			}
+
+			if (excludeWorseThanMs && res.second.second.precisionWorseThanMs) {
+				continue;
+			}
+
+			const PrecisionTestResults& pr = res.second.second;
+			bool better = pr.withoutZeros.mean < bestImpl.second.withoutZeros.mean;
+			bool tiedButCheaper = pr.withoutZeros.mean == bestImpl.second.withoutZeros.mean && pr.costPerCall < bestImpl.second.costPerCall;
+			if (better || tiedButCheaper) {
+				bestImpl = res.second;
+			}
 		}
+		return bestImpl;
+	};
 
-		if (excludeWorseThanMs && res.second.second.precisionWorseThanMs) {
-			continue;
-		}
+#ifdef CX_HAS_TSC_CLOCK
+	{
+		TestRes reference = selectBest();
 
-		if (res.second.second.withoutZeros.mean < bestImpl.second.withoutZeros.mean) {
-			bestImpl = res.second;
-		}
+		TestRes res;
+
+		res.first = std::make_shared<CX_TSCClock>(reference.first);
+		res.second = CX_Clock::testPrecision(res.first, samples);
+
+		results[res.first->getName()] = res;
 	}
+#endif
+
+	TestRes bestImpl = selectBest();
 
 
 	// Print all results
@@ -323,6 +434,43 @@ std::pair<std::shared_ptr<CX_BaseClockInterface>, CX_Clock::PrecisionTestResults
 	return bestImpl;
 }
 
+/*! Makes one of the built-in clock implementations from its name, as returned by CX_BaseClockInterface::getName().
+This is used to restore the clock implementation that was chosen by chooseBestClockImplementation() in an earlier
+run of the experiment (see CX_InitConfiguation::startupCacheFile) without testing all of the implementations again.
+\param name The name of the implementation.
+\param referenceName Only used if `name` is "CX_TSCClock": The name of the implementation to calibrate the TSC against
+(see CX_TSCClock::getReferenceName()).
+\return The implementation, or `nullptr` if there is no built-in implementation with that name on this system. */
+std::shared_ptr<CX_BaseClockInterface> CX_Clock::makeImplementation(std::string name, std::string referenceName) {
+	std::vector<std::shared_ptr<CX_BaseClockInterface>> candidates;
+	candidates.push_back(std::make_shared<CX_StdClockWrapper<std::chrono::high_resolution_clock>>());
+	candidates.push_back(std::make_shared<CX_StdClockWrapper<std::chrono::system_clock>>());
+	candidates.push_back(std::make_shared<CX_StdClockWrapper<std::chrono::steady_clock>>());
+#ifdef TARGET_WIN32
+	candidates.push_back(std::make_shared<CX_WIN32_PerformanceCounterClock>());
+#endif
+#if OF_VERSION_MAJOR == 0 && OF_VERSION_MINOR == 9 && OF_VERSION_PATCH >= 0
+	candidates.push_back(std::make_shared<CX_ofMonotonicTimeClock>());
+#endif
+
+	for (auto& c : candidates) {
+		if (c->getName() == name) {
+			return c;
+		}
+	}
+
+#ifdef CX_HAS_TSC_CLOCK
+	if (name == "CX_TSCClock") {
+		std::shared_ptr<CX_BaseClockInterface> reference = makeImplementation(referenceName);
+		if (reference != nullptr && reference->getName() != "CX_TSCClock") {
+			return std::make_shared<CX_TSCClock>(reference);
+		}
+	}
+#endif
+
+	return nullptr;
+}
+
 /*! This function tests the precision of the clock implementation used by this instance of CX_Clock.
 The results are computer-specific.
 If the precision of the clock is worse than millisecond accuracy, a warning is logged including
@@ -364,6 +512,8 @@ CX_Clock::PrecisionTestResults CX_Clock::testPrecision(std::shared_ptr<CX_BaseCl
 
 	std::vector<cxTick_t> intervals(samples);
 
+	std::chrono::steady_clock::time_point loopStart = std::chrono::steady_clock::now();
+
 	for (unsigned int i = 0; i < intervals.size(); i++) {
 		//Get two timestamps with as little code in between as possible.
 		cxTick_t t1 = impl->nanos();
@@ -372,8 +522,13 @@ CX_Clock::PrecisionTestResults CX_Clock::testPrecision(std::shared_ptr<CX_BaseCl
 		intervals[i] = t2 - t1;
 	}
 
+	std::chrono::steady_clock::time_point loopEnd = std::chrono::steady_clock::now();
+
 	PrecisionTestResults rval;
 
+	cxTick_t loopNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(loopEnd - loopStart).count();
+	rval.costPerCall = CX_Nanos(samples > 0 ? loopNanos / (2 * (cxTick_t)samples) : 0);
+
 	rval.isMonotonic = impl->isMonotonic();
 	
 	
@@ -430,6 +585,8 @@ CX_Clock::PrecisionTestResults CX_Clock::testPrecision(std::shared_ptr<CX_BaseCl
 	
 	oss << "Clock precision (minimum nonzero step size): " << minNonzero.micros() << " microseconds. ";
 
+	oss << "Cost per call: " << rval.costPerCall.nanos() << " nanoseconds. ";
+
 	if (rval.precisionWorseThanMs) {
 		std::ostringstream wss;
 
@@ -492,10 +649,144 @@ void CX_ofMonotonicTimeClock::resetStartTime(void) {
 #endif
 
 
+#ifdef CX_HAS_TSC_CLOCK
+
+#ifndef _MSC_VER
+#include <cpuid.h>
+#endif
+
+/*! Constructs the clock and calibrates it. See calibrate().
+\param reference The clock implementation to calibrate against. If `nullptr`, a CX_StdClockWrapper around `std::chrono::steady_clock` is used.
+\param calibrationDuration How long to calibrate for. */
+CX_TSCClock::CX_TSCClock(std::shared_ptr<CX_BaseClockInterface> reference, CX_Millis calibrationDuration) :
+	_startTicks(0),
+	_nanosPerTick(1),
+	_invariant(isInvariantTSCAvailable())
+{
+	calibrate(reference, calibrationDuration);
+	resetStartTime();
+}
+
+/*! Finds the rate of the time stamp counter by measuring how many ticks it counts while the reference clock
+counts `calibrationDuration`. This blocks for that long. Longer calibrations give a more accurate rate: with the default of 50 ms,
+the rate is typically accurate to within a few parts per million, so the clock would drift a few milliseconds per hour
+relative to the reference.
+\param reference The clock implementation to calibrate against. If `nullptr`, a CX_StdClockWrapper around `std::chrono::steady_clock` is used.
+\param calibrationDuration How long to calibrate for. */
+void CX_TSCClock::calibrate(std::shared_ptr<CX_BaseClockInterface> reference, CX_Millis calibrationDuration) {
+	if (reference == nullptr) {
+		reference = std::make_shared<CX_StdClockWrapper<std::chrono::steady_clock>>();
+	}
+	_referenceName = reference->getName();
+
+	//Reads the reference clock between two counter reads and uses the read that took the least time,
+	//which is the one that was least likely to have been interrupted.
+	auto sample = [&reference](cxTick_t* referenceNanos) -> uint64_t {
+		uint64_t bestTicks = 0;
+		uint64_t bestSpan = std::numeric_limits<uint64_t>::max();
+		for (int i = 0; i < 10; i++) {
+			uint64_t before = __rdtsc();
+			cxTick_t ref = reference->nanos();
+			uint64_t after = __rdtsc();
+			if (after - before < bestSpan) {
+				bestSpan = after - before;
+				bestTicks = before + (after - before) / 2;
+				*referenceNanos = ref;
+			}
+		}
+		return bestTicks;
+	};
+
+	cxTick_t referenceStart = 0;
+	uint64_t ticksStart = sample(&referenceStart);
+
+	cxTick_t calibrationNanos = std::max<cxTick_t>(calibrationDuration.nanos(), 1000000);
+	while (reference->nanos() - referenceStart < calibrationNanos) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	cxTick_t referenceEnd = 0;
+	uint64_t ticksEnd = sample(&referenceEnd);
+
+	if (ticksEnd > ticksStart && referenceEnd > referenceStart) {
+		_nanosPerTick = (double)(referenceEnd - referenceStart) / (double)(ticksEnd - ticksStart);
+	} else {
+		CX::Instances::Log.error("CX_TSCClock") << "calibrate(): The time stamp counter did not advance during calibration.";
+	}
+}
+
+/*! Returns `true` if the processor reports that it has an invariant time stamp counter, which counts
+at a constant rate regardless of the power state of the processor. */
+bool CX_TSCClock::isInvariantTSCAvailable(void) {
+	unsigned int regs[4] = { 0, 0, 0, 0 };
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0x80000000);
+	if ((unsigned int)info[0] < 0x80000007) {
+		return false;
+	}
+	__cpuid(info, 0x80000007);
+	regs[3] = (unsigned int)info[3];
+#else
+	if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007) {
+		return false;
+	}
+	__get_cpuid(0x80000007, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+	return (regs[3] & (1 << 8)) != 0; //EDX bit 8
+}
+
+#endif //CX_HAS_TSC_CLOCK
+
 #ifdef TARGET_WIN32
 
 #include "Windows.h"
 
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+//Uses a high resolution waitable timer (Windows 10 1803 and later). On older versions of Windows, a regular
+//waitable timer is used and the timer resolution is raised to 1 ms while sleeping.
+void CX_Clock::_platformSleep(CX_Millis duration) {
+	struct ThreadTimer {
+		ThreadTimer(void) : highResolution(true) {
+			handle = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+			if (handle == NULL) {
+				highResolution = false;
+				handle = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+			}
+		}
+		~ThreadTimer(void) {
+			if (handle != NULL) {
+				CloseHandle(handle);
+			}
+		}
+		HANDLE handle;
+		bool highResolution;
+	};
+	static thread_local ThreadTimer timer;
+
+	if (timer.handle == NULL) {
+		std::this_thread::sleep_for(std::chrono::nanoseconds(duration.nanos()));
+		return;
+	}
+
+	if (!timer.highResolution) {
+		timeBeginPeriod(1);
+	}
+
+	LARGE_INTEGER dueTime;
+	dueTime.QuadPart = -(duration.nanos() / 100); //Negative values are relative, in 100 ns units.
+	if (SetWaitableTimer(timer.handle, &dueTime, 0, NULL, NULL, FALSE)) {
+		WaitForSingleObject(timer.handle, INFINITE);
+	}
+
+	if (!timer.highResolution) {
+		timeEndPeriod(1);
+	}
+}
+
 CX_WIN32_PerformanceCounterClock::CX_WIN32_PerformanceCounterClock(void) {
 	_resetFrequency();
 	resetStartTime();
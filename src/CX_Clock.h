@@ -8,6 +8,7 @@
 #include <thread>
 #include <type_traits>
 #include <memory>
+#include <atomic>
 
 #include "Poco/DateTimeFormatter.h"
 
@@ -17,6 +18,15 @@
 #include "CX_Logger.h"
 #include "CX_Time_t.h"
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#	define CX_HAS_TSC_CLOCK
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#	else
+#		include <x86intrin.h>
+#	endif
+#endif
+
 /*! \defgroup timing Timing
 This module provides methods for timestamping events in experiments.
 */
@@ -24,6 +34,7 @@ This module provides methods for timestamping events in experiments.
 namespace CX {
 
 	class CX_BaseClockInterface;
+	class CX_TSCClock;
 
 	/*! This class is responsible for getting timestamps for anything requiring timestamps. The way to
 	get timing information is the function now(). It returns the current time relative to the start
@@ -35,16 +46,21 @@ namespace CX {
 	class CX_Clock {
 	public:
 
+		CX_Clock(void);
+
 		bool setup(std::shared_ptr<CX_BaseClockInterface> impl, bool resetStartTime = true, unsigned int samples = 100000);
 
 		CX_Millis now(void) const;
 
 		void sleep(CX_Millis t) const;
 		void delay(CX_Millis t) const;
+		void sleepUntil(CX_Millis deadline) const;
+		CX_Millis getSleepOvershoot(void) const;
 
 		void resetExperimentStartTime(void);
 
 		std::string getDateTimeString(const std::string& format = "%Y-%b-%e %h-%M-%S %a") const;
+		std::string getDateTimeString(CX_Millis experimentTime, const std::string& format = "%Y-%b-%e %h-%M-%S %a") const;
 		std::string getExperimentStartDateTimeString(const std::string& format = "%Y-%b-%e %h-%M-%S %a") const;
 
 		void setImplementation(std::shared_ptr<CX_BaseClockInterface> impl);
@@ -59,6 +75,8 @@ namespace CX {
 
 			std::vector<double> percentiles; //<! The percentiles that were used to get the quantiles.
 
+			CX_Millis costPerCall; //!< The average time taken by one call to `nanos()` of the clock implementation.
+
 			struct {
 				CX_Millis mean; //!< The mean intervals.
 				std::vector<CX_Millis> quantiles; //<! Quantiles of the intervals, based on the `percentiles`.
@@ -75,10 +93,17 @@ namespace CX {
 		static std::pair<std::shared_ptr<CX_BaseClockInterface>, PrecisionTestResults> 
 			chooseBestClockImplementation(unsigned int iterationsPerClock, bool excludeUnstable = true, bool excludeWorseThanMs = true, bool log = true);
 
+		static std::shared_ptr<CX_BaseClockInterface> makeImplementation(std::string name, std::string referenceName = "");
+
 	private:
 		std::unique_ptr<Poco::LocalDateTime> _pocoExperimentStart;
 
 		std::shared_ptr<CX_BaseClockInterface> _impl;
+		CX_TSCClock* _tsc; //Points to _impl if it is a CX_TSCClock, so that now() can call it without a virtual call.
+
+		//The estimated amount by which an OS sleep oversleeps, in nanoseconds. Updated by sleepUntil().
+		mutable std::atomic<int64_t> _sleepOvershootNanos;
+		static void _platformSleep(CX_Millis duration);
 	};
 
 	namespace Instances {
@@ -145,6 +170,65 @@ namespace CX {
 		typename stdClock::time_point _startTime;
 	};
 
+#ifdef CX_HAS_TSC_CLOCK
+	/*! This clock implementation reads the time stamp counter (TSC) of the processor, which is much faster
+	than asking the operating system for the time. The rate of the counter is found by calibrating it against
+	another clock implementation.
+
+	The clock is only monotonic if the processor has an invariant TSC, which counts at a constant rate
+	regardless of power states and is synchronized between cores. Most x86 processors made since about 2008 do.
+	See isInvariantTSCAvailable().
+
+	When CX_Clock uses this implementation, CX_Clock::now() reads the counter directly rather than through
+	a virtual function call.
+
+	\code{.cpp}
+	auto tsc = std::make_shared<CX_TSCClock>(std::make_shared<CX_StdClockWrapper<std::chrono::steady_clock>>());
+	Clock.setImplementation(tsc);
+	\endcode
+	\ingroup timing */
+	class CX_TSCClock final : public CX_BaseClockInterface {
+	public:
+		CX_TSCClock(std::shared_ptr<CX_BaseClockInterface> reference = nullptr, CX_Millis calibrationDuration = 50);
+
+		void calibrate(std::shared_ptr<CX_BaseClockInterface> reference, CX_Millis calibrationDuration = 50);
+
+		/*! Returns the current time in nanoseconds. */
+		cxTick_t nanos(void) const override {
+			return (cxTick_t)((double)(int64_t)(__rdtsc() - _startTicks) * _nanosPerTick);
+		}
+
+		void resetStartTime(void) override {
+			_startTicks = __rdtsc();
+		}
+
+		std::string getName(void) const override {
+			return "CX_TSCClock";
+		}
+
+		bool isMonotonic(void) const override {
+			return _invariant;
+		}
+
+		/*! Returns the calibrated rate of the counter in ticks per second. */
+		double getTicksPerSecond(void) const {
+			return 1e9 / _nanosPerTick;
+		}
+
+		/*! Returns the name of the clock implementation that this clock was calibrated against. */
+		std::string getReferenceName(void) const {
+			return _referenceName;
+		}
+
+		static bool isInvariantTSCAvailable(void);
+
+	private:
+		uint64_t _startTicks;
+		double _nanosPerTick;
+		bool _invariant;
+		std::string _referenceName;
+	};
+#endif
 
 #if OF_VERSION_MAJOR == 0 && OF_VERSION_MINOR == 9 && OF_VERSION_PATCH >= 0
 	/* This clock implementation uses ofGetMonotonicTime() (in ofUtils.cpp).
@@ -202,4 +286,20 @@ namespace CX {
 
 #endif
 
+	/*! Returns the current time relative to the start of the experiment in milliseconds.
+	The start of the experiment is defined by default as when the CX_Clock instance named `CX::Instances::Clock`
+	is set up during the beginning of program execution. See also `resetExperimentStartTime()`.
+
+	\return A `CX_Millis` object containing the time.
+
+	\note This cannot be converted to current date/time in any meaningful way. Use getDateTimeString() for that.*/
+	inline CX_Millis CX_Clock::now(void) const {
+#ifdef CX_HAS_TSC_CLOCK
+		if (_tsc != nullptr) {
+			return CX_Nanos(_tsc->nanos());
+		}
+#endif
+		return CX_Nanos(_impl->nanos());
+	}
+
 }
@@ -1,9 +1,21 @@
 #include "CX_DataFrame.h"
 
 #include "CX_RandomNumberGenerator.h"
+#include "CX_DataFrameParser.h"
+#include "CX_DataFrameBinary.h"
+#include "CX_DataFrameGroups.h"
+#include "CX_MappedFile.h"
+
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <thread>
 
 namespace CX {
 
+static const char binaryMagic[8] = { 'C', 'X', 'D', 'F', 'B', 'I', 'N', '\0' };
+static const uint32_t binaryVersion = 1;
+
 CX_DataFrame::CX_DataFrame(void) :
 	_rowCount(0)
 {}
@@ -37,6 +49,7 @@ CX_DataFrame& CX_DataFrame::operator=(CX_DataFrame&& df) {
 	this->_rowCount = df._rowCount;
 	this->_data = std::move(df._data);
 	this->_orderToName = std::move(df._orderToName);
+	this->_trackedBytes = std::move(df._trackedBytes);
 
 	return *this;
 }
@@ -48,13 +61,14 @@ the data frame will be resized in order to fit the new row(s) and/or column.
 \param column The column name.
 \return A CX_DataFrameCell that can be read from or written to.
 */
-CX_DataFrameCell CX_DataFrame::operator() (std::string column, rowIndex_t row) {
-	_resizeToFit(column, row);
-	return _data.at(column).at(row);
+CX_DataFrameCell CX_DataFrame::operator() (const std::string& column, rowIndex_t row) {
+	ColumnPtr& store = _findOrAddColumn(column);
+	_resizeToFit(row);
+	return CX_DataFrameCell(store, row);
 }
 
-/*! \brief Equivalent to CX_DataFrame::operator()(std::string, rowIndex_t). */
-CX_DataFrameCell CX_DataFrame::operator() (rowIndex_t row, std::string column) {
+/*! \brief Equivalent to CX_DataFrame::operator()(const std::string&, rowIndex_t). */
+CX_DataFrameCell CX_DataFrame::operator() (rowIndex_t row, const std::string& column) {
 	return this->operator()(column, row);
 }
 
@@ -64,16 +78,16 @@ exception and logs an error if either the row or column is out of bounds.
 \param column The column name.
 \return A CX_DataFrameCell that can be read from or written to.
 */
-CX_DataFrameCell CX_DataFrame::at(rowIndex_t row, std::string column) {
+CX_DataFrameCell CX_DataFrame::at(rowIndex_t row, const std::string& column) {
 	return at(column, row);
 }
 
-/*! Equivalent to `CX::CX_DataFrame::at(rowIndex_t, std::string)`. */
-CX_DataFrameCell CX_DataFrame::at(std::string column, rowIndex_t row) {
-	try {
-		return _data.at(column).at(row);
-	} catch (...) {
-		//This just assumes that an exception here is out of bounds access...
+/*! Equivalent to `CX::CX_DataFrame::at(rowIndex_t, const std::string&)`. */
+CX_DataFrameCell CX_DataFrame::at(const std::string& column, rowIndex_t row) {
+	auto it = _data.find(column);
+	if (it != _data.end() && row < _rowCount) {
+		return CX_DataFrameCell(it->second, row);
+	} else {
 		std::stringstream s;
 		s << "CX_DataFrame: Out of bounds access at(" << column << ", " << row << ")";
 		Instances::Log.error("CX_DataFrame") << s.str();
@@ -162,94 +176,165 @@ std::string CX_DataFrame::print(const std::vector<std::string>& columns, const s
 \param oOpt Output formatting options. 
 \return A string containing a formatted representation of the data frame contents. */
 std::string CX_DataFrame::print(OutputOptions oOpt) const {
+	std::string output;
+	_print(oOpt, [&output](const std::string& text) {
+		output.append(text);
+	});
+	return output;
+}
 
+//Gets the columns of `available` that are in `requested`, in the order of `available`, or all of `available` if `requested`
+//is empty. Requested columns that are not available are logged. This is shared by print() and CX_DataFrameWriter.
+std::vector<std::string> CX_DataFrame::_selectColumnsToPrint(const std::vector<std::string>& requested, const std::vector<std::string>& available) {
 	// If no columns are to be printed, print all columns
-	if (oOpt.columnsToPrint.empty()) {
-		oOpt.columnsToPrint = getColumnNames();
+	if (requested.empty()) {
+		return available;
 	}
 
 	//Get rid of invalid columns
-	std::vector<std::string> validColumns = Util::intersectionV(oOpt.columnsToPrint, getColumnNames());
-	validColumns = Util::reorder(validColumns, getColumnNames(), false);
+	std::vector<std::string> validColumns = Util::intersectionV(requested, available);
+	validColumns = Util::reorder(validColumns, available, false);
 
-	if (validColumns.size() < oOpt.columnsToPrint.size()) {
-		std::vector<std::string> invalidColumns = Util::exclude(oOpt.columnsToPrint, validColumns);
+	if (validColumns.size() < requested.size()) {
+		std::vector<std::string> invalidColumns = Util::exclude(requested, validColumns);
 		CX::Instances::Log.warning("CX_DataFrame") << "The following column names were requested for printing but were not found in the data frame: " << 
 			Util::vectorToString(invalidColumns, ", ");
 	}
-	
+
+	return validColumns;
+}
+
+//Formats the data frame in chunks of rows, each of which is passed to `write` in order. The rows of a chunk are formatted
+//in parallel into one buffer per thread, which is reused for each chunk so that memory use does not grow with the data frame.
+//If formatting throws on any thread, the exception is rethrown on the calling thread once the threads of that round have been joined.
+void CX_DataFrame::_print(OutputOptions oOpt, const std::function<void(const std::string&)>& write) const {
+
+	std::vector<std::string> validColumns = _selectColumnsToPrint(oOpt.columnsToPrint, getColumnNames());
+
 
 	//No rows to print is not an error: Just the column headers are printed.
-	if (oOpt.rowsToPrint.empty() && this->getRowCount() > 0) {
-		oOpt.rowsToPrint = Util::intVector<rowIndex_t>(0, this->getRowCount() - 1);
+	std::vector<rowIndex_t> rows;
+	if (oOpt.rowsToPrint.empty()) {
+		rows.resize(_rowCount);
+		for (rowIndex_t i = 0; i < _rowCount; i++) {
+			rows[i] = i;
+		}
+	} else {
+		//Skip invalid row numbers
+		rows.reserve(oOpt.rowsToPrint.size());
+		for (rowIndex_t row : oOpt.rowsToPrint) {
+			if (row >= _rowCount) {
+				Instances::Log.warning("CX_DataFrame") << "Invalid row index requested for printing: " << row;
+				continue;
+			}
+			rows.push_back(row);
+		}
 	}
 
-	std::ostringstream output;
-
 	//Output the headers
+	std::string header;
 	if (oOpt.printRowNumbers) {
-		output << "rowNumber" << oOpt.cellDelimiter;
+		header.append("rowNumber").append(oOpt.cellDelimiter);
 	}
 
 	for (unsigned int j = 0; j < validColumns.size(); j++) {
 		if (j > 0) {
-			output << oOpt.cellDelimiter;
+			header.append(oOpt.cellDelimiter);
 		}
-		output << validColumns[j];
+		header.append(validColumns[j]);
 	}
+	write(header);
 
-	//Output the rows of data
-	for (rowIndex_t i = 0; i < oOpt.rowsToPrint.size(); i++) {
-		//Skip invalid row numbers
-		if (oOpt.rowsToPrint[i] >= _rowCount) {
-			Instances::Log.warning("CX_DataFrame") << "Invalid row index requested for printing: " << oOpt.rowsToPrint[i];
-			continue;
-		}
+	std::vector<const Private::CX_DataFrameColumnStore*> stores;
+	for (const std::string& column : validColumns) {
+		stores.push_back(_data.find(column)->second.get());
+	}
 
-		output << std::endl; // Headers on first line
-		if (oOpt.printRowNumbers) {
-			output << oOpt.rowsToPrint[i] << oOpt.cellDelimiter;
+	//Each row starts with a new line, which ends the line before it (headers on first line).
+	auto formatRows = [&](size_t begin, size_t end, std::string* out) {
+		for (size_t i = begin; i < end; i++) {
+			out->push_back('\n');
+			if (oOpt.printRowNumbers) {
+				out->append(std::to_string(rows[i])).append(oOpt.cellDelimiter);
+			}
+
+			for (unsigned int j = 0; j < stores.size(); j++) {
+				if (j > 0) {
+					out->append(oOpt.cellDelimiter);
+				}
+				stores[j]->appendText(rows[i], oOpt.vectorEncloser, oOpt.vectorElementDelimiter, out);
+			}
 		}
+	};
 
-		for (unsigned int j = 0; j < validColumns.size(); j++) {
-			if (j > 0) {
-				output << oOpt.cellDelimiter;
+	//An exception must not escape a thread, so the first one is kept and rethrown after the threads are joined.
+	std::mutex errorMutex;
+	std::exception_ptr error;
+	auto formatChunk = [&](size_t begin, size_t end, std::string* out) {
+		try {
+			formatRows(begin, end, out);
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(errorMutex);
+			if (!error) {
+				error = std::current_exception();
 			}
+		}
+	};
 
-			std::map<std::string, std::vector<CX_DataFrameCell> >::const_iterator it = _data.find(validColumns[j]);
+	const size_t minimumCellsPerChunk = 65536;
+	const size_t rowsPerChunk = std::max<size_t>(minimumCellsPerChunk / std::max<size_t>(stores.size(), 1), 1);
 
-			//TODO: Update this to be more sensible/allow configuration.
-			const CX_DataFrameCell& cellRef = it->second[oOpt.rowsToPrint[i]];
-			if (cellRef.isVector()) {
-				output << oOpt.vectorEncloser;
-				output << Util::vectorToString(cellRef.toVector<std::string>(false), oOpt.vectorElementDelimiter);
-				output << oOpt.vectorEncloser;
-			} else {
-				output << cellRef.to<std::string>(false);
-			}
+	unsigned int threadCount = oOpt.threadCount;
+	if (threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	threadCount = (unsigned int)std::max<size_t>(std::min<size_t>(threadCount, rows.size() / rowsPerChunk), 1);
+
+	std::vector<std::string> buffers(threadCount);
+	std::vector<std::thread> threads;
+
+	for (size_t roundStart = 0; roundStart < rows.size(); roundStart += rowsPerChunk * threadCount) {
+		size_t roundEnd = std::min(roundStart + rowsPerChunk * threadCount, rows.size());
+
+		//The calling thread formats the first chunk of each round.
+		for (unsigned int t = 1; t < threadCount; t++) {
+			size_t begin = std::min(roundStart + t * rowsPerChunk, roundEnd);
+			size_t end = std::min(begin + rowsPerChunk, roundEnd);
+			threads.push_back(std::thread(formatChunk, begin, end, &buffers[t]));
+		}
+		formatChunk(roundStart, std::min(roundStart + rowsPerChunk, roundEnd), &buffers[0]);
+
+		for (std::thread& t : threads) {
+			t.join();
+		}
+		threads.clear();
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+
+		for (std::string& buffer : buffers) {
+			write(buffer);
+			buffer.clear(); //Keeps its capacity for the next round.
 		}
 	}
-	output << std::endl;
 
-	return output.str();
+	write("\n");
 }
 
 /*! \brief Reduced argument version of printToFile(). Prints all rows and columns. */
 bool CX_DataFrame::printToFile(std::string filename, std::string delimiter, bool printRowNumbers) const {
-	std::string dfStr = this->print(delimiter, printRowNumbers);
-	return CX::Util::writeToFile(filename, dfStr, false);
+	return printToFile(filename, std::vector<std::string>(), std::vector<rowIndex_t>(), delimiter, printRowNumbers);
 }
 
 /*! \brief Reduced argument version of printToFile(). Prints all rows and the selected columns. */
 bool CX_DataFrame::printToFile(std::string filename, const std::vector<std::string>& columns, std::string delimiter, bool printRowNumbers) const {
-	std::string dfStr = this->print(columns, delimiter, printRowNumbers);
-	return CX::Util::writeToFile(filename, dfStr, false);
+	return printToFile(filename, columns, std::vector<rowIndex_t>(), delimiter, printRowNumbers);
 }
 
 /*! \brief Reduced argument version of printToFile(). Prints all columns and the selected rows. */
 bool CX_DataFrame::printToFile(std::string filename, const std::vector<rowIndex_t>& rows, std::string delimiter, bool printRowNumbers) const {
-	std::string dfStr = this->print(rows, delimiter, printRowNumbers);
-	return CX::Util::writeToFile(filename, dfStr, false);
+	return printToFile(filename, std::vector<std::string>(), rows, delimiter, printRowNumbers);
 }
 
 /*! This function is equivalent in behavior to CX::CX_DataFrame::print() except that instead of returning a string containing the
@@ -271,8 +356,12 @@ being the selected row indices. If false, no row numbers will be printed.
 bool CX_DataFrame::printToFile(std::string filename, const std::vector<std::string>& columns, const std::vector<rowIndex_t>& rows,
 							   std::string delimiter, bool printRowNumbers) const
 {
-	std::string dfStr = this->print(columns, rows, delimiter, printRowNumbers);
-	return CX::Util::writeToFile(filename, dfStr, false);
+	OutputOptions oOpt;
+	oOpt.cellDelimiter = delimiter;
+	oOpt.printRowNumbers = printRowNumbers;
+	oOpt.columnsToPrint = columns;
+	oOpt.rowsToPrint = rows;
+	return printToFile(filename, oOpt);
 }
 
 /*! This function is equivalent in behavior to CX::CX_DataFrame::print() except that instead of returning a string containing the
@@ -283,7 +372,24 @@ All paramters shared with print() are simply passed along to print(), so they ha
 \param oOpt The output options.
 \return `true` for success, `false` if there was some problem writing to the file (insufficient permissions, etc.) */
 bool CX_DataFrame::printToFile(std::string filename, OutputOptions oOpt) const {
-	return CX::Util::writeToFile(filename, this->print(oOpt), false);
+	//Chunks are written as they are formatted, rather than formatting the whole data frame into one string first.
+	filename = ofToDataPath(filename);
+	ofFile out(filename, ofFile::WriteOnly, false);
+	if (!out.is_open()) {
+		CX::Instances::Log.error("CX_DataFrame") << "printToFile(): File \"" << filename << "\" could not be opened.";
+		return false;
+	}
+
+	_print(oOpt, [&out](const std::string& text) {
+		out.write(text.data(), text.size());
+	});
+
+	bool success = out.good();
+	out.close();
+	if (!success) {
+		CX::Instances::Log.error("CX_DataFrame") << "printToFile(): There was an error writing to file \"" << filename << "\".";
+	}
+	return success;
 }
 
 /*! Deletes the contents of the data frame. Resizes the data frame to have no rows and no columns. */
@@ -291,6 +397,7 @@ void CX_DataFrame::clear (void) {
 	_data.clear();
 	_rowCount = 0;
 	_orderToName.clear();
+	_updateMemoryUse();
 }
 
 /*! Reads data from the given file into the data frame. This function assumes that there will be a row of column names as the first row of the file.
@@ -320,6 +427,9 @@ bool CX_DataFrame::readFromFile(std::string filename, std::string cellDelimiter,
 
 /*! Equivalent to a call to readFromFile(string, string, string, string), except that the last three arguments are
 taken from `iOpt`.
+
+The file is mapped into memory and parsed in a single pass. Large files can be parsed by several threads at once
+by setting `iOpt.threadCount`.
 \param filename The name of the file to read data from. If it is a relative path, the file will be read relative to the data directory.
 \param iOpt Input options, such as the delimiter between cells in the input file.
 */
@@ -333,9 +443,13 @@ bool CX_DataFrame::readFromFile(std::string filename, InputOptions iOpt) {
 
 	this->clear();
 
-	ofBuffer fileBuf = ofBufferFromFile(filename, false);
+	Private::CX_MappedFile file;
+	if (!file.open(filename)) {
+		Instances::Log.error("CX_DataFrame") << "Attempt to read from file " << filename << " failed: The file could not be opened.";
+		return false;
+	}
 
-	bool loadSuccess = this->_readFromString(fileBuf.getText(), iOpt, "readFromFile(): ", filename);
+	bool loadSuccess = this->_readFromBuffer(file.data(), file.size(), iOpt, "readFromFile(): ", filename);
 
 	if (loadSuccess) {
 		Instances::Log.notice("CX_DataFrame") << "readFromFile(): File " << filename << " loaded successfully.";
@@ -343,111 +457,188 @@ bool CX_DataFrame::readFromFile(std::string filename, InputOptions iOpt) {
 	return loadSuccess;
 }
 
-bool CX_DataFrame::_readFromString(const std::string& dfStr, const CX_DataFrame::InputOptions& opt, std::string callingFunction, std::string filename) {
+bool CX_DataFrame::_readFromBuffer(const char* data, size_t size, const CX_DataFrame::InputOptions& opt, std::string callingFunction, std::string filename) {
 
-	std::ostringstream endlOss;
-	endlOss << std::endl;
-	std::vector<std::string> lines = ofSplitString(dfStr, endlOss.str(), false, false);
-
-	std::vector<std::string> headers = ofSplitString(lines.front(), opt.cellDelimiter, true, true);
-
-	rowIndex_t rowNumber = 0;
+	if (opt.cellDelimiter.empty()) {
+		Instances::Log.error("CX_DataFrame") << callingFunction << "Error while loading " << filename << ": The cell delimiter was empty.";
+		return false;
+	}
 
-	for (unsigned int lineIndex = 1; lineIndex < lines.size(); lineIndex++) {
+	Private::CX_DataFrameParser parser(opt.cellDelimiter, opt.vectorEncloser, opt.vectorElementDelimiter);
+	bool parsed = parser.parse(data, size, opt.threadCount);
 
-		const std::string& line = lines[lineIndex];
+	for (size_t line : parser.getBlankLines()) {
+		Instances::Log.warning("CX_DataFrame") << callingFunction << "Blank line skipped on line " << line << ".";
+	}
 
-		if (line == "") {
-			Instances::Log.warning("CX_DataFrame") << callingFunction << "Blank line skipped on line " << (lineIndex + 1) << ".";
-			continue;
-		}
+	if (!parsed) {
+		Instances::Log.error("CX_DataFrame") << callingFunction << "Error while loading " << filename <<
+			": The number of columns (" << parser.getErrorCellCount() << ") on line " << parser.getErrorLine() <<
+			" does not match the number of headers (" << parser.getHeaders().size() << ").";
 
-		std::vector<std::vector<std::string>> cells = CX_DataFrame::_fileLineToVectors(line, opt);
+		this->clear();
+		return false;
+	}
 
-		if (cells.size() != headers.size()) {
-			Instances::Log.error("CX_DataFrame") << callingFunction << "Error while loading " << filename <<
-				": The number of columns (" << cells.size() << ") on line " << (lineIndex + 1) << 
-				" does not match the number of headers (" << headers.size() << ").";
+	rowIndex_t rowCount = parser.getRowCount();
+	if (rowCount == 0) {
+		return true;
+	}
 
-			this->clear();
-			return false;
-		}
+	const std::vector<std::string>& headers = parser.getHeaders();
+	std::vector<Private::CX_DataFrameColumnStore>& columns = parser.getColumns();
 
-		for (unsigned int i = 0; i < cells.size(); i++) {
-			this->operator()(rowNumber, headers[i]).storeVector(cells[i]);
-			this->operator()(rowNumber, headers[i]).deleteStoredType();
+	for (size_t i = 0; i < headers.size(); i++) {
+		if (!columnExists(headers[i])) {
+			_tryAddColumn(headers[i], false);
+			_data.at(headers[i]) = std::make_shared<Private::CX_DataFrameColumnStore>(std::move(columns[i]));
+		} else {
+			//Data can be read into a data frame that already has data in it (or a column can be named twice).
+			_resizeToFit(headers[i], rowCount - 1);
+			for (rowIndex_t row = 0; row < rowCount; row++) {
+				_data.at(headers[i])->copyRowFrom(columns[i], row, row);
+			}
 		}
-
-		rowNumber++;
 	}
 
+	_equalizeRowLengths();
+
 	return true;
 }
 
-std::vector< std::vector<std::string> > CX_DataFrame::_fileLineToVectors(std::string line, const CX_DataFrame::InputOptions& opt) {
-
-	std::vector<std::vector<std::string>> lineParts;
+/*! Writes the data frame to a file in a binary format that can be read back in with readBinary(). Unlike printToFile(), the
+values are not converted to text, so writing and reading are much faster and no precision is lost for floating point values.
+The type information for each cell is kept as well. The format is not meant to be read by other software.
+
+The file is column-major and little-endian, with all sizes and offsets given as unsigned integers. It starts with a header:
+1. 8 bytes: "CXDFBIN" followed by a zero byte.
+2. 32 bits: The format version, currently 1.
+3. 32 bits: Reserved (0).
+4. 64 bits each: The number of rows, the number of columns, and the offset from the start of the file to the data section.
+
+For each column, the header then has the name of the column (strings are a 32-bit length followed by that many characters),
+the kind of storage used for the column (as one byte with the value of `Private::CX_DataFrameColumnStore::Kind`: 0 empty,
+1 int64, 2 uint64, 3 double, 4 bool, 5 string, 6 generic), a byte that is 1 if the column holds vectors, a byte that is 1 if the type
+of the column is ignored, a padding byte, the type name of the column, and the 64-bit offset (from the start of the data section) and
+size of the data for the column.
+
+The data for each column starts on an 8-byte boundary. For columns that do not hold vectors, there is one byte per row that is 1 if
+the row has a value, followed (after padding to 8 bytes) by one value per row. For columns that hold vectors, there are `rows + 1`
+64-bit offsets giving the range of elements for each row, followed by the elements. Values are 64-bit integers, IEEE doubles, or
+one byte per bool. Strings are an array of 64-bit lengths followed by the characters of all of the strings. Generic columns,
+which hold each cell as strings along with its own type, have for each row the type name, a byte that is 1 if the type is ignored,
+a 64-bit count of elements, and that many strings.
+
+\param filename The name of the file to write to. If it is a relative path, the file will be written relative to the data directory.
+\return `false` if the file could not be written, `true` otherwise.
+*/
+bool CX_DataFrame::writeBinary(std::string filename) const {
+	filename = ofToDataPath(filename);
 
-	if (line == "") {
-		return lineParts;
+	Private::CX_BinaryWriter schema;
+	Private::CX_BinaryWriter data;
+	for (const std::string& name : _orderToName) {
+		schema.putString(name);
+		_data.at(name)->writeBinary(schema, data);
 	}
 
-	std::string nextPart = "";
-	bool nextVector = false;
+	Private::CX_BinaryWriter header;
+	header.putBytes(binaryMagic, sizeof(binaryMagic));
+	header.putU32(binaryVersion);
+	header.putU32(0);
+	header.putU64(_rowCount);
+	header.putU64(_orderToName.size());
+
+	size_t dataStart = header.size() + sizeof(uint64_t) + schema.size();
+	dataStart += (8 - dataStart % 8) % 8;
+	header.putU64(dataStart);
+	header.putBytes(schema.buffer().data(), schema.size());
+	header.align(8);
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		Instances::Log.error("CX_DataFrame") << "writeBinary(): File " << filename << " could not be opened.";
+		return false;
+	}
 
-	bool inEncloser = false;
+	file.write(header.buffer().data(), header.size());
+	file.write(data.buffer().data(), data.size());
+	file.close();
 
-	auto storeNextPart = [&]() {
-		std::vector<std::string> parts;
-		if (nextVector) {
-			parts = ofSplitString(nextPart, opt.vectorElementDelimiter, true, true); // ignore empty and do trim
-		} else {
-			parts.push_back(nextPart);
-		}
-		lineParts.push_back(parts);
-		nextPart = "";
-		nextVector = false;
-	};
+	if (file.fail()) {
+		Instances::Log.error("CX_DataFrame") << "writeBinary(): Writing to file " << filename << " failed.";
+		return false;
+	}
+	return true;
+}
 
-	auto isSymbolAtPosition = [](const std::string& line, size_t pos, const std::string& sym) -> bool {
-		return sym == line.substr(pos, sym.size());
-	};
+/*! Reads a file written by writeBinary() into the data frame. The file is mapped into memory and the data for each
+column is copied directly into the column.
+\param filename The name of the file to read data from. If it is a relative path, the file will be read relative to the data directory.
+\return `false` if an error occurred, `true` otherwise.
+\note The contents of the data frame will be deleted before attempting to read in the file.
+*/
+bool CX_DataFrame::readBinary(std::string filename) {
+	filename = ofToDataPath(filename);
 
+	if (!ofFile::doesFileExist(filename)) {
+		Instances::Log.error("CX_DataFrame") << "readBinary(): Attempt to read from file " << filename << " failed: File not found.";
+		return false;
+	}
 
-	for (unsigned int i = 0; i < line.size(); i++) {
+	this->clear();
 
-		if (isSymbolAtPosition(line, i, opt.cellDelimiter)) {
+	Private::CX_MappedFile file;
+	if (!file.open(filename)) {
+		Instances::Log.error("CX_DataFrame") << "readBinary(): Attempt to read from file " << filename << " failed: The file could not be opened.";
+		return false;
+	}
 
-			if (!inEncloser) {
-				storeNextPart();
+	Private::CX_BinaryReader header(file.data(), file.size());
+	const char* magic = header.getBytes(sizeof(binaryMagic));
+	if (magic == nullptr || std::memcmp(magic, binaryMagic, sizeof(binaryMagic)) != 0) {
+		Instances::Log.error("CX_DataFrame") << "readBinary(): File " << filename << " is not a binary data frame file.";
+		return false;
+	}
 
-				i += (opt.cellDelimiter.size() - 1);
-				continue;
-			}
+	uint32_t version = header.getU32();
+	if (version > binaryVersion) {
+		Instances::Log.error("CX_DataFrame") << "readBinary(): File " << filename << " has format version " << version <<
+			", which is newer than the supported version (" << binaryVersion << ").";
+		return false;
+	}
+	header.getU32();
 
-		} else if (isSymbolAtPosition(line, i, opt.vectorEncloser)) {
+	uint64_t rowCount = header.getU64();
+	uint64_t columnCount = header.getU64();
+	uint64_t dataStart = header.getU64();
 
-			if (!inEncloser) {
-				nextVector = true;
-			}
+	if (header.failed() || dataStart > file.size()) {
+		Instances::Log.error("CX_DataFrame") << "readBinary(): File " << filename << " is truncated or corrupt.";
+		return false;
+	}
 
-			inEncloser = !inEncloser;
+	Private::CX_BinaryReader data(file.data() + dataStart, file.size() - (size_t)dataStart);
 
-			i += (opt.vectorEncloser.size() - 1);
-			continue;
+	for (uint64_t i = 0; i < columnCount; i++) {
+		std::string name = header.getString();
 
+		ColumnPtr column = std::make_shared<Private::CX_DataFrameColumnStore>();
+		if (header.failed() || columnExists(name) || !column->readBinary(header, data, (size_t)rowCount)) {
+			Instances::Log.error("CX_DataFrame") << "readBinary(): File " << filename << " is truncated or corrupt.";
+			this->clear();
+			return false;
 		}
 
-		nextPart += line[i];
+		_tryAddColumn(name, false);
+		_data.at(name) = column;
 	}
 
-	if (inEncloser) {
-		//warning: EOL reached in encloser.
-	}
+	_rowCount = (rowIndex_t)rowCount;
+	_updateMemoryUse();
 
-	storeNextPart();
-
-	return lineParts;
+	Instances::Log.notice("CX_DataFrame") << "readBinary(): File " << filename << " loaded successfully.";
+	return true;
 }
 
 /*! Deletes the given column of the data frame.
@@ -465,7 +656,8 @@ bool CX_DataFrame::deleteColumn(std::string columnName) {
 
 	std::vector<std::string>::iterator orderIt = std::find(_orderToName.begin(), _orderToName.end(), columnName);
 	_orderToName.erase(orderIt);
-	
+
+	_updateMemoryUse();
 	return true;
 }
 
@@ -479,8 +671,8 @@ bool CX_DataFrame::deleteRow(rowIndex_t row) {
 		return false;
 	}
 
-	for (std::map<std::string, std::vector<CX_DataFrameCell>>::iterator col = _data.begin(); col != _data.end(); col++) {
-		col->second.erase(col->second.begin() + row);
+	for (auto col = _data.begin(); col != _data.end(); col++) {
+		col->second->eraseRow(row);
 	}
 	_rowCount--;
 	return true;
@@ -498,9 +690,10 @@ void CX_DataFrame::appendRow(CX_DataFrameRow row) {
 	for (const std::string& name : row.names()) {
 
 		_tryAddColumn(name, false); // Don't size new columns
-		_data.at(name).resize(_rowCount); // But resize all columns (that are in row)
+		_data.at(name)->resize(_rowCount); // But resize all columns (that are in row)
 
-		row[name].copyCellTo( &_data.at(name).back() ); //Copy the cell in the row into the data frame.
+		CX_DataFrameCell target(_data.at(name), _rowCount - 1);
+		row[name].copyCellTo(&target); //Copy the cell in the row into the data frame.
 	}
 
 	// Columns not in row must now be lengthened with empty cells.
@@ -534,25 +727,19 @@ void CX_DataFrame::insertRow(CX_DataFrameRow row, rowIndex_t beforeIndex) {
 	//For each existing column, insert one cell then assign new data to that cell
 	for (auto existingColumn = this->_data.begin(); existingColumn != this->_data.end(); existingColumn++) {
 
-		//By default, put new items at the end
-		std::vector<CX_DataFrameCell>::iterator insertionIterator = existingColumn->second.end();
-
-		//But if the insertion is supposed to come before the end, update the iterator.
-		if (beforeIndex < this->getRowCount()) {
-			insertionIterator = existingColumn->second.begin() + beforeIndex;
-		}
-
 		//For each column, make a new cell, regardless of if it is going to be filled right now.
-		existingColumn->second.insert(insertionIterator, CX_DataFrameCell());
+		existingColumn->second->insertRow(insertIndex);
 
 		//If this the row had data for this column, copy it over.
 		if (Util::contains(rowNames, existingColumn->first)) {
-			row[existingColumn->first].copyCellTo(&(existingColumn->second[insertIndex]));
+			CX_DataFrameCell target(existingColumn->second, insertIndex);
+			row[existingColumn->first].copyCellTo(&target);
 		}
 	}
 
 	//Note that a row has been added
 	this->_rowCount++;
+	_updateMemoryUse();
 }
 
 /*! Returns a vector containing the names of the columns in the data frame.
@@ -570,6 +757,7 @@ CX_DataFrame::rowIndex_t CX_DataFrame::getRowCount(void) const {
 \param newOrder Vector of row indices. newOrder.size() must equal this->getRowCount(). newOrder must not contain any out-of-range indices
 (i.e. they must be < getRowCount()). Both of these error conditions are checked for in the function call and errors are logged.
 \return true if all of the conditions of newOrder are met, false otherwise.
+\note If `newOrder` contains each row once, the data of each column is moved into the new order without being copied.
 */
 bool CX_DataFrame::reorderRows(const std::vector<CX_DataFrame::rowIndex_t>& newOrder) {
 	if (newOrder.size() != _rowCount) {
@@ -584,34 +772,27 @@ bool CX_DataFrame::reorderRows(const std::vector<CX_DataFrame::rowIndex_t>& newO
 		}
 	}
 
-	*this = copyRows(newOrder);
-	return true;
-
-	/*
-	for (unsigned int i = 0; i < newOrder.size(); i++) {
-		if (newOrder[i] >= _rowCount) {
-			CX::Instances::Log.error("CX_DataFrame") << "reorderRows failed: newOrder contained out-of-range indices.";
-			return false;
+	//A permutation of the rows can be applied by moving the data of each column into its new order.
+	//If rows are repeated, some data must be copied.
+	std::vector<bool> seen(_rowCount, false);
+	bool isPermutation = true;
+	for (rowIndex_t row : newOrder) {
+		if (seen[row]) {
+			isPermutation = false;
+			break;
 		}
+		seen[row] = true;
 	}
 
-	std::vector<std::string> names = getColumnNames();
-
-	for (std::vector<std::string>::iterator it = names.begin(); it != names.end(); it++) {
-
-		std::vector<CX_DataFrameCell> columnCopy(_rowCount); //Data must first be copied into new columns,
-			//otherwise moving data from one row to another could overwrite a row that hasn't been copied yet.
-		for (rowIndex_t i = 0; i < newOrder.size(); i++) {
-			_data[*it][newOrder[i]].copyCellTo( &columnCopy[i] );
-		}
-
-		for (rowIndex_t i = 0; i < newOrder.size(); i++) {
-			columnCopy[i].copyCellTo( &_data[*it][newOrder[i]] );
-		}
+	if (!isPermutation) {
+		*this = copyRows(newOrder);
+		return true;
+	}
 
+	for (auto& column : _data) {
+		column.second->permute(newOrder);
 	}
 	return true;
-	*/
 }
 
 /*! Creates a CX_DataFrameRow that contains a copy of the given row of the CX_DataFrame.
@@ -631,7 +812,8 @@ CX_DataFrameRow CX_DataFrame::copyRow(rowIndex_t row) const {
 	}
 
 	for (const std::string& col : getColumnNames()) {
-		this->_data.at(col).at(row).copyCellTo(&(r[col]));
+		CX_DataFrameCell target = r[col];
+		CX_DataFrameCell(this->_data.at(col), row).copyCellTo(&target);
 	}
 
 	return r;
@@ -662,11 +844,10 @@ CX_DataFrame CX_DataFrame::copyRows(std::vector<CX_DataFrame::rowIndex_t> rowOrd
 	CX_DataFrame copyDf;
 
 	for (const std::string& col : getColumnNames()) {
-        copyDf._resizeToFit(col, rowOrder.size() - 1);
-        for (rowIndex_t row = 0; row < rowOrder.size(); row++) {
-            this->_data.at(col)[rowOrder[row]].copyCellTo( &copyDf._data.at(col)[row] );
-        }
+		copyDf._tryAddColumn(col, false);
+		copyDf._data.at(col) = std::make_shared<Private::CX_DataFrameColumnStore>(this->_data.at(col)->gather(rowOrder));
 	}
+	copyDf._rowCount = rowOrder.size();
 
 	return copyDf;
 }
@@ -692,11 +873,10 @@ CX_DataFrame CX_DataFrame::copyColumns(std::vector<std::string> columns) {
 
 	CX_DataFrame copyDf;
 	for (const std::string& col : validColumns) {
-		copyDf._resizeToFit(col, this->getRowCount() - 1);
-		for (rowIndex_t row = 0; row < this->getRowCount(); row++) {
-			this->operator()(col, row).copyCellTo( &copyDf._data.at(col)[row] );
-		}
+		copyDf._tryAddColumn(col, false);
+		copyDf._data.at(col) = std::make_shared<Private::CX_DataFrameColumnStore>(*this->_data.at(col));
 	}
+	copyDf._rowCount = this->getRowCount();
 
 	return copyDf;
 }
@@ -706,6 +886,9 @@ CX_DataFrame CX_DataFrame::copyColumns(std::vector<std::string> columns) {
 \note This function may be \ref blockingCode if the data frame is large.
 */
 void CX_DataFrame::shuffleRows(CX_RandomNumberGenerator &rng) {
+	if (_rowCount == 0) {
+		return;
+	}
 	vector<CX_DataFrame::rowIndex_t> newOrder = CX::Util::intVector<CX_DataFrame::rowIndex_t>(0, _rowCount - 1);
 	rng.shuffleVector(&newOrder);
 	reorderRows(newOrder);
@@ -738,17 +921,42 @@ bool CX_DataFrame::addColumn(std::string columnName) {
 	return _tryAddColumn(columnName, true);
 }
 
-/*! Appends a data frame to this data frame. 
-Internally, CX_DataFrame::appendRow() is used to copy over the rows of `df` one at a time.
+/*! Appends a copy of a data frame to the end of this data frame. Columns of `df` that are not in this data frame are added to it
+and columns of this data frame that are not in `df` get empty cells in the appended rows.
 \param df The CX_DataFrame to append. */
-void CX_DataFrame::append(CX_DataFrame df) {
-	for (rowIndex_t i = 0; i < df.getRowCount(); i++) {
-		this->appendRow(df[i]);
+void CX_DataFrame::append(const CX_DataFrame& df) {
+	this->append(CX_DataFrame(df));
+}
+
+/*! Appends a data frame to the end of this data frame, moving the data of each column of `df` onto the end of
+the matching column of this data frame instead of copying it one cell at a time.
+\param df The CX_DataFrame to append. It is empty after this function is called. */
+void CX_DataFrame::append(CX_DataFrame&& df) {
+	if (&df == this) {
+		this->append(CX_DataFrame(df));
+		return;
 	}
+
+	for (const std::string& name : df._orderToName) {
+		_tryAddColumn(name, true);
+
+		ColumnPtr& source = df._data.at(name);
+		if (source.use_count() == 1) {
+			_data.at(name)->append(std::move(*source));
+		} else {
+			//Cells outside of df still refer to its data, so it must not be moved.
+			_data.at(name)->append(Private::CX_DataFrameColumnStore(*source));
+		}
+	}
+
+	_rowCount += df._rowCount;
+	_equalizeRowLengths();
+
+	df.clear();
 }
 
 /*! \brief Returns `true` if the named column exists in the `CX_DataFrame`. */
-bool CX_DataFrame::columnExists(std::string columnName) const {
+bool CX_DataFrame::columnExists(const std::string& columnName) const {
 	return _data.find(columnName) != _data.end();
 }
 
@@ -759,12 +967,7 @@ bool CX_DataFrame::columnContainsVectors(std::string columnName) const {
 		return false;
 	}
 
-	for (rowIndex_t i = 0; i < getRowCount(); i++) {
-		if (_data.at(columnName)[i].isVector()) {
-			return true;
-		}
-	}
-	return false;
+	return _data.at(columnName)->containsVectors();
 }
 
 /*! Converts a column which contains vectors of data into multiple columns which are given names
@@ -860,11 +1063,18 @@ void CX_DataFrame::convertAllVectorColumnsToMultipleColumns(int startIndex, bool
 	}
 }
 
+/*! Splits the rows of the data frame into groups that have the same values in the given columns, so that summary
+statistics can be calculated for each group with CX_DataFrameGroups::agg(). See CX::CX_DataFrameGroups.
+\param columns The names of the columns to group by.
+\return The groups. */
+CX_DataFrameGroups CX_DataFrame::groupBy(const std::vector<std::string>& columns) const {
+	return CX_DataFrameGroups(*this, columns);
+}
 
 
 
 
-void CX_DataFrame::_resizeToFit(std::string column) {
+void CX_DataFrame::_resizeToFit(const std::string& column) {
 	if (_tryAddColumn(column, true)) {
 		CX::Instances::Log.verbose("CX_DataFrame") << "Data frame resized to fit column \"" << column << "\".";
 	}
@@ -874,60 +1084,76 @@ void CX_DataFrame::_resizeToFit(rowIndex_t row) {
 	rowIndex_t newCount = row + 1;
 	if (newCount > _rowCount && _data.size() > 0) {
 		_rowCount = std::max(_rowCount, newCount);
-		for (std::map<std::string, std::vector<CX_DataFrameCell>>::iterator it = _data.begin(); it != _data.end(); it++) {
-			it->second.resize(_rowCount);
+		for (auto it = _data.begin(); it != _data.end(); it++) {
+			it->second->resize(_rowCount);
 		}
+		_updateMemoryUse();
 		CX::Instances::Log.verbose("CX_DataFrame") << "Data frame resized to fit row " << row << ".";
 	}
 }
 
-void CX_DataFrame::_resizeToFit(std::string column, rowIndex_t row) {
+void CX_DataFrame::_resizeToFit(const std::string& column, rowIndex_t row) {
 	_resizeToFit(column);
 	_resizeToFit(row);
 }
 
 void CX_DataFrame::_equalizeRowLengths(void) {
 	rowIndex_t maxSize = 0;
-	for (std::map<std::string, std::vector<CX_DataFrameCell>>::iterator it = _data.begin(); it != _data.end(); it++) {
-		maxSize = std::max(it->second.size(), maxSize);
+	for (auto it = _data.begin(); it != _data.end(); it++) {
+		maxSize = std::max(it->second->rowCount(), maxSize);
 	}
 
-	for (std::map<std::string, std::vector<CX_DataFrameCell>>::iterator it = _data.begin(); it != _data.end(); it++) {
-		it->second.resize(maxSize);
+	for (auto it = _data.begin(); it != _data.end(); it++) {
+		it->second->resize(maxSize);
 	}
 	_rowCount = maxSize;
+	_updateMemoryUse();
 }
 
 // Returns true if a new column was added
-bool CX_DataFrame::_tryAddColumn(std::string column, bool setRowCount) {
+bool CX_DataFrame::_tryAddColumn(const std::string& column, bool setRowCount) {
 
 	if (columnExists(column)) {
 		return false;
 	}
 
-	_data.insert(std::pair<std::string, std::vector<CX_DataFrameCell>>(column, std::vector<CX_DataFrameCell>()));
+	_data.insert(std::pair<std::string, ColumnPtr>(column, std::make_shared<Private::CX_DataFrameColumnStore>(setRowCount ? _rowCount : 0)));
 
 	_orderToName.push_back(column);
 
-	if (setRowCount) {
-		_data.at(column).resize(_rowCount);
-	}
-
+	_updateMemoryUse();
 	return true;
 }
 
+//Looks up the column with a single search of the index, adding it if it does not exist.
+CX_DataFrame::ColumnPtr& CX_DataFrame::_findOrAddColumn(const std::string& column) {
+	auto it = _data.find(column);
+	if (it == _data.end()) {
+		_resizeToFit(column);
+		it = _data.find(column);
+	}
+	return it->second;
+}
+
 void CX_DataFrame::_duplicate(CX_DataFrame* target) const {
 
 	target->clear();
 
 	for (const std::string& col : this->getColumnNames()) {
+		target->_tryAddColumn(col, false);
+		target->_data.at(col) = std::make_shared<Private::CX_DataFrameColumnStore>(*this->_data.at(col));
+	}
+	target->_rowCount = this->_rowCount;
+	target->_updateMemoryUse();
+}
 
-		target->_resizeToFit(col, this->_rowCount - 1);
-
-		for (rowIndex_t row = 0; row < this->_rowCount; row++) {
-			this->_data.at(col)[row].copyCellTo(&target->_data.at(col)[row]);
-		}
+//Columns that are shared with cells or columns that outlive the data frame are counted as belonging to the data frame.
+void CX_DataFrame::_updateMemoryUse(void) {
+	uint64_t bytes = 0;
+	for (const auto& col : _data) {
+		bytes += col.second->estimateMemoryUse();
 	}
+	_trackedBytes.set(bytes);
 }
 
 
@@ -943,7 +1169,7 @@ std::istream& operator >> (std::istream& is, CX_DataFrame& df) {
 	// See https://stackoverflow.com/a/3203502
 	std::istreambuf_iterator<char> eoi; // default-constructed istreambuf_iterator is end-of-file (or end of input).
 	std::string dfStr(std::istreambuf_iterator<char>(is), eoi);
-	df._readFromString(dfStr, CX_DataFrame::InputOptions(), "operator>>(): ", "from input stream");
+	df._readFromBuffer(dfStr.data(), dfStr.size(), CX_DataFrame::InputOptions(), "operator>>(): ", "from input stream");
 	return is;
 }
 
@@ -1003,12 +1229,15 @@ CX_DataFrameCell CX_DataFrameRow::operator[] (std::string column) {
 	if (_df) {
 		return _df->operator()(column, _rowNumber);
 	} else {
-		if (_data.find(column) == _data.end()) {
-			_data.insert(std::pair<std::string, CX_DataFrameCell>());
+		auto it = _data.find(column);
+		if (it == _data.end()) {
+			//The cells of an unlinked row are backed by stores so that the returned cells refer to the row.
+			CX_DataFrameCell cell(std::make_shared<Private::CX_DataFrameColumnStore>(1), 0);
+			it = _data.insert(std::pair<std::string, CX_DataFrameCell>(column, cell)).first;
 			_orderToName.push_back(column);
 		}
 
-		return _data[column];
+		return it->second;
 	}
 }
 
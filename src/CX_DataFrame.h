@@ -2,16 +2,19 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <set>
 #include <string>
 #include <sstream>
 #include <iostream>
 #include <exception>
+#include <functional>
 
 #include "ofUtils.h"
 
 #include "CX_Utilities.h"
 #include "CX_Logger.h"
+#include "CX_MemoryUsage.h"
 
 #include "CX_DataFrameCell.h"
 
@@ -20,6 +23,8 @@ namespace CX {
 // Foward declarations
 class CX_DataFrameRow;
 class CX_DataFrameColumn;
+template <typename T> class CX_DataFrameColumnHandle;
+class CX_DataFrameGroups;
 class CX_RandomNumberGenerator;
 
 /*! \defgroup dataManagement Data
@@ -63,16 +68,30 @@ public:
 	/*! Options for the format of data that are output from a CX_DataFrame. */
 	struct OutputOptions : public IoOptions {
 		OutputOptions(void) :
-			printRowNumbers(false)
+			printRowNumbers(false),
+			threadCount(0)
 		{}
 
 		bool printRowNumbers; //!< If `true`, a column of row numbers will be printed. The column will be named "rowNumber". Defaults to `true`.
 		std::vector<rowIndex_t> rowsToPrint; //!< The indices of the rows that should be printed. If the vector has size 0, all rows will be printed.
 		std::vector<std::string> columnsToPrint; //!< The names of the columns that should be printed. If the vector has size 0, all columns will be printed.
+
+		/*! The number of threads used to format the rows. If 0, one thread per hardware thread is used. Rows are only split
+		between threads in chunks of at least 65536 cells, so small data frames are always formatted by one thread. The output
+		is the same for any number of threads. Defaults to 0. */
+		unsigned int threadCount;
 	};
 
 	/*! Options for the format of data that are input to a CX_DataFrame. */
-	struct InputOptions : public IoOptions {};
+	struct InputOptions : public IoOptions {
+		InputOptions(void) :
+			threadCount(1)
+		{}
+
+		/*! The number of threads used to parse the input. If 0, one thread per hardware thread is used. Inputs are only split
+		between threads in chunks of at least a megabyte, so small files are always parsed by one thread. Defaults to 1. */
+		unsigned int threadCount;
+	};
 
 
 	CX_DataFrame(void);
@@ -82,17 +101,18 @@ public:
 	CX_DataFrame& operator=(const CX_DataFrame& df);
 	CX_DataFrame& operator=(CX_DataFrame&& df);
 
-	void append(CX_DataFrame df);
+	void append(const CX_DataFrame& df);
+	void append(CX_DataFrame&& df);
 
 	void clear(void);
 
 
 	//Cell operations
-	CX_DataFrameCell operator() (std::string column, rowIndex_t row);
-	CX_DataFrameCell operator() (rowIndex_t row, std::string column);
+	CX_DataFrameCell operator() (const std::string& column, rowIndex_t row);
+	CX_DataFrameCell operator() (rowIndex_t row, const std::string& column);
 
-	CX_DataFrameCell at(rowIndex_t row, std::string column);
-	CX_DataFrameCell at(std::string column, rowIndex_t row);
+	CX_DataFrameCell at(rowIndex_t row, const std::string& column);
+	CX_DataFrameCell at(const std::string& column, rowIndex_t row);
 
 
 	//Row operations
@@ -121,13 +141,14 @@ public:
 	bool deleteColumn(std::string columnName);
 
 	std::vector<std::string> getColumnNames(void) const;
-	bool columnExists(std::string columnName) const;
+	bool columnExists(const std::string& columnName) const;
 
 	//std::vector<CX_DataFrameCell>& getColumnReference(std::string columnName);
 
 	CX_DataFrame copyColumns(std::vector<std::string> columns);
 	
 	CX_DataFrameColumn operator[] (std::string column);
+	template <typename T> CX_DataFrameColumnHandle<T> columnHandle(const std::string& column);
 	template <typename T> std::vector<T> copyColumn(std::string column) const;
 	template <typename T> std::vector<std::vector<T>> copyVectorColumn(std::string column) const;
 
@@ -135,6 +156,8 @@ public:
 	std::vector<std::string> convertVectorColumnToColumns(std::string columnName, int startIndex, bool deleteOriginal, std::string newBaseName = "");
 	void convertAllVectorColumnsToMultipleColumns(int startIndex, bool deleteOriginals);
 
+	CX_DataFrameGroups groupBy(const std::vector<std::string>& columns) const;
+
 
 	//Data IO
 	std::string print(std::string delimiter = "\t", bool printRowNumbers = false) const;
@@ -152,28 +175,42 @@ public:
 	bool readFromFile(std::string filename, InputOptions iOpt);
 	bool readFromFile(std::string filename, std::string cellDelimiter = "\t", std::string vectorEncloser = "\"", std::string vectorElementDelimiter = ";");
 
+	bool writeBinary(std::string filename) const;
+	bool readBinary(std::string filename);
+
 
 private:
 	friend class CX_DataFrameRow;
 	friend class CX_DataFrameColumn;
+	friend class CX_DataFrameWriter;
+	friend class CX_DataFrameGroups;
+
+	typedef std::shared_ptr<Private::CX_DataFrameColumnStore> ColumnPtr;
 
-	std::map<std::string, std::vector<CX_DataFrameCell>> _data;
+	std::unordered_map<std::string, ColumnPtr> _data;
 	std::vector<std::string> _orderToName;
 
 	rowIndex_t _rowCount;
 
-	void _resizeToFit(std::string column, rowIndex_t row);
+	//Counts the cell data of the columns in Util::MemoryCategory::DATA_FRAMES. It is updated when the shape of the data frame changes.
+	Private::CX_TrackedBytes<Util::MemoryCategory::DATA_FRAMES> _trackedBytes;
+	void _updateMemoryUse(void);
+
+	void _resizeToFit(const std::string& column, rowIndex_t row);
 	void _resizeToFit(rowIndex_t row);
-	void _resizeToFit(std::string column);
+	void _resizeToFit(const std::string& column);
 
 	void _equalizeRowLengths(void);
 
-	bool _tryAddColumn(std::string column, bool setRowCount);
+	bool _tryAddColumn(const std::string& column, bool setRowCount);
+	ColumnPtr& _findOrAddColumn(const std::string& column);
 
 	void _duplicate(CX_DataFrame* target) const;
 
-	static std::vector< std::vector<std::string> > _fileLineToVectors(std::string line, const CX_DataFrame::InputOptions& opt);
-	bool _readFromString(const std::string& dfStr, const CX_DataFrame::InputOptions& opt, std::string callingFunction, std::string filename);
+	bool _readFromBuffer(const char* data, size_t size, const CX_DataFrame::InputOptions& opt, std::string callingFunction, std::string filename);
+
+	void _print(OutputOptions oOpt, const std::function<void(const std::string&)>& write) const;
+	static std::vector<std::string> _selectColumnsToPrint(const std::vector<std::string>& requested, const std::vector<std::string>& available);
 
 	friend std::ostream& operator<< (std::ostream& os, const CX_DataFrame& df);
 	friend std::istream& operator >> (std::istream& is, CX_DataFrame& df);
@@ -212,9 +249,10 @@ std::vector<T> CX_DataFrame::copyColumn(std::string column) const {
 		return rval;
 	}
 
-	for (unsigned int i = 0; i < _data.at(column).size(); i++) {
-		const CX_DataFrameCell& c = _data.at(column).at(i);
-		rval.push_back(c.to<T>());
+	const Private::CX_DataFrameColumnStore& store = *_data.at(column);
+	rval.reserve(store.rowCount());
+	for (rowIndex_t i = 0; i < store.rowCount(); i++) {
+		rval.push_back(store.to<T>(i, true));
 	}
 	return rval;
 }
@@ -233,9 +271,10 @@ std::vector<std::vector<T>> CX_DataFrame::copyVectorColumn(std::string column) c
 		return rval;
 	}
 
-	for (unsigned int i = 0; i < _data.at(column).size(); i++) {
-		const CX_DataFrameCell& c = _data.at(column).at(i);
-		rval.push_back(c.toVector<T>());
+	const Private::CX_DataFrameColumnStore& store = *_data.at(column);
+	rval.reserve(store.rowCount());
+	for (rowIndex_t i = 0; i < store.rowCount(); i++) {
+		rval.push_back(store.toVector<T>(i, true));
 	}
 	return rval;
 }
@@ -309,4 +348,124 @@ private:
 	
 };
 
+/*! This class gives fast access to the cells of one column of a CX_DataFrame. The column is looked up by name once, when the
+handle is created with CX::CX_DataFrame::columnHandle(), instead of on every access, and values are read and written directly as
+type `T` without constructing a CX_DataFrameCell. This makes it the best way to access many rows of a column in a loop.
+
+\code{.cpp}
+CX_DataFrame df;
+CX_DataFrameColumnHandle<double> rt = df.columnHandle<double>("rt");
+
+df.setRowCount(100);
+for (CX_DataFrame::rowIndex_t row = 0; row < rt.size(); row++) {
+	rt[row] = 300 + row;
+}
+
+double total = 0;
+for (CX_DataFrame::rowIndex_t row = 0; row < rt.size(); row++) {
+	total += rt[row];
+}
+\endcode
+
+Unlike CX::CX_DataFrame::operator(), the handle does not resize the data frame: `operator[]` does no bounds checking (just like
+`std::vector::operator[]`) and at() throws a `std::out_of_range` exception for rows that do not exist. Rows that are added to the
+data frame after the handle is created can be accessed with the handle.
+
+The handle refers to the column data itself, so it does not see a column that replaces the original. Make a new handle
+after deleting the column, clearing or assigning to the data frame, or reading data into it from a file.
+
+\tparam T The type of data that is stored into and extracted from the column. If the data in a cell is of a different
+type, it is converted in the same way as with CX::CX_DataFrameCell::to().
+
+\ingroup dataManagement */
+template <typename T>
+class CX_DataFrameColumnHandle {
+public:
+
+	/*! A reference to one cell of the column, like a CX_DataFrameCell, but with the type fixed to `T`. */
+	class Reference {
+	public:
+		Reference& operator=(const T& value) { _store->storeScalar<T>(_row, value); return *this; };
+		Reference& operator=(const Reference& other) { return this->operator=(T(other)); };
+		operator T(void) const { return _store->to<T>(_row, true); };
+
+	private:
+		friend class CX_DataFrameColumnHandle<T>;
+		Reference(Private::CX_DataFrameColumnStore* store, CX_DataFrame::rowIndex_t row) : _store(store), _row(row) {};
+
+		Private::CX_DataFrameColumnStore* _store;
+		CX_DataFrame::rowIndex_t _row;
+	};
+
+	/*! Constructs a handle that does not refer to any column. */
+	CX_DataFrameColumnHandle(void) {};
+
+	/*! Returns `true` if the handle refers to a column. */
+	bool isValid(void) const { return _store != nullptr; };
+
+	/*! Returns the name of the column. */
+	const std::string& getColumnName(void) const { return _columnName; };
+
+	/*! Returns the number of rows in the column, or 0 if the handle does not refer to a column (see isValid()). */
+	CX_DataFrame::rowIndex_t size(void) const { return (_store != nullptr) ? _store->rowCount() : 0; };
+
+	/*! Accesses the cell in the given row without bounds checking. */
+	Reference operator[](CX_DataFrame::rowIndex_t row) { return Reference(_store.get(), row); };
+
+	/*! Extracts the value of the cell in the given row without bounds checking. */
+	T operator[](CX_DataFrame::rowIndex_t row) const { return _store->to<T>(row, true); };
+
+	Reference at(CX_DataFrame::rowIndex_t row);
+	T at(CX_DataFrame::rowIndex_t row) const;
+
+	/*! Returns a CX_DataFrameCell for the given row, which can be used to store data of other types or vectors. */
+	CX_DataFrameCell cell(CX_DataFrame::rowIndex_t row) { return CX_DataFrameCell(_store, row); };
+
+private:
+	friend class CX_DataFrame;
+	CX_DataFrameColumnHandle(std::shared_ptr<Private::CX_DataFrameColumnStore> store, std::string columnName) :
+		_store(store),
+		_columnName(columnName)
+	{}
+
+	std::shared_ptr<Private::CX_DataFrameColumnStore> _store;
+	std::string _columnName;
+
+	void _checkRow(CX_DataFrame::rowIndex_t row) const;
+};
+
+/*! Accesses the cell in the given row. Throws a `std::out_of_range` exception and logs an error if the row does not exist. */
+template <typename T>
+typename CX_DataFrameColumnHandle<T>::Reference CX_DataFrameColumnHandle<T>::at(CX_DataFrame::rowIndex_t row) {
+	_checkRow(row);
+	return Reference(_store.get(), row);
+}
+
+/*! Extracts the value of the cell in the given row. Throws a `std::out_of_range` exception and logs an error if the row does not exist. */
+template <typename T>
+T CX_DataFrameColumnHandle<T>::at(CX_DataFrame::rowIndex_t row) const {
+	_checkRow(row);
+	return _store->to<T>(row, true);
+}
+
+template <typename T>
+void CX_DataFrameColumnHandle<T>::_checkRow(CX_DataFrame::rowIndex_t row) const {
+	if (_store == nullptr || row >= _store->rowCount()) {
+		std::stringstream s;
+		s << "CX_DataFrameColumnHandle: Out of bounds access at(" << row << ") in column \"" << _columnName << "\"";
+		CX::Instances::Log.error("CX_DataFrame") << s.str();
+		throw std::out_of_range(s.str().c_str());
+	}
+}
+
+/*! Makes a handle for fast access to the given column. If the column does not exist, it is created.
+See CX::CX_DataFrameColumnHandle for more information.
+\tparam T The type of data to store into and extract from the column.
+\param column The name of the column.
+\return A handle to the column. */
+template <typename T>
+CX_DataFrameColumnHandle<T> CX_DataFrame::columnHandle(const std::string& column) {
+	return CX_DataFrameColumnHandle<T>(_findOrAddColumn(column), column);
+}
+
 }
@@ -0,0 +1,183 @@
+#include "CX_DataFrameBinary.h"
+
+namespace CX {
+namespace Private {
+
+/////////////////////
+// CX_BinaryWriter //
+/////////////////////
+
+void CX_BinaryWriter::putU32(uint32_t value) {
+	for (int i = 0; i < 4; i++) {
+		putU8((uint8_t)(value >> (8 * i)));
+	}
+}
+
+void CX_BinaryWriter::putU64(uint64_t value) {
+	for (int i = 0; i < 8; i++) {
+		putU8((uint8_t)(value >> (8 * i)));
+	}
+}
+
+void CX_BinaryWriter::putDouble(double value) {
+	uint64_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	putU64(bits);
+}
+
+void CX_BinaryWriter::putBytes(const void* data, size_t size) {
+	if (size > 0) {
+		_buffer.append(static_cast<const char*>(data), size);
+	}
+}
+
+/*! Writes the length of the string as a 32-bit integer followed by the characters. */
+void CX_BinaryWriter::putString(const std::string& str) {
+	putU32((uint32_t)str.size());
+	putBytes(str.data(), str.size());
+}
+
+void CX_BinaryWriter::putDoubleArray(const double* values, size_t count) {
+	if (hostIsLittleEndian()) {
+		putBytes(values, count * sizeof(double));
+	} else {
+		for (size_t i = 0; i < count; i++) {
+			putDouble(values[i]);
+		}
+	}
+}
+
+/*! Pads the buffer with zeros until its size is a multiple of `alignment`. */
+void CX_BinaryWriter::align(size_t alignment) {
+	size_t remainder = _buffer.size() % alignment;
+	if (remainder != 0) {
+		_buffer.append(alignment - remainder, '\0');
+	}
+}
+
+/////////////////////
+// CX_BinaryReader //
+/////////////////////
+
+CX_BinaryReader::CX_BinaryReader(const char* data, size_t size) :
+	_data(data),
+	_size(size),
+	_pos(0),
+	_failed(false)
+{}
+
+bool CX_BinaryReader::_canRead(size_t size, size_t count) {
+	if (_failed) {
+		return false;
+	}
+	size_t available = _size - _pos;
+	if (count > 0 && size > available / count) {
+		_failed = true;
+		return false;
+	}
+	return true;
+}
+
+uint8_t CX_BinaryReader::getU8(void) {
+	if (!_canRead(1)) {
+		return 0;
+	}
+	return (uint8_t)_data[_pos++];
+}
+
+uint32_t CX_BinaryReader::getU32(void) {
+	if (!_canRead(4)) {
+		return 0;
+	}
+	uint32_t value = 0;
+	for (int i = 0; i < 4; i++) {
+		value |= (uint32_t)(uint8_t)_data[_pos++] << (8 * i);
+	}
+	return value;
+}
+
+uint64_t CX_BinaryReader::getU64(void) {
+	if (!_canRead(8)) {
+		return 0;
+	}
+	uint64_t value = 0;
+	for (int i = 0; i < 8; i++) {
+		value |= (uint64_t)(uint8_t)_data[_pos++] << (8 * i);
+	}
+	return value;
+}
+
+double CX_BinaryReader::getDouble(void) {
+	uint64_t bits = getU64();
+	double value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+std::string CX_BinaryReader::getString(void) {
+	uint32_t length = getU32();
+	const char* chars = getBytes(length);
+	if (chars == nullptr) {
+		return std::string();
+	}
+	return std::string(chars, length);
+}
+
+/*! Returns a pointer to the next `size` bytes and moves past them, or `nullptr` if there are not that many bytes left. */
+const char* CX_BinaryReader::getBytes(size_t size) {
+	if (!_canRead(size)) {
+		return nullptr;
+	}
+	const char* bytes = _data + _pos;
+	_pos += size;
+	return bytes;
+}
+
+bool CX_BinaryReader::getDoubleArray(std::vector<double>* values, size_t count) {
+	if (!_canRead(sizeof(double), count)) {
+		return false;
+	}
+
+	values->resize(count);
+	if (hostIsLittleEndian()) {
+		if (count > 0) {
+			std::memcpy(values->data(), _data + _pos, count * sizeof(double));
+			_pos += count * sizeof(double);
+		}
+	} else {
+		for (size_t i = 0; i < count; i++) {
+			(*values)[i] = getDouble();
+		}
+	}
+	return true;
+}
+
+bool CX_BinaryReader::getByteArray(std::vector<uint8_t>* values, size_t count) {
+	const char* bytes = getBytes(count);
+	if (bytes == nullptr) {
+		return false;
+	}
+	values->assign(bytes, bytes + count);
+	return true;
+}
+
+/*! Skips padding until the position is a multiple of `alignment`. */
+bool CX_BinaryReader::align(size_t alignment) {
+	size_t remainder = _pos % alignment;
+	if (remainder != 0) {
+		return getBytes(alignment - remainder) != nullptr;
+	}
+	return !_failed;
+}
+
+bool CX_BinaryReader::seek(size_t position) {
+	if (_failed || position > _size) {
+		_failed = true;
+		return false;
+	}
+	_pos = position;
+	return true;
+}
+
+} //namespace Private
+} //namespace CX
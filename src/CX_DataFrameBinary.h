@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+namespace CX {
+namespace Private {
+
+	/*! Returns `true` if the machine stores integers with the least significant byte first. */
+	inline bool hostIsLittleEndian(void) {
+		const uint16_t one = 1;
+		return *reinterpret_cast<const unsigned char*>(&one) == 1;
+	}
+
+	/*! This class appends values to a buffer in the little-endian byte order used by the binary data frame format
+	(see CX_DataFrame::writeBinary()). Arrays of values are copied in a single block when the machine is little-endian.
+
+	This class is used internally by CX_DataFrame and should not be used directly.
+	*/
+	class CX_BinaryWriter {
+	public:
+
+		void putU8(uint8_t value) { _buffer.push_back((char)value); };
+		void putU32(uint32_t value);
+		void putU64(uint64_t value);
+		void putDouble(double value);
+		void putBytes(const void* data, size_t size);
+		void putString(const std::string& str);
+
+		template <typename T> void putU64Array(const T* values, size_t count);
+		void putDoubleArray(const double* values, size_t count);
+
+		void align(size_t alignment);
+
+		size_t size(void) const { return _buffer.size(); };
+		const std::string& buffer(void) const { return _buffer; };
+
+	private:
+		std::string _buffer;
+	};
+
+	/*! This class reads values written by CX_BinaryWriter from a buffer, which may be a memory-mapped file. Reading past the end
+	of the buffer puts the reader into a failed state in which nothing more is read, so a sequence of reads can be checked once
+	at the end with failed(). Arrays are checked against the remaining size before anything is allocated for them.
+
+	This class is used internally by CX_DataFrame and should not be used directly.
+	*/
+	class CX_BinaryReader {
+	public:
+
+		CX_BinaryReader(const char* data, size_t size);
+
+		uint8_t getU8(void);
+		uint32_t getU32(void);
+		uint64_t getU64(void);
+		double getDouble(void);
+		std::string getString(void);
+		const char* getBytes(size_t size);
+
+		template <typename T> bool getU64Array(std::vector<T>* values, size_t count);
+		bool getDoubleArray(std::vector<double>* values, size_t count);
+		bool getByteArray(std::vector<uint8_t>* values, size_t count);
+
+		bool align(size_t alignment);
+		bool seek(size_t position);
+
+		size_t position(void) const { return _pos; };
+		size_t remaining(void) const { return _failed ? 0 : _size - _pos; };
+		bool failed(void) const { return _failed; };
+
+	private:
+		const char* _data;
+		size_t _size;
+		size_t _pos;
+		bool _failed;
+
+		bool _canRead(size_t size, size_t count = 1);
+	};
+
+	template <typename T>
+	void CX_BinaryWriter::putU64Array(const T* values, size_t count) {
+		static_assert(std::is_integral<T>::value, "putU64Array() only writes integers.");
+		if (hostIsLittleEndian() && sizeof(T) == sizeof(uint64_t)) {
+			putBytes(values, count * sizeof(T));
+		} else {
+			for (size_t i = 0; i < count; i++) {
+				putU64(static_cast<uint64_t>(values[i]));
+			}
+		}
+	}
+
+	template <typename T>
+	bool CX_BinaryReader::getU64Array(std::vector<T>* values, size_t count) {
+		static_assert(std::is_integral<T>::value, "getU64Array() only reads integers.");
+		if (!_canRead(sizeof(uint64_t), count)) {
+			return false;
+		}
+
+		values->resize(count);
+		if (hostIsLittleEndian() && sizeof(T) == sizeof(uint64_t)) {
+			if (count > 0) {
+				std::memcpy(values->data(), _data + _pos, count * sizeof(T));
+				_pos += count * sizeof(T);
+			}
+		} else {
+			for (size_t i = 0; i < count; i++) {
+				(*values)[i] = static_cast<T>(getU64());
+			}
+		}
+		return true;
+	}
+
+} //namespace Private
+} //namespace CX
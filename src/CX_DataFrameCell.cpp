@@ -2,11 +2,9 @@
 
 namespace CX {
 
-unsigned int CX_DataFrameCell::_floatingPointPrecision = std::numeric_limits<double>::max_digits10;
-
 /*! Set the precision with which floating point numbers (`float`s and `double`s) are stored, in number of significant digits.
-This value will be used for all `CX_DataFrameCell`s. Changing this value after storing data will
-not change the precision of the stored data.
+This value will be used for all `CX_DataFrameCell`s. Numbers are stored in binary form, so this precision
+is applied whenever a number is converted to text, e.g. when a data frame is printed.
 
 Defaults to std::numeric_limits<double>::max_digits10 significant digits. To quote cppreference.com,
 "The value of std::numeric_limits<T>::max_digits10 is the number of base-10 digits that are necessary to
@@ -17,39 +15,94 @@ and the string representation of that value stored by the CX_DataFrameCell.
 \param prec The number of significant digits.
 */
 void CX_DataFrameCell::setFloatingPointPrecision(unsigned int prec) {
-	_floatingPointPrecision = prec;
+	Private::CX_DataFrameColumnStore::floatingPointPrecision = prec;
 }
 
 /*! Get the current floating point precision, set by CX_DataFrameCell::setFloatingPointPrecision(). */
 unsigned int CX_DataFrameCell::getFloatingPointPrecision(void) {
-	return _floatingPointPrecision;
+	return Private::CX_DataFrameColumnStore::floatingPointPrecision;
 }
 
 
 
-CX_DataFrameCell::CX_DataFrameCell(void) {
-	_allocatePointers();
-	*_type = "NULL";
+CX_DataFrameCell::CX_DataFrameCell(void) :
+	_row(0),
+	_ownsStore(false)
+{}
+
+//Constructs a cell that refers to a row of a column of a data frame.
+CX_DataFrameCell::CX_DataFrameCell(std::shared_ptr<Private::CX_DataFrameColumnStore> store, std::size_t row) :
+	_store(store),
+	_row(row),
+	_ownsStore(false)
+{}
+
+/*! Copy constructor. If `cell` refers to a cell of a data frame, the new cell refers to the same cell.
+Otherwise, the data in `cell` is copied. */
+CX_DataFrameCell::CX_DataFrameCell(const CX_DataFrameCell& cell) :
+	_row(0),
+	_ownsStore(false)
+{
+	*this = cell;
 }
 
-/*! Constructs the cell with a string literal, treating it's type as the same as a `std::string`. */
-CX_DataFrameCell::CX_DataFrameCell(const char* c) {
-	_allocatePointers();
+/*! Move constructor. */
+CX_DataFrameCell::CX_DataFrameCell(CX_DataFrameCell&& cell) :
+	_store(std::move(cell._store)),
+	_row(cell._row),
+	_ownsStore(cell._ownsStore),
+	_value(cell._value)
+{
+	cell._ownsStore = false;
+}
+
+/*! Copy assignment. If `cell` refers to a cell of a data frame, this cell will refer to the same cell.
+Otherwise, the data in `cell` is copied into this cell. */
+CX_DataFrameCell& CX_DataFrameCell::operator=(const CX_DataFrameCell& cell) {
+	if (this == &cell) {
+		return *this;
+	}
+
+	if (cell._ownsStore) {
+		_store = std::make_shared<Private::CX_DataFrameColumnStore>(*cell._store);
+	} else {
+		_store = cell._store;
+	}
+	_row = cell._row;
+	_ownsStore = cell._ownsStore;
+	_value = cell._value;
+	return *this;
+}
 
-	this->store<const char*>(c);
-	this->setStoredType<std::string>(); //override the type information with the type of std::string.
+/*! Move assignment. */
+CX_DataFrameCell& CX_DataFrameCell::operator=(CX_DataFrameCell&& cell) {
+	_store = std::move(cell._store);
+	_row = cell._row;
+	_ownsStore = cell._ownsStore;
+	_value = cell._value;
+	cell._ownsStore = false;
+	return *this;
+}
+
+//Called when a cell that is not part of a data frame is given data that does not fit in _value.
+void CX_DataFrameCell::_moveValueToStore(void) {
+	_store = std::make_shared<Private::CX_DataFrameColumnStore>(1);
+	_row = 0;
+	_ownsStore = true;
+	_store->storeValue(0, _value);
+	_value.clear();
 }
 
-void CX_DataFrameCell::_allocatePointers(void) {
-	_data = std::make_shared<std::vector<std::string>>();
-	_type = std::make_shared<std::string>();
-	_ignoreStoredType = std::make_shared<bool>(true);
+/*! Constructs the cell with a string literal, treating it's type as the same as a `std::string`. */
+CX_DataFrameCell::CX_DataFrameCell(const char* c) :
+	CX_DataFrameCell()
+{
+	this->store<std::string>(c);
 }
 
 /*! Assigns a string literal to the cell, treating it's type as the same as a `std::string`. */
 CX_DataFrameCell& CX_DataFrameCell::operator=(const char* c) {
-	this->store<const char*>(c);
-	this->setStoredType<std::string>();
+	this->store<std::string>(c);
 	return *this;
 }
 
@@ -71,29 +124,52 @@ between the surrounding angle brackets, and then using ` typeid(T).name()` as in
 
 \return A string containing the name of the stored type as given by typeid(typename).name(). */
 std::string CX_DataFrameCell::getStoredType(void) const {
-	if (*_ignoreStoredType) {
+	bool ignored = _store ? _store->isRowTypeIgnored(_row) : _value.isTypeIgnored();
+	if (ignored) {
 		return "Data type ignored (type deleted or unknown).";
 	}
 
+	std::string typeName = _store ? _store->getRowType(_row) : _value.getTypeName();
 	if (this->isVector()) {
-		return "vector<" + *_type + ">";
+		return "vector<" + typeName + ">";
 	}
-	return *_type;
+	return typeName;
 }
 
 /*! If for whatever reason the type of the data stored in the CX_DataFrameCell should
 be ignored, you can delete it with this function. */
 void CX_DataFrameCell::deleteStoredType(void) {
-	*_ignoreStoredType = true;
+	if (_store) {
+		_store->ignoreRowType(_row);
+	} else {
+		_value.ignoreType();
+	}
 }
 
 /*! Copies the contents of this cell to targetCell, including type information.
 \param targetCell A pointer to the cell to copy data to.
 */
 void CX_DataFrameCell::copyCellTo(CX_DataFrameCell* targetCell) const {
-	*targetCell->_data = *this->_data;
-	*targetCell->_type = *this->_type;
-	*targetCell->_ignoreStoredType = *this->_ignoreStoredType;
+	if (targetCell == this) {
+		return;
+	}
+
+	if (!targetCell->_store) {
+		if (!this->_store) {
+			targetCell->_value = this->_value;
+			return;
+		}
+		if (this->_store->loadValue(this->_row, &targetCell->_value)) {
+			return;
+		}
+		targetCell->_moveValueToStore();
+	}
+
+	if (this->_store) {
+		targetCell->_store->copyRowFrom(*this->_store, this->_row, targetCell->_row);
+	} else {
+		targetCell->_store->storeValue(targetCell->_row, this->_value);
+	}
 }
 
 
@@ -104,46 +180,58 @@ std::string CX_DataFrameCell::toString(void) const {
 
 /*! \brief Returns `true` if more than one element is stored in the CX_DataFrameCell. */
 bool CX_DataFrameCell::isVector(void) const {
-	return _data->size() > 1;
+	return this->size() > 1;
 }
 
 /*! \brief Returns the number of elements stored in the cell. */
 unsigned int CX_DataFrameCell::size(void) const {
-	return _data->size();
+	return _store ? _store->elementCount(_row) : _value.elementCount();
 }
 
 /*! \brief Delete the contents of the cell. */
 void CX_DataFrameCell::clear(void) {
-	_data->clear();
-	this->deleteStoredType();
+	if (_store) {
+		_store->clearRow(_row);
+	} else {
+		_value.clear();
+	}
 }
 
 /*! Equivalent to a call to toString(). This is specialized because it skips the type checks of to<T>.
 \return A copy of the stored data encoded as a string. */
 template<> std::string CX_DataFrameCell::to(bool log) const {
-	if (_data->size() == 0) {
+	size_t count = this->size();
+	if (count == 0) {
 		if (log) {
 			CX::Instances::Log.error("CX_DataFrameCell") << "to(): No data to extract from cell.";
 		}
 		return std::string();
 	}
 
-	if (log && (_data->size() > 1)) {
+	if (log && (count > 1)) {
 		CX::Instances::Log.warning("CX_DataFrameCell") << "to(): Attempt to extract a scalar when the stored data was a vector. Only the first value of the vector will be returned.";
 	}
 
-	return _data->at(0);
+	return _store ? _store->elementToString(_row, 0) : _value.toString();
 }
 
 /*! Converts the contents of the CX_DataFrame cell to a vector of strings. */
 template<> std::vector<std::string> CX_DataFrameCell::toVector(bool log) const {
 
 	//But why is an empty vector an error? An empty scalar can be thought of as an error, but an empty vector should be fine.
-	if (log && (_data->size() == 0)) {
+	if (log && (this->size() == 0)) {
 		CX::Instances::Log.error("CX_DataFrameCell") << "toVector(): No data to extract from cell.";
 	}
 
-	return *_data;
+	if (_store) {
+		return _store->rowToStrings(_row);
+	}
+
+	std::vector<std::string> rval;
+	if (_value.elementCount() > 0) {
+		rval.push_back(_value.toString());
+	}
+	return rval;
 }
 
 /*! \brief Stream insertion operator for a CX_DataFrameCell. It simply prints the contents of the CX_DataFrameCell in a pretty way. */
@@ -11,26 +11,43 @@
 
 #include "CX_Utilities.h"
 #include "CX_Logger.h"
+#include "CX_DataFrameColumnStore.h"
 
 namespace CX {
 
+	class CX_DataFrame;
+	class CX_DataFrameRow;
+	template <typename T> class CX_DataFrameColumnHandle;
+
 	/*! This class manages the contents of a single cell in a CX_DataFrame. It handles all of the type conversion nonsense
 	that goes on when data is inserted into or extracted from a data frame. It tracks the type of the data that is inserted
 	or extracted and logs warnings if the inserted type does not match the extracted type, with a few exceptions (see notes).
 
+	A CX_DataFrameCell that is returned from a CX_DataFrame refers to the data in the data frame, so assigning to it
+	modifies the data frame. The data itself is stored by column in typed arrays, so numbers, bools, and strings are
+	not converted to text until the data frame is printed, and storing a single value into an existing cell of a data
+	frame does not allocate memory. Other types are stored as strings using their stream insertion and extraction operators.
+
+	A CX_DataFrameCell that is not part of a data frame holds its own data, so copying it copies the data. Single numbers,
+	bools, and short strings are held within the cell itself without allocating memory.
+
 	\note There are a few exceptions to the type tracking. If the inserted type is const char*, it is treated as a string.
-	Additionally, you can extract anything as string without a warning. This is because the data is stored as a string
-	internally so extracting the data as a string is a lossless operation.
+	Additionally, you can extract anything as string without a warning, because every stored value has a lossless string
+	representation.
 	\ingroup dataManagement
 	*/
 	class CX_DataFrameCell {
 	public:
 
 		CX_DataFrameCell(void);
+		CX_DataFrameCell(const CX_DataFrameCell& cell);
+		CX_DataFrameCell(CX_DataFrameCell&& cell);
 		CX_DataFrameCell(const char* c);
 		template <typename T> CX_DataFrameCell(const T& value); //!< Construct the cell, assigning the value to it.
 		template <typename T> CX_DataFrameCell(const std::vector<T>& values); //!< Construct the cell, assigning the values to it.
 
+		CX_DataFrameCell& operator=(const CX_DataFrameCell& cell);
+		CX_DataFrameCell& operator=(CX_DataFrameCell&& cell);
 		CX_DataFrameCell& operator=(const char* c);
 		template <typename T> CX_DataFrameCell& operator=(const T& value); //!< Assigns a value to the cell.
 		template <typename T> CX_DataFrameCell& operator=(const std::vector<T>& values); //!< Assigns a vector of values to the cell.
@@ -70,31 +87,33 @@ namespace CX {
 		static unsigned int getFloatingPointPrecision(void);
 
 	private:
+		friend class CX_DataFrame;
+		friend class CX_DataFrameRow;
+		template <typename T> friend class CX_DataFrameColumnHandle;
 
-		static unsigned int _floatingPointPrecision;
-
-		std::shared_ptr<std::vector<std::string>> _data;
+		CX_DataFrameCell(std::shared_ptr<Private::CX_DataFrameColumnStore> store, std::size_t row);
 
-		std::shared_ptr<std::string> _type;
-		std::shared_ptr<bool> _ignoreStoredType;
-		//std::shared_ptr<std::size_t> _typeHash; //Could make type comparison go much faster
+		//_store is null if the data is held in _value. A cell that is not part of a data frame owns its store.
+		std::shared_ptr<Private::CX_DataFrameColumnStore> _store;
+		std::size_t _row;
+		bool _ownsStore;
+		Private::CX_DataFrameValue _value;
 
-		template <typename T> static std::string _toString(const T& value);
-		template <typename T> static T _fromString(const std::string& str);
-
-		void _allocatePointers(void);
+		void _moveValueToStore(void);
 
 	};
 
 	template <typename T>
-	CX_DataFrameCell::CX_DataFrameCell(const T& value) {
-		_allocatePointers();
+	CX_DataFrameCell::CX_DataFrameCell(const T& value) :
+		CX_DataFrameCell()
+	{
 		this->store(value);
 	}
 
 	template <typename T>
-	CX_DataFrameCell::CX_DataFrameCell(const std::vector<T>& values) {
-		_allocatePointers();
+	CX_DataFrameCell::CX_DataFrameCell(const std::vector<T>& values) :
+		CX_DataFrameCell()
+	{
 		storeVector<T>(values);
 	}
 
@@ -130,30 +149,10 @@ namespace CX {
 	*/
 	template <typename T>
 	T CX_DataFrameCell::to(bool log) const {
-
-		if (_data->size() == 0) {
-			if (log) {
-				CX::Instances::Log.error("CX_DataFrameCell") << "to(): No data to extract from cell.";
-			}
-			return T();
-			//TODO: It may be better to throw an exception here. 
-			//Alternately, The fact that a default value is returned could
-			//suggest that the returned value is stored in the cell, when in fact the cell is empty.
-			//Maybe the default-constructed value should be stored.
+		if (_store) {
+			return _store->to<T>(_row, log);
 		}
-
-		if (log && (_data->size() > 1)) {
-			CX::Instances::Log.warning("CX_DataFrameCell") << "to(): Attempt to extract a scalar when the stored data was a vector. "
-				"Only the first value of the vector will be returned.";
-		}
-
-		std::string typeName = typeid(T).name();
-		if (log && !(*_ignoreStoredType) && (*_type != typeName)) {
-			CX::Instances::Log.warning("CX_DataFrameCell") << "to(): Extracting data of different type than was inserted:" <<
-				" Inserted type was \"" << *_type << "\" and extracted type was \"" << typeName << "\".";
-		}
-
-		return _fromString<T>(_data->at(0));
+		return _value.to<T>(log);
 	}
 
 	/*! Returns a copy of the contents of the cell converted to a vector of the given type. If the type
@@ -164,32 +163,23 @@ namespace CX {
 	*/
 	template <typename T>
 	std::vector<T> CX_DataFrameCell::toVector(bool log) const {
-
-		std::string extractedTypeName = typeid(T).name();
-		if (log && !(*_ignoreStoredType) && (*_type != extractedTypeName)) {
-			CX::Instances::Log.warning("CX_DataFrameCell") << "toVector(): Attempt to extract data of different type than was inserted:" <<
-				" Inserted type was \"" << *_type << "\" and attempted extracted type was \"" << extractedTypeName << "\".";
+		if (_store) {
+			return _store->toVector<T>(_row, log);
 		}
-
-		std::vector<T> values;
-		for (unsigned int i = 0; i < _data->size(); i++) {
-			values.push_back(_fromString<T>((*_data)[i]));
-		}
-		return values;
+		return _value.toVector<T>(log);
 	}
 
-	/*! Stores a vector of data in the cell. The data is stored as a string with each element delimited by a semicolon.
-	If the data to be stored are strings containing semicolons, the data will not be extracted properly.
+	/*! Stores a vector of data in the cell. When the data frame is printed, the elements of the vector
+	are delimited by a semicolon. If the data to be stored are strings containing semicolons, the data
+	will not be read back in properly.
 	\param values A vector of values to store.
 	*/
 	template <typename T>
 	void CX_DataFrameCell::storeVector(std::vector<T> values) {
-		_data->clear();
-		for (unsigned int i = 0; i < values.size(); i++) {
-			_data->push_back(_toString<T>(values[i]));
+		if (!_store) {
+			_moveValueToStore();
 		}
-		this->setStoredType<T>();
-		*_ignoreStoredType = false;
+		_store->storeVector<T>(_row, values);
 	}
 
 	/*! Stores the given value with the given type. This function is a good way to explicitly
@@ -199,36 +189,26 @@ namespace CX {
 	*/
 	template <typename T> 
 	void CX_DataFrameCell::store(const T& value) {
-		_data->clear();
-		_data->push_back(_toString<T>(value));
-
-		this->setStoredType<T>();
-		*_ignoreStoredType = false;
-	}
-
-	/*! \brief Convert from T to string. */
-	template <typename T>
-	static std::string CX_DataFrameCell::_toString(const T& value) {
-		std::ostringstream os;
-		os << std::fixed << std::setprecision(CX_DataFrameCell::getFloatingPointPrecision()) << value;
-		return os.str();
-	}
-
-	/*! \brief Convert from string to T. */
-	template <typename T>
-	static T CX_DataFrameCell::_fromString(const std::string& str) {
-		std::stringstream is;
-		is << str;
-		T val;
-		is >> val;
-		return val;
+		if (!_store) {
+			if (_value.tryStore<T>(value)) {
+				return;
+			}
+			_moveValueToStore();
+		}
+		_store->storeScalar<T>(_row, value);
 	}
 
 	/*! \brief Sets the type of data stored by the cell to T. This doesn't convert the contents, it just sets metadata. */
 	template <typename T> 
 	void CX_DataFrameCell::setStoredType(void) {
-		*_type = typeid(T).name();
-		*_ignoreStoredType = false;
+		const Private::CX_DataFrameColumnStore::Kind kind = Private::CX_DataFrameColumnStore::kindOf<T>();
+		if (!_store) {
+			if (_value.setType(kind, typeid(T).name())) {
+				return;
+			}
+			_moveValueToStore(); //The store can keep the value as a string with the new type.
+		}
+		_store->setRowType(_row, kind, typeid(T).name());
 	}
 
 	template<> std::string CX_DataFrameCell::to(bool log) const;
@@ -0,0 +1,1121 @@
+#include "CX_DataFrameColumnStore.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+#include "CX_DataFrameBinary.h"
+
+namespace CX {
+namespace Private {
+
+unsigned int CX_DataFrameColumnStore::floatingPointPrecision = std::numeric_limits<double>::max_digits10;
+
+CX_DataFrameColumnStore::CX_DataFrameColumnStore(void) :
+	CX_DataFrameColumnStore(0)
+{}
+
+CX_DataFrameColumnStore::CX_DataFrameColumnStore(size_t rows) :
+	_kind(Kind::EMPTY),
+	_rows(rows),
+	_typeName("NULL"),
+	_typeIgnored(true),
+	_presentCount(0),
+	_reservedRows(0),
+	_vectorMode(false)
+{}
+
+/*! Formats a double in the same way as `toString<double>()`, but without constructing a stream. */
+std::string CX_DataFrameColumnStore::formatDouble(double value) {
+	char buffer[128];
+	int length = snprintf(buffer, sizeof(buffer), "%.*f", (int)floatingPointPrecision, value);
+	if (length < 0) {
+		return toString<double>(value);
+	}
+	if ((size_t)length < sizeof(buffer)) {
+		return std::string(buffer, length);
+	}
+
+	//Very large values with many digits do not fit in the buffer.
+	std::string big(length + 1, '\0');
+	snprintf(&big[0], big.size(), "%.*f", (int)floatingPointPrecision, value);
+	big.resize(length);
+	return big;
+}
+
+/*! Estimates the number of bytes allocated for the data of the column from the capacities of its arrays. The characters
+of strings that are stored outside of the string objects are not counted, so that this does not need to look at every row. */
+size_t CX_DataFrameColumnStore::estimateMemoryUse(void) const {
+	return _present.capacity() * sizeof(uint8_t) +
+		_offsets.capacity() * sizeof(size_t) +
+		_int64s.capacity() * sizeof(int64_t) +
+		_uint64s.capacity() * sizeof(uint64_t) +
+		_doubles.capacity() * sizeof(double) +
+		_bools.capacity() * sizeof(uint8_t) +
+		_strings.capacity() * sizeof(std::string) +
+		_generic.capacity() * sizeof(GenericCell);
+}
+
+void CX_DataFrameColumnStore::resize(size_t rows) {
+	if (rows == _rows) {
+		return;
+	}
+
+	switch (_kind) {
+	case Kind::EMPTY: break;
+	case Kind::INT64: _resizeTyped(_int64s, rows); break;
+	case Kind::UINT64: _resizeTyped(_uint64s, rows); break;
+	case Kind::DOUBLE: _resizeTyped(_doubles, rows); break;
+	case Kind::BOOL: _resizeTyped(_bools, rows); break;
+	case Kind::STRING: _resizeTyped(_strings, rows); break;
+	case Kind::GENERIC:
+		for (size_t r = rows; r < _rows; r++) {
+			if (!_generic[r].data.empty()) {
+				_presentCount--;
+			}
+		}
+		_generic.resize(rows);
+		break;
+	}
+
+	_rows = rows;
+}
+
+template <typename V>
+void CX_DataFrameColumnStore::_resizeTyped(std::vector<V>& values, size_t rows) {
+	for (size_t r = rows; r < _rows; r++) {
+		if (elementCount(r) > 0) {
+			_presentCount--;
+		}
+	}
+
+	if (_vectorMode) {
+		if (rows < _rows) {
+			values.resize(_offsets[rows]);
+			_offsets.resize(rows + 1);
+		} else {
+			_offsets.resize(rows + 1, _offsets.back());
+		}
+	} else {
+		values.resize(rows);
+		_present.resize(rows, 0);
+	}
+}
+
+/*! Reserves space for the given number of rows, so that the column can grow to that size without reallocating
+(as long as it holds one value per row). */
+void CX_DataFrameColumnStore::reserve(size_t rows) {
+	_reservedRows = rows;
+
+	switch (_kind) {
+	case Kind::EMPTY: break;
+	case Kind::INT64: _reserveTyped(_int64s); break;
+	case Kind::UINT64: _reserveTyped(_uint64s); break;
+	case Kind::DOUBLE: _reserveTyped(_doubles); break;
+	case Kind::BOOL: _reserveTyped(_bools); break;
+	case Kind::STRING: _reserveTyped(_strings); break;
+	case Kind::GENERIC: _generic.reserve(rows); break;
+	}
+}
+
+template <typename V>
+void CX_DataFrameColumnStore::_reserveTyped(std::vector<V>& values) {
+	values.reserve(_reservedRows);
+	if (_vectorMode) {
+		_offsets.reserve(_reservedRows + 1);
+	} else {
+		_present.reserve(_reservedRows);
+	}
+}
+
+void CX_DataFrameColumnStore::eraseRow(size_t row) {
+	if (row >= _rows) {
+		return;
+	}
+
+	switch (_kind) {
+	case Kind::EMPTY: break;
+	case Kind::INT64: _eraseTyped(_int64s, row); break;
+	case Kind::UINT64: _eraseTyped(_uint64s, row); break;
+	case Kind::DOUBLE: _eraseTyped(_doubles, row); break;
+	case Kind::BOOL: _eraseTyped(_bools, row); break;
+	case Kind::STRING: _eraseTyped(_strings, row); break;
+	case Kind::GENERIC:
+		if (!_generic[row].data.empty()) {
+			_presentCount--;
+		}
+		_generic.erase(_generic.begin() + row);
+		break;
+	}
+
+	_rows--;
+}
+
+template <typename V>
+void CX_DataFrameColumnStore::_eraseTyped(std::vector<V>& values, size_t row) {
+	if (elementCount(row) > 0) {
+		_presentCount--;
+	}
+
+	if (_vectorMode) {
+		size_t start = _offsets[row];
+		size_t count = _offsets[row + 1] - start;
+		values.erase(values.begin() + start, values.begin() + start + count);
+		_offsets.erase(_offsets.begin() + row + 1);
+		for (size_t r = row + 1; r < _offsets.size(); r++) {
+			_offsets[r] -= count;
+		}
+	} else {
+		values.erase(values.begin() + row);
+		_present.erase(_present.begin() + row);
+	}
+}
+
+void CX_DataFrameColumnStore::insertRow(size_t beforeRow) {
+	beforeRow = std::min(beforeRow, _rows);
+
+	switch (_kind) {
+	case Kind::EMPTY: break;
+	case Kind::INT64: _insertTyped(_int64s, beforeRow); break;
+	case Kind::UINT64: _insertTyped(_uint64s, beforeRow); break;
+	case Kind::DOUBLE: _insertTyped(_doubles, beforeRow); break;
+	case Kind::BOOL: _insertTyped(_bools, beforeRow); break;
+	case Kind::STRING: _insertTyped(_strings, beforeRow); break;
+	case Kind::GENERIC: _generic.insert(_generic.begin() + beforeRow, GenericCell()); break;
+	}
+
+	_rows++;
+}
+
+template <typename V>
+void CX_DataFrameColumnStore::_insertTyped(std::vector<V>& values, size_t beforeRow) {
+	if (_vectorMode) {
+		_offsets.insert(_offsets.begin() + beforeRow, _offsets[beforeRow]);
+	} else {
+		values.insert(values.begin() + beforeRow, V());
+		_present.insert(_present.begin() + beforeRow, 0);
+	}
+}
+
+void CX_DataFrameColumnStore::clearRow(size_t row) {
+	switch (_kind) {
+	case Kind::EMPTY: break;
+	case Kind::INT64: _storeTyped(_int64s, row, (const int64_t*)nullptr, 0); break;
+	case Kind::UINT64: _storeTyped(_uint64s, row, (const uint64_t*)nullptr, 0); break;
+	case Kind::DOUBLE: _storeTyped(_doubles, row, (const double*)nullptr, 0); break;
+	case Kind::BOOL: _storeTyped(_bools, row, (const uint8_t*)nullptr, 0); break;
+	case Kind::STRING: _storeTyped(_strings, row, (const std::string*)nullptr, 0); break;
+	case Kind::GENERIC:
+		if (!_generic[row].data.empty()) {
+			_presentCount--;
+		}
+		_generic[row].data.clear();
+		_generic[row].ignoreType = true;
+		break;
+	}
+}
+
+/*! Copies the data and type information from row `srcRow` of `src` into row `dstRow` of this column. */
+void CX_DataFrameColumnStore::copyRowFrom(const CX_DataFrameColumnStore& src, size_t srcRow, size_t dstRow) {
+	if (&src == this && srcRow == dstRow) {
+		return;
+	}
+
+	size_t count = src.elementCount(srcRow);
+
+	if (src._kind == Kind::GENERIC || src._kind == Kind::EMPTY || count == 0) {
+		if (count == 0 && (_kind != Kind::GENERIC || src._kind != Kind::GENERIC)) {
+			clearRow(dstRow);
+			return;
+		}
+		GenericCell cell = src._toGenericCell(srcRow);
+		_prepareGeneric(dstRow);
+		_setGenericCell(dstRow, std::move(cell));
+		return;
+	}
+
+	if (!_prepareTyped(dstRow, src._kind, src._typeName, src._typeIgnored)) {
+		GenericCell cell = src._toGenericCell(srcRow);
+		_prepareGeneric(dstRow);
+		_setGenericCell(dstRow, std::move(cell));
+		return;
+	}
+
+	size_t start = src._elementStart(srcRow);
+	switch (_kind) {
+	case Kind::INT64: _copyTypedRow(_int64s, src._int64s, start, count, dstRow); break;
+	case Kind::UINT64: _copyTypedRow(_uint64s, src._uint64s, start, count, dstRow); break;
+	case Kind::DOUBLE: _copyTypedRow(_doubles, src._doubles, start, count, dstRow); break;
+	case Kind::BOOL: _copyTypedRow(_bools, src._bools, start, count, dstRow); break;
+	case Kind::STRING: _copyTypedRow(_strings, src._strings, start, count, dstRow); break;
+	default: break;
+	}
+}
+
+/*! Stores the data and type information held by `value` into the given row. */
+void CX_DataFrameColumnStore::storeValue(size_t row, const CX_DataFrameValue& value) {
+	switch (value._kind) {
+	case Kind::INT64: _storeValue<Kind::INT64>(row, value._int64, value); break;
+	case Kind::UINT64: _storeValue<Kind::UINT64>(row, value._uint64, value); break;
+	case Kind::DOUBLE: _storeValue<Kind::DOUBLE>(row, value._double, value); break;
+	case Kind::BOOL: _storeValue<Kind::BOOL>(row, value._bool, value); break;
+	case Kind::STRING: _storeValue<Kind::STRING>(row, std::string(value._chars, value._length), value); break;
+	default: clearRow(row); break;
+	}
+}
+
+template <CX_DataFrameColumnStore::Kind K, typename V>
+void CX_DataFrameColumnStore::_storeValue(size_t row, const V& v, const CX_DataFrameValue& value) {
+	if (_prepareTyped(row, K, value._typeName, value._typeIgnored)) {
+		_storeTyped(_values(KindTag<K>()), row, &v, 1);
+	} else {
+		GenericCell cell;
+		cell.data.push_back(value.toString());
+		cell.type = value._typeName;
+		cell.ignoreType = value._typeIgnored;
+		_prepareGeneric(row);
+		_setGenericCell(row, std::move(cell));
+	}
+}
+
+/*! Copies the data and type information from the given row into `value`, if it can be held there.
+\return `false` if the row holds a vector, a long string, or data in the string fallback. `value` is not changed in that case. */
+bool CX_DataFrameColumnStore::loadValue(size_t row, CX_DataFrameValue* value) const {
+	size_t count = elementCount(row);
+	if (count == 0) {
+		value->clear();
+		return true;
+	}
+
+	if (count > 1 || _kind == Kind::GENERIC) {
+		return false;
+	}
+
+	size_t i = _elementStart(row);
+	switch (_kind) {
+	case Kind::INT64: value->_int64 = _int64s[i]; break;
+	case Kind::UINT64: value->_uint64 = _uint64s[i]; break;
+	case Kind::DOUBLE: value->_double = _doubles[i]; break;
+	case Kind::BOOL: value->_bool = _bools[i] != 0; break;
+	case Kind::STRING:
+		if (!value->_assign(_strings[i], KindTag<Kind::STRING>())) {
+			return false;
+		}
+		break;
+	default: return false;
+	}
+
+	value->_kind = _kind;
+	value->_typeName = _typeName;
+	value->_typeIgnored = _typeIgnored;
+	return true;
+}
+
+template <typename V>
+void CX_DataFrameColumnStore::_copyTypedRow(std::vector<V>& values, const std::vector<V>& srcValues, size_t srcStart, size_t count, size_t dstRow) {
+	if (&values == &srcValues) {
+		//Storing into this column can move its values, so copy them out first.
+		std::vector<V> temp(srcValues.begin() + srcStart, srcValues.begin() + srcStart + count);
+		_storeTyped(values, dstRow, temp.begin(), count);
+	} else {
+		_storeTyped(values, dstRow, srcValues.begin() + srcStart, count);
+	}
+}
+
+/*! Makes a new column containing the given rows of this column, in the given order. Rows may be repeated. */
+CX_DataFrameColumnStore CX_DataFrameColumnStore::gather(const std::vector<size_t>& rows) const {
+	CX_DataFrameColumnStore target(rows.size());
+	target._kind = _kind;
+	target._typeName = _typeName;
+	target._typeIgnored = _typeIgnored;
+	target._vectorMode = _vectorMode;
+
+	switch (_kind) {
+	case Kind::EMPTY: break;
+	case Kind::INT64: _gatherTyped(_int64s, target._int64s, rows, target); break;
+	case Kind::UINT64: _gatherTyped(_uint64s, target._uint64s, rows, target); break;
+	case Kind::DOUBLE: _gatherTyped(_doubles, target._doubles, rows, target); break;
+	case Kind::BOOL: _gatherTyped(_bools, target._bools, rows, target); break;
+	case Kind::STRING: _gatherTyped(_strings, target._strings, rows, target); break;
+	case Kind::GENERIC:
+		target._generic.reserve(rows.size());
+		for (size_t r : rows) {
+			target._generic.push_back(_generic[r]);
+			if (!_generic[r].data.empty()) {
+				target._presentCount++;
+			}
+		}
+		break;
+	}
+
+	return target;
+}
+
+/*! Reorders the rows so that row `i` holds what was in row `order[i]`. `order` must be a permutation of the rows.
+Unlike gather(), the values are moved into their new rows rather than copied. */
+void CX_DataFrameColumnStore::permute(const std::vector<size_t>& order) {
+	switch (_kind) {
+	case Kind::EMPTY: break;
+	case Kind::INT64: _permuteTyped(_int64s, order); break;
+	case Kind::UINT64: _permuteTyped(_uint64s, order); break;
+	case Kind::DOUBLE: _permuteTyped(_doubles, order); break;
+	case Kind::BOOL: _permuteTyped(_bools, order); break;
+	case Kind::STRING: _permuteTyped(_strings, order); break;
+	case Kind::GENERIC:
+		{
+			std::vector<GenericCell> permuted;
+			permuted.reserve(_rows);
+			for (size_t r : order) {
+				permuted.push_back(std::move(_generic[r]));
+			}
+			_generic.swap(permuted);
+		}
+		break;
+	}
+}
+
+template <typename V>
+void CX_DataFrameColumnStore::_permuteTyped(std::vector<V>& values, const std::vector<size_t>& order) {
+	std::vector<V> permuted;
+	permuted.reserve(values.size());
+
+	if (_vectorMode) {
+		std::vector<size_t> offsets(_rows + 1);
+		offsets[0] = 0;
+		for (size_t i = 0; i < order.size(); i++) {
+			size_t start = _offsets[order[i]];
+			size_t end = _offsets[order[i] + 1];
+			permuted.insert(permuted.end(), std::make_move_iterator(values.begin() + start), std::make_move_iterator(values.begin() + end));
+			offsets[i + 1] = permuted.size();
+		}
+		_offsets.swap(offsets);
+	} else {
+		std::vector<uint8_t> present(_rows);
+		for (size_t i = 0; i < order.size(); i++) {
+			permuted.push_back(std::move(values[order[i]]));
+			present[i] = _present[order[i]];
+		}
+		_present.swap(present);
+	}
+
+	values.swap(permuted);
+}
+
+/*! Moves the rows of `other` onto the end of this column. `other` is left in an unspecified state. */
+void CX_DataFrameColumnStore::append(CX_DataFrameColumnStore&& other) {
+	if (_rows == 0) {
+		*this = std::move(other);
+		return;
+	}
+
+	if (other._presentCount == 0) {
+		resize(_rows + other._rows);
+		return;
+	}
+
+	bool sameType = (_kind == other._kind) && (_typeIgnored == other._typeIgnored) && sameTypeName(_typeName, other._typeName);
+	if (sameType && _kind != Kind::GENERIC) {
+		switch (_kind) {
+		case Kind::INT64: _appendTyped(_int64s, other, other._int64s); break;
+		case Kind::UINT64: _appendTyped(_uint64s, other, other._uint64s); break;
+		case Kind::DOUBLE: _appendTyped(_doubles, other, other._doubles); break;
+		case Kind::BOOL: _appendTyped(_bools, other, other._bools); break;
+		case Kind::STRING: _appendTyped(_strings, other, other._strings); break;
+		default: break;
+		}
+		_rows += other._rows;
+		_presentCount += other._presentCount;
+		return;
+	}
+
+	size_t start = _rows;
+	resize(_rows + other._rows);
+	for (size_t r = 0; r < other._rows; r++) {
+		if (other.elementCount(r) > 0) {
+			copyRowFrom(other, r, start + r);
+		}
+	}
+}
+
+template <typename V>
+void CX_DataFrameColumnStore::_appendTyped(std::vector<V>& values, CX_DataFrameColumnStore& other, std::vector<V>& otherValues) {
+	if (_vectorMode || other._vectorMode) {
+		if (!_vectorMode) {
+			_enterVectorMode(values);
+		}
+		if (!other._vectorMode) {
+			other._enterVectorMode(otherValues);
+		}
+
+		size_t base = values.size();
+		for (size_t r = 1; r <= other._rows; r++) {
+			_offsets.push_back(base + other._offsets[r]);
+		}
+	} else {
+		_present.insert(_present.end(), other._present.begin(), other._present.end());
+	}
+
+	values.insert(values.end(), std::make_move_iterator(otherValues.begin()), std::make_move_iterator(otherValues.end()));
+}
+
+template <typename V>
+void CX_DataFrameColumnStore::_gatherTyped(const std::vector<V>& values, std::vector<V>& out, const std::vector<size_t>& rows, CX_DataFrameColumnStore& target) const {
+	if (_vectorMode) {
+		target._offsets.resize(rows.size() + 1);
+		target._offsets[0] = 0;
+		for (size_t i = 0; i < rows.size(); i++) {
+			size_t start = _offsets[rows[i]];
+			size_t end = _offsets[rows[i] + 1];
+			out.insert(out.end(), values.begin() + start, values.begin() + end);
+			target._offsets[i + 1] = out.size();
+			if (end > start) {
+				target._presentCount++;
+			}
+		}
+	} else {
+		out.resize(rows.size());
+		target._present.resize(rows.size());
+		for (size_t i = 0; i < rows.size(); i++) {
+			out[i] = values[rows[i]];
+			target._present[i] = _present[rows[i]];
+			target._presentCount += _present[rows[i]];
+		}
+	}
+}
+
+/*! Gives each row a code for the value that it holds, so that rows with equal values have the same code. Codes are given
+in the order in which the values first appear, starting from 0. Empty cells are given a code of their own.
+\param codes Is set to the code for each row.
+\param firstRows Is set to the first row that has each code.
+\return The number of different codes. */
+size_t CX_DataFrameColumnStore::factorize(std::vector<uint32_t>* codes, std::vector<size_t>* firstRows) const {
+	codes->resize(_rows);
+	firstRows->clear();
+
+	if (!_vectorMode) {
+		switch (_kind) {
+		case Kind::INT64: _factorizeTyped(_int64s, codes, firstRows); return firstRows->size();
+		case Kind::UINT64: _factorizeTyped(_uint64s, codes, firstRows); return firstRows->size();
+		case Kind::DOUBLE: _factorizeTyped(_doubles, codes, firstRows); return firstRows->size();
+		case Kind::BOOL: _factorizeTyped(_bools, codes, firstRows); return firstRows->size();
+		default: break;
+		}
+	}
+
+	//Other columns are compared by their elements as strings, which is how they would be printed.
+	std::unordered_map<std::string, uint32_t> levels;
+	uint32_t emptyCode = std::numeric_limits<uint32_t>::max();
+	std::string key;
+	for (size_t r = 0; r < _rows; r++) {
+		size_t count = elementCount(r);
+		if (count == 0) {
+			if (emptyCode == std::numeric_limits<uint32_t>::max()) {
+				emptyCode = (uint32_t)firstRows->size();
+				firstRows->push_back(r);
+			}
+			(*codes)[r] = emptyCode;
+			continue;
+		}
+
+		if (_kind == Kind::STRING && !_vectorMode) {
+			key = _strings[r];
+		} else {
+			key.clear();
+			for (size_t i = 0; i < count; i++) {
+				key += elementToString(r, i);
+				key += '\0';
+			}
+		}
+
+		auto it = levels.find(key);
+		if (it == levels.end()) {
+			it = levels.insert(std::make_pair(key, (uint32_t)firstRows->size())).first;
+			firstRows->push_back(r);
+		}
+		(*codes)[r] = it->second;
+	}
+	return firstRows->size();
+}
+
+template <typename V>
+void CX_DataFrameColumnStore::_factorizeTyped(const std::vector<V>& values, std::vector<uint32_t>* codes, std::vector<size_t>* firstRows) const {
+	std::unordered_map<uint64_t, uint32_t> levels;
+	uint32_t emptyCode = std::numeric_limits<uint32_t>::max();
+	for (size_t r = 0; r < _rows; r++) {
+		if (!_present[r]) {
+			if (emptyCode == std::numeric_limits<uint32_t>::max()) {
+				emptyCode = (uint32_t)firstRows->size();
+				firstRows->push_back(r);
+			}
+			(*codes)[r] = emptyCode;
+			continue;
+		}
+
+		auto it = levels.find(_keyBits(values[r]));
+		if (it == levels.end()) {
+			it = levels.insert(std::make_pair(_keyBits(values[r]), (uint32_t)firstRows->size())).first;
+			firstRows->push_back(r);
+		}
+		(*codes)[r] = it->second;
+	}
+}
+
+uint64_t CX_DataFrameColumnStore::_keyBits(double value) {
+	if (value == 0) {
+		value = 0; //-0 and 0 are the same value.
+	}
+	uint64_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+/*! Returns the number of elements stored in the given row: 0 if the cell is empty, 1 for a scalar, and the length
+of the vector otherwise. */
+size_t CX_DataFrameColumnStore::elementCount(size_t row) const {
+	switch (_kind) {
+	case Kind::EMPTY:
+		return 0;
+	case Kind::GENERIC:
+		return _generic[row].data.size();
+	default:
+		return _vectorMode ? (_offsets[row + 1] - _offsets[row]) : _present[row];
+	}
+}
+
+/*! Returns `true` if any row contains more than one element. */
+bool CX_DataFrameColumnStore::containsVectors(void) const {
+	if (_kind == Kind::EMPTY || (_kind != Kind::GENERIC && !_vectorMode)) {
+		return false;
+	}
+
+	for (size_t r = 0; r < _rows; r++) {
+		if (elementCount(r) > 1) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*! Returns the given element of the given row converted to a string, in the same way that CX_DataFrameCell has
+always converted data to strings. */
+std::string CX_DataFrameColumnStore::elementToString(size_t row, size_t element) const {
+	size_t i = _elementStart(row) + element;
+	switch (_kind) {
+	case Kind::INT64: return std::to_string(_int64s[i]);
+	case Kind::UINT64: return std::to_string(_uint64s[i]);
+	case Kind::DOUBLE: return formatDouble(_doubles[i]);
+	case Kind::BOOL: return _bools[i] ? "1" : "0";
+	case Kind::STRING: return _strings[i];
+	case Kind::GENERIC: return _generic[row].data[element];
+	default: return std::string();
+	}
+}
+
+/*! Returns all of the elements of the given row converted to strings. */
+std::vector<std::string> CX_DataFrameColumnStore::rowToStrings(size_t row) const {
+	if (_kind == Kind::GENERIC) {
+		return _generic[row].data;
+	}
+
+	size_t count = elementCount(row);
+	std::vector<std::string> rval(count);
+	for (size_t i = 0; i < count; i++) {
+		rval[i] = elementToString(row, i);
+	}
+	return rval;
+}
+
+/*! Appends the contents of the given row to `out` in the way they are printed by CX_DataFrame::print(): Vectors are
+surrounded by `vectorEncloser` and their elements are separated by `vectorElementDelimiter`. Empty rows append nothing. */
+void CX_DataFrameColumnStore::appendText(size_t row, const std::string& vectorEncloser, const std::string& vectorElementDelimiter, std::string* out) const {
+	size_t count = elementCount(row);
+	if (count == 1) {
+		out->append(elementToString(row, 0));
+		return;
+	}
+
+	if (count > 1) {
+		out->append(vectorEncloser);
+		for (size_t i = 0; i < count; i++) {
+			if (i > 0) {
+				out->append(vectorElementDelimiter);
+			}
+			out->append(elementToString(row, i));
+		}
+		out->append(vectorEncloser);
+	}
+}
+
+/*! Returns the name of the type (from `typeid(T).name()`) that was stored in the given row. */
+const char* CX_DataFrameColumnStore::getRowType(size_t row) const {
+	if (_kind == Kind::GENERIC) {
+		return _generic[row].type;
+	}
+	return _typeName;
+}
+
+/*! Returns `true` if the type of the data in the given row is unknown, either because the row is empty
+or because the type was deleted. */
+bool CX_DataFrameColumnStore::isRowTypeIgnored(size_t row) const {
+	if (_kind == Kind::GENERIC) {
+		return _generic[row].ignoreType;
+	}
+	return _typeIgnored || elementCount(row) == 0;
+}
+
+/*! Sets the type information for the given row without changing its data. If the column has no data, it is given the
+storage kind `kind` of the type, so that values of the type that are stored later are stored directly. If the row has data of
+a different kind, or other rows have a different type, the column falls back to strings so that the data is kept as it is.
+\param row The row.
+\param kind The storage kind of the type (see kindOf()).
+\param typeName The name of the type. */
+void CX_DataFrameColumnStore::setRowType(size_t row, Kind kind, const char* typeName) {
+	if (_kind != Kind::GENERIC) {
+		if (_kind == kind && sameTypeName(_typeName, typeName) && !_typeIgnored) {
+			return;
+		}
+
+		if (!_othersPresent(row)) {
+			if (elementCount(row) == 0 && _kind != kind) {
+				if (kind == Kind::GENERIC) {
+					_reset(Kind::GENERIC, "NULL", true);
+				} else {
+					_reset(kind, typeName, false);
+					return;
+				}
+			} else if (_kind == kind) {
+				_typeName = typeName;
+				_typeIgnored = false;
+				return;
+			}
+		}
+		_convertToGeneric();
+	}
+
+	_generic[row].type = typeName;
+	_generic[row].ignoreType = false;
+}
+
+/*! Marks the type of the data in the given row as unknown. */
+void CX_DataFrameColumnStore::ignoreRowType(size_t row) {
+	if (_kind != Kind::GENERIC) {
+		if (_typeIgnored || elementCount(row) == 0) {
+			return;
+		}
+		if (!_othersPresent(row)) {
+			_typeIgnored = true;
+			return;
+		}
+		_convertToGeneric();
+	}
+
+	_generic[row].ignoreType = true;
+}
+
+/*! Stores strings of unknown type, such as data that was read from a file. */
+void CX_DataFrameColumnStore::storeUntypedStrings(size_t row, const std::vector<std::string>& values) {
+	if (_prepareTyped(row, Kind::STRING, typeid(std::string).name(), true)) {
+		_storeTyped(_strings, row, values.begin(), values.size());
+	} else {
+		GenericCell cell;
+		cell.data = values;
+		cell.type = typeid(std::string).name();
+		cell.ignoreType = true;
+		_prepareGeneric(row);
+		_setGenericCell(row, std::move(cell));
+	}
+}
+
+/*! Stores a single string of unknown type. This is equivalent to `storeUntypedStrings()` with one string,
+but does not require the string to be copied into a vector first. */
+void CX_DataFrameColumnStore::storeUntypedString(size_t row, const char* data, size_t length) {
+	if (!_prepareTyped(row, Kind::STRING, typeid(std::string).name(), true) || _vectorMode) {
+		storeUntypedStrings(row, std::vector<std::string>(1, std::string(data, length)));
+		return;
+	}
+
+	_strings[row].assign(data, length);
+	if (!_present[row]) {
+		_present[row] = 1;
+		_presentCount++;
+	}
+}
+
+bool CX_DataFrameColumnStore::_othersPresent(size_t row) const {
+	return _presentCount > ((elementCount(row) > 0) ? 1 : 0);
+}
+
+//Makes the column ready to store data of the given kind and type into `row`. Returns `false` if the
+//column has fallen back (or has just been converted) to the string representation.
+bool CX_DataFrameColumnStore::_prepareTyped(size_t row, Kind kind, const char* typeName, bool typeIgnored) {
+	if (_kind == kind && _typeIgnored == typeIgnored && sameTypeName(_typeName, typeName)) {
+		return true;
+	}
+
+	if (!_othersPresent(row)) {
+		_reset(kind, typeName, typeIgnored);
+		return true;
+	}
+
+	if (_kind != Kind::GENERIC) {
+		_convertToGeneric();
+	}
+	return false;
+}
+
+void CX_DataFrameColumnStore::_prepareGeneric(size_t row) {
+	if (_kind == Kind::GENERIC) {
+		return;
+	}
+
+	if (!_othersPresent(row)) {
+		_reset(Kind::GENERIC, "NULL", true);
+	} else {
+		_convertToGeneric();
+	}
+}
+
+void CX_DataFrameColumnStore::_reset(Kind kind, const char* typeName, bool typeIgnored) {
+	_kind = kind;
+	_typeName = typeName;
+	_typeIgnored = typeIgnored;
+	_presentCount = 0;
+	_vectorMode = false;
+
+	_offsets.clear();
+	_int64s.clear();
+	_uint64s.clear();
+	_doubles.clear();
+	_bools.clear();
+	_strings.clear();
+	_generic.clear();
+	_present.clear();
+
+	if (_kind != Kind::EMPTY && _kind != Kind::GENERIC) {
+		_present.assign(_rows, 0);
+	}
+
+	switch (_kind) {
+	case Kind::EMPTY: break;
+	case Kind::INT64: _reserveTyped(_int64s); _int64s.resize(_rows); break;
+	case Kind::UINT64: _reserveTyped(_uint64s); _uint64s.resize(_rows); break;
+	case Kind::DOUBLE: _reserveTyped(_doubles); _doubles.resize(_rows); break;
+	case Kind::BOOL: _reserveTyped(_bools); _bools.resize(_rows); break;
+	case Kind::STRING: _reserveTyped(_strings); _strings.resize(_rows); break;
+	case Kind::GENERIC: _generic.reserve(_reservedRows); _generic.resize(_rows); break;
+	}
+}
+
+void CX_DataFrameColumnStore::_convertToGeneric(void) {
+	if (_kind == Kind::GENERIC) {
+		return;
+	}
+
+	std::vector<GenericCell> cells(_rows);
+	for (size_t r = 0; r < _rows; r++) {
+		cells[r] = _toGenericCell(r);
+	}
+
+	size_t presentCount = _presentCount;
+	_reset(Kind::GENERIC, "NULL", true);
+	_generic.swap(cells);
+	_presentCount = presentCount;
+}
+
+CX_DataFrameColumnStore::GenericCell CX_DataFrameColumnStore::_toGenericCell(size_t row) const {
+	if (_kind == Kind::GENERIC) {
+		return _generic[row];
+	}
+
+	GenericCell cell;
+	cell.data = rowToStrings(row);
+	if (_kind != Kind::EMPTY) {
+		cell.type = _typeName;
+	}
+	cell.ignoreType = isRowTypeIgnored(row);
+	return cell;
+}
+
+void CX_DataFrameColumnStore::_setGenericCell(size_t row, GenericCell cell) {
+	bool wasPresent = !_generic[row].data.empty();
+	bool isPresent = !cell.data.empty();
+
+	_generic[row] = std::move(cell);
+
+	if (isPresent && !wasPresent) {
+		_presentCount++;
+	} else if (!isPresent && wasPresent) {
+		_presentCount--;
+	}
+}
+
+
+
+/*! Returns a pointer to a copy of the type name that lasts for the rest of the program, so that type names
+read from files can be held in the same way as the names from `typeid(T).name()`. */
+const char* CX_DataFrameColumnStore::internTypeName(const std::string& typeName) {
+	static std::mutex mutex;
+	static std::set<std::string> names;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	return names.insert(typeName).first->c_str();
+}
+
+/*! Writes the description of the column to `schema` and the data of the column to `data`, in the format
+described in CX_DataFrame::writeBinary(). */
+void CX_DataFrameColumnStore::writeBinary(CX_BinaryWriter& schema, CX_BinaryWriter& data) const {
+	schema.putU8((uint8_t)_kind);
+	schema.putU8(_vectorMode ? 1 : 0);
+	schema.putU8(_typeIgnored ? 1 : 0);
+	schema.putU8(0);
+	schema.putString(_typeName);
+
+	data.align(8);
+	size_t start = data.size();
+
+	switch (_kind) {
+	case Kind::EMPTY: break;
+	case Kind::INT64: _writeTyped(data, _int64s); break;
+	case Kind::UINT64: _writeTyped(data, _uint64s); break;
+	case Kind::DOUBLE: _writeTyped(data, _doubles); break;
+	case Kind::BOOL: _writeTyped(data, _bools); break;
+	case Kind::STRING: _writeTyped(data, _strings); break;
+	case Kind::GENERIC:
+		for (const GenericCell& cell : _generic) {
+			data.putString(cell.type);
+			data.putU8(cell.ignoreType ? 1 : 0);
+			data.putU64(cell.data.size());
+			for (const std::string& str : cell.data) {
+				data.putString(str);
+			}
+		}
+		break;
+	}
+
+	schema.putU64(start);
+	schema.putU64(data.size() - start);
+}
+
+/*! Replaces the contents of the column with a column that was written with writeBinary().
+\param schema The reader for the schema, positioned at the description of this column.
+\param data The reader for the data section of the file.
+\param rows The number of rows in the column.
+\return `false` if the column could not be read because the file was truncated or corrupt, in which case
+the column is left empty. */
+bool CX_DataFrameColumnStore::readBinary(CX_BinaryReader& schema, CX_BinaryReader& data, size_t rows) {
+	uint8_t kind = schema.getU8();
+	bool vectorMode = schema.getU8() != 0;
+	bool typeIgnored = schema.getU8() != 0;
+	schema.getU8();
+	std::string typeName = schema.getString();
+	uint64_t offset = schema.getU64();
+	uint64_t size = schema.getU64();
+
+	*this = CX_DataFrameColumnStore(rows);
+
+	if (schema.failed() || kind > (uint8_t)Kind::GENERIC || !data.seek((size_t)offset)) {
+		return false;
+	}
+
+	_reset((Kind)kind, internTypeName(typeName), typeIgnored);
+
+	bool success = true;
+	switch (_kind) {
+	case Kind::EMPTY: break;
+	case Kind::INT64: success = _readTyped(data, _int64s, vectorMode); break;
+	case Kind::UINT64: success = _readTyped(data, _uint64s, vectorMode); break;
+	case Kind::DOUBLE: success = _readTyped(data, _doubles, vectorMode); break;
+	case Kind::BOOL: success = _readTyped(data, _bools, vectorMode); break;
+	case Kind::STRING: success = _readTyped(data, _strings, vectorMode); break;
+	case Kind::GENERIC:
+		for (GenericCell& cell : _generic) {
+			cell.type = internTypeName(data.getString());
+			cell.ignoreType = data.getU8() != 0;
+
+			uint64_t count = data.getU64();
+			if (count > data.remaining() / sizeof(uint32_t)) {
+				success = false;
+				break;
+			}
+			cell.data.resize((size_t)count);
+			for (std::string& str : cell.data) {
+				str = data.getString();
+			}
+
+			if (!cell.data.empty()) {
+				_presentCount++;
+			}
+		}
+		break;
+	}
+
+	if (!success || data.failed() || data.position() - offset != size) {
+		*this = CX_DataFrameColumnStore(rows);
+		return false;
+	}
+	return true;
+}
+
+template <typename V>
+void CX_DataFrameColumnStore::_writeTyped(CX_BinaryWriter& data, const std::vector<V>& values) const {
+	if (_vectorMode) {
+		data.putU64Array(_offsets.data(), _offsets.size());
+	} else {
+		data.putBytes(_present.data(), _present.size());
+		data.align(8);
+	}
+	_writeValues(data, values);
+}
+
+template <typename V>
+bool CX_DataFrameColumnStore::_readTyped(CX_BinaryReader& data, std::vector<V>& values, bool vectorMode) {
+	if (vectorMode) {
+		_vectorMode = true;
+		_present.clear();
+		if (!data.getU64Array(&_offsets, _rows + 1) || _offsets[0] != 0) {
+			return false;
+		}
+		for (size_t r = 0; r < _rows; r++) {
+			if (_offsets[r + 1] < _offsets[r]) {
+				return false;
+			}
+			if (_offsets[r + 1] > _offsets[r]) {
+				_presentCount++;
+			}
+		}
+		return _readValues(data, &values, _offsets[_rows]);
+	}
+
+	if (!data.getByteArray(&_present, _rows) || !data.align(8)) {
+		return false;
+	}
+	for (uint8_t& present : _present) {
+		present = (present != 0) ? 1 : 0;
+		_presentCount += present;
+	}
+	return _readValues(data, &values, _rows);
+}
+
+void CX_DataFrameColumnStore::_writeValues(CX_BinaryWriter& data, const std::vector<int64_t>& values) {
+	data.putU64Array(values.data(), values.size());
+}
+
+void CX_DataFrameColumnStore::_writeValues(CX_BinaryWriter& data, const std::vector<uint64_t>& values) {
+	data.putU64Array(values.data(), values.size());
+}
+
+void CX_DataFrameColumnStore::_writeValues(CX_BinaryWriter& data, const std::vector<double>& values) {
+	data.putDoubleArray(values.data(), values.size());
+}
+
+void CX_DataFrameColumnStore::_writeValues(CX_BinaryWriter& data, const std::vector<uint8_t>& values) {
+	data.putBytes(values.data(), values.size());
+}
+
+//Strings are written as an array of their lengths followed by all of their characters.
+void CX_DataFrameColumnStore::_writeValues(CX_BinaryWriter& data, const std::vector<std::string>& values) {
+	for (const std::string& str : values) {
+		data.putU64(str.size());
+	}
+	for (const std::string& str : values) {
+		data.putBytes(str.data(), str.size());
+	}
+}
+
+bool CX_DataFrameColumnStore::_readValues(CX_BinaryReader& data, std::vector<int64_t>* values, size_t count) {
+	return data.getU64Array(values, count);
+}
+
+bool CX_DataFrameColumnStore::_readValues(CX_BinaryReader& data, std::vector<uint64_t>* values, size_t count) {
+	return data.getU64Array(values, count);
+}
+
+bool CX_DataFrameColumnStore::_readValues(CX_BinaryReader& data, std::vector<double>* values, size_t count) {
+	return data.getDoubleArray(values, count);
+}
+
+bool CX_DataFrameColumnStore::_readValues(CX_BinaryReader& data, std::vector<uint8_t>* values, size_t count) {
+	return data.getByteArray(values, count);
+}
+
+bool CX_DataFrameColumnStore::_readValues(CX_BinaryReader& data, std::vector<std::string>* values, size_t count) {
+	std::vector<uint64_t> lengths;
+	if (!data.getU64Array(&lengths, count)) {
+		return false;
+	}
+
+	values->resize(count);
+	for (size_t i = 0; i < count; i++) {
+		const char* chars = (lengths[i] <= data.remaining()) ? data.getBytes((size_t)lengths[i]) : nullptr;
+		if (chars == nullptr) {
+			return false;
+		}
+		(*values)[i].assign(chars, (size_t)lengths[i]);
+	}
+	return true;
+}
+
+
+///////////////////////
+// CX_DataFrameValue //
+///////////////////////
+
+CX_DataFrameValue::CX_DataFrameValue(void) :
+	_kind(Kind::EMPTY),
+	_typeName("NULL"),
+	_typeIgnored(true),
+	_length(0),
+	_int64(0)
+{}
+
+/*! Deletes the stored value. */
+void CX_DataFrameValue::clear(void) {
+	_kind = Kind::EMPTY;
+	_typeName = "NULL";
+	_typeIgnored = true;
+	_length = 0;
+}
+
+/*! Returns the stored value converted to a string in the same way as CX_DataFrameColumnStore::elementToString(). */
+std::string CX_DataFrameValue::toString(void) const {
+	switch (_kind) {
+	case Kind::INT64: return std::to_string(_int64);
+	case Kind::UINT64: return std::to_string(_uint64);
+	case Kind::DOUBLE: return CX_DataFrameColumnStore::formatDouble(_double);
+	case Kind::BOOL: return _bool ? "1" : "0";
+	case Kind::STRING: return std::string(_chars, _length);
+	default: return std::string();
+	}
+}
+
+/*! Sets the type information without changing the stored value. If the value is empty, it takes the storage kind of the type.
+\return `false`, without changing anything, if a value of a different storage kind is held, which this class has no way to
+hold with the new type. */
+bool CX_DataFrameValue::setType(Kind kind, const char* typeName) {
+	if (_kind != Kind::EMPTY && _kind != kind) {
+		return false;
+	}
+	_typeName = typeName;
+	_typeIgnored = false;
+	return true;
+}
+
+/*! Marks the type of the stored value as unknown. */
+void CX_DataFrameValue::ignoreType(void) {
+	_typeIgnored = true;
+}
+
+bool CX_DataFrameValue::_assign(const std::string& value, KindTag<Kind::STRING>) {
+	if (value.size() > shortStringCapacity) {
+		return false;
+	}
+	std::memcpy(_chars, value.data(), value.size());
+	_length = static_cast<unsigned char>(value.size());
+	return true;
+}
+
+} //namespace Private
+} //namespace CX
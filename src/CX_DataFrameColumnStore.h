@@ -0,0 +1,570 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <typeinfo>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include "CX_Logger.h"
+
+namespace CX {
+namespace Private {
+
+	class CX_DataFrameValue;
+	class CX_BinaryWriter;
+	class CX_BinaryReader;
+
+	/*! This class stores the data for one column of a CX_DataFrame. It is also used to hold the data for a CX_DataFrameCell
+	that is not part of a data frame when that data does not fit in a CX_DataFrameValue, in which case it has one row.
+
+	Each column holds its values in a contiguous array of the type that the first stored value had: int64, uint64, double,
+	bool, or std::string. If a cell of the column holds a vector of more than one value, an array of offsets into the value
+	array is used to find the elements for each row. Storing a value of a different type into a column that already has
+	data in other rows, or storing a type that is not one of those types (e.g. a user-defined type with stream operators),
+	causes the column to fall back on storing each cell as strings along with its own type information, which is how all
+	data frame cells used to be stored. The fallback is never undone while the column has data in it.
+
+	This class is used internally by CX_DataFrame and CX_DataFrameCell and should not be used directly.
+	*/
+	class CX_DataFrameColumnStore {
+	public:
+
+		enum class Kind {
+			EMPTY,
+			INT64,
+			UINT64,
+			DOUBLE,
+			BOOL,
+			STRING,
+			GENERIC
+		};
+
+		/*! The storage kind that is used for values of type T. Types that do not have a natural typed array
+		(including character types, which are printed as characters, not numbers) use GENERIC. */
+		template <typename T>
+		static constexpr Kind kindOf(void) {
+			return std::is_same<T, bool>::value ? Kind::BOOL :
+				std::is_same<T, std::string>::value ? Kind::STRING :
+				(std::is_floating_point<T>::value && sizeof(T) <= sizeof(double)) ? Kind::DOUBLE :
+				(std::is_integral<T>::value && sizeof(T) > 1 && sizeof(T) <= 8 && !std::is_same<T, wchar_t>::value &&
+					!std::is_same<T, char16_t>::value && !std::is_same<T, char32_t>::value) ?
+						(std::is_signed<T>::value ? Kind::INT64 : Kind::UINT64) :
+				Kind::GENERIC;
+		}
+
+		template <Kind K> using KindTag = std::integral_constant<Kind, K>;
+
+		/*! Compares type names from `typeid(T).name()`. The names have static storage duration, so they are held as
+		pointers rather than copied into strings. */
+		static bool sameTypeName(const char* a, const char* b) {
+			return (a == b) || (std::strcmp(a, b) == 0);
+		}
+
+		CX_DataFrameColumnStore(void);
+		explicit CX_DataFrameColumnStore(size_t rows);
+
+		size_t rowCount(void) const { return _rows; };
+		Kind getKind(void) const { return _kind; };
+		bool isVectorMode(void) const { return _vectorMode; };
+
+		void resize(size_t rows);
+		void reserve(size_t rows);
+		void eraseRow(size_t row);
+		void insertRow(size_t beforeRow);
+		void clearRow(size_t row);
+
+		void copyRowFrom(const CX_DataFrameColumnStore& src, size_t srcRow, size_t dstRow);
+		void storeValue(size_t row, const CX_DataFrameValue& value);
+		bool loadValue(size_t row, CX_DataFrameValue* value) const;
+		CX_DataFrameColumnStore gather(const std::vector<size_t>& rows) const;
+		void permute(const std::vector<size_t>& order);
+		void append(CX_DataFrameColumnStore&& other);
+
+		size_t elementCount(size_t row) const;
+		bool containsVectors(void) const;
+
+		size_t estimateMemoryUse(void) const;
+
+		size_t factorize(std::vector<uint32_t>* codes, std::vector<size_t>* firstRows) const;
+		template <typename F> void forEachNumber(F f) const;
+
+		std::string elementToString(size_t row, size_t element) const;
+		std::vector<std::string> rowToStrings(size_t row) const;
+		void appendText(size_t row, const std::string& vectorEncloser, const std::string& vectorElementDelimiter, std::string* out) const;
+
+		const char* getRowType(size_t row) const;
+		bool isRowTypeIgnored(size_t row) const;
+		void setRowType(size_t row, Kind kind, const char* typeName);
+		void ignoreRowType(size_t row);
+
+		void storeUntypedStrings(size_t row, const std::vector<std::string>& values);
+		void storeUntypedString(size_t row, const char* data, size_t length);
+
+		void writeBinary(CX_BinaryWriter& schema, CX_BinaryWriter& data) const;
+		bool readBinary(CX_BinaryReader& schema, CX_BinaryReader& data, size_t rows);
+
+		template <typename T> void storeScalar(size_t row, const T& value);
+		template <typename T> void storeVector(size_t row, const std::vector<T>& values);
+
+		template <typename T> T to(size_t row, bool log) const;
+		template <typename T> std::vector<T> toVector(size_t row, bool log) const;
+
+		static unsigned int floatingPointPrecision;
+
+		static std::string formatDouble(double value);
+		static const char* internTypeName(const std::string& typeName);
+
+		template <typename T> static std::string toString(const T& value);
+		template <typename T> static T fromString(const std::string& str);
+
+	private:
+
+		//Cells in the string fallback store their data just as CX_DataFrameCell formerly did.
+		struct GenericCell {
+			GenericCell(void) :
+				type("NULL"),
+				ignoreType(true)
+			{}
+
+			std::vector<std::string> data;
+			const char* type;
+			bool ignoreType;
+		};
+
+		Kind _kind;
+		size_t _rows;
+
+		//The type information shared by all rows of a typed column.
+		const char* _typeName;
+		bool _typeIgnored;
+
+		size_t _presentCount; //The number of rows that have at least one element.
+		size_t _reservedRows; //Capacity to reserve in the arrays when the column is reset.
+
+		//In scalar mode, each row has one slot in the value array and _present says if it is filled.
+		//In vector mode, the elements for row r are in [_offsets[r], _offsets[r + 1]).
+		bool _vectorMode;
+		std::vector<uint8_t> _present;
+		std::vector<size_t> _offsets;
+
+		std::vector<int64_t> _int64s;
+		std::vector<uint64_t> _uint64s;
+		std::vector<double> _doubles;
+		std::vector<uint8_t> _bools;
+		std::vector<std::string> _strings;
+
+		std::vector<GenericCell> _generic;
+
+		std::vector<int64_t>& _values(KindTag<Kind::INT64>) { return _int64s; };
+		std::vector<uint64_t>& _values(KindTag<Kind::UINT64>) { return _uint64s; };
+		std::vector<double>& _values(KindTag<Kind::DOUBLE>) { return _doubles; };
+		std::vector<uint8_t>& _values(KindTag<Kind::BOOL>) { return _bools; };
+		std::vector<std::string>& _values(KindTag<Kind::STRING>) { return _strings; };
+
+		const std::vector<int64_t>& _values(KindTag<Kind::INT64>) const { return _int64s; };
+		const std::vector<uint64_t>& _values(KindTag<Kind::UINT64>) const { return _uint64s; };
+		const std::vector<double>& _values(KindTag<Kind::DOUBLE>) const { return _doubles; };
+		const std::vector<uint8_t>& _values(KindTag<Kind::BOOL>) const { return _bools; };
+		const std::vector<std::string>& _values(KindTag<Kind::STRING>) const { return _strings; };
+
+		size_t _elementStart(size_t row) const { return _vectorMode ? _offsets[row] : row; };
+
+		bool _othersPresent(size_t row) const;
+		bool _prepareTyped(size_t row, Kind kind, const char* typeName, bool typeIgnored);
+		void _prepareGeneric(size_t row);
+		void _reset(Kind kind, const char* typeName, bool typeIgnored);
+		void _convertToGeneric(void);
+		GenericCell _toGenericCell(size_t row) const;
+		void _setGenericCell(size_t row, GenericCell cell);
+
+		template <typename V> void _enterVectorMode(std::vector<V>& values);
+		template <typename V, typename It> void _storeTyped(std::vector<V>& values, size_t row, It begin, size_t count);
+
+		template <Kind K, typename V> void _storeValue(size_t row, const V& v, const CX_DataFrameValue& value);
+
+		template <typename T, typename It, Kind K> void _store(size_t row, It begin, size_t count, KindTag<K> tag);
+		template <typename T, typename It> void _store(size_t row, It begin, size_t count, KindTag<Kind::GENERIC>);
+
+		template <typename T, Kind K> T _elementAs(size_t row, size_t element, KindTag<K> tag) const;
+		template <typename T> T _elementAs(size_t row, size_t element, KindTag<Kind::GENERIC>) const;
+
+		template <typename V> void _copyTypedRow(std::vector<V>& values, const std::vector<V>& srcValues, size_t srcStart, size_t count, size_t dstRow);
+		template <typename V> void _factorizeTyped(const std::vector<V>& values, std::vector<uint32_t>* codes, std::vector<size_t>* firstRows) const;
+		template <typename V, typename F> void _forEachTyped(const std::vector<V>& values, F& f) const;
+
+		static uint64_t _keyBits(int64_t value) { return static_cast<uint64_t>(value); };
+		static uint64_t _keyBits(uint64_t value) { return value; };
+		static uint64_t _keyBits(uint8_t value) { return value; };
+		static uint64_t _keyBits(double value);
+
+		template <typename V> void _permuteTyped(std::vector<V>& values, const std::vector<size_t>& order);
+		template <typename V> void _gatherTyped(const std::vector<V>& values, std::vector<V>& out, const std::vector<size_t>& rows, CX_DataFrameColumnStore& target) const;
+		template <typename V> void _resizeTyped(std::vector<V>& values, size_t rows);
+		template <typename V> void _eraseTyped(std::vector<V>& values, size_t row);
+		template <typename V> void _insertTyped(std::vector<V>& values, size_t beforeRow);
+		template <typename V> void _reserveTyped(std::vector<V>& values);
+		template <typename V> void _appendTyped(std::vector<V>& values, CX_DataFrameColumnStore& other, std::vector<V>& otherValues);
+
+		template <typename V> void _writeTyped(CX_BinaryWriter& data, const std::vector<V>& values) const;
+		template <typename V> bool _readTyped(CX_BinaryReader& data, std::vector<V>& values, bool vectorMode);
+
+		static void _writeValues(CX_BinaryWriter& data, const std::vector<int64_t>& values);
+		static void _writeValues(CX_BinaryWriter& data, const std::vector<uint64_t>& values);
+		static void _writeValues(CX_BinaryWriter& data, const std::vector<double>& values);
+		static void _writeValues(CX_BinaryWriter& data, const std::vector<uint8_t>& values);
+		static void _writeValues(CX_BinaryWriter& data, const std::vector<std::string>& values);
+
+		static bool _readValues(CX_BinaryReader& data, std::vector<int64_t>* values, size_t count);
+		static bool _readValues(CX_BinaryReader& data, std::vector<uint64_t>* values, size_t count);
+		static bool _readValues(CX_BinaryReader& data, std::vector<double>* values, size_t count);
+		static bool _readValues(CX_BinaryReader& data, std::vector<uint8_t>* values, size_t count);
+		static bool _readValues(CX_BinaryReader& data, std::vector<std::string>* values, size_t count);
+
+	};
+
+	/*! \brief Convert from T to string. */
+	template <typename T>
+	std::string CX_DataFrameColumnStore::toString(const T& value) {
+		std::ostringstream os;
+		os << std::fixed << std::setprecision(floatingPointPrecision) << value;
+		return os.str();
+	}
+
+	/*! \brief Convert from string to T. */
+	template <typename T>
+	T CX_DataFrameColumnStore::fromString(const std::string& str) {
+		std::stringstream is;
+		is << str;
+		T val;
+		is >> val;
+		return val;
+	}
+
+	template <typename T>
+	void CX_DataFrameColumnStore::storeScalar(size_t row, const T& value) {
+		_store<T>(row, &value, 1, KindTag<kindOf<T>()>());
+	}
+
+	template <typename T>
+	void CX_DataFrameColumnStore::storeVector(size_t row, const std::vector<T>& values) {
+		//An empty vector has no values, so it must not change the kind of a typed column or convert the column to strings.
+		if (values.empty() && _kind != Kind::EMPTY && _kind != Kind::GENERIC) {
+			clearRow(row);
+			return;
+		}
+		_store<T>(row, values.begin(), values.size(), KindTag<kindOf<T>()>());
+	}
+
+	template <typename T, typename It, CX_DataFrameColumnStore::Kind K>
+	void CX_DataFrameColumnStore::_store(size_t row, It begin, size_t count, KindTag<K> tag) {
+		if (_prepareTyped(row, K, typeid(T).name(), false)) {
+			_storeTyped(_values(tag), row, begin, count);
+		} else {
+			_store<T>(row, begin, count, KindTag<Kind::GENERIC>());
+		}
+	}
+
+	template <typename T, typename It>
+	void CX_DataFrameColumnStore::_store(size_t row, It begin, size_t count, KindTag<Kind::GENERIC>) {
+		GenericCell cell;
+		cell.data.reserve(count);
+		for (size_t i = 0; i < count; i++, ++begin) {
+			cell.data.push_back(toString<T>(*begin));
+		}
+		cell.type = typeid(T).name();
+		cell.ignoreType = false;
+
+		_prepareGeneric(row);
+		_setGenericCell(row, std::move(cell));
+	}
+
+	template <typename V, typename It>
+	void CX_DataFrameColumnStore::_storeTyped(std::vector<V>& values, size_t row, It begin, size_t count) {
+		bool wasPresent = elementCount(row) > 0;
+
+		if (!_vectorMode && count > 1) {
+			_enterVectorMode(values);
+		}
+
+		if (!_vectorMode) {
+			if (count == 1) {
+				values[row] = static_cast<V>(*begin);
+			}
+			_present[row] = (count == 1) ? 1 : 0;
+		} else {
+			size_t start = _offsets[row];
+			size_t oldCount = _offsets[row + 1] - start;
+
+			if (count > oldCount) {
+				values.insert(values.begin() + start + oldCount, count - oldCount, V());
+			} else if (count < oldCount) {
+				values.erase(values.begin() + start + count, values.begin() + start + oldCount);
+			}
+
+			for (size_t i = 0; i < count; i++, ++begin) {
+				values[start + i] = static_cast<V>(*begin);
+			}
+
+			if (count != oldCount) {
+				for (size_t r = row + 1; r <= _rows; r++) {
+					_offsets[r] = _offsets[r] + count - oldCount;
+				}
+			}
+		}
+
+		bool isPresent = count > 0;
+		if (isPresent && !wasPresent) {
+			_presentCount++;
+		} else if (!isPresent && wasPresent) {
+			_presentCount--;
+		}
+	}
+
+	template <typename V>
+	void CX_DataFrameColumnStore::_enterVectorMode(std::vector<V>& values) {
+		std::vector<V> packed;
+		packed.reserve(_presentCount);
+
+		_offsets.assign(_rows + 1, 0);
+		for (size_t r = 0; r < _rows; r++) {
+			if (_present[r]) {
+				packed.push_back(std::move(values[r]));
+			}
+			_offsets[r + 1] = packed.size();
+		}
+
+		values.swap(packed);
+		_present.clear();
+		_present.shrink_to_fit();
+		_vectorMode = true;
+	}
+
+	template <typename T>
+	T CX_DataFrameColumnStore::to(size_t row, bool log) const {
+		size_t count = elementCount(row);
+
+		if (count == 0) {
+			if (log) {
+				CX::Instances::Log.error("CX_DataFrameCell") << "to(): No data to extract from cell.";
+			}
+			return T();
+		}
+
+		if (log && (count > 1)) {
+			CX::Instances::Log.warning("CX_DataFrameCell") << "to(): Attempt to extract a scalar when the stored data was a vector. "
+				"Only the first value of the vector will be returned.";
+		}
+
+		const char* typeName = typeid(T).name();
+		bool typeMatches = sameTypeName(getRowType(row), typeName);
+		if (log && !isRowTypeIgnored(row) && !typeMatches) {
+			CX::Instances::Log.warning("CX_DataFrameCell") << "to(): Extracting data of different type than was inserted:" <<
+				" Inserted type was \"" << getRowType(row) << "\" and extracted type was \"" << typeName << "\".";
+		}
+
+		if (typeMatches && _kind == kindOf<T>()) {
+			return _elementAs<T>(row, 0, KindTag<kindOf<T>()>());
+		}
+		return fromString<T>(elementToString(row, 0));
+	}
+
+	template <typename T>
+	std::vector<T> CX_DataFrameColumnStore::toVector(size_t row, bool log) const {
+		const char* extractedTypeName = typeid(T).name();
+		bool typeMatches = sameTypeName(getRowType(row), extractedTypeName);
+		if (log && !isRowTypeIgnored(row) && !typeMatches) {
+			CX::Instances::Log.warning("CX_DataFrameCell") << "toVector(): Attempt to extract data of different type than was inserted:" <<
+				" Inserted type was \"" << getRowType(row) << "\" and attempted extracted type was \"" << extractedTypeName << "\".";
+		}
+
+		size_t count = elementCount(row);
+		std::vector<T> values;
+		values.reserve(count);
+
+		bool direct = typeMatches && (_kind == kindOf<T>());
+		for (size_t i = 0; i < count; i++) {
+			if (direct) {
+				values.push_back(_elementAs<T>(row, i, KindTag<kindOf<T>()>()));
+			} else {
+				values.push_back(fromString<T>(elementToString(row, i)));
+			}
+		}
+		return values;
+	}
+
+	/*! Calls `f(row, value)` for each element of each row of the column, with the element converted to `double`.
+	Elements of numeric and bool columns are read directly from the typed array. Empty cells are skipped. */
+	template <typename F>
+	void CX_DataFrameColumnStore::forEachNumber(F f) const {
+		switch (_kind) {
+		case Kind::EMPTY: break;
+		case Kind::INT64: _forEachTyped(_int64s, f); break;
+		case Kind::UINT64: _forEachTyped(_uint64s, f); break;
+		case Kind::DOUBLE: _forEachTyped(_doubles, f); break;
+		case Kind::BOOL: _forEachTyped(_bools, f); break;
+		case Kind::STRING:
+		case Kind::GENERIC:
+			for (size_t r = 0; r < _rows; r++) {
+				size_t count = elementCount(r);
+				for (size_t i = 0; i < count; i++) {
+					f(r, fromString<double>(elementToString(r, i)));
+				}
+			}
+			break;
+		}
+	}
+
+	template <typename V, typename F>
+	void CX_DataFrameColumnStore::_forEachTyped(const std::vector<V>& values, F& f) const {
+		if (_vectorMode) {
+			for (size_t r = 0; r < _rows; r++) {
+				for (size_t i = _offsets[r]; i < _offsets[r + 1]; i++) {
+					f(r, static_cast<double>(values[i]));
+				}
+			}
+		} else {
+			for (size_t r = 0; r < _rows; r++) {
+				if (_present[r]) {
+					f(r, static_cast<double>(values[r]));
+				}
+			}
+		}
+	}
+
+	template <typename T, CX_DataFrameColumnStore::Kind K>
+	T CX_DataFrameColumnStore::_elementAs(size_t row, size_t element, KindTag<K> tag) const {
+		return static_cast<T>(_values(tag)[_elementStart(row) + element]);
+	}
+
+	template <typename T>
+	T CX_DataFrameColumnStore::_elementAs(size_t row, size_t element, KindTag<Kind::GENERIC>) const {
+		return fromString<T>(elementToString(row, element));
+	}
+
+	/*! This class holds the data for a CX_DataFrameCell that is not part of a data frame, as long as that data is a single
+	number, bool, or short string. The value is held in place in a tagged union, so storing it does not allocate memory.
+	A CX_DataFrameCell moves its data into a one-row CX_DataFrameColumnStore if anything else is stored in it.
+
+	This class is used internally by CX_DataFrameCell and should not be used directly.
+	*/
+	class CX_DataFrameValue {
+	public:
+
+		typedef CX_DataFrameColumnStore::Kind Kind;
+
+		static const size_t shortStringCapacity = 23; //!< The longest string that can be held without allocating memory.
+
+		CX_DataFrameValue(void);
+
+		template <typename T> bool tryStore(const T& value);
+		void clear(void);
+
+		Kind getKind(void) const { return _kind; };
+		size_t elementCount(void) const { return (_kind == Kind::EMPTY) ? 0 : 1; };
+		std::string toString(void) const;
+
+		const char* getTypeName(void) const { return _typeName; };
+		bool isTypeIgnored(void) const { return _typeIgnored || (_kind == Kind::EMPTY); };
+		bool setType(Kind kind, const char* typeName);
+		void ignoreType(void);
+
+		template <typename T> T to(bool log) const;
+		template <typename T> std::vector<T> toVector(bool log) const;
+
+	private:
+		friend class CX_DataFrameColumnStore;
+
+		template <Kind K> using KindTag = CX_DataFrameColumnStore::KindTag<K>;
+
+		Kind _kind;
+		const char* _typeName;
+		bool _typeIgnored;
+		unsigned char _length; //The length of _chars, if a string is stored.
+
+		union {
+			int64_t _int64;
+			uint64_t _uint64;
+			double _double;
+			bool _bool;
+			char _chars[shortStringCapacity];
+		};
+
+		bool _assign(const std::string& value, KindTag<Kind::STRING>);
+		template <typename T> bool _assign(const T& value, KindTag<Kind::INT64>) { _int64 = static_cast<int64_t>(value); return true; };
+		template <typename T> bool _assign(const T& value, KindTag<Kind::UINT64>) { _uint64 = static_cast<uint64_t>(value); return true; };
+		template <typename T> bool _assign(const T& value, KindTag<Kind::DOUBLE>) { _double = static_cast<double>(value); return true; };
+		template <typename T> bool _assign(const T& value, KindTag<Kind::BOOL>) { _bool = value; return true; };
+		template <typename T> bool _assign(const T&, KindTag<Kind::GENERIC>) { return false; };
+
+		template <typename T> T _as(KindTag<Kind::INT64>) const { return static_cast<T>(_int64); };
+		template <typename T> T _as(KindTag<Kind::UINT64>) const { return static_cast<T>(_uint64); };
+		template <typename T> T _as(KindTag<Kind::DOUBLE>) const { return static_cast<T>(_double); };
+		template <typename T> T _as(KindTag<Kind::BOOL>) const { return _bool; };
+		template <typename T> T _as(KindTag<Kind::STRING>) const { return std::string(_chars, _length); };
+		template <typename T> T _as(KindTag<Kind::GENERIC>) const { return CX_DataFrameColumnStore::fromString<T>(toString()); };
+
+		template <typename T> T _convert(bool typeMatches) const;
+	};
+
+	/*! Stores the value if it can be held in place. Returns `false` without changing the stored value otherwise. */
+	template <typename T>
+	bool CX_DataFrameValue::tryStore(const T& value) {
+		if (!_assign(value, KindTag<CX_DataFrameColumnStore::kindOf<T>()>())) {
+			return false;
+		}
+		_kind = CX_DataFrameColumnStore::kindOf<T>();
+		_typeName = typeid(T).name();
+		_typeIgnored = false;
+		return true;
+	}
+
+	template <typename T>
+	T CX_DataFrameValue::to(bool log) const {
+		if (_kind == Kind::EMPTY) {
+			if (log) {
+				CX::Instances::Log.error("CX_DataFrameCell") << "to(): No data to extract from cell.";
+			}
+			return T();
+		}
+
+		const char* typeName = typeid(T).name();
+		bool typeMatches = CX_DataFrameColumnStore::sameTypeName(_typeName, typeName);
+		if (log && !_typeIgnored && !typeMatches) {
+			CX::Instances::Log.warning("CX_DataFrameCell") << "to(): Extracting data of different type than was inserted:" <<
+				" Inserted type was \"" << _typeName << "\" and extracted type was \"" << typeName << "\".";
+		}
+
+		return _convert<T>(typeMatches);
+	}
+
+	template <typename T>
+	std::vector<T> CX_DataFrameValue::toVector(bool log) const {
+		const char* extractedTypeName = typeid(T).name();
+		bool typeMatches = CX_DataFrameColumnStore::sameTypeName(_typeName, extractedTypeName);
+		if (log && !isTypeIgnored() && !typeMatches) {
+			CX::Instances::Log.warning("CX_DataFrameCell") << "toVector(): Attempt to extract data of different type than was inserted:" <<
+				" Inserted type was \"" << _typeName << "\" and attempted extracted type was \"" << extractedTypeName << "\".";
+		}
+
+		std::vector<T> values;
+		if (_kind != Kind::EMPTY) {
+			values.push_back(_convert<T>(typeMatches));
+		}
+		return values;
+	}
+
+	template <typename T>
+	T CX_DataFrameValue::_convert(bool typeMatches) const {
+		if (typeMatches && _kind == CX_DataFrameColumnStore::kindOf<T>()) {
+			return _as<T>(KindTag<CX_DataFrameColumnStore::kindOf<T>()>());
+		}
+		return CX_DataFrameColumnStore::fromString<T>(toString());
+	}
+
+} //namespace Private
+} //namespace CX
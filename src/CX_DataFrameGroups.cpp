@@ -0,0 +1,174 @@
+#include "CX_DataFrameGroups.h"
+
+#include <map>
+#include <unordered_map>
+
+#include "CX_StatisticsAccumulator.h"
+
+namespace CX {
+
+/*! Splits the rows of the data frame into groups that have the same values in the given columns.
+\param df The data frame to group.
+\param columns The names of the columns to group by. If no columns are given, all of the rows are in one group.
+Columns that are not in the data frame are ignored with an error. */
+CX_DataFrameGroups::CX_DataFrameGroups(const CX_DataFrame& df, const std::vector<std::string>& columns) :
+	_df(&df)
+{
+	CX_DataFrame::rowIndex_t rowCount = df.getRowCount();
+
+	_rowGroups.assign(rowCount, 0);
+	if (rowCount > 0) {
+		_firstRows.push_back(0);
+	}
+
+	std::vector<uint32_t> codes;
+	std::vector<size_t> firstRows;
+
+	for (const std::string& column : columns) {
+		auto it = df._data.find(column);
+		if (it == df._data.end()) {
+			CX::Instances::Log.error("CX_DataFrameGroups") << "Column \"" << column << "\" is not in the data frame. It will not be used for grouping.";
+			continue;
+		}
+		_columns.push_back(column);
+
+		it->second->factorize(&codes, &firstRows);
+
+		if (_columns.size() == 1) {
+			_rowGroups.swap(codes);
+			_firstRows.assign(firstRows.begin(), firstRows.end());
+			continue;
+		}
+
+		//Each combination of the previous group and the value in this column is a new group.
+		std::unordered_map<uint64_t, uint32_t> combined;
+		_firstRows.clear();
+		for (CX_DataFrame::rowIndex_t r = 0; r < rowCount; r++) {
+			uint64_t key = ((uint64_t)_rowGroups[r] << 32) | codes[r];
+			auto group = combined.find(key);
+			if (group == combined.end()) {
+				group = combined.insert(std::make_pair(key, (uint32_t)_firstRows.size())).first;
+				_firstRows.push_back(r);
+			}
+			_rowGroups[r] = group->second;
+		}
+	}
+}
+
+/*! Returns the number of groups. */
+size_t CX_DataFrameGroups::getGroupCount(void) const {
+	return _firstRows.size();
+}
+
+/*! Returns the indices of the rows of the data frame that are in the given group. */
+std::vector<CX_DataFrame::rowIndex_t> CX_DataFrameGroups::getGroupRows(size_t group) const {
+	std::vector<CX_DataFrame::rowIndex_t> rows;
+	for (CX_DataFrame::rowIndex_t r = 0; r < _rowGroups.size(); r++) {
+		if (_rowGroups[r] == group) {
+			rows.push_back(r);
+		}
+	}
+	return rows;
+}
+
+/*! Returns the index of the group that the given row of the data frame is in. */
+size_t CX_DataFrameGroups::getRowGroup(CX_DataFrame::rowIndex_t row) const {
+	return _rowGroups.at(row);
+}
+
+/*! Returns a data frame with one row per group, containing the values of the grouping columns for each group. */
+CX_DataFrame CX_DataFrameGroups::keys(void) const {
+	return agg(std::vector<Aggregation>());
+}
+
+/*! Calculates statistics of columns within each group.
+\param aggregations The statistics to calculate. See CX::CX_DataFrameGroups::Aggregation.
+\return A data frame with one row per group. The first columns are the grouping columns, which hold the values for each group,
+followed by one column per aggregation. Statistics that cannot be calculated for a group because it has too few values (e.g. the
+mean of no values or the variance of one value) are left empty. */
+CX_DataFrame CX_DataFrameGroups::agg(const std::vector<Aggregation>& aggregations) const {
+	CX_DataFrame result;
+
+	if (_df->getRowCount() != _rowGroups.size()) {
+		CX::Instances::Log.error("CX_DataFrameGroups") << "agg(): The number of rows in the data frame has changed since the groups were made.";
+		return result;
+	}
+
+	size_t groupCount = getGroupCount();
+
+	for (const std::string& column : _columns) {
+		const Private::CX_DataFrameColumnStore& source = *_df->_data.at(column);
+
+		auto target = std::make_shared<Private::CX_DataFrameColumnStore>(groupCount);
+		for (size_t g = 0; g < groupCount; g++) {
+			target->copyRowFrom(source, _firstRows[g], g);
+		}
+
+		result._tryAddColumn(column, false);
+		result._data.at(column) = target;
+	}
+
+	//Each column is summarized once, no matter how many statistics are requested for it.
+	std::map<std::string, std::vector<Private::CX_StatisticsAccumulator>> summaries;
+
+	for (const Aggregation& aggregation : aggregations) {
+		auto source = _df->_data.find(aggregation.column);
+		if (source == _df->_data.end()) {
+			CX::Instances::Log.error("CX_DataFrameGroups") << "agg(): Column \"" << aggregation.column << "\" is not in the data frame.";
+			continue;
+		}
+
+		std::string name = aggregation.name.empty() ? aggregation.column + "_" + statisticName(aggregation.statistic) : aggregation.name;
+		if (result.columnExists(name)) {
+			CX::Instances::Log.error("CX_DataFrameGroups") << "agg(): There is already a column named \"" << name << "\" in the output. The statistic will not be calculated.";
+			continue;
+		}
+
+		auto summary = summaries.find(aggregation.column);
+		if (summary == summaries.end()) {
+			std::vector<Private::CX_StatisticsAccumulator> accumulators(groupCount);
+			const std::vector<uint32_t>& rowGroups = _rowGroups;
+			source->second->forEachNumber([&accumulators, &rowGroups](size_t row, double value) {
+				accumulators[rowGroups[row]].add(value);
+			});
+			summary = summaries.insert(std::make_pair(aggregation.column, std::move(accumulators))).first;
+		}
+
+		auto target = std::make_shared<Private::CX_DataFrameColumnStore>(groupCount);
+		for (size_t g = 0; g < groupCount; g++) {
+			const Private::CX_StatisticsAccumulator& acc = summary->second[g];
+
+			switch (aggregation.statistic) {
+			case Statistic::COUNT: target->storeScalar<CX_DataFrame::rowIndex_t>(g, (CX_DataFrame::rowIndex_t)acc.count()); break;
+			case Statistic::SUM: target->storeScalar<double>(g, acc.sum()); break;
+			case Statistic::MEAN: if (acc.count() > 0) target->storeScalar<double>(g, acc.mean()); break;
+			case Statistic::VAR: if (acc.count() > 1) target->storeScalar<double>(g, acc.variance()); break;
+			case Statistic::SD: if (acc.count() > 1) target->storeScalar<double>(g, acc.standardDeviation()); break;
+			case Statistic::MIN: if (acc.count() > 0) target->storeScalar<double>(g, acc.min()); break;
+			case Statistic::MAX: if (acc.count() > 0) target->storeScalar<double>(g, acc.max()); break;
+			}
+		}
+
+		result._tryAddColumn(name, false);
+		result._data.at(name) = target;
+	}
+
+	result._rowCount = groupCount;
+	return result;
+}
+
+/*! Returns the name of the statistic in lower case, e.g. "mean" for Statistic::MEAN. */
+std::string CX_DataFrameGroups::statisticName(Statistic statistic) {
+	switch (statistic) {
+	case Statistic::COUNT: return "count";
+	case Statistic::SUM: return "sum";
+	case Statistic::MEAN: return "mean";
+	case Statistic::VAR: return "var";
+	case Statistic::SD: return "sd";
+	case Statistic::MIN: return "min";
+	case Statistic::MAX: return "max";
+	}
+	return "";
+}
+
+} //namespace CX
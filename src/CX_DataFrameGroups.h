@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "CX_DataFrame.h"
+
+namespace CX {
+
+	/*! This class splits the rows of a CX_DataFrame into groups that have the same values in one or more columns and
+	calculates summary statistics of other columns within each group. It is usually made with CX::CX_DataFrame::groupBy().
+
+	\code{.cpp}
+	//At the end of a block, find the mean response time and the accuracy in each condition.
+	CX_DataFrame summary = df.groupBy({ "condition" }).agg({
+		{ "rt", CX_DataFrameGroups::Statistic::MEAN },
+		{ "rt", CX_DataFrameGroups::Statistic::SD },
+		{ "correct", CX_DataFrameGroups::Statistic::MEAN, "accuracy" }
+	});
+
+	for (CX_DataFrame::rowIndex_t i = 0; i < summary.getRowCount(); i++) {
+		cout << summary(i, "condition").toString() << ": " << summary(i, "rt_mean").toString() << " ms, " <<
+			summary(i, "accuracy").to<double>() * 100 << "% correct" << endl;
+	}
+	\endcode
+
+	The statistics are calculated in one pass over each column, reading numeric and bool values directly from the column data
+	without copying the column. The mean and variance are calculated with Welford's algorithm and sums are compensated, so the
+	results are accurate even for large groups. Elements of cells that contain vectors are all included. Empty cells are skipped.
+	Columns that hold strings or other types are converted to `double` element by element, which is much slower.
+
+	The groups are in the order in which their values first appear in the data frame. Empty cells in the grouping columns
+	form a group of their own.
+
+	The groups refer to the rows of the data frame that they were made from, so they should be used right away, before rows are
+	added to, removed from, or reordered in the data frame. The data frame must exist for as long as the groups are used.
+
+	\ingroup dataManagement
+	*/
+	class CX_DataFrameGroups {
+	public:
+
+		/*! The statistics that can be calculated for each group. */
+		enum class Statistic {
+			COUNT, //!< The number of values.
+			SUM, //!< The sum of the values.
+			MEAN, //!< The mean of the values.
+			VAR, //!< The sample variance (with `n - 1` in the denominator) of the values.
+			SD, //!< The sample standard deviation of the values.
+			MIN, //!< The smallest value.
+			MAX //!< The largest value.
+		};
+
+		/*! A statistic to calculate for a column. */
+		struct Aggregation {
+			/*! \param column The name of the column to summarize.
+			\param statistic The statistic to calculate.
+			\param name The name of the column of the output that holds the statistic. If empty, it is the name of
+			the column followed by an underscore and the name of the statistic in lower case, e.g. "rt_mean". */
+			Aggregation(std::string column, Statistic statistic, std::string name = "") :
+				column(column),
+				statistic(statistic),
+				name(name)
+			{}
+
+			std::string column;
+			Statistic statistic;
+			std::string name;
+		};
+
+		CX_DataFrameGroups(const CX_DataFrame& df, const std::vector<std::string>& columns);
+
+		size_t getGroupCount(void) const;
+		std::vector<CX_DataFrame::rowIndex_t> getGroupRows(size_t group) const;
+		size_t getRowGroup(CX_DataFrame::rowIndex_t row) const;
+
+		CX_DataFrame keys(void) const;
+		CX_DataFrame agg(const std::vector<Aggregation>& aggregations) const;
+
+		static std::string statisticName(Statistic statistic);
+
+	private:
+
+		const CX_DataFrame* _df;
+		std::vector<std::string> _columns;
+
+		std::vector<uint32_t> _rowGroups;
+		std::vector<CX_DataFrame::rowIndex_t> _firstRows;
+	};
+
+}
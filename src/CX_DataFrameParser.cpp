@@ -0,0 +1,291 @@
+#include "CX_DataFrameParser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace CX {
+namespace Private {
+
+CX_DataFrameParser::CX_DataFrameParser(const std::string& cellDelimiter, const std::string& vectorEncloser, const std::string& vectorElementDelimiter) :
+	_cellDelimiter(cellDelimiter),
+	_vectorEncloser(vectorEncloser),
+	_vectorElementDelimiter(vectorElementDelimiter),
+	_rowCount(0),
+	_errorLine(0),
+	_errorCellCount(0)
+{}
+
+/*! Parses the text. The cell delimiter must not be empty.
+\param data A pointer to the text.
+\param size The length of the text, in bytes.
+\param threadCount The maximum number of threads to use. If 0, one thread per hardware thread is used. The
+text is only split into as many chunks as there are multiples of `minimumChunkSize` in it.
+\return `false` if a line had a different number of cells than there are column names, `true` otherwise. */
+bool CX_DataFrameParser::parse(const char* data, size_t size, unsigned int threadCount) {
+	_headers.clear();
+	_columns.clear();
+	_rowCount = 0;
+	_blankLines.clear();
+	_errorLine = 0;
+	_errorCellCount = 0;
+
+	const char* end = data + size;
+	const char* headerEnd = (size > 0) ? (const char*)std::memchr(data, '\n', size) : nullptr;
+	if (headerEnd == nullptr) {
+		headerEnd = end;
+	}
+	const char* headerTextEnd = _stripCarriageReturn(data, headerEnd);
+
+	for (const char* cell = data; ; ) {
+		const char* cellEnd = cell;
+		while (cellEnd < headerTextEnd && !_matches(cellEnd, headerTextEnd, _cellDelimiter)) {
+			cellEnd++;
+		}
+
+		const char* nameBegin = cell;
+		const char* nameEnd = cellEnd;
+		_trim(nameBegin, nameEnd);
+		if (nameBegin != nameEnd) {
+			_headers.push_back(std::string(nameBegin, nameEnd));
+		}
+
+		if (cellEnd >= headerTextEnd) {
+			break;
+		}
+		cell = cellEnd + _cellDelimiter.size();
+	}
+
+	_columns.resize(_headers.size());
+
+	//If there is no newline after the header, there are no other lines.
+	if (headerEnd == end) {
+		return true;
+	}
+
+	const char* body = headerEnd + 1;
+	size_t bodySize = end - body;
+
+	if (threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	size_t chunkCount = std::max<size_t>(std::min<size_t>(threadCount, bodySize / minimumChunkSize), 1);
+
+	//Chunks start just after a newline.
+	std::vector<Chunk> chunks(chunkCount);
+	const char* chunkBegin = body;
+	for (size_t i = 0; i < chunkCount; i++) {
+		const char* chunkEnd = end;
+		if (i < chunkCount - 1) {
+			const char* target = std::max(chunkBegin, body + bodySize * (i + 1) / chunkCount);
+			const char* newline = (const char*)std::memchr(target, '\n', end - target);
+			if (newline != nullptr) {
+				chunkEnd = newline + 1;
+			}
+		}
+
+		chunks[i].begin = chunkBegin;
+		chunks[i].end = chunkEnd;
+		chunks[i].isLast = (chunkEnd == end);
+		chunkBegin = chunkEnd;
+
+		if (chunks[i].isLast) {
+			chunks.resize(i + 1);
+			break;
+		}
+	}
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < chunks.size(); i++) {
+		threads.push_back(std::thread(&CX_DataFrameParser::_parseChunk, this, std::ref(chunks[i])));
+	}
+	_parseChunk(chunks[0]);
+	for (std::thread& t : threads) {
+		t.join();
+	}
+
+	size_t firstLine = 2; //Line 1 is the header.
+	for (Chunk& chunk : chunks) {
+		for (size_t line : chunk.blankLines) {
+			_blankLines.push_back(firstLine + line);
+		}
+
+		if (chunk.failed) {
+			_errorLine = firstLine + chunk.errorLine;
+			_errorCellCount = chunk.errorCellCount;
+			_columns.clear();
+			_rowCount = 0;
+			return false;
+		}
+
+		for (size_t c = 0; c < _columns.size(); c++) {
+			_columns[c].append(std::move(chunk.columns[c]));
+		}
+		_rowCount += chunk.rowCount;
+		firstLine += chunk.lineCount;
+	}
+
+	return true;
+}
+
+void CX_DataFrameParser::_parseChunk(Chunk& chunk) const {
+	chunk.lineCount = std::count(chunk.begin, chunk.end, '\n') + (chunk.isLast ? 1 : 0);
+
+	chunk.columns.resize(_headers.size());
+	for (CX_DataFrameColumnStore& column : chunk.columns) {
+		column.reserve(chunk.lineCount);
+	}
+
+	const char* lineBegin = chunk.begin;
+	for (size_t line = 0; ; line++) {
+		const char* newline = (const char*)std::memchr(lineBegin, '\n', chunk.end - lineBegin);
+		if (newline == nullptr && !chunk.isLast) {
+			break;
+		}
+		const char* lineEnd = _stripCarriageReturn(lineBegin, (newline != nullptr) ? newline : chunk.end);
+
+		if (lineBegin == lineEnd) {
+			chunk.blankLines.push_back(line);
+		} else {
+			size_t cellCount = _parseLine(lineBegin, lineEnd, chunk);
+			if (cellCount != _headers.size()) {
+				chunk.failed = true;
+				chunk.errorLine = line;
+				chunk.errorCellCount = cellCount;
+				return;
+			}
+			chunk.rowCount++;
+		}
+
+		if (newline == nullptr) {
+			break;
+		}
+		lineBegin = newline + 1;
+	}
+
+	for (CX_DataFrameColumnStore& column : chunk.columns) {
+		column.resize(chunk.rowCount);
+	}
+}
+
+//Stores the cells of the line into row chunk.rowCount of the columns of the chunk and returns the number of cells.
+size_t CX_DataFrameParser::_parseLine(const char* begin, const char* end, Chunk& chunk) const {
+	size_t column = 0;
+
+	//Cells are used in place unless they contain an encloser, in which case they are copied into scratch without it.
+	const char* cellBegin = begin;
+	bool copying = false;
+	bool isVector = false;
+	bool inEncloser = false;
+
+	const char* pos = begin;
+	while (pos < end) {
+		if (_matches(pos, end, _cellDelimiter)) {
+			if (!inEncloser) {
+				if (copying) {
+					_storeCell(chunk, column, chunk.scratch.data(), chunk.scratch.size(), isVector);
+				} else {
+					_storeCell(chunk, column, cellBegin, pos - cellBegin, isVector);
+				}
+				column++;
+
+				pos += _cellDelimiter.size();
+				cellBegin = pos;
+				copying = false;
+				isVector = false;
+				continue;
+			}
+		} else if (!_vectorEncloser.empty() && _matches(pos, end, _vectorEncloser)) {
+			if (!copying) {
+				chunk.scratch.assign(cellBegin, pos);
+				copying = true;
+			}
+			if (!inEncloser) {
+				isVector = true;
+			}
+			inEncloser = !inEncloser;
+
+			pos += _vectorEncloser.size();
+			continue;
+		}
+
+		if (copying) {
+			chunk.scratch.push_back(*pos);
+		}
+		pos++;
+	}
+
+	if (copying) {
+		_storeCell(chunk, column, chunk.scratch.data(), chunk.scratch.size(), isVector);
+	} else {
+		_storeCell(chunk, column, cellBegin, end - cellBegin, isVector);
+	}
+	return column + 1;
+}
+
+void CX_DataFrameParser::_storeCell(Chunk& chunk, size_t column, const char* data, size_t length, bool isVector) const {
+	if (column >= chunk.columns.size()) {
+		return; //The line has too many cells, which is reported once the line has been read.
+	}
+
+	CX_DataFrameColumnStore& store = chunk.columns[column];
+	size_t row = chunk.rowCount;
+	if (store.rowCount() <= row) {
+		store.resize(row + 1);
+	}
+
+	if (!isVector) {
+		store.storeUntypedString(row, data, length);
+		return;
+	}
+
+	chunk.elements.clear();
+	const char* dataEnd = data + length;
+	for (const char* element = data; ; ) {
+		const char* elementEnd = element;
+		if (_vectorElementDelimiter.empty()) {
+			elementEnd = dataEnd;
+		} else {
+			while (elementEnd < dataEnd && !_matches(elementEnd, dataEnd, _vectorElementDelimiter)) {
+				elementEnd++;
+			}
+		}
+
+		const char* b = element;
+		const char* e = elementEnd;
+		_trim(b, e);
+		if (b != e) {
+			chunk.elements.push_back(std::string(b, e));
+		}
+
+		if (elementEnd >= dataEnd) {
+			break;
+		}
+		element = elementEnd + _vectorElementDelimiter.size();
+	}
+
+	store.storeUntypedStrings(row, chunk.elements);
+}
+
+bool CX_DataFrameParser::_matches(const char* pos, const char* end, const std::string& symbol) {
+	size_t length = symbol.size();
+	return (length > 0) && (*pos == symbol[0]) && ((size_t)(end - pos) >= length) && (std::memcmp(pos, symbol.data(), length) == 0);
+}
+
+void CX_DataFrameParser::_trim(const char*& begin, const char*& end) {
+	auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; };
+	while (begin < end && isSpace(*begin)) {
+		begin++;
+	}
+	while (end > begin && isSpace(*(end - 1))) {
+		end--;
+	}
+}
+
+//Files with Windows line endings have a '\r' before each '\n', which must not end up in the last cell of the line.
+const char* CX_DataFrameParser::_stripCarriageReturn(const char* begin, const char* end) {
+	return (end > begin && *(end - 1) == '\r') ? end - 1 : end;
+}
+
+} //namespace Private
+} //namespace CX
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+#include "CX_DataFrameColumnStore.h"
+
+namespace CX {
+namespace Private {
+
+	/*! This class reads delimited text, such as the files written by CX_DataFrame::printToFile(), into column stores.
+	The first line of the text holds the column names. The text is tokenized in a single pass directly from the
+	input buffer (which may be a memory-mapped file) without first being split into lines, and each cell is stored
+	straight into the column that was looked up for it when the header was read.
+
+	Large inputs can be split at line boundaries into chunks that are parsed in parallel, each into its own set of
+	columns. The columns of the chunks are then concatenated in order.
+
+	The results are the same as `CX_DataFrame` has always produced: Cells are stored as strings with their
+	type ignored, cells surrounded by the vector encloser are split into elements on the vector element delimiter
+	(with the elements trimmed and empty elements ignored), and column names are trimmed.
+
+	This class is used internally by CX_DataFrame and should not be used directly.
+	*/
+	class CX_DataFrameParser {
+	public:
+
+		CX_DataFrameParser(const std::string& cellDelimiter, const std::string& vectorEncloser, const std::string& vectorElementDelimiter);
+
+		bool parse(const char* data, size_t size, unsigned int threadCount);
+
+		const std::vector<std::string>& getHeaders(void) const { return _headers; };
+		std::vector<CX_DataFrameColumnStore>& getColumns(void) { return _columns; };
+		size_t getRowCount(void) const { return _rowCount; };
+
+		/*! Returns the line numbers (starting from 1) of blank lines that were skipped. */
+		const std::vector<size_t>& getBlankLines(void) const { return _blankLines; };
+
+		/*! If parse() failed, returns the line number (starting from 1) of the line that had the wrong number of cells. */
+		size_t getErrorLine(void) const { return _errorLine; };
+
+		/*! If parse() failed, returns the number of cells on the line given by getErrorLine(). */
+		size_t getErrorCellCount(void) const { return _errorCellCount; };
+
+		static const size_t minimumChunkSize = 1 << 20; //!< Inputs are not split into chunks smaller than this many bytes.
+
+	private:
+
+		struct Chunk {
+			Chunk(void) :
+				begin(nullptr),
+				end(nullptr),
+				isLast(false),
+				lineCount(0),
+				rowCount(0),
+				failed(false),
+				errorLine(0),
+				errorCellCount(0)
+			{}
+
+			const char* begin;
+			const char* end;
+			bool isLast; //Only the last chunk has a line after its final newline.
+
+			size_t lineCount;
+			size_t rowCount;
+			std::vector<CX_DataFrameColumnStore> columns;
+
+			std::vector<size_t> blankLines; //Relative to the start of the chunk.
+			bool failed;
+			size_t errorLine;
+			size_t errorCellCount;
+
+			//Reused between cells so that parsing does not allocate for every cell.
+			std::string scratch;
+			std::vector<std::string> elements;
+		};
+
+		std::string _cellDelimiter;
+		std::string _vectorEncloser;
+		std::string _vectorElementDelimiter;
+
+		std::vector<std::string> _headers;
+		std::vector<CX_DataFrameColumnStore> _columns;
+		size_t _rowCount;
+
+		std::vector<size_t> _blankLines;
+		size_t _errorLine;
+		size_t _errorCellCount;
+
+		void _parseChunk(Chunk& chunk) const;
+		size_t _parseLine(const char* begin, const char* end, Chunk& chunk) const;
+		void _storeCell(Chunk& chunk, size_t column, const char* data, size_t length, bool isVector) const;
+
+		static bool _matches(const char* pos, const char* end, const std::string& symbol);
+		static void _trim(const char*& begin, const char*& end);
+		static const char* _stripCarriageReturn(const char* begin, const char* end);
+	};
+
+} //namespace Private
+} //namespace CX
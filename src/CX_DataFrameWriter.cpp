@@ -0,0 +1,299 @@
+#include "CX_DataFrameWriter.h"
+
+namespace CX {
+
+CX_DataFrameWriter::CX_DataFrameWriter(void) :
+	_open(false),
+	_headerWritten(false),
+	_rowsWritten(0),
+	_bytesQueued(0),
+	_bytesWritten(0),
+	_stopWriting(false),
+	_writeFailed(false),
+	_failureReported(false)
+{}
+
+CX_DataFrameWriter::~CX_DataFrameWriter(void) {
+	close();
+}
+
+/*! Opens a file to write rows to and starts the background thread that writes to it. If the file exists, it will be overwritten.
+If another file was open, it is closed first.
+\param filename The name of the file to write to. If it is a relative path, the file will be written relative to the data directory.
+\param oOpt The output options. See CX::CX_DataFrame::OutputOptions. `rowsToPrint` is ignored.
+\return `true` if the file was opened, `false` otherwise. */
+bool CX_DataFrameWriter::open(std::string filename, CX_DataFrame::OutputOptions oOpt) {
+	close();
+
+	filename = ofToDataPath(filename);
+	if (ofFile::doesFileExist(filename)) {
+		CX::Instances::Log.warning("CX_DataFrameWriter") << "open(): File \"" << filename << "\" already exists. It will be overwritten.";
+	}
+
+	_file.open(filename, std::ios::binary | std::ios::trunc);
+	if (!_file.is_open()) {
+		CX::Instances::Log.error("CX_DataFrameWriter") << "open(): File \"" << filename << "\" could not be opened.";
+		return false;
+	}
+
+	_filename = filename;
+	_options = oOpt;
+	_columns.clear();
+	_columnSet.clear();
+	_headerWritten = false;
+	_skippedColumns.clear();
+	_rowsWritten = 0;
+
+	_queued.clear();
+	_bytesQueued = 0;
+	_bytesWritten = 0;
+	_stopWriting = false;
+	_writeFailed = false;
+	_failureReported = false;
+
+	_writerThread = std::thread(&CX_DataFrameWriter::_writerLoop, this);
+	_open = true;
+	return true;
+}
+
+/*! Waits for all of the rows to be written and closes the file. If no rows were written, the file is empty. */
+void CX_DataFrameWriter::close(void) {
+	if (!_open) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopWriting = true;
+	}
+	_dataQueued.notify_one();
+	_writerThread.join();
+
+	_file.close();
+	_checkWriteFailure("close");
+	_open = false;
+}
+
+/*! Returns `true` if a file is open for writing. */
+bool CX_DataFrameWriter::isOpen(void) const {
+	return _open;
+}
+
+/*! Writes a row to the file. The row number that is written if `OutputOptions::printRowNumbers` is `true`
+is the number of rows that had been written before this row.
+\param row The row to write. This can be a row of a CX_DataFrame or a CX_DataFrameRow that is not linked to a data frame.
+\return `false` if the file is not open or writing to it has failed, `true` otherwise. */
+bool CX_DataFrameWriter::writeRow(CX_DataFrameRow row) {
+	if (!_open) {
+		CX::Instances::Log.error("CX_DataFrameWriter") << "writeRow(): No file is open. Have you forgotten to call open()?";
+		return false;
+	}
+
+	std::vector<std::string> names = row.names();
+	_beginRow(names);
+
+	std::set<std::string> rowColumns(names.begin(), names.end());
+
+	_rowText.clear();
+	if (_options.printRowNumbers) {
+		_rowText.append(ofToString(_rowsWritten));
+		_rowText.append(_options.cellDelimiter);
+	}
+
+	for (size_t j = 0; j < _columns.size(); j++) {
+		if (j > 0) {
+			_rowText.append(_options.cellDelimiter);
+		}
+		if (rowColumns.find(_columns[j]) == rowColumns.end()) {
+			continue;
+		}
+
+		CX_DataFrameCell cell = row[_columns[j]];
+		if (cell.size() > 1) {
+			_rowText.append(_options.vectorEncloser);
+			_rowText.append(Util::vectorToString(cell.toVector<std::string>(false), _options.vectorElementDelimiter));
+			_rowText.append(_options.vectorEncloser);
+		} else if (cell.size() == 1) {
+			_rowText.append(cell.to<std::string>(false));
+		}
+	}
+	_rowText.append("\n");
+
+	_enqueue(_rowText);
+	_rowsWritten++;
+
+	return _checkWriteFailure("writeRow");
+}
+
+/*! Writes a row of a data frame to the file.
+\param df The data frame containing the row.
+\param row The index of the row to write.
+\return `false` if the file is not open, the row is out of range, or writing to the file has failed, `true` otherwise. */
+bool CX_DataFrameWriter::writeRow(const CX_DataFrame& df, CX_DataFrame::rowIndex_t row) {
+	if (!_open) {
+		CX::Instances::Log.error("CX_DataFrameWriter") << "writeRow(): No file is open. Have you forgotten to call open()?";
+		return false;
+	}
+
+	if (row >= df.getRowCount()) {
+		CX::Instances::Log.error("CX_DataFrameWriter") << "writeRow(): Row " << row << " is out of range.";
+		return false;
+	}
+
+	_beginRow(df.getColumnNames());
+
+	_rowText.clear();
+	if (_options.printRowNumbers) {
+		_rowText.append(ofToString(row));
+		_rowText.append(_options.cellDelimiter);
+	}
+
+	for (size_t j = 0; j < _columns.size(); j++) {
+		if (j > 0) {
+			_rowText.append(_options.cellDelimiter);
+		}
+
+		auto it = df._data.find(_columns[j]);
+		if (it != df._data.end()) {
+			it->second->appendText(row, _options.vectorEncloser, _options.vectorElementDelimiter, &_rowText);
+		}
+	}
+	_rowText.append("\n");
+
+	_enqueue(_rowText);
+	_rowsWritten++;
+
+	return _checkWriteFailure("writeRow");
+}
+
+/*! Writes the rows of the data frame that have not been written yet, i.e. the rows from getRowsWritten() to the end of
+the data frame. This assumes that all of the rows that have been written came from `df`.
+\param df The data frame to write rows from.
+\return The number of rows that were written. */
+CX_DataFrame::rowIndex_t CX_DataFrameWriter::writeNewRows(const CX_DataFrame& df) {
+	CX_DataFrame::rowIndex_t written = 0;
+	while (_rowsWritten < df.getRowCount()) {
+		if (!writeRow(df, _rowsWritten)) {
+			break;
+		}
+		written++;
+	}
+	return written;
+}
+
+/*! Waits until all of the rows that have been given to the writer are written to the file.
+\return `false` if no file is open or writing to the file has failed, `true` otherwise. */
+bool CX_DataFrameWriter::flush(void) {
+	if (!_open) {
+		return false;
+	}
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_dataWritten.wait(lock, [this] { return _bytesWritten == _bytesQueued; });
+	lock.unlock();
+
+	return _checkWriteFailure("flush");
+}
+
+/*! Returns the names of the columns that are written to the file. This is empty until the first row is written. */
+std::vector<std::string> CX_DataFrameWriter::getColumnNames(void) const {
+	return _columns;
+}
+
+/*! Returns the number of rows that have been written (or are waiting to be written) to the file. */
+CX_DataFrame::rowIndex_t CX_DataFrameWriter::getRowsWritten(void) const {
+	return _rowsWritten;
+}
+
+void CX_DataFrameWriter::_writerLoop(void) {
+	std::string writing;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true) {
+		_dataQueued.wait(lock, [this] { return !_queued.empty() || _stopWriting; });
+		if (_queued.empty()) {
+			break; //Stopping with nothing left to write.
+		}
+
+		writing.swap(_queued);
+		lock.unlock();
+
+		_file.write(writing.data(), writing.size());
+		_file.flush();
+		if (!_file.good()) {
+			_writeFailed = true;
+		}
+		size_t size = writing.size();
+		writing.clear();
+
+		lock.lock();
+		_bytesWritten += size;
+		_dataWritten.notify_all();
+	}
+}
+
+//Determines the columns on the first row and warns about columns that are not in the file. Columns that were left
+//out of `OutputOptions::columnsToPrint` are not warned about.
+bool CX_DataFrameWriter::_beginRow(const std::vector<std::string>& availableColumns) {
+	if (!_headerWritten) {
+		_columns = CX_DataFrame::_selectColumnsToPrint(_options.columnsToPrint, availableColumns);
+		_columnSet = std::set<std::string>(_columns.begin(), _columns.end());
+		_writeHeader();
+	}
+
+	const std::vector<std::string>& requested = _options.columnsToPrint;
+
+	bool allWritten = true;
+	for (const std::string& column : availableColumns) {
+		bool wanted = requested.empty() || (std::find(requested.begin(), requested.end(), column) != requested.end());
+		if (wanted && _columnSet.find(column) == _columnSet.end()) {
+			allWritten = false;
+			if (_skippedColumns.insert(column).second) {
+				CX::Instances::Log.warning("CX_DataFrameWriter") << "Column \"" << column << "\" is not in the file because it was not present "
+					"when the first row was written. It will not be written.";
+			}
+		}
+	}
+	return allWritten;
+}
+
+void CX_DataFrameWriter::_writeHeader(void) {
+	std::string header;
+	if (_options.printRowNumbers) {
+		header.append("rowNumber");
+		header.append(_options.cellDelimiter);
+	}
+	for (size_t j = 0; j < _columns.size(); j++) {
+		if (j > 0) {
+			header.append(_options.cellDelimiter);
+		}
+		header.append(_columns[j]);
+	}
+	header.append("\n");
+
+	_enqueue(header);
+	_headerWritten = true;
+}
+
+void CX_DataFrameWriter::_enqueue(const std::string& text) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_queued.append(text);
+		_bytesQueued += text.size();
+	}
+	_dataQueued.notify_one();
+}
+
+bool CX_DataFrameWriter::_checkWriteFailure(const std::string& functionName) {
+	if (!_writeFailed) {
+		return true;
+	}
+
+	if (!_failureReported) {
+		CX::Instances::Log.error("CX_DataFrameWriter") << functionName << "(): Writing to file \"" << _filename << "\" failed.";
+		_failureReported = true;
+	}
+	return false;
+}
+
+} //namespace CX
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CX_DataFrame.h"
+
+namespace CX {
+
+	/*! This class writes the rows of a CX_DataFrame to a file as they are completed, rather than all at once at the end of
+	the experiment with CX_DataFrame::printToFile(). If the program crashes, everything that was written before the crash
+	is in the file, and saving the data at the end of the session does not require the whole data frame to be printed.
+
+	Each row is formatted on the calling thread and handed to a background thread that appends it to the file, so writing
+	a row does not wait for the disk. The column names are written along with the first row, so the columns of the file are
+	the columns of the first row that is written. If `OutputOptions::columnsToPrint` is given, only those of its columns that are
+	in the first row are used, in the order of the data frame, and the others are logged, just as with CX_DataFrame::print().
+	Columns that appear in later rows but are not in the file are skipped with a warning.
+
+	The file has the same format as the output of CX_DataFrame::printToFile() with the same options, so it can be read
+	back in with CX_DataFrame::readFromFile(). `OutputOptions::rowsToPrint` is ignored.
+
+	\code{.cpp}
+	CX_DataFrame df;
+	CX_DataFrameWriter writer;
+	writer.open("data.txt");
+
+	for (int trial = 0; trial < 100; trial++) {
+		//Run the trial...
+		df(trial, "rt") = responseTime;
+		df(trial, "correct") = correct;
+
+		writer.writeNewRows(df); //Writes row `trial`, which is now complete.
+	}
+
+	writer.close(); //Waits for all of the rows to be written.
+	\endcode
+
+	The functions of this class must all be called from the same thread.
+
+	\ingroup dataManagement
+	*/
+	class CX_DataFrameWriter {
+	public:
+
+		CX_DataFrameWriter(void);
+		~CX_DataFrameWriter(void);
+
+		bool open(std::string filename, CX_DataFrame::OutputOptions oOpt = CX_DataFrame::OutputOptions());
+		void close(void);
+		bool isOpen(void) const;
+
+		bool writeRow(CX_DataFrameRow row);
+		bool writeRow(const CX_DataFrame& df, CX_DataFrame::rowIndex_t row);
+		CX_DataFrame::rowIndex_t writeNewRows(const CX_DataFrame& df);
+
+		bool flush(void);
+
+		std::vector<std::string> getColumnNames(void) const;
+		CX_DataFrame::rowIndex_t getRowsWritten(void) const;
+
+	private:
+
+		CX_DataFrame::OutputOptions _options;
+		std::string _filename;
+		bool _open;
+
+		std::vector<std::string> _columns;
+		std::set<std::string> _columnSet;
+		bool _headerWritten;
+		std::set<std::string> _skippedColumns;
+		CX_DataFrame::rowIndex_t _rowsWritten;
+
+		std::string _rowText;
+
+		std::ofstream _file;
+		std::thread _writerThread;
+		std::mutex _mutex;
+		std::condition_variable _dataQueued;
+		std::condition_variable _dataWritten;
+		std::string _queued;
+		uint64_t _bytesQueued;
+		uint64_t _bytesWritten;
+		bool _stopWriting;
+		std::atomic<bool> _writeFailed;
+		bool _failureReported;
+
+		void _writerLoop(void);
+
+		bool _beginRow(const std::vector<std::string>& availableColumns);
+		void _writeHeader(void);
+		void _enqueue(const std::string& text);
+		bool _checkWriteFailure(const std::string& functionName);
+	};
+
+}
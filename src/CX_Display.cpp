@@ -11,17 +11,28 @@ namespace CX {
 
 CX_Display::CX_Display(void) :
     _swapThread(nullptr),
+	_window(nullptr),
+	_drawingSlot(0),
+	_windowFullscreen(false),
+	_lastManualSwapNanos(0),
 	_framePeriod(0),
 	_framePeriodStandardDeviation(0),
+	_presentationLatency(0),
 	_manualBufferSwaps(0),
 	_frameNumberOnLastSwapCheck(0),
-	_softVSyncWithGLFinish(false)
+	_softVSyncWithGLFinish(false),
+	_leanRendering(false)
 {
 }
 
 CX_Display::~CX_Display(void) {
-	_swapThread->stopThread();
-	_swapThread->waitForThread(false);
+	if (_swapThread) {
+		_swapThread->stop();
+	}
+
+	if (_window) {
+		glfwDestroyWindow(_window);
+	}
 }
 
 /*! Set up the display. Must be called for the display to function correctly. 
@@ -39,6 +50,115 @@ void CX_Display::setup(void) {
 	//mean I have no idea what too early means) or else there will be a crash.
 	_swapThread = std::unique_ptr<Private::CX_VideoBufferSwappingThread>(new Private::CX_VideoBufferSwappingThread()); 
 
+	_presentationTimestamps.setup(CX::Private::glfwContext);
+	_swapThread->setPresentationTimestamps(&_presentationTimestamps);
+
+}
+
+/*! Sets up a display with its own window, rather than the main window. The window shares the OpenGL context of the
+main window, so anything that can be drawn on \ref CX::Instances::Disp can be drawn on this display. This must be called
+from the main thread after CX has been set up (i.e. in runExperiment()), and it must not be called on \ref CX::Instances::Disp.
+
+What is drawn between beginDrawingToBackBuffer() and endDrawingToBackBuffer() goes into a framebuffer, which is shown in
+the window from the next buffer swap of this display on. The swaps are always done by the buffer swapping thread of the
+display: swapBuffers() asks the thread for one swap and waits for it, and setAutomaticSwapping() makes it swap every frame.
+The frame period of the display is estimated during setup, which takes about half a second.
+
+The frame capture and the video recorder of a display with its own window capture the main window.
+The window does not get keyboard or mouse input; see CX_InputManager for input from the main window.
+
+\param config The configuration of the window.
+\return `true` if the window was made, `false` otherwise.
+*/
+bool CX_Display::setupWindow(const WindowConfiguration& config) {
+	if (_swapThread) {
+		CX::Instances::Log.error("CX_Display") << "setupWindow(): The display has already been set up.";
+		return false;
+	}
+
+	if (CX::Private::glfwContext == nullptr) {
+		CX::Instances::Log.error("CX_Display") << "setupWindow(): There is no main window to share a context with. setupWindow() must be called after CX has been set up.";
+		return false;
+	}
+
+	GLFWmonitor* monitor = nullptr;
+	if (config.monitor >= 0) {
+		int monitorCount = 0;
+		GLFWmonitor** monitors = glfwGetMonitors(&monitorCount);
+		if (config.monitor >= monitorCount) {
+			CX::Instances::Log.error("CX_Display") << "setupWindow(): Monitor " << config.monitor << " does not exist. There are " << monitorCount << " monitors.";
+			return false;
+		}
+		monitor = monitors[config.monitor];
+	}
+
+	int width = config.width;
+	int height = config.height;
+	if (monitor != nullptr && (width <= 0 || height <= 0)) {
+		const GLFWvidmode* mode = glfwGetVideoMode(monitor);
+		width = mode->width;
+		height = mode->height;
+	}
+
+	if (width <= 0 || height <= 0) {
+		CX::Instances::Log.error("CX_Display") << "setupWindow(): width and height must be > 0. Given width == " <<
+			width << " and height == " << height << ".";
+		return false;
+	}
+
+	//The other window hints are still the ones that the main window was made with.
+	glfwWindowHint(GLFW_DECORATED, config.decorated ? GL_TRUE : GL_FALSE);
+	_window = glfwCreateWindow(width, height, config.title.c_str(), monitor, CX::Private::glfwContext);
+	glfwWindowHint(GLFW_DECORATED, GL_TRUE);
+
+	if (_window == nullptr) {
+		CX::Instances::Log.error("CX_Display") << "setupWindow(): The window could not be made.";
+		return false;
+	}
+
+	if (monitor == nullptr) {
+		glfwSetWindowPos(_window, config.position.x, config.position.y);
+	}
+
+	_windowFullscreen = (monitor != nullptr);
+	_windowResolution = ofRectangle(width, height, width, height);
+
+#if OF_VERSION_MAJOR == 0 && OF_VERSION_MINOR == 9 && OF_VERSION_PATCH >= 0
+	_renderer = CX::Private::appWindow->renderer();
+#else
+	_renderer = ofGetGLProgrammableRenderer();
+#endif
+
+	for (ofFbo& fbo : _windowFbos) {
+		fbo.allocate(width, height, GL_RGBA, CX::Util::getMsaaSampleCount());
+		fbo.begin();
+		ofClear(0, 255);
+		fbo.end();
+	}
+	_drawingSlot = 0;
+
+	_swapThread = std::unique_ptr<Private::CX_VideoBufferSwappingThread>(new Private::CX_VideoBufferSwappingThread());
+	_swapThread->setWindow(_window);
+	_swapThread->setPresentationTimestamps(&_presentationTimestamps); //Set up on the swapping thread, where the context is current.
+
+	_swapThread->startThread(true);
+	if (!_swapThread->waitForContext(CX_Seconds(2))) {
+		CX::Instances::Log.error("CX_Display") << "setupWindow(): The buffer swapping thread did not start.";
+		_swapThread->stop();
+		_swapThread.reset();
+		glfwDestroyWindow(_window);
+		_window = nullptr;
+		return false;
+	}
+
+	estimateFramePeriod(CX_Millis(500));
+
+	return true;
+}
+
+/*! Returns `true` if the display was set up with setupWindow(), `false` if it uses the main window. */
+bool CX_Display::hasOwnWindow(void) const {
+	return _window != nullptr;
 }
 
 /*! This function exists to serve a per-computer configuration function that is otherwise difficult to provide
@@ -54,6 +174,8 @@ display.fullscreen = false
 display.hardwareVSync = true
 //display.softwareVSync = false //Commented out: no change
 //display.swapAutomatically = false //Commented out: no change
+display.presentationTimestamps = true
+display.presentationLatency = 8.5 //In milliseconds. See CX_LatencyCalibration.
 \endcode
 
 All of the configuration keys are used in this example.
@@ -108,6 +230,17 @@ void CX_Display::configureFromFile(std::string filename, std::string delimiter,
 			this->setAutomaticSwapping(result == 1);
 		}
 	}
+
+	if (kv.find("display.presentationTimestamps") != kv.end()) {
+		int result = Private::stringToBooleint(kv["display.presentationTimestamps"]);
+		if (result != -1) {
+			this->usePresentationTimestamps(result == 1);
+		}
+	}
+
+	if (kv.find("display.presentationLatency") != kv.end()) {
+		this->setPresentationLatency(CX_Millis(ofFromString<double>(kv.at("display.presentationLatency"))));
+	}
 }
 
 /*! Set whether the front and buffers of the display will swap automatically every frame or not.
@@ -116,29 +249,24 @@ check to see if the display is automatically swapping by calling isAutomatically
 \param autoSwap If true, the front and back buffer will swap automatically every frame.
 \note This function may \ref blockingCode "block" for up to 1 frame to due the requirement that it synchronize with the thread. */
 void CX_Display::setAutomaticSwapping(bool autoSwap) {
-	if (autoSwap) {
-		if (!_swapThread->isThreadRunning()) {
-			_swapThread->startThread(true);
-		}
-	} else {
-		if (_swapThread->isThreadRunning()) {
-			_swapThread->stopThread();
-			_swapThread->waitForThread();
-		}
-	}
+	_swapThread->setAutomaticSwapping(autoSwap);
 }
 
 /*! Determine whether the display is configured to automatically swap the front and back buffers
 every frame.
 See \ref setAutomaticSwapping for more information. */
 bool CX_Display::isAutomaticallySwapping(void) const {
-	return _swapThread->isThreadRunning();
+	return _swapThread->isAutomaticallySwapping();
 }
 
-/*! Get the last time at which the front and back buffers were swapped.
+/*! Get the last time at which the front and back buffers were swapped, by the swapping thread or by swapBuffers().
+If presentation timestamps are in use (see usePresentationTimestamps()), this is the time at which the frame was
+presented, as reported by the windowing system.
 \return A time value that can be compared with CX::Instances::Clock.now(). */
 CX_Millis CX_Display::getLastSwapTime(void) const {
-	return _swapThread->getLastSwapTime();
+	CX_Millis threadSwapTime = _swapThread->getLastSwapTime();
+	CX_Millis manualSwapTime = CX_Nanos(_lastManualSwapNanos.load(std::memory_order_acquire));
+	return std::max(threadSwapTime, manualSwapTime);
 }
 
 /*! Get an estimate of the next time the front and back buffers will be swapped.
@@ -169,18 +297,32 @@ bool CX_Display::hasSwappedSinceLastCheck(void) {
 }
 
 /*! If the display is automatically swapping, this function blocks until a buffer swap has ocurred. If the
-display is not automatically swapping, it returns immediately. */
+display is not automatically swapping, it returns immediately.
+
+The calling thread sleeps while it waits instead of spinning, so waiting does not use CPU time.
+\see waitForBufferSwap(CX_Millis) to wait with a timeout. */
 void CX_Display::waitForBufferSwap(void) {
 	if (!isAutomaticallySwapping()) {
 		CX::Instances::Log.warning("CX_Display") << "waitForBufferSwap(): Wait requested while not swapping in secondary thread. Returning immediately";
 		return;
 	}
-	hasSwappedSinceLastCheck();
-	while (!hasSwappedSinceLastCheck()) {
+
+	uint64_t frameNumber = _swapThread->getFrameNumber();
+	while (!_swapThread->waitForSwap(CX_Seconds(1), frameNumber)) {
 		if (!isAutomaticallySwapping()) {
 			return;
 		}
 	}
+	hasSwappedSinceLastCheck();
+}
+
+/*! Blocks until a buffer swap has ocurred in the buffer swapping thread, the thread stops swapping, or `timeout` has passed.
+The calling thread sleeps while it waits. This works with automatic swapping (\ref setAutomaticSwapping "setAutomaticSwapping(true)")
+and with swapBuffersInThread(). Unlike waitForBufferSwap(void), this does not change the result of hasSwappedSinceLastCheck().
+\param timeout The longest time to wait.
+\return `true` if a swap occurred, `false` if the timeout expired or the thread stopped swapping before a swap occurred. */
+bool CX_Display::waitForBufferSwap(CX_Millis timeout) {
+	return _swapThread->waitForSwap(timeout, _swapThread->getFrameNumber());
 }
 
 /*! This function returns the number of the last frame presented, as determined by
@@ -203,21 +345,96 @@ Disp.endDrawingToBackBuffer();
 */
 void CX_Display::beginDrawingToBackBuffer(void) {
 
+	_textureLoader.update();
+	_frameCapture.update();
+
+	if (!_window && _videoRecorder.isRecording()) {
+		//Buffer swaps in the swapping thread are found here. Manual swaps are reported in swapBuffers().
+		Private::CX_VideoBufferSwappingThread::SwapSnapshot swap = _swapThread->getSwapSnapshot();
+		_videoRecorder.frameSwapped(swap.frameCount + _manualBufferSwaps, swap.swapTime);
+		_videoRecorder.update();
+	}
+
 	if (_renderer) {
 		_renderer->startRender();
 	}
 
+	if (_window) {
+		//Wait (on the video card) until the swapping thread is done copying the last frame that was drawn in this framebuffer.
+		GLsync readFence = _swapThread->takeReadFence(_drawingSlot);
+		if (readFence) {
+			glWaitSync(readFence, 0, GL_TIMEOUT_IGNORED);
+			glDeleteSync(readFence);
+		}
+		_windowFbos[_drawingSlot].begin(); //Sets up the viewport and matrices for the framebuffer.
+		return;
+	}
+
+	if (_leanRendering) {
+		ofRectangle resolution = getResolution();
+		if (resolution.width == _leanViewport.width && resolution.height == _leanViewport.height) {
+			return;
+		}
+		_leanViewport = resolution;
+	}
+
 	ofViewport();
 	ofSetupScreen();
 }
 
+/*! Sets whether beginDrawingToBackBuffer() skips resetting the viewport and the projection and modelview matrices
+(`ofViewport()` and `ofSetupScreen()`) when the resolution of the display has not changed since the last frame.
+This removes most of the fixed cost of each frame, but it means that any matrix or viewport changes that are not undone
+(for example, an `ofTranslate()` without `ofPushMatrix()`/`ofPopMatrix()`) carry over into the next frame.
+This is turned on with CX_WindowConfiguration::leanRenderLoop.
+\param lean If `true`, use lean rendering. */
+void CX_Display::setLeanRendering(bool lean) {
+	_leanRendering = lean;
+	_leanViewport = ofRectangle(); //Force the state to be set up on the next frame.
+}
+
+/*! Returns `true` if lean rendering is in use. See setLeanRendering(). */
+bool CX_Display::isLeanRendering(void) const {
+	return _leanRendering;
+}
+
 /*! Finish rendering to the back buffer. Must be paired with a call to beginDrawingToBackBuffer(). */
 void CX_Display::endDrawingToBackBuffer(void) {
 
+	if (_window) {
+		ofFbo& fbo = _windowFbos[_drawingSlot];
+		fbo.end();
+
+		//Getting the texture resolves a multisampled framebuffer into it.
+#if OF_VERSION_MAJOR == 0 && OF_VERSION_MINOR == 9 && OF_VERSION_PATCH >= 0
+		const ofTextureData& texData = fbo.getTexture().getTextureData();
+#else
+		const ofTextureData& texData = fbo.getTextureReference().getTextureData();
+#endif
+
+		if (_renderer) {
+			_renderer->finishRender();
+		}
+
+		GLsync renderedFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush(); //The fence must reach the video card before the swapping thread waits for it in its context.
+
+		int windowWidth = 0;
+		int windowHeight = 0;
+		glfwGetFramebufferSize(_window, &windowWidth, &windowHeight);
+
+		_swapThread->submitFrame(_drawingSlot, texData.textureID, texData.textureTarget, fbo.getWidth(), fbo.getHeight(), renderedFence,
+			windowWidth, windowHeight);
+		_drawingSlot = 1 - _drawingSlot;
+		return;
+	}
+
 	if (_renderer) {
 		_renderer->finishRender();
 	}
 
+	_videoRecorder.frameRendered(getFrameNumber() + 1);
+
 	glFlush(); //This is very important, because it seems like commands are buffered in a thread-local fashion initially.
 		//As a result, if a swap is requested from a swapping thread separate from the rendering thread, the automatic flush
 		//that supposedly happens when a swap is queued may not flush commands from the rendering thread. Calling glFlush
@@ -235,11 +452,24 @@ void CX_Display::swapBuffers(void) {
 			"while automatic buffer swapping mode was in use.";
 	}
 
+	if (_window) {
+		//The context of the window is only current on the swapping thread, so it does the swap.
+		uint64_t frameNumber = _swapThread->getFrameNumber();
+		_swapThread->swapNFrames(1);
+		_swapThread->waitForSwap(CX_Seconds(1), frameNumber);
+		return;
+	}
+
 	glfwSwapBuffers(CX::Private::glfwContext);
 	if (_softVSyncWithGLFinish) {
 		glFinish();
 	}
 	_manualBufferSwaps++;
+
+	CX_Millis swapTime = _presentationTimestamps.getSwapTime(CX::Instances::Clock.now());
+	_lastManualSwapNanos.store(swapTime.nanos(), std::memory_order_release);
+
+	_videoRecorder.frameSwapped(getFrameNumber(), swapTime);
 }
 
 /*! This function cues a swap of the front and back buffers. It avoids blocking
@@ -272,6 +502,9 @@ of the window. If in full screen mode, this will return the resolution of the mo
 and `x` members and the height in pixles is stored in both the `height` and `y` members, so you can
 use whichever makes the most sense to you. */
 ofRectangle CX_Display::getResolution(void) const {
+	if (_window) {
+		return _windowResolution;
+	}
 	return ofRectangle( ofGetWidth(), ofGetHeight(), ofGetWidth(), ofGetHeight() );
 }
 
@@ -293,6 +526,11 @@ void CX_Display::setWindowResolution(int width, int height) {
 		return;
 	}
 
+	if (_window) {
+		CX::Instances::Log.error("CX_Display") << "setWindowResolution: The resolution of a display with its own window is set with setupWindow().";
+		return;
+	}
+
 	if (ofGetWindowMode() == OF_WINDOW) {
 		ofSetWindowShape(width, height);
 	}
@@ -350,6 +588,7 @@ void CX_Display::estimateFramePeriod(CX_Millis estimationInterval, float minRefr
 		if (cleanedDurations.size() >= 2) {
 			_framePeriodStandardDeviation = CX_Millis::standardDeviation(cleanedDurations);
 			_framePeriod = Util::mean(cleanedDurations);
+			_presentationTimestamps.setFramePeriod(_framePeriod);
 		} else {
 			CX::Instances::Log.error("CX_Display") << "estimateFramePeriod(): Not enough valid swaps occurred during the " <<
 				estimationInterval << " ms estimation interval. If the estimation interval was very short (less than 50 ms), you "
@@ -400,22 +639,31 @@ to set the frame period for a 60 Hz refresh cycle. However, note that this will
 that prevented the frame period from being estimated correctly, which usually has to do with problems with
 the video card doing vertical synchronization incorrectly. Thus, this may not fix anything.
 \param knownPeriod The known refresh period of the monitor.
-\note This function sets the standard deviation of the frame period to 0.
+\param standardDeviation The standard deviation of the frame period, e.g. from an earlier call to estimateFramePeriod().
+It defaults to 0.
 */
-void CX_Display::setFramePeriod(CX_Millis knownPeriod) {
+void CX_Display::setFramePeriod(CX_Millis knownPeriod, CX_Millis standardDeviation) {
 	_framePeriod = knownPeriod;
-	_framePeriodStandardDeviation = 0;
+	_framePeriodStandardDeviation = standardDeviation;
+	_presentationTimestamps.setFramePeriod(knownPeriod);
 }
 
 /*! Set whether the display is full screen or not. If the display is set to full screen,
 the resolution may not be the same as the resolution of display in windowed mode, and vice
 versa. */
 void CX_Display::setFullscreen(bool fullscreen) {
+	if (_window) {
+		CX::Instances::Log.error("CX_Display") << "setFullscreen(): Whether a display with its own window is full screen is set with setupWindow().";
+		return;
+	}
 	ofSetFullscreen(fullscreen);
 }
 
 /*! \brief Returns `true` if the display is in full screen mode, false otherwise. */
 bool CX_Display::isFullscreen(void) {
+	if (_window) {
+		return _windowFullscreen;
+	}
 	return (ofGetWindowMode() == OF_FULLSCREEN);
 }
 
@@ -424,9 +672,9 @@ bool CX_Display::isFullscreen(void) {
 */
 void CX_Display::setMinimized(bool minimize) {
 	if (minimize) {
-		glfwIconifyWindow(Private::glfwContext);
+		glfwIconifyWindow(_getWindow());
 	} else {
-		glfwRestoreWindow(Private::glfwContext);
+		glfwRestoreWindow(_getWindow());
 	}
 }
 
@@ -442,6 +690,11 @@ a Vsync setting, it is still possible that this function will have not have the
 expected effect. OpenGL seems to struggle with VSync.
 \see See \ref visualStimuli for information on what VSync is. */
 void CX_Display::useHardwareVSync(bool b) {
+	if (_window) {
+		_swapThread->setSwapInterval(b ? 1 : 0);
+		return;
+	}
+
 	if (b) {
 		glfwSwapInterval(1);
 	} else {
@@ -449,6 +702,89 @@ void CX_Display::useHardwareVSync(bool b) {
 	}
 }
 
+/*! Sets whether the display is using adaptive VSync, where buffer swaps wait for the vertical blank unless the frame
+is already late, in which case the swap happens immediately (causing a tear) instead of waiting a whole extra frame.
+This needs the `WGL_EXT_swap_control_tear` or `GLX_EXT_swap_control_tear` extension. If it is not available, plain
+hardware VSync is used instead (see useHardwareVSync()).
+\param b If `true`, try to use adaptive VSync. If `false`, this is the same as `useHardwareVSync(false)`.
+\return `true` if adaptive VSync was turned on, `false` otherwise. */
+bool CX_Display::useAdaptiveVSync(bool b) {
+	if (!b) {
+		useHardwareVSync(false);
+		return false;
+	}
+
+	if (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+		if (_window) {
+			_swapThread->setSwapInterval(-1);
+		} else {
+			glfwSwapInterval(-1);
+		}
+		return true;
+	}
+
+	CX::Instances::Log.notice("CX_Display") << "useAdaptiveVSync(): Adaptive VSync is not supported. Hardware VSync is used instead.";
+	useHardwareVSync(true);
+	return false;
+}
+
+/*! Adds the window of this display to a swap group, so that its buffer swaps happen at the same time as the swaps of
+the other windows in the group, for example for the two eyes of a stereoscope on two monitors. This needs the
+`NV_swap_group` extension (`WGL_NV_swap_group` or `GLX_NV_swap_group`), which is usually only available on professional
+video cards. For a display with its own window (see setupWindow()), the group is joined by the swapping thread before its
+next swap and a warning is logged if that fails.
+\param group The swap group. Groups are numbered from 1. Group 0 removes the window from its swap group.
+\return `true` if swap groups are supported and, for the main window, the group was joined. */
+bool CX_Display::joinSwapGroup(unsigned int group) {
+	if (!Private::swapGroupsSupported()) {
+		CX::Instances::Log.warning("CX_Display") << "joinSwapGroup(): Swap groups (NV_swap_group) are not supported.";
+		return false;
+	}
+
+	if (_window) {
+		_swapThread->setSwapGroup(group);
+		return true;
+	}
+
+	if (!Private::joinSwapGroup(group)) {
+		CX::Instances::Log.warning("CX_Display") << "joinSwapGroup(): Swap group " << group << " could not be joined.";
+		return false;
+	}
+	return true;
+}
+
+/*! Sets whether buffer swap times come from the windowing system instead of from the time at which the swap returned.
+With a compositor or a driver that queues frames, the time at which `glfwSwapBuffers()` returns can be a frame or more
+away from the time at which the frame was actually presented. When presentation timestamps are in use, the time at which the
+frame was presented is used by getLastSwapTime(), CX_SlidePresenter, and CX_VideoRecorder. They are used by default when they
+are available, which is with `GLX_OML_sync_control` on Linux and with the Desktop Window Manager on Windows. If they are not
+available, or if the timestamps that are reported are not plausible, the time at which the swap returned is used.
+\param use If `true`, use presentation timestamps when they are available.
+\see getPresentationTimestampSource() */
+void CX_Display::usePresentationTimestamps(bool use) {
+	_presentationTimestamps.setEnabled(use);
+}
+
+/*! Returns the source of the buffer swap times: "GLX_OML_sync_control", "DWM", or "CPU" if the time at which the swap
+returned is used. See usePresentationTimestamps(). */
+std::string CX_Display::getPresentationTimestampSource(void) const {
+	return Private::CX_PresentationTimestamps::sourceToString(_presentationTimestamps.getSource());
+}
+
+/*! Sets the time from a buffer swap (as given by getLastSwapTime()) until the swapped in frame is actually visible, e.g.
+at the top left corner of the screen. This is usually measured with a light sensor using CX_LatencyCalibration. It is
+not used for the timing of buffer swaps, but CX_SlidePresenter adds it to the start times of slides to give the times at
+which the slides appeared (see CX_SlidePresenter::Slide::onsetTime).
+\param latency The presentation latency. */
+void CX_Display::setPresentationLatency(CX_Millis latency) {
+	_presentationLatency = latency;
+}
+
+/*! Returns the presentation latency that was set with setPresentationLatency(), or 0 if none was set. */
+CX_Millis CX_Display::getPresentationLatency(void) const {
+	return _presentationLatency;
+}
+
 /*! Sets whether the display is using software VSync to control frame presentation.
 Without some form of Vsync, vertical tearing can occur. Hardware VSync, if available,
 is generally preferable to software VSync, so see useHardwareVSync() as well. However,
@@ -470,11 +806,35 @@ the FBO will produce the same output as rendering into the back buffer.
 */
 ofFbo CX_Display::makeFbo(void) {
 	ofFbo fbo;
-	ofRectangle dims = CX::Instances::Disp.getResolution();
+	ofRectangle dims = getResolution();
 	fbo.allocate(dims.width, dims.height, GL_RGBA, CX::Util::getMsaaSampleCount());
 	return fbo;
 }
 
+/*! Makes an `ofFbo` that is the size of a texture from the texture loader (see getTextureLoader()) and draws the texture
+into it. If the texture is not loaded yet, this waits for it.
+\param textureId The id of the image, from CX_TextureLoader::load().
+\param timeout How long to wait for the texture to be loaded.
+\return The framebuffer. If the texture could not be loaded, it is not allocated. */
+ofFbo CX_Display::makeFbo(unsigned int textureId, CX_Millis timeout) {
+	ofFbo fbo;
+	if (!_textureLoader.waitUntilReady(textureId, timeout)) {
+		CX::Instances::Log.error("CX_Display") << "makeFbo(): Texture " << textureId << " could not be loaded.";
+		return fbo;
+	}
+
+	ofTexture& texture = _textureLoader.getTexture(textureId);
+	fbo.allocate(texture.getWidth(), texture.getHeight(), GL_RGBA, CX::Util::getMsaaSampleCount());
+	fbo.begin();
+	ofClear(0, 0);
+	ofPushStyle();
+	ofSetColor(255);
+	texture.draw(0, 0);
+	ofPopStyle();
+	fbo.end();
+	return fbo;
+}
+
 /*! Copies an `ofFbo` to the back buffer using a potentially very slow but pixel-perfect blitting operation.
 The slowness of the operation is hardware-dependent, with older hardware often being faster at this operation.
 Generally, you should just draw the `ofFbo` directly using its `draw()` function.
@@ -570,10 +930,13 @@ void CX_Display::_blitFboToBackBuffer(ofFbo& fbo, ofRectangle sourceCoordinates,
 		break;
 	}
 
-	glDrawBuffer(GL_BACK);
-
 	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo.getFbo());
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0); //GL_BACK
+	if (_window) {
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _windowFbos[_drawingSlot].getFbo()); //The back buffer of a display with its own window.
+	} else {
+		glDrawBuffer(GL_BACK);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0); //GL_BACK
+	}
 
 	glBlitFramebuffer(sx0, sy0, sx1, sy1, dx0, dy0, dx1, dy1, GL_COLOR_BUFFER_BIT, GL_LINEAR);
 }
@@ -584,6 +947,7 @@ void CX_Display::_blitFboToBackBuffer(ofFbo& fbo, ofRectangle sourceCoordinates,
 void CX_Display::setYIncreasesUpwards(bool upwards) {
 	//when vFlip is true, y-values increase downwards.
 	ofSetOrientation(ofGetOrientation(), !upwards);
+	_leanViewport = ofRectangle(); //The projection depends on the orientation, so it must be set up again.
 }
 
 /*! \brief Do y-axis values increase upwards? */
@@ -592,6 +956,24 @@ bool CX_Display::getYIncreasesUpwards(void) const {
 	return !ofIsVFlipped();
 }
 
+/*! Returns the texture loader of the display, which loads images into textures on a background thread.
+It is updated each time beginDrawingToBackBuffer() is called. See CX::CX_TextureLoader. */
+CX_TextureLoader& CX_Display::getTextureLoader(void) {
+	return _textureLoader;
+}
+
+/*! Returns the frame capture of the display, which reads framebuffers and the back buffer back asynchronously and processes
+the pixels on worker threads. It is updated each time beginDrawingToBackBuffer() is called. See CX::CX_FrameCapture. */
+CX_FrameCapture& CX_Display::getFrameCapture(void) {
+	return _frameCapture;
+}
+
+/*! Returns the video recorder of the display, which can record everything that is drawn with the display.
+See CX::CX_VideoRecorder. */
+CX_VideoRecorder& CX_Display::getVideoRecorder(void) {
+	return _videoRecorder;
+}
+
 /*! \brief Get a `shared_ptr` to the renderer used by the CX_Display. */
 #if OF_VERSION_MAJOR == 0 && OF_VERSION_MINOR == 9 && OF_VERSION_PATCH >= 0
 std::shared_ptr<ofBaseRenderer> CX_Display::getRenderer(void) {
@@ -792,7 +1174,7 @@ std::map<std::string, CX_DataFrame> CX_Display::testBufferSwapping(CX_Millis des
 
 				} else {
 
-					CX::Instances::Clock.delay(CX_Millis(200));
+					CX::Instances::Clock.sleepUntil(CX::Instances::Clock.now() + CX_Millis(200));
 
 					CX_Millis startTime = CX::Instances::Clock.now();
 					while ((CX::Instances::Clock.now() - startTime) < testSegmentDuration) {
@@ -852,7 +1234,7 @@ std::map<std::string, CX_DataFrame> CX_Display::testBufferSwapping(CX_Millis des
 											   ofRectangle(resolution.width / 3, 0, resolution.width / 3, resolution.height),
 											   "Wait swap test\n" + conditionString);
 
-						CX::Instances::Clock.delay(period * 2.5);
+						CX::Instances::Clock.sleepUntil(CX::Instances::Clock.now() + period * 2.5);
 
 						swapBuffers();
 						swapTimes.push_back(CX::Instances::Clock.now());
@@ -926,4 +1308,8 @@ std::map<std::string, CX_DataFrame> CX_Display::testBufferSwapping(CX_Millis des
 	return data;
 }
 
+GLFWwindow* CX_Display::_getWindow(void) const {
+	return (_window != nullptr) ? _window : CX::Private::glfwContext;
+}
+
 } //namespace CX
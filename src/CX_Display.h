@@ -22,6 +22,10 @@ draw stimuli with openFrameworks: See the graphics and 3d sections of this page:
 #include "CX_Clock.h"
 #include "CX_Logger.h"
 #include "CX_VideoBufferSwappingThread.h"
+#include "CX_PresentationTimestamps.h"
+#include "CX_TextureLoader.h"
+#include "CX_FrameCapture.h"
+#include "CX_VideoRecorder.h"
 #include "CX_DataFrame.h"
 
 namespace CX {
@@ -31,17 +35,64 @@ namespace CX {
 	monitor. It is also a bit abstract in that it does not draw anything, but only creates a context in which
 	things can be drawn.
 
-	An instance of this class is created for the user. It is called \ref CX::Instances::Disp. The user should not
-	need another instance of this class.
+	An instance of this class is created for the user. It is called \ref CX::Instances::Disp. It uses the main window.
+
+	Other instances can be given their own windows with setupWindow(), for example for a view for the experimenter on a second
+	monitor or for the two eyes of a stereoscope. All of the displays share the OpenGL context of the main window, so textures,
+	framebuffers, and shaders can be used with any display, and all drawing is done on the main thread as usual. A display with
+	its own window renders into a framebuffer in the main context, which the buffer swapping thread of that display copies into
+	its window just before each swap, so each display swaps independently (on its own thread) and the main thread never blocks on
+	the swaps of more than one display. Where the driver supports `NV_swap_group`, displays can be made to swap together with
+	joinSwapGroup(). A CX_SlidePresenter is given the display to present on with CX_SlidePresenter::Configuration::display.
+
+	\code{.cpp}
+	CX_Display experimenterView;
+	CX_Display::WindowConfiguration windowConfig;
+	windowConfig.monitor = 1; //Full screen on the second monitor.
+	experimenterView.setupWindow(windowConfig);
+	experimenterView.setAutomaticSwapping(true);
+
+	experimenterView.beginDrawingToBackBuffer();
+	ofBackground(50);
+	ofDrawBitmapString("Trial 1", 20, 20);
+	experimenterView.endDrawingToBackBuffer(); //Shown from the next swap of experimenterView on.
+	\endcode
 
 	\ingroup video
 	*/
 	class CX_Display {
 	public:
+
+		/*! The window of a display that has its own window. See setupWindow(). */
+		struct WindowConfiguration {
+			WindowConfiguration(void) :
+				width(800),
+				height(600),
+				monitor(-1),
+				position(0, 0),
+				decorated(true),
+				title("CX")
+			{}
+
+			/*! The width of the window, in pixels. If the window is full screen and this or `height` is not greater than 0,
+			the resolution of the monitor is used. */
+			int width;
+			int height; //!< The height of the window, in pixels.
+
+			/*! The index of the monitor on which the window is full screen, or -1 for a window that is not full screen. */
+			int monitor;
+
+			ofPoint position; //!< The position of a window that is not full screen.
+			bool decorated; //!< If `false`, a window that is not full screen has no border or title bar.
+			std::string title; //!< The title of a window that is not full screen.
+		};
+
 		CX_Display(void);
 		~CX_Display(void);
 
 		void setup(void);
+		bool setupWindow(const WindowConfiguration& config);
+		bool hasOwnWindow(void) const;
 		void configureFromFile(std::string filename, std::string delimiter = "=", bool trimWhitespace = true, std::string commentString = "//");
 
 		void setFullscreen(bool fullscreen);
@@ -50,8 +101,17 @@ namespace CX {
 
 		void useHardwareVSync(bool b);
 		void useSoftwareVSync(bool b);
+		bool useAdaptiveVSync(bool b);
+		bool joinSwapGroup(unsigned int group);
+
+		void usePresentationTimestamps(bool use);
+		std::string getPresentationTimestampSource(void) const;
 
-		
+		void setPresentationLatency(CX_Millis latency);
+		CX_Millis getPresentationLatency(void) const;
+
+		void setLeanRendering(bool lean);
+		bool isLeanRendering(void) const;
 
 		void beginDrawingToBackBuffer(void);
 		void endDrawingToBackBuffer(void);
@@ -63,6 +123,7 @@ namespace CX {
 
 		bool hasSwappedSinceLastCheck(void);
 		void waitForBufferSwap(void);
+		bool waitForBufferSwap(CX_Millis timeout);
 		CX_Millis getLastSwapTime(void) const;
 		CX_Millis estimateNextSwapTime(void) const;
 		uint64_t getFrameNumber(void) const;
@@ -70,7 +131,7 @@ namespace CX {
 		void estimateFramePeriod(CX_Millis estimationInterval, float minRefreshRate = 40, float maxRefreshRate = 160);
 		CX_Millis getFramePeriod(void) const;
 		CX_Millis getFramePeriodStandardDeviation(void) const;
-		void setFramePeriod(CX_Millis knownPeriod);
+		void setFramePeriod(CX_Millis knownPeriod, CX_Millis standardDeviation = CX_Millis(0));
 
 		void setWindowResolution(int width, int height);
 		ofRectangle getResolution(void) const;
@@ -81,6 +142,7 @@ namespace CX {
 		std::map<std::string, CX_DataFrame> testBufferSwapping(CX_Millis desiredTestDuration, bool testSecondaryThread);
 
 		ofFbo makeFbo(void);
+		ofFbo makeFbo(unsigned int textureId, CX_Millis timeout = CX_Seconds(10));
 		void copyFboToBackBuffer(ofFbo &fbo);
 		void copyFboToBackBuffer(ofFbo &fbo, ofPoint destination);
 		void copyFboToBackBuffer(ofFbo &fbo, ofRectangle source, ofPoint destination);
@@ -88,6 +150,10 @@ namespace CX {
 		void setYIncreasesUpwards(bool upwards);
 		bool getYIncreasesUpwards(void) const;
 
+		CX_TextureLoader& getTextureLoader(void);
+		CX_FrameCapture& getFrameCapture(void);
+		CX_VideoRecorder& getVideoRecorder(void);
+
 #if OF_VERSION_MAJOR == 0 && OF_VERSION_MINOR == 9 && OF_VERSION_PATCH >= 0
 		std::shared_ptr<ofBaseRenderer> getRenderer(void);
 #else
@@ -104,15 +170,34 @@ namespace CX {
 
 		std::unique_ptr<Private::CX_VideoBufferSwappingThread> _swapThread;
 
+		//For a display with its own window. Frames are drawn into the framebuffers alternately.
+		GLFWwindow* _window;
+		ofFbo _windowFbos[2];
+		unsigned int _drawingSlot;
+		ofRectangle _windowResolution;
+		bool _windowFullscreen;
+
+		Private::CX_PresentationTimestamps _presentationTimestamps;
+		std::atomic<int64_t> _lastManualSwapNanos;
+
+		CX_TextureLoader _textureLoader;
+		CX_FrameCapture _frameCapture;
+		CX_VideoRecorder _videoRecorder;
+
 		CX_Millis _framePeriod;
 		CX_Millis _framePeriodStandardDeviation;
+		CX_Millis _presentationLatency;
 
 		uint64_t _manualBufferSwaps;
 		uint64_t _frameNumberOnLastSwapCheck;
 
 		bool _softVSyncWithGLFinish;
 
+		bool _leanRendering;
+		ofRectangle _leanViewport;
+
 		void _blitFboToBackBuffer(ofFbo& fbo, ofRectangle sourceCoordinates, ofRectangle destinationCoordinates);
+		GLFWwindow* _getWindow(void) const;
 
 	};
 
@@ -1,5 +1,11 @@
 ﻿#include "CX_Draw.h"
 
+#include <list>
+#include <map>
+#include <functional>
+#include <iterator>
+#include <thread>
+
 #include "CX_Display.h"
 
 #include "../libs/colorspace/colorspace.h"
@@ -45,6 +51,244 @@ struct LineSegment {
 
 // \endcond
 
+// \cond INTERNAL_DOCS
+//The meshes of shapes are cached, keyed by the type of shape and its parameters, so that shapes that are drawn
+//over and over are not rebuilt and tessellated every time. All cached meshes are centered on (0, 0) and made
+//of indexed triangles, so that they can be appended to a Batch.
+enum class ShapeType : int {
+	CIRCLE,
+	RING,
+	ARC,
+	SQUIRCLE,
+	STAR,
+	FIXATION_CROSS
+};
+
+struct ShapeKey {
+	ShapeType type;
+	std::vector<float> parameters;
+
+	bool operator<(const ShapeKey& k) const {
+		if (type != k.type) {
+			return type < k.type;
+		}
+		return parameters < k.parameters;
+	}
+};
+
+class ShapeCache {
+public:
+	ShapeCache(void) :
+		_capacity(256)
+	{}
+
+	ofVboMesh& get(const ShapeKey& key, std::function<ofMesh(void)> build) {
+		auto it = _meshes.find(key);
+		if (it != _meshes.end()) {
+			_recentlyUsed.splice(_recentlyUsed.begin(), _recentlyUsed, it->second.second);
+			return it->second.first;
+		}
+
+		while (!_recentlyUsed.empty() && _meshes.size() >= _capacity) {
+			_meshes.erase(_recentlyUsed.back());
+			_recentlyUsed.pop_back();
+		}
+
+		_recentlyUsed.push_front(key);
+
+		ofVboMesh& mesh = _meshes[key].first;
+		mesh = ofVboMesh(build());
+		mesh.setUsage(GL_STATIC_DRAW);
+		_meshes[key].second = _recentlyUsed.begin();
+		return mesh;
+	}
+
+	void setCapacity(unsigned int capacity) {
+		_capacity = std::max<unsigned int>(capacity, 1);
+		while (_meshes.size() > _capacity) {
+			_meshes.erase(_recentlyUsed.back());
+			_recentlyUsed.pop_back();
+		}
+	}
+
+	void clear(void) {
+		_meshes.clear();
+		_recentlyUsed.clear();
+	}
+
+private:
+	unsigned int _capacity;
+	std::list<ShapeKey> _recentlyUsed;
+	std::map<ShapeKey, std::pair<ofVboMesh, std::list<ShapeKey>::iterator>> _meshes;
+};
+
+ShapeCache& getShapeCache(void) {
+	static ShapeCache cache;
+	return cache;
+}
+
+//Converts a mesh made of triangles, a triangle strip, or a triangle fan to the indices of a list of triangles.
+std::vector<ofIndexType> getTriangleIndices(const ofMesh& mesh) {
+	std::vector<ofIndexType> indices = mesh.getIndices();
+	if (indices.empty()) {
+		for (ofIndexType i = 0; i < mesh.getNumVertices(); i++) {
+			indices.push_back(i);
+		}
+	}
+
+	if (mesh.getMode() == OF_PRIMITIVE_TRIANGLES) {
+		return indices;
+	}
+
+	std::vector<ofIndexType> triangles;
+	for (size_t i = 2; i < indices.size(); i++) {
+		if (mesh.getMode() == OF_PRIMITIVE_TRIANGLE_STRIP) {
+			triangles.push_back(indices[i - 2]);
+			triangles.push_back(indices[i - 1]);
+		} else if (mesh.getMode() == OF_PRIMITIVE_TRIANGLE_FAN) {
+			triangles.push_back(indices[0]);
+			triangles.push_back(indices[i - 1]);
+		}
+		triangles.push_back(indices[i]);
+	}
+	return triangles;
+}
+
+//Makes a mesh of triangles from vertices that form a triangle strip.
+ofMesh stripToTriangleMesh(const std::vector<ofPoint>& vertices) {
+	ofMesh strip;
+	strip.setMode(OF_PRIMITIVE_TRIANGLE_STRIP);
+	strip.addVertices(vertices);
+
+	ofMesh mesh;
+	mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+	mesh.addVertices(vertices);
+	mesh.addIndices(getTriangleIndices(strip));
+	return mesh;
+}
+
+//Makes a mesh of triangles that fan out from the first vertex.
+ofMesh fanToTriangleMesh(const std::vector<ofPoint>& vertices) {
+	ofMesh fan;
+	fan.setMode(OF_PRIMITIVE_TRIANGLE_FAN);
+	fan.addVertices(vertices);
+
+	ofMesh mesh;
+	mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+	mesh.addVertices(vertices);
+	mesh.addIndices(getTriangleIndices(fan));
+	return mesh;
+}
+
+ofVboMesh& getCircleMesh(float radius, unsigned int resolution) {
+	ShapeKey key = { ShapeType::CIRCLE, { radius, (float)resolution } };
+	return getShapeCache().get(key, [=](void) {
+		std::vector<ofPoint> vertices(1, ofPoint(0, 0));
+		for (unsigned int i = 0; i <= resolution; i++) {
+			float angle = TWO_PI * i / resolution;
+			vertices.push_back(ofPoint(radius * cos(angle), radius * sin(angle)));
+		}
+		return fanToTriangleMesh(vertices);
+	});
+}
+
+ofVboMesh& getRingMesh(float radius, float width, unsigned int resolution) {
+	ShapeKey key = { ShapeType::RING, { radius, width, (float)resolution } };
+	return getShapeCache().get(key, [=](void) {
+		float halfWidth = width / 2;
+		std::vector<ofPoint> vertices;
+		for (unsigned int i = 0; i <= resolution; i++) {
+			float angle = TWO_PI * (i % resolution) / resolution;
+			ofPoint unit(cos(angle), sin(angle));
+			vertices.push_back(unit * (radius + halfWidth));
+			vertices.push_back(unit * (radius - halfWidth));
+		}
+		return stripToTriangleMesh(vertices);
+	});
+}
+
+ofVboMesh& getArcMesh(float radiusX, float radiusY, float width, float angleBegin, float angleEnd, unsigned int resolution) {
+	ShapeKey key = { ShapeType::ARC, { radiusX, radiusY, width, angleBegin, angleEnd, (float)resolution } };
+	return getShapeCache().get(key, [=](void) {
+		float d = width / 2;
+		unsigned int vertexCount = resolution + 1;
+
+		std::vector<ofPoint> vertices(2 * vertexCount);
+		for (unsigned int i = 0; i < vertexCount; i++) {
+			float angle = (angleEnd - angleBegin) * i / (vertexCount - 1) + angleBegin;
+			angle = angle * PI / 180;
+
+			vertices[(2 * i)] = ofPoint((radiusX - d) * cos(angle), (radiusY - d) * sin(angle));
+			vertices[(2 * i) + 1] = ofPoint((radiusX + d) * cos(angle), (radiusY + d) * sin(angle));
+		}
+		return stripToTriangleMesh(vertices);
+	});
+}
+
+ofVboMesh& getSquircleMesh(double radius, double amount, double rotationDeg) {
+	ShapeKey key = { ShapeType::SQUIRCLE, { (float)radius, (float)amount, (float)rotationDeg } };
+	return getShapeCache().get(key, [=](void) {
+		ofPath sq = squircleToPath(radius, amount);
+		sq.setFilled(true);
+		sq.rotate(rotationDeg, ofVec3f(0, 0, 1));
+
+		const ofMesh& tess = sq.getTessellation();
+
+		ofMesh mesh;
+		mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+		mesh.addVertices(tess.getVertices());
+		mesh.addIndices(getTriangleIndices(tess));
+		return mesh;
+	});
+}
+
+ofVboMesh& getStarMesh(unsigned int numberOfPoints, float innerRadius, float outerRadius, float rotationDeg) {
+	//The direction of the star depends on which way y increases.
+	bool yUp = CX::Instances::Disp.getYIncreasesUpwards();
+	ShapeKey key = { ShapeType::STAR, { (float)numberOfPoints, innerRadius, outerRadius, rotationDeg, (float)yUp } };
+	return getShapeCache().get(key, [=](void) {
+		std::vector<ofPoint> vertices = getStarVertices(numberOfPoints, innerRadius, outerRadius, rotationDeg);
+		vertices.insert(vertices.begin(), ofPoint(0, 0));
+		return fanToTriangleMesh(vertices);
+	});
+}
+
+ofVboMesh& getFixationCrossMesh(float armLength, float armWidth) {
+	ShapeKey key = { ShapeType::FIXATION_CROSS, { armLength, armWidth } };
+	return getShapeCache().get(key, [=](void) {
+		//The cross is a vertical bar and two horizontal arms, which do not overlap.
+		ofMesh mesh;
+		mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+		mesh.addVertices(getFixationCrossVertices(armLength, armWidth));
+
+		ofIndexType indices[] = { 0, 1, 6, 0, 6, 7, 2, 3, 4, 2, 4, 5, 8, 9, 10, 8, 10, 11 };
+		mesh.addIndices(std::vector<ofIndexType>(std::begin(indices), std::end(indices)));
+		return mesh;
+	});
+}
+
+void drawCachedMesh(ofVboMesh& mesh, ofPoint location) {
+	ofPushMatrix();
+	ofTranslate(location);
+	mesh.draw();
+	ofPopMatrix();
+}
+// \endcond
+
+/*! Sets the number of shapes whose meshes are kept by functions like Draw::ring(), Draw::arc(), Draw::star(),
+Draw::squircle(), and Draw::fixationCross(), and by Draw::Batch. Each of these functions builds the mesh of the shape
+for the given parameters (other than location) once and reuses it each time that it is called with the same parameters.
+When more than `capacity` different shapes have been drawn, the least recently used shapes are removed from the cache.
+\param capacity The number of shapes to keep. Defaults to 256. */
+void setShapeCacheCapacity(unsigned int capacity) {
+	getShapeCache().setCapacity(capacity);
+}
+
+/*! Removes all of the shapes from the shape cache. See setShapeCacheCapacity(). */
+void clearShapeCache(void) {
+	getShapeCache().clear();
+}
+
 
 /*! This function draws an approximation of a squircle (http://en.wikipedia.org/wiki/Squircle) using Bezier curves
 to an ofPath. The squircle will be centered on (0,0) in the ofPath.
@@ -86,14 +330,7 @@ approximation of a squircle, but different amounts can give different sorts of s
 \note If more control over the drawing of the squircle is desired, use squircleToPath() and then modify the ofPath.
 */
 void squircle(ofPoint center, double radius, double amount, double rotationDeg) {
-	ofPath sq = squircleToPath(radius, amount);
-
-	sq.setColor(ofGetStyle().color);
-	sq.setFilled(true);
-
-	sq.rotate(rotationDeg, ofVec3f(0, 0, 1));
-
-	sq.draw(center.x, center.y);
+	drawCachedMesh(getSquircleMesh(radius, amount, rotationDeg), center);
 }
 
 /*! Draws an arrow to an ofPath. The outline of the arrow is drawn with strokes, so you can
@@ -200,19 +437,7 @@ the star hit.
 Positive values rotate the star counter-clockwise.
 */
 void star(ofPoint center, unsigned int numberOfPoints, float innerRadius, float outerRadius, float rotationDeg) {
-
-	std::vector<ofPoint> vertices = getStarVertices(numberOfPoints, innerRadius, outerRadius, rotationDeg);
-
-	for (unsigned int i = 0; i < vertices.size(); i++) {
-		vertices[i] += center;
-	}
-
-	vertices.insert(vertices.begin(), center);
-
-	ofVbo vbo;
-	vbo.setVertexData(vertices.data(), vertices.size(), GL_STATIC_DRAW);
-
-	vbo.draw(GL_TRIANGLE_FAN, 0, vertices.size());
+	drawCachedMesh(getStarMesh(numberOfPoints, innerRadius, outerRadius, rotationDeg), center);
 }
 
 /*! Equivalent to a call to CX::Draw::centeredString(ofPoint, std::string, ofTrueTypeFont&) 
@@ -232,6 +457,9 @@ void centeredString(int x, int y, std::string s, ofTrueTypeFont &font) {
 drawn such that the x coordinate gives the left edge of the string and the y coordinate
 gives the line above which the letters will be drawn, where some characters (like y or g) 
 can descend below the line.
+
+The string is measured every time this is called. To draw the same string on many frames, use a Draw::TextLayout, which
+measures it once.
 \param center The coordinates of the center of the string.
 \param s The string to draw.
 \param font A font that has already been prepared for use.
@@ -254,22 +482,9 @@ but that function can break in various ways.
 \param circleJoins Whether each junction of two lines should have a circle drawn over it.
 */
 void lines(std::vector<ofPoint> points, float lineWidth, bool circleJoins) {
-	if (points.size() < 2) {
-		return;
-	}
-
-	float d = lineWidth / 2;
-	Draw::line(points[0], points[1], lineWidth);
-	for (unsigned int i = 1; i < points.size() - 1; i++) {
-		if (circleJoins) {
-			ofCircle(points[i], d);
-		}
-		Draw::line(points[i], points[i + 1], lineWidth);
-	}
-
-	if (circleJoins && (points.back() == points.front())) {
-		ofCircle(points.front(), d);
-	}
+	Batch batch;
+	batch.lines(points, lineWidth, circleJoins);
+	batch.draw();
 }
 
 /*! This function draws a line from p1 to p2 with the given width. Note that this function is purely 2D:
@@ -301,17 +516,7 @@ void line(ofPoint p1, ofPoint p2, float width) {
 the unfilled circle cannot be set to a value greater than 1 with ofCircle.
 */
 void ring(ofPoint center, float radius, float width, unsigned int resolution) {
-	float halfWidth = width / 2;
-
-	ofPath path;
-	path.setCircleResolution(resolution);
-	path.moveTo(center + ofPoint(radius + halfWidth, 0));
-	path.circle(center, radius + halfWidth);
-	path.moveTo(center + ofPoint(radius - halfWidth, 0));
-	path.circle(center, radius - halfWidth);
-	
-	ofMesh tess = path.getTessellation();
-	tess.draw(ofPolyRenderMode::OF_MESH_FILL);
+	drawCachedMesh(getRingMesh(radius, width, resolution), center);
 }
 
 /*! Draw an arc around a central point. If radiusX and radiusY are equal, the arc will be like a section of a circle. If they
@@ -326,23 +531,7 @@ are unequal, the arc will be a section of an ellipse.
 \note This uses an ofVbo internally. If VBOs are not supported by your video card, this may not work at all.
 */
 void arc(ofPoint center, float radiusX, float radiusY, float width, float angleBegin, float angleEnd, unsigned int resolution) {
-
-	float d = width / 2;
-	unsigned int vertexCount = resolution + 1;
-
-	vector<ofPoint> vertices(2 * vertexCount);
-
-	for (unsigned int i = 0; i < vertexCount; i++) {
-		float angle = (angleEnd - angleBegin) * i / (vertexCount - 1) + angleBegin;
-		angle = angle * PI / 180;
-
-		vertices[(2 * i)] = center + ofPoint((radiusX - d) * cos(angle), (radiusY - d) * sin(angle));
-		vertices[(2 * i) + 1] = center + ofPoint((radiusX + d) * cos(angle), (radiusY + d) * sin(angle));
-	}
-
-	ofVbo vbo;
-	vbo.setVertexData(vertices.data(), vertices.size(), GL_STATIC_DRAW);
-	vbo.draw(GL_TRIANGLE_STRIP, 0, vertices.size());
+	drawCachedMesh(getArcMesh(radiusX, radiusY, width, angleBegin, angleEnd, resolution), center);
 }
 
 
@@ -448,20 +637,149 @@ Make sure they are clamped to reasonable values if they are to be used directly.
 (something to RGB).
 */
 std::vector<double> convertColors(std::string conversionFormula, double S1, double S2, double S3) {
-	std::vector<num> dest(3, 0);
-	colortransform cTrans;
+	//Keep the last transform that was used, so that converting many colors with the same formula only parses it once.
+	static thread_local ColorTransform lastTransform;
+
+	std::vector<double> dest(3, 0);
+
+	if (lastTransform.getFormula() != conversionFormula || !lastTransform.isValid()) {
+		if (!lastTransform.setup(conversionFormula)) {
+			return dest;
+		}
+	}
+
+	lastTransform.apply(S1, S2, S3, &dest[0], &dest[1], &dest[2]);
+
+	return dest;
+}
+
+////////////////////
+// ColorTransform //
+////////////////////
+
+struct ColorTransform::Compiled {
+	colortransform transform;
+};
+
+/*! Constructs a ColorTransform that is not valid. Call setup() before using it. */
+ColorTransform::ColorTransform(void) {}
+
+/*! Constructs a ColorTransform and calls setup() with `conversionFormula`. */
+ColorTransform::ColorTransform(std::string conversionFormula) {
+	setup(conversionFormula);
+}
+
+/*! Parses a color conversion formula.
+\param conversionFormula A formula of the format "SRC -> DEST". See convertColors() for the details.
+\return `true` if the formula was valid, `false` otherwise. If the formula was not valid, an error is logged and the
+transform will leave colors unchanged. */
+bool ColorTransform::setup(std::string conversionFormula) {
+	_formula = conversionFormula;
 
-	if (((conversionFormula.find("->") == std::string::npos) && (conversionFormula.find("<-") == std::string::npos)) || 
-		!GetColorTransform(&cTrans, conversionFormula.c_str()))
+	std::shared_ptr<Compiled> compiled = std::make_shared<Compiled>();
+
+	if (((conversionFormula.find("->") == std::string::npos) && (conversionFormula.find("<-") == std::string::npos)) ||
+		!GetColorTransform(&compiled->transform, conversionFormula.c_str()))
 	{
-		CX::Instances::Log.error() << "CX::Draw::convertColors: Invalid syntax or unknown color space. The provided conversion formula was \"" << 
+		CX::Instances::Log.error() << "CX::Draw::ColorTransform: Invalid syntax or unknown color space. The provided conversion formula was \"" <<
 			conversionFormula << "\"" << endl;
-		return dest;
+		_compiled = nullptr;
+		return false;
 	}
 
-	ApplyColorTransform(cTrans, &dest[0], &dest[1], &dest[2], S1, S2, S3);
+	_compiled = compiled;
+	return true;
+}
 
-	return dest;
+/*! Returns `true` if the formula given to setup() was valid. */
+bool ColorTransform::isValid(void) const {
+	return _compiled != nullptr;
+}
+
+/*! Returns the formula given to setup(). */
+std::string ColorTransform::getFormula(void) const {
+	return _formula;
+}
+
+/*! Converts one color. If the transform is not valid, the destination coordinates are set to 0.
+\param S1 Source coordinate 1. Corresponds to, e.g., the R in RGB.
+\param S2 Source coordinate 2.
+\param S3 Source coordinate 3.
+\param D1 Pointer to destination coordinate 1.
+\param D2 Pointer to destination coordinate 2.
+\param D3 Pointer to destination coordinate 3. */
+void ColorTransform::apply(double S1, double S2, double S3, double* D1, double* D2, double* D3) const {
+	if (!_compiled) {
+		*D1 = *D2 = *D3 = 0;
+		return;
+	}
+	ApplyColorTransform(_compiled->transform, D1, D2, D3, S1, S2, S3);
+}
+
+/*! Converts `count` colors. The coordinates are interleaved, so `in` and `out` each
+hold `3 * count` values. `in` and `out` may be the same array. If the transform is not valid,
+`out` is set to 0.
+
+The color space functions are looked up once for the whole batch and called directly,
+so this is much faster than calling convertColors() for each color. */
+void ColorTransform::apply(const float* in, float* out, size_t count) const {
+	if (!_compiled) {
+		std::fill(out, out + 3 * count, 0.0f);
+		return;
+	}
+
+	const colortransform& t = _compiled->transform;
+	for (size_t i = 0; i < 3 * count; i += 3) {
+		num d0 = in[i];
+		num d1 = in[i + 1];
+		num d2 = in[i + 2];
+		for (int stage = 0; stage < t.NumStages; stage++) {
+			t.Fun[stage](&d0, &d1, &d2, d0, d1, d2);
+		}
+		out[i] = (float)d0;
+		out[i + 1] = (float)d1;
+		out[i + 2] = (float)d2;
+	}
+}
+
+/*! \copydoc ColorTransform::apply(const float*, float*, size_t) const */
+void ColorTransform::apply(const double* in, double* out, size_t count) const {
+	if (!_compiled) {
+		std::fill(out, out + 3 * count, 0.0);
+		return;
+	}
+
+	const colortransform& t = _compiled->transform;
+	for (size_t i = 0; i < 3 * count; i += 3) {
+		num d0 = in[i];
+		num d1 = in[i + 1];
+		num d2 = in[i + 2];
+		for (int stage = 0; stage < t.NumStages; stage++) {
+			t.Fun[stage](&d0, &d1, &d2, d0, d1, d2);
+		}
+		out[i] = d0;
+		out[i + 1] = d1;
+		out[i + 2] = d2;
+	}
+}
+
+/*! Converts one color and returns it as an `ofFloatColor`. This is most useful when the destination color space is RGB. */
+ofFloatColor ColorTransform::toColor(double S1, double S2, double S3) const {
+	double d[3];
+	apply(S1, S2, S3, &d[0], &d[1], &d[2]);
+	return ofFloatColor(d[0], d[1], d[2]);
+}
+
+/*! Converts `count` colors with interleaved coordinates in `in` (see apply()) and returns them as `ofFloatColor`s.
+This is most useful when the destination color space is RGB. */
+std::vector<ofFloatColor> ColorTransform::toColors(const float* in, size_t count) const {
+	std::vector<ofFloatColor> colors(count);
+	std::vector<float> out(3 * count);
+	apply(in, out.data(), count);
+	for (size_t i = 0; i < count; i++) {
+		colors[i] = ofFloatColor(out[3 * i], out[3 * i + 1], out[3 * i + 2]);
+	}
+	return colors;
 }
 
 /*! This function converts from an arbitrary color space to the RGB color space. This is convenient, 
@@ -489,6 +807,102 @@ ofFloatColor convertToRGB(std::string inputColorSpace, double S1, double S2, dou
 }
 
 
+/*! Fills `pixels` with uniform random noise, for example for a dynamic noise mask that changes on every frame.
+The pixels are split into bands of rows that are filled in parallel on all of the available cores, each with its
+own stream of random numbers from `rng` (see CX_RandomNumberGenerator::split()), so the noise is the same for
+the same seed no matter how many cores there are. For the fastest fills, use an `rng` with the
+CX_RandomEngine::Type::XOSHIRO256PP engine.
+
+\param pixels The pixels to fill. They must already be allocated. They can have any number of channels.
+\param low The lowest value.
+\param high The highest value (exclusive).
+\param luminance If `true`, the same value is used for all of the color channels of a pixel, so the noise is gray.
+If there is an alpha channel, it is set to 1. If `false`, every channel of every pixel gets its own value.
+\param rng The random number generator that the noise is made from. It is advanced by one split() for each band.
+
+\code{.cpp}
+ofFloatPixels noisePixels;
+noisePixels.allocate(Disp.getResolution().x, Disp.getResolution().y, OF_PIXELS_RGB);
+ofTexture noiseTexture;
+noiseTexture.allocate(noisePixels);
+
+//On each frame:
+Draw::fillNoise(noisePixels);
+noiseTexture.loadData(noisePixels);
+noiseTexture.draw(0, 0);
+\endcode
+*/
+void fillNoise(ofFloatPixels& pixels, float low, float high, bool luminance, CX_RandomNumberGenerator& rng) {
+	const size_t width = pixels.getWidth();
+	const size_t height = pixels.getHeight();
+	const size_t channels = pixels.getNumChannels();
+	if (width == 0 || height == 0 || channels == 0) {
+		return;
+	}
+
+	const size_t rowsPerBand = 64;
+	const size_t bandCount = (height + rowsPerBand - 1) / rowsPerBand;
+
+	std::vector<CX_RandomNumberGenerator> bandRngs;
+	bandRngs.reserve(bandCount);
+	for (size_t i = 0; i < bandCount; i++) {
+		bandRngs.push_back(rng.split());
+	}
+
+	float* data = pixels.getData();
+	const bool gray = luminance && channels > 1;
+	const size_t colorChannels = (channels == 4 || channels == 2) ? channels - 1 : channels;
+
+	auto fillBand = [&](size_t band, std::vector<float>& scratch) {
+		size_t firstRow = band * rowsPerBand;
+		size_t rows = std::min(rowsPerBand, height - firstRow);
+		float* bandData = data + firstRow * width * channels;
+
+		if (!gray) {
+			bandRngs[band].fillUniform(bandData, rows * width * channels, low, high);
+			return;
+		}
+
+		size_t pixelCount = rows * width;
+		scratch.resize(pixelCount);
+		bandRngs[band].fillUniform(scratch.data(), pixelCount, low, high);
+		for (size_t i = 0; i < pixelCount; i++) {
+			float* px = bandData + i * channels;
+			for (size_t c = 0; c < colorChannels; c++) {
+				px[c] = scratch[i];
+			}
+			if (colorChannels < channels) {
+				px[channels - 1] = 1;
+			}
+		}
+	};
+
+	//Starting a thread costs more than filling a small image, so small images are filled on this thread. The bands and
+	//their random number generators do not depend on the thread count, so the noise is the same either way.
+	const size_t minPixelsPerThread = 65536;
+	size_t threadCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), bandCount);
+	threadCount = std::min(threadCount, std::max<size_t>((width * height) / minPixelsPerThread, 1));
+
+	std::vector<std::thread> threads;
+	for (size_t t = 1; t < threadCount; t++) {
+		threads.push_back(std::thread([&, t](void) {
+			std::vector<float> scratch;
+			for (size_t band = t; band < bandCount; band += threadCount) {
+				fillBand(band, scratch);
+			}
+		}));
+	}
+
+	std::vector<float> scratch;
+	for (size_t band = 0; band < bandCount; band += threadCount) {
+		fillBand(band, scratch);
+	}
+
+	for (std::thread& th : threads) {
+		th.join();
+	}
+}
+
 /*! Gets teh vertices defining the perimeter of a standard fixation cross (plus sign).
 \param armLength The length of the arms of the cross (end to end, not from the center).
 \param armWidth The width of the arms.
@@ -541,9 +955,7 @@ ofPath fixationCrossToPath(float armLength, float armWidth) {
 \param armLength The length of the arms of the cross (end to end, not from the center).
 \param armWidth The width of the arms. */
 void fixationCross(ofPoint location, float armLength, float armWidth) {
-	ofPath path = fixationCrossToPath(armLength, armWidth);
-	path.setColor(ofGetStyle().color);
-	path.draw(location.x, location.y);
+	drawCachedMesh(getFixationCrossMesh(armLength, armWidth), location);
 }
 
 /*! Saves the contents of an ofFbo to an image file. The file type is hinted by the file extension you provide
@@ -560,6 +972,17 @@ void saveFboToFile(ofFbo& fbo, std::string filename) {
 	ofSaveImage(pix, filename, OF_IMAGE_QUALITY_BEST);
 }
 
+/*! Saves the contents of an ofFbo to an image file without stalling the calling thread. Unlike saveFboToFile(),
+the pixels are read back asynchronously and encoded on a worker thread, using the frame capture of CX::Instances::Disp
+(see CX_Display::getFrameCapture() and CX_FrameCapture::saveToFile()). The file is written some time after this function
+returns. Use CX_FrameCapture::waitUntilDone() to wait for all of the files to be written.
+\param fbo The framebuffer to save. It can be drawn into again right away.
+\param filename The path of the file to save. The file extension determines the type of file that is saved.
+\return `true` if the capture was queued, `false` otherwise. */
+bool saveFboToFileAsync(ofFbo& fbo, std::string filename) {
+	return CX::Instances::Disp.getFrameCapture().saveToFile(fbo, filename);
+}
+
 
 // \cond INTERNAL_DOCS
 
@@ -882,7 +1305,285 @@ ofPath lines(std::vector<ofPoint> points, float width, LineCornerMode cornerMode
 	return path;
 }
 
+Batch::Batch(void) {
+	_mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+	_mesh.setUsage(GL_DYNAMIC_DRAW);
+}
+
+/*! Adds a line. See Draw::line(). */
+void Batch::line(ofPoint p1, ofPoint p2, float width) {
+	std::vector<LineSegment> ls = getParallelLineSegments(LineSegment(p1, p2), width / 2);
+
+	ofMesh quad;
+	quad.setMode(OF_PRIMITIVE_TRIANGLES);
+	quad.addVertex(ls[0].p1);
+	quad.addVertex(ls[0].p2);
+	quad.addVertex(ls[1].p1);
+	quad.addVertex(ls[1].p2);
+
+	ofIndexType indices[] = { 0, 1, 2, 1, 2, 3 };
+	quad.addIndices(std::vector<ofIndexType>(std::begin(indices), std::end(indices)));
+
+	triangles(quad);
+}
+
+/*! Adds a series of connected lines. See Draw::lines(std::vector<ofPoint>, float, bool).
+The circles at the joins use the circle resolution from `ofGetStyle()`. */
+void Batch::lines(const std::vector<ofPoint>& points, float lineWidth, bool circleJoins) {
+	if (points.size() < 2) {
+		return;
+	}
+
+	float d = lineWidth / 2;
+	unsigned int resolution = ofGetStyle().circleResolution;
+
+	line(points[0], points[1], lineWidth);
+	for (unsigned int i = 1; i < points.size() - 1; i++) {
+		if (circleJoins) {
+			circle(points[i], d, resolution);
+		}
+		line(points[i], points[i + 1], lineWidth);
+	}
+
+	if (circleJoins && (points.back() == points.front())) {
+		circle(points.front(), d, resolution);
+	}
+}
+
+/*! Adds a filled circle.
+\param center The center of the circle.
+\param radius The radius of the circle.
+\param resolution The number of line segments that the edge of the circle is made of. */
+void Batch::circle(ofPoint center, float radius, unsigned int resolution) {
+	triangles(getCircleMesh(radius, resolution), center);
+}
+
+/*! Adds a ring. See Draw::ring(). */
+void Batch::ring(ofPoint center, float radius, float width, unsigned int resolution) {
+	triangles(getRingMesh(radius, width, resolution), center);
+}
+
+/*! Adds an arc. See Draw::arc(). */
+void Batch::arc(ofPoint center, float radiusX, float radiusY, float width, float angleBegin, float angleEnd, unsigned int resolution) {
+	triangles(getArcMesh(radiusX, radiusY, width, angleBegin, angleEnd, resolution), center);
+}
+
+/*! Adds a squircle. See Draw::squircle(). */
+void Batch::squircle(ofPoint center, double radius, double amount, double rotationDeg) {
+	triangles(getSquircleMesh(radius, amount, rotationDeg), center);
+}
+
+/*! Adds a star. See Draw::star(). */
+void Batch::star(ofPoint center, unsigned int numberOfPoints, float innerRadius, float outerRadius, float rotationDeg) {
+	triangles(getStarMesh(numberOfPoints, innerRadius, outerRadius, rotationDeg), center);
+}
 
+/*! Adds a fixation cross. See Draw::fixationCross(). */
+void Batch::fixationCross(ofPoint location, float armLength, float armWidth) {
+	triangles(getFixationCrossMesh(armLength, armWidth), location);
+}
+
+/*! Adds the triangles of a mesh, which can be used to add shapes that do not have their own function.
+\param mesh A mesh with the mode `OF_PRIMITIVE_TRIANGLES`, `OF_PRIMITIVE_TRIANGLE_STRIP`, or `OF_PRIMITIVE_TRIANGLE_FAN`,
+with or without indices. The current color is used for all of the vertices; the colors of the mesh are ignored.
+\param offset An offset that is added to each vertex of the mesh. */
+void Batch::triangles(const ofMesh& mesh, ofPoint offset) {
+	ofIndexType firstIndex = _mesh.getNumVertices();
+	ofFloatColor color = ofGetStyle().color;
+
+	const std::vector<ofPoint>& vertices = mesh.getVertices();
+	for (const ofPoint& v : vertices) {
+		_mesh.addVertex(v + offset);
+		_mesh.addColor(color);
+	}
+
+	std::vector<ofIndexType> indices = getTriangleIndices(mesh);
+	for (ofIndexType& i : indices) {
+		i += firstIndex;
+	}
+	_mesh.addIndices(indices);
+}
+
+/*! Draws all of the shapes in the batch with a single draw call. */
+void Batch::draw(void) {
+	if (_mesh.getNumIndices() > 0) {
+		_mesh.draw();
+	}
+}
+
+/*! Removes all of the shapes from the batch. */
+void Batch::clear(void) {
+	_mesh.clear();
+	_mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+}
+
+/*! Returns the number of vertices in the batch. */
+size_t Batch::getVertexCount(void) const {
+	return _mesh.getNumVertices();
+}
+
+
+TextLayout::TextLayout(void) :
+	_font(nullptr),
+	_wrapWidth(0),
+	_alignment(Alignment::LEFT),
+	_builtWithYUp(false)
+{
+	_mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+	_mesh.setUsage(GL_STATIC_DRAW);
+}
+
+/*! Constructs the layout and calls setup() with the given arguments. */
+TextLayout::TextLayout(ofTrueTypeFont& font, std::string text, float wrapWidth, Alignment alignment) :
+	TextLayout()
+{
+	setup(font, text, wrapWidth, alignment);
+}
+
+/*! Lays out the text. This is where all of the measuring and wrapping happens, so it should be done once, before the text
+is drawn, rather than on every frame.
+\param font The font to draw with. It must be loaded and it must outlive the layout.
+\param text The text. Newlines in the text always start a new line.
+\param wrapWidth If greater than 0, lines are wrapped to be less than this wide, in pixels. See Util::wordWrap().
+\param alignment How the lines are aligned with each other.
+\return `false` if the font is not loaded, in which case the layout is empty. */
+bool TextLayout::setup(ofTrueTypeFont& font, std::string text, float wrapWidth, Alignment alignment) {
+	clear();
+
+	if (!font.isLoaded()) {
+		CX::Instances::Log.error("Draw") << "TextLayout::setup(): The font is not loaded.";
+		return false;
+	}
+
+	_font = &font;
+	_wrapWidth = wrapWidth;
+	_alignment = alignment;
+
+	//Explicit newlines are kept and each paragraph is wrapped on its own.
+	for (const std::string& paragraph : ofSplitString(text, "\n", false, false)) {
+		std::string wrapped = (wrapWidth > 0 && paragraph != "") ? Util::wordWrap(paragraph, wrapWidth, font) : paragraph;
+		for (const std::string& line : ofSplitString(wrapped, "\n", false, false)) {
+			_lines.push_back(line);
+			_lineWidths.push_back(line == "" ? 0 : font.stringWidth(line));
+		}
+	}
+
+	_build();
+	return true;
+}
+
+/*! Removes the text from the layout. */
+void TextLayout::clear(void) {
+	_font = nullptr;
+	_lines.clear();
+	_lineWidths.clear();
+	_mesh.clear();
+	_mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+	_boundingBox = ofRectangle();
+}
+
+/*! Draws the text with the current color.
+\param position The position of the left end of the baseline of the first line, like `ofTrueTypeFont::drawString()`.
+With center or right alignment, this is where the left end of the baseline would be if the first line were as wide as the widest line. */
+void TextLayout::draw(ofPoint position) {
+	if (_font == nullptr) {
+		return;
+	}
+
+	if (_builtWithYUp != CX::Instances::Disp.getYIncreasesUpwards()) {
+		_build();
+	}
+
+	if (_mesh.getNumVertices() == 0) {
+		return;
+	}
+
+	ofPushStyle();
+	ofEnableAlphaBlending();
+	ofPushMatrix();
+	ofTranslate(position);
+
+	_font->getFontTexture().bind();
+	_mesh.draw();
+	_font->getFontTexture().unbind();
+
+	ofPopMatrix();
+	ofPopStyle();
+}
+
+/*! Draws the text so that the center of its bounding box is at `center`. Unlike Draw::centeredString(), nothing is measured. */
+void TextLayout::drawCentered(ofPoint center) {
+	if (_builtWithYUp != CX::Instances::Disp.getYIncreasesUpwards()) {
+		_build();
+	}
+	draw(center - _boundingBox.getCenter());
+}
+
+/*! Returns the bounding box of the text, relative to the position given to draw(). */
+ofRectangle TextLayout::getBoundingBox(void) const {
+	return _boundingBox;
+}
+
+/*! Returns the text with the newlines that were inserted by wrapping. */
+std::string TextLayout::getWrappedText(void) const {
+	return ofJoinString(_lines, "\n");
+}
+
+/*! Returns the lines of the text, after wrapping. */
+const std::vector<std::string>& TextLayout::getLines(void) const {
+	return _lines;
+}
+
+void TextLayout::_build(void) {
+	_mesh.clear();
+	_mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+	_boundingBox = ofRectangle();
+
+	_builtWithYUp = CX::Instances::Disp.getYIncreasesUpwards();
+	if (_font == nullptr) {
+		return;
+	}
+
+	float maxWidth = 0;
+	for (float w : _lineWidths) {
+		maxWidth = std::max(maxWidth, w);
+	}
+
+	float lineStep = _builtWithYUp ? -_font->getLineHeight() : _font->getLineHeight();
+
+	for (size_t i = 0; i < _lines.size(); i++) {
+		if (_lines[i] == "") {
+			continue;
+		}
+
+		float x = 0;
+		if (_alignment == Alignment::CENTER) {
+			x = (maxWidth - _lineWidths[i]) / 2;
+		} else if (_alignment == Alignment::RIGHT) {
+			x = maxWidth - _lineWidths[i];
+		}
+		float y = i * lineStep;
+
+#if OF_VERSION_MAJOR == 0 && OF_VERSION_MINOR == 9 && OF_VERSION_PATCH >= 0
+		_mesh.append(_font->getStringMesh(_lines[i], x, y, !_builtWithYUp));
+#else
+		_mesh.append(_font->getStringMesh(_lines[i], x, y));
+#endif
+	}
+
+	const std::vector<ofPoint>& vertices = _mesh.getVertices();
+	if (!vertices.empty()) {
+		ofPoint low = vertices.front();
+		ofPoint high = vertices.front();
+		for (const ofPoint& v : vertices) {
+			low.x = std::min(low.x, v.x);
+			low.y = std::min(low.y, v.y);
+			high.x = std::max(high.x, v.x);
+			high.y = std::max(high.y, v.y);
+		}
+		_boundingBox = ofRectangle(low.x, low.y, high.x - low.x, high.y - low.y);
+	}
+}
 
 } //namespace Draw
 } //namespace CX
\ No newline at end of file
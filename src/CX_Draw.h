@@ -1,10 +1,14 @@
 #pragma once
 
+#include <memory>
+
 #include "ofPoint.h"
+#include "ofPixels.h"
 #include "ofPath.h"
 #include "ofTrueTypeFont.h"
 #include "ofGraphics.h"
 #include "ofShader.h"
+#include "ofVboMesh.h"
 
 #include "CX_Utilities.h"
 #include "CX_RandomNumberGenerator.h"
@@ -12,6 +16,7 @@
 #include "CX_Synth.h"
 
 #include "CX_Gabor.h"
+#include "CX_GaborTextureCache.h"
 
 namespace CX {
 
@@ -21,6 +26,41 @@ however, there are no strong guarantees about what the output of the functions w
 \ingroup video */
 namespace Draw {
 
+	/*! A conversion between two color spaces that is parsed once from a formula and can then be applied to any number
+	of colors. This is what convertColors() and convertToRGB() use. If many colors are converted, such as when the colors
+	of a color wheel are made, making a ColorTransform once and using it for all of the colors avoids parsing the formula
+	for every color. Copies of a ColorTransform share the same parsed conversion.
+
+	\code{.cpp}
+	Draw::ColorTransform labToRgb("LAB -> RGB");
+
+	std::vector<float> lab = { 50, 20, -20,   50, 40, 0 }; //Two colors.
+	std::vector<float> rgb(lab.size());
+	labToRgb.apply(lab.data(), rgb.data(), 2);
+	\endcode
+	*/
+	class ColorTransform {
+	public:
+		ColorTransform(void);
+		ColorTransform(std::string conversionFormula);
+
+		bool setup(std::string conversionFormula);
+		bool isValid(void) const;
+		std::string getFormula(void) const;
+
+		void apply(double S1, double S2, double S3, double* D1, double* D2, double* D3) const;
+		void apply(const float* in, float* out, size_t count) const;
+		void apply(const double* in, double* out, size_t count) const;
+
+		ofFloatColor toColor(double S1, double S2, double S3) const;
+		std::vector<ofFloatColor> toColors(const float* in, size_t count) const;
+
+	private:
+		struct Compiled;
+		std::shared_ptr<const Compiled> _compiled;
+		std::string _formula;
+	};
+
 	std::vector<double> convertColors(std::string conversionFormula, double S1, double S2, double S3);
 	ofFloatColor convertToRGB(std::string inputColorSpace, double S1, double S2, double S3);
 
@@ -56,9 +96,132 @@ namespace Draw {
 	void fixationCross(ofPoint location, float armLength, float armWidth);
 
 	void centeredString(int x, int y, std::string s, ofTrueTypeFont &font);
+
+	void fillNoise(ofFloatPixels& pixels, float low = 0, float high = 1, bool luminance = true, CX_RandomNumberGenerator& rng = CX::Instances::RNG);
 	void centeredString(ofPoint center, std::string s, ofTrueTypeFont &font);
 
 	void saveFboToFile(ofFbo& fbo, std::string filename);
+	bool saveFboToFileAsync(ofFbo& fbo, std::string filename);
+
+	void setShapeCacheCapacity(unsigned int capacity);
+	void clearShapeCache(void);
+
+	/*! This class collects many shapes into one mesh so that they can all be drawn with a single draw call.
+	Drawing each shape with its own function call (e.g. Draw::ring()) takes one draw call per shape, which
+	makes drawing hundreds of shapes per frame CPU-bound. With a Batch, the shapes are added one at a time
+	and then drawn all at once with draw().
+
+	Each shape is given the color that is set when the shape is added (with, e.g., `ofSetColor()`), so shapes with
+	different colors can be in the same batch. The shapes are drawn in the order that they were added. The geometry
+	of each shape is taken from the same cache that Draw::ring() and the like use, so only the shape's position
+	changes between shapes that have the same parameters.
+
+	\code{.cpp}
+	Draw::Batch batch;
+
+	for (ofPoint p : locations) {
+		ofSetColor(ofColor::red);
+		batch.ring(p, 30, 5, 64);
+		ofSetColor(ofColor::white);
+		batch.fixationCross(p, 10, 2);
+	}
+
+	Disp.beginDrawingToBackBuffer();
+	ofBackground(0);
+	batch.draw(); //All of the rings and crosses are drawn in one draw call.
+	Disp.endDrawingToBackBuffer();
+	\endcode
+
+	If the shapes do not change from frame to frame, the batch can be drawn again without being rebuilt. Call clear() before
+	adding new shapes.
+
+	\ingroup video
+	*/
+	class Batch {
+	public:
+
+		Batch(void);
+
+		void line(ofPoint p1, ofPoint p2, float width);
+		void lines(const std::vector<ofPoint>& points, float lineWidth, bool circleJoins = true);
+		void circle(ofPoint center, float radius, unsigned int resolution);
+		void ring(ofPoint center, float radius, float width, unsigned int resolution);
+		void arc(ofPoint center, float radiusX, float radiusY, float width, float angleBegin, float angleEnd, unsigned int resolution);
+		void squircle(ofPoint center, double radius, double amount = 0.9, double rotationDeg = 0);
+		void star(ofPoint center, unsigned int numberOfPoints, float innerRadius, float outerRadius, float rotationDeg = 0);
+		void fixationCross(ofPoint location, float armLength, float armWidth);
+		void triangles(const ofMesh& mesh, ofPoint offset = ofPoint(0, 0));
+
+		void draw(void);
+		void clear(void);
+
+		size_t getVertexCount(void) const;
+
+	private:
+		ofVboMesh _mesh;
+	};
+
+	/*! This class lays out a passage of text once, so that it can be drawn many times cheaply. The text is wrapped (see
+	Util::wordWrap()), aligned, and turned into quads that are textured from the glyph atlas of the font when setup() is
+	called. After that, drawing the whole passage is one draw call from a single VBO, and its bounding box is known without
+	measuring the text again. This is useful for self-paced reading or RSVP tasks, where the same page of text is drawn on
+	every frame, and as a replacement for Draw::centeredString() when the same string is drawn many times.
+
+	\code{.cpp}
+	ofTrueTypeFont font;
+	font.load(OF_TTF_SANS, 18); //In oF 0.8, this is font.loadFont(OF_TTF_SANS, 18).
+
+	Draw::TextLayout page(font, passage, 600); //Wrapped to 600 pixels wide.
+
+	Disp.beginDrawingToBackBuffer();
+	ofBackground(0);
+	ofSetColor(255);
+	page.drawCentered(Disp.getCenter());
+	Disp.endDrawingToBackBuffer();
+	\endcode
+
+	The font must outlive the layout and must not be reloaded while the layout is in use. The text is drawn with the current
+	color. If the direction of the y axis changes (see CX_Display::setYIncreasesUpwards()), the layout is rebuilt the next
+	time it is drawn.
+
+	\ingroup video
+	*/
+	class TextLayout {
+	public:
+
+		/*! How the lines of a TextLayout are aligned with each other. */
+		enum class Alignment {
+			LEFT,
+			CENTER,
+			RIGHT
+		};
+
+		TextLayout(void);
+		TextLayout(ofTrueTypeFont& font, std::string text, float wrapWidth = 0, Alignment alignment = Alignment::LEFT);
+
+		bool setup(ofTrueTypeFont& font, std::string text, float wrapWidth = 0, Alignment alignment = Alignment::LEFT);
+		void clear(void);
+
+		void draw(ofPoint position);
+		void drawCentered(ofPoint center);
+
+		ofRectangle getBoundingBox(void) const;
+		std::string getWrappedText(void) const;
+		const std::vector<std::string>& getLines(void) const;
+
+	private:
+		ofTrueTypeFont* _font;
+		std::vector<std::string> _lines;
+		std::vector<float> _lineWidths;
+		float _wrapWidth;
+		Alignment _alignment;
+
+		ofVboMesh _mesh;
+		ofRectangle _boundingBox;
+		bool _builtWithYUp;
+
+		void _build(void);
+	};
 
 	/*! Sample colors from the RGB spectrum with variable precision. Colors will be sampled
 	beginning with red, continue through yellow, green, cyan, blue, violet, and almost, but not quite, back to red.
@@ -216,17 +379,19 @@ namespace Draw {
 				}
 
 				//Now that input has been received, redraw the color wheel
-				vector<ofFloatColor> wheelColors(100);
+				std::vector<float> labValues(100 * 3);
 
-				for (int i = 0; i < wheelColors.size(); i++) {
-					float angle = (float)i / wheelColors.size() * 2 * PI;
-					float A = sin(angle) * aOff;
-					float B = cos(angle) * bOff;
-
-					//Convert the L, A, and B components to the RGB color space.
-					wheelColors[i] = Draw::convertToRGB("LAB", L, A, B);
+				for (int i = 0; i < 100; i++) {
+					float angle = (float)i / 100 * 2 * PI;
+					labValues[i * 3 + 0] = L;
+					labValues[i * 3 + 1] = sin(angle) * aOff;
+					labValues[i * 3 + 2] = cos(angle) * bOff;
 				}
 
+				//Convert the L, A, and B components to the RGB color space, all at once.
+				static const Draw::ColorTransform labToRgb("LAB -> RGB");
+				vector<ofFloatColor> wheelColors = labToRgb.toColors(labValues.data(), 100);
+
 				Disp.beginDrawingToBackBuffer();
 				ofBackground(0);
 				Draw::colorWheel(Disp.getCenter(), wheelColors, 200, 70, 0);
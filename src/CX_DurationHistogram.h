@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace CX {
+namespace Private {
+
+	/*! This class counts durations, in nanoseconds, in logarithmically spaced buckets, so that percentiles of a
+	stream of durations can be estimated without storing the durations. It works like an HDR histogram: each
+	power of 2 is split into 64 linear buckets, so any percentile is within about 0.8% of the true value. Durations
+	of up to 2^40 ns (about 18 minutes) are counted separately and longer ones are counted with the longest.
+	Adding a duration is a few integer operations and an increment. The buckets take about 18 KB, so they are not
+	allocated until allocate() or the first add() is called. After that, adding a duration never allocates memory.
+
+	This class is used internally by CX and should not be used directly.
+	*/
+	class CX_DurationHistogram {
+	public:
+
+		CX_DurationHistogram(void) :
+			_total(0)
+		{}
+
+		/*! Allocates the buckets, if they have not been allocated yet, so that add() does not need to allocate them. */
+		void allocate(void) {
+			if (_counts.empty()) {
+				_counts.assign(_bucketIndex(_maxValue) + 1, 0);
+			}
+		}
+
+		/*! Removes all of the durations from the histogram. */
+		void reset(void) {
+			std::fill(_counts.begin(), _counts.end(), 0);
+			_total = 0;
+		}
+
+		/*! Adds a duration, in nanoseconds. Negative durations are counted as 0. */
+		void add(int64_t nanos) {
+			allocate();
+			_counts[_bucketIndex(nanos)]++;
+			_total++;
+		}
+
+		/*! Adds all of the durations from another histogram to this one. */
+		void merge(const CX_DurationHistogram& other) {
+			if (other._counts.empty()) {
+				return;
+			}
+			allocate();
+			for (size_t i = 0; i < _counts.size(); i++) {
+				_counts[i] += other._counts[i];
+			}
+			_total += other._total;
+		}
+
+		uint64_t count(void) const { return _total; }
+
+		/*! Returns an estimate of the duration, in nanoseconds, below which `p` of the durations are, where `p` is in [0, 1].
+		The estimate is the middle of the bucket that contains that duration. Returns 0 if there are no durations. */
+		int64_t quantile(double p) const {
+			if (_total == 0) {
+				return 0;
+			}
+
+			p = std::min(std::max(p, 0.0), 1.0);
+			uint64_t rank = std::max<uint64_t>((uint64_t)(p * _total + 0.5), 1);
+
+			uint64_t cumulative = 0;
+			for (size_t i = 0; i < _counts.size(); i++) {
+				cumulative += _counts[i];
+				if (cumulative >= rank) {
+					return _bucketMiddle(i);
+				}
+			}
+			return _maxValue;
+		}
+
+	private:
+		static const int _subBucketBits = 7;
+		static const int64_t _subBucketCount = 1 << _subBucketBits;
+		static const int64_t _halfSubBucketCount = _subBucketCount / 2;
+		static const int64_t _maxValue = ((int64_t)1 << 40) - 1;
+
+		std::vector<uint64_t> _counts;
+		uint64_t _total;
+
+		static int _highestBit(uint64_t v) {
+#if defined(_MSC_VER) && defined(_WIN64)
+			unsigned long index;
+			_BitScanReverse64(&index, v);
+			return (int)index;
+#elif defined(__GNUC__)
+			return 63 - __builtin_clzll(v);
+#else
+			int bit = 0;
+			while (v >>= 1) {
+				bit++;
+			}
+			return bit;
+#endif
+		}
+
+		//Values below _subBucketCount get one bucket each. Above that, each power of 2 gets _halfSubBucketCount buckets.
+		static size_t _bucketIndex(int64_t v) {
+			v = std::min(std::max<int64_t>(v, 0), _maxValue);
+			if (v < _subBucketCount) {
+				return (size_t)v;
+			}
+			int shift = _highestBit((uint64_t)v) - (_subBucketBits - 1);
+			return (size_t)(_subBucketCount + (shift - 1) * _halfSubBucketCount + ((v >> shift) - _halfSubBucketCount));
+		}
+
+		static int64_t _bucketMiddle(size_t index) {
+			if ((int64_t)index < _subBucketCount) {
+				return (int64_t)index;
+			}
+			int64_t offset = (int64_t)index - _subBucketCount;
+			int shift = (int)(offset / _halfSubBucketCount) + 1;
+			int64_t sub = (offset % _halfSubBucketCount) + _halfSubBucketCount;
+			return (sub << shift) + ((int64_t)1 << (shift - 1));
+		}
+	};
+
+} //namespace Private
+} //namespace CX
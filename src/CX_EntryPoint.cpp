@@ -1,6 +1,10 @@
 #include "CX_EntryPoint.h"
 
+#include <thread>
+#include <cstdlib>
+
 #include "CX_Private.h"
+#include "CX_StartupCache.h"
 
 #include "CX_AppWindow.h"
 #include "ofAppGLFWWindow.h"
@@ -12,6 +16,46 @@
 
 namespace CX {
 
+namespace Private {
+
+//A description of the things that the startup calibrations depend on, hashed into a fingerprint for the startup cache.
+std::string startupFingerprint(const CX_WindowConfiguration& config) {
+	std::ostringstream s;
+
+	s << "CX startup cache 1;";
+	s << "oF " << OF_VERSION_MAJOR << "." << OF_VERSION_MINOR << "." << OF_VERSION_PATCH << ";";
+#if defined(TARGET_WIN32)
+	s << "win32;";
+#elif defined(TARGET_OSX)
+	s << "osx;";
+#elif defined(TARGET_LINUX)
+	s << "linux;";
+#endif
+	s << "threads " << std::thread::hardware_concurrency() << ";";
+
+	const char* vendor = (const char*)glGetString(GL_VENDOR);
+	const char* renderer = (const char*)glGetString(GL_RENDERER);
+	const char* version = (const char*)glGetString(GL_VERSION);
+	s << "gl " << (vendor ? vendor : "") << "|" << (renderer ? renderer : "") << "|" << (version ? version : "") << ";";
+
+	GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+	if (monitor != nullptr) {
+		const char* name = glfwGetMonitorName(monitor);
+		const GLFWvidmode* mode = glfwGetVideoMode(monitor);
+		s << "monitor " << (name ? name : "");
+		if (mode != nullptr) {
+			s << " " << mode->width << "x" << mode->height << "@" << mode->refreshRate;
+		}
+		s << ";";
+	}
+
+	s << "window " << (int)config.mode << " " << config.width << "x" << config.height << " msaa " << config.msaaSampleCount << ";";
+
+	return s.str();
+}
+
+} //namespace Private
+
 /*! This function initializes CX functionality. It should probably only be called once, at program start.
 \param config The intial CX configuration.
 \return `true` if intialization was successful, `false` if there was an error. If there was an error, it should be logged.
@@ -44,13 +88,74 @@ bool initializeCX(CX_InitConfiguation config) {
 		CX::Instances::Input.pollEvents(); //Do this so that the window is at least minimally responding and doesn't get killed by the OS.
 			//This must happen after the window is configured because it relies on GLFW.
 
+		Private::CX_StartupCache& cache = Private::startupCache;
+		if (config.startupCacheFile != "") {
+			std::string description = Private::startupFingerprint(config.windowConfig);
+			cache.load(config.startupCacheFile, Private::CX_StartupCache::hashFingerprint(description));
+		}
+
+		//Restore the clock implementation from the cache or choose one. Choosing one takes a while, but it only uses the CPU,
+		//so it is done on another thread while the frame period is estimated, which mostly waits for buffer swaps.
+		std::shared_ptr<CX_BaseClockInterface> clockImpl;
+		std::string clockName;
+		std::string clockReference;
+		if (cache.get("clockImplementation", clockName)) {
+			cache.get("clockReference", clockReference);
+			clockImpl = CX_Clock::makeImplementation(clockName, clockReference);
+			if (clockImpl != nullptr) {
+				CX::Instances::Log.notice("CX_EntryPoint") << "Clock implementation from the startup cache: " << clockName << ".";
+			}
+		}
+
+		std::thread clockThread;
+		auto chooseClock = [&](void) {
+			CX_Clock chooser;
+			if (chooser.setup(nullptr, false, config.clockPrecisionTestIterations)) {
+				clockImpl = chooser.getImplementation();
+			}
+		};
+		if (clockImpl == nullptr && std::thread::hardware_concurrency() > 1) {
+			clockThread = std::thread(chooseClock);
+		}
+
 		if (config.framePeriodEstimationInterval != CX_Millis(0)) {
-			CX::Instances::Disp.estimateFramePeriod(config.framePeriodEstimationInterval);
-			CX::Instances::Log.notice("CX_EntryPoint") << "Estimated frame period: " << CX::Instances::Disp.getFramePeriod() << " ms.";
+			std::string periodString;
+			std::string sdString;
+			int64_t periodNanos = 0;
+			if (cache.get("framePeriodNanos", periodString) && cache.get("framePeriodSDNanos", sdString)) {
+				periodNanos = (int64_t)std::strtoll(periodString.c_str(), nullptr, 10);
+			}
+
+			if (periodNanos > 0) {
+				CX::Instances::Disp.setFramePeriod(CX_Nanos(periodNanos), CX_Nanos((int64_t)std::strtoll(sdString.c_str(), nullptr, 10)));
+				CX::Instances::Log.notice("CX_EntryPoint") << "Frame period from the startup cache: " << CX::Instances::Disp.getFramePeriod() << " ms.";
+			} else {
+				CX::Instances::Disp.estimateFramePeriod(config.framePeriodEstimationInterval);
+				CX::Instances::Log.notice("CX_EntryPoint") << "Estimated frame period: " << CX::Instances::Disp.getFramePeriod() << " ms.";
+
+				if (CX::Instances::Disp.getFramePeriod() > CX_Millis(0)) {
+					cache.set("framePeriodNanos", ofToString(CX::Instances::Disp.getFramePeriod().nanos()));
+					cache.set("framePeriodSDNanos", ofToString(CX::Instances::Disp.getFramePeriodStandardDeviation().nanos()));
+				}
+			}
+		}
+
+		if (clockThread.joinable()) {
+			clockThread.join();
+		} else if (clockImpl == nullptr) {
+			chooseClock();
 		}
 
-		// Set up the clock
-		CX::Instances::Clock.setup(nullptr, true, config.clockPrecisionTestIterations);
+		if (clockImpl != nullptr && clockName != clockImpl->getName()) {
+			cache.set("clockImplementation", clockImpl->getName());
+#ifdef CX_HAS_TSC_CLOCK
+			CX_TSCClock* tsc = dynamic_cast<CX_TSCClock*>(clockImpl.get());
+			cache.set("clockReference", tsc ? tsc->getReferenceName() : "");
+#endif
+		}
+
+		// Set up the clock. If no implementation could be chosen, setup() tries again and logs the error.
+		CX::Instances::Clock.setup(clockImpl, true, config.clockPrecisionTestIterations);
 		
 		//This is temporary: I think there's an oF bug about it
 #if OF_VERSION_MAJOR == 0 && OF_VERSION_MINOR == 8
@@ -139,6 +244,10 @@ bool exitCallbackHandler(ofEventArgs& args) {
 	//	glfwDestroyWindow(glfwGetCurrentContext());
 	//}
 
+	CX::Instances::Disp.getVideoRecorder().stop();
+	CX::Instances::Disp.getFrameCapture().shutdown(); //Finishes pending captures, which needs the GL context.
+	CX::Instances::Disp.getTextureLoader().shutdown(); //The shared context must be destroyed before GLFW is terminated.
+
 	glfwTerminate(); //this also should not be called from callbacks...
 	//but without calling this, the window hangs.
 
@@ -154,6 +263,10 @@ void reopenWindow090(CX_WindowConfiguration config) {
 
 	bool firstCall = (CX::Private::appWindow == nullptr);
 
+	CX::Instances::Disp.getVideoRecorder().stop();
+	CX::Instances::Disp.getFrameCapture().shutdown(); //Its pixel buffers belong to the window that is being closed.
+	CX::Instances::Disp.getTextureLoader().shutdown(); //Its context is shared with the window that is being closed.
+
 	if (firstCall) {
 		CX::Private::appWindow = shared_ptr<ofAppBaseWindow>(new CX::Private::CX_AppWindow);
 	} else {
@@ -171,6 +284,10 @@ void reopenWindow090(CX_WindowConfiguration config) {
 	settings.width = config.width;
 	settings.height = config.height;
 
+	if (config.noErrorContext) {
+		CX::Instances::Log.warning("CX_EntryPoint") << "reopenWindow(): noErrorContext is not supported with this version of openFrameworks. It was ignored.";
+	}
+
 	awp->setup(settings);
 
 	awp->events().enable();
@@ -194,6 +311,10 @@ void reopenWindow090(CX_WindowConfiguration config) {
 
 void reopenWindow080(CX_WindowConfiguration config) {
 
+	CX::Instances::Disp.getVideoRecorder().stop();
+	CX::Instances::Disp.getFrameCapture().shutdown(); //Its pixel buffers belong to the window that is being closed.
+	CX::Instances::Disp.getTextureLoader().shutdown(); //Its context is shared with the window that is being closed.
+
 	//Close previous window, if opened
 	if (CX::Private::glfwContext == glfwGetCurrentContext()) {
 		glfwDestroyWindow(CX::Private::glfwContext);
@@ -209,12 +330,18 @@ void reopenWindow080(CX_WindowConfiguration config) {
 	CX::Private::CX_AppWindow* awp = (CX::Private::CX_AppWindow*)CX::Private::appWindow.get();
 	awp->setOpenGLVersion(config.desiredOpenGLVersion.major, config.desiredOpenGLVersion.minor);
 	awp->setNumSamples(Util::getMsaaSampleCount());
+	awp->setNoErrorContext(config.noErrorContext);
+	awp->setLeanRenderLoop(config.leanRenderLoop);
 
 	ofSetupOpenGL(CX::Private::appWindow, config.width, config.height, config.mode);
 }
 
 void reopenWindow084(CX_WindowConfiguration config) {
 
+	CX::Instances::Disp.getVideoRecorder().stop();
+	CX::Instances::Disp.getFrameCapture().shutdown(); //Its pixel buffers belong to the window that is being closed.
+	CX::Instances::Disp.getTextureLoader().shutdown(); //Its context is shared with the window that is being closed.
+
 	//Close previous window, if opened
 	if (CX::Private::glfwContext == glfwGetCurrentContext()) {
 		glfwDestroyWindow(CX::Private::glfwContext);
@@ -263,6 +390,8 @@ void reopenWindow084(CX_WindowConfiguration config) {
 	CX::Private::CX_AppWindow* awp = (CX::Private::CX_AppWindow*)CX::Private::appWindow.get();
 	awp->setOpenGLVersion(config.desiredOpenGLVersion.major, config.desiredOpenGLVersion.minor);
 	awp->setNumSamples(Util::getMsaaSampleCount());
+	awp->setNoErrorContext(config.noErrorContext);
+	awp->setLeanRenderLoop(config.leanRenderLoop);
 
 	((CX::Private::CX_AppWindow*)CX::Private::appWindow.get())->setupOpenGL(config.width, config.height, config.mode, config.preOpeningUserFunction, config.resizeable);
 }
@@ -303,7 +432,12 @@ bool reopenWindow(CX_WindowConfiguration config) {
 
 		//Setup the display for the new window
 		CX::Instances::Disp.setup();
-		CX::Instances::Disp.useHardwareVSync(true);
+		CX::Instances::Disp.setLeanRendering(config.leanRenderLoop);
+		if (config.adaptiveVSync) {
+			CX::Instances::Disp.useAdaptiveVSync(true);
+		} else {
+			CX::Instances::Disp.useHardwareVSync(true);
+		}
 	} catch (std::exception& e) {
 		CX::Instances::Log.error("CX_EntryPoint") << "reopenWindow(): Exception caught while setting up window: " << e.what();
 	} catch (...) {
@@ -358,6 +492,7 @@ int main (void) {
 	runExperiment();
 
 	CX::Instances::Log.flush();
+	CX::Instances::Log.waitForFlush(); //Make sure that all messages are written if flushing is asynchronous.
 	return 0;
 }
 #endif
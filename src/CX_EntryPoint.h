@@ -13,7 +13,10 @@ namespace CX {
 			resizeable(false),
 			msaaSampleCount(4),
 			windowTitle("CX Experiment"),
-			preOpeningUserFunction(nullptr)
+			preOpeningUserFunction(nullptr),
+			leanRenderLoop(false),
+			noErrorContext(false),
+			adaptiveVSync(false)
 		{}
 
 		ofWindowMode mode; //!< The mode of the window. One of ofWindowMode::OF_WINDOW, ofWindowMode::OF_FULLSCREEN, or ofWindowMode::OF_GAME_MODE.
@@ -39,6 +42,20 @@ namespace CX {
 		/*! A user-supplied function that will be called just before the GLFW window is opened. This allows you to
 		set window hints just before the window is opened. This only works if you are using oF version 0.8.4. */
 		std::function<void(void)> preOpeningUserFunction;
+
+		/*! If `true`, rendering is set up for the lowest cost per frame: CX_Display::beginDrawingToBackBuffer() no longer resets
+		the viewport and projection every frame (see CX_Display::setLeanRendering()) and, with oF 0.8.x, the window's own
+		update/draw loop does nothing but swap buffers and poll events. Use this if you draw directly with CX_Display
+		and restore any state that you change (matrices, viewport) before the end of each frame. */
+		bool leanRenderLoop;
+
+		/*! If `true`, an OpenGL context without error checking (GL_KHR_no_error) is requested, which lets the driver skip
+		validating every GL call. OpenGL errors are undefined behavior in such a context, so only use this for experiments
+		that are known to work. It is ignored if GLFW or the driver does not support it. Only works with oF 0.8.x. */
+		bool noErrorContext;
+
+		/*! If `true`, adaptive VSync (see CX_Display::useAdaptiveVSync()) is used instead of plain hardware VSync, if it is supported. */
+		bool adaptiveVSync;
 	};
 
 	struct CX_InitConfiguation {
@@ -46,7 +63,8 @@ namespace CX {
 		CX_InitConfiguation(void) :
 			captureOFLogMessages(true),
 			framePeriodEstimationInterval(CX_Seconds(1)),
-			clockPrecisionTestIterations(100000)
+			clockPrecisionTestIterations(100000),
+			startupCacheFile("")
 		{}
 
 		CX_WindowConfiguration windowConfig; //!< The window configuration.
@@ -61,6 +79,14 @@ namespace CX {
 		Forced to be at least 10,000.
 		Passed to CX_Clock::chooseBestClockImplementation(). */
 		unsigned int clockPrecisionTestIterations;
+
+		/*! If not empty, the name of a file in which the results of the startup calibrations are cached: the chosen
+		clock implementation, the frame period and its standard deviation, and the sample rates chosen
+		by CX_SoundStream::setup(). On the next start, the cached results are used instead of running the calibrations again,
+		which makes startup much faster. The cache is tied to a fingerprint of the hardware (graphics card, monitor, processor)
+		and the window configuration, so it is ignored if any of those change. Delete the file to force recalibration.
+		Relative paths are relative to the data directory. Calibrations that are not cached are run in parallel when possible. */
+		std::string startupCacheFile;
 	};
 
 	bool reopenWindow(CX_WindowConfiguration config);
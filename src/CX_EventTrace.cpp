@@ -0,0 +1,275 @@
+#include "CX_EventTrace.h"
+
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "CX_Logger.h"
+#include "CX_Utilities.h"
+
+CX::CX_EventTrace CX::Instances::EventTrace;
+
+namespace CX {
+namespace Private {
+
+	struct CX_EventTraceBuffer {
+		CX_EventTraceBuffer(size_t capacity, unsigned int index) :
+			records(capacity),
+			mask(capacity - 1),
+			written(0),
+			threadIndex(index)
+		{}
+
+		std::vector<CX_EventTrace::Record> records;
+		size_t mask;
+		std::atomic<uint64_t> written; //The total number of records that have been written. Only the owning thread writes.
+
+		unsigned int threadIndex;
+		std::string threadName;
+	};
+
+	//Each thread keeps the buffer that it records into. The generation is checked so that the buffer is
+	//replaced after setup() or clear() and the owner is checked in case more than one CX_EventTrace is used.
+	struct CX_EventTraceThreadState {
+		CX_EventTraceThreadState(void) :
+			owner(nullptr),
+			generation(0)
+		{}
+
+		const CX_EventTrace* owner;
+		unsigned int generation;
+		std::shared_ptr<CX_EventTraceBuffer> buffer;
+		std::string threadName;
+	};
+
+	static thread_local CX_EventTraceThreadState eventTraceThreadState;
+
+	static std::string eventTraceJsonEscape(const std::string& s) {
+		std::string rval;
+		for (char c : s) {
+			switch (c) {
+			case '"': rval += "\\\""; break;
+			case '\\': rval += "\\\\"; break;
+			case '\n': rval += "\\n"; break;
+			case '\r': rval += "\\r"; break;
+			case '\t': rval += "\\t"; break;
+			default:
+				if ((unsigned char)c < 0x20) {
+					std::ostringstream hex;
+					hex << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c;
+					rval += hex.str();
+				} else {
+					rval += c;
+				}
+			}
+		}
+		return rval;
+	}
+
+} //namespace Private
+
+CX_EventTrace::CX_EventTrace(void) :
+	_enabled(false),
+	_generation(1),
+	_recordsPerThread(65536)
+{
+	_eventNames[(uint16_t)Event::BUFFER_SWAP] = "BUFFER_SWAP";
+	_eventNames[(uint16_t)Event::AUDIO_CALLBACK] = "AUDIO_CALLBACK";
+	_eventNames[(uint16_t)Event::SLIDE_RENDER] = "SLIDE_RENDER";
+	_eventNames[(uint16_t)Event::SLIDE_PRESENTED] = "SLIDE_PRESENTED";
+	_eventNames[(uint16_t)Event::INPUT_POLL] = "INPUT_POLL";
+}
+
+/*! Removes all recorded events, sets the size of the buffer that each thread records into, and starts recording events.
+\param recordsPerThread The number of records that each thread can hold before the oldest records are overwritten.
+This is rounded up to a power of 2. Each record takes 24 bytes. */
+void CX_EventTrace::setup(size_t recordsPerThread) {
+	size_t size = 1;
+	while (size < recordsPerThread) {
+		size *= 2;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_recordsPerThread = size;
+	}
+
+	clear();
+	enable(true);
+}
+
+/*! Starts or stops recording events. Recorded events are kept when recording is stopped. */
+void CX_EventTrace::enable(bool enable) {
+	_enabled.store(enable, std::memory_order_relaxed);
+}
+
+/*! Gives a name to an event id. The name is used when events are exported. The events that are recorded by CX
+already have names. If an event id has no name, it is exported as "event" followed by the id.
+\param event The event id, such as `(uint16_t)CX_EventTrace::Event::USER + 1`.
+\param name The name of the event. */
+void CX_EventTrace::nameEvent(uint16_t event, std::string name) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_eventNames[event] = name;
+}
+
+/*! Gives a name to the thread that calls this function. The name is used when events are exported.
+Threads without names are given names based on the order in which they recorded their first event.
+This function does not allocate a buffer for the thread, so it can be called whether or not tracing is enabled. */
+void CX_EventTrace::nameThread(std::string name) {
+	Private::CX_EventTraceThreadState& state = Private::eventTraceThreadState;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	state.threadName = name;
+	if (state.owner == this && state.buffer) {
+		state.buffer->threadName = name;
+	}
+}
+
+/*! Removes all recorded events. Threads that record events after this is called are given new buffers. */
+void CX_EventTrace::clear(void) {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	//Threads keep their old buffers until they see the new generation.
+	_buffers.clear();
+	_generation.fetch_add(1, std::memory_order_release);
+}
+
+/*! Returns a copy of all of the events that are currently in the buffers of all threads, sorted by time. */
+std::vector<CX_EventTrace::Record> CX_EventTrace::getRecords(void) {
+	std::vector<std::shared_ptr<Private::CX_EventTraceBuffer>> buffers;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		buffers = _buffers;
+	}
+
+	std::vector<Record> rval;
+	for (auto& buffer : buffers) {
+		std::vector<Record> records = _copyRecords(*buffer);
+		rval.insert(rval.end(), records.begin(), records.end());
+	}
+
+	std::stable_sort(rval.begin(), rval.end(), [](const Record& a, const Record& b) { return a.nanos < b.nanos; });
+	return rval;
+}
+
+/*! Writes all of the events that are currently in the buffers to a file in the Chrome trace event format.
+The file can be opened in the Perfetto UI (https://ui.perfetto.dev) or at chrome://tracing in Chrome.
+Each thread that recorded events is shown on its own track. The value of each event is shown in its arguments.
+
+Events can be exported while they are being recorded, but events that are recorded during the export may not be included.
+\param filename The name of the file. If it is a relative path, it is relative to the data directory. The file is overwritten if it exists.
+\return `true` if the file was written, `false` otherwise. */
+bool CX_EventTrace::exportChromeTrace(std::string filename) {
+	std::vector<std::shared_ptr<Private::CX_EventTraceBuffer>> buffers;
+	std::map<uint16_t, std::string> eventNames;
+	std::vector<std::string> threadNames;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		buffers = _buffers;
+		eventNames = _eventNames;
+		for (auto& buffer : buffers) {
+			threadNames.push_back(buffer->threadName);
+		}
+	}
+
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool first = true;
+	for (size_t i = 0; i < buffers.size(); i++) {
+		std::string threadName = threadNames[i].empty() ? "thread " + ofToString(buffers[i]->threadIndex) : threadNames[i];
+
+		out << (first ? "\n" : ",\n");
+		first = false;
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffers[i]->threadIndex <<
+			",\"args\":{\"name\":\"" << Private::eventTraceJsonEscape(threadName) << "\"}}";
+
+		std::vector<Record> records = _copyRecords(*buffers[i]);
+		for (const Record& r : records) {
+			auto name = eventNames.find(r.event);
+
+			out << ",\n{\"name\":\"";
+			if (name != eventNames.end()) {
+				out << Private::eventTraceJsonEscape(name->second);
+			} else {
+				out << "event" << r.event;
+			}
+			out << "\",\"cat\":\"CX\",\"ph\":\"";
+			switch (r.phase) {
+			case Phase::BEGIN: out << "B"; break;
+			case Phase::END: out << "E"; break;
+			case Phase::INSTANT: out << "i\",\"s\":\"t"; break;
+			}
+			out << "\",\"ts\":" << (r.nanos / 1000.0) << ",\"pid\":1,\"tid\":" << buffers[i]->threadIndex <<
+				",\"args\":{\"value\":" << r.value << "}}";
+		}
+	}
+	out << "\n]}\n";
+
+	bool success = CX::Util::writeToFile(filename, out.str(), false, false);
+	if (!success) {
+		CX::Instances::Log.error("CX_EventTrace") << "exportChromeTrace(): The trace could not be written to \"" << filename << "\".";
+	}
+	return success;
+}
+
+void CX_EventTrace::_record(uint16_t event, Phase phase, uint64_t value) {
+	Private::CX_EventTraceBuffer* buffer = _getThreadBuffer();
+
+	uint64_t index = buffer->written.load(std::memory_order_relaxed);
+
+	Record& r = buffer->records[index & buffer->mask];
+	r.nanos = CX::Instances::Clock.now().nanos();
+	r.event = event;
+	r.phase = phase;
+	r.value = value;
+
+	buffer->written.store(index + 1, std::memory_order_release);
+}
+
+Private::CX_EventTraceBuffer* CX_EventTrace::_getThreadBuffer(void) {
+	Private::CX_EventTraceThreadState& state = Private::eventTraceThreadState;
+
+	unsigned int generation = _generation.load(std::memory_order_acquire);
+	if (state.owner == this && state.generation == generation && state.buffer) {
+		return state.buffer.get();
+	}
+
+	//This only happens the first time a thread records an event after setup() or clear().
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	state.owner = this;
+	state.generation = _generation.load(std::memory_order_relaxed);
+	state.buffer = std::make_shared<Private::CX_EventTraceBuffer>(_recordsPerThread, (unsigned int)_buffers.size());
+	state.buffer->threadName = state.threadName;
+	_buffers.push_back(state.buffer);
+
+	return state.buffer.get();
+}
+
+std::vector<CX_EventTrace::Record> CX_EventTrace::_copyRecords(Private::CX_EventTraceBuffer& buffer) {
+	uint64_t capacity = buffer.records.size();
+
+	uint64_t end = buffer.written.load(std::memory_order_acquire);
+	uint64_t start = (end > capacity) ? end - capacity : 0;
+
+	std::vector<Record> rval;
+	rval.reserve(end - start);
+	for (uint64_t i = start; i < end; i++) {
+		rval.push_back(buffer.records[i & buffer.mask]);
+	}
+
+	//Records that the thread overwrote while they were being copied are dropped. The slot after the last
+	//written record may be in the middle of being written, so it is dropped too.
+	uint64_t after = buffer.written.load(std::memory_order_acquire);
+	uint64_t firstValid = (after + 1 > capacity) ? after + 1 - capacity : 0;
+	if (firstValid > start) {
+		size_t drop = (size_t)std::min<uint64_t>(firstValid - start, rval.size());
+		rval.erase(rval.begin(), rval.begin() + drop);
+	}
+
+	return rval;
+}
+
+} //namespace CX
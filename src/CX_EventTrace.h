@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include "CX_Clock.h"
+
+namespace CX {
+
+	namespace Private {
+		struct CX_EventTraceBuffer;
+	}
+
+	/*! This class records when timing-critical things happen in CX, like buffer swaps, audio callbacks,
+	slide rendering, and input polling, so that the timing of an experiment can be checked after the fact.
+	It is meant to be used through the preinstantiated CX::Instances::EventTrace.
+
+	Each record is a timestamp, an event id, and one 64-bit value. Each thread that records events gets
+	its own fixed-size ring buffer, so recording an event does not lock and does not allocate memory
+	(except for the first event recorded by each thread). When a thread's buffer is full, its oldest records
+	are overwritten. When tracing is turned off, which it is by default, recording an event only costs
+	a check of a flag.
+
+	The events can be exported to a JSON file in the Chrome trace event format with exportChromeTrace(),
+	which can be viewed in the Perfetto UI (https://ui.perfetto.dev) or at chrome://tracing in Chrome.
+
+	\code{.cpp}
+	EventTrace.setup(); //Turn on tracing.
+
+	//Run some trials...
+
+	EventTrace.begin(CX_EventTrace::Event::USER, trialNumber); //You can add your own events.
+	//...
+	EventTrace.end(CX_EventTrace::Event::USER, trialNumber);
+
+	EventTrace.exportChromeTrace("trace.json");
+	\endcode
+
+	The functions that record events may be called from any thread. The other functions should be called from the main thread.
+	\ingroup timing
+	*/
+	class CX_EventTrace {
+	public:
+
+		/*! The events that are recorded by CX. You can record your own events with ids starting at `USER`. */
+		enum class Event : uint16_t {
+			BUFFER_SWAP, //!< The buffer swap in the buffer swapping thread of CX_Display. The value is the frame number after the swap.
+			AUDIO_CALLBACK, //!< The audio callback of a CX_SoundStream. The value is the sample number at the start of the buffer.
+			SLIDE_RENDER, //!< The rendering of a slide by a CX_SlidePresenter. The value is the index of the slide.
+			SLIDE_PRESENTED, //!< A CX_SlidePresenter noticing that a slide was presented. The value is the index of the slide.
+			INPUT_POLL, //!< CX_InputManager::pollEvents(), which has a value of 0, or a sample taken by the joystick sampling thread (see CX_Joystick::startSampling()), which has a value of 1.
+			USER = 1024 //!< The first id for user events. Give them names with nameEvent().
+		};
+
+		/*! Whether a record marks the beginning or end of something that takes time, or something that happens at one time. */
+		enum class Phase : uint8_t {
+			BEGIN,
+			END,
+			INSTANT
+		};
+
+		/*! One traced event. */
+		struct Record {
+			int64_t nanos; //!< The time of the event, in nanoseconds since the start of the experiment.
+			uint16_t event; //!< The id of the event.
+			Phase phase; //!< The phase of the event.
+			uint64_t value; //!< A value that goes with the event.
+		};
+
+		/*! Records a Phase::BEGIN at construction and a Phase::END at destruction. */
+		class Scope {
+		public:
+			Scope(CX_EventTrace& trace, Event event, uint64_t value = 0) :
+				_trace(trace),
+				_event((uint16_t)event),
+				_value(value)
+			{
+				_trace.record(_event, Phase::BEGIN, _value);
+			}
+
+			~Scope(void) {
+				_trace.record(_event, Phase::END, _value);
+			}
+
+			/*! Sets the value that will be recorded at the end. */
+			void setEndValue(uint64_t value) {
+				_value = value;
+			}
+
+		private:
+			CX_EventTrace& _trace;
+			uint16_t _event;
+			uint64_t _value;
+		};
+
+		CX_EventTrace(void);
+
+		void setup(size_t recordsPerThread = 65536);
+		void enable(bool enable);
+
+		/*! Returns `true` if events are being recorded. */
+		bool isEnabled(void) const {
+			return _enabled.load(std::memory_order_relaxed);
+		}
+
+		/*! Records an event with the given id, phase, and value, if tracing is enabled. */
+		void record(uint16_t event, Phase phase, uint64_t value = 0) {
+			if (isEnabled()) {
+				_record(event, phase, value);
+			}
+		}
+
+		/*! Records the beginning of something that takes time. */
+		void begin(Event event, uint64_t value = 0) { record((uint16_t)event, Phase::BEGIN, value); }
+
+		/*! Records the end of something that takes time. */
+		void end(Event event, uint64_t value = 0) { record((uint16_t)event, Phase::END, value); }
+
+		/*! Records something that happens at one time. */
+		void instant(Event event, uint64_t value = 0) { record((uint16_t)event, Phase::INSTANT, value); }
+
+		void nameEvent(uint16_t event, std::string name);
+		void nameThread(std::string name);
+
+		std::vector<Record> getRecords(void);
+		bool exportChromeTrace(std::string filename);
+		void clear(void);
+
+	private:
+
+		std::atomic<bool> _enabled;
+		std::atomic<unsigned int> _generation; //Incremented when the buffers are replaced, so threads know to get new ones.
+		size_t _recordsPerThread;
+
+		std::mutex _mutex;
+		std::vector<std::shared_ptr<Private::CX_EventTraceBuffer>> _buffers;
+		std::map<uint16_t, std::string> _eventNames;
+
+		void _record(uint16_t event, Phase phase, uint64_t value);
+		Private::CX_EventTraceBuffer* _getThreadBuffer(void);
+
+		static std::vector<Record> _copyRecords(Private::CX_EventTraceBuffer& buffer);
+	};
+
+	namespace Instances {
+		extern CX_EventTrace EventTrace;
+	}
+
+}
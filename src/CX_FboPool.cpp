@@ -0,0 +1,202 @@
+#include "CX_FboPool.h"
+
+#include <tuple>
+
+#include "CX_Logger.h"
+
+namespace CX {
+
+bool CX_FboPool::Key::operator<(const Key& k) const {
+	return std::tie(width, height, internalFormat, numSamples) < std::tie(k.width, k.height, k.internalFormat, k.numSamples);
+}
+
+CX_FboPool::CX_FboPool(void) :
+	_memoryBudget(0),
+	_memoryUsage(0)
+{
+}
+
+CX_FboPool::~CX_FboPool(void) {
+	clear();
+}
+
+/*! Gets a framebuffer with the given settings. If the pool has an unused framebuffer with the same settings,
+it is given out, otherwise a new one is allocated. To make room for a new framebuffer, unused framebuffers
+with other settings are deallocated if the memory budget would otherwise be exceeded.
+
+The contents of a reused framebuffer are whatever was last drawn into it, so it should be cleared or drawn over completely.
+
+\param width The width of the framebuffer, in pixels.
+\param height The height of the framebuffer, in pixels.
+\param internalFormat The internal format of the framebuffer, e.g. `GL_RGB` or `GL_RGBA`.
+\param numSamples The number of MSAA samples, e.g. the value returned by CX::Util::getMsaaSampleCount().
+\return The framebuffer. Give it back with release() when you are done with it. */
+ofFbo CX_FboPool::acquire(int width, int height, int internalFormat, int numSamples) {
+	Key key = { width, height, internalFormat, numSamples };
+
+	ofFbo fbo;
+
+	auto it = _available.find(key);
+	if (it != _available.end() && !it->second.empty()) {
+		fbo = it->second.back();
+		it->second.pop_back();
+	} else {
+		uint64_t bytes = estimateMemoryUse(width, height, internalFormat, numSamples);
+		if (!_makeRoom(bytes, nullptr)) {
+			CX::Instances::Log.warning("CX_FboPool") << "acquire(): Allocating a framebuffer will exceed the memory budget of " <<
+				_memoryBudget << " bytes. The framebuffers in use are using " << _memoryUsage << " bytes.";
+		}
+		fbo = _allocate(key);
+	}
+
+	_inUse[fbo.getFbo()] = key;
+	return fbo;
+}
+
+/*! Gives a framebuffer that was acquired from this pool back to the pool, so that it can be given out again.
+`fbo` is replaced with an empty framebuffer.
+\param fbo The framebuffer to give back.
+\return `true` if the framebuffer came from this pool, `false` otherwise. If it did not come from this pool, it is not changed. */
+bool CX_FboPool::release(ofFbo& fbo) {
+	auto it = _inUse.find(fbo.getFbo());
+	if (it == _inUse.end()) {
+		return false;
+	}
+
+	Key key = it->second;
+	_inUse.erase(it);
+
+	if (_memoryBudget != 0 && _memoryUsage > _memoryBudget) {
+		_deallocate(fbo, key);
+	} else {
+		_available[key].push_back(fbo);
+	}
+
+	fbo = ofFbo();
+	return true;
+}
+
+/*! Allocates framebuffers ahead of time so that they are ready when they are needed.
+The pool will have at least `count` unused framebuffers with the given settings, unless that would exceed the memory budget.
+See acquire() for the meaning of the settings. */
+void CX_FboPool::prewarm(unsigned int count, int width, int height, int internalFormat, int numSamples) {
+	Key key = { width, height, internalFormat, numSamples };
+	uint64_t bytes = estimateMemoryUse(width, height, internalFormat, numSamples);
+
+	std::vector<ofFbo>& available = _available[key];
+	while (available.size() < count) {
+		if (!_makeRoom(bytes, &key)) {
+			CX::Instances::Log.warning("CX_FboPool") << "prewarm(): Only " << available.size() << " of " << count <<
+				" framebuffers could be allocated within the memory budget of " << _memoryBudget << " bytes.";
+			break;
+		}
+		available.push_back(_allocate(key));
+	}
+}
+
+/*! Deallocates all of the unused framebuffers. Framebuffers that are in use are not affected, but they
+are still counted against the memory budget until they are released. */
+void CX_FboPool::clear(void) {
+	for (auto& it : _available) {
+		for (ofFbo& fbo : it.second) {
+			_deallocate(fbo, it.first);
+		}
+	}
+	_available.clear();
+}
+
+/*! Sets the most video memory that the framebuffers of the pool (both in use and unused) should use.
+If the pool is already using more than this, unused framebuffers are deallocated until it is within the budget.
+\param bytes The budget, in bytes. 0, the default, means no limit. See estimateMemoryUse() for how memory use is estimated. */
+void CX_FboPool::setMemoryBudget(uint64_t bytes) {
+	_memoryBudget = bytes;
+	_makeRoom(0, nullptr);
+}
+
+/*! Returns the memory budget, in bytes. 0 means no limit. */
+uint64_t CX_FboPool::getMemoryBudget(void) const {
+	return _memoryBudget;
+}
+
+/*! Returns the estimated video memory used by all of the framebuffers of the pool, both in use and unused, in bytes. */
+uint64_t CX_FboPool::getMemoryUsage(void) const {
+	return _memoryUsage;
+}
+
+/*! Returns the number of unused framebuffers that are waiting in the pool. */
+unsigned int CX_FboPool::getAvailableCount(void) const {
+	unsigned int count = 0;
+	for (auto& it : _available) {
+		count += it.second.size();
+	}
+	return count;
+}
+
+/*! Returns the number of framebuffers that have been acquired but not released. */
+unsigned int CX_FboPool::getInUseCount(void) const {
+	return _inUse.size();
+}
+
+/*! Estimates the video memory used by a framebuffer. The estimate assumes that each pixel of each sample is padded to a
+multiple of 4 bytes and that a framebuffer with MSAA also has a resolved texture. The real amount depends on the video driver.
+\return The estimated number of bytes. */
+uint64_t CX_FboPool::estimateMemoryUse(int width, int height, int internalFormat, int numSamples) {
+	uint64_t bytesPerPixel = 4;
+	switch (internalFormat) {
+	case GL_RGB16:
+	case GL_RGBA16:
+	case GL_RGB16F:
+	case GL_RGBA16F:
+		bytesPerPixel = 8;
+		break;
+	case GL_RGB32F:
+	case GL_RGBA32F:
+		bytesPerPixel = 16;
+		break;
+	}
+
+	uint64_t pixels = (uint64_t)width * (uint64_t)height;
+	uint64_t bytes = pixels * bytesPerPixel;
+	if (numSamples > 1) {
+		bytes += pixels * bytesPerPixel * numSamples;
+	}
+	return bytes;
+}
+
+ofFbo CX_FboPool::_allocate(const Key& key) {
+	ofFbo fbo;
+	fbo.allocate(key.width, key.height, key.internalFormat, key.numSamples);
+	_memoryUsage += estimateMemoryUse(key.width, key.height, key.internalFormat, key.numSamples);
+	_trackedBytes.set(_memoryUsage);
+	return fbo;
+}
+
+//The fbo is deallocated the same way that it is elsewhere in CX, by allocating it with no size.
+void CX_FboPool::_deallocate(ofFbo& fbo, const Key& key) {
+	fbo.allocate(0, 0);
+	uint64_t bytes = estimateMemoryUse(key.width, key.height, key.internalFormat, key.numSamples);
+	_memoryUsage -= std::min(bytes, _memoryUsage);
+	_trackedBytes.set(_memoryUsage);
+}
+
+//Deallocates unused framebuffers, except for those with the settings in `keep`, until there is room for
+//`bytes` more within the budget. Returns false if there is not enough room.
+bool CX_FboPool::_makeRoom(uint64_t bytes, const Key* keep) {
+	if (_memoryBudget == 0) {
+		return true;
+	}
+
+	for (auto it = _available.begin(); it != _available.end() && _memoryUsage + bytes > _memoryBudget; ++it) {
+		if (keep != nullptr && !(it->first < *keep) && !(*keep < it->first)) {
+			continue;
+		}
+		while (!it->second.empty() && _memoryUsage + bytes > _memoryBudget) {
+			_deallocate(it->second.back(), it->first);
+			it->second.pop_back();
+		}
+	}
+
+	return _memoryUsage + bytes <= _memoryBudget;
+}
+
+} //namespace CX
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <cstdint>
+
+#include "ofFbo.h"
+
+#include "CX_MemoryUsage.h"
+
+namespace CX {
+
+	/*! This class keeps framebuffers (`ofFbo`s) that are no longer needed so that they can be given out again
+	instead of being deallocated and reallocated. Allocating framebuffers is slow and, when it is done many times
+	in a row (e.g. for the hundreds of slides of an RSVP stream), can stall the video driver in the middle of
+	stimulus presentation. Framebuffers are matched by their width, height, internal format, and number of MSAA samples.
+
+	The pool can be prewarmed with framebuffers before they are needed and has a video memory budget: When the
+	framebuffers that belong to the pool would use more than the budget, unused framebuffers are deallocated.
+
+	CX_SlidePresenter uses one of these for the framebuffers of its slides. See CX::CX_SlidePresenter::getFramebufferPool().
+
+	\code{.cpp}
+	CX_FboPool pool;
+	pool.setMemoryBudget(256 * 1024 * 1024); //256 MB
+	pool.prewarm(20, Disp.getResolution().x, Disp.getResolution().y, GL_RGB, 4);
+
+	ofFbo fbo = pool.acquire(Disp.getResolution().x, Disp.getResolution().y, GL_RGB, 4);
+	//Draw into the fbo and use it...
+	pool.release(fbo); //The fbo is now empty and its framebuffer can be given out again.
+	\endcode
+	\ingroup video
+	*/
+	class CX_FboPool {
+	public:
+
+		CX_FboPool(void);
+		~CX_FboPool(void);
+
+		ofFbo acquire(int width, int height, int internalFormat, int numSamples);
+		bool release(ofFbo& fbo);
+
+		void prewarm(unsigned int count, int width, int height, int internalFormat, int numSamples);
+		void clear(void);
+
+		void setMemoryBudget(uint64_t bytes);
+		uint64_t getMemoryBudget(void) const;
+		uint64_t getMemoryUsage(void) const;
+
+		unsigned int getAvailableCount(void) const;
+		unsigned int getInUseCount(void) const;
+
+		static uint64_t estimateMemoryUse(int width, int height, int internalFormat, int numSamples);
+
+	private:
+
+		struct Key {
+			int width;
+			int height;
+			int internalFormat;
+			int numSamples;
+
+			bool operator<(const Key& k) const;
+		};
+
+		std::map<Key, std::vector<ofFbo>> _available;
+		std::map<GLuint, Key> _inUse;
+
+		uint64_t _memoryBudget;
+		uint64_t _memoryUsage;
+		Private::CX_TrackedBytes<Util::MemoryCategory::FRAMEBUFFERS> _trackedBytes; //Mirrors _memoryUsage for Util::memoryReport().
+
+		ofFbo _allocate(const Key& key);
+		void _deallocate(ofFbo& fbo, const Key& key);
+		bool _makeRoom(uint64_t bytes, const Key* keep);
+	};
+
+}
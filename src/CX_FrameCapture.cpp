@@ -0,0 +1,475 @@
+#include "CX_FrameCapture.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstring>
+
+#include "ofImage.h"
+#include "ofGLUtils.h"
+#include "ofAppRunner.h"
+
+#include "CX_Private.h" //glfwContext, glFenceSyncSupported
+#include "CX_Logger.h"
+#include "CX_EventTrace.h"
+
+namespace CX {
+
+struct CX_FrameCapture::Slot {
+	Slot(void) :
+		pbo(0),
+		capacity(0),
+		fence(0),
+		width(0),
+		height(0),
+		type(OF_IMAGE_COLOR),
+		flip(false)
+	{}
+
+	GLuint pbo;
+	size_t capacity; //The size, in bytes, of the data store of the PBO.
+	GLsync fence; //Not 0 while the slot is in flight.
+
+	int width;
+	int height;
+	ofImageType type;
+	bool flip;
+	PixelConsumer consumer;
+	FrameInfo info;
+};
+
+struct CX_FrameCapture::Job {
+	ofPixels pixels;
+	bool flip;
+	PixelConsumer consumer;
+	FrameInfo info;
+};
+
+struct CX_FrameCapture::Workers {
+	Workers(void) :
+		stop(false)
+	{}
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stop; //The workers finish the jobs in the queue before they stop.
+	std::deque<std::shared_ptr<Job>> queue;
+};
+
+CX_FrameCapture::CX_FrameCapture(void) :
+	_usePixelBuffers(false),
+	_captureCount(0),
+	_pendingCount(0),
+	_droppedCount(0)
+{}
+
+CX_FrameCapture::~CX_FrameCapture(void) {
+	shutdown();
+}
+
+/*! Sets up the frame capture with the default configuration. See setup(Configuration). */
+bool CX_FrameCapture::setup(void) {
+	return setup(_config);
+}
+
+/*! Starts the worker threads and decides whether PBOs are used. This must be called from the main thread after the
+CX window has been opened. It is called with the default configuration by the capture functions if needed.
+If the frame capture is already set up, it is shut down first if the configuration is different.
+\param config The configuration.
+\return `false` if there is no GL context, `true` otherwise. */
+bool CX_FrameCapture::setup(Configuration config) {
+	config.bufferCount = std::max(config.bufferCount, 1u);
+	config.workerThreads = std::max(config.workerThreads, 1u);
+
+	if (_workers) {
+		if (config.bufferCount == _config.bufferCount && config.workerThreads == _config.workerThreads &&
+			config.maxQueuedFrames == _config.maxQueuedFrames)
+		{
+			return true;
+		}
+		shutdown();
+	}
+
+	if (CX::Private::glfwContext == nullptr) {
+		CX::Instances::Log.error("CX_FrameCapture") << "setup(): There is no GL context. The frame capture must be set up after the window has been opened.";
+		return false;
+	}
+
+	_config = config;
+
+	_usePixelBuffers = CX::Private::glFenceSyncSupported();
+	if (!_usePixelBuffers) {
+		CX::Instances::Log.notice("CX_FrameCapture") << "setup(): Fence sync is not supported, so pixels will be read back synchronously.";
+	}
+
+	_slots.clear();
+	for (unsigned int i = 0; i < _config.bufferCount; i++) {
+		_slots.push_back(std::make_shared<Slot>());
+	}
+
+	_workers = std::make_shared<Workers>();
+	for (unsigned int i = 0; i < _config.workerThreads; i++) {
+		_workers->threads.push_back(std::thread(&CX_FrameCapture::_workerLoop, this, _workers));
+	}
+
+	return true;
+}
+
+/*! Finishes all of the captures that have been made, waiting for the worker threads to process them, then stops the
+worker threads and deletes the PBOs. Must be called from the main thread while the GL context still exists. */
+void CX_FrameCapture::shutdown(void) {
+	if (!_workers) {
+		return;
+	}
+
+	while (!_inFlight.empty()) {
+		std::shared_ptr<Slot> slot = _inFlight.front();
+		_inFlight.pop_front();
+		_collect(slot);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_workers->mutex);
+		_workers->stop = true;
+	}
+	_workers->condition.notify_all();
+	for (std::thread& t : _workers->threads) {
+		t.join();
+	}
+	_workers.reset();
+
+	if (CX::Private::glfwContext != nullptr) {
+		for (std::shared_ptr<Slot>& slot : _slots) {
+			if (slot->pbo) {
+				glDeleteBuffers(1, &slot->pbo);
+			}
+		}
+	}
+	_slots.clear();
+	_pendingCount = 0;
+}
+
+/*! Returns `true` if setup() has been called successfully and shutdown() has not been called since. */
+bool CX_FrameCapture::isSetup(void) const {
+	return (bool)_workers;
+}
+
+/*! Returns `true` if captures are read back asynchronously with PBOs, or `false` if they are read back synchronously. */
+bool CX_FrameCapture::usingPixelBuffers(void) const {
+	return _usePixelBuffers;
+}
+
+/*! Returns `true` if a capture can be queued without first waiting for an earlier capture to be copied out of its buffer.
+If PBOs are not used, this is always `true`, because nothing is buffered. */
+bool CX_FrameCapture::hasFreeBuffer(void) const {
+	if (!_usePixelBuffers) {
+		return true;
+	}
+	for (const std::shared_ptr<Slot>& slot : _slots) {
+		if (slot->fence == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*! Queues a capture of the contents of a framebuffer. The framebuffer can be drawn into again right away: the copy
+is made by the GPU before any commands that are given after this function returns.
+\param fbo The framebuffer. If it is multisampled, it is resolved first.
+\param consumer A function that is called on a worker thread with the pixels once they have been read back.
+\return `true` if the capture was queued, `false` if it was dropped or there was an error. */
+bool CX_FrameCapture::capture(ofFbo& fbo, PixelConsumer consumer) {
+	if (!fbo.isAllocated()) {
+		CX::Instances::Log.error("CX_FrameCapture") << "capture(): The framebuffer is not allocated.";
+		return false;
+	}
+
+	ofTexture& texture = fbo.getTextureReference();
+	const ofTextureData& data = texture.getTextureData();
+
+#if OF_VERSION_MAJOR == 0 && OF_VERSION_MINOR == 9 && OF_VERSION_PATCH >= 0
+	ofImageType type = ofGetImageTypeFromGLType(data.glInternalFormat);
+#else
+	ofImageType type = ofGetImageTypeFromGLType(data.glTypeInternal);
+#endif
+	if (type == OF_IMAGE_UNDEFINED) {
+		CX::Instances::Log.error("CX_FrameCapture") << "capture(): The format of the framebuffer is not supported.";
+		return false;
+	}
+
+	return _capture(data.textureID, data.textureTarget, texture.getWidth(), texture.getHeight(), type, false, consumer);
+}
+
+/*! Queues a capture of the back buffer of the display, e.g. just after drawing a frame and before it is swapped in.
+This must not be called while a framebuffer is being drawn to (i.e. between `ofFbo::begin()` and `ofFbo::end()`).
+\param consumer A function that is called on a worker thread with the pixels once they have been read back.
+They are RGB, top row first.
+\return `true` if the capture was queued, `false` if it was dropped or there was an error. */
+bool CX_FrameCapture::captureBackBuffer(PixelConsumer consumer) {
+	return _capture(0, 0, ofGetWidth(), ofGetHeight(), OF_IMAGE_COLOR, true, consumer);
+}
+
+/*! Queues a capture of a framebuffer that is saved to an image file on a worker thread. See capture().
+\param fbo The framebuffer.
+\param filename The name of the file. The file extension determines the type of file. Relative paths are relative to the data directory.
+\return `true` if the capture was queued. */
+bool CX_FrameCapture::saveToFile(ofFbo& fbo, std::string filename) {
+	std::string path = ofToDataPath(filename);
+	return capture(fbo, [path](ofPixels& pixels, const FrameInfo&) {
+		ofSaveImage(pixels, path, OF_IMAGE_QUALITY_BEST);
+	});
+}
+
+/*! Queues a capture of the back buffer that is saved to an image file on a worker thread. See captureBackBuffer().
+\param filename The name of the file. The file extension determines the type of file. Relative paths are relative to the data directory.
+\return `true` if the capture was queued. */
+bool CX_FrameCapture::saveBackBufferToFile(std::string filename) {
+	std::string path = ofToDataPath(filename);
+	return captureBackBuffer([path](ofPixels& pixels, const FrameInfo&) {
+		ofSaveImage(pixels, path, OF_IMAGE_QUALITY_BEST);
+	});
+}
+
+bool CX_FrameCapture::_capture(GLuint texture, GLenum target, int width, int height, ofImageType type, bool flip, PixelConsumer consumer) {
+	if (!setup()) {
+		return false;
+	}
+
+	if (width <= 0 || height <= 0) {
+		CX::Instances::Log.error("CX_FrameCapture") << "There is nothing to capture.";
+		return false;
+	}
+
+	if (!consumer) {
+		CX::Instances::Log.error("CX_FrameCapture") << "No function was given to receive the pixels.";
+		return false;
+	}
+
+	size_t queued = _inFlight.size();
+	{
+		std::lock_guard<std::mutex> lock(_workers->mutex);
+		queued += _workers->queue.size();
+	}
+	if (queued >= _config.maxQueuedFrames) {
+		_droppedCount++;
+		CX::Instances::Log.error("CX_FrameCapture") << "The worker threads are " << queued << " frames behind. The capture was dropped.";
+		return false;
+	}
+
+	FrameInfo info;
+	info.captureNumber = _captureCount++;
+	info.captureTime = CX::Instances::Clock.now();
+
+	GLint packAlignment = 4;
+	glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	if (!_usePixelBuffers) {
+		std::shared_ptr<Job> job = std::make_shared<Job>();
+		job->pixels.allocate(width, height, type);
+		job->flip = flip;
+		job->consumer = consumer;
+		job->info = info;
+
+		if (texture) {
+			glBindTexture(target, texture);
+			glGetTexImage(target, 0, ofGetGlFormat(job->pixels), GL_UNSIGNED_BYTE, job->pixels.getPixels());
+			glBindTexture(target, 0);
+		} else {
+			glReadBuffer(GL_BACK);
+			glReadPixels(0, 0, width, height, ofGetGlFormat(job->pixels), GL_UNSIGNED_BYTE, job->pixels.getPixels());
+		}
+		glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+
+		_pendingCount++;
+		return _enqueue(job);
+	}
+
+	std::shared_ptr<Slot> slot = _getFreeSlot();
+
+	ofPixels format; //Only used to find the GL format of the type.
+	format.allocate(1, 1, type);
+	size_t bytes = (size_t)width * height * format.getNumChannels();
+
+	if (slot->pbo == 0) {
+		glGenBuffers(1, &slot->pbo);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+	if (slot->capacity != bytes) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+		slot->capacity = bytes;
+	}
+
+	//With a pack buffer bound, the last argument is an offset into the buffer, so these return right away.
+	if (texture) {
+		glBindTexture(target, texture);
+		glGetTexImage(target, 0, ofGetGlFormat(format), GL_UNSIGNED_BYTE, 0);
+		glBindTexture(target, 0);
+	} else {
+		glReadBuffer(GL_BACK);
+		glReadPixels(0, 0, width, height, ofGetGlFormat(format), GL_UNSIGNED_BYTE, 0);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+
+	slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot->width = width;
+	slot->height = height;
+	slot->type = type;
+	slot->flip = flip;
+	slot->consumer = consumer;
+	slot->info = info;
+
+	_inFlight.push_back(slot);
+	_pendingCount++;
+
+	return true;
+}
+
+//If every slot is in flight, the oldest one is waited for.
+std::shared_ptr<CX_FrameCapture::Slot> CX_FrameCapture::_getFreeSlot(void) {
+	for (std::shared_ptr<Slot>& slot : _slots) {
+		if (slot->fence == 0) {
+			return slot;
+		}
+	}
+
+	std::shared_ptr<Slot> oldest = _inFlight.front();
+	_inFlight.pop_front();
+	_collect(oldest);
+	return oldest;
+}
+
+//Waits for the copy into the slot to finish, if needed, and hands the pixels to the workers.
+void CX_FrameCapture::_collect(std::shared_ptr<Slot> slot) {
+	GLenum result = glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	while (result == GL_TIMEOUT_EXPIRED) {
+		result = glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, CX_Millis(100).nanos());
+	}
+	glDeleteSync(slot->fence);
+	slot->fence = 0;
+
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	job->flip = slot->flip;
+	job->consumer = slot->consumer;
+	job->info = slot->info;
+	slot->consumer = nullptr;
+
+	if (result == GL_WAIT_FAILED) {
+		CX::Instances::Log.error("CX_FrameCapture") << "Waiting for capture " << job->info.captureNumber << " to be read back failed.";
+		_pendingCount--;
+		return;
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+	const void* mapped = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+	if (mapped) {
+		job->pixels.allocate(slot->width, slot->height, slot->type);
+		std::memcpy(job->pixels.getPixels(), mapped, (size_t)slot->width * slot->height * job->pixels.getNumChannels());
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (!mapped) {
+		CX::Instances::Log.error("CX_FrameCapture") << "The pixel buffer of capture " << job->info.captureNumber << " could not be mapped.";
+		_pendingCount--;
+		return;
+	}
+
+	_enqueue(job);
+}
+
+bool CX_FrameCapture::_enqueue(std::shared_ptr<Job> job) {
+	{
+		std::lock_guard<std::mutex> lock(_workers->mutex);
+		_workers->queue.push_back(job);
+	}
+	_workers->condition.notify_one();
+	return true;
+}
+
+/*! Hands the pixels of captures that have finished being read back to the worker threads. This must be called
+regularly from the main thread. It returns quickly when nothing is being read back. */
+void CX_FrameCapture::update(void) {
+	while (!_inFlight.empty()) {
+		std::shared_ptr<Slot> slot = _inFlight.front();
+		GLenum result = glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			return;
+		}
+		_inFlight.pop_front();
+		_collect(slot);
+	}
+}
+
+/*! Waits until every capture that has been made has been given to its consumer function, calling update() while waiting.
+Must be called from the main thread.
+\param timeout The longest time to wait.
+\return `true` if nothing is left to do, `false` if the timeout expired. */
+bool CX_FrameCapture::waitUntilDone(CX_Millis timeout) {
+	CX_Millis deadline = CX::Instances::Clock.now() + timeout;
+
+	while (true) {
+		update();
+
+		if (_pendingCount == 0) {
+			return true;
+		}
+
+		if (CX::Instances::Clock.now() >= deadline) {
+			CX::Instances::Log.warning("CX_FrameCapture") << "waitUntilDone(): Timed out with " << _pendingCount.load() << " captures still pending.";
+			return false;
+		}
+		CX::Instances::Clock.sleep(CX_Millis(1));
+	}
+}
+
+/*! Returns the number of captures that have not yet been given to their consumer functions. This can be checked from any thread. */
+unsigned int CX_FrameCapture::getPendingCount(void) const {
+	return _pendingCount;
+}
+
+/*! Returns the number of captures that were dropped because the worker threads were too far behind. See Configuration::maxQueuedFrames. */
+uint64_t CX_FrameCapture::getDroppedCount(void) const {
+	return _droppedCount;
+}
+
+void CX_FrameCapture::_workerLoop(std::shared_ptr<Workers> workers) {
+	CX::Instances::EventTrace.nameThread("CX frame capture");
+
+	std::unique_lock<std::mutex> lock(workers->mutex);
+	while (true) {
+		if (workers->queue.empty()) {
+			if (workers->stop) {
+				break;
+			}
+			workers->condition.wait(lock);
+			continue;
+		}
+
+		std::shared_ptr<Job> job = workers->queue.front();
+		workers->queue.pop_front();
+		lock.unlock();
+
+		//The pixels of the back buffer are read bottom row first.
+		if (job->flip) {
+			job->pixels.mirror(true, false);
+		}
+
+		try {
+			job->consumer(job->pixels, job->info);
+		} catch (std::exception& e) {
+			CX::Instances::Log.error("CX_FrameCapture") << "Processing capture " << job->info.captureNumber << " failed with an exception: " << e.what();
+		} catch (...) {
+			CX::Instances::Log.error("CX_FrameCapture") << "Processing capture " << job->info.captureNumber << " failed with an exception.";
+		}
+		_pendingCount--;
+
+		lock.lock();
+	}
+}
+
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <string>
+#include <atomic>
+#include <functional>
+
+#include "ofPixels.h"
+#include "ofFbo.h"
+
+#include "CX_Clock.h"
+
+namespace CX {
+
+	/*! This class reads framebuffers and the back buffer back from video memory without stalling the rendering pipeline,
+	and hands the pixels to a pool of worker threads, for example to be encoded into image files. It is meant for archiving
+	what was shown on each trial without losing frames.
+
+	A capture copies the framebuffer into one of a small ring of pixel buffer objects (PBOs). The copy is done by the GPU
+	after the rendering commands that came before it, so queuing it costs the CPU almost nothing. A fence sync is placed after
+	the copy and the pixels are collected in update(), once the fence shows that the copy is done, which is normally a frame
+	or two later. The pixels are then given to a worker thread. If all of the buffers in the ring are still being copied into when
+	a new capture is made, the oldest one is waited for. Code that must not wait can check hasFreeBuffer() first.
+
+	If PBOs or fence sync are not supported (OpenGL older than 3.2), the pixels are read synchronously, which stalls the pipeline,
+	but the encoding is still done on the worker threads.
+
+	update() must be called regularly from the main thread. CX_Display::beginDrawingToBackBuffer() and CX_SlidePresenter::update()
+	call update() for the frame capture of the display (see CX_Display::getFrameCapture()), so normally you don't need to call it yourself.
+
+	\code{.cpp}
+	ofFbo fbo = Disp.makeFbo();
+	//Draw into the fbo...
+
+	Draw::saveFboToFileAsync(fbo, "trial1.png"); //Returns right away.
+
+	//Later, before the program ends:
+	Disp.getFrameCapture().waitUntilDone(CX_Seconds(10));
+	\endcode
+
+	\ingroup video
+	*/
+	class CX_FrameCapture {
+	public:
+
+		/*! Information about a captured frame that is given to the function that receives its pixels. */
+		struct FrameInfo {
+			FrameInfo(void) :
+				captureNumber(0)
+			{}
+
+			uint64_t captureNumber; //!< The number of the capture, counting from 0 since the frame capture was constructed.
+			CX_Millis captureTime; //!< The time at which the capture was queued.
+		};
+
+		/*! A function that receives the pixels of a captured frame. It is called on a worker thread and may modify the pixels. */
+		typedef std::function<void(ofPixels& pixels, const FrameInfo& info)> PixelConsumer;
+
+		/*! The configuration of a CX_FrameCapture. */
+		struct Configuration {
+			Configuration(void) :
+				bufferCount(3),
+				workerThreads(2),
+				maxQueuedFrames(64)
+			{}
+
+			unsigned int bufferCount; //!< The number of PBOs in the readback ring. 2 or 3 is normally enough. At least 1.
+			unsigned int workerThreads; //!< The number of threads that pixels are handed to. At least 1.
+
+			/*! The most frames that may be waiting for a worker thread. If the workers fall this far behind, new captures
+			are dropped, with an error, instead of letting memory use grow without bound. See getDroppedCount(). */
+			unsigned int maxQueuedFrames;
+		};
+
+		CX_FrameCapture(void);
+		~CX_FrameCapture(void);
+
+		bool setup(void);
+		bool setup(Configuration config);
+		void shutdown(void);
+		bool isSetup(void) const;
+		bool usingPixelBuffers(void) const;
+		bool hasFreeBuffer(void) const;
+
+		bool capture(ofFbo& fbo, PixelConsumer consumer);
+		bool captureBackBuffer(PixelConsumer consumer);
+
+		bool saveToFile(ofFbo& fbo, std::string filename);
+		bool saveBackBufferToFile(std::string filename);
+
+		void update(void);
+
+		bool waitUntilDone(CX_Millis timeout);
+		unsigned int getPendingCount(void) const;
+		uint64_t getDroppedCount(void) const;
+
+	private:
+
+		struct Slot;
+		struct Job;
+		struct Workers;
+
+		Configuration _config;
+		bool _usePixelBuffers;
+
+		std::vector<std::shared_ptr<Slot>> _slots;
+		std::deque<std::shared_ptr<Slot>> _inFlight; //Oldest first.
+
+		std::shared_ptr<Workers> _workers;
+
+		uint64_t _captureCount;
+		std::atomic<unsigned int> _pendingCount;
+		std::atomic<uint64_t> _droppedCount;
+
+		bool _capture(GLuint texture, GLenum target, int width, int height, ofImageType type, bool flip, PixelConsumer consumer);
+		std::shared_ptr<Slot> _getFreeSlot(void);
+		void _collect(std::shared_ptr<Slot> slot);
+		bool _enqueue(std::shared_ptr<Job> job);
+
+		void _workerLoop(std::shared_ptr<Workers> workers);
+	};
+
+}
@@ -1,5 +1,7 @@
 #include "CX_Gabor.h"
 
+#include <thread>
+
 
 #define STRINGIFY(x) #x
 
@@ -67,6 +69,68 @@ void main() {
 );
 
 
+//----------
+// Vertex shader for GaborArray. Each vertex is a corner of a square that is scaled by the radius
+// of the instance and moved to its center.
+static std::string gaborArrayVert = "#version 150\n" STRINGIFY(
+uniform mat4 modelViewProjectionMatrix;
+in vec4 position;
+
+in vec2 instanceCenter;
+in vec4 instanceWave; // cos(angle), sin(angle), inverse wavelength, phase in the interval [0,1)
+in vec3 instanceShape; // radius, envelope control parameter, contrast
+
+out vec2 localPosition;
+flat out vec4 wave;
+flat out vec3 shape;
+
+void main(){
+	localPosition = position.xy * instanceShape.x;
+	wave = instanceWave;
+	shape = instanceShape;
+	gl_Position = modelViewProjectionMatrix * vec4(instanceCenter + localPosition, 0, 1);
+}
+);
+
+//----------
+// First part of the GaborArray fragment shader.
+static std::string gaborArrayPrelude = "#version 150\n" STRINGIFY(
+
+const float PI = 3.14159265358979323846;
+
+uniform vec4 color1;
+uniform vec4 color2;
+
+in vec2 localPosition;
+flat in vec4 wave;
+flat in vec3 shape;
+
+out vec4 outputColor;
+);
+
+//----------
+// Main part of the GaborArray fragment shader. The waveform position is the same as in gaborMain,
+// but it is calculated from the position relative to the center in the coordinates that the patch is drawn in.
+static std::string gaborArrayMain = STRINGIFY(
+void main() {
+	float distFromCenter = length(localPosition);
+	if (distFromCenter > shape.x) {
+		discard;
+	}
+
+	float waveformPosition = fract(dot(localPosition, vec2(-wave.y, wave.x)) * wave.z + wave.w);
+	float colorProportion = waveformFunction(waveformPosition);
+
+	vec3 rgb = mix(color2.rgb, color1.rgb, colorProportion);
+	rgb = mix((color1.rgb + color2.rgb) / 2, rgb, shape.z);
+
+	float alpha = envelopeFunction(distFromCenter, shape.y);
+
+	outputColor = vec4(rgb, alpha);
+}
+);
+
+
 namespace CX {
 namespace Draw {
 
@@ -263,13 +327,309 @@ void Gabor::_initVars(void) {
 }
 
 
+//Vertex attribute locations used by GaborArray. The locations below 4 are used by openFrameworks.
+static const int gaborArrayCenterLocation = 4;
+static const int gaborArrayWaveLocation = 5;
+static const int gaborArrayShapeLocation = 6;
+
+GaborArray::GaborArray(void) :
+	color1(1, 1, 1, 1),
+	color2(0, 0, 0, 1),
+	_instancesChanged(false),
+	_uploadedInstanceCount(0)
+{}
+
+/*! Convenience constructor which sets up the class while constructing it. */
+GaborArray::GaborArray(std::string waveFunction, std::string envelopeFunction) :
+	GaborArray()
+{
+	setup(waveFunction, envelopeFunction);
+}
+
+/*! Sets the wave and envelope functions that are used by all of the patches. This compiles the shader
+that draws the patches, so it is potentially blocking. The instances are kept.
 
+\param waveFunction A function to use to calculate the mixing between color1 and color2, such as a value from
+Gabor::Wave. See CX::Draw::Gabor for how to write your own.
 
+\param envelopeFunction A function to use to calculate the envelope giving the falloff of each patch from its
+center, such as a value from Gabor::Envelope. See CX::Draw::Gabor for how to write your own.
+*/
+void GaborArray::setup(std::string waveFunction, std::string envelopeFunction) {
+	std::string fullWaveFunction = "float waveformFunction(in float wp) {\n" +
+		waveFunction +
+		"\n}\n";
+
+	std::string fullEnvelopeFunction = "float envelopeFunction(in float d, in float cp) {\n" +
+		envelopeFunction +
+		"\n}\n";
+
+	std::string source = gaborArrayPrelude + fullWaveFunction + fullEnvelopeFunction + gaborArrayMain;
+
+	_shader.setupShaderFromSource(GL_VERTEX_SHADER, gaborArrayVert);
+	_shader.setupShaderFromSource(GL_FRAGMENT_SHADER, source);
+
+	if (ofIsGLProgrammableRenderer()) {
+		_shader.bindDefaults();
+	} else {
+		CX::Instances::Log.error("GaborArray") << "setup(): GaborArray requires the programmable renderer (OpenGL 3.2 or later).";
+	}
+	_shader.bindAttribute(gaborArrayCenterLocation, "instanceCenter");
+	_shader.bindAttribute(gaborArrayWaveLocation, "instanceWave");
+	_shader.bindAttribute(gaborArrayShapeLocation, "instanceShape");
+	_shader.linkProgram();
+
+	//The corners of a square, drawn as a triangle strip.
+	const float corners[8] = { -1, -1, 1, -1, -1, 1, 1, 1 };
+	_vbo.setVertexData(corners, 2, 4, GL_STATIC_DRAW, 2 * sizeof(float));
+
+	_uploadedInstanceCount = 0;
+	_instancesChanged = true;
+}
+
+/*! Replaces all of the instances. */
+void GaborArray::setInstances(const std::vector<Instance>& instances) {
+	_instances = instances;
+	_instancesChanged = true;
+}
+
+/*! Adds a patch to the array. */
+void GaborArray::addInstance(const Instance& instance) {
+	_instances.push_back(instance);
+	_instancesChanged = true;
+}
+
+/*! Changes the settings of one patch.
+\param index The index of the patch. If it is out of range, an error is logged.
+\param instance The new settings for the patch. */
+void GaborArray::setInstance(size_t index, const Instance& instance) {
+	if (index >= _instances.size()) {
+		CX::Instances::Log.error("GaborArray") << "setInstance(): Index " << index << " is out of range. There are " << _instances.size() << " instances.";
+		return;
+	}
+	_instances[index] = instance;
+	_instancesChanged = true;
+}
+
+/*! Returns the instances. Use setInstance() or setInstances() to change them. */
+const std::vector<GaborArray::Instance>& GaborArray::getInstances(void) const {
+	return _instances;
+}
+
+/*! Returns the number of instances. */
+size_t GaborArray::size(void) const {
+	return _instances.size();
+}
+
+/*! Removes all of the instances. */
+void GaborArray::clear(void) {
+	_instances.clear();
+	_instancesChanged = true;
+}
+
+/*! Draws all of the patches with one draw call. If the instances have changed since the last time they were drawn,
+their settings are uploaded to the video card first. */
+void GaborArray::draw(void) {
+	if (!_shader.isLoaded()) {
+		CX::Instances::Log.error("GaborArray") << "draw(): setup() must be called before the patches can be drawn.";
+		return;
+	}
+
+	if (_instancesChanged) {
+		_uploadInstances();
+	}
+
+	if (_instances.empty()) {
+		return;
+	}
+
+	_shader.begin();
+
+	_shader.setUniform4f("color1", color1.r, color1.g, color1.b, color1.a);
+	_shader.setUniform4f("color2", color2.r, color2.g, color2.b, color2.a);
+
+#if OF_VERSION_MAJOR == 0 && OF_VERSION_MINOR == 9 && OF_VERSION_PATCH >= 0
+	_vbo.drawInstanced(GL_TRIANGLE_STRIP, 0, 4, _instances.size());
+#else
+	//ofVbo can't set attribute divisors in this version of openFrameworks, so they are set around the draw.
+	glVertexAttribDivisor(gaborArrayCenterLocation, 1);
+	glVertexAttribDivisor(gaborArrayWaveLocation, 1);
+	glVertexAttribDivisor(gaborArrayShapeLocation, 1);
+
+	_vbo.drawInstanced(GL_TRIANGLE_STRIP, 0, 4, _instances.size());
+
+	glVertexAttribDivisor(gaborArrayCenterLocation, 0);
+	glVertexAttribDivisor(gaborArrayWaveLocation, 0);
+	glVertexAttribDivisor(gaborArrayShapeLocation, 0);
+#endif
+
+	_shader.end();
+}
+
+/*! \brief Get a reference to the ofShader used by this class. Use this only if
+you want to do advanced things directly with the shader. */
+ofShader& GaborArray::getShader(void) {
+	return _shader;
+}
+
+void GaborArray::_uploadInstances(void) {
+	size_t count = _instances.size();
+
+	_centerData.resize(count * 2);
+	_waveData.resize(count * 4);
+	_shapeData.resize(count * 3);
+
+	for (size_t i = 0; i < count; i++) {
+		const Instance& inst = _instances[i];
+
+		_centerData[i * 2 + 0] = inst.center.x;
+		_centerData[i * 2 + 1] = inst.center.y;
+
+		float angle = ofDegToRad(inst.angle);
+		float phase = fmod(inst.phase, 360.0f) / 360.0f;
+		if (phase < 0) {
+			phase += 1;
+		}
+		_waveData[i * 4 + 0] = cos(angle);
+		_waveData[i * 4 + 1] = sin(angle);
+		_waveData[i * 4 + 2] = 1 / inst.wavelength;
+		_waveData[i * 4 + 3] = phase;
+
+		_shapeData[i * 3 + 0] = inst.radius;
+		_shapeData[i * 3 + 1] = inst.controlParameter;
+		_shapeData[i * 3 + 2] = CX::Util::clamp<float>(inst.contrast, 0, 1);
+	}
+
+	_instancesChanged = false;
+
+	if (count == 0) {
+		return;
+	}
+
+	if (count == _uploadedInstanceCount) {
+		_vbo.updateAttributeData(gaborArrayCenterLocation, _centerData.data(), count);
+		_vbo.updateAttributeData(gaborArrayWaveLocation, _waveData.data(), count);
+		_vbo.updateAttributeData(gaborArrayShapeLocation, _shapeData.data(), count);
+	} else {
+		_vbo.setAttributeData(gaborArrayCenterLocation, _centerData.data(), 2, count, GL_DYNAMIC_DRAW, 2 * sizeof(float));
+		_vbo.setAttributeData(gaborArrayWaveLocation, _waveData.data(), 4, count, GL_DYNAMIC_DRAW, 4 * sizeof(float));
+		_vbo.setAttributeData(gaborArrayShapeLocation, _shapeData.data(), 3, count, GL_DYNAMIC_DRAW, 3 * sizeof(float));
+
+#if OF_VERSION_MAJOR == 0 && OF_VERSION_MINOR == 9 && OF_VERSION_PATCH >= 0
+		_vbo.setAttributeDivisor(gaborArrayCenterLocation, 1);
+		_vbo.setAttributeDivisor(gaborArrayWaveLocation, 1);
+		_vbo.setAttributeDivisor(gaborArrayShapeLocation, 1);
+#endif
+
+		_uploadedInstanceCount = count;
+	}
+}
+
+
+
+
+
+
+//Calls rowFunction(beginRow, endRow) for blocks of rows on as many threads as there are cores, if there are enough
+//pixels for it to be worth starting threads. The calling thread does the last block.
+static void gaborForEachRowBlock(unsigned int width, unsigned int height, const std::function<void(unsigned int, unsigned int)>& rowFunction) {
+	const unsigned int minPixelsPerThread = 32768;
+
+	unsigned int threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	threadCount = std::min(threadCount, std::max((width * height) / minPixelsPerThread, 1u));
+	threadCount = std::min(threadCount, std::max(height, 1u));
+
+	if (threadCount <= 1) {
+		rowFunction(0, height);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	unsigned int beginRow = 0;
+	for (unsigned int i = 0; i < threadCount; i++) {
+		unsigned int endRow = beginRow + (height / threadCount) + ((i < height % threadCount) ? 1 : 0);
+		if (i == threadCount - 1) {
+			rowFunction(beginRow, endRow);
+		} else {
+			threads.push_back(std::thread(std::cref(rowFunction), beginRow, endRow));
+		}
+		beginRow = endRow;
+	}
+
+	for (std::thread& t : threads) {
+		t.join();
+	}
+}
+
+//The built in functions are recognized so that their loops can be inlined and vectorized
+//instead of calling through the std::function for every pixel.
+enum class GaborBuiltInWave {
+	OTHER,
+	SINE,
+	SQUARE,
+	TRIANGLE,
+	SAW
+};
+
+static GaborBuiltInWave gaborIdentifyWave(const std::function<float(float)>& f) {
+	typedef float(*WaveFunctionPointer)(float);
+	const WaveFunctionPointer* target = f.target<WaveFunctionPointer>();
+	if (target == nullptr) {
+		return GaborBuiltInWave::OTHER;
+	}
+	if (*target == &WaveformProperties::sine) {
+		return GaborBuiltInWave::SINE;
+	} else if (*target == &WaveformProperties::square) {
+		return GaborBuiltInWave::SQUARE;
+	} else if (*target == &WaveformProperties::triangle) {
+		return GaborBuiltInWave::TRIANGLE;
+	} else if (*target == &WaveformProperties::saw) {
+		return GaborBuiltInWave::SAW;
+	}
+	return GaborBuiltInWave::OTHER;
+}
+
+enum class GaborBuiltInEnvelope {
+	OTHER,
+	NONE,
+	CIRCLE,
+	LINEAR,
+	COSINE,
+	GAUSSIAN
+};
+
+static GaborBuiltInEnvelope gaborIdentifyEnvelope(const std::function<float(float, float)>& f) {
+	typedef float(*EnvelopeFunctionPointer)(float, float);
+	const EnvelopeFunctionPointer* target = f.target<EnvelopeFunctionPointer>();
+	if (target == nullptr) {
+		return GaborBuiltInEnvelope::OTHER;
+	}
+	if (*target == &EnvelopeProperties::none) {
+		return GaborBuiltInEnvelope::NONE;
+	} else if (*target == &EnvelopeProperties::circle) {
+		return GaborBuiltInEnvelope::CIRCLE;
+	} else if (*target == &EnvelopeProperties::linear) {
+		return GaborBuiltInEnvelope::LINEAR;
+	} else if (*target == &EnvelopeProperties::cosine) {
+		return GaborBuiltInEnvelope::COSINE;
+	} else if (*target == &EnvelopeProperties::gaussian) {
+		return GaborBuiltInEnvelope::GAUSSIAN;
+	}
+	return GaborBuiltInEnvelope::OTHER;
+}
+
+static void gaborClampRow(float* row, unsigned int width) {
+	for (unsigned int x = 0; x < width; x++) {
+		row[x] = std::min(std::max(row[x], 0.0f), 1.0f);
+	}
+}
 
 /*! This function draws a two-dimensional waveform pattern to an ofFloatPixels objects.
 The results of this function are not intended to be used directly, but to be applied
 to an image, for example. The pattern lacks color information, but can be used as an alpha mask,
 used to control color mixing, or otherwise.
+
+Large patterns are split into blocks of rows that are calculated on several threads at once.
 \param properties The properties that will be used to create the pattern.
 \return An ofFloatPixels object containing the pattern.
 */
@@ -280,6 +640,9 @@ ofFloatPixels waveformToPixels(const WaveformProperties& properties) {
 	unsigned int height = ceil(properties.height);
 	pix.allocate(width, height, ofImageType::OF_IMAGE_GRAYSCALE);
 
+	if (width == 0 || height == 0) {
+		return pix;
+	}
 
 	float theta = properties.angle * PI / 180;
 	float slope = tan(theta);
@@ -302,24 +665,53 @@ ofFloatPixels waveformToPixels(const WaveformProperties& properties) {
 	float C = -intercept;
 	float mult = 1 / sqrt(A * A + 1 * 1);
 
-	for (int yi = 0; yi < pix.getHeight(); yi++) {
-		for (int xi = 0; xi < pix.getWidth(); xi++) {
-
-			//Center so that x and y are relative to the origin.
-			float px = xi - center.x;
-			float py = yi - center.y;
-
-			float distFromLine = (A*px + py + C) * mult; //B == 1
+	//The distance from the line, in wavelengths, changes by the same amount for each step along a row.
+	float xStep = A * mult * inverseWavelength;
 
-			float wavePos = fmod(distFromLine * inverseWavelength, 1);
-			float intensity = properties.waveFunction(wavePos);
+	GaborBuiltInWave builtIn = gaborIdentifyWave(properties.waveFunction);
+	float* data = &pix[0];
 
-			intensity = CX::Util::clamp<float>(intensity, 0, 1);
+	gaborForEachRowBlock(width, height, [&](unsigned int beginRow, unsigned int endRow) {
+		for (unsigned int yi = beginRow; yi < endRow; yi++) {
+			float* row = data + (size_t)yi * width;
 
-			int index = xi + yi * pix.getWidth();
-			pix[index] = intensity;
+			//Center so that x and y are relative to the origin.
+			float py = yi - center.y;
+			float rowStart = (A * -center.x + py + C) * mult * inverseWavelength; //B == 1
+
+			for (unsigned int xi = 0; xi < width; xi++) {
+				float v = rowStart + xi * xStep;
+				row[xi] = v - std::trunc(v); //fmod(v, 1)
+			}
+
+			switch (builtIn) {
+			case GaborBuiltInWave::SINE:
+				for (unsigned int xi = 0; xi < width; xi++) {
+					row[xi] = (std::sin(row[xi] * (float)TWO_PI) + 1) / 2;
+				}
+				break;
+			case GaborBuiltInWave::SQUARE:
+				for (unsigned int xi = 0; xi < width; xi++) {
+					row[xi] = (row[xi] < 0.5f) ? 1.0f : 0.0f;
+				}
+				break;
+			case GaborBuiltInWave::TRIANGLE:
+				for (unsigned int xi = 0; xi < width; xi++) {
+					row[xi] = (row[xi] < 0.5f) ? (2 * row[xi]) : (2 - (2 * row[xi]));
+				}
+				break;
+			case GaborBuiltInWave::SAW:
+				break;
+			case GaborBuiltInWave::OTHER:
+				for (unsigned int xi = 0; xi < width; xi++) {
+					row[xi] = properties.waveFunction(row[xi]);
+				}
+				break;
+			}
+
+			gaborClampRow(row, width);
 		}
-	}
+	});
 
 	return pix;
 }
@@ -369,29 +761,80 @@ ofFloatPixels result = Draw::envelopeToPixels(properties); //Get the pixels
 float level = result.getColor(1,2).getBrightness(); //where 1 and 2 are some x and y coordinates
 \endcode
 
+Large envelopes are split into blocks of rows that are calculated on several threads at once.
+
 \param properties The properties of the envelope.
 \return An ofFloatPixels containing the envelope.
 */
 ofFloatPixels envelopeToPixels(const EnvelopeProperties& properties) {
 	ofFloatPixels pix;
 
-	pix.allocate(ceil(properties.width), ceil(properties.height), ofImageType::OF_IMAGE_GRAYSCALE);
-
-	ofPoint center = ofPoint(properties.width / 2, properties.height / 2);
-
-	for (int y = 0; y < pix.getHeight(); y++) {
-		for (int x = 0; x < pix.getWidth(); x++) {
-
-			float d = center.distance(ofPoint(x, y));
+	unsigned int width = ceil(properties.width);
+	unsigned int height = ceil(properties.height);
+	pix.allocate(width, height, ofImageType::OF_IMAGE_GRAYSCALE);
 
-			float amount = properties.envelopeFunction(d, properties.controlParameter);
+	if (width == 0 || height == 0) {
+		return pix;
+	}
 
-			amount = CX::Util::clamp<float>(amount, 0, 1);
+	ofPoint center = ofPoint(properties.width / 2, properties.height / 2);
 
-			int index = x + y * pix.getWidth();
-			pix[index] = amount;
+	float cp = properties.controlParameter;
+	GaborBuiltInEnvelope builtIn = gaborIdentifyEnvelope(properties.envelopeFunction);
+	float* data = &pix[0];
+
+	gaborForEachRowBlock(width, height, [&](unsigned int beginRow, unsigned int endRow) {
+		for (unsigned int y = beginRow; y < endRow; y++) {
+			float* row = data + (size_t)y * width;
+
+			//Squared distances from the center, which is all that some of the envelopes need.
+			float dy = y - center.y;
+			for (unsigned int x = 0; x < width; x++) {
+				float dx = x - center.x;
+				row[x] = dx * dx + dy * dy;
+			}
+
+			switch (builtIn) {
+			case GaborBuiltInEnvelope::NONE:
+				for (unsigned int x = 0; x < width; x++) {
+					row[x] = 1;
+				}
+				break;
+			case GaborBuiltInEnvelope::CIRCLE:
+				for (unsigned int x = 0; x < width; x++) {
+					row[x] = (std::sqrt(row[x]) <= cp) ? 1.0f : 0.0f;
+				}
+				break;
+			case GaborBuiltInEnvelope::LINEAR:
+				for (unsigned int x = 0; x < width; x++) {
+					float d = std::sqrt(row[x]);
+					row[x] = (d <= cp) ? (1 - (d / cp)) : 0.0f;
+				}
+				break;
+			case GaborBuiltInEnvelope::COSINE:
+				for (unsigned int x = 0; x < width; x++) {
+					float d = std::sqrt(row[x]);
+					row[x] = (d < cp) ? ((std::cos((float)PI * d / cp) + 1) / 2) : 0.0f;
+				}
+				break;
+			case GaborBuiltInEnvelope::GAUSSIAN:
+				{
+					float k = -1 / (2 * (cp * cp));
+					for (unsigned int x = 0; x < width; x++) {
+						row[x] = std::exp(row[x] * k);
+					}
+				}
+				break;
+			case GaborBuiltInEnvelope::OTHER:
+				for (unsigned int x = 0; x < width; x++) {
+					row[x] = properties.envelopeFunction(std::sqrt(row[x]), cp);
+				}
+				break;
+			}
+
+			gaborClampRow(row, width);
 		}
-	}
+	});
 
 	return pix;
 }
@@ -491,26 +934,42 @@ ofFloatPixels gaborToPixels(ofColor color1, ofColor color2, const ofFloatPixels&
 			" The minimum of both will be used.";
 	}
 
-	int width = ceil(min(wave.getWidth(), envelope.getWidth()));
-	int height = ceil(min(wave.getHeight(), envelope.getHeight()));
+	unsigned int width = min(wave.getWidth(), envelope.getWidth());
+	unsigned int height = min(wave.getHeight(), envelope.getHeight());
 
-	
 	pix.allocate(width, height, ofImageType::OF_IMAGE_COLOR_ALPHA);
 
-	for (int x = 0; x < pix.getHeight(); x++) {
-		for (int y = 0; y < pix.getWidth(); y++) {
-
-			int index = x + y * pix.getWidth();
-
-			float waveProportion = wave[index];
-			ofFloatColor lerped = color1.getLerped(color2, waveProportion);
-
-			float envelopeProportion = envelope[index];
-			lerped.a = envelopeProportion;
+	if (width == 0 || height == 0) {
+		return pix;
+	}
 
-			pix.setColor(x, y, lerped);
+	ofFloatColor c1 = color1;
+	ofFloatColor c2 = color2;
+	float dr = c2.r - c1.r;
+	float dg = c2.g - c1.g;
+	float db = c2.b - c1.b;
+
+	const float* waveData = &wave[0];
+	const float* envelopeData = &envelope[0];
+	unsigned int waveWidth = wave.getWidth();
+	unsigned int envelopeWidth = envelope.getWidth();
+	float* data = &pix[0];
+
+	gaborForEachRowBlock(width, height, [&](unsigned int beginRow, unsigned int endRow) {
+		for (unsigned int y = beginRow; y < endRow; y++) {
+			const float* waveRow = waveData + (size_t)y * waveWidth;
+			const float* envelopeRow = envelopeData + (size_t)y * envelopeWidth;
+			float* row = data + (size_t)y * width * 4;
+
+			for (unsigned int x = 0; x < width; x++) {
+				float waveProportion = waveRow[x];
+				row[x * 4 + 0] = c1.r + dr * waveProportion;
+				row[x * 4 + 1] = c1.g + dg * waveProportion;
+				row[x * 4 + 2] = c1.b + db * waveProportion;
+				row[x * 4 + 3] = envelopeRow[x];
+			}
 		}
-	}
+	});
 
 	return pix;
 }
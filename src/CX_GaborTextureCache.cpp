@@ -0,0 +1,545 @@
+#include "CX_GaborTextureCache.h"
+
+#include <tuple>
+
+#include "CX_Logger.h"
+
+namespace CX {
+namespace Draw {
+
+bool GaborTextureCache::Key::operator<(const Key& right) const {
+	return std::tie(width, height, color1, color2, angle, wavelength, phase, waveFunction, controlParameter, envelopeFunction) <
+		std::tie(right.width, right.height, right.color1, right.color2, right.angle, right.wavelength, right.phase,
+		right.waveFunction, right.controlParameter, right.envelopeFunction);
+}
+
+GaborTextureCache::GaborTextureCache(void) :
+	_pageSize(2048),
+	_memoryBudget(0),
+	_pendingCount(0),
+	_stopWorker(false)
+{}
+
+GaborTextureCache::~GaborTextureCache(void) {
+	_stopWorkerThread();
+}
+
+/*! Removes all of the patches from the cache and sets the size of the pages and the memory budget.
+It is not necessary to call this function if the defaults are acceptable.
+\param pageSize The width and height of each page, in pixels. Each page takes `pageSize * pageSize * 4` bytes of video memory.
+No patch can be larger than a page.
+\param memoryBudget The most video memory that the pages can use, in bytes. See setMemoryBudget(). */
+void GaborTextureCache::setup(unsigned int pageSize, uint64_t memoryBudget) {
+	clear();
+	_pageSize = pageSize;
+	_memoryBudget = memoryBudget;
+}
+
+/*! Starts making a patch on the background thread, unless it is already in the cache or being made.
+Call update() or waitUntilReady() to put finished patches into the texture pages.
+\param properties The properties of the patch. See isCacheable().
+\return `true` if the patch is in the cache or will be, `false` if it can't be cached. */
+bool GaborTextureCache::request(const GaborProperties& properties) {
+	if (!isCacheable(properties)) {
+		CX::Instances::Log.error("GaborTextureCache") << "request(): Only patches whose wave and envelope functions are plain functions"
+			" (like WaveformProperties::sine) can be cached.";
+		return false;
+	}
+
+	//There is one pixel of padding to the right of and below each patch.
+	if (ceil(properties.width) + 1 > _pageSize || ceil(properties.height) + 1 > _pageSize) {
+		CX::Instances::Log.error("GaborTextureCache") << "request(): The patch (" << properties.width << " by " << properties.height <<
+			") does not fit on a page (" << _pageSize << " by " << _pageSize << ").";
+		return false;
+	}
+
+	Key key = _makeKey(properties);
+	auto it = _entries.find(key);
+	if (it != _entries.end()) {
+		_touch(it->second);
+		return true;
+	}
+
+	Entry& entry = _entries[key];
+	entry.lruPosition = _lru.insert(_lru.begin(), key);
+	_pendingCount++;
+
+	_startWorker();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		Job job;
+		job.key = key;
+		job.properties = properties;
+		_jobs.push_back(job);
+	}
+	_jobQueued.notify_one();
+
+	return true;
+}
+
+/*! Puts the patches that have been made on the background thread into the texture pages. This is called by
+draw() and waitUntilReady(), so it only needs to be called if you want the patches to be uploaded at a certain time. */
+void GaborTextureCache::update(void) {
+	std::vector<Result> results;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		results.swap(_results);
+	}
+
+	for (const Result& result : results) {
+		auto it = _entries.find(result.key);
+		if (it == _entries.end() || it->second.ready) {
+			continue; //The patch was removed or was already made by draw().
+		}
+		_insert(result.key, result.pixels);
+	}
+}
+
+/*! Returns `true` if the patch with the given properties is in a texture page and can be drawn right away. */
+bool GaborTextureCache::isReady(const GaborProperties& properties) const {
+	if (!isCacheable(properties)) {
+		return false;
+	}
+	auto it = _entries.find(_makeKey(properties));
+	return it != _entries.end() && it->second.ready;
+}
+
+/*! Waits until all of the patches that have been requested are ready to be drawn.
+\param timeout The longest time to wait. If this is negative, this waits for as long as it takes.
+\return `true` if all of the patches are ready, `false` if the timeout expired. */
+bool GaborTextureCache::waitUntilReady(CX_Millis timeout) {
+	CX_Millis endTime = CX::Instances::Clock.now() + timeout;
+
+	while (true) {
+		update();
+		if (_pendingCount == 0) {
+			return true;
+		}
+
+		if (timeout >= CX_Millis(0) && CX::Instances::Clock.now() >= endTime) {
+			return false;
+		}
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_jobCompleted.wait_for(lock, std::chrono::milliseconds(1), [this](void) { return !_results.empty(); });
+	}
+}
+
+/*! Draws a patch centered on a point. If the patch is not ready, it is made on this thread, which can take a while,
+and a warning is logged. Patches that can't be cached are drawn with Draw::gabor().
+\param properties The properties of the patch.
+\param center The point to center the patch on.
+\return `true` if the patch was drawn from the cache. */
+bool GaborTextureCache::draw(const GaborProperties& properties, ofPoint center) {
+	if (!isCacheable(properties)) {
+		CX::Instances::Log.error("GaborTextureCache") << "draw(): The patch can't be cached, so it was drawn with Draw::gabor().";
+		Draw::gabor(center, properties);
+		return false;
+	}
+
+	update();
+
+	Key key = _makeKey(properties);
+	auto it = _entries.find(key);
+	if (it == _entries.end() || !it->second.ready) {
+		CX::Instances::Log.warning("GaborTextureCache") << "draw(): The patch was not ready, so it was made while drawing. "
+			"Use request() and waitUntilReady() to make patches before they are needed.";
+
+		if (!_insert(key, _makePixels(properties))) {
+			Draw::gabor(center, properties);
+			return false;
+		}
+		it = _entries.find(key);
+	}
+
+	Entry& entry = it->second;
+	_touch(entry);
+
+	const ofRectangle& r = entry.region;
+	ofSetColor(255);
+	_pages[entry.page].texture.drawSubsection(center.x - r.width / 2, center.y - r.height / 2, r.width, r.height, r.x, r.y, r.width, r.height);
+	return true;
+}
+
+/*! Removes all of the patches and frees the texture pages. Patches that were being made are discarded. */
+void GaborTextureCache::clear(void) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.clear();
+		_results.clear();
+	}
+
+	_entries.clear();
+	_lru.clear();
+	_pendingCount = 0;
+	_pages.clear();
+}
+
+/*! Sets the most video memory that the texture pages can use. When a new patch does not fit in the pages and
+another page would go over the budget, the least recently used patches are removed until it fits. If the budget is
+lowered below the current usage, patches are removed and empty pages are freed until the usage is within the budget.
+At least one page is always allowed.
+\param bytes The budget, in bytes. If this is 0, there is no limit. */
+void GaborTextureCache::setMemoryBudget(uint64_t bytes) {
+	_memoryBudget = bytes;
+	_releasePagesOverBudget();
+}
+
+/*! Returns the memory budget, in bytes. See setMemoryBudget(). */
+uint64_t GaborTextureCache::getMemoryBudget(void) const {
+	return _memoryBudget;
+}
+
+/*! Returns the amount of video memory used by the texture pages, in bytes. */
+uint64_t GaborTextureCache::getMemoryUsage(void) const {
+	uint64_t pages = 0;
+	for (const Page& page : _pages) {
+		if (page.allocated) {
+			pages++;
+		}
+	}
+	return pages * _pageBytes();
+}
+
+/*! Returns the number of patches that are ready to be drawn. */
+size_t GaborTextureCache::getReadyCount(void) const {
+	return _entries.size() - _pendingCount;
+}
+
+/*! Returns the number of patches that have been requested but are not ready yet. */
+size_t GaborTextureCache::getPendingCount(void) const {
+	return _pendingCount;
+}
+
+/*! Returns `true` if a patch with the given properties can be cached, which is the case if its wave and envelope
+functions are plain functions, like WaveformProperties::sine and EnvelopeProperties::gaussian. */
+bool GaborTextureCache::isCacheable(const GaborProperties& properties) {
+	typedef float(*WaveFunctionPointer)(float);
+	typedef float(*EnvelopeFunctionPointer)(float, float);
+
+	const WaveFunctionPointer* wave = properties.wave.waveFunction.target<WaveFunctionPointer>();
+	const EnvelopeFunctionPointer* envelope = properties.envelope.envelopeFunction.target<EnvelopeFunctionPointer>();
+
+	return wave != nullptr && *wave != nullptr && envelope != nullptr && *envelope != nullptr;
+}
+
+void GaborTextureCache::_startWorker(void) {
+	if (_workerThread.joinable()) {
+		return;
+	}
+	_stopWorker = false;
+	_workerThread = std::thread(&GaborTextureCache::_workerLoop, this);
+}
+
+void GaborTextureCache::_stopWorkerThread(void) {
+	if (!_workerThread.joinable()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopWorker = true;
+		_jobs.clear();
+	}
+	_jobQueued.notify_one();
+	_workerThread.join();
+}
+
+void GaborTextureCache::_workerLoop(void) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true) {
+		_jobQueued.wait(lock, [this](void) { return _stopWorker || !_jobs.empty(); });
+		if (_stopWorker) {
+			return;
+		}
+
+		Job job = _jobs.front();
+		_jobs.pop_front();
+
+		lock.unlock();
+		Result result;
+		result.key = job.key;
+		result.pixels = _makePixels(job.properties);
+		lock.lock();
+
+		_results.push_back(result);
+		_jobCompleted.notify_all();
+	}
+}
+
+GaborTextureCache::Key GaborTextureCache::_makeKey(const GaborProperties& properties) {
+	typedef float(*WaveFunctionPointer)(float);
+	typedef float(*EnvelopeFunctionPointer)(float, float);
+
+	auto packColor = [](const ofColor& c) -> uint32_t {
+		return ((uint32_t)c.r << 24) | ((uint32_t)c.g << 16) | ((uint32_t)c.b << 8) | (uint32_t)c.a;
+	};
+
+	const WaveFunctionPointer* wave = properties.wave.waveFunction.target<WaveFunctionPointer>();
+	const EnvelopeFunctionPointer* envelope = properties.envelope.envelopeFunction.target<EnvelopeFunctionPointer>();
+
+	//The width and height of the wave and envelope are ignored by gaborToPixels(), so they are not part of the key.
+	Key key;
+	key.width = properties.width;
+	key.height = properties.height;
+	key.color1 = packColor(properties.color1);
+	key.color2 = packColor(properties.color2);
+	key.angle = properties.wave.angle;
+	key.wavelength = properties.wave.wavelength;
+	key.phase = properties.wave.phase;
+	key.waveFunction = wave ? reinterpret_cast<uintptr_t>(*wave) : 0;
+	key.controlParameter = properties.envelope.controlParameter;
+	key.envelopeFunction = envelope ? reinterpret_cast<uintptr_t>(*envelope) : 0;
+	return key;
+}
+
+//Makes the pixels of a patch with one transparent pixel of padding to the right of and below it, so that
+//patches next to each other in a page do not bleed into each other when they are drawn with filtering.
+ofPixels GaborTextureCache::_makePixels(const GaborProperties& properties) {
+	ofFloatPixels patch = gaborToPixels(properties);
+
+	unsigned int width = patch.getWidth();
+	unsigned int height = patch.getHeight();
+
+	ofPixels pix;
+	pix.allocate(width + 1, height + 1, ofImageType::OF_IMAGE_COLOR_ALPHA);
+	unsigned char* data = &pix[0];
+	std::fill(data, data + pix.size(), 0);
+
+	if (width == 0 || height == 0) {
+		return pix;
+	}
+
+	const float* patchData = &patch[0];
+	for (unsigned int y = 0; y < height; y++) {
+		const float* src = patchData + (size_t)y * width * 4;
+		unsigned char* dst = data + (size_t)y * (width + 1) * 4;
+		for (unsigned int i = 0; i < width * 4; i++) {
+			dst[i] = (unsigned char)(CX::Util::clamp<float>(src[i], 0, 1) * 255 + 0.5f);
+		}
+	}
+
+	return pix;
+}
+
+void GaborTextureCache::_touch(Entry& entry) {
+	_lru.splice(_lru.begin(), _lru, entry.lruPosition);
+}
+
+bool GaborTextureCache::_insert(const Key& key, const ofPixels& pixels) {
+	auto it = _entries.find(key);
+	if (it == _entries.end()) {
+		it = _entries.insert(std::make_pair(key, Entry())).first;
+		it->second.lruPosition = _lru.insert(_lru.begin(), key);
+		_pendingCount++;
+	}
+
+	unsigned int width = pixels.getWidth();
+	unsigned int height = pixels.getHeight();
+
+	if (width > _pageSize || height > _pageSize) {
+		CX::Instances::Log.error("GaborTextureCache") << "A patch (" << (width - 1) << " by " << (height - 1) <<
+			") does not fit on a page (" << _pageSize << " by " << _pageSize << ").";
+		_removeEntry(it);
+		return false;
+	}
+
+	size_t pageIndex = 0;
+	ofRectangle allocation;
+	while (!_allocate(width, height, &pageIndex, &allocation)) {
+		if (_addPage()) {
+			continue;
+		}
+		if (!_evictLeastRecentlyUsed(&key)) {
+			CX::Instances::Log.error("GaborTextureCache") << "A patch (" << (width - 1) << " by " << (height - 1) <<
+				") could not be added to the cache.";
+			_removeEntry(it);
+			return false;
+		}
+	}
+
+	Page& page = _pages[pageIndex];
+	const ofTextureData& texData = page.texture.getTextureData();
+	glBindTexture(texData.textureTarget, texData.textureID);
+	glTexSubImage2D(texData.textureTarget, 0, allocation.x, allocation.y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+	glBindTexture(texData.textureTarget, 0);
+	page.entryCount++;
+
+	Entry& entry = it->second;
+	entry.ready = true;
+	entry.page = pageIndex;
+	entry.allocation = allocation;
+	entry.region = ofRectangle(allocation.x, allocation.y, width - 1, height - 1);
+	_pendingCount--;
+	_touch(entry);
+
+	return true;
+}
+
+bool GaborTextureCache::_allocate(unsigned int width, unsigned int height, size_t* page, ofRectangle* allocation) {
+	for (size_t i = 0; i < _pages.size(); i++) {
+		if (_pages[i].allocated && _allocateInPage(_pages[i], width, height, allocation)) {
+			*page = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+//Patches are packed into shelves (rows as tall as the first patch put in them). The space left by removed
+//patches is reused for later patches that fit in it.
+bool GaborTextureCache::_allocateInPage(Page& page, unsigned int width, unsigned int height, ofRectangle* allocation) {
+	int best = -1;
+	for (size_t i = 0; i < page.freeRegions.size(); i++) {
+		const ofRectangle& fr = page.freeRegions[i];
+		if (fr.width >= width && fr.height >= height) {
+			if (best == -1 || fr.width * fr.height < page.freeRegions[best].width * page.freeRegions[best].height) {
+				best = i;
+			}
+		}
+	}
+
+	if (best != -1) {
+		ofRectangle fr = page.freeRegions[best];
+		page.freeRegions.erase(page.freeRegions.begin() + best);
+
+		*allocation = ofRectangle(fr.x, fr.y, width, height);
+		if (fr.width > width) {
+			page.freeRegions.push_back(ofRectangle(fr.x + width, fr.y, fr.width - width, height));
+		}
+		if (fr.height > height) {
+			page.freeRegions.push_back(ofRectangle(fr.x, fr.y + height, fr.width, fr.height - height));
+		}
+		return true;
+	}
+
+	Shelf* bestShelf = nullptr;
+	for (Shelf& shelf : page.shelves) {
+		if (shelf.height >= height && _pageSize - shelf.usedWidth >= width) {
+			if (bestShelf == nullptr || shelf.height < bestShelf->height) {
+				bestShelf = &shelf;
+			}
+		}
+	}
+
+	if (bestShelf != nullptr) {
+		*allocation = ofRectangle(bestShelf->usedWidth, bestShelf->y, width, height);
+		if (bestShelf->height > height) {
+			page.freeRegions.push_back(ofRectangle(bestShelf->usedWidth, bestShelf->y + height, width, bestShelf->height - height));
+		}
+		bestShelf->usedWidth += width;
+		return true;
+	}
+
+	if (page.nextShelfY + height <= _pageSize) {
+		Shelf shelf;
+		shelf.y = page.nextShelfY;
+		shelf.height = height;
+		shelf.usedWidth = width;
+		page.shelves.push_back(shelf);
+		page.nextShelfY += height;
+
+		*allocation = ofRectangle(0, shelf.y, width, height);
+		return true;
+	}
+
+	return false;
+}
+
+bool GaborTextureCache::_addPage(void) {
+	uint64_t allocatedPages = getMemoryUsage() / _pageBytes();
+	if (_memoryBudget > 0 && allocatedPages > 0 && (allocatedPages + 1) * _pageBytes() > _memoryBudget) {
+		return false;
+	}
+
+	Page* page = nullptr;
+	for (Page& p : _pages) {
+		if (!p.allocated) {
+			page = &p;
+			break;
+		}
+	}
+	if (page == nullptr) {
+		_pages.push_back(Page());
+		page = &_pages.back();
+	}
+
+	//The page starts out transparent so that the padding around patches is transparent.
+	std::vector<unsigned char> transparent(_pageBytes(), 0);
+	page->texture.allocate(_pageSize, _pageSize, GL_RGBA);
+	page->texture.loadData(transparent.data(), _pageSize, _pageSize, GL_RGBA);
+
+	page->allocated = true;
+	page->entryCount = 0;
+	page->nextShelfY = 0;
+	page->shelves.clear();
+	page->freeRegions.clear();
+
+	return true;
+}
+
+//Removes the least recently used patch that is ready, other than `keep`, which may be nullptr.
+bool GaborTextureCache::_evictLeastRecentlyUsed(const Key* keep) {
+	for (auto rit = _lru.rbegin(); rit != _lru.rend(); ++rit) {
+		if (keep != nullptr && !(*rit < *keep) && !(*keep < *rit)) {
+			continue;
+		}
+
+		auto it = _entries.find(*rit);
+		if (it != _entries.end() && it->second.ready) {
+			_removeEntry(it);
+			return true;
+		}
+	}
+	return false;
+}
+
+void GaborTextureCache::_removeEntry(std::map<Key, Entry>::iterator it) {
+	Entry& entry = it->second;
+
+	if (entry.ready) {
+		Page& page = _pages[entry.page];
+		page.entryCount--;
+		if (page.entryCount == 0) {
+			page.nextShelfY = 0;
+			page.shelves.clear();
+			page.freeRegions.clear();
+		} else {
+			page.freeRegions.push_back(entry.allocation);
+		}
+	} else {
+		_pendingCount--;
+	}
+
+	_lru.erase(entry.lruPosition);
+	_entries.erase(it);
+}
+
+void GaborTextureCache::_releasePagesOverBudget(void) {
+	if (_memoryBudget == 0) {
+		return;
+	}
+
+	auto releaseEmptyPages = [this](void) {
+		for (Page& page : _pages) {
+			if (page.allocated && page.entryCount == 0 && getMemoryUsage() > _memoryBudget) {
+				page.texture.clear();
+				page.allocated = false;
+			}
+		}
+	};
+
+	releaseEmptyPages();
+	while (getMemoryUsage() > _memoryBudget && getMemoryUsage() > _pageBytes()) {
+		if (!_evictLeastRecentlyUsed(nullptr)) {
+			break;
+		}
+		releaseEmptyPages();
+	}
+}
+
+uint64_t GaborTextureCache::_pageBytes(void) const {
+	return (uint64_t)_pageSize * _pageSize * 4;
+}
+
+} //namespace Draw
+} //namespace CX
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ofTexture.h"
+#include "ofRectangle.h"
+
+#include "CX_Clock.h"
+#include "CX_Gabor.h"
+
+namespace CX {
+namespace Draw {
+
+	/*! This class keeps gabor patches that were made with CX::Draw::gaborToPixels() in textures so that
+	experiments that use the same patches over and over do not have to make them again each time. The patches
+	are made on a background thread, so requesting them does not block, and they are packed together into a few
+	large textures (called pages), which uses less video memory than one texture per patch. If a memory budget
+	is set, the patches that were least recently used are removed from the pages to make room for new ones.
+
+	Patches are identified by their GaborProperties. Only patches whose wave and envelope functions are
+	plain functions, like WaveformProperties::sine and EnvelopeProperties::gaussian, can be cached, because
+	other kinds of functions (like lambdas) cannot be compared with one another.
+
+	\code{.cpp}
+	Draw::GaborTextureCache cache;
+
+	Draw::GaborProperties props;
+	props.width = 100;
+	props.height = 100;
+	props.wave.waveFunction = Draw::WaveformProperties::sine;
+	props.envelope.envelopeFunction = Draw::EnvelopeProperties::gaussian;
+	props.envelope.controlParameter = 15;
+
+	//Request all of the orientations that will be used before the trials start.
+	for (int angle = 0; angle < 180; angle += 15) {
+		props.wave.angle = angle;
+		cache.request(props);
+	}
+	cache.waitUntilReady();
+
+	//Later, during a trial:
+	props.wave.angle = 45;
+	cache.draw(props, Disp.getCenter());
+	\endcode
+
+	Apart from the construction of the patches, which happens on the background thread, all of the functions
+	of this class must be called from the main thread.
+	\ingroup video
+	*/
+	class GaborTextureCache {
+	public:
+
+		GaborTextureCache(void);
+		~GaborTextureCache(void);
+
+		void setup(unsigned int pageSize = 2048, uint64_t memoryBudget = 0);
+
+		bool request(const GaborProperties& properties);
+		void update(void);
+		bool isReady(const GaborProperties& properties) const;
+		bool waitUntilReady(CX_Millis timeout = -1);
+
+		bool draw(const GaborProperties& properties, ofPoint center);
+
+		void clear(void);
+
+		void setMemoryBudget(uint64_t bytes);
+		uint64_t getMemoryBudget(void) const;
+		uint64_t getMemoryUsage(void) const;
+
+		size_t getReadyCount(void) const;
+		size_t getPendingCount(void) const;
+
+		static bool isCacheable(const GaborProperties& properties);
+
+	private:
+
+		struct Key {
+			float width;
+			float height;
+			uint32_t color1;
+			uint32_t color2;
+			float angle;
+			float wavelength;
+			float phase;
+			uintptr_t waveFunction;
+			float controlParameter;
+			uintptr_t envelopeFunction;
+
+			bool operator<(const Key& right) const;
+		};
+
+		struct Entry {
+			Entry(void) :
+				ready(false),
+				page(0)
+			{}
+
+			bool ready;
+			size_t page;
+			ofRectangle region; //The part of the page that the patch is in.
+			ofRectangle allocation; //The region plus the padding around it.
+			std::list<Key>::iterator lruPosition;
+		};
+
+		struct Shelf {
+			unsigned int y;
+			unsigned int height;
+			unsigned int usedWidth;
+		};
+
+		struct Page {
+			Page(void) :
+				allocated(false),
+				entryCount(0),
+				nextShelfY(0)
+			{}
+
+			ofTexture texture;
+			bool allocated;
+			unsigned int entryCount;
+			unsigned int nextShelfY;
+			std::vector<Shelf> shelves;
+			std::vector<ofRectangle> freeRegions;
+		};
+
+		struct Job {
+			Key key;
+			GaborProperties properties;
+		};
+
+		struct Result {
+			Key key;
+			ofPixels pixels;
+		};
+
+		unsigned int _pageSize;
+		uint64_t _memoryBudget;
+
+		std::map<Key, Entry> _entries;
+		std::list<Key> _lru; //Most recently used at the front.
+		size_t _pendingCount;
+
+		std::vector<Page> _pages;
+
+		std::thread _workerThread;
+		std::mutex _mutex;
+		std::condition_variable _jobQueued;
+		std::condition_variable _jobCompleted;
+		std::deque<Job> _jobs;
+		std::vector<Result> _results;
+		bool _stopWorker;
+
+		void _startWorker(void);
+		void _stopWorkerThread(void);
+		void _workerLoop(void);
+
+		static Key _makeKey(const GaborProperties& properties);
+		static ofPixels _makePixels(const GaborProperties& properties);
+
+		void _touch(Entry& entry);
+		bool _insert(const Key& key, const ofPixels& pixels);
+		bool _allocate(unsigned int width, unsigned int height, size_t* page, ofRectangle* allocation);
+		bool _allocateInPage(Page& page, unsigned int width, unsigned int height, ofRectangle* allocation);
+		bool _addPage(void);
+		bool _evictLeastRecentlyUsed(const Key* keep);
+		void _removeEntry(std::map<Key, Entry>::iterator it);
+		void _releasePagesOverBudget(void);
+		uint64_t _pageBytes(void) const;
+	};
+
+} //namespace Draw
+} //namespace CX
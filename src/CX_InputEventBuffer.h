@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include "CX_MemoryUsage.h"
+
+namespace CX {
+
+	/*! This class is a fixed-capacity ring buffer of input events, which is what CX_Keyboard, CX_Mouse, and CX_Joystick
+	store their events in. Adding and removing events never allocates memory, so the memory used by an input device stays
+	the same no matter how many events come in (for example, while the mouse is moved during a tracking task). If the buffer
+	is full when an event is added, the oldest event is overwritten and counted in getOverflowCount().
+
+	The events can be looked at without copying them, either all of them with begin() and end() or only the ones that match
+	a predicate with filter(). The first event is the oldest.
+
+	\code{.cpp}
+	const CX_InputEventBuffer<CX_Mouse::Event>& events = Input.Mouse.getEvents();
+
+	for (const CX_Mouse::Event& ev : events.filter([](const CX_Mouse::Event& ev) { return ev.type == CX_Mouse::PRESSED; })) {
+		//Look at each button press...
+	}
+	\endcode
+	\ingroup inputDevices
+	*/
+	template <typename T>
+	class CX_InputEventBuffer {
+	public:
+
+		/*! An iterator over the events in the buffer, from oldest to newest. */
+		class const_iterator {
+		public:
+			typedef std::random_access_iterator_tag iterator_category;
+			typedef T value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const T* pointer;
+			typedef const T& reference;
+
+			const_iterator(void) : _buffer(nullptr), _index(0) {}
+			const_iterator(const CX_InputEventBuffer* buffer, size_t index) : _buffer(buffer), _index(index) {}
+
+			const T& operator*(void) const { return (*_buffer)[_index]; }
+			const T* operator->(void) const { return &(*_buffer)[_index]; }
+			const T& operator[](std::ptrdiff_t n) const { return (*_buffer)[_index + n]; }
+
+			const_iterator& operator++(void) { _index++; return *this; }
+			const_iterator operator++(int) { const_iterator copy = *this; _index++; return copy; }
+			const_iterator& operator--(void) { _index--; return *this; }
+			const_iterator operator--(int) { const_iterator copy = *this; _index--; return copy; }
+
+			const_iterator& operator+=(std::ptrdiff_t n) { _index += n; return *this; }
+			const_iterator& operator-=(std::ptrdiff_t n) { _index -= n; return *this; }
+			const_iterator operator+(std::ptrdiff_t n) const { return const_iterator(_buffer, _index + n); }
+			const_iterator operator-(std::ptrdiff_t n) const { return const_iterator(_buffer, _index - n); }
+			std::ptrdiff_t operator-(const const_iterator& rhs) const { return (std::ptrdiff_t)_index - (std::ptrdiff_t)rhs._index; }
+
+			bool operator==(const const_iterator& rhs) const { return _index == rhs._index; }
+			bool operator!=(const const_iterator& rhs) const { return _index != rhs._index; }
+			bool operator<(const const_iterator& rhs) const { return _index < rhs._index; }
+			bool operator>(const const_iterator& rhs) const { return _index > rhs._index; }
+			bool operator<=(const const_iterator& rhs) const { return _index <= rhs._index; }
+			bool operator>=(const const_iterator& rhs) const { return _index >= rhs._index; }
+
+			/*! Returns the index of the event in the buffer, which can be passed to CX_InputEventBuffer::erase(). */
+			size_t index(void) const { return _index; }
+
+		private:
+			const CX_InputEventBuffer* _buffer;
+			size_t _index;
+		};
+
+		/*! A view of the events in a buffer that match a predicate. The events are not copied: the view
+		checks the predicate as it is iterated over, so it shows the events that are in the buffer at that time.
+		Changing the buffer while iterating over a view is not allowed. */
+		template <typename Predicate>
+		class FilteredView {
+		public:
+
+			/*! An iterator over the events that match the predicate. */
+			class iterator {
+			public:
+				typedef std::forward_iterator_tag iterator_category;
+				typedef T value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef const T* pointer;
+				typedef const T& reference;
+
+				iterator(const FilteredView* view, size_t index) :
+					_view(view),
+					_index(index)
+				{
+					_skip();
+				}
+
+				const T& operator*(void) const { return (*_view->_buffer)[_index]; }
+				const T* operator->(void) const { return &(*_view->_buffer)[_index]; }
+
+				iterator& operator++(void) { _index++; _skip(); return *this; }
+				iterator operator++(int) { iterator copy = *this; ++(*this); return copy; }
+
+				bool operator==(const iterator& rhs) const { return _index == rhs._index; }
+				bool operator!=(const iterator& rhs) const { return _index != rhs._index; }
+
+				/*! Returns the index of the event in the buffer, which can be passed to CX_InputEventBuffer::erase(). */
+				size_t index(void) const { return _index; }
+
+			private:
+				const FilteredView* _view;
+				size_t _index;
+
+				void _skip(void) {
+					size_t size = _view->_buffer->size();
+					while (_index < size && !_view->_predicate((*_view->_buffer)[_index])) {
+						_index++;
+					}
+				}
+			};
+
+			FilteredView(const CX_InputEventBuffer* buffer, Predicate predicate) :
+				_buffer(buffer),
+				_predicate(predicate)
+			{}
+
+			iterator begin(void) const { return iterator(this, 0); }
+			iterator end(void) const { return iterator(this, _buffer->size()); }
+
+			/*! Returns `true` if no events match the predicate. */
+			bool empty(void) const { return begin() == end(); }
+
+			/*! Returns the number of events that match the predicate. This checks every event in the buffer. */
+			size_t size(void) const {
+				return std::count_if(_buffer->begin(), _buffer->end(), _predicate);
+			}
+
+		private:
+			const CX_InputEventBuffer* _buffer;
+			Predicate _predicate;
+		};
+
+		/*! Constructs the buffer with room for at least `capacity` events. See setCapacity(). */
+		CX_InputEventBuffer(size_t capacity = 1024) :
+			_mask(0),
+			_head(0),
+			_size(0),
+			_overflowCount(0)
+		{
+			setCapacity(capacity);
+		}
+
+		/*! Sets the number of events that the buffer can hold. The capacity is rounded up to a power of 2 and is at least 1.
+		If there are more events in the buffer than fit in the new capacity, the oldest ones are removed. */
+		void setCapacity(size_t capacity) {
+			size_t size = 1;
+			while (size < capacity) {
+				size *= 2;
+			}
+
+			std::vector<T> data(size);
+			size_t keep = std::min(_size, size);
+			for (size_t i = 0; i < keep; i++) {
+				data[i] = (*this)[_size - keep + i];
+			}
+
+			_data.swap(data);
+			_trackedBytes.set(_data.size() * sizeof(T));
+			_mask = size - 1;
+			_head = 0;
+			_size = keep;
+		}
+
+		/*! Returns the number of events that the buffer can hold. */
+		size_t capacity(void) const { return _data.size(); }
+
+		/*! Returns the number of events in the buffer. */
+		size_t size(void) const { return _size; }
+
+		/*! Returns `true` if there are no events in the buffer. */
+		bool empty(void) const { return _size == 0; }
+
+		/*! Adds an event to the end of the buffer. If the buffer is full, the oldest event is overwritten.
+		\return `true` if an event was overwritten, `false` otherwise. */
+		bool push_back(const T& ev) {
+			if (_size == _data.size()) {
+				_data[_head] = ev;
+				_head = (_head + 1) & _mask;
+				_overflowCount++;
+				return true;
+			}
+
+			_data[(_head + _size) & _mask] = ev;
+			_size++;
+			return false;
+		}
+
+		/*! Returns the oldest event. The buffer must not be empty. */
+		const T& front(void) const { return _data[_head]; }
+
+		/*! Returns the newest event. The buffer must not be empty. */
+		const T& back(void) const { return _data[(_head + _size - 1) & _mask]; }
+
+		/*! Removes the oldest event. The buffer must not be empty. */
+		void pop_front(void) {
+			_head = (_head + 1) & _mask;
+			_size--;
+		}
+
+		/*! Returns the event at `index`, where 0 is the oldest event. The index must be less than size(). */
+		const T& operator[](size_t index) const { return _data[(_head + index) & _mask]; }
+
+		/*! Returns the event at `index`, where 0 is the oldest event.
+		\throw std::out_of_range If `index` is not less than size(). */
+		const T& at(size_t index) const {
+			if (index >= _size) {
+				throw std::out_of_range("CX_InputEventBuffer::at(): Index out of range.");
+			}
+			return (*this)[index];
+		}
+
+		/*! Removes the event at `index`, where 0 is the oldest event. The events after it are moved down by one. */
+		void erase(size_t index) {
+			if (index >= _size) {
+				return;
+			}
+			for (size_t i = index; i + 1 < _size; i++) {
+				_data[(_head + i) & _mask] = _data[(_head + i + 1) & _mask];
+			}
+			_size--;
+		}
+
+		/*! Removes all of the events. The overflow count is not changed. */
+		void clear(void) {
+			_head = 0;
+			_size = 0;
+		}
+
+		const_iterator begin(void) const { return const_iterator(this, 0); }
+		const_iterator end(void) const { return const_iterator(this, _size); }
+
+		/*! Returns a view of the events for which `predicate` returns `true`. See FilteredView. */
+		template <typename Predicate>
+		FilteredView<Predicate> filter(Predicate predicate) const {
+			return FilteredView<Predicate>(this, predicate);
+		}
+
+		/*! Copies the events into `dst`, replacing its contents. If `dst` already has enough capacity, no memory is allocated. */
+		void copyTo(std::vector<T>& dst) const {
+			dst.assign(begin(), end());
+		}
+
+		/*! Returns the number of events that were overwritten because the buffer was full, since the buffer was
+		made or resetOverflowCount() was called. */
+		uint64_t getOverflowCount(void) const { return _overflowCount; }
+
+		/*! Sets the overflow count to 0. */
+		void resetOverflowCount(void) { _overflowCount = 0; }
+
+	private:
+		std::vector<T> _data;
+		size_t _mask;
+		size_t _head;
+		size_t _size;
+		uint64_t _overflowCount;
+
+		Private::CX_TrackedBytes<Util::MemoryCategory::INPUT_EVENTS> _trackedBytes;
+	};
+
+}
@@ -1,6 +1,8 @@
 #include "CX_InputManager.h"
 
 #include "CX_AppWindow.h" //glfwPollEvents()
+#include "CX_EventTrace.h"
+#include "CX_Logger.h"
 
 namespace CX {
 
@@ -47,6 +49,7 @@ namespace CX {
 		} else {
 			_usingJoystick = false;
 		}
+
 		return success;
 	}
 
@@ -67,6 +70,8 @@ namespace CX {
 		// they wouldn't have if they each took a poll time one after the other.
 		// The joystick works differently: the GLFW helper functions simply reads
 		// off the current axis and button values rather than creating events.
+		CX_EventTrace::Scope traceScope(CX::Instances::EventTrace, CX_EventTrace::Event::INPUT_POLL);
+
 		glfwPollEvents();
 		CX_Millis pollCompleteTime = CX::Instances::Clock.now();
 
@@ -104,4 +109,32 @@ namespace CX {
 		Joystick.clearEvents();
 	}
 
+	/*! Starts a thread that samples the joystick at a regular interval. Each sample is timestamped right away and
+	the resulting events are collected by the next call to pollEvents(), so the precision of joystick timestamps is set by
+	the interval rather than by how often pollEvents() is called. The joystick is not read by pollEvents() while the
+	thread is running. This is the same as calling `Joystick.startSampling()`; see CX_Joystick::startSampling().
+
+	Keyboard and mouse events are not affected, because GLFW only delivers them to the main thread when pollEvents() is called.
+	\param interval The time between samples. The default of 1 ms samples at 1 kHz.
+	\return `true` if the thread was started, `false` if `interval` is not positive. */
+	bool CX_InputManager::startPollingThread(CX_Millis interval) {
+		return Joystick.startSampling(interval);
+	}
+
+	/*! Stops the thread started with startPollingThread(). Events that the thread sampled are kept and
+	the joystick is read by pollEvents() again. */
+	void CX_InputManager::stopPollingThread(void) {
+		Joystick.stopSampling();
+	}
+
+	/*! Returns `true` if the thread started with startPollingThread() is running. */
+	bool CX_InputManager::isPollingThreadRunning(void) const {
+		return Joystick.isSampling();
+	}
+
+	/*! Returns the interval of the polling thread, or 0 if it is not running. */
+	CX_Millis CX_InputManager::getPollingThreadInterval(void) const {
+		return Joystick.getSamplingInterval();
+	}
+
 }
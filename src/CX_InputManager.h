@@ -2,6 +2,7 @@
 
 #include <set>
 #include <queue>
+#include <memory>
 
 #include "ofEvents.h"
 
@@ -96,6 +97,18 @@ namespace CX {
 	}
 	\endcode
 
+	The stored events can also be looked at without copying them with `getEvents()`, and only the events
+	of one type or for one key or button with, for example, CX_Keyboard::getEventsOfType() or
+	CX_Mouse::getEventsForButton(). Each device stores its events in a fixed-size CX_InputEventBuffer.
+	If more events come in than fit, the oldest ones are overwritten and counted by `getOverflowCount()`.
+
+	If you are using a joystick on Linux, you can have it read on a background thread with
+	startPollingThread() (see CX_Joystick::startSampling()). The events are timestamped when they are sampled and collected the next time
+	pollEvents() is called, so they keep their timing even when pollEvents() is called infrequently, such as
+	while a long drawing operation is running. GLFW only delivers keyboard and mouse events to the main thread,
+	so keyboard and mouse events are still collected by pollEvents() and their timestamps depend on how often
+	it is called.
+
 	This class has a private constructor because you should never need more than one of them. If you really,
 	really need more than one, you can use CX::Private::inputManagerFactory() to make one.
 
@@ -110,6 +123,11 @@ namespace CX {
 		bool pollEvents (void);
 		void clearAllEvents(bool poll = false);
 
+		bool startPollingThread(CX_Millis interval = CX_Millis(1));
+		void stopPollingThread(void);
+		bool isPollingThreadRunning(void) const;
+		CX_Millis getPollingThreadInterval(void) const;
+
 		CX_Keyboard Keyboard; //!< An instance of CX::CX_Keyboard. Enabled or disabled with CX::CX_InputManager::setup().
 		CX_Mouse Mouse; //!< An instance of CX::CX_Mouse. Enabled or disabled with CX::CX_InputManager::setup().
 		CX_Joystick Joystick; //!< An instance of CX::CX_Joystick. Enabled or disabled with CX::CX_InputManager::setup().
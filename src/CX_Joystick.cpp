@@ -1,16 +1,51 @@
 #include "CX_Joystick.h"
 
+#include <cmath>
+#include <atomic>
+#include <thread>
+
 #include "ofAppGLFWWindow.h"
 
+#include "CX_EventTrace.h"
+#include "CX_Logger.h"
+
+#ifdef TARGET_LINUX
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/joystick.h>
+#endif
+
 namespace CX {
 
+//GLFW only allows its joystick functions to be called from the main thread, so the sampling thread
+//reads the device through the joystick API of the operating system instead.
+struct CX_Joystick::Sampler {
+	Sampler(void) :
+		stop(false),
+		fd(-1)
+	{}
+
+	std::thread thread;
+	std::atomic<bool> stop;
+	CX_Millis interval;
+	int fd;
+};
+
 CX_Joystick::CX_Joystick (void) :
     _joystickIndex(-1),
-	_joystickName("unnamed")
+	_joystickName("unnamed"),
+	_joystickEvents(16384),
+	_sampledButtonCount(0),
+	_axisThreshold(0),
+	_sampledByThread(false),
+	_reportedDropCount(0)
 {
 }
 
 CX_Joystick::~CX_Joystick (void) {
+	stopSampling();
 }
 
 /*!
@@ -32,6 +67,11 @@ bool CX_Joystick::setup(int joystickIndex) {
 		return false;
 	}
 
+	//The joystick can't be set up while the sampling thread is reading it.
+	bool restartSampling = isSampling();
+	CX_Millis samplingInterval = getSamplingInterval();
+	stopSampling();
+
 	_joystickIndex = joystickIndex;
 
 	const char *name = glfwGetJoystickName(_joystickIndex);
@@ -43,10 +83,18 @@ bool CX_Joystick::setup(int joystickIndex) {
 	int axisCount = 0;
 	glfwGetJoystickAxes(_joystickIndex, &axisCount);
 	_axisPositions.resize(axisCount);
+	_sampledAxisPositions.resize(axisCount);
 
 	int buttonCount = 0;
 	glfwGetJoystickButtons(_joystickIndex, &buttonCount);
 	_buttonStates.resize(buttonCount);
+	_sampledButtonCount = buttonCount;
+	_sampledButtonBits.assign((buttonCount + 63) / 64, 0);
+	_currentButtonBits.assign(_sampledButtonBits.size(), 0);
+
+	if (restartSampling) {
+		startSampling(samplingInterval);
+	}
 
 	return true;
 
@@ -65,70 +113,349 @@ int CX_Joystick::getJoystickIndex(void) {
 
 /*! Check to see if there are any new joystick events. If there are new events,
 they can be accessed with availableEvents() and getNextEvent().
+
+If the joystick is being sampled by a background thread (see startSampling()), this does not
+read the joystick, but collects the events that the thread has sampled since the last call.
 \return True if there are new events.*/
 bool CX_Joystick::pollEvents (void) {
 	if (_joystickIndex == -1) {
 		return false;
 	}
 
+	if (_sampledByThread) {
+		_drainSampledEvents();
+	} else {
+		_sample();
+	}
+
+	if (_joystickEvents.size() > 0) {
+		return true;
+	}
+	return false;
+}
+
+//Reads the joystick with GLFW and makes events for the axes and buttons that changed since the last time it was read.
+//This must be called from the main thread.
+void CX_Joystick::_sample(void) {
 	int axisCount = 0;
 	const float *axes = glfwGetJoystickAxes(_joystickIndex, &axisCount);
 
 	int buttonCount = 0;
 	const unsigned char *buttons = glfwGetJoystickButtons(_joystickIndex, &buttonCount);
 
-	CX_Millis pollTime = CX::Instances::Clock.now();
+	CX_Millis sampleTime = CX::Instances::Clock.now();
 
-	if ((unsigned int)axisCount == _axisPositions.size()) {
+	auto emit = [&](const CX_Joystick::Event& ev) {
+		_storeEvent(ev);
+	};
+
+	if ((unsigned int)axisCount == _sampledAxisPositions.size()) {
 		for (unsigned int i = 0; i < (unsigned int)axisCount; i++) {
-			if (_axisPositions[i] != axes[i]) {
+			if (std::abs(axes[i] - _sampledAxisPositions[i]) > _axisThreshold) {
 				CX_Joystick::Event ev;
 
 				ev.type = CX_Joystick::EventType::AXIS_POSITION_CHANGE;
 				ev.axisIndex = i;
 				ev.axisPosition = axes[i];
 
-				ev.time = pollTime;
+				ev.time = sampleTime;
 				ev.uncertainty = ev.time - _lastEventPollTime;
 
-				_joystickEvents.push_back(ev);
+				emit(ev);
 
-				_axisPositions[i] = axes[i];
+				_sampledAxisPositions[i] = axes[i];
 			}
 		}
 	}
 
-	if ((unsigned int)buttonCount == _buttonStates.size()) {
+	//The buttons are packed into bits so that unchanged buttons can be skipped 64 at a time.
+	if ((unsigned int)buttonCount == _sampledButtonCount) {
+		std::fill(_currentButtonBits.begin(), _currentButtonBits.end(), 0);
 		for (unsigned int i = 0; i < (unsigned int)buttonCount; i++) {
-			if (_buttonStates[i] != buttons[i]) {
-				CX_Joystick::Event ev;
+			//I'm just guessing about button state here. 1 might be PRESSED, but it could also be UNDEFINED_BUTTON.
+			if (buttons[i] == 1) {
+				_currentButtonBits[i / 64] |= (uint64_t)1 << (i % 64);
+			}
+		}
 
-				//I'm just guessing about button state here. 1 might be PRESSED, but it could also be UNDEFINED_BUTTON.
-				if (buttons[i] == 1) {
-					ev.type = CX_Joystick::EventType::BUTTON_PRESS;
-				} else {
-					ev.type = CX_Joystick::EventType::BUTTON_RELEASE;
+		for (size_t word = 0; word < _currentButtonBits.size(); word++) {
+			uint64_t changed = _currentButtonBits[word] ^ _sampledButtonBits[word];
+
+			for (unsigned int bit = 0; changed != 0; bit++, changed >>= 1) {
+				if ((changed & 1) == 0) {
+					continue;
 				}
 
-				ev.buttonIndex = i;
-				ev.buttonState = buttons[i];
+				CX_Joystick::Event ev;
 
-				ev.time = pollTime;
-				ev.uncertainty = ev.time - _lastEventPollTime;
+				bool pressed = ((_currentButtonBits[word] >> bit) & 1) == 1;
+				ev.type = pressed ? CX_Joystick::EventType::BUTTON_PRESS : CX_Joystick::EventType::BUTTON_RELEASE;
+				ev.buttonIndex = (int)(word * 64 + bit);
+				ev.buttonState = pressed ? 1 : 0;
 
-				_joystickEvents.push_back( ev );
+				ev.time = sampleTime;
+				ev.uncertainty = ev.time - _lastEventPollTime;
 
-				_buttonStates[i] = buttons[i];
+				emit(ev);
 			}
+
+			_sampledButtonBits[word] = _currentButtonBits[word];
 		}
 	}
 
-	_lastEventPollTime = pollTime;
+	_lastEventPollTime = sampleTime;
+}
 
-	if (_joystickEvents.size() > 0) {
-		return true;
+//Stores an event and updates the axis positions and button states that are returned by getAxisPositions() and getButtonStates().
+void CX_Joystick::_storeEvent(const CX_Joystick::Event& ev) {
+	if (ev.type == CX_Joystick::AXIS_POSITION_CHANGE) {
+		if (ev.axisIndex >= 0 && (size_t)ev.axisIndex < _axisPositions.size()) {
+			_axisPositions[ev.axisIndex] = ev.axisPosition;
+		}
+	} else {
+		if (ev.buttonIndex >= 0 && (size_t)ev.buttonIndex < _buttonStates.size()) {
+			_buttonStates[ev.buttonIndex] = ev.buttonState;
+		}
 	}
-	return false;
+
+	_pushEvent(ev);
+}
+
+void CX_Joystick::_pushEvent(const CX_Joystick::Event& ev) {
+	if (_joystickEvents.push_back(ev) && _joystickEvents.getOverflowCount() == 1) {
+		CX::Instances::Log.warning("CX_Joystick") << "More joystick events were stored than fit in the event buffer (" <<
+			_joystickEvents.capacity() << " events), so the oldest events are being overwritten. Read or clear events more often or use setEventCapacity().";
+	}
+}
+
+void CX_Joystick::_drainSampledEvents(void) {
+	CX_Joystick::Event ev;
+	while (_sampledEvents->read(&ev, 1) == 1) {
+		_storeEvent(ev);
+	}
+
+	uint64_t dropped = _sampledEvents->getDroppedCount();
+	if (dropped != _reportedDropCount) {
+		CX::Instances::Log.warning("CX_Joystick") << (dropped - _reportedDropCount) << " joystick events were lost because "
+			"pollEvents() was not called often enough while the joystick was being sampled by a background thread.";
+		_reportedDropCount = dropped;
+	}
+}
+
+//Must only be called while the sampling thread is not running.
+void CX_Joystick::_setSampledByThread(bool sampled) {
+	if (sampled) {
+		if (!_sampledEvents) {
+			_sampledEvents = std::make_shared<CX_SPSCRingBuffer<CX_Joystick::Event>>(4096);
+		}
+		_sampledEvents->clear();
+		_reportedDropCount = 0;
+	} else if (_sampledByThread) {
+		_drainSampledEvents(); //Keep the events that were sampled before the thread stopped.
+	}
+	_sampledByThread = sampled;
+}
+
+/*! Starts a thread that reads the joystick as its state changes, so that each event is timestamped as soon as the
+operating system reports it, rather than when pollEvents() is called. Only the axes and buttons that changed produce events
+(see setAxisThreshold()). The events are collected by the next call to pollEvents(). This is meant for response boxes and
+other devices that report at high rates.
+
+GLFW, which pollEvents() otherwise uses to read the joystick, may only be used from the main thread, so the thread
+reads the device through the Linux joystick API (`/dev/input/js*`) instead. The device is the one with the same name and
+numbers of axes and buttons as the joystick that was set up with setup(). On other systems, background sampling is not
+available: An error is logged, `false` is returned, and pollEvents() continues to read the joystick on the main thread.
+
+If the thread is already running, it is restarted with the new interval.
+\param interval The longest time that the thread waits for the device before checking whether it should stop. The
+uncertainty of each event is the time since the thread last woke up, so it is at most this long.
+\return `true` if the thread was started, `false` otherwise. */
+bool CX_Joystick::startSampling(CX_Millis interval) {
+	if (interval <= CX_Millis(0)) {
+		CX::Instances::Log.error("CX_Joystick") << "startSampling(): The interval must be greater than 0.";
+		return false;
+	}
+
+	if (_joystickIndex == -1) {
+		CX::Instances::Log.error("CX_Joystick") << "startSampling(): The joystick has not been set up. Call setup() first.";
+		return false;
+	}
+
+	stopSampling();
+
+	int fd = _openSamplingDevice();
+	if (fd < 0) {
+		return false;
+	}
+
+	_setSampledByThread(true);
+
+	_sampler = std::make_shared<Sampler>();
+	_sampler->interval = interval;
+	_sampler->fd = fd;
+	_sampler->thread = std::thread(&CX_Joystick::_samplerLoop, this, _sampler);
+
+	return true;
+}
+
+/*! Stops the thread started with startSampling(). Events that the thread sampled are kept and
+the joystick is read by pollEvents() again. */
+void CX_Joystick::stopSampling(void) {
+	if (!_sampler) {
+		return;
+	}
+
+	_sampler->stop = true;
+	_sampler->thread.join();
+#ifdef TARGET_LINUX
+	::close(_sampler->fd);
+#endif
+	_sampler.reset();
+
+	_setSampledByThread(false);
+}
+
+/*! Returns `true` if the thread started with startSampling() is running. */
+bool CX_Joystick::isSampling(void) const {
+	return (bool)_sampler;
+}
+
+/*! Returns the interval of the sampling thread, or 0 if it is not running. */
+CX_Millis CX_Joystick::getSamplingInterval(void) const {
+	if (!_sampler) {
+		return CX_Millis(0);
+	}
+	return _sampler->interval;
+}
+
+/*! Sets how far an axis must move from its position at the last axis event before a new axis event is made.
+Small changes, like those caused by noise in the sensors of analog sticks, are ignored. Because the distance is measured
+from the last event, slow movements still produce events once they add up to more than the threshold.
+Buttons are not affected.
+\param threshold The distance, in the units of CX_Joystick::Event::axisPosition. The default of 0 makes an event for any change.
+\note This should not be called while the joystick is being sampled by the thread started by startSampling(). */
+void CX_Joystick::setAxisThreshold(float threshold) {
+	_axisThreshold = std::abs(threshold);
+}
+
+/*! Returns the threshold set with setAxisThreshold(). */
+float CX_Joystick::getAxisThreshold(void) const {
+	return _axisThreshold;
+}
+
+//Finds the joystick device of the operating system that matches the GLFW joystick, preferring the one with the same index.
+int CX_Joystick::_openSamplingDevice(void) const {
+#ifdef TARGET_LINUX
+	for (int attempt = -1; attempt < 32; attempt++) {
+		int index = (attempt == -1) ? _joystickIndex : attempt;
+		if (attempt == _joystickIndex) {
+			continue;
+		}
+
+		std::string path = "/dev/input/js" + ofToString(index);
+		int fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK);
+		if (fd < 0) {
+			continue;
+		}
+
+		char name[128] = { 0 };
+		unsigned char axes = 0;
+		unsigned char buttons = 0;
+		bool matches = ioctl(fd, JSIOCGNAME(sizeof(name) - 1), name) >= 0 &&
+			ioctl(fd, JSIOCGAXES, &axes) >= 0 &&
+			ioctl(fd, JSIOCGBUTTONS, &buttons) >= 0 &&
+			_joystickName == name &&
+			axes == _sampledAxisPositions.size() &&
+			buttons == _sampledButtonCount;
+
+		if (matches) {
+			return fd;
+		}
+		::close(fd);
+	}
+
+	CX::Instances::Log.error("CX_Joystick") << "startSampling(): No joystick device matching \"" << _joystickName <<
+		"\" could be opened in /dev/input. The joystick will be read by pollEvents().";
+	return -1;
+#else
+	CX::Instances::Log.error("CX_Joystick") << "startSampling(): Sampling the joystick from a background thread is only "
+		"available on Linux. The joystick will be read by pollEvents().";
+	return -1;
+#endif
+}
+
+void CX_Joystick::_samplerLoop(std::shared_ptr<Sampler> sampler) {
+#ifdef TARGET_LINUX
+	CX::Instances::EventTrace.nameThread("CX joystick sampling");
+
+	int timeoutMs = std::max(1, (int)std::ceil(sampler->interval.millis()));
+
+	while (!sampler->stop) {
+		pollfd pfd;
+		pfd.fd = sampler->fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		int ready = ::poll(&pfd, 1, timeoutMs);
+
+		CX_Millis sampleTime = CX::Instances::Clock.now();
+		if (ready <= 0) {
+			_lastEventPollTime = sampleTime;
+			continue;
+		}
+
+		CX_EventTrace::Scope traceScope(CX::Instances::EventTrace, CX_EventTrace::Event::INPUT_POLL, 1);
+
+		js_event jse;
+		while (::read(sampler->fd, &jse, sizeof(jse)) == (ssize_t)sizeof(jse)) {
+			//The initial state of the device is reported with JS_EVENT_INIT. It only sets the sampled state.
+			bool isInit = (jse.type & JS_EVENT_INIT) != 0;
+			unsigned char type = jse.type & ~JS_EVENT_INIT;
+
+			CX_Joystick::Event ev;
+			ev.time = sampleTime;
+			ev.uncertainty = sampleTime - _lastEventPollTime;
+
+			if (type == JS_EVENT_AXIS && jse.number < _sampledAxisPositions.size()) {
+				float position = (jse.value + 32768.0f) / 32767.5f - 1.0f; //The same scaling as GLFW.
+				if (isInit) {
+					_sampledAxisPositions[jse.number] = position;
+					continue;
+				}
+				if (std::abs(position - _sampledAxisPositions[jse.number]) <= _axisThreshold) {
+					continue;
+				}
+
+				ev.type = CX_Joystick::EventType::AXIS_POSITION_CHANGE;
+				ev.axisIndex = jse.number;
+				ev.axisPosition = position;
+				_sampledAxisPositions[jse.number] = position;
+				_sampledEvents->write(&ev, 1);
+
+			} else if (type == JS_EVENT_BUTTON && jse.number < _sampledButtonCount) {
+				uint64_t mask = (uint64_t)1 << (jse.number % 64);
+				bool pressed = jse.value != 0;
+				bool wasPressed = (_sampledButtonBits[jse.number / 64] & mask) != 0;
+				if (pressed) {
+					_sampledButtonBits[jse.number / 64] |= mask;
+				} else {
+					_sampledButtonBits[jse.number / 64] &= ~mask;
+				}
+				if (isInit || pressed == wasPressed) {
+					continue;
+				}
+
+				ev.type = pressed ? CX_Joystick::EventType::BUTTON_PRESS : CX_Joystick::EventType::BUTTON_RELEASE;
+				ev.buttonIndex = jse.number;
+				ev.buttonState = pressed ? 1 : 0;
+				_sampledEvents->write(&ev, 1);
+			}
+		}
+
+		_lastEventPollTime = sampleTime;
+	}
+#else
+	(void)sampler;
+#endif
 }
 
 /*! Get the number of available events for this input device. 
@@ -156,13 +483,44 @@ void CX_Joystick::clearEvents (void) {
 /*! \brief Return a vector containing a copy of the currently stored events. The events stored by
 the input device are unchanged. The first element of the vector is the oldest event. */
 std::vector<CX_Joystick::Event> CX_Joystick::copyEvents(void) {
-	std::vector<CX_Joystick::Event> copy(_joystickEvents.size());
-	for (unsigned int i = 0; i < _joystickEvents.size(); i++) {
-		copy[i] = _joystickEvents.at(i);
-	}
+	std::vector<CX_Joystick::Event> copy;
+	_joystickEvents.copyTo(copy);
 	return copy;
 }
 
+/*! Returns the stored events without copying them. The first event is the oldest.
+The events can be iterated over or filtered with CX_InputEventBuffer::filter().
+The reference is valid for as long as the joystick exists, but the events in it change
+when events are polled, read, or cleared. */
+const CX_InputEventBuffer<CX_Joystick::Event>& CX_Joystick::getEvents(void) const {
+	return _joystickEvents;
+}
+
+/*! Returns a view of the stored events of the given type, without copying them. */
+CX_Joystick::FilteredEvents CX_Joystick::getEventsOfType(EventType type) const {
+	EventFilter filter;
+	filter.type = type;
+	return _joystickEvents.filter(filter);
+}
+
+/*! Sets the number of events that the joystick can store. When the joystick has stored this many
+events, each new event overwrites the oldest stored event and the overflow count (see getOverflowCount())
+is incremented. The capacity is rounded up to a power of 2. The default is 16384 events.
+\param capacity The number of events. */
+void CX_Joystick::setEventCapacity(size_t capacity) {
+	_joystickEvents.setCapacity(capacity);
+}
+
+/*! Returns the number of events that the joystick can store. See setEventCapacity(). */
+size_t CX_Joystick::getEventCapacity(void) const {
+	return _joystickEvents.capacity();
+}
+
+/*! Returns the number of events that were lost because the joystick had stored as many events as it could. */
+uint64_t CX_Joystick::getOverflowCount(void) const {
+	return _joystickEvents.getOverflowCount();
+}
+
 /*! This function returns in the current positions of the joystick axes.
 \return A vector of the current axis positions. */
 vector<float> CX_Joystick::getAxisPositions (void) {
@@ -226,7 +584,7 @@ void CX_Joystick::appendEvent(CX_Joystick::Event ev) {
 		_buttonStates[ev.buttonIndex] = 0;
 	}
 
-	_joystickEvents.push_back(ev);
+	_pushEvent(ev);
 }
 
 static const std::string dlm = ", ";
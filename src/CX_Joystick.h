@@ -1,10 +1,12 @@
 #pragma once
 
-#include <deque>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "CX_Clock.h"
+#include "CX_InputEventBuffer.h"
+#include "CX_SPSCRingBuffer.h"
 
 namespace CX {
 
@@ -40,6 +42,18 @@ namespace CX {
 			EventType type; //!< The type of the event, from the CX_Joystick::EventType enum.
 		};
 
+		/*! Selects events by type for getEventsOfType(). */
+		struct EventFilter {
+			EventType type; //!< The type of event to match.
+
+			bool operator()(const CX_Joystick::Event& ev) const {
+				return ev.type == type;
+			}
+		};
+
+		/*! A view of the stored events that match an EventFilter. See CX_InputEventBuffer::FilteredView. */
+		typedef CX_InputEventBuffer<CX_Joystick::Event>::FilteredView<EventFilter> FilteredEvents;
+
 		CX_Joystick(void);
 		~CX_Joystick (void);
 
@@ -55,21 +69,60 @@ namespace CX {
 		std::vector<CX_Joystick::Event> copyEvents(void);
 		void clearEvents(void);
 
+		const CX_InputEventBuffer<CX_Joystick::Event>& getEvents(void) const;
+		FilteredEvents getEventsOfType(EventType type) const;
+
+		void setEventCapacity(size_t capacity);
+		size_t getEventCapacity(void) const;
+		uint64_t getOverflowCount(void) const;
+
 		std::vector<float> getAxisPositions(void);
 		std::vector<unsigned char> getButtonStates(void);
 
+		bool startSampling(CX_Millis interval = CX_Millis(1));
+		void stopSampling(void);
+		bool isSampling(void) const;
+		CX_Millis getSamplingInterval(void) const;
+
+		void setAxisThreshold(float threshold);
+		float getAxisThreshold(void) const;
+
 		void appendEvent(CX_Joystick::Event ev);
 
 	private:
+
 		int _joystickIndex;
 		std::string _joystickName;
 
-		std::deque<CX_Joystick::Event> _joystickEvents;
+		CX_InputEventBuffer<CX_Joystick::Event> _joystickEvents;
 
 		std::vector<float> _axisPositions;
 		std::vector<unsigned char> _buttonStates;
 
+		//The state of the joystick the last time it was sampled. These belong to whichever thread samples the joystick.
+		std::vector<float> _sampledAxisPositions;
+		unsigned int _sampledButtonCount;
+		std::vector<uint64_t> _sampledButtonBits; //One bit per button, set if the button is pressed.
+		std::vector<uint64_t> _currentButtonBits;
+		float _axisThreshold;
 		CX_Millis _lastEventPollTime;
+
+		//When the joystick is sampled by the sampling thread, the events are passed
+		//through this to the thread that calls pollEvents().
+		std::shared_ptr<CX_SPSCRingBuffer<CX_Joystick::Event>> _sampledEvents;
+		bool _sampledByThread;
+		uint64_t _reportedDropCount;
+
+		void _sample(void);
+		void _storeEvent(const CX_Joystick::Event& ev);
+		void _pushEvent(const CX_Joystick::Event& ev);
+		void _drainSampledEvents(void);
+		void _setSampledByThread(bool sampled);
+
+		struct Sampler;
+		std::shared_ptr<Sampler> _sampler;
+		void _samplerLoop(std::shared_ptr<Sampler> sampler);
+		int _openSamplingDevice(void) const;
 	};
 
 	std::ostream& operator<< (std::ostream& os, const CX_Joystick::Event& ev);
@@ -1,12 +1,15 @@
 #include "CX_Keyboard.h"
 
 #include "CX_InputManager.h"
+#include "CX_Logger.h"
 
 namespace CX {
 
 CX_Keyboard::CX_Keyboard(CX_InputManager* owner) :
 	_owner(owner),
 	_enabled(false),
+	_keyEvents(1024),
+	_heldUnmaskedKeyCount(0),
 	_listeningForEvents(false)
 {
 }
@@ -29,7 +32,7 @@ void CX_Keyboard::enable(bool enable) {
 	_enabled = enable;
 	
 	clearEvents();
-	_heldKeys.clear();
+	_clearHeldKeys();
 }
 
 /*! \brief Returns `true` if the keyboard is enabled. */
@@ -62,17 +65,67 @@ void CX_Keyboard::clearEvents(void) {
 /*! \brief Return a vector containing a copy of the currently stored events. The events stored by
 the input device are unchanged. The first element of the vector is the oldest event. */
 std::vector<CX_Keyboard::Event> CX_Keyboard::copyEvents(void) {
-	std::vector<CX_Keyboard::Event> copy(_keyEvents.size());
-	for (unsigned int i = 0; i < _keyEvents.size(); i++) {
-		copy[i] = _keyEvents.at(i);
-	}
+	std::vector<CX_Keyboard::Event> copy;
+	_keyEvents.copyTo(copy);
 	return copy;
 }
 
+/*! Returns the stored events without copying them. The first event is the oldest.
+The events can be iterated over or filtered with CX_InputEventBuffer::filter().
+The reference is valid for as long as the keyboard exists, but the events in it change
+when events are polled, read, or cleared. */
+const CX_InputEventBuffer<CX_Keyboard::Event>& CX_Keyboard::getEvents(void) const {
+	return _keyEvents;
+}
+
+/*! Returns a view of the stored events of the given type, without copying them.
+\code{.cpp}
+for (const CX_Keyboard::Event& ev : Input.Keyboard.getEventsOfType(CX_Keyboard::PRESSED)) {
+	Log.notice() << "Key " << ev.key << " pressed at " << ev.time;
+}
+\endcode */
+CX_Keyboard::FilteredEvents CX_Keyboard::getEventsOfType(EventType type) const {
+	EventFilter filter;
+	filter.key = -1;
+	filter.type = type;
+	return _keyEvents.filter(filter);
+}
+
+/*! Returns a view of the stored events for the given key, without copying them.
+\param key The key, like in CX_Keyboard::Event::key.
+\param type The CX_Keyboard::EventType of the events, or -1 for events of all types. */
+CX_Keyboard::FilteredEvents CX_Keyboard::getEventsForKey(int key, int type) const {
+	EventFilter filter;
+	filter.key = key;
+	filter.type = type;
+	return _keyEvents.filter(filter);
+}
+
+/*! Sets the number of events that the keyboard can store. When the keyboard has stored this many
+events, each new event overwrites the oldest stored event and the overflow count (see getOverflowCount())
+is incremented. The capacity is rounded up to a power of 2. The default is 1024 events.
+\param capacity The number of events. */
+void CX_Keyboard::setEventCapacity(size_t capacity) {
+	_keyEvents.setCapacity(capacity);
+}
+
+/*! Returns the number of events that the keyboard can store. See setEventCapacity(). */
+size_t CX_Keyboard::getEventCapacity(void) const {
+	return _keyEvents.capacity();
+}
+
+/*! Returns the number of events that were lost because the keyboard had stored as many events as it could. */
+uint64_t CX_Keyboard::getOverflowCount(void) const {
+	return _keyEvents.getOverflowCount();
+}
+
 /*! This function checks to see if the given key is held, which means a keypress has been received, but not a key release.
 \param key The character literal for the key you are interested in or special key code from CX::Keycode. 
 \return `true` if the given key is held, `false` otherwise. */
 bool CX_Keyboard::isKeyHeld(int key) const {
+	if (key >= 0 && key < _KEY_MASK_SIZE) {
+		return _heldKeyMask.test(key);
+	}
 	return _heldKeys.find(key) != _heldKeys.end();
 }
 
@@ -125,16 +178,17 @@ CX_Keyboard::Event CX_Keyboard::waitForKeypress(std::vector<int> keys, bool clea
 			continue;
 		}
 
-		for (auto it = _keyEvents.begin(); it != _keyEvents.end(); it++) {
-			if (it->type == CX_Keyboard::PRESSED) {
+		for (size_t i = 0; i < _keyEvents.size(); i++) {
+			const CX_Keyboard::Event& ev = _keyEvents[i];
+			if (ev.type == CX_Keyboard::PRESSED) {
 				
-				bool keyFound = std::find(keys.begin(), keys.end(), it->key) != keys.end();
+				bool keyFound = std::find(keys.begin(), keys.end(), ev.key) != keys.end();
 
 				if (minus1Found || keyFound) {
-					rval = *it;
+					rval = ev;
 
 					if (eraseEvent) {
-						_keyEvents.erase(it);
+						_keyEvents.erase(i);
 					}
 
 					waiting = false;
@@ -181,12 +235,22 @@ type.
 */
 void CX_Keyboard::appendEvent(CX_Keyboard::Event ev) {
 	if (ev.type == CX_Keyboard::PRESSED) {
-		_heldKeys.insert(ev.key);
+		_setKeyHeld(ev.key, true);
 	} else if (ev.type == CX_Keyboard::RELEASED) {
-		_heldKeys.erase(ev.key);
+		_setKeyHeld(ev.key, false);
+	}
+
+	_storeEvent(ev);
+}
+
+void CX_Keyboard::_storeEvent(const CX_Keyboard::Event& ev) {
+	if (_keyEvents.push_back(ev) && _keyEvents.getOverflowCount() == 1) {
+		CX::Instances::Log.warning("CX_Keyboard") << "More keyboard events were stored than fit in the event buffer (" <<
+			_keyEvents.capacity() << " events), so the oldest events are being overwritten. Read or clear events more often or use setEventCapacity().";
 	}
 
-	_keyEvents.push_back(ev);
+	CX_Keyboard::Event listenerCopy = ev;
+	ofNotifyEvent(eventStored, listenerCopy);
 }
 
 void CX_Keyboard::_listenForEvents(bool listen) {
@@ -265,10 +329,10 @@ void CX_Keyboard::_keyEventHandler(CX_Keyboard::Event &ev) {
 
 	switch (ev.type) {
 	case CX_Keyboard::PRESSED:
-		_heldKeys.insert(ev.key);
+		_setKeyHeld(ev.key, true);
 		break;
 	case CX_Keyboard::RELEASED:
-		_heldKeys.erase(ev.key);
+		_setKeyHeld(ev.key, false);
 		break;
 	case CX_Keyboard::REPEAT:
 	default:
@@ -277,14 +341,15 @@ void CX_Keyboard::_keyEventHandler(CX_Keyboard::Event &ev) {
 
 	_checkForShortcuts();
 
-	_keyEvents.push_back(ev);
+	_storeEvent(ev);
 }
 
 /*! Add a keyboard shortcut chord (1 or more keys held at once) and the function that will be called
 when the shortcut is held. The shortcuts require that exactly the desired keys are held. No other keys
 may be held.
 
-Keyboard shortcuts are checked for every time `CX_InputManager::pollEvents()` is called. This means
+Keyboard shortcuts are checked for every time `CX_InputManager::pollEvents()` is called. Shortcuts are looked
+up by the set of held keys, so having many shortcuts does not make checking for them slower. This means
 that you can set up keyboard shortcuts that work the same way throughout the whole experiment once,
 and because the shortcuts are set up, you won't have to check for the shortcuts in each section of code
 in which input is awaited on. You just need to regularly call `Input.pollEvents()` in your code.
@@ -337,10 +402,19 @@ void runExperiment(void) {
 void CX_Keyboard::addShortcut(std::string name, const std::vector<int>& chord, std::function<void(void)> callback) {
 	this->enable(true); // Automatically enable keyboard
 
+	removeShortcut(name);
+
 	KeyboardShortcut ks;
 	ks.chord.insert(chord.begin(), chord.end());
+	ks.masked = _makeKeyMask(ks.chord, &ks.mask);
 	ks.callback = callback;
 
+	if (ks.masked) {
+		_shortcutsByMask[ks.mask].insert(name);
+	} else {
+		_unmaskedShortcuts.insert(name);
+	}
+
 	_shortcuts[name] = ks;
 }
 
@@ -348,12 +422,31 @@ void CX_Keyboard::addShortcut(std::string name, const std::vector<int>& chord, s
 \param name The name of the shortcut.
 */
 void CX_Keyboard::removeShortcut(std::string name) {
-	_shortcuts.erase(name);
+	auto it = _shortcuts.find(name);
+	if (it == _shortcuts.end()) {
+		return;
+	}
+
+	if (it->second.masked) {
+		auto byMask = _shortcutsByMask.find(it->second.mask);
+		if (byMask != _shortcutsByMask.end()) {
+			byMask->second.erase(name);
+			if (byMask->second.empty()) {
+				_shortcutsByMask.erase(byMask);
+			}
+		}
+	} else {
+		_unmaskedShortcuts.erase(name);
+	}
+
+	_shortcuts.erase(it);
 }
 
 /*! Clears all stored keyboard shortcuts. */
 void CX_Keyboard::clearShortcuts(void) {
 	_shortcuts.clear();
+	_shortcutsByMask.clear();
+	_unmaskedShortcuts.clear();
 }
 
 /*! Get a vector of the names of shortcuts.
@@ -367,12 +460,72 @@ std::vector<std::string> CX_Keyboard::getShortcutNames(void) const {
 	return names;
 }
 
+//The shortcuts whose chords are in the key mask are found with one lookup of the held keys, so the
+//cost of checking does not depend on how many shortcuts there are. The callbacks are copied before they are
+//called so that they can add or remove shortcuts.
 void CX_Keyboard::_checkForShortcuts(void) {
-	for (const std::pair<std::string, KeyboardShortcut>& ks : _shortcuts) {
-		if (ks.second.chord == _heldKeys) {
-			ks.second.callback();
+	std::vector<std::function<void(void)>> callbacks;
+
+	if (_heldUnmaskedKeyCount == 0) {
+		auto byMask = _shortcutsByMask.find(_heldKeyMask);
+		if (byMask != _shortcutsByMask.end()) {
+			for (const std::string& name : byMask->second) {
+				callbacks.push_back(_shortcuts[name].callback);
+			}
+		}
+	}
+
+	for (const std::string& name : _unmaskedShortcuts) {
+		const KeyboardShortcut& ks = _shortcuts[name];
+		if (ks.chord == _heldKeys) {
+			callbacks.push_back(ks.callback);
+		}
+	}
+
+	for (std::function<void(void)>& callback : callbacks) {
+		callback();
+	}
+}
+
+void CX_Keyboard::_setKeyHeld(int key, bool held) {
+	bool inMask = key >= 0 && key < _KEY_MASK_SIZE;
+
+	if (held) {
+		if (!_heldKeys.insert(key).second) {
+			return;
+		}
+		if (inMask) {
+			_heldKeyMask.set(key);
+		} else {
+			_heldUnmaskedKeyCount++;
+		}
+	} else {
+		if (_heldKeys.erase(key) == 0) {
+			return;
+		}
+		if (inMask) {
+			_heldKeyMask.reset(key);
+		} else {
+			_heldUnmaskedKeyCount--;
+		}
+	}
+}
+
+void CX_Keyboard::_clearHeldKeys(void) {
+	_heldKeys.clear();
+	_heldKeyMask.reset();
+	_heldUnmaskedKeyCount = 0;
+}
+
+bool CX_Keyboard::_makeKeyMask(const std::set<int>& keys, KeyMask* mask) {
+	mask->reset();
+	for (int key : keys) {
+		if (key < 0 || key >= _KEY_MASK_SIZE) {
+			return false;
 		}
+		mask->set(key);
 	}
+	return true;
 }
 
 
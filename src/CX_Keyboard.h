@@ -1,12 +1,16 @@
 #pragma once
 
-#include <deque>
+#include <bitset>
+#include <functional>
+#include <map>
 #include <set>
+#include <unordered_map>
 
 #include "ofEvents.h"
 
 #include "CX_Clock.h"
 #include "CX_Events.h"
+#include "CX_InputEventBuffer.h"
 
 #define GLFW_INCLUDE_NONE
 #include "GLFW/glfw3.h"
@@ -147,6 +151,10 @@ namespace CX {
 
 	/*! This class is responsible for managing the keyboard. You should not need to create an instance of this class:
 	use the instance of CX_Keyboard within CX::Instances::Input instead.
+
+	Keyboard events are delivered by GLFW on the main thread while CX_InputManager::pollEvents() is running. They are
+	timestamped there and stored directly in the event buffer, so their timestamps depend on how often pollEvents() is called.
+	They are not sampled by CX_InputManager::startPollingThread().
 	\ingroup inputDevices */
 	class CX_Keyboard {
 	public:
@@ -245,6 +253,19 @@ namespace CX {
 			Keycodes codes; //!< Alternative representations of the pressed key.
 		};
 
+		/*! Selects events by key and type for getEventsOfType() and getEventsForKey(). A value of -1 matches any key or type. */
+		struct EventFilter {
+			int key; //!< The key to match, or -1 for any key.
+			int type; //!< The CX_Keyboard::EventType to match, or -1 for any type.
+
+			bool operator()(const CX_Keyboard::Event& ev) const {
+				return (key == -1 || ev.key == key) && (type == -1 || ev.type == type);
+			}
+		};
+
+		/*! A view of the stored events that match an EventFilter. See CX_InputEventBuffer::FilteredView. */
+		typedef CX_InputEventBuffer<CX_Keyboard::Event>::FilteredView<EventFilter> FilteredEvents;
+
 		// Private constructor
 		~CX_Keyboard(void);
 
@@ -257,6 +278,14 @@ namespace CX {
 		std::vector<CX_Keyboard::Event> copyEvents(void);
 		void clearEvents(void);
 
+		const CX_InputEventBuffer<CX_Keyboard::Event>& getEvents(void) const;
+		FilteredEvents getEventsOfType(EventType type) const;
+		FilteredEvents getEventsForKey(int key, int type = -1) const;
+
+		void setEventCapacity(size_t capacity);
+		size_t getEventCapacity(void) const;
+		uint64_t getOverflowCount(void) const;
+
 		bool isKeyHeld(int key) const;
 		bool isChordHeld(const std::vector<int>& chord) const;
 
@@ -265,6 +294,10 @@ namespace CX {
 
 		void appendEvent(CX_Keyboard::Event ev);
 
+		/*! This event is triggered every time a keyboard event is stored, including events added with appendEvent(), so that
+		events can be forwarded as they happen (e.g. by a CX_MarkerStream) without reading them out of the event buffer. */
+		ofEvent<CX_Keyboard::Event> eventStored;
+
 		void addShortcut(std::string name, const std::vector<int>& chord, std::function<void(void)> callback);
 		void removeShortcut(std::string name);
 		void clearShortcuts(void);
@@ -278,10 +311,22 @@ namespace CX {
 		bool _enabled;
 		CX_Millis _lastEventPollTime;
 
-		std::deque<CX_Keyboard::Event> _keyEvents;
+		CX_InputEventBuffer<CX_Keyboard::Event> _keyEvents;
+		void _storeEvent(const CX_Keyboard::Event& ev);
 
 		std::set<int> _heldKeys;
 
+		//Keys from 0 to _KEY_MASK_SIZE - 1, which includes all of the GLFW keycodes, are also tracked in a bitset
+		//so that shortcuts can be looked up by the set of held keys. Other keys are only in _heldKeys.
+		static const int _KEY_MASK_SIZE = 512;
+		typedef std::bitset<_KEY_MASK_SIZE> KeyMask;
+		KeyMask _heldKeyMask;
+		unsigned int _heldUnmaskedKeyCount;
+
+		void _setKeyHeld(int key, bool held);
+		void _clearHeldKeys(void);
+		static bool _makeKeyMask(const std::set<int>& keys, KeyMask* mask);
+
 		void _keyPressHandler(ofKeyEventArgs &a);
 		void _keyReleaseHandler(ofKeyEventArgs &a);
 		void _keyRepeatHandler(CX::Private::CX_KeyRepeatEventArgs_t &a);
@@ -292,10 +337,14 @@ namespace CX {
 
 		struct KeyboardShortcut {
 			std::set<int> chord;
+			bool masked; //True if all of the keys in the chord are in the mask.
+			KeyMask mask;
 			std::function<void(void)> callback;
 		};
 
 		std::map<std::string, KeyboardShortcut> _shortcuts;
+		std::unordered_map<KeyMask, std::set<std::string>> _shortcutsByMask;
+		std::set<std::string> _unmaskedShortcuts;
 		void _checkForShortcuts(void);
 
 	};
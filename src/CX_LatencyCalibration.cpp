@@ -0,0 +1,369 @@
+#include "CX_LatencyCalibration.h"
+
+#include "ofGraphics.h"
+
+#include "CX_SlidePresenter.h"
+#include "CX_SoundBufferPlayer.h"
+#include "CX_Utilities.h"
+#include "CX_Logger.h"
+
+namespace CX {
+
+CX_LatencyCalibration::CX_LatencyCalibration(void) :
+	_onsets(1024),
+	_holdoffFrames(0),
+	_listening(false)
+{
+	for (int i = 0; i < DETECTOR_COUNT; i++) {
+		_detectors[i].channel = -1;
+		_detectors[i].threshold = 1;
+		_detectors[i].holdoffUntil = 0;
+	}
+}
+
+CX_LatencyCalibration::~CX_LatencyCalibration(void) {
+	_listenForEvents(false);
+}
+
+/*! Runs the calibration. This \ref blockingCode "blocks" for about `2 * trials * (trialInterval + flashDuration)`.
+During the run, the display shows `patch` flashing on the background color, so the light sensor should be in place
+before this is called.
+\param config The configuration.
+\return The measured latencies. If a latency could not be measured, its Distribution::isMeasured() is `false` and an
+error is logged. */
+CX_LatencyCalibration::Result CX_LatencyCalibration::run(Configuration config) {
+	_config = config;
+	Result result;
+
+	bool soundLight = (_config.lightSensor == LightSensor::SOUND_INPUT);
+
+	if ((soundLight || _config.measureAudio) && (_config.soundStream == nullptr || !_config.soundStream->isStreamRunning())) {
+		CX::Instances::Log.error("CX_LatencyCalibration") << "run(): The sound stream is needed to record the sensors, but it is not set up and running.";
+		return result;
+	}
+	if (_config.lightSensor != LightSensor::NONE && _config.display == nullptr) {
+		CX::Instances::Log.error("CX_LatencyCalibration") << "run(): There is no display to measure.";
+		return result;
+	}
+	if (_config.lightSensor == LightSensor::JOYSTICK_BUTTON && _config.joystick == nullptr) {
+		CX::Instances::Log.error("CX_LatencyCalibration") << "run(): The light sensor is a joystick button, but no joystick was given.";
+		return result;
+	}
+
+	if (_config.soundStream) {
+		const CX_SoundStream::Configuration& ssConfig = _config.soundStream->getConfiguration();
+
+		_detectors[LIGHT_DETECTOR].channel = soundLight ? _config.lightSensorChannel : -1;
+		_detectors[LIGHT_DETECTOR].threshold = _config.lightSensorThreshold;
+		_detectors[MICROPHONE_DETECTOR].channel = _config.measureAudio ? _config.microphoneChannel : -1;
+		_detectors[MICROPHONE_DETECTOR].threshold = _config.microphoneThreshold;
+
+		for (int i = 0; i < DETECTOR_COUNT; i++) {
+			_detectors[i].holdoffUntil = 0;
+			if (_detectors[i].channel >= ssConfig.inputChannels) {
+				CX::Instances::Log.error("CX_LatencyCalibration") << "run(): Input channel " << _detectors[i].channel <<
+					" was requested, but the sound stream only has " << ssConfig.inputChannels << " input channels.";
+				return result;
+			}
+		}
+
+		//After an onset, the rest of the flash or click (and the offset of the flash) is ignored.
+		_holdoffFrames = (uint64_t)((_config.trialInterval / 2).seconds() * ssConfig.sampleRate);
+
+		_onsets.discard(_onsets.getReadAvailable());
+		_listenForEvents(true);
+	}
+
+	if (_config.lightSensor != LightSensor::NONE) {
+		result.display = _measureDisplay();
+		if (!result.display.isMeasured()) {
+			CX::Instances::Log.error("CX_LatencyCalibration") << "run(): No light sensor onsets were found. Check that the sensor is "
+				"pointed at the patch and that the threshold is not too high.";
+		}
+	}
+
+	if (_config.measureAudio) {
+		result.audio = _measureAudio();
+		if (!result.audio.isMeasured()) {
+			CX::Instances::Log.error("CX_LatencyCalibration") << "run(): No microphone onsets were found. Check the microphone "
+				"and that the threshold is not too high.";
+		}
+	}
+
+	_listenForEvents(false);
+
+	if (result.display.missedTrials > 0 || result.audio.missedTrials > 0) {
+		CX::Instances::Log.warning("CX_LatencyCalibration") << "run(): No onset was found on " << result.display.missedTrials <<
+			" of the flashes and " << result.audio.missedTrials << " of the clicks.";
+	}
+
+	if (_config.applyOffsets) {
+		applyOffsets(result, _config.display, _config.soundStream);
+	}
+	if (_config.filename != "") {
+		saveOffsets(result, _config.filename);
+	}
+
+	return result;
+}
+
+/*! Gives the median latencies in `result` to the display (see CX_Display::setPresentationLatency()) and the sound stream
+(see CX_SoundStream::setOutputLatencyOffset()). Latencies that were not measured are not applied.
+\param result The result of run().
+\param display The display. Can be `nullptr`.
+\param soundStream The sound stream. Can be `nullptr`. */
+void CX_LatencyCalibration::applyOffsets(const Result& result, CX_Display* display, CX_SoundStream* soundStream) {
+	if (display && result.display.isMeasured()) {
+		display->setPresentationLatency(result.display.median);
+	}
+	if (soundStream && result.audio.isMeasured()) {
+		soundStream->setOutputLatencyOffset(result.audio.median);
+	}
+}
+
+/*! Saves the median latencies in `result` to a file. The file uses the same keys as CX_Display::configureFromFile() and
+CX_SoundStream::Configuration::setFromFile(), so the lines can also be copied into those configuration files.
+Latencies that were not measured are not saved.
+\param result The result of run().
+\param filename The name of the file. It is overwritten.
+\return `true` if the file was written. */
+bool CX_LatencyCalibration::saveOffsets(const Result& result, std::string filename) {
+	std::stringstream out;
+	out << "//Measured by CX_LatencyCalibration on " << CX::Instances::Clock.getDateTimeString() << std::endl;
+	if (result.display.isMeasured()) {
+		out << "display.presentationLatency = " << ofToString(result.display.median.millis(), 6) << std::endl;
+	}
+	if (result.audio.isMeasured()) {
+		out << "ss.outputLatencyOffset = " << ofToString(result.audio.median.millis(), 6) << std::endl;
+	}
+	return CX::Util::writeToFile(filename, out.str(), false, false);
+}
+
+/*! Loads offsets that were saved with saveOffsets() and applies them to the display and the sound stream.
+\param filename The name of the file.
+\param display The display. Can be `nullptr`.
+\param soundStream The sound stream. Can be `nullptr`.
+\return `false` if the file does not exist. */
+bool CX_LatencyCalibration::loadOffsets(std::string filename, CX_Display* display, CX_SoundStream* soundStream) {
+	if (!ofFile::doesFileExist(filename)) {
+		CX::Instances::Log.error("CX_LatencyCalibration") << "loadOffsets(): The file \"" << filename << "\" does not exist.";
+		return false;
+	}
+
+	std::map<std::string, std::string> kv = CX::Util::readKeyValueFile(filename);
+
+	if (display && kv.find("display.presentationLatency") != kv.end()) {
+		display->setPresentationLatency(CX_Millis(ofFromString<double>(kv["display.presentationLatency"])));
+	}
+	if (soundStream && kv.find("ss.outputLatencyOffset") != kv.end()) {
+		soundStream->setOutputLatencyOffset(CX_Millis(ofFromString<double>(kv["ss.outputLatencyOffset"])));
+	}
+	return true;
+}
+
+CX_LatencyCalibration::Distribution CX_LatencyCalibration::_measureDisplay(void) {
+	CX_SlidePresenter presenter;
+	CX_SlidePresenter::Configuration spConfig;
+	spConfig.display = _config.display;
+	spConfig.swappingMode = CX_SlidePresenter::SwappingMode::SINGLE_CORE_BLOCKING_SWAPS;
+	if (!presenter.setup(spConfig)) {
+		return Distribution();
+	}
+
+	ofColor background = _config.backgroundColor;
+	ofColor patchColor = _config.patchColor;
+	ofRectangle patch = _config.patch;
+
+	auto drawBackground = [background](void) {
+		ofBackground(background);
+	};
+	auto drawFlash = [background, patchColor, patch](void) {
+		ofBackground(background);
+		ofSetColor(patchColor);
+		ofRect(patch);
+	};
+
+	presenter.appendSlideFunction(drawBackground, _config.trialInterval, "background");
+	for (unsigned int i = 0; i < _config.trials; i++) {
+		presenter.appendSlideFunction(drawFlash, _config.flashDuration, "flash");
+		presenter.appendSlideFunction(drawBackground, _config.trialInterval, "background");
+	}
+
+	if (_config.lightSensor == LightSensor::JOYSTICK_BUTTON) {
+		_config.joystick->pollEvents();
+		_config.joystick->clearEvents();
+	}
+
+	presenter.presentSlides();
+
+	//Wait for the last onset to make it through the input latency.
+	CX::Instances::Clock.sleep(_config.trialInterval / 2);
+
+	std::vector<CX_Millis> onsets;
+	if (_config.lightSensor == LightSensor::JOYSTICK_BUTTON) {
+		_config.joystick->pollEvents();
+		for (const CX_Joystick::Event& ev : _config.joystick->copyEvents()) {
+			if (ev.type == CX_Joystick::BUTTON_PRESS && ev.buttonIndex == _config.joystickButton) {
+				onsets.push_back(ev.time);
+			}
+		}
+	} else {
+		onsets = _collectOnsets(LIGHT_DETECTOR);
+	}
+
+	std::vector<CX_Millis> latencies;
+	const std::vector<CX_SlidePresenter::Slide>& slides = presenter.getSlides();
+	for (const CX_SlidePresenter::Slide& slide : slides) {
+		if (slide.name != "flash" || slide.presentationStatus != CX_SlidePresenter::Slide::PresStatus::FINISHED) {
+			continue;
+		}
+
+		bool found = false;
+		CX_Millis swapTime = slide.actual.startTime;
+		CX_Millis onset = _firstOnsetIn(onsets, swapTime - _config.display->getFramePeriod(), swapTime + _config.trialInterval / 2, &found);
+		if (found) {
+			latencies.push_back(onset - swapTime);
+		}
+	}
+
+	return _makeDistribution(latencies, _config.trials);
+}
+
+CX_LatencyCalibration::Distribution CX_LatencyCalibration::_measureAudio(void) {
+	CX_SoundStream* stream = _config.soundStream;
+	const CX_SoundStream::Configuration& ssConfig = stream->getConfiguration();
+
+	if (ssConfig.outputChannels <= 0) {
+		CX::Instances::Log.error("CX_LatencyCalibration") << "run(): The sound stream has no output channels, so clicks cannot be played.";
+		return Distribution();
+	}
+
+	unsigned int clickFrames = std::max(1u, (unsigned int)(_config.clickDuration.seconds() * ssConfig.sampleRate));
+	std::vector<float> clickData(clickFrames * ssConfig.outputChannels, _config.clickAmplitude);
+	CX_SoundBuffer click;
+	click.setFromVector(std::move(clickData), ssConfig.outputChannels, ssConfig.sampleRate);
+
+	CX_SoundBufferPlayer player;
+	player.setup(stream);
+	player.setSoundBuffer(&click);
+
+	//The latency is measured without any offset that was applied before, so that the result replaces that offset.
+	CX_Millis previousOffset = ssConfig.outputLatencyOffset;
+	stream->setOutputLatencyOffset(0);
+
+	std::vector<CX_Millis> targets;
+	CX_Millis target = CX::Instances::Clock.now() + _config.trialInterval;
+	for (unsigned int i = 0; i < _config.trials; i++) {
+		player.startPlayingAt(target, 0);
+		targets.push_back(target);
+
+		CX::Instances::Clock.sleepUntil(target + _config.clickDuration);
+		target += _config.trialInterval;
+	}
+	CX::Instances::Clock.sleepUntil(target);
+
+	stream->setOutputLatencyOffset(previousOffset);
+
+	std::vector<CX_Millis> onsets = _collectOnsets(MICROPHONE_DETECTOR);
+
+	std::vector<CX_Millis> latencies;
+	for (CX_Millis t : targets) {
+		bool found = false;
+		CX_Millis onset = _firstOnsetIn(onsets, t - _config.trialInterval / 2, t + _config.trialInterval / 2, &found);
+		if (found) {
+			latencies.push_back(onset - t);
+		}
+	}
+
+	return _makeDistribution(latencies, _config.trials);
+}
+
+//Takes the onsets of `detector` out of the ring buffer. Onsets of the other detector are dropped.
+std::vector<CX_Millis> CX_LatencyCalibration::_collectOnsets(int detector) {
+	std::vector<CX_Millis> rval;
+
+	CX_Millis inputOffset = _config.soundStream->estimateLatencyPerBuffer() + _config.inputLatency;
+
+	Onset onset;
+	while (_onsets.read(&onset, 1) == 1) {
+		if (onset.detector == detector) {
+			rval.push_back(_config.soundStream->sampleFrameToTime(onset.sampleFrame) - inputOffset);
+		}
+	}
+	return rval;
+}
+
+CX_Millis CX_LatencyCalibration::_firstOnsetIn(const std::vector<CX_Millis>& onsets, CX_Millis from, CX_Millis until, bool* found) {
+	for (CX_Millis t : onsets) {
+		if (t >= from && t <= until) {
+			*found = true;
+			return t;
+		}
+	}
+	*found = false;
+	return CX_Millis(0);
+}
+
+CX_LatencyCalibration::Distribution CX_LatencyCalibration::_makeDistribution(std::vector<CX_Millis> samples, unsigned int trials) {
+	Distribution d;
+	d.samples = samples;
+	d.missedTrials = (trials > samples.size()) ? trials - samples.size() : 0;
+
+	if (samples.empty()) {
+		return d;
+	}
+
+	std::sort(samples.begin(), samples.end());
+	size_t n = samples.size();
+	d.median = (n % 2 == 1) ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+	d.minimum = samples.front();
+	d.maximum = samples.back();
+	d.mean = CX::Util::mean(samples);
+	d.standardDeviation = (n >= 2) ? CX_Millis::standardDeviation(samples) : CX_Millis(0);
+
+	return d;
+}
+
+bool CX_LatencyCalibration::_inputEventHandler(CX_SoundStream::InputEventArgs& inputData) {
+	CX_SoundStream::ListenerScope watchdog(inputData.instance, "CX_LatencyCalibration");
+
+	uint64_t firstFrame = inputData.instance->getSampleFrameNumber();
+
+	for (int d = 0; d < DETECTOR_COUNT; d++) {
+		Detector& det = _detectors[d];
+		if (det.channel < 0) {
+			continue;
+		}
+
+		for (unsigned int i = 0; i < inputData.bufferSize; i++) {
+			uint64_t frame = firstFrame + i;
+			if (frame < det.holdoffUntil) {
+				continue;
+			}
+			if (std::abs(inputData.inputBuffer[i * inputData.inputChannels + det.channel]) >= det.threshold) {
+				Onset onset;
+				onset.sampleFrame = frame;
+				onset.detector = d;
+				_onsets.write(&onset, 1);
+				det.holdoffUntil = frame + _holdoffFrames;
+			}
+		}
+	}
+
+	return false; //The input is only observed, so other listeners, like a CX_SoundBufferRecorder, still get it.
+}
+
+void CX_LatencyCalibration::_listenForEvents(bool listen) {
+	if (listen == _listening || (listen && _config.soundStream == nullptr)) {
+		return;
+	}
+
+	if (listen) {
+		ofAddListener(_config.soundStream->inputEvent, this, &CX_LatencyCalibration::_inputEventHandler);
+	} else {
+		ofRemoveListener(_config.soundStream->inputEvent, this, &CX_LatencyCalibration::_inputEventHandler);
+	}
+	_listening = listen;
+}
+
+}
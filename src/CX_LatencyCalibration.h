@@ -0,0 +1,211 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ofRectangle.h"
+#include "ofColor.h"
+
+#include "CX_Clock.h"
+#include "CX_Display.h"
+#include "CX_SoundStream.h"
+#include "CX_Joystick.h"
+#include "CX_SPSCRingBuffer.h"
+
+namespace CX {
+
+	/*! This class measures the end-to-end latency of the display and of sound output with sensors, rather than relying on what
+	the CPU can see (see CX_SlidePresenter::PresentationErrorInfo). A patch in a corner of the screen is flashed with a
+	CX_SlidePresenter while a light sensor (e.g. a photodiode) pointed at the patch is recorded, then clicks are played with a
+	CX_SoundBufferPlayer while a microphone (or a direct loopback cable) is recorded. The light sensor can be recorded through
+	an input channel of a CX_SoundStream or, if it is wired to a joystick port, through a button of a CX_Joystick. The
+	microphone is recorded through an input channel of the same CX_SoundStream that plays the clicks.
+
+	The result is the distribution of the delay between each buffer swap and the light sensor onset (for the display) and
+	between each scheduled sound start time and the microphone onset (for sound). The medians of these are the offsets
+	for the computer: they are given to CX_Display::setPresentationLatency() and CX_SoundStream::setOutputLatencyOffset(),
+	after which scheduled sounds are started so that they are heard when asked for and slides get an estimated onset time
+	(CX_SlidePresenter::Slide::onsetTime). The offsets can be saved to a file and loaded on later runs with loadOffsets(),
+	or the lines of the file can be copied into per-computer configuration files (see CX_Display::configureFromFile() and
+	CX_SoundStream::Configuration::setFromFile()).
+
+	The times of sensor onsets that are recorded through the sound stream are taken to be one buffer period before the
+	callback that delivered them (see CX_SoundStream::sampleFrameToTime()). Any additional latency of the input hardware
+	delays both onsets equally, so it biases both measured latencies but not their difference. If the input latency is
+	known, it can be given in Configuration::inputLatency.
+
+	\code{.cpp}
+	CX_SoundStream::Configuration ssConfig;
+	ssConfig.inputChannels = 2; //Photodiode on channel 0, microphone on channel 1.
+	ssConfig.outputChannels = 2;
+	ssConfig.bufferSize = 256;
+	CX_SoundStream stream;
+	stream.setup(ssConfig);
+	stream.start();
+
+	CX_LatencyCalibration::Configuration config;
+	config.soundStream = &stream;
+	config.lightSensorChannel = 0;
+	config.microphoneChannel = 1;
+	config.filename = "latencyOffsets.txt";
+
+	CX_LatencyCalibration calibration;
+	CX_LatencyCalibration::Result result = calibration.run(config);
+	Log.notice() << "Display latency: " << result.display.median << " ms, sound latency: " << result.audio.median << " ms";
+
+	//On later runs:
+	CX_LatencyCalibration::loadOffsets("latencyOffsets.txt", &Disp, &stream);
+	\endcode
+
+	\ingroup timing
+	*/
+	class CX_LatencyCalibration {
+	public:
+
+		/*! How the light sensor that is pointed at the flashing patch is recorded. */
+		enum class LightSensor {
+			NONE, //!< The display latency is not measured.
+			SOUND_INPUT, //!< The light sensor is recorded on input channel `lightSensorChannel` of `soundStream`.
+			JOYSTICK_BUTTON //!< The light sensor presses button `joystickButton` of `joystick` when it sees light.
+		};
+
+		/*! The configuration of a calibration run. */
+		struct Configuration {
+			Configuration(void) :
+				display(&CX::Instances::Disp),
+				soundStream(nullptr),
+				lightSensor(LightSensor::SOUND_INPUT),
+				lightSensorChannel(0),
+				lightSensorThreshold(0.1),
+				joystick(nullptr),
+				joystickButton(0),
+				measureAudio(true),
+				microphoneChannel(1),
+				microphoneThreshold(0.1),
+				inputLatency(0),
+				trials(20),
+				patch(0, 0, 100, 100),
+				patchColor(255),
+				backgroundColor(0),
+				flashDuration(100),
+				trialInterval(500),
+				clickDuration(5),
+				clickAmplitude(0.8),
+				applyOffsets(true),
+				filename("")
+			{}
+
+			CX_Display* display; //!< The display to measure.
+
+			/*! The sound stream that records the sensors and plays the clicks. It must be set up and running. It needs input
+			channels for the sensors that are recorded through it and output channels if `measureAudio` is `true`. */
+			CX_SoundStream* soundStream;
+
+			LightSensor lightSensor; //!< How the light sensor is recorded.
+			int lightSensorChannel; //!< For `SOUND_INPUT`, the input channel of the light sensor.
+			float lightSensorThreshold; //!< For `SOUND_INPUT`, the absolute sample value that counts as an onset.
+			CX_Joystick* joystick; //!< For `JOYSTICK_BUTTON`, the joystick. It should be sampled with CX_Joystick::startSampling() for precise times.
+			int joystickButton; //!< For `JOYSTICK_BUTTON`, the index of the button.
+
+			bool measureAudio; //!< If `true`, the sound output latency is measured.
+			int microphoneChannel; //!< The input channel of the microphone or loopback cable.
+			float microphoneThreshold; //!< The absolute sample value that counts as an onset on the microphone channel.
+
+			CX_Millis inputLatency; //!< The known latency of the input hardware, which is subtracted from the times of onsets that are recorded through the sound stream.
+
+			unsigned int trials; //!< The number of flashes and the number of clicks.
+
+			ofRectangle patch; //!< The rectangle that is flashed, in pixels. The light sensor should be pointed at it.
+			ofColor patchColor; //!< The color of the patch while it is flashed.
+			ofColor backgroundColor; //!< The color of the rest of the screen, and of the patch between flashes.
+			CX_Millis flashDuration; //!< How long the patch is shown for each flash.
+
+			/*! The time between the end of one flash and the start of the next, and between clicks. Onsets are looked for within
+			half of this after each flash or click, so it should be considerably longer than the largest expected latency. */
+			CX_Millis trialInterval;
+
+			CX_Millis clickDuration; //!< The duration of each click.
+			float clickAmplitude; //!< The amplitude of each click, in (0, 1].
+
+			bool applyOffsets; //!< If `true`, the measured offsets are applied to `display` and `soundStream` with applyOffsets().
+			std::string filename; //!< If not empty, the measured offsets are saved to this file with saveOffsets().
+		};
+
+		/*! The distribution of the latencies that were measured for one kind of output. */
+		struct Distribution {
+			Distribution(void) :
+				missedTrials(0),
+				mean(0),
+				median(0),
+				standardDeviation(0),
+				minimum(0),
+				maximum(0)
+			{}
+
+			std::vector<CX_Millis> samples; //!< The latency of each trial on which an onset was found, in trial order.
+			unsigned int missedTrials; //!< The number of trials on which no onset was found.
+
+			CX_Millis mean;
+			CX_Millis median;
+			CX_Millis standardDeviation;
+			CX_Millis minimum;
+			CX_Millis maximum;
+
+			/*! Returns `true` if any latencies were measured. */
+			bool isMeasured(void) const { return !samples.empty(); };
+		};
+
+		/*! The result of a calibration run. */
+		struct Result {
+			Distribution display; //!< The delay from each buffer swap (see CX_Display::getLastSwapTime()) to the light sensor onset.
+			Distribution audio; //!< The delay from each scheduled sound start time to the microphone onset, before any output latency offset.
+		};
+
+		CX_LatencyCalibration(void);
+		~CX_LatencyCalibration(void);
+
+		Result run(Configuration config);
+
+		static void applyOffsets(const Result& result, CX_Display* display, CX_SoundStream* soundStream);
+		static bool saveOffsets(const Result& result, std::string filename);
+		static bool loadOffsets(std::string filename, CX_Display* display, CX_SoundStream* soundStream);
+
+	private:
+
+		struct Onset {
+			uint64_t sampleFrame;
+			int detector;
+		};
+
+		struct Detector {
+			int channel;
+			float threshold;
+			uint64_t holdoffUntil;
+		};
+
+		enum {
+			LIGHT_DETECTOR = 0,
+			MICROPHONE_DETECTOR = 1,
+			DETECTOR_COUNT = 2
+		};
+
+		Configuration _config;
+
+		//Written by the audio thread, read by the thread that calls run().
+		CX_SPSCRingBuffer<Onset> _onsets;
+		Detector _detectors[DETECTOR_COUNT];
+		uint64_t _holdoffFrames;
+		bool _listening;
+
+		bool _inputEventHandler(CX_SoundStream::InputEventArgs& inputData);
+		void _listenForEvents(bool listen);
+
+		Distribution _measureDisplay(void);
+		Distribution _measureAudio(void);
+
+		std::vector<CX_Millis> _collectOnsets(int detector);
+		static Distribution _makeDistribution(std::vector<CX_Millis> samples, unsigned int trials);
+		static CX_Millis _firstOnsetIn(const std::vector<CX_Millis>& onsets, CX_Millis from, CX_Millis until, bool* found);
+	};
+
+}
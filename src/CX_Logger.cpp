@@ -1,5 +1,11 @@
 #include "CX_Logger.h"
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+
 /*! This is an instance of CX::CX_Logger that is hooked into the CX backend.
 All log messages generated by CX and openFrameworks go through this instance.
 After runExperiment() returns, CX::Instances::Log.flush() is called.
@@ -37,7 +43,41 @@ namespace Private {
 		std::string message;
 		CX_Logger::Level level;
 		std::string module;
-		std::string timestamp;
+		CX_Millis time; //The timestamp is formatted from this when the message is flushed.
+	};
+
+	//Everything needed to write the messages from one flush, copied so that they can be written by another thread.
+	struct CX_LogBatch {
+		std::vector<CX_LogMessage> messages;
+		std::vector<CX_LoggerTargetInfo> targets;
+		std::map<std::string, CX_Logger::Level> moduleLevels;
+		bool timestamps;
+		std::string timestampFormat;
+	};
+
+	//The text to write to one target.
+	struct CX_LogOutput {
+		CX_LoggerTargetInfo target;
+		std::string text;
+	};
+
+	struct CX_LoggerAsyncWriter {
+		CX_LoggerAsyncWriter(void) :
+			stopping(false),
+			writing(false),
+			drainRequests(0)
+		{}
+
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable done;
+
+		std::deque<CX_LogBatch> batches;
+		bool stopping;
+		bool writing;
+		unsigned int drainRequests;
+		std::chrono::nanoseconds minimumInterval;
 	};
 
 	struct CX_ofLogMessageEventData_t {
@@ -109,7 +149,8 @@ namespace Private {
 	// CX_LogMessageSink //
 	///////////////////////
 	CX_LogMessageSink::CX_LogMessageSink(void) :
-		_logger(nullptr)
+		_logger(nullptr),
+		_level(CX::CX_Logger::Level::LOG_NONE)
 	{
 	}
 
@@ -147,19 +188,100 @@ namespace Private {
 	}
 
 	CX_LogMessageSink& CX_LogMessageSink::operator << (std::ostream& (*func)(std::ostream&)) {
-		func(*_message);
+		if (_message) {
+			func(*_message);
+		}
 		return *this;
 	}
 
+	//Replaces each {} in the format string of the record with the next argument.
+	static std::string formatRealTimeRecord(const CX_RealTimeLogRecord& record) {
+		std::ostringstream message;
+		unsigned int argument = 0;
+
+		for (const char* c = record.format; *c != '\0'; c++) {
+			if (c[0] == '{' && c[1] == '}' && argument < record.argumentCount) {
+				const CX_RealTimeLogRecord::Argument& a = record.arguments[argument++];
+				switch (a.type) {
+				case CX_RealTimeLogRecord::Argument::Type::SIGNED: message << a.i; break;
+				case CX_RealTimeLogRecord::Argument::Type::UNSIGNED: message << a.u; break;
+				case CX_RealTimeLogRecord::Argument::Type::FLOATING: message << a.d; break;
+				case CX_RealTimeLogRecord::Argument::Type::BOOL: message << (a.b ? "true" : "false"); break;
+				case CX_RealTimeLogRecord::Argument::Type::STRING: message << (a.s ? a.s : "(null)"); break;
+				}
+				c++;
+			} else {
+				message << *c;
+			}
+		}
+
+		return message.str();
+	}
+
 } //namespace Private
 
 
+/////////////////////
+// RealTimeChannel //
+/////////////////////
+
+/*! Constructs a channel that is not connected to a logger. Messages logged with it are ignored.
+Use CX::CX_Logger::realTimeChannel() to make a usable channel. */
+CX_Logger::RealTimeChannel::RealTimeChannel(void) :
+	_logger(nullptr),
+	_moduleLevel(Level::LOG_NONE),
+	_moduleLogLevelsVersion(0)
+{}
+
+CX_Logger::RealTimeChannel::RealTimeChannel(CX_Logger* logger, std::string module) :
+	_logger(logger),
+	_module(module),
+	_moduleLevel(logger->_getModuleLevelAndRegister(module)),
+	_moduleLogLevelsVersion(logger->_moduleLogLevelsVersion.load())
+{}
+
+/*! Returns `true` if a message logged at `level` would be stored. This never blocks: If the level of the module
+has just been changed, the change might not be seen until a later call. */
+bool CX_Logger::RealTimeChannel::isEnabled(Level level) {
+	if (_logger == nullptr) {
+		return false;
+	}
+
+	unsigned int version = _logger->_moduleLogLevelsVersion.load(std::memory_order_acquire);
+	if (version != _moduleLogLevelsVersion && _logger->_moduleLogLevelsMutex.tryLock()) {
+		std::map<std::string, Level>::const_iterator it = _logger->_moduleLogLevels.find(_module);
+		_moduleLevel = (it != _logger->_moduleLogLevels.end()) ? it->second : _logger->_defaultLogLevel;
+		_moduleLogLevelsVersion = version;
+		_logger->_moduleLogLevelsMutex.unlock();
+	}
+
+	//As with the other logging functions, the flush callback gets every message.
+	return level >= _moduleLevel || _logger->_hasFlushCallback.load(std::memory_order_relaxed);
+}
+
+void CX_Logger::RealTimeChannel::_store(CX::Private::CX_RealTimeLogRecord& record) {
+	size_t maxLength = CX::Private::CX_RealTimeLogRecord::maxModuleLength;
+	size_t length = std::min(_module.size(), maxLength);
+	std::memcpy(record.module, _module.data(), length);
+	record.module[length] = '\0';
+
+	_logger->_storeRealTimeRecord(record);
+}
+
+
+///////////////
+// CX_Logger //
+///////////////
 
 CX_Logger::CX_Logger(void) :
+	_queuedBytes(0),
+	_moduleLogLevelsVersion(0),
 	_flushCallback(nullptr),
+	_hasFlushCallback(false),
 	_logTimestamps(false),
 	_timestampFormat("%H:%M:%S"),
-	_defaultLogLevel(Level::LOG_NOTICE)
+	_defaultLogLevel(Level::LOG_NOTICE),
+	_realTimeQueueCapacity(1024)
 {
 	levelForAllExceptions(Level::LOG_NONE);
 	levelForConsole(Level::LOG_ALL);
@@ -177,6 +299,7 @@ CX_Logger::~CX_Logger(void) {
 	//Doesn't need to be removed because the _ofLoggerChannel is being destructed along with its messageLoggedEvent.
 	//ofRemoveListener(_ofLoggerChannel->messageLoggedEvent, this, &CX_Logger::_loggerChannelEventHandler);
 
+	asynchronousFlush(false); //Writes everything that was already flushed and stops the background thread.
 	flush();
 
 	for (unsigned int i = 0; i < _targetInfo.size(); i++) {
@@ -190,74 +313,215 @@ CX_Logger::~CX_Logger(void) {
 /*! Log all of the messages stored since the last call to flush() to the
 selected logging targets. This is a blocking operation, because it may take
 quite a while to output all log messages to various targets (see \ref blockingCode).
+
+If asynchronous flushing is on (see asynchronousFlush()), this function only hands the messages to
+a background thread that writes them, so it returns quickly no matter how many messages there are.
+The flush callback (see setMessageFlushCallback()) is still called in this function.
+
 \note This function is not 100% thread-safe: Only call it from the main thread. */
 void CX_Logger::flush(void) {
 
-	//By getting the message count once and only iterating over that many messages,
-	//a known number of messages are processed and just that many messages can be deleted later.
+	_drainRealTimeQueue();
+
+	CX::Private::CX_LogBatch batch;
+
+	//Messages can be logged again as soon as the queue has been swapped out.
 	_messageQueueMutex.lock();
-	unsigned int messageCount = _messageQueue.size();
+	batch.messages.swap(_messageQueue);
+	uint64_t flushedBytes = _queuedBytes;
+	_queuedBytes = 0;
 	_messageQueueMutex.unlock();
+	_trackedBytes.add(-(int64_t)flushedBytes);
 
-	if (messageCount == 0) {
+	if (batch.messages.empty()) {
 		return;
 	}
 
-	//Open output files
-	for (unsigned int i = 0; i < _targetInfo.size(); i++) {
-		if (_targetInfo[i].targetType == CX::Private::LogTarget::FILE) {
-			_targetInfo[i].file->open(_targetInfo[i].filename, ofFile::Append, false);
-			if (!_targetInfo[i].file->is_open()) {
-				std::cerr << "<CX_Logger> File " << _targetInfo[i].filename << " could not be opened for logging." << std::endl;
+	if (_flushCallback) {
+		for (const CX::Private::CX_LogMessage& m : batch.messages) {
+			MessageFlushData dat(m.message, m.level, m.module);
+			_flushCallback(dat);
+		}
+	}
+
+	batch.targets = _targetInfo;
+	batch.timestamps = _logTimestamps;
+	batch.timestampFormat = _timestampFormat;
+
+	_moduleLogLevelsMutex.lock();
+	batch.moduleLevels = _moduleLogLevels;
+	_moduleLogLevelsMutex.unlock();
+
+	if (_asyncWriter) {
+		std::lock_guard<std::mutex> lock(_asyncWriter->mutex);
+		_asyncWriter->batches.push_back(std::move(batch));
+		_asyncWriter->wake.notify_one();
+		return;
+	}
+
+	std::vector<CX::Private::CX_LogOutput> outputs;
+	_formatBatch(batch, &outputs);
+	_writeOutputs(outputs);
+}
+
+/*! Turns asynchronous flushing on or off. When it is on, flush() hands the messages to a background thread, which
+formats them and writes them to the console and log files, so that logging a lot of messages does not slow down the
+thread that calls flush(). Everything that is written to a target at once is written with one call, rather than
+one message at a time.
+
+To avoid disturbing the rest of the experiment with frequent small writes, the background thread waits at least `minimumWriteInterval`
+between writes. Messages from flushes that happen within that time are written together. Call waitForFlush() to make sure that
+everything has been written. It is called for you after runExperiment() returns.
+
+\param async If `true`, asynchronous flushing is turned on. If `false`, it is turned off, after waiting for all of the messages
+that were already flushed to be written.
+\param minimumWriteInterval The minimum time between writes.
+*/
+void CX_Logger::asynchronousFlush(bool async, CX_Millis minimumWriteInterval) {
+	if (!async) {
+		if (_asyncWriter) {
+			{
+				std::lock_guard<std::mutex> lock(_asyncWriter->mutex);
+				_asyncWriter->stopping = true;
+				_asyncWriter->wake.notify_one();
 			}
+			_asyncWriter->thread.join();
+			_asyncWriter.reset();
 		}
+		return;
 	}
 
-	for (unsigned int i = 0; i < messageCount; i++) {
-		//Lock and copy each message. Messages cannot be added while locked.
-		//After the unlock, the message copy is used, not the original message.
-		_messageQueueMutex.lock();
-		CX::Private::CX_LogMessage m = _messageQueue[i];
-		_messageQueueMutex.unlock();
+	std::chrono::nanoseconds interval((long long)minimumWriteInterval.nanos());
 
-		if (_flushCallback) {
-			MessageFlushData dat(m.message, m.level, m.module);
-			_flushCallback(dat);
+	if (_asyncWriter) {
+		std::lock_guard<std::mutex> lock(_asyncWriter->mutex);
+		_asyncWriter->minimumInterval = interval;
+		return;
+	}
+
+	_asyncWriter.reset(new CX::Private::CX_LoggerAsyncWriter);
+	_asyncWriter->minimumInterval = interval;
+	_asyncWriter->thread = std::thread(&CX_Logger::_asyncWriterThread, this);
+}
+
+/*! If asynchronous flushing is on (see asynchronousFlush()), waits until the background thread has written all of the
+messages from previous calls to flush(). Otherwise, returns immediately. */
+void CX_Logger::waitForFlush(void) {
+	if (!_asyncWriter) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(_asyncWriter->mutex);
+	_asyncWriter->drainRequests++;
+	_asyncWriter->wake.notify_one();
+	_asyncWriter->done.wait(lock, [this]() { return _asyncWriter->batches.empty() && !_asyncWriter->writing; });
+	_asyncWriter->drainRequests--;
+}
+
+void CX_Logger::_asyncWriterThread(void) {
+	CX::Private::CX_LoggerAsyncWriter& w = *_asyncWriter;
+	std::chrono::steady_clock::time_point lastWrite = std::chrono::steady_clock::now() - w.minimumInterval;
+
+	std::unique_lock<std::mutex> lock(w.mutex);
+	while (true) {
+		w.wake.wait(lock, [&w]() { return w.stopping || !w.batches.empty(); });
+
+		if (w.batches.empty()) {
+			break; //Stopping with nothing left to write.
+		}
+
+		//Wait out the rest of the interval since the last write, unless someone is waiting for everything to be written.
+		w.wake.wait_until(lock, lastWrite + w.minimumInterval, [&w]() { return w.stopping || w.drainRequests > 0; });
+
+		std::deque<CX::Private::CX_LogBatch> batches;
+		batches.swap(w.batches);
+		w.writing = true;
+		lock.unlock();
+
+		std::vector<CX::Private::CX_LogOutput> outputs;
+		for (const CX::Private::CX_LogBatch& batch : batches) {
+			_formatBatch(batch, &outputs);
 		}
+		_writeOutputs(outputs);
+		lastWrite = std::chrono::steady_clock::now();
 
-		std::string formattedMessage = _formatMessage(m) + "\n";
+		lock.lock();
+		w.writing = false;
+		w.done.notify_all();
+	}
+}
 
-		if (m.level >= _moduleLogLevels[m.module]) {
-			for (unsigned int i = 0; i < _targetInfo.size(); i++) {
-				if (m.level >= _targetInfo[i].level) {
-					if (_targetInfo[i].targetType == CX::Private::LogTarget::CONSOLE) {
-						std::cout << formattedMessage;
-					} else if (_targetInfo[i].targetType == CX::Private::LogTarget::FILE) {
-						*_targetInfo[i].file << formattedMessage;
-					}
+//Formats the messages in the batch and appends them to the text for each target that they should go to.
+void CX_Logger::_formatBatch(const CX::Private::CX_LogBatch& batch, std::vector<CX::Private::CX_LogOutput>* outputs) {
+	std::vector<size_t> outputIndices;
+	for (const CX::Private::CX_LoggerTargetInfo& target : batch.targets) {
+		size_t index = 0;
+		while (index < outputs->size() &&
+			   ((*outputs)[index].target.targetType != target.targetType || (*outputs)[index].target.filename != target.filename))
+		{
+			index++;
+		}
+		if (index == outputs->size()) {
+			CX::Private::CX_LogOutput output;
+			output.target = target;
+			outputs->push_back(output);
+		}
+		outputIndices.push_back(index);
+	}
+
+	for (const CX::Private::CX_LogMessage& m : batch.messages) {
+		std::map<std::string, Level>::const_iterator moduleLevel = batch.moduleLevels.find(m.module);
+		if (moduleLevel != batch.moduleLevels.end() && m.level < moduleLevel->second) {
+			continue;
+		}
+
+		std::string formattedMessage;
+		for (size_t i = 0; i < batch.targets.size(); i++) {
+			if (m.level >= batch.targets[i].level) {
+				if (formattedMessage.empty()) {
+					formattedMessage = _formatMessage(m, batch.timestamps, batch.timestampFormat) + "\n";
 				}
+				(*outputs)[outputIndices[i]].text += formattedMessage;
 			}
 		}
 	}
+}
 
-	//Close output files
-	for (unsigned int i = 0; i < _targetInfo.size(); i++) {
-		if (_targetInfo[i].targetType == CX::Private::LogTarget::FILE) {
-			_targetInfo[i].file->close();
+void CX_Logger::_writeOutputs(const std::vector<CX::Private::CX_LogOutput>& outputs) {
+	for (const CX::Private::CX_LogOutput& output : outputs) {
+		if (output.text.empty()) {
+			continue;
 		}
-	}
 
-	//Delete printed messages
-	_messageQueueMutex.lock();
-	_messageQueue.erase(_messageQueue.begin(), _messageQueue.begin() + messageCount);
-	_messageQueueMutex.unlock();
+		if (output.target.targetType == CX::Private::LogTarget::CONSOLE) {
+			std::cout << output.text;
+		} else if (output.target.targetType == CX::Private::LogTarget::FILE) {
+			FILE* file = fopen(output.target.filename.c_str(), "a");
+			if (file == nullptr) {
+				std::cerr << "<CX_Logger> File " << output.target.filename << " could not be opened for logging." << std::endl;
+				continue;
+			}
+			fwrite(output.text.data(), 1, output.text.size(), file);
+			fclose(file);
+		}
+	}
 }
 
 /*! \brief Clear all stored log messages. */
 void CX_Logger::clear(void) {
+	if (_realTimeQueue) {
+		CX::Private::CX_RealTimeLogRecord record;
+		while (_realTimeQueue->pop(&record))
+			;
+		_realTimeQueue->resetDroppedCount();
+	}
+
 	_messageQueueMutex.lock();
 	_messageQueue.clear();
+	uint64_t clearedBytes = _queuedBytes;
+	_queuedBytes = 0;
 	_messageQueueMutex.unlock();
+	_trackedBytes.add(-(int64_t)clearedBytes);
 }
 
 /*! \brief Set the log level for messages to be printed to the console. */
@@ -340,6 +604,7 @@ void CX_Logger::levelForFile(Level level, std::string filename) {
 void CX_Logger::level(Level level, std::string module) {
 	_moduleLogLevelsMutex.lock();
 	_moduleLogLevels[module] = level;
+	_moduleLogLevelsVersion++;
 	_moduleLogLevelsMutex.unlock();
 }
 
@@ -366,6 +631,7 @@ void CX_Logger::levelForAllModules(Level level) {
 	for (std::map<std::string, Level>::iterator it = _moduleLogLevels.begin(); it != _moduleLogLevels.end(); it++) {
 		_moduleLogLevels[it->first] = level;
 	}
+	_moduleLogLevelsVersion++;
 	_moduleLogLevelsMutex.unlock();
 }
 
@@ -377,6 +643,7 @@ log level will be sent to the user function.
 */
 void CX_Logger::setMessageFlushCallback(std::function<void(CX_Logger::MessageFlushData&)> f) {
 	_flushCallback = f;
+	_hasFlushCallback = (bool)f;
 }
 
 /*! Set whether or not to log timestamps and the format for the timestamps.
@@ -495,24 +762,11 @@ void CX_Logger::levelForExceptions(Level level, std::string module) {
 }
 
 void CX_Logger::_storeLogMessage(CX::Private::CX_LogMessageSink& ms) {
-	//If the module is unknown to the logger, it becomes known with the default log level.
-	_moduleLogLevelsMutex.lock();
-	if (_moduleLogLevels.find(ms._module) == _moduleLogLevels.end()) {
-		_moduleLogLevels[ms._module] = _defaultLogLevel;
-	}
-	_moduleLogLevelsMutex.unlock();
-
-
 	CX::Private::CX_LogMessage temp(ms._level, ms._module);
 	temp.message = (*(ms._message)).str();
+	temp.time = CX::Instances::Clock.now();
 
-	if (_logTimestamps) {
-		temp.timestamp = CX::Instances::Clock.getDateTimeString(_timestampFormat);
-	}
-
-	_messageQueueMutex.lock();
-	_messageQueue.push_back(temp);
-	_messageQueueMutex.unlock();
+	_queueMessages(std::vector<CX::Private::CX_LogMessage>(1, temp));
 
 	//Check for exceptions
 	_exceptionLevelsMutex.lock();
@@ -531,9 +785,111 @@ void CX_Logger::_storeLogMessage(CX::Private::CX_LogMessageSink& ms) {
 }
 
 CX::Private::CX_LogMessageSink CX_Logger::_log(Level level, std::string module) {
+	if (!_isMessageKept(level, module)) {
+		return CX::Private::CX_LogMessageSink(); //A sink with no logger ignores everything given to it.
+	}
 	return CX::Private::CX_LogMessageSink(this, level, module);
 }
 
+//A message is kept if it would be printed, if it would cause an exception, or if there is a flush callback, which gets every message.
+bool CX_Logger::_isMessageKept(Level level, const std::string& module) {
+	if (_hasFlushCallback || level >= _getModuleLevelAndRegister(module)) {
+		return true;
+	}
+
+	_exceptionLevelsMutex.lock();
+	std::map<std::string, Level>::const_iterator it = _exceptionLevels.find(module);
+	Level exceptionLevel = (it != _exceptionLevels.end()) ? it->second : _defaultExceptionLevel;
+	_exceptionLevelsMutex.unlock();
+
+	return level >= exceptionLevel;
+}
+
+//If the module is unknown to the logger, it becomes known with the default log level.
+CX_Logger::Level CX_Logger::_getModuleLevelAndRegister(const std::string& module) {
+	_moduleLogLevelsMutex.lock();
+	std::map<std::string, Level>::iterator it = _moduleLogLevels.find(module);
+	if (it == _moduleLogLevels.end()) {
+		it = _moduleLogLevels.insert(std::make_pair(module, _defaultLogLevel)).first;
+	}
+	Level level = it->second;
+	_moduleLogLevelsMutex.unlock();
+	return level;
+}
+
+/*! Makes a channel for logging messages from real-time threads, like the callback of a CX_SoundStream.
+Call this outside of the real-time thread and give the channel to the real-time thread.
+See CX::CX_Logger::RealTimeChannel for more information.
+\param module The name of the module that messages logged with the channel belong to.
+\return The channel. */
+CX_Logger::RealTimeChannel CX_Logger::realTimeChannel(std::string module) {
+	if (!_realTimeQueue) {
+		_realTimeQueue.reset(new CX_MPSCQueue<CX::Private::CX_RealTimeLogRecord>(_realTimeQueueCapacity));
+	}
+	return RealTimeChannel(this, module);
+}
+
+/*! Sets how many messages logged with real-time channels (see realTimeChannel()) can be stored between flushes.
+If more messages than this are logged before the next flush, the extra messages are dropped. The default is 1024.
+Any messages from real-time channels that have not been flushed are lost.
+\param messages The number of messages. This is rounded up to a power of 2.
+\note This must not be called while any real-time channel might be in use by another thread. */
+void CX_Logger::setRealTimeQueueCapacity(size_t messages) {
+	_realTimeQueueCapacity = messages;
+	if (_realTimeQueue) {
+		_realTimeQueue->setup(messages);
+	}
+}
+
+void CX_Logger::_storeRealTimeRecord(CX::Private::CX_RealTimeLogRecord& record) {
+	record.time = CX::Instances::Clock.now();
+	_realTimeQueue->push(record); //If the queue is full, the record is dropped and counted.
+}
+
+//Moves messages from real-time channels into the main message queue, formatting them along the way.
+void CX_Logger::_drainRealTimeQueue(void) {
+	if (!_realTimeQueue) {
+		return;
+	}
+
+	std::vector<CX::Private::CX_LogMessage> messages;
+	CX::Private::CX_RealTimeLogRecord record;
+	while (_realTimeQueue->pop(&record)) {
+		CX::Private::CX_LogMessage m(record.level, record.module);
+		m.message = CX::Private::formatRealTimeRecord(record);
+		m.time = record.time;
+		messages.push_back(m);
+	}
+
+	uint64_t dropped = _realTimeQueue->resetDroppedCount();
+	if (dropped > 0) {
+		CX::Private::CX_LogMessage m(Level::LOG_WARNING, "CX_Logger");
+		m.message = ofToString(dropped) + " messages from real-time channels were dropped because the queue was full. "
+			"See CX_Logger::setRealTimeQueueCapacity().";
+		m.time = CX::Instances::Clock.now();
+		messages.push_back(m);
+	}
+
+	if (!messages.empty()) {
+		_queueMessages(messages);
+	}
+}
+
+//The memory use is tracked outside of the lock because going over the memory budget logs a message.
+void CX_Logger::_queueMessages(const std::vector<CX::Private::CX_LogMessage>& messages) {
+	uint64_t bytes = 0;
+	for (const CX::Private::CX_LogMessage& m : messages) {
+		bytes += sizeof(CX::Private::CX_LogMessage) + m.message.capacity() + m.module.capacity();
+	}
+
+	_messageQueueMutex.lock();
+	_messageQueue.insert(_messageQueue.end(), messages.begin(), messages.end());
+	_queuedBytes += bytes;
+	_messageQueueMutex.unlock();
+
+	_trackedBytes.add(bytes);
+}
+
 std::string CX_Logger::_getLogLevelString(Level level) {
 	switch (level) {
 	case Level::LOG_VERBOSE: return "verbose";
@@ -548,11 +904,15 @@ std::string CX_Logger::_getLogLevelString(Level level) {
 }
 
 std::string CX_Logger::_formatMessage(const CX::Private::CX_LogMessage& message) {
+	return _formatMessage(message, _logTimestamps, _timestampFormat);
+}
+
+std::string CX_Logger::_formatMessage(const CX::Private::CX_LogMessage& message, bool timestamps, const std::string& timestampFormat) {
 	std::string logName = _getLogLevelString(message.level);
 	logName.append(max<int>((int)(7 - logName.size()), 0), ' '); //Pad out names to 7 chars
 	std::string formattedMessage;
-	if (_logTimestamps) {
-		formattedMessage += message.timestamp + " ";
+	if (timestamps) {
+		formattedMessage += CX::Instances::Clock.getDateTimeString(message.time, timestampFormat) + " ";
 	}
 
 	formattedMessage += "[ " + logName + " ] ";
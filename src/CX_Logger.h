@@ -7,18 +7,27 @@
 #include <map>
 #include <algorithm>
 #include <functional>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 #include <stdio.h> //vsnprintf
 #include <stdarg.h> //va_args
 
 #include "Poco/Mutex.h"
 
+#include "CX_MemoryUsage.h"
+
 #include "ofUtils.h"
 #include "ofFileUtils.h"
 #include "ofEvents.h"
 #include "ofLog.h"
 
 #include "CX_Clock.h"
+#include "CX_Time_t.h"
+#include "CX_MPSCQueue.h"
 
 /*! \defgroup errorLogging Message Logging
 This module is designed for logging error, warnings, and other messages. The primary interface is the CX_Logger class,
@@ -34,6 +43,10 @@ namespace CX {
 		class CX_LoggerChannel;
 		struct CX_ofLogMessageEventData_t;
 		class CX_LogMessageSink;
+		struct CX_RealTimeLogRecord;
+		struct CX_LogBatch;
+		struct CX_LogOutput;
+		struct CX_LoggerAsyncWriter;
 	}
 
 	/*! This class is used for logging messages throughout the CX backend code. It can also be used
@@ -47,7 +60,8 @@ namespace CX {
 	it could disrupt a timing-critical section of code. For this reason, logged messages are stored
 	by the CX_Logger until the user requests that all stored messages be outputted to the logging
 	targets with CX_Logger::flush(). The user can choose an appropriate, non-timing-critical time
-	at which to call flush().
+	at which to call flush(). If there is no such time, messages can be written by a background
+	thread instead (see CX_Logger::asynchronousFlush()).
 
 	By default, messages are logged to the console window that opens with CX programs. Optionally,
 	messages can also be logged to any number of files using CX_Logger::levelForFile(). For each
@@ -64,6 +78,11 @@ namespace CX {
 	at once. Other than those functions, the other functions should be called only from one thread
 	(the main thread).
 
+	Messages that are filtered out by the level of their module (see level()) are discarded before anything
+	is formatted, so logging a message that will not be printed costs very little. However, the logging functions
+	take locks and allocate memory, so they should not be used in real-time threads, like the callback of
+	a CX_SoundStream. For those threads, use a CX_Logger::RealTimeChannel, which does not lock or allocate.
+
 	\ingroup errorLogging */
 	class CX_Logger {
 	public:
@@ -134,19 +153,30 @@ namespace CX {
 		void flush(void);
 		void clear(void);
 
+		void asynchronousFlush(bool async, CX_Millis minimumWriteInterval = CX_Millis(250));
+		void waitForFlush(void);
+
 		void timestamps(bool logTimestamps, std::string format = "%H:%M:%S.%i");
 
 		void setMessageFlushCallback(std::function<void(MessageFlushData&)> f);
 
 		void captureOFLogMessages(bool capture);
 
+		class RealTimeChannel;
+		RealTimeChannel realTimeChannel(std::string module);
+		void setRealTimeQueueCapacity(size_t messages);
+
 	private:
 
 		std::vector<CX::Private::CX_LoggerTargetInfo> _targetInfo;
 		std::map<std::string, Level> _moduleLogLevels;
 		std::vector<CX::Private::CX_LogMessage> _messageQueue;
 		Poco::Mutex _messageQueueMutex;
+		uint64_t _queuedBytes; //The approximate size of the messages in _messageQueue. Protected by _messageQueueMutex.
+		Private::CX_TrackedBytes<Util::MemoryCategory::LOG_MESSAGES> _trackedBytes;
+		void _queueMessages(const std::vector<CX::Private::CX_LogMessage>& messages);
 		Poco::Mutex _moduleLogLevelsMutex;
+		std::atomic<unsigned int> _moduleLogLevelsVersion; //Incremented whenever a module level changes.
 
 
 		CX::Private::CX_LogMessageSink _log(Level level, std::string module);
@@ -155,6 +185,7 @@ namespace CX {
 		void _storeLogMessage(CX::Private::CX_LogMessageSink& msg);
 
 		std::function<void(MessageFlushData&)> _flushCallback;
+		std::atomic<bool> _hasFlushCallback;
 
 		bool _logTimestamps;
 		std::string _timestampFormat;
@@ -170,6 +201,20 @@ namespace CX {
 
 		static std::string _getLogLevelString(Level level);
 		std::string _formatMessage(const CX::Private::CX_LogMessage& message);
+		std::string _formatMessage(const CX::Private::CX_LogMessage& message, bool timestamps, const std::string& timestampFormat);
+
+		std::unique_ptr<CX::Private::CX_LoggerAsyncWriter> _asyncWriter;
+		void _asyncWriterThread(void);
+		void _formatBatch(const CX::Private::CX_LogBatch& batch, std::vector<CX::Private::CX_LogOutput>* outputs);
+		void _writeOutputs(const std::vector<CX::Private::CX_LogOutput>& outputs);
+
+		bool _isMessageKept(Level level, const std::string& module);
+		Level _getModuleLevelAndRegister(const std::string& module);
+
+		std::unique_ptr<CX_MPSCQueue<CX::Private::CX_RealTimeLogRecord>> _realTimeQueue;
+		size_t _realTimeQueueCapacity;
+		void _storeRealTimeRecord(CX::Private::CX_RealTimeLogRecord& record);
+		void _drainRealTimeQueue(void);
 	};
 
 	namespace Instances {
@@ -191,7 +236,9 @@ namespace CX {
 
 			template <class T>
 			CX_LogMessageSink& operator<<(const T& value) {
-				*_message << value;
+				if (_message) { //If the message was filtered out, there is no stream and nothing is formatted.
+					*_message << value;
+				}
 				return *this;
 			}
 
@@ -209,4 +256,165 @@ namespace CX {
 			std::string _module;
 		};
 	}
+
+	namespace Private {
+		/* A message logged with a CX_Logger::RealTimeChannel. It has a fixed size so that it can be stored
+		without allocating memory. The message is formatted when the logger is flushed. */
+		struct CX_RealTimeLogRecord {
+			static const size_t maxArguments = 6;
+			static const size_t maxModuleLength = 31;
+
+			struct Argument {
+				enum class Type : uint8_t {
+					SIGNED,
+					UNSIGNED,
+					FLOATING,
+					BOOL,
+					STRING
+				};
+
+				Type type;
+				union {
+					int64_t i;
+					uint64_t u;
+					double d;
+					bool b;
+					const char* s;
+				};
+			};
+
+			CX_Millis time;
+			CX_Logger::Level level;
+			const char* format;
+			unsigned int argumentCount;
+			Argument arguments[maxArguments];
+			char module[maxModuleLength + 1];
+		};
+	}
+
+	/*! A CX_Logger::RealTimeChannel logs messages for one module without locking or allocating memory, so
+	it can be used in real-time threads, like the callback of a CX_SoundStream. Make a channel with
+	CX_Logger::realTimeChannel() outside of the real-time thread, then use it in the real-time thread.
+
+	Rather than being formatted as they are logged, messages are stored in a fixed-size queue with
+	a format string and up to 6 arguments, which are formatted when the logger is flushed. In the format string,
+	each `{}` is replaced by the next argument. The arguments may be numbers, `bool`s, `CX_Time_t`s
+	(which are formatted in milliseconds), or C strings. Because the format string and C string arguments
+	are not copied, they must still exist when the logger is flushed, so they should be string literals.
+
+	\code{.cpp}
+	CX_Logger::RealTimeChannel audioLog = Log.realTimeChannel("audio"); //Outside of the real-time thread.
+
+	//In the real-time thread:
+	audioLog.warning("Late by {} samples at {} ms.", lateSamples, Clock.now());
+	\endcode
+
+	Messages are filtered by the level of the module before they are stored. If the queue is full, messages are
+	dropped and a warning about how many were dropped is logged on the next flush. See CX_Logger::setRealTimeQueueCapacity().
+	Messages logged with a channel never cause exceptions to be thrown (see CX_Logger::levelForExceptions()).
+
+	A channel may be used by one thread at a time. To log from several real-time threads, give each one a channel.
+	\ingroup errorLogging
+	*/
+	class CX_Logger::RealTimeChannel {
+	public:
+
+		RealTimeChannel(void);
+
+		/*! Logs a message at the given level. See the class description for the format of the message. */
+		template <typename... Args>
+		void log(Level level, const char* format, const Args&... args) {
+			static_assert(sizeof...(Args) <= CX::Private::CX_RealTimeLogRecord::maxArguments,
+				"CX_Logger::RealTimeChannel: Too many arguments for a real-time log message.");
+
+			if (!isEnabled(level)) {
+				return;
+			}
+
+			CX::Private::CX_RealTimeLogRecord record;
+			record.level = level;
+			record.format = format;
+			record.argumentCount = 0;
+			_setArguments(record, args...);
+			_store(record);
+		}
+
+		/*! \brief Equivalent to `log(CX_Logger::Level::LOG_VERBOSE, format, args...)`. */
+		template <typename... Args> void verbose(const char* format, const Args&... args) { log(Level::LOG_VERBOSE, format, args...); }
+
+		/*! \brief Equivalent to `log(CX_Logger::Level::LOG_NOTICE, format, args...)`. */
+		template <typename... Args> void notice(const char* format, const Args&... args) { log(Level::LOG_NOTICE, format, args...); }
+
+		/*! \brief Equivalent to `log(CX_Logger::Level::LOG_WARNING, format, args...)`. */
+		template <typename... Args> void warning(const char* format, const Args&... args) { log(Level::LOG_WARNING, format, args...); }
+
+		/*! \brief Equivalent to `log(CX_Logger::Level::LOG_ERROR, format, args...)`. */
+		template <typename... Args> void error(const char* format, const Args&... args) { log(Level::LOG_ERROR, format, args...); }
+
+		/*! \brief Equivalent to `log(CX_Logger::Level::LOG_FATAL_ERROR, format, args...)`. */
+		template <typename... Args> void fatalError(const char* format, const Args&... args) { log(Level::LOG_FATAL_ERROR, format, args...); }
+
+		bool isEnabled(Level level);
+
+		/*! Returns the name of the module that this channel logs for. */
+		const std::string& getModule(void) const { return _module; };
+
+	private:
+		friend class CX_Logger;
+
+		RealTimeChannel(CX_Logger* logger, std::string module);
+
+		CX_Logger* _logger;
+		std::string _module;
+
+		Level _moduleLevel;
+		unsigned int _moduleLogLevelsVersion;
+
+		void _store(CX::Private::CX_RealTimeLogRecord& record);
+
+		typedef CX::Private::CX_RealTimeLogRecord::Argument Argument;
+
+		template <typename T>
+		static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type _setArgument(Argument& a, T value) {
+			a.type = Argument::Type::SIGNED;
+			a.i = value;
+		}
+
+		template <typename T>
+		static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value && !std::is_same<T, bool>::value>::type _setArgument(Argument& a, T value) {
+			a.type = Argument::Type::UNSIGNED;
+			a.u = value;
+		}
+
+		template <typename T>
+		static typename std::enable_if<std::is_floating_point<T>::value>::type _setArgument(Argument& a, T value) {
+			a.type = Argument::Type::FLOATING;
+			a.d = value;
+		}
+
+		template <typename TimeUnit>
+		static void _setArgument(Argument& a, const CX_Time_t<TimeUnit>& value) {
+			a.type = Argument::Type::FLOATING;
+			a.d = value.millis();
+		}
+
+		static void _setArgument(Argument& a, bool value) {
+			a.type = Argument::Type::BOOL;
+			a.b = value;
+		}
+
+		static void _setArgument(Argument& a, const char* value) {
+			a.type = Argument::Type::STRING;
+			a.s = value;
+		}
+
+		static void _setArguments(CX::Private::CX_RealTimeLogRecord&) {}
+
+		template <typename T, typename... Rest>
+		static void _setArguments(CX::Private::CX_RealTimeLogRecord& record, const T& first, const Rest&... rest) {
+			_setArgument(record.arguments[record.argumentCount++], first);
+			_setArguments(record, rest...);
+		}
+	};
+
 }
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+namespace CX {
+
+	/*! This class is a lock-free, bounded, multiple-producer, single-consumer queue. Any number of threads
+	may push elements into the queue at once while one thread pops them out, without locks and without
+	allocating memory, which makes it suitable for passing small records out of real-time threads such as
+	the audio callback of a CX_SoundStream. If the queue is full, pushed elements are dropped and counted.
+
+	Any thread may call push() and getDroppedCount(). Only one thread may call the consumer functions
+	(pop() and resetDroppedCount()). setup() must not be called while any other thread is using the queue.
+
+	\code{.cpp}
+	CX_MPSCQueue<int> queue(1024);
+
+	//In any producer thread:
+	queue.push(42); //Returns false if the queue was full.
+
+	//In the consumer thread:
+	int value;
+	while (queue.pop(&value)) {
+		//Use value...
+	}
+	\endcode
+	\ingroup utility
+	*/
+	template <typename T>
+	class CX_MPSCQueue {
+	public:
+
+		CX_MPSCQueue(void) :
+			_mask(0),
+			_enqueuePosition(0),
+			_dequeuePosition(0),
+			_droppedCount(0)
+		{}
+
+		/*! Construct the queue with room for at least `capacity` elements. See setup(). */
+		CX_MPSCQueue(size_t capacity) :
+			CX_MPSCQueue()
+		{
+			setup(capacity);
+		}
+
+		/*! Allocates space for at least `capacity` elements and empties the queue. The capacity is rounded
+		up to a power of 2. This function must not be called while the queue is in use by another thread.
+		\param capacity The minimum number of elements that the queue should be able to hold. */
+		void setup(size_t capacity) {
+			size_t size = 1;
+			while (size < capacity) {
+				size *= 2;
+			}
+
+			_cells.reset(new Cell[size]);
+			_mask = size - 1;
+			for (size_t i = 0; i < size; i++) {
+				_cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+
+			_enqueuePosition.store(0, std::memory_order_relaxed);
+			_dequeuePosition = 0;
+			_droppedCount.store(0, std::memory_order_release);
+		}
+
+		/*! Returns the number of elements that the queue can hold. */
+		size_t capacity(void) const {
+			return _cells ? _mask + 1 : 0;
+		}
+
+		/*! Producer: Pushes a copy of `value` into the queue.
+		\return `true` if the value was pushed, `false` if the queue was full (or not set up) and the value was dropped. */
+		bool push(const T& value) {
+			if (!_cells) {
+				_droppedCount.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			size_t position = _enqueuePosition.load(std::memory_order_relaxed);
+			while (true) {
+				Cell& cell = _cells[position & _mask];
+				size_t sequence = cell.sequence.load(std::memory_order_acquire);
+				intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+				if (difference == 0) {
+					if (_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+						cell.value = value;
+						cell.sequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				} else if (difference < 0) {
+					_droppedCount.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				} else {
+					position = _enqueuePosition.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		/*! Consumer: Pops the oldest element from the queue.
+		\param value Where to store the popped element.
+		\return `true` if an element was popped, `false` if the queue was empty. An element that is in the middle of being
+		pushed by another thread is treated as not yet being in the queue. */
+		bool pop(T* value) {
+			if (!_cells) {
+				return false;
+			}
+
+			Cell& cell = _cells[_dequeuePosition & _mask];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			if ((intptr_t)sequence - (intptr_t)(_dequeuePosition + 1) < 0) {
+				return false;
+			}
+
+			*value = cell.value;
+			cell.sequence.store(_dequeuePosition + _mask + 1, std::memory_order_release);
+			_dequeuePosition++;
+			return true;
+		}
+
+		/*! Returns the number of elements that have been dropped because the queue was full since the last time
+		resetDroppedCount() was called. */
+		uint64_t getDroppedCount(void) const {
+			return _droppedCount.load(std::memory_order_relaxed);
+		}
+
+		/*! Consumer: Sets the dropped count to 0 and returns what it was. */
+		uint64_t resetDroppedCount(void) {
+			return _droppedCount.exchange(0, std::memory_order_relaxed);
+		}
+
+	private:
+
+		struct Cell {
+			std::atomic<size_t> sequence;
+			T value;
+		};
+
+		std::unique_ptr<Cell[]> _cells;
+		size_t _mask;
+
+		std::atomic<size_t> _enqueuePosition;
+		size_t _dequeuePosition;
+
+		std::atomic<uint64_t> _droppedCount;
+	};
+
+}
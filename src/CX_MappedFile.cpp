@@ -0,0 +1,152 @@
+#include "CX_MappedFile.h"
+
+#include <algorithm>
+
+#include "CX_Logger.h"
+
+#ifndef TARGET_WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace CX {
+namespace Private {
+
+CX_MappedFile::CX_MappedFile(void) :
+	_open(false),
+	_data(nullptr),
+	_size(0)
+#ifdef TARGET_WIN32
+	, _file(INVALID_HANDLE_VALUE),
+	_mapping(NULL)
+#else
+	, _fd(-1)
+#endif
+{}
+
+CX_MappedFile::~CX_MappedFile(void) {
+	close();
+}
+
+/*! Maps the given file into memory. Any previously opened file is closed.
+\param filename The full path to the file.
+\return `true` if the file was mapped, `false` otherwise. An empty file can be opened, but has no data. */
+bool CX_MappedFile::open(const std::string& filename) {
+	close();
+
+#ifdef TARGET_WIN32
+	_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (_file == INVALID_HANDLE_VALUE) {
+		CX::Instances::Log.error("CX_MappedFile") << "open(): Could not open file " << filename << ".";
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(_file, &fileSize)) {
+		CX::Instances::Log.error("CX_MappedFile") << "open(): Could not get the size of file " << filename << ".";
+		close();
+		return false;
+	}
+	_size = (size_t)fileSize.QuadPart;
+
+	if (_size > 0) {
+		_mapping = CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (_mapping != NULL) {
+			_data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+		}
+		if (_data == nullptr) {
+			CX::Instances::Log.error("CX_MappedFile") << "open(): Could not map file " << filename << " into memory.";
+			close();
+			return false;
+		}
+	}
+#else
+	_fd = ::open(filename.c_str(), O_RDONLY);
+	if (_fd < 0) {
+		CX::Instances::Log.error("CX_MappedFile") << "open(): Could not open file " << filename << ".";
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(_fd, &st) != 0) {
+		CX::Instances::Log.error("CX_MappedFile") << "open(): Could not get the size of file " << filename << ".";
+		close();
+		return false;
+	}
+	_size = (size_t)st.st_size;
+
+	if (_size > 0) {
+		void* mapped = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+		if (mapped == MAP_FAILED) {
+			CX::Instances::Log.error("CX_MappedFile") << "open(): Could not map file " << filename << " into memory.";
+			close();
+			return false;
+		}
+		madvise(mapped, _size, MADV_SEQUENTIAL);
+		_data = (const char*)mapped;
+	}
+#endif
+
+	_open = true;
+	return true;
+}
+
+/*! Asks the operating system to start reading part of the file into memory in the background, so that it is
+resident by the time it is accessed. This returns without waiting for the data to be read. On versions of Windows
+before Windows 8, this does nothing.
+\param offset The offset of the part, in bytes.
+\param length The length of the part, in bytes. It is clipped to the end of the file. */
+void CX_MappedFile::prefetch(size_t offset, size_t length) const {
+	if (_data == nullptr || offset >= _size) {
+		return;
+	}
+	length = std::min(length, _size - offset);
+
+#ifdef TARGET_WIN32
+#if defined(_WIN32_WINNT) && (_WIN32_WINNT >= 0x0602)
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = (PVOID)(_data + offset);
+	range.NumberOfBytes = length;
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#else
+	//madvise() needs a page-aligned address.
+	static const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	size_t alignedOffset = offset - (offset % pageSize);
+	madvise((void*)(_data + alignedOffset), length + (offset - alignedOffset), MADV_WILLNEED);
+#endif
+}
+
+/*! Unmaps and closes the file. Pointers returned by data() are invalid after this is called. */
+void CX_MappedFile::close(void) {
+#ifdef TARGET_WIN32
+	if (_data != nullptr) {
+		UnmapViewOfFile(_data);
+	}
+	if (_mapping != NULL) {
+		CloseHandle(_mapping);
+		_mapping = NULL;
+	}
+	if (_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(_file);
+		_file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (_data != nullptr) {
+		munmap((void*)_data, _size);
+	}
+	if (_fd >= 0) {
+		::close(_fd);
+		_fd = -1;
+	}
+#endif
+
+	_data = nullptr;
+	_size = 0;
+	_open = false;
+}
+
+} //namespace Private
+} //namespace CX
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+#include "ofConstants.h"
+
+namespace CX {
+namespace Private {
+
+	/*! This class maps a file into memory for reading, so that the contents of the file can be used directly
+	without first copying them into a buffer. Pages of the file are read by the operating system as they are accessed.
+
+	This class is used internally by CX and should not be used directly.
+	*/
+	class CX_MappedFile {
+	public:
+
+		CX_MappedFile(void);
+		~CX_MappedFile(void);
+
+		bool open(const std::string& filename);
+		void close(void);
+
+		bool isOpen(void) const { return _open; };
+
+		/*! Returns a pointer to the start of the file data. If the file is empty, this is `nullptr`. */
+		const char* data(void) const { return _data; };
+
+		/*! Returns the size of the file, in bytes. */
+		size_t size(void) const { return _size; };
+
+		void prefetch(size_t offset, size_t length) const;
+
+	private:
+
+		CX_MappedFile(const CX_MappedFile&) = delete;
+		CX_MappedFile& operator=(const CX_MappedFile&) = delete;
+
+		bool _open;
+		const char* _data;
+		size_t _size;
+
+#ifdef TARGET_WIN32
+		HANDLE _file;
+		HANDLE _mapping;
+#else
+		int _fd;
+#endif
+	};
+
+} //namespace Private
+} //namespace CX
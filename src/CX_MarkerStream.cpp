@@ -0,0 +1,473 @@
+#include "CX_MarkerStream.h"
+
+#include <chrono>
+#include <cstring>
+#include <sstream>
+
+#ifdef TARGET_WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace CX {
+
+namespace {
+#ifdef TARGET_WIN32
+	typedef SOCKET socket_t;
+	const socket_t INVALID_SOCKET_VALUE = INVALID_SOCKET;
+	void closeSocket(socket_t s) { closesocket(s); }
+#else
+	typedef int socket_t;
+	const socket_t INVALID_SOCKET_VALUE = -1;
+	void closeSocket(socket_t s) { ::close(s); }
+#endif
+
+	struct SocketData {
+		socket_t socket;
+		sockaddr_in destination;
+	};
+
+	SocketData* socketData(void* p) {
+		return static_cast<SocketData*>(p);
+	}
+}
+
+CX_MarkerStream::CX_MarkerStream(void) :
+	_socketData(nullptr),
+	_sending(false),
+	_sequenceNumber(0),
+	_sentCount(0),
+	_failedCount(0),
+	_listeningToKeyboard(false),
+	_listeningToMouse(false)
+{}
+
+CX_MarkerStream::~CX_MarkerStream(void) {
+	close();
+}
+
+/*! Opens the stream and starts the sender thread. If the stream was already open, it is closed first.
+\param config The settings for the stream.
+\return `true` if the socket was opened, `false` otherwise. */
+bool CX_MarkerStream::setup(const Configuration& config) {
+	close();
+
+	_config = config;
+
+#ifdef TARGET_WIN32
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+		CX::Instances::Log.error("CX_MarkerStream") << "setup(): Windows sockets could not be initialized.";
+		return false;
+	}
+#endif
+
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	addrinfo* resolved = nullptr;
+	if (getaddrinfo(_config.host.c_str(), nullptr, &hints, &resolved) != 0 || resolved == nullptr) {
+		CX::Instances::Log.error("CX_MarkerStream") << "setup(): The host \"" << _config.host << "\" could not be resolved.";
+#ifdef TARGET_WIN32
+		WSACleanup();
+#endif
+		return false;
+	}
+
+	SocketData* data = new SocketData;
+	std::memcpy(&data->destination, resolved->ai_addr, sizeof(sockaddr_in));
+	data->destination.sin_port = htons(_config.port);
+	freeaddrinfo(resolved);
+
+	data->socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (data->socket == INVALID_SOCKET_VALUE) {
+		CX::Instances::Log.error("CX_MarkerStream") << "setup(): The socket could not be opened.";
+		delete data;
+#ifdef TARGET_WIN32
+		WSACleanup();
+#endif
+		return false;
+	}
+
+	//The sender thread polls for pings between sends, so receiving must not block.
+#ifdef TARGET_WIN32
+	u_long nonBlocking = 1;
+	ioctlsocket(data->socket, FIONBIO, &nonBlocking);
+#else
+	fcntl(data->socket, F_SETFL, fcntl(data->socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+	_socketData = data;
+
+	_queue.setup(_config.queueCapacity);
+	_sequenceNumber = 0;
+	_sentCount = 0;
+	_failedCount = 0;
+
+	_listenForEvents(true);
+
+	_sending = true;
+	_senderThread = std::thread(&CX_MarkerStream::_senderLoop, this);
+
+	CX::Instances::Log.notice("CX_MarkerStream") << "setup(): Streaming \"" << _config.streamName << "\" to " << _config.host << ":" << _config.port << ".";
+	return true;
+}
+
+/*! Stops listening for events, sends any markers that are waiting to be sent, and closes the stream. */
+void CX_MarkerStream::close(void) {
+	_listenForEvents(false);
+
+	if (_senderThread.joinable()) {
+		_sending = false;
+		_wake();
+		_senderThread.join();
+	}
+
+	if (_socketData == nullptr) {
+		return;
+	}
+
+	//The sender thread has stopped, so this thread is now the consumer of the queue.
+	Record rec;
+	while (_queue.pop(&rec)) {
+		_send(_formatRecord(rec));
+	}
+	_sendPendingRows();
+
+	closeSocket(socketData(_socketData)->socket);
+	delete socketData(_socketData);
+	_socketData = nullptr;
+
+#ifdef TARGET_WIN32
+	WSACleanup();
+#endif
+}
+
+/*! \brief Returns `true` if the stream has been set up and not closed. */
+bool CX_MarkerStream::isOpen(void) const {
+	return _socketData != nullptr;
+}
+
+/*! \brief Returns the configuration that the stream was set up with. */
+const CX_MarkerStream::Configuration& CX_MarkerStream::getConfiguration(void) const {
+	return _config;
+}
+
+/*! Sends a marker. This never blocks and never allocates memory, so it can be called from any thread.
+\param label The label of the marker. Labels longer than 95 bytes are truncated.
+\param time The time of the marker. Defaults to the current time.
+\return `false` if the stream is not open or the marker was dropped because the queue was full. */
+bool CX_MarkerStream::pushMarker(const std::string& label, CX_Millis time) {
+	Record rec;
+	rec.type = 'M';
+	rec.subtype = 0;
+	rec.code = 0;
+	rec.x = 0;
+	rec.y = 0;
+	rec.nanos = (int64_t)time.nanos();
+	_copyText(rec.text, sizeof(rec.text), label);
+	return _pushRecord(rec);
+}
+
+/*! Sends the values in a row of a data frame, e.g. the data for a trial once it is complete. The row is formatted
+on the calling thread, because the data frame could be changed after this returns.
+\param df The data frame.
+\param row The index of the row.
+\return `false` if the stream is not open, the row does not exist, or the row was dropped because too many rows are waiting to be sent. */
+bool CX_MarkerStream::pushRow(CX_DataFrame& df, CX_DataFrame::rowIndex_t row) {
+	if (!isOpen()) {
+		return false;
+	}
+
+	if (row >= df.getRowCount()) {
+		CX::Instances::Log.error("CX_MarkerStream") << "pushRow(): Row " << row << " does not exist. The data frame has " << df.getRowCount() << " rows.";
+		return false;
+	}
+
+	std::ostringstream s;
+	s << row;
+	for (const std::string& column : df.getColumnNames()) {
+		s << '\t' << _sanitize(column) << '=' << _sanitize(df(row, column).toString());
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_rowMutex);
+		if (_pendingRows.size() >= _config.queueCapacity) {
+			_failedCount++;
+			return false;
+		}
+		_pendingRows.push_back(std::make_pair((int64_t)CX::Instances::Clock.now().nanos(), s.str()));
+	}
+	_wake();
+	return true;
+}
+
+/*! Sends the onset of a slide, using CX_SlidePresenter::Slide::onsetTime as the time of the marker.
+This should be called after the slide has been presented, e.g. from its `slidePresentedCallback`.
+\param slide The slide.
+\return `false` if the stream is not open or the marker was dropped because the queue was full. */
+bool CX_MarkerStream::pushSlideOnset(const CX_SlidePresenter::Slide& slide) {
+	Record rec;
+	rec.type = 'S';
+	rec.subtype = 0;
+	rec.code = (int)slide.actual.startFrame;
+	rec.x = 0;
+	rec.y = 0;
+	rec.nanos = (int64_t)slide.onsetTime.nanos();
+	_copyText(rec.text, sizeof(rec.text), slide.name);
+	return _pushRecord(rec);
+}
+
+/*! Makes the onset of every slide that is currently in `presenter` be sent with pushSlideOnset() as soon as the slide
+is presented. This wraps the `slidePresentedCallback` of each slide, so any callbacks that were already set are still called
+(after the onset is pushed). Call this once, after all of the slides for the presentation have been appended: Slides that
+are appended later are not streamed unless this is called again, in which case the slides that were already streamed
+would be streamed twice.
+\param presenter The slide presenter. It must not be destroyed while its slides are being presented. */
+void CX_MarkerStream::streamSlideOnsets(CX_SlidePresenter& presenter) {
+	std::vector<CX_SlidePresenter::Slide>& slides = presenter.getSlides();
+	CX_SlidePresenter* p = &presenter;
+
+	for (size_t i = 0; i < slides.size(); i++) {
+		std::function<void(void)> previousCallback = slides[i].slidePresentedCallback;
+		slides[i].slidePresentedCallback = [this, p, i, previousCallback](void) {
+			this->pushSlideOnset(p->getSlides().at(i));
+			if (previousCallback) {
+				previousCallback();
+			}
+		};
+	}
+}
+
+/*! \brief Returns the number of datagrams that have been sent since the stream was set up. */
+uint64_t CX_MarkerStream::getSentCount(void) const {
+	return _sentCount.load();
+}
+
+/*! \brief Returns the number of markers and rows that were dropped, either because the queue was full or because
+the datagram could not be sent. */
+uint64_t CX_MarkerStream::getDroppedCount(void) const {
+	return _queue.getDroppedCount() + _failedCount.load();
+}
+
+bool CX_MarkerStream::_pushRecord(const Record& rec) {
+	if (!isOpen()) {
+		return false;
+	}
+	if (!_queue.push(rec)) {
+		return false;
+	}
+	_wake();
+	return true;
+}
+
+//The sender polls at least once per millisecond, so a missed notification only delays a marker by that much.
+void CX_MarkerStream::_wake(void) {
+	_wakeCondition.notify_one();
+}
+
+void CX_MarkerStream::_senderLoop(void) {
+	CX_Millis nextClockPacket = CX::Instances::Clock.now();
+
+	while (_sending) {
+		Record rec;
+		while (_queue.pop(&rec)) {
+			_send(_formatRecord(rec));
+		}
+
+		_sendPendingRows();
+
+		if (_config.clockPacketInterval > CX_Millis(0) && CX::Instances::Clock.now() >= nextClockPacket) {
+			_sendClockPacket();
+			nextClockPacket = CX::Instances::Clock.now() + _config.clockPacketInterval;
+		}
+
+		_answerPings();
+
+		std::unique_lock<std::mutex> lock(_wakeMutex);
+		_wakeCondition.wait_for(lock, std::chrono::milliseconds(1));
+	}
+}
+
+void CX_MarkerStream::_sendPendingRows(void) {
+	std::deque<std::pair<int64_t, std::string>> rows;
+	{
+		std::lock_guard<std::mutex> lock(_rowMutex);
+		rows.swap(_pendingRows);
+	}
+	for (const std::pair<int64_t, std::string>& row : rows) {
+		_send(_header('R', row.first) + '\t' + row.second);
+	}
+}
+
+std::string CX_MarkerStream::_header(char type, int64_t nanos) {
+	std::ostringstream s;
+	s << "CX1\t" << _sanitize(_config.streamName) << '\t' << _sequenceNumber++ << '\t' << type << '\t' << nanos;
+	return s.str();
+}
+
+std::string CX_MarkerStream::_formatRecord(const Record& rec) {
+	std::ostringstream s;
+	s << _header(rec.type, rec.nanos);
+
+	switch (rec.type) {
+	case 'K':
+		s << '\t' << rec.subtype << '\t' << rec.code;
+		break;
+	case 'B':
+		s << '\t' << rec.subtype << '\t' << rec.code << '\t' << rec.x << '\t' << rec.y;
+		break;
+	case 'S':
+		s << '\t' << rec.text << '\t' << rec.code;
+		break;
+	case 'M':
+	default:
+		s << '\t' << rec.text;
+		break;
+	}
+
+	return s.str();
+}
+
+bool CX_MarkerStream::_send(const std::string& message) {
+	SocketData* data = socketData(_socketData);
+	int sent = (int)::sendto(data->socket, message.c_str(), (int)message.size(), 0, (const sockaddr*)&data->destination, sizeof(data->destination));
+	if (sent != (int)message.size()) {
+		_failedCount++;
+		return false;
+	}
+	_sentCount++;
+	return true;
+}
+
+//The CX_Clock time and the system clock time are read back to back, so the receiver can find the offset between CX_Clock and its own clock.
+void CX_MarkerStream::_sendClockPacket(void) {
+	CX_Millis cxTime = CX::Instances::Clock.now();
+	int64_t systemNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+	std::ostringstream s;
+	s << _header('C', (int64_t)cxTime.nanos()) << '\t' << systemNanos;
+	_send(s.str());
+}
+
+//Answers "CX1 PING <id>" datagrams with the current time, so the receiver can measure the round trip.
+void CX_MarkerStream::_answerPings(void) {
+	SocketData* data = socketData(_socketData);
+
+	char buffer[256];
+	while (true) {
+		sockaddr_in sender;
+#ifdef TARGET_WIN32
+		int senderSize = sizeof(sender);
+#else
+		socklen_t senderSize = sizeof(sender);
+#endif
+		int received = (int)::recvfrom(data->socket, buffer, sizeof(buffer) - 1, 0, (sockaddr*)&sender, &senderSize);
+		if (received <= 0) {
+			return;
+		}
+		CX_Millis receiptTime = CX::Instances::Clock.now();
+		buffer[received] = 0;
+
+		const char* prefix = "CX1\tPING\t";
+		size_t prefixLength = std::strlen(prefix);
+		if ((size_t)received <= prefixLength || std::strncmp(buffer, prefix, prefixLength) != 0) {
+			continue;
+		}
+
+		std::string id = _sanitize(std::string(buffer + prefixLength));
+		std::string reply = _header('P', (int64_t)receiptTime.nanos()) + '\t' + id;
+		::sendto(data->socket, reply.c_str(), (int)reply.size(), 0, (const sockaddr*)&sender, senderSize);
+	}
+}
+
+void CX_MarkerStream::_keyboardEventHandler(CX_Keyboard::Event& ev) {
+	Record rec;
+	rec.type = 'K';
+	switch (ev.type) {
+	case CX_Keyboard::PRESSED: rec.subtype = 'P'; break;
+	case CX_Keyboard::RELEASED: rec.subtype = 'R'; break;
+	case CX_Keyboard::REPEAT: default: rec.subtype = 'T'; break;
+	}
+	rec.code = ev.key;
+	rec.x = 0;
+	rec.y = 0;
+	rec.nanos = (int64_t)ev.time.nanos();
+	rec.text[0] = 0;
+	_pushRecord(rec);
+}
+
+void CX_MarkerStream::_mouseEventHandler(CX_Mouse::Event& ev) {
+	Record rec;
+	rec.type = 'B';
+	switch (ev.type) {
+	case CX_Mouse::MOVED: rec.subtype = 'M'; break;
+	case CX_Mouse::PRESSED: rec.subtype = 'P'; break;
+	case CX_Mouse::RELEASED: rec.subtype = 'R'; break;
+	case CX_Mouse::DRAGGED: rec.subtype = 'D'; break;
+	case CX_Mouse::SCROLLED: default: rec.subtype = 'S'; break;
+	}
+
+	if (!_config.streamMouseMovement && (rec.subtype == 'M' || rec.subtype == 'D')) {
+		return;
+	}
+
+	rec.code = ev.button;
+	rec.x = ev.x;
+	rec.y = ev.y;
+	rec.nanos = (int64_t)ev.time.nanos();
+	rec.text[0] = 0;
+	_pushRecord(rec);
+}
+
+void CX_MarkerStream::_listenForEvents(bool listen) {
+	bool keyboard = listen && _config.streamKeyboard;
+	if (keyboard != _listeningToKeyboard) {
+		if (keyboard) {
+			ofAddListener(CX::Instances::Input.Keyboard.eventStored, this, &CX_MarkerStream::_keyboardEventHandler);
+		} else {
+			ofRemoveListener(CX::Instances::Input.Keyboard.eventStored, this, &CX_MarkerStream::_keyboardEventHandler);
+		}
+		_listeningToKeyboard = keyboard;
+	}
+
+	bool mouse = listen && _config.streamMouse;
+	if (mouse != _listeningToMouse) {
+		if (mouse) {
+			ofAddListener(CX::Instances::Input.Mouse.eventStored, this, &CX_MarkerStream::_mouseEventHandler);
+		} else {
+			ofRemoveListener(CX::Instances::Input.Mouse.eventStored, this, &CX_MarkerStream::_mouseEventHandler);
+		}
+		_listeningToMouse = mouse;
+	}
+}
+
+void CX_MarkerStream::_copyText(char* destination, size_t size, const std::string& source) {
+	size_t length = std::min(source.size(), size - 1);
+	for (size_t i = 0; i < length; i++) {
+		char c = source[i];
+		destination[i] = (c == '\t' || c == '\n' || c == '\r') ? ' ' : c;
+	}
+	destination[length] = 0;
+}
+
+std::string CX_MarkerStream::_sanitize(const std::string& s) {
+	std::string rval = s;
+	for (char& c : rval) {
+		if (c == '\t' || c == '\n' || c == '\r') {
+			c = ' ';
+		}
+	}
+	return rval;
+}
+
+}
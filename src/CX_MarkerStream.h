@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <utility>
+#include <mutex>
+#include <thread>
+
+#include "CX_Clock.h"
+#include "CX_DataFrame.h"
+#include "CX_InputManager.h"
+#include "CX_MPSCQueue.h"
+#include "CX_SlidePresenter.h"
+
+namespace CX {
+
+	/*! This class streams event markers and trial data out of CX as they happen, so that they can be recorded alongside
+	data from other acquisition systems, like EEG amplifiers or eye trackers, instead of only being written to files
+	at the end of the experiment. Each message is sent as one UDP datagram from a background thread, so sending never
+	blocks the main thread.
+
+	Markers can come from:
+	+ Keyboard and mouse events, which are forwarded from CX_Keyboard::eventStored and CX_Mouse::eventStored.
+	+ Slide onsets of a CX_SlidePresenter (see streamSlideOnsets()).
+	+ The user, with pushMarker() and pushRow().
+
+	All times are in the time of CX::Instances::Clock. So that a receiver can map them onto its own clock, the sender
+	regularly publishes the current CX_Clock time together with the wall-clock time of the system (see
+	Configuration::clockPacketInterval). A receiver can also measure the offset of the clocks with a round trip: If
+	it sends a datagram containing `CX1 PING <id>` (tab separated) back to the address and port that the datagrams of the
+	stream come from, the stream answers right away with a pong packet containing the id and the CX_Clock time at which
+	the ping was received.
+
+	Each datagram is one line of UTF-8 text with tab separated fields:
+	\code
+	CX1 <stream name> <sequence number> <type> <time in nanoseconds> <fields...>
+	\endcode
+	where the `<type>` and fields are:
+	+ `M <label>`: A marker from pushMarker().
+	+ `K <P, R, or T for pressed, released, or repeat> <key>`: A keyboard event.
+	+ `B <M, P, R, D, or S for moved, pressed, released, dragged, or scrolled> <button> <x> <y>`: A mouse event.
+	+ `S <slide name> <start frame>`: A slide onset. The time is CX_SlidePresenter::Slide::onsetTime.
+	+ `R <row index> <column>=<value> ...`: A trial row from pushRow(). The time is when the row was pushed.
+	+ `C <system clock time in nanoseconds since the epoch>`: A clock offset packet.
+	+ `P <ping id>`: The answer to a ping.
+
+	Tabs and newlines in labels and values are replaced with spaces. The sequence number increases by one for each datagram,
+	so a receiver can detect lost datagrams.
+
+	\code{.cpp}
+	CX_MarkerStream markers;
+
+	CX_MarkerStream::Configuration config;
+	config.host = "192.168.1.20"; //The computer that records the EEG.
+	config.port = 16571;
+	markers.setup(config);
+
+	//Mark the onsets of all of the slides once they have been appended.
+	markers.streamSlideOnsets(SlidePresenter);
+
+	markers.pushMarker("trial start");
+	SlidePresenter.presentSlides();
+
+	//At the end of each trial:
+	markers.pushRow(df, df.getRowCount() - 1);
+	\endcode
+
+	\ingroup dataManagement
+	*/
+	class CX_MarkerStream {
+	public:
+
+		/*! The settings for a CX_MarkerStream. See CX_MarkerStream::setup(). */
+		struct Configuration {
+			Configuration(void) :
+				host("127.0.0.1"),
+				port(16571),
+				streamName("CX"),
+				queueCapacity(4096),
+				clockPacketInterval(CX_Seconds(1)),
+				streamKeyboard(true),
+				streamMouse(true),
+				streamMouseMovement(false)
+			{}
+
+			std::string host; //!< The host name or IPv4 address of the receiver.
+			unsigned short port; //!< The UDP port of the receiver.
+
+			std::string streamName; //!< The name of the stream, which is sent in each datagram.
+
+			/*! The number of markers that can wait to be sent. If more markers are pushed while the sender thread is busy,
+			they are dropped and counted (see getDroppedCount()). */
+			size_t queueCapacity;
+
+			/*! How often clock offset packets are sent. If this is 0, no clock offset packets are sent. */
+			CX_Millis clockPacketInterval;
+
+			bool streamKeyboard; //!< If `true`, keyboard events from CX::Instances::Input.Keyboard are sent.
+			bool streamMouse; //!< If `true`, mouse button and scroll events from CX::Instances::Input.Mouse are sent.
+
+			/*! If `true` and `streamMouse` is `true`, mouse movement and drag events are also sent. There can be very many of them. */
+			bool streamMouseMovement;
+		};
+
+		CX_MarkerStream(void);
+		~CX_MarkerStream(void);
+
+		bool setup(const Configuration& config);
+		void close(void);
+		bool isOpen(void) const;
+		const Configuration& getConfiguration(void) const;
+
+		bool pushMarker(const std::string& label, CX_Millis time = CX::Instances::Clock.now());
+		bool pushRow(CX_DataFrame& df, CX_DataFrame::rowIndex_t row);
+		bool pushSlideOnset(const CX_SlidePresenter::Slide& slide);
+		void streamSlideOnsets(CX_SlidePresenter& presenter);
+
+		uint64_t getSentCount(void) const;
+		uint64_t getDroppedCount(void) const;
+
+	private:
+
+		//Markers are passed to the sender thread as fixed-size records so that pushing one never allocates.
+		struct Record {
+			char type;
+			char subtype;
+			int code;
+			float x;
+			float y;
+			int64_t nanos;
+			char text[96];
+		};
+
+		Configuration _config;
+
+		void* _socketData; //Platform-specific socket and address, defined in the .cpp file.
+
+		CX_MPSCQueue<Record> _queue;
+
+		//Trial rows can be long, so they are formatted on the calling thread and passed separately.
+		std::mutex _rowMutex;
+		std::deque<std::pair<int64_t, std::string>> _pendingRows; //The time at which each row was pushed and its fields.
+		void _sendPendingRows(void);
+
+		std::atomic<bool> _sending;
+		std::thread _senderThread;
+		std::mutex _wakeMutex;
+		std::condition_variable _wakeCondition;
+		void _senderLoop(void);
+		void _wake(void);
+
+		uint64_t _sequenceNumber; //Only used by the sender thread.
+		std::atomic<uint64_t> _sentCount;
+		std::atomic<uint64_t> _failedCount; //Rows that did not fit in the queue and datagrams that could not be sent.
+
+		std::string _formatRecord(const Record& rec);
+		std::string _header(char type, int64_t nanos);
+		bool _send(const std::string& message);
+		void _sendClockPacket(void);
+		void _answerPings(void);
+
+		bool _pushRecord(const Record& rec);
+
+		void _keyboardEventHandler(CX_Keyboard::Event& ev);
+		void _mouseEventHandler(CX_Mouse::Event& ev);
+		void _listenForEvents(bool listen);
+		bool _listeningToKeyboard;
+		bool _listeningToMouse;
+
+		static void _copyText(char* destination, size_t size, const std::string& source);
+		static std::string _sanitize(const std::string& s);
+	};
+
+}
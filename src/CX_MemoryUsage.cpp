@@ -0,0 +1,140 @@
+#include "CX_MemoryUsage.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "CX_Logger.h"
+
+namespace CX {
+
+namespace {
+	const int categoryCount = (int)Util::MemoryCategory::COUNT;
+
+	//Zero-initialized before any static constructors are run, so objects with static storage duration can be tracked.
+	std::atomic<int64_t> categoryBytes[categoryCount];
+	std::atomic<int64_t> categoryPeaks[categoryCount];
+	std::atomic<uint64_t> categoryBudgets[categoryCount];
+
+	std::string formatBytes(uint64_t bytes) {
+		std::ostringstream s;
+		s << std::fixed << std::setprecision(1);
+		if (bytes >= (1ull << 30)) {
+			s << (double)bytes / (1ull << 30) << " GB";
+		} else if (bytes >= (1ull << 20)) {
+			s << (double)bytes / (1ull << 20) << " MB";
+		} else if (bytes >= (1ull << 10)) {
+			s << (double)bytes / (1ull << 10) << " KB";
+		} else {
+			s << bytes << " bytes";
+		}
+		return s.str();
+	}
+}
+
+namespace Private {
+
+	//Called by the counters in the tracked classes. If the change takes the category over its budget, a warning is logged.
+	void trackMemory(Util::MemoryCategory category, int64_t deltaBytes) {
+		int index = (int)category;
+		int64_t current = categoryBytes[index].fetch_add(deltaBytes, std::memory_order_relaxed) + deltaBytes;
+		int64_t previous = current - deltaBytes;
+
+		int64_t peak = categoryPeaks[index].load(std::memory_order_relaxed);
+		while (current > peak && !categoryPeaks[index].compare_exchange_weak(peak, current, std::memory_order_relaxed))
+			;
+
+		uint64_t budget = categoryBudgets[index].load(std::memory_order_relaxed);
+		if (budget > 0 && deltaBytes > 0 && previous <= (int64_t)budget && current > (int64_t)budget) {
+			CX::Instances::Log.warning("CX::Util::memoryReport") << Util::memoryCategoryName(category) << " are using " <<
+				formatBytes(current) << ", which is over the budget of " << formatBytes(budget) << ".";
+		}
+	}
+
+}
+
+namespace Util {
+
+	/*! Returns the current and peak memory use of each category of CX memory use. See memoryReport().
+	\ingroup utility */
+	std::vector<MemoryUsage> getMemoryUsage(void) {
+		std::vector<MemoryUsage> rval;
+		for (int i = 0; i < categoryCount; i++) {
+			rval.push_back(getMemoryUsage((MemoryCategory)i));
+		}
+		return rval;
+	}
+
+	/*! Returns the current and peak memory use of one category. See memoryReport().
+	\ingroup utility */
+	MemoryUsage getMemoryUsage(MemoryCategory category) {
+		int index = (int)category;
+
+		MemoryUsage usage;
+		usage.category = category;
+		usage.name = memoryCategoryName(category);
+		usage.bytes = (uint64_t)std::max<int64_t>(categoryBytes[index].load(), 0);
+		usage.peakBytes = (uint64_t)std::max<int64_t>(categoryPeaks[index].load(), 0);
+		usage.budget = categoryBudgets[index].load();
+		return usage;
+	}
+
+	/*! Makes a human readable report of how much memory each subsystem of CX is using, how much it has used at most,
+	and its budget, if any (see setMemoryBudget()). The memory is counted by the classes that own it as they allocate and free it,
+	so getting the report is fast. The counts are of the data that CX holds and do not include the overhead of the memory allocator,
+	memory used by openFrameworks or the video driver outside of framebuffers, or memory used by user code.
+
+	\code{.cpp}
+	Log.notice() << Util::memoryReport();
+	\endcode
+
+	\return The report, with one line per category.
+	\ingroup utility */
+	std::string memoryReport(void) {
+		std::ostringstream s;
+		s << "CX memory use (current, peak, budget):";
+		for (const MemoryUsage& usage : getMemoryUsage()) {
+			s << std::endl << usage.name << ": " << formatBytes(usage.bytes) << ", " << formatBytes(usage.peakBytes) << ", " <<
+				(usage.budget > 0 ? formatBytes(usage.budget) : "none");
+		}
+		return s.str();
+	}
+
+	/*! Sets a soft budget for the memory use of a category. When the memory use of the category goes over the budget,
+	a warning is logged, so that running out of memory (or video memory) during a session can be seen coming before the operating
+	system starts paging. Nothing else happens: The memory is still allocated. A warning is logged again each time the memory use goes
+	from under the budget to over it.
+	\param category The category.
+	\param bytes The budget in bytes. If 0, the category has no budget.
+	\ingroup utility */
+	void setMemoryBudget(MemoryCategory category, uint64_t bytes) {
+		categoryBudgets[(int)category].store(bytes);
+
+		MemoryUsage usage = getMemoryUsage(category);
+		if (bytes > 0 && usage.bytes > bytes) {
+			CX::Instances::Log.warning("CX::Util::memoryReport") << usage.name << " are already using " << formatBytes(usage.bytes) <<
+				", which is over the new budget of " << formatBytes(bytes) << ".";
+		}
+	}
+
+	/*! Returns the memory budget of the category, or 0 if it has no budget. See setMemoryBudget().
+	\ingroup utility */
+	uint64_t getMemoryBudget(MemoryCategory category) {
+		return categoryBudgets[(int)category].load();
+	}
+
+	/*! Returns the name of the category, e.g. "Sound buffers".
+	\ingroup utility */
+	std::string memoryCategoryName(MemoryCategory category) {
+		switch (category) {
+		case MemoryCategory::SOUND_BUFFERS: return "Sound buffers";
+		case MemoryCategory::FRAMEBUFFERS: return "Framebuffers";
+		case MemoryCategory::DATA_FRAMES: return "Data frames";
+		case MemoryCategory::LOG_MESSAGES: return "Log messages";
+		case MemoryCategory::INPUT_EVENTS: return "Input events";
+		default: return "Unknown";
+		}
+	}
+
+}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace CX {
+namespace Util {
+
+	/*! The subsystems of CX whose memory use is tracked. See CX::Util::memoryReport(). */
+	enum class MemoryCategory : int {
+		SOUND_BUFFERS, //!< The sample data of CX_SoundBuffer%s that are in memory. Mapped files (see CX_SoundBuffer::mapFile()) are not counted.
+		FRAMEBUFFERS, //!< Video memory used by framebuffers from CX_FboPool%s, which includes the slides of CX_SlidePresenter%s.
+		DATA_FRAMES, //!< The cell data of CX_DataFrame%s. The characters of strings that are too long to be stored inside the string object are not counted.
+		LOG_MESSAGES, //!< Log messages that are waiting to be flushed by CX_Logger::flush().
+		INPUT_EVENTS, //!< The event buffers of the keyboard, mouse, and joysticks.
+		COUNT //!< The number of categories. Not a category.
+	};
+
+	/*! The memory use of one category, as returned by getMemoryUsage(). */
+	struct MemoryUsage {
+		MemoryCategory category; //!< The category.
+		std::string name; //!< The name of the category.
+		uint64_t bytes; //!< The number of bytes that are currently used.
+		uint64_t peakBytes; //!< The largest number of bytes that have been used at once.
+		uint64_t budget; //!< The soft budget for the category, or 0 if it has no budget. See setMemoryBudget().
+	};
+
+	std::vector<MemoryUsage> getMemoryUsage(void);
+	MemoryUsage getMemoryUsage(MemoryCategory category);
+	std::string memoryReport(void);
+
+	void setMemoryBudget(MemoryCategory category, uint64_t bytes);
+	uint64_t getMemoryBudget(MemoryCategory category);
+
+	std::string memoryCategoryName(MemoryCategory category);
+
+}
+
+namespace Private {
+
+	void trackMemory(Util::MemoryCategory category, int64_t deltaBytes);
+
+	/*! The part of the memory use of a category that belongs to one object. Objects that own tracked
+	memory hold one of these and call set() or add() when the amount of memory that they own changes. The
+	bytes are counted for a copy of the object as well, moved out of an object that is moved from, and
+	subtracted when the object is destroyed. Copying or moving the owning object does not need any special
+	handling because these are copied or moved along with it. */
+	template <Util::MemoryCategory C>
+	class CX_TrackedBytes {
+	public:
+		CX_TrackedBytes(void) :
+			_bytes(0)
+		{}
+
+		CX_TrackedBytes(const CX_TrackedBytes& other) :
+			_bytes(0)
+		{
+			set(other.get());
+		}
+
+		CX_TrackedBytes(CX_TrackedBytes&& other) :
+			_bytes(other._bytes.exchange(0))
+		{}
+
+		~CX_TrackedBytes(void) {
+			set(0);
+		}
+
+		CX_TrackedBytes& operator=(const CX_TrackedBytes& other) {
+			if (this != &other) {
+				set(other.get());
+			}
+			return *this;
+		}
+
+		CX_TrackedBytes& operator=(CX_TrackedBytes&& other) {
+			if (this != &other) {
+				set(0);
+				_bytes = other._bytes.exchange(0);
+			}
+			return *this;
+		}
+
+		void set(uint64_t bytes) {
+			uint64_t previous = _bytes.exchange(bytes);
+			if (bytes != previous) {
+				trackMemory(C, (int64_t)bytes - (int64_t)previous);
+			}
+		}
+
+		void add(int64_t deltaBytes) {
+			if (deltaBytes != 0) {
+				_bytes += deltaBytes;
+				trackMemory(C, deltaBytes);
+			}
+		}
+
+		uint64_t get(void) const {
+			return _bytes.load();
+		}
+
+	private:
+		std::atomic<uint64_t> _bytes;
+	};
+
+}
+}
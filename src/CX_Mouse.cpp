@@ -1,6 +1,7 @@
 #include "CX_Mouse.h"
 
 #include "CX_InputManager.h"
+#include "CX_Logger.h"
 
 #include "GLFW/glfw3.h"
 #include "CX_Private.h"
@@ -8,15 +9,21 @@
 
 namespace CX {
 
+CX_Mouse* CX_Mouse::_rawMotionMouse = nullptr;
+void (*CX_Mouse::_previousCursorPosCallback)(GLFWwindow*, double, double) = nullptr;
+
 CX_Mouse::CX_Mouse(CX_InputManager* owner) :
 	_owner(owner),
 	_enabled(false),
+	_mouseEvents(16384),
 	_listeningForEvents(false),
-	_cursorPos(ofPoint(0,0))
+	_cursorPos(ofPoint(0,0)),
+	_rawMotion(false)
 {
 }
 
 CX_Mouse::~CX_Mouse(void) {
+	setRawMotion(false);
 	_listenForEvents(false);
 }
 
@@ -68,13 +75,61 @@ void CX_Mouse::clearEvents(void) {
 /*! \brief Return a vector containing a copy of the currently stored events. The events stored by
 the input device are unchanged. The first element of the vector is the oldest event. */
 std::vector<CX_Mouse::Event> CX_Mouse::copyEvents(void) {
-	std::vector<CX_Mouse::Event> copy(_mouseEvents.size());
-	for (unsigned int i = 0; i < _mouseEvents.size(); i++) {
-		copy[i] = _mouseEvents.at(i);
-	}
+	std::vector<CX_Mouse::Event> copy;
+	_mouseEvents.copyTo(copy);
 	return copy;
 }
 
+/*! Returns the stored events without copying them. The first event is the oldest.
+The events can be iterated over or filtered with CX_InputEventBuffer::filter().
+The reference is valid for as long as the mouse exists, but the events in it change
+when events are polled, read, or cleared. */
+const CX_InputEventBuffer<CX_Mouse::Event>& CX_Mouse::getEvents(void) const {
+	return _mouseEvents;
+}
+
+/*! Returns a view of the stored events of the given type, without copying them.
+\code{.cpp}
+for (const CX_Mouse::Event& ev : Input.Mouse.getEventsOfType(CX_Mouse::MOVED)) {
+	trajectory.push_back(ofPoint(ev.x, ev.y));
+}
+\endcode */
+CX_Mouse::FilteredEvents CX_Mouse::getEventsOfType(EventType type) const {
+	EventFilter filter;
+	filter.button = -1;
+	filter.type = type;
+	return _mouseEvents.filter(filter);
+}
+
+/*! Returns a view of the stored events for the given button, without copying them.
+\param button The button, like in CX_Mouse::Event::button.
+\param type The CX_Mouse::EventType of the events, or -1 for events of all types. */
+CX_Mouse::FilteredEvents CX_Mouse::getEventsForButton(int button, int type) const {
+	EventFilter filter;
+	filter.button = button;
+	filter.type = type;
+	return _mouseEvents.filter(filter);
+}
+
+/*! Sets the number of events that the mouse can store. When the mouse has stored this many
+events, each new event overwrites the oldest stored event and the overflow count (see getOverflowCount())
+is incremented. The capacity is rounded up to a power of 2. The default is 16384 events, which is
+a few minutes of continuous mouse movement on most systems.
+\param capacity The number of events. */
+void CX_Mouse::setEventCapacity(size_t capacity) {
+	_mouseEvents.setCapacity(capacity);
+}
+
+/*! Returns the number of events that the mouse can store. See setEventCapacity(). */
+size_t CX_Mouse::getEventCapacity(void) const {
+	return _mouseEvents.capacity();
+}
+
+/*! Returns the number of events that were lost because the mouse had stored as many events as it could. */
+uint64_t CX_Mouse::getOverflowCount(void) const {
+	return _mouseEvents.getOverflowCount();
+}
+
 /*!
 Sets the position of the cursor, relative to the program the window. The window must be focused.
 \param pos The location within the window to set the cursor.
@@ -155,16 +210,17 @@ CX_Mouse::Event CX_Mouse::waitForButtonPress(std::vector<int> buttons, bool clea
 			continue;
 		}
 
-		for (auto it = _mouseEvents.begin(); it != _mouseEvents.end(); it++) {
-			if (it->type == CX_Mouse::PRESSED) {
+		for (size_t i = 0; i < _mouseEvents.size(); i++) {
+			const CX_Mouse::Event& ev = _mouseEvents[i];
+			if (ev.type == CX_Mouse::PRESSED) {
 
-				bool buttonFound = std::find(buttons.begin(), buttons.end(), it->button) != buttons.end();
+				bool buttonFound = std::find(buttons.begin(), buttons.end(), ev.button) != buttons.end();
 
 				if (minus1Found || buttonFound) {
-					rval = *it;
+					rval = ev;
 
 					if (eraseEvent) {
-						_mouseEvents.erase(it);
+						_mouseEvents.erase(i);
 					}
 
 					waiting = false;
@@ -200,7 +256,156 @@ void CX_Mouse::appendEvent(CX_Mouse::Event ev) {
 		_heldButtons.erase(ev.button);
 	}
 
-	_mouseEvents.push_back(ev);
+	_storeEvent(ev);
+}
+
+void CX_Mouse::_storeEvent(const CX_Mouse::Event& ev) {
+	if (_mouseEvents.push_back(ev) && _mouseEvents.getOverflowCount() == 1) {
+		CX::Instances::Log.warning("CX_Mouse") << "More mouse events were stored than fit in the event buffer (" <<
+			_mouseEvents.capacity() << " events), so the oldest events are being overwritten. Read or clear events more often or use setEventCapacity().";
+	}
+
+	CX_Mouse::Event listenerCopy = ev;
+	ofNotifyEvent(eventStored, listenerCopy);
+}
+
+/*! Turns raw motion mode on or off. Raw motion mode is meant for tasks in which the movement of the mouse is tracked
+continuously, like motor control tasks. While it is on:
+
++ The cursor is hidden and is not bounded by the window, so the mouse can be moved as far as needed in any direction.
++ If the system supports it (see isRawMotionSupported()), the movement of the mouse is not changed by the mouse
+acceleration (pointer speed) settings of the operating system.
++ Every cursor position that is received from the system is recorded in a Trajectory, which can be
+collected with pullTrajectory(), usually once per frame. This is much cheaper than storing a CX_Mouse::Event for each
+position, so CX_Mouse::MOVED and CX_Mouse::DRAGGED events are not stored. Button presses, releases, and scrolling are
+stored as events as usual.
+
+The positions are received from the system when events are polled with CX_InputManager::pollEvents(), so
+each position is timestamped when it is received. If events are polled less often than the mouse reports
+its position, several positions can have nearly the same timestamp. Poll often for the most accurate timing.
+
+\param raw If `true`, raw motion mode is turned on. If `false`, it is turned off and the cursor is shown again.
+\param trajectoryCapacity The number of samples to make room for in the trajectory buffer. The trajectory
+can hold more samples than this, but storing more samples than this between calls to pullTrajectory() makes it allocate memory.
+\return `true` if raw motion mode is on and the movement of the mouse is not changed by mouse acceleration.
+`false` if raw motion mode is off or if the system does not support unaccelerated motion, in which case the
+positions are still recorded but include mouse acceleration.
+
+\note Only one CX_Mouse can be in raw motion mode at a time. This should be called from the main thread
+after the display has been set up. */
+bool CX_Mouse::setRawMotion(bool raw, size_t trajectoryCapacity) {
+	GLFWwindow* window = CX::Private::glfwContext;
+
+	if (raw && window == nullptr) {
+		CX::Instances::Log.error("CX_Mouse") << "setRawMotion(): Raw motion could not be turned on because there is no window.";
+		return false;
+	}
+
+	if (raw) {
+		_trajectory.x.reserve(trajectoryCapacity);
+		_trajectory.y.reserve(trajectoryCapacity);
+		_trajectory.time.reserve(trajectoryCapacity);
+	}
+
+	if (raw == _rawMotion) {
+		return raw && isRawMotionSupported();
+	}
+
+	if (raw) {
+		if (_rawMotionMouse != nullptr) {
+			_rawMotionMouse->setRawMotion(false);
+		}
+
+		_trajectory.clear();
+		_rawMotionMouse = this;
+		_previousCursorPosCallback = glfwSetCursorPosCallback(window, &CX_Mouse::_rawCursorPosCallback);
+
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+#ifdef GLFW_RAW_MOUSE_MOTION
+		if (isRawMotionSupported()) {
+			glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+		}
+#endif
+	} else {
+		if (window != nullptr) {
+#ifdef GLFW_RAW_MOUSE_MOTION
+			if (isRawMotionSupported()) {
+				glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_FALSE);
+			}
+#endif
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+			glfwSetCursorPosCallback(window, _previousCursorPosCallback);
+		}
+
+		_previousCursorPosCallback = nullptr;
+		_rawMotionMouse = nullptr;
+	}
+
+	_rawMotion = raw;
+
+	if (raw && !isRawMotionSupported()) {
+		CX::Instances::Log.warning("CX_Mouse") << "setRawMotion(): Unaccelerated mouse motion is not supported on this system, "
+			"so the recorded movement of the mouse includes mouse acceleration.";
+		return false;
+	}
+	return raw;
+}
+
+/*! Returns `true` if raw motion mode is on. See setRawMotion(). */
+bool CX_Mouse::isRawMotionEnabled(void) const {
+	return _rawMotion;
+}
+
+/*! Returns `true` if the system can give mouse movement that is not changed by mouse acceleration.
+This requires GLFW 3.3 or newer and support from the operating system. */
+bool CX_Mouse::isRawMotionSupported(void) {
+#ifdef GLFW_RAW_MOUSE_MOTION
+	return glfwRawMouseMotionSupported() == GLFW_TRUE;
+#else
+	return false;
+#endif
+}
+
+/*! Moves the samples that have been recorded in raw motion mode into `trajectory`, replacing its contents.
+The samples are removed from the mouse. Memory is swapped, not copied, so if the same Trajectory is used
+each time this is called, no memory is allocated once the arrays have grown to fit the samples of one call.
+
+\code{.cpp}
+Input.Mouse.setRawMotion(true);
+
+CX_Mouse::Trajectory trajectory;
+while (tracking) {
+	Input.pollEvents();
+	Input.Mouse.pullTrajectory(&trajectory);
+	for (size_t i = 0; i < trajectory.size(); i++) {
+		//Use trajectory.x[i], trajectory.y[i], and trajectory.time[i]...
+	}
+	//Draw the frame...
+}
+\endcode
+\param trajectory A pointer to the Trajectory to fill. */
+void CX_Mouse::pullTrajectory(Trajectory* trajectory) {
+	trajectory->clear();
+	std::swap(*trajectory, _trajectory);
+}
+
+void CX_Mouse::_rawCursorPosCallback(GLFWwindow* window, double x, double y) {
+	CX_Mouse* mouse = _rawMotionMouse;
+	if (mouse != nullptr) {
+		float fy = (float)y;
+		if (CX::Instances::Disp.getYIncreasesUpwards()) {
+			fy = CX::Instances::Disp.getResolution().y - fy;
+		}
+
+		mouse->_trajectory.x.push_back((float)x);
+		mouse->_trajectory.y.push_back(fy);
+		mouse->_trajectory.time.push_back(CX::Instances::Clock.now());
+	}
+
+	//openFrameworks still needs to know where the cursor is.
+	if (_previousCursorPosCallback != nullptr) {
+		_previousCursorPosCallback(window, x, y);
+	}
 }
 
 //As of oF 084 (at least), the type of the event is properly marked by oF, so these functions are depreciated once oF 080 support is dropped.
@@ -237,7 +442,7 @@ void CX_Mouse::_mouseWheelScrollHandler(ofMouseEventArgs &a) {
 	ev.x = a.scrollX;
 	ev.y = a.scrollY;
 
-	_mouseEvents.push_back(ev);
+	_storeEvent(ev);
 }
 #else
 void CX_Mouse::_mouseWheelScrollHandler(Private::CX_MouseScrollEventArgs_t &a) {
@@ -252,7 +457,7 @@ void CX_Mouse::_mouseWheelScrollHandler(Private::CX_MouseScrollEventArgs_t &a) {
 	ev.x = a.x;
 	ev.y = a.y;
 
-	_mouseEvents.push_back(ev);
+	_storeEvent(ev);
 }
 #endif
 
@@ -295,7 +500,11 @@ void CX_Mouse::_mouseEventHandler(ofMouseEventArgs &ofEvent) {
 		return; //This function should not be getting this event.
 	}
 
-	_mouseEvents.push_back(ev);
+	if (_rawMotion && (ev.type == CX_Mouse::MOVED || ev.type == CX_Mouse::DRAGGED)) {
+		return; //The positions are in the trajectory.
+	}
+
+	_storeEvent(ev);
 }
 
 void CX_Mouse::_listenForEvents(bool listen) {
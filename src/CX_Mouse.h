@@ -1,20 +1,26 @@
 #pragma once
 
-#include <deque>
 #include <set>
 
 #include "CX_Clock.h"
 #include "CX_Events.h"
+#include "CX_InputEventBuffer.h"
 #include "CX_Utilities.h"
 
 #include "ofEvents.h"
 
+struct GLFWwindow;
+
 namespace CX {
 
     class CX_InputManager;
 
 	/*! This class is responsible for managing the mouse. You should not need to create an instance of this class:
 	use the instance of CX_Mouse within CX::Instances::Input instead.
+
+	Mouse events are delivered by GLFW on the main thread while CX_InputManager::pollEvents() is running. They are
+	timestamped there and stored directly in the event buffer, so their timestamps depend on how often pollEvents() is called.
+	They are not sampled by CX_InputManager::startPollingThread().
 	\ingroup inputDevices */
 	class CX_Mouse {
 	public:
@@ -62,6 +68,43 @@ namespace CX {
 			EventType type; //!< The type of the event.
 		};
 
+		/*! Selects events by button and type for getEventsOfType() and getEventsForButton(). A value of -1 matches any button or type. */
+		struct EventFilter {
+			int button; //!< The button to match, or -1 for any button.
+			int type; //!< The CX_Mouse::EventType to match, or -1 for any type.
+
+			bool operator()(const CX_Mouse::Event& ev) const {
+				return (button == -1 || ev.button == button) && (type == -1 || ev.type == type);
+			}
+		};
+
+		/*! A view of the stored events that match an EventFilter. See CX_InputEventBuffer::FilteredView. */
+		typedef CX_InputEventBuffer<CX_Mouse::Event>::FilteredView<EventFilter> FilteredEvents;
+
+		/*! The cursor positions that were recorded while raw motion was enabled (see setRawMotion()), stored as
+		one array per value. Element `i` of each array belongs to the same sample. The positions are in the same
+		coordinates as CX_Mouse::Event::x and CX_Mouse::Event::y, but because the cursor is not bounded by the
+		window while raw motion is enabled, they can be outside of the window. The movement of the mouse
+		between two samples is the difference between their positions. */
+		struct Trajectory {
+			std::vector<float> x; //!< The x positions.
+			std::vector<float> y; //!< The y positions.
+			std::vector<CX_Millis> time; //!< The times at which the positions were received.
+
+			/*! Returns the number of samples. */
+			size_t size(void) const { return time.size(); }
+
+			/*! Returns `true` if there are no samples. */
+			bool empty(void) const { return time.empty(); }
+
+			/*! Removes all of the samples without freeing the memory used by the arrays. */
+			void clear(void) {
+				x.clear();
+				y.clear();
+				time.clear();
+			}
+		};
+
 		// Private constructor
 		~CX_Mouse (void);
 
@@ -74,6 +117,14 @@ namespace CX {
 		std::vector<CX_Mouse::Event> copyEvents(void);
 		void clearEvents(void);
 
+		const CX_InputEventBuffer<CX_Mouse::Event>& getEvents(void) const;
+		FilteredEvents getEventsOfType(EventType type) const;
+		FilteredEvents getEventsForButton(int button, int type = -1) const;
+
+		void setEventCapacity(size_t capacity);
+		size_t getEventCapacity(void) const;
+		uint64_t getOverflowCount(void) const;
+
 		void showCursor(bool show);
 		void setCursorPosition(ofPoint pos);
 		ofPoint getCursorPosition(void);
@@ -84,6 +135,15 @@ namespace CX {
 
 		void appendEvent(CX_Mouse::Event ev);
 
+		/*! This event is triggered every time a mouse event is stored, including events added with appendEvent(), so that
+		events can be forwarded as they happen (e.g. by a CX_MarkerStream) without reading them out of the event buffer. */
+		ofEvent<CX_Mouse::Event> eventStored;
+
+		bool setRawMotion(bool raw, size_t trajectoryCapacity = 8192);
+		bool isRawMotionEnabled(void) const;
+		static bool isRawMotionSupported(void);
+		void pullTrajectory(Trajectory* trajectory);
+
 	private:
 		friend class CX_InputManager; //So that CX_InputManager can set _lastEventPollTime
 
@@ -93,7 +153,8 @@ namespace CX {
 		CX_Millis _lastEventPollTime;
 
 		std::set<int> _heldButtons;
-		std::deque<CX_Mouse::Event> _mouseEvents;
+		CX_InputEventBuffer<CX_Mouse::Event> _mouseEvents;
+		void _storeEvent(const CX_Mouse::Event& ev);
 
 		void _mouseButtonPressedEventHandler (ofMouseEventArgs &a);
 		void _mouseButtonReleasedEventHandler (ofMouseEventArgs &a);
@@ -113,6 +174,13 @@ namespace CX {
 
 		ofPoint _cursorPos;
 
+		bool _rawMotion;
+		Trajectory _trajectory;
+
+		static CX_Mouse* _rawMotionMouse;
+		static void (*_previousCursorPosCallback)(GLFWwindow*, double, double);
+		static void _rawCursorPosCallback(GLFWwindow* window, double x, double y);
+
 	};
 
 	std::ostream& operator<< (std::ostream& os, const CX_Mouse::Event& ev);
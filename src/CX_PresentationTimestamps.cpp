@@ -0,0 +1,202 @@
+#include "CX_PresentationTimestamps.h"
+
+#include <cmath>
+
+#include "CX_Private.h"
+
+#if defined(TARGET_LINUX) && !defined(TARGET_OPENGLES)
+	#define CX_PRESENTATION_TIMESTAMPS_GLX
+	#define GLFW_EXPOSE_NATIVE_X11
+	#define GLFW_EXPOSE_NATIVE_GLX
+	#include "GLFW/glfw3native.h"
+	#include <time.h>
+#elif defined(TARGET_WIN32)
+	#define CX_PRESENTATION_TIMESTAMPS_DWM
+	#include <dwmapi.h>
+	#ifdef _MSC_VER
+		#pragma comment(lib, "dwmapi.lib")
+	#endif
+#endif
+
+namespace CX {
+namespace Private {
+
+#ifdef CX_PRESENTATION_TIMESTAMPS_GLX
+typedef Bool (*CX_PFNGLXWAITFORSBCOMLPROC)(Display* dpy, GLXDrawable drawable, int64_t target_sbc, int64_t* ust, int64_t* msc, int64_t* sbc);
+#endif
+
+//How many rejected timestamps in a row cause a fall back to CPU-side times.
+static const unsigned int maxConsecutiveRejections = 30;
+
+CX_PresentationTimestamps::CX_PresentationTimestamps(void) :
+	_available(Source::CPU),
+	_enabled(true),
+	_fellBack(false),
+	_consecutiveRejections(0),
+	_framePeriodNanos(0),
+	_x11Display(nullptr),
+	_glxDrawable(0),
+	_waitForSbc(nullptr)
+{}
+
+/*! Finds out which source of presentation timestamps can be used. Must be called from the thread on which
+the OpenGL context of `window` is current. */
+void CX_PresentationTimestamps::setup(GLFWwindow* window) {
+	_available = Source::CPU;
+
+#if defined(CX_PRESENTATION_TIMESTAMPS_GLX)
+	if (window != nullptr && glfwExtensionSupported("GLX_OML_sync_control")) {
+		_waitForSbc = (void*)glfwGetProcAddress("glXWaitForSbcOML");
+		_x11Display = glfwGetX11Display();
+#if GLFW_VERSION_MAJOR > 3 || (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR >= 2)
+		_glxDrawable = glfwGetGLXWindow(window);
+#else
+		_glxDrawable = glfwGetX11Window(window); //Older versions of GLFW draw directly into the X window.
+#endif
+		if (_waitForSbc != nullptr && _x11Display != nullptr && _glxDrawable != 0) {
+			_available = Source::GLX_OML_SYNC_CONTROL;
+		}
+	}
+#elif defined(CX_PRESENTATION_TIMESTAMPS_DWM)
+	(void)window;
+	BOOL compositionEnabled = FALSE;
+	if (SUCCEEDED(DwmIsCompositionEnabled(&compositionEnabled)) && compositionEnabled) {
+		_available = Source::DWM_TIMING;
+	}
+#else
+	(void)window;
+#endif
+
+	_fellBack = false;
+	_consecutiveRejections = 0;
+
+	CX::Instances::Log.verbose("CX_Display") << "Presentation timestamps are from " << sourceToString(_available) << ".";
+}
+
+/*! Sets whether presentation timestamps are used. If `false`, getSwapTime() returns the CPU-side time. Enabling
+presentation timestamps after they fell back to the CPU-side time tries them again. */
+void CX_PresentationTimestamps::setEnabled(bool enabled) {
+	_enabled = enabled;
+	if (enabled) {
+		_fellBack = false;
+		_consecutiveRejections = 0;
+	}
+}
+
+bool CX_PresentationTimestamps::isEnabled(void) const {
+	return _enabled;
+}
+
+/*! Returns the source of the times given by getSwapTime(). */
+CX_PresentationTimestamps::Source CX_PresentationTimestamps::getSource(void) const {
+	if (!_enabled || _fellBack) {
+		return Source::CPU;
+	}
+	return _available;
+}
+
+std::string CX_PresentationTimestamps::sourceToString(Source source) {
+	switch (source) {
+	case Source::GLX_OML_SYNC_CONTROL: return "GLX_OML_sync_control";
+	case Source::DWM_TIMING: return "DWM";
+	case Source::CPU: return "CPU";
+	}
+	return "CPU";
+}
+
+/*! Sets the frame period, which is used to reject timestamps that are too old. */
+void CX_PresentationTimestamps::setFramePeriod(CX_Millis framePeriod) {
+	_framePeriodNanos = framePeriod.nanos();
+}
+
+/*! Gets the time at which the swap that just completed was presented. This should be called right after
+the swap, from the thread that did the swap.
+\param cpuSwapTime The time at which the swap returned.
+\return The presentation time, or `cpuSwapTime` if the presentation time could not be found. */
+CX_Millis CX_PresentationTimestamps::getSwapTime(CX_Millis cpuSwapTime) {
+	if (getSource() == Source::CPU) {
+		return cpuSwapTime;
+	}
+
+	CX_Millis now = CX::Instances::Clock.now();
+
+	CX_Millis presentTime;
+	bool valid = _queryPresentTime(cpuSwapTime, &presentTime);
+
+	if (valid) {
+		int64_t periodNanos = _framePeriodNanos.load(std::memory_order_relaxed);
+		CX_Millis oldest = cpuSwapTime - ((periodNanos > 0) ? CX_Millis(CX_Nanos(2 * periodNanos)) : CX_Millis(100));
+		CX_Millis newest = now + ((periodNanos > 0) ? CX_Millis(CX_Nanos(periodNanos)) : CX_Millis(50));
+		valid = (presentTime >= oldest) && (presentTime <= newest);
+	}
+
+	if (valid) {
+		_consecutiveRejections = 0;
+		return presentTime;
+	}
+
+	if (++_consecutiveRejections >= maxConsecutiveRejections && !_fellBack.exchange(true)) {
+		CX::Instances::Log.warning("CX_Display") << "The presentation timestamps from " << sourceToString(_available) <<
+			" were not usable for " << maxConsecutiveRejections << " buffer swaps in a row. The times at which the swaps returned are used instead.";
+	}
+
+	return cpuSwapTime;
+}
+
+bool CX_PresentationTimestamps::_queryPresentTime(CX_Millis cpuSwapTime, CX_Millis* presentTime) {
+#if defined(CX_PRESENTATION_TIMESTAMPS_GLX)
+	if (_available == Source::GLX_OML_SYNC_CONTROL) {
+		int64_t ust = 0;
+		int64_t msc = 0;
+		int64_t sbc = 0;
+
+		//A target of 0 waits for the swaps that have been queued and gives the time at which the last one completed.
+		CX_PFNGLXWAITFORSBCOMLPROC waitForSbc = (CX_PFNGLXWAITFORSBCOMLPROC)_waitForSbc;
+		if (!waitForSbc((Display*)_x11Display, (GLXDrawable)_glxDrawable, 0, &ust, &msc, &sbc) || ust == 0) {
+			return false;
+		}
+
+		//The UST is in microseconds of CLOCK_MONOTONIC on Linux.
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		CX_Millis now = CX::Instances::Clock.now();
+		int64_t monotonicMicros = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+		*presentTime = now - CX_Micros(monotonicMicros - ust);
+		return true;
+	}
+#elif defined(CX_PRESENTATION_TIMESTAMPS_DWM)
+	if (_available == Source::DWM_TIMING) {
+		DWM_TIMING_INFO info;
+		ZeroMemory(&info, sizeof(info));
+		info.cbSize = sizeof(info);
+		if (FAILED(DwmGetCompositionTimingInfo(NULL, &info)) || info.qpcRefreshPeriod == 0) {
+			return false;
+		}
+
+		LARGE_INTEGER qpcNow;
+		LARGE_INTEGER qpcFrequency;
+		QueryPerformanceCounter(&qpcNow);
+		CX_Millis now = CX::Instances::Clock.now();
+		QueryPerformanceFrequency(&qpcFrequency);
+
+		double nanosPerTick = 1e9 / qpcFrequency.QuadPart;
+		CX_Millis lastVBlank = now - CX_Nanos((int64_t)((qpcNow.QuadPart - (int64_t)info.qpcVBlank) * nanosPerTick));
+		CX_Nanos refreshPeriod((int64_t)(info.qpcRefreshPeriod * nanosPerTick));
+
+		//The frame is shown at the first vertical blank after the swap completed.
+		CX_Millis vblank = lastVBlank;
+		if (vblank < cpuSwapTime) {
+			vblank = vblank + refreshPeriod * std::ceil((cpuSwapTime - vblank) / refreshPeriod);
+		}
+		*presentTime = vblank;
+		return true;
+	}
+#endif
+	(void)cpuSwapTime;
+	(void)presentTime;
+	return false;
+}
+
+}
+}
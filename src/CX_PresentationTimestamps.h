@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "CX_Clock.h"
+
+struct GLFWwindow;
+
+namespace CX {
+namespace Private {
+
+	/*! This class finds the time at which a buffer swap was actually presented on the display, using timing information
+	from the windowing system where it is available, rather than the time at which `glfwSwapBuffers()` returned. With
+	compositors and driver queues, the CPU-side time can be off by a whole frame.
+
+	The sources, in order of preference, are:
+	+ `GLX_OML_sync_control` (Linux, X11): `glXWaitForSbcOML()` gives the time at which the last swap completed.
+	+ The Desktop Window Manager (Windows): The CPU-side time is moved to the vertical blank at which the frame was
+	composed, using the vertical blank time and refresh period from `DwmGetCompositionTimingInfo()`.
+
+	Timestamps that are in the future or more than two frames old are rejected and the CPU-side time is used instead.
+	If many timestamps in a row are rejected, a warning is logged and the CPU-side time is used from then on.
+
+	This class is used internally by CX and should not be used directly. See CX_Display::usePresentationTimestamps().
+	*/
+	class CX_PresentationTimestamps {
+	public:
+
+		enum class Source {
+			CPU, //!< The time at which the swap returned, from CX::Instances::Clock.
+			GLX_OML_SYNC_CONTROL,
+			DWM_TIMING
+		};
+
+		CX_PresentationTimestamps(void);
+
+		void setup(GLFWwindow* window);
+
+		void setEnabled(bool enabled);
+		bool isEnabled(void) const;
+
+		Source getSource(void) const;
+		static std::string sourceToString(Source source);
+
+		void setFramePeriod(CX_Millis framePeriod);
+
+		CX_Millis getSwapTime(CX_Millis cpuSwapTime);
+
+	private:
+
+		Source _available;
+		std::atomic<bool> _enabled;
+		std::atomic<bool> _fellBack;
+		std::atomic<unsigned int> _consecutiveRejections;
+		std::atomic<int64_t> _framePeriodNanos;
+
+		//Native handles for GLX.
+		void* _x11Display;
+		unsigned long _glxDrawable;
+		void* _waitForSbc;
+
+		bool _queryPresentTime(CX_Millis cpuSwapTime, CX_Millis* presentTime);
+	};
+
+}
+}
@@ -4,6 +4,13 @@
 
 #include "CX_Mouse.h"
 
+#if defined(TARGET_LINUX) && !defined(TARGET_OPENGLES)
+	#define CX_SWAP_GROUPS_GLX
+	#define GLFW_EXPOSE_NATIVE_X11
+	#define GLFW_EXPOSE_NATIVE_GLX
+	#include "GLFW/glfw3native.h" //Includes GL/glx.h
+#endif
+
 namespace CX {
 namespace Private {
 
@@ -127,6 +134,60 @@ int stringToBooleint(std::string s) {
 	return -1;
 }
 
+#if defined(CX_SWAP_GROUPS_GLX)
+typedef Bool (*CX_PFNGLXJOINSWAPGROUPNVPROC)(Display* dpy, GLXDrawable drawable, GLuint group);
+typedef Bool (*CX_PFNGLXBINDSWAPBARRIERNVPROC)(Display* dpy, GLuint group, GLuint barrier);
+#elif defined(TARGET_WIN32)
+typedef BOOL (WINAPI *CX_PFNWGLJOINSWAPGROUPNVPROC)(HDC hDC, GLuint group);
+typedef BOOL (WINAPI *CX_PFNWGLBINDSWAPBARRIERNVPROC)(GLuint group, GLuint barrier);
+#endif
+
+/* Returns `true` if the context that is current on the calling thread supports NV_swap_group, with which the buffer
+swaps of several windows (and, with a swap barrier, several video cards) happen together. */
+bool swapGroupsSupported(void) {
+#if defined(CX_SWAP_GROUPS_GLX)
+	return glfwExtensionSupported("GLX_NV_swap_group") == GL_TRUE;
+#elif defined(TARGET_WIN32)
+	return glfwExtensionSupported("WGL_NV_swap_group") == GL_TRUE;
+#else
+	return false;
+#endif
+}
+
+/* Adds the window of the context that is current on the calling thread to a swap group, which is bound to swap barrier 1
+so that swap groups on other video cards in the same frame lock system are synchronized as well. Windows in the same
+group swap together. Group 0 removes the window from its group. Returns `false` if swap groups are not supported. */
+bool joinSwapGroup(unsigned int group) {
+	if (!swapGroupsSupported()) {
+		return false;
+	}
+
+#if defined(CX_SWAP_GROUPS_GLX)
+	CX_PFNGLXJOINSWAPGROUPNVPROC joinGroup = (CX_PFNGLXJOINSWAPGROUPNVPROC)glfwGetProcAddress("glXJoinSwapGroupNV");
+	CX_PFNGLXBINDSWAPBARRIERNVPROC bindBarrier = (CX_PFNGLXBINDSWAPBARRIERNVPROC)glfwGetProcAddress("glXBindSwapBarrierNV");
+	if (joinGroup == nullptr || !joinGroup(glXGetCurrentDisplay(), glXGetCurrentDrawable(), group)) {
+		return false;
+	}
+	if (bindBarrier != nullptr && group != 0) {
+		bindBarrier(glXGetCurrentDisplay(), group, 1); //Fails without a frame lock board, which is fine on a single video card.
+	}
+	return true;
+#elif defined(TARGET_WIN32)
+	CX_PFNWGLJOINSWAPGROUPNVPROC joinGroup = (CX_PFNWGLJOINSWAPGROUPNVPROC)glfwGetProcAddress("wglJoinSwapGroupNV");
+	CX_PFNWGLBINDSWAPBARRIERNVPROC bindBarrier = (CX_PFNWGLBINDSWAPBARRIERNVPROC)glfwGetProcAddress("wglBindSwapBarrierNV");
+	if (joinGroup == nullptr || !joinGroup(wglGetCurrentDC(), group)) {
+		return false;
+	}
+	if (bindBarrier != nullptr && group != 0) {
+		bindBarrier(group, 1); //Fails without a frame lock board, which is fine on a single video card.
+	}
+	return true;
+#else
+	(void)group;
+	return false;
+#endif
+}
+
 #ifdef TARGET_WIN32
 namespace Windows {
 	std::string convertErrorCodeToString(DWORD errorCode) {
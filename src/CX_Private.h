@@ -62,6 +62,9 @@ namespace Private {
 
 	int stringToBooleint(std::string s);
 
+	bool swapGroupsSupported(void);
+	bool joinSwapGroup(unsigned int group);
+
 #ifdef TARGET_WIN32
 	namespace Windows {
 		std::string convertErrorCodeToString(DWORD errorCode);
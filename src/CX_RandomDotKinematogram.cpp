@@ -0,0 +1,413 @@
+#include "CX_RandomDotKinematogram.h"
+
+#include "CX_Logger.h"
+#include "CX_Utilities.h"
+
+#define STRINGIFY(x) #x
+
+//----------
+// Hash-based random numbers shared by the shaders. Each dot has a 32-bit seed and the values for a dot
+// are made by hashing its seed with a small key, so no random state has to be stored between steps.
+static std::string rdkRandom = STRINGIFY(
+const float PI = 3.14159265358979323846;
+
+uint hash(uint x) {
+	x ^= x >> 16u;
+	x *= 0x7feb352du;
+	x ^= x >> 15u;
+	x *= 0x846ca68bu;
+	x ^= x >> 16u;
+	return x;
+}
+
+float random(uint seed, uint key) {
+	return float(hash(seed ^ hash(key))) * (1.0 / 4294967296.0);
+}
+);
+
+//----------
+// Moves each dot one step. Nothing is drawn: the new state of each dot is captured with transform feedback.
+static std::string rdkUpdateVert = "#version 150\n" + rdkRandom + STRINGIFY(
+
+uniform int seed;
+uniform int stepIndex;
+uniform vec2 velocity; // of the signal dots, in pixels per step
+uniform float speed;
+uniform float coherence;
+uniform int lifetime; // 0 means that dots are never replotted
+uniform int noiseType; // 0: random position, 1: random direction, 2: random walk
+uniform int aperture; // 0: circle, 1: square
+uniform float apertureRadius;
+
+in vec3 state; // x, y, age
+in uint dotSeed;
+
+out vec3 outState;
+flat out uint outSeed;
+
+vec2 randomPoint(uint s) {
+	if (aperture == 1) {
+		return (vec2(random(s, 1u), random(s, 2u)) * 2.0 - 1.0) * apertureRadius;
+	}
+	float r = apertureRadius * sqrt(random(s, 1u));
+	float a = 2.0 * PI * random(s, 2u);
+	return r * vec2(cos(a), sin(a));
+}
+
+void main() {
+	vec2 p = state.xy;
+	float age = state.z + 1.0;
+	uint s = dotSeed;
+	uint stepSeed = hash(uint(seed) ^ hash(uint(stepIndex)));
+
+	outSeed = s;
+
+	if (lifetime > 0 && age >= float(lifetime)) {
+		outSeed = hash(s ^ stepSeed);
+		outState = vec3(randomPoint(outSeed), 0.0);
+		return;
+	}
+
+	vec2 v = velocity;
+	if (random(s, 3u) >= coherence) {
+		if (noiseType == 0) {
+			outState = vec3(randomPoint(hash(s ^ stepSeed)), age);
+			return;
+		}
+		float a = 2.0 * PI * ((noiseType == 1) ? random(s, 4u) : random(hash(s ^ stepSeed), 4u));
+		v = speed * vec2(cos(a), sin(a));
+	}
+
+	p += v;
+
+	if (aperture == 1) {
+		p = mod(p + apertureRadius, 2.0 * apertureRadius) - apertureRadius;
+	} else if (dot(p, p) > apertureRadius * apertureRadius && dot(v, v) > 0.0) {
+		// Move the dot back along its line of motion to where that line enters the aperture, then forward by
+		// as far as it went past the edge, so it comes in on the opposite side. The overshoot is kept between
+		// 0 and the chord, so the dot always ends up strictly inside. Dots that only graze the edge are replotted.
+		vec2 d = normalize(v);
+		vec2 h = p - dot(p, d) * d; // The closest point to the center on the line of motion.
+		float r2 = apertureRadius * apertureRadius;
+		float hh = dot(h, h);
+		if (hh >= 0.999 * r2) {
+			p = randomPoint(hash(s ^ stepSeed));
+		} else {
+			float halfChord = sqrt(r2 - hh);
+			float overshoot = clamp(abs(dot(p, d)) - halfChord, 0.001 * halfChord, 1.999 * halfChord);
+			p = h + (overshoot - halfChord) * d;
+		}
+	}
+
+	outState = vec3(p, age);
+}
+);
+
+//----------
+// Draws each dot as a point sprite. Dots are always put back inside the aperture when they wrap, but any dot that is
+// outside of it (e.g. from rounding at the edge) is moved out of clip space.
+static std::string rdkDrawVert = "#version 150\n" STRINGIFY(
+uniform mat4 modelViewProjectionMatrix;
+
+uniform vec2 center;
+uniform float pointSize;
+uniform int aperture;
+uniform float apertureRadius;
+
+in vec3 state;
+
+void main() {
+	vec2 p = state.xy;
+	bool outside = (aperture == 1) ? any(greaterThan(abs(p), vec2(apertureRadius))) : (dot(p, p) > apertureRadius * apertureRadius);
+
+	gl_PointSize = pointSize;
+	gl_Position = outside ? vec4(2.0, 2.0, 2.0, 1.0) : modelViewProjectionMatrix * vec4(center + p, 0.0, 1.0);
+}
+);
+
+static std::string rdkDrawFrag = "#version 150\n" STRINGIFY(
+uniform vec4 dotColor;
+uniform int roundDots;
+
+out vec4 outputColor;
+
+void main() {
+	vec2 c = gl_PointCoord * 2.0 - 1.0;
+	if (roundDots == 1 && dot(c, c) > 1.0) {
+		discard;
+	}
+	outputColor = dotColor;
+}
+);
+
+namespace CX {
+namespace Draw {
+
+//Vertex attribute locations used by RandomDotKinematogram.
+static const int rdkStateLocation = 0;
+static const int rdkSeedLocation = 1;
+
+//The same hash as in the shaders, so that the initial state is made the same way as the state of replotted dots.
+static uint32_t rdkHash(uint32_t x) {
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+static float rdkRandom(uint32_t seed, uint32_t key) {
+	return (float)(rdkHash(seed ^ rdkHash(key)) * (1.0 / 4294967296.0));
+}
+
+RandomDotKinematogram::RandomDotKinematogram(void) :
+	center(0, 0),
+	coherence(0.5),
+	direction(0),
+	speed(2),
+	dotSize(3),
+	roundDots(true),
+	dotColor(1, 1, 1, 1),
+	_current(0),
+	_seed(0),
+	_updateCount(0)
+{
+	_buffers[0] = _buffers[1] = 0;
+	_vaos[0] = _vaos[1] = 0;
+}
+
+RandomDotKinematogram::~RandomDotKinematogram(void) {
+	_deleteBuffers();
+}
+
+/*! Sets up the kinematogram. This compiles the shaders and makes the buffers on the video card that hold the
+dots, so it is potentially blocking. It must be called from the thread that has the OpenGL context.
+
+\param config The configuration of the kinematogram.
+\param rng The random number generator that the initial positions and ages of the dots and the seed of the
+random values on the video card are taken from.
+\return `false` if the programmable renderer is not in use or the shaders could not be compiled, `true` otherwise.
+*/
+bool RandomDotKinematogram::setup(const Configuration& config, CX_RandomNumberGenerator& rng) {
+	_deleteBuffers();
+	_config = config;
+
+	if (!ofIsGLProgrammableRenderer()) {
+		CX::Instances::Log.error("RandomDotKinematogram") << "setup(): RandomDotKinematogram requires the programmable renderer (OpenGL 3.2 or later).";
+		return false;
+	}
+
+	if (!_setupShaders()) {
+		CX::Instances::Log.error("RandomDotKinematogram") << "setup(): The shaders could not be compiled.";
+		return false;
+	}
+
+	glGenBuffers(2, _buffers);
+	glGenVertexArrays(2, _vaos);
+
+	for (int i = 0; i < 2; i++) {
+		glBindVertexArray(_vaos[i]);
+		glBindBuffer(GL_ARRAY_BUFFER, _buffers[i]);
+		glBufferData(GL_ARRAY_BUFFER, _config.dotCount * sizeof(DotState), nullptr, GL_DYNAMIC_COPY);
+
+		glEnableVertexAttribArray(rdkStateLocation);
+		glVertexAttribPointer(rdkStateLocation, 3, GL_FLOAT, GL_FALSE, sizeof(DotState), (const void*)offsetof(DotState, x));
+		glEnableVertexAttribArray(rdkSeedLocation);
+		glVertexAttribIPointer(rdkSeedLocation, 1, GL_UNSIGNED_INT, sizeof(DotState), (const void*)offsetof(DotState, seed));
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	reset(rng);
+
+	return true;
+}
+
+/*! Returns `true` if setup() was successful. */
+bool RandomDotKinematogram::isReady(void) const {
+	return _vaos[0] != 0;
+}
+
+/*! Returns the configuration that was given to setup(). */
+const RandomDotKinematogram::Configuration& RandomDotKinematogram::getConfiguration(void) const {
+	return _config;
+}
+
+/*! Replots all of the dots at new random locations with new random ages and takes a new seed for the random values
+on the video card. This is how a new trial is started without setting up the kinematogram again.
+\param rng The random number generator to take the positions, ages, and seed from. */
+void RandomDotKinematogram::reset(CX_RandomNumberGenerator& rng) {
+	if (!isReady()) {
+		CX::Instances::Log.error("RandomDotKinematogram") << "reset(): setup() must be called before the dots can be reset.";
+		return;
+	}
+
+	_seed = (uint32_t)rng.randomInt(0, 0xFFFFFFFF);
+	_updateCount = 0;
+	_current = 0;
+
+	std::vector<DotState> dots = _makeInitialState(rng);
+
+	glBindBuffer(GL_ARRAY_BUFFER, _buffers[_current]);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, dots.size() * sizeof(DotState), dots.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/*! Moves all of the dots one step. This is usually called once per frame, before draw(). */
+void RandomDotKinematogram::update(void) {
+	update(1);
+}
+
+/*! Moves all of the dots a number of steps.
+\param steps The number of steps. */
+void RandomDotKinematogram::update(unsigned int steps) {
+	if (!isReady()) {
+		CX::Instances::Log.error("RandomDotKinematogram") << "update(): setup() must be called before the dots can be updated.";
+		return;
+	}
+
+	float radians = ofDegToRad(direction);
+
+	_updateShader.begin();
+
+	_updateShader.setUniform1i("seed", (int)_seed);
+	_updateShader.setUniform2f("velocity", speed * cos(radians), -speed * sin(radians)); //Screen y increases downward.
+	_updateShader.setUniform1f("speed", speed);
+	_updateShader.setUniform1f("coherence", CX::Util::clamp<float>(coherence, 0, 1));
+	_updateShader.setUniform1i("lifetime", (int)_config.lifetime);
+	_updateShader.setUniform1i("noiseType", (int)_config.noiseType);
+	_updateShader.setUniform1i("aperture", (int)_config.aperture);
+	_updateShader.setUniform1f("apertureRadius", _config.apertureRadius);
+
+	glEnable(GL_RASTERIZER_DISCARD);
+
+	for (unsigned int i = 0; i < steps; i++) {
+		_updateShader.setUniform1i("stepIndex", (int)(uint32_t)_updateCount);
+
+		unsigned int next = 1 - _current;
+		glBindVertexArray(_vaos[_current]);
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, _buffers[next]);
+
+		glBeginTransformFeedback(GL_POINTS);
+		glDrawArrays(GL_POINTS, 0, _config.dotCount);
+		glEndTransformFeedback();
+
+		_current = next;
+		_updateCount++;
+	}
+
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glBindVertexArray(0);
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	_updateShader.end();
+}
+
+/*! Returns the number of steps that the dots have been moved since setup() or reset(). */
+uint64_t RandomDotKinematogram::getUpdateCount(void) const {
+	return _updateCount;
+}
+
+/*! Draws all of the dots with one draw call. */
+void RandomDotKinematogram::draw(void) {
+	if (!isReady()) {
+		CX::Instances::Log.error("RandomDotKinematogram") << "draw(): setup() must be called before the dots can be drawn.";
+		return;
+	}
+
+	_drawShader.begin();
+
+	_drawShader.setUniform2f("center", center.x, center.y);
+	_drawShader.setUniform1f("pointSize", dotSize);
+	_drawShader.setUniform1i("aperture", (int)_config.aperture);
+	_drawShader.setUniform1f("apertureRadius", _config.apertureRadius);
+	_drawShader.setUniform4f("dotColor", dotColor.r, dotColor.g, dotColor.b, dotColor.a);
+	_drawShader.setUniform1i("roundDots", roundDots ? 1 : 0);
+
+	glEnable(GL_PROGRAM_POINT_SIZE);
+	glBindVertexArray(_vaos[_current]);
+	glDrawArrays(GL_POINTS, 0, _config.dotCount);
+	glBindVertexArray(0);
+	glDisable(GL_PROGRAM_POINT_SIZE);
+
+	_drawShader.end();
+}
+
+/*! Reads the current positions of the dots back from the video card. This waits for the video card to finish
+all of the updates that have been queued, so it is slow and should not be used while a stimulus is being presented.
+It is meant for checking or saving the stimulus.
+\return The positions of the dots, in the same coordinates as `center`. */
+std::vector<ofPoint> RandomDotKinematogram::getDotPositions(void) {
+	std::vector<ofPoint> rval;
+	if (!isReady()) {
+		CX::Instances::Log.error("RandomDotKinematogram") << "getDotPositions(): setup() must be called before the dot positions can be read.";
+		return rval;
+	}
+
+	std::vector<DotState> dots(_config.dotCount);
+	glBindBuffer(GL_ARRAY_BUFFER, _buffers[_current]);
+	glGetBufferSubData(GL_ARRAY_BUFFER, 0, dots.size() * sizeof(DotState), dots.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	rval.resize(dots.size());
+	for (size_t i = 0; i < dots.size(); i++) {
+		rval[i] = ofPoint(center.x + dots[i].x, center.y + dots[i].y);
+	}
+	return rval;
+}
+
+bool RandomDotKinematogram::_setupShaders(void) {
+	_updateShader.setupShaderFromSource(GL_VERTEX_SHADER, rdkUpdateVert);
+	_updateShader.bindAttribute(rdkStateLocation, "state");
+	_updateShader.bindAttribute(rdkSeedLocation, "dotSeed");
+
+	//The outputs that are captured must be chosen before the program is linked.
+	const char* varyings[2] = { "outState", "outSeed" };
+	glTransformFeedbackVaryings(_updateShader.getProgram(), 2, varyings, GL_INTERLEAVED_ATTRIBS);
+	_updateShader.linkProgram();
+
+	_drawShader.setupShaderFromSource(GL_VERTEX_SHADER, rdkDrawVert);
+	_drawShader.setupShaderFromSource(GL_FRAGMENT_SHADER, rdkDrawFrag);
+	_drawShader.bindAttribute(rdkStateLocation, "state");
+	_drawShader.linkProgram();
+
+	return _updateShader.isLoaded() && _drawShader.isLoaded();
+}
+
+void RandomDotKinematogram::_deleteBuffers(void) {
+	if (_vaos[0] != 0) {
+		glDeleteVertexArrays(2, _vaos);
+		glDeleteBuffers(2, _buffers);
+	}
+	_buffers[0] = _buffers[1] = 0;
+	_vaos[0] = _vaos[1] = 0;
+}
+
+std::vector<RandomDotKinematogram::DotState> RandomDotKinematogram::_makeInitialState(CX_RandomNumberGenerator& rng) {
+	std::vector<DotState> dots(_config.dotCount);
+	float r = _config.apertureRadius;
+
+	for (DotState& dot : dots) {
+		dot.seed = (uint32_t)rng.randomInt(0, 0xFFFFFFFF);
+
+		//The same distributions as randomPoint() in the update shader.
+		if (_config.aperture == Aperture::SQUARE) {
+			dot.x = (rdkRandom(dot.seed, 1) * 2 - 1) * r;
+			dot.y = (rdkRandom(dot.seed, 2) * 2 - 1) * r;
+		} else {
+			float dist = r * sqrt(rdkRandom(dot.seed, 1));
+			float angle = 2 * PI * rdkRandom(dot.seed, 2);
+			dot.x = dist * cos(angle);
+			dot.y = dist * sin(angle);
+		}
+
+		//Ages are staggered so that the dots are not all replotted on the same step.
+		dot.age = (_config.lifetime > 0) ? (float)rng.randomInt(0, _config.lifetime - 1) : 0;
+	}
+
+	return dots;
+}
+
+} //namespace Draw
+} //namespace CX
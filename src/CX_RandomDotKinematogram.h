@@ -0,0 +1,156 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "ofShader.h"
+#include "ofGraphics.h"
+
+#include "CX_RandomNumberGenerator.h"
+
+namespace CX {
+namespace Draw {
+
+/*! This class draws a random dot kinematogram (RDK) with the positions of the dots kept on the video card.
+Each call to update() moves every dot one step with a shader (using transform feedback), so the dot positions
+never have to be computed on the CPU or uploaded, and draw() draws all of the dots as point sprites with one
+draw call. Tens of thousands of dots can be updated and drawn every frame at high refresh rates.
+
+On each step, signal dots move `speed` pixels in `direction`. Which dots are signal dots is decided by
+`coherence`: each dot has a random value that is chosen when it is (re)born and the dot is a signal dot if
+that value is less than `coherence`. The noise dots move according to Configuration::noiseType. When a dot
+has lived for Configuration::lifetime steps, it is replotted at a random location in the aperture and gets
+new random values. Dots that leave the aperture wrap around to the other side of it.
+
+The initial positions and ages of the dots and the seed from which the random values on the video card are
+made are all taken from a CX_RandomNumberGenerator, so a kinematogram is reproducible from the seed of that
+generator and the number of times that update() has been called.
+
+This class requires the programmable renderer (OpenGL 3.2 or later).
+
+\code{.cpp}
+Draw::RandomDotKinematogram rdk;
+
+Draw::RandomDotKinematogram::Configuration config;
+config.dotCount = 5000;
+config.apertureRadius = 300;
+config.lifetime = 10;
+rdk.setup(config);
+
+rdk.center = Disp.getCenter();
+rdk.coherence = 0.3;
+rdk.direction = 90; //Upward
+rdk.speed = 4; //Pixels per update
+rdk.dotSize = 4;
+
+while (!Input.Keyboard.availableEvents()) {
+	rdk.update();
+
+	Disp.beginDrawingToBackBuffer();
+	ofBackground(0);
+	rdk.draw();
+	Disp.endDrawingToBackBuffer();
+	Disp.swapBuffers();
+
+	Input.pollEvents();
+}
+\endcode
+
+\ingroup video
+*/
+class RandomDotKinematogram {
+public:
+
+	/*! The shape of the area that the dots are in. */
+	enum class Aperture {
+		CIRCLE, //!< A circle with a radius of Configuration::apertureRadius.
+		SQUARE //!< A square with sides of twice Configuration::apertureRadius.
+	};
+
+	/*! How the dots that are not signal dots move. */
+	enum class NoiseType {
+		RANDOM_POSITION, //!< Noise dots are replotted at a random location in the aperture on each step.
+		RANDOM_DIRECTION, //!< Each noise dot moves at `speed` in a random direction that is fixed for its lifetime.
+		RANDOM_WALK //!< Noise dots move at `speed` in a new random direction on each step.
+	};
+
+	/*! The settings of a kinematogram that are fixed by setup(). */
+	struct Configuration {
+		Configuration(void) :
+			dotCount(1000),
+			aperture(Aperture::CIRCLE),
+			apertureRadius(200),
+			lifetime(0),
+			noiseType(NoiseType::RANDOM_DIRECTION)
+		{}
+
+		unsigned int dotCount; //!< The number of dots.
+		Aperture aperture; //!< The shape of the aperture.
+		float apertureRadius; //!< The radius of the aperture, in pixels. For a square aperture, this is half of the length of the sides.
+
+		/*! The number of steps that each dot lives for before it is replotted. If this is 0, dots are never replotted, so
+		the same dots are signal dots for as long as `coherence` does not change. */
+		unsigned int lifetime;
+
+		NoiseType noiseType; //!< How the noise dots move.
+	};
+
+	RandomDotKinematogram(void);
+	~RandomDotKinematogram(void);
+
+	RandomDotKinematogram(const RandomDotKinematogram&) = delete;
+	RandomDotKinematogram& operator=(const RandomDotKinematogram&) = delete;
+
+	bool setup(const Configuration& config, CX_RandomNumberGenerator& rng = CX::Instances::RNG);
+	bool isReady(void) const;
+	const Configuration& getConfiguration(void) const;
+
+	void reset(CX_RandomNumberGenerator& rng = CX::Instances::RNG);
+
+	void update(void);
+	void update(unsigned int steps);
+	uint64_t getUpdateCount(void) const;
+
+	void draw(void);
+
+	std::vector<ofPoint> getDotPositions(void);
+
+	ofPoint center; //!< The center of the aperture. The dots are stored relative to it, so it can be changed at any time.
+	float coherence; //!< The proportion of dots that are signal dots, in the interval [0,1].
+	float direction; //!< The direction of motion of the signal dots, in degrees. 0 is rightward and 90 is upward on the screen.
+	float speed; //!< The distance that each moving dot moves on each update(), in pixels.
+
+	/*! The diameter of the dots, in pixels. The largest size that can be drawn depends on the video card. */
+	float dotSize;
+	bool roundDots; //!< If `true`, the dots are circles. If `false`, they are squares.
+	ofFloatColor dotColor; //!< The color of the dots.
+
+private:
+
+	Configuration _config;
+
+	ofShader _updateShader;
+	ofShader _drawShader;
+
+	//The dot state is ping-ponged between two buffers: each update reads one and writes the other.
+	GLuint _buffers[2];
+	GLuint _vaos[2];
+	unsigned int _current;
+
+	uint32_t _seed;
+	uint64_t _updateCount;
+
+	struct DotState {
+		float x;
+		float y;
+		float age;
+		uint32_t seed;
+	};
+
+	bool _setupShaders(void);
+	void _deleteBuffers(void);
+	std::vector<DotState> _makeInitialState(CX_RandomNumberGenerator& rng);
+};
+
+} //namespace Draw
+} //namespace CX
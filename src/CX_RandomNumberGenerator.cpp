@@ -4,6 +4,93 @@
 
 namespace CX {
 
+/////////////////////
+// CX_Xoshiro256pp //
+/////////////////////
+
+/*! Seeds the generator. The 256 bits of state are filled from the seed with the SplitMix64 generator, as recommended
+by the authors of xoshiro, so that similar seeds give unrelated sequences. */
+void CX_Xoshiro256pp::seed(uint64_t seed) {
+	for (int i = 0; i < 4; i++) {
+		uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		_s[i] = z ^ (z >> 31);
+	}
+}
+
+/*! Advances the generator by 2^128 steps. This is the same as 2^128 calls to operator(), but takes about as long as 256 of them. */
+void CX_Xoshiro256pp::jump(void) {
+	static const uint64_t table[4] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+	_jump(table);
+}
+
+/*! Advances the generator by 2^192 steps. Streams made with longJump() can each be split with jump(). */
+void CX_Xoshiro256pp::longJump(void) {
+	static const uint64_t table[4] = { 0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL };
+	_jump(table);
+}
+
+void CX_Xoshiro256pp::_jump(const uint64_t (&table)[4]) {
+	uint64_t s[4] = { 0, 0, 0, 0 };
+	for (int i = 0; i < 4; i++) {
+		for (int b = 0; b < 64; b++) {
+			if (table[i] & ((uint64_t)1 << b)) {
+				for (int j = 0; j < 4; j++) {
+					s[j] ^= _s[j];
+				}
+			}
+			(*this)();
+		}
+	}
+	std::copy(s, s + 4, _s);
+}
+
+//Bulk generation. These are written for a specific engine type so that the inner loops have no dispatch.
+namespace {
+
+	//The top 24 or 53 bits of a 64-bit value make a uniform value in [0, 1) with every representable step.
+	inline float bitsToUnitFloat(uint64_t bits) {
+		return (float)(bits >> 40) * (1.0f / 16777216.0f);
+	}
+
+	inline double bitsToUnitDouble(uint64_t bits) {
+		return (double)(bits >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	template <typename Engine, typename T>
+	void fillUniformWith(Engine& engine, T* dest, size_t count, T lower, T upper) {
+		const T range = upper - lower;
+		for (size_t i = 0; i < count; i++) {
+			T u = (sizeof(T) == sizeof(float)) ? (T)bitsToUnitFloat(engine()) : (T)bitsToUnitDouble(engine());
+			dest[i] = lower + u * range;
+		}
+	}
+
+	//Box-Muller transform, which makes two normal deviates from each pair of uniform deviates.
+	template <typename Engine, typename T>
+	void fillNormalWith(Engine& engine, T* dest, size_t count, T mean, T sd) {
+		const double twoPi = 6.283185307179586;
+		for (size_t i = 0; i < count; i += 2) {
+			double u1 = bitsToUnitDouble(engine()) + (1.0 / 9007199254740992.0); //(0, 1], so that log() is finite.
+			double u2 = bitsToUnitDouble(engine());
+
+			double r = std::sqrt(-2.0 * std::log(u1));
+			double theta = twoPi * u2;
+
+			dest[i] = (T)(mean + sd * r * std::cos(theta));
+			if (i + 1 < count) {
+				dest[i + 1] = (T)(mean + sd * r * std::sin(theta));
+			}
+		}
+	}
+
+}
+
+///////////////////////////////
+// CX_RandomNumberGenerator  //
+///////////////////////////////
+
 /*! An instance of CX_RandomNumberGenerator that is very lightly hooked into the CX backend. The only
  way this is used outside of user code is to generate random numbers internally in, e.g., Algo::BlockSampler.
 \ingroup entryPoint
@@ -35,7 +122,7 @@ CX_RandomNumberGenerator::CX_RandomNumberGenerator (void) {
 void CX_RandomNumberGenerator::setSeed (unsigned long seed) {
 	_seed = seed; //Store the seed for reference.
 
-	_mersenneTwister.seed( _seed );
+	_engine.seed( _seed );
 }
 
 /*! This function provides a method of setting the seed using an arbitrary string
@@ -59,7 +146,7 @@ unsigned long CX_RandomNumberGenerator::getSeed (void) {
 /*! Get a random integer in the range getMinimumRandomInt(), getMaximumRandomInt(), inclusive.
 \return The int. */
 CX_RandomInt_t CX_RandomNumberGenerator::randomInt(void) {
-	return std::uniform_int_distribution<CX_RandomInt_t>(std::numeric_limits<CX_RandomInt_t>::min(), std::numeric_limits<CX_RandomInt_t>::max())(_mersenneTwister);
+	return std::uniform_int_distribution<CX_RandomInt_t>(std::numeric_limits<CX_RandomInt_t>::min(), std::numeric_limits<CX_RandomInt_t>::max())(_engine);
 }
 
 /*! This function returns an integer from the range [rangeLower, rangeUpper]. The minimum and maximum values for the
@@ -73,7 +160,7 @@ CX_RandomInt_t CX_RandomNumberGenerator::randomInt(CX_RandomInt_t min, CX_Random
 		std::swap(min, max);
 	}
 
-	return std::uniform_int_distribution<CX_RandomInt_t>(min, max)(_mersenneTwister);
+	return std::uniform_int_distribution<CX_RandomInt_t>(min, max)(_engine);
 }
 
 /*! Get the minimum value that can be returned by randomInt(). 
@@ -97,7 +184,7 @@ double CX_RandomNumberGenerator::randomDouble(double lowerBound_closed, double u
 		Instances::Log.error("CX_RandomNumberGenerator") << "randomDouble: The lower bound is greater than the upper bound, returning 0.";
 		return 0;
 	}
-	return std::uniform_real_distribution<double>(lowerBound_closed, upperBound_open)(_mersenneTwister);
+	return std::uniform_real_distribution<double>(lowerBound_closed, upperBound_open)(_engine);
 }
 
 /*! Returns a vector of count integers drawn randomly from the range [lowerBound, upperBound] with or without replacement.
@@ -107,7 +194,79 @@ double CX_RandomNumberGenerator::randomDouble(double lowerBound_closed, double u
 \param withReplacement Sample with or without replacement.
 \return A vector of the samples. */
 std::vector<int> CX_RandomNumberGenerator::sample(unsigned int count, int lowerBound, int upperBound, bool withReplacement) {
-	return sample(count, CX::Util::intVector<int>(lowerBound, upperBound), withReplacement);
+	if (lowerBound > upperBound) {
+		std::swap(lowerBound, upperBound);
+	}
+
+	std::vector<int> samples;
+	if (withReplacement) {
+		samples.reserve(count);
+		for (unsigned int i = 0; i < count; i++) {
+			samples.push_back((int)randomInt(lowerBound, upperBound));
+		}
+		return samples;
+	}
+
+	size_t rangeSize = (size_t)((int64_t)upperBound - lowerBound + 1);
+	if (count > rangeSize) {
+		return samples;
+	}
+
+	std::vector<size_t> indices = sampleIndices(count, rangeSize);
+	samples.reserve(count);
+	for (size_t index : indices) {
+		samples.push_back((int)(lowerBound + (int64_t)index));
+	}
+	return samples;
+}
+
+/*! Samples `count` indices in the range [0, populationSize) without replacement, in a random order. This takes time
+and memory in proportion to `count`, not to `populationSize`, so it can be used to draw a few items from a very large pool
+without making a vector of indices for the whole pool. It is what sample() uses when sampling without replacement.
+
+This is a partial Fisher-Yates shuffle. When `count` is a large part of `populationSize`, the shuffle is done on a
+vector of all indices, which is faster. Otherwise, only the indices that have been moved are stored, in a hash map.
+\param count The number of indices to sample. If this is greater than `populationSize`, an error is logged and an empty vector is returned.
+\param populationSize The number of indices to sample from.
+\return A vector of the sampled indices. */
+std::vector<size_t> CX_RandomNumberGenerator::sampleIndices(size_t count, size_t populationSize) {
+	std::vector<size_t> samples;
+	if (count > populationSize) {
+		Instances::Log.error("CX_RandomNumberGenerator") << "sampleIndices: More indices requested (" << count <<
+			") than are in the population (" << populationSize << ").";
+		return samples;
+	}
+
+	samples.resize(count);
+
+	if (count * 4 >= populationSize) {
+		std::vector<size_t> indices(populationSize);
+		for (size_t i = 0; i < populationSize; i++) {
+			indices[i] = i;
+		}
+		for (size_t i = 0; i < count; i++) {
+			size_t j = (size_t)randomInt(i, populationSize - 1);
+			std::swap(indices[i], indices[j]);
+			samples[i] = indices[i];
+		}
+		return samples;
+	}
+
+	//An index that is not in the map has not been moved, so it holds itself.
+	std::unordered_map<size_t, size_t> moved;
+	moved.reserve(count * 2);
+	auto valueAt = [&moved](size_t i) {
+		auto it = moved.find(i);
+		return (it == moved.end()) ? i : it->second;
+	};
+
+	for (size_t i = 0; i < count; i++) {
+		size_t j = (size_t)randomInt(i, populationSize - 1);
+		size_t atJ = valueAt(j);
+		moved[j] = valueAt(i);
+		samples[i] = atJ;
+	}
+	return samples;
 }
 
 /*!	Samples count realizations from a binomial distribution with the given number of trials and probability of success on each trial.
@@ -119,7 +278,9 @@ std::vector<unsigned int> CX_RandomNumberGenerator::sampleBinomialRealizations(u
 	return this->sampleRealizations(count, std::binomial_distribution<unsigned int>(trials, probSuccess));
 }
 
-/*! This function returns a reference to the standard library PRNG used by the CX_RandomNumberGenerator.
+/*! This function returns a reference to the standard library Mersenne Twister PRNG used by the CX_RandomNumberGenerator
+when the engine type is CX_RandomEngine::Type::MERSENNE_TWISTER (the default, see setEngine()). If another engine is selected,
+a warning is logged and getEngine() should be used instead.
 This can be used for various things, including sampling from some of the other distributions
 provided by the standard library: http://en.cppreference.com/w/cpp/numeric/random
 \code{.cpp}
@@ -127,7 +288,116 @@ std::poisson_distribution<int> pois(4);
 int deviate = pois(RNG.getGenerator());
 \endcode */
 std::mt19937_64& CX_RandomNumberGenerator::getGenerator(void) { 
-	return _mersenneTwister; 
+	if (_engine.getType() != CX_RandomEngine::Type::MERSENNE_TWISTER) {
+		Instances::Log.warning("CX_RandomNumberGenerator") << "getGenerator: The Mersenne Twister is not the selected engine, so "
+			"values drawn from it are not reproducible from the seed. Use getEngine() instead.";
+	}
+	return _engine.mersenneTwister();
+}
+
+/*! Returns a reference to the engine used by the CX_RandomNumberGenerator, whichever type it is (see setEngine()).
+This works with the distributions in the standard library in the same way as getGenerator().
+\code{.cpp}
+std::poisson_distribution<int> pois(4);
+int deviate = pois(RNG.getEngine());
+\endcode */
+CX_RandomEngine& CX_RandomNumberGenerator::getEngine(void) {
+	return _engine;
+}
+
+/*! Selects the algorithm that is used to generate random numbers. The engine is reseeded with the current seed
+(see getSeed()), so the sequence of random numbers starts over.
+\param type The engine to use. The default is CX_RandomEngine::Type::MERSENNE_TWISTER. */
+void CX_RandomNumberGenerator::setEngine(CX_RandomEngine::Type type) {
+	_engine.setType(type);
+	setSeed(_seed);
+}
+
+/*! Returns the type of engine that is used to generate random numbers. See setEngine(). */
+CX_RandomEngine::Type CX_RandomNumberGenerator::getEngineType(void) const {
+	return _engine.getType();
+}
+
+/*! Makes a new CX_RandomNumberGenerator with its own stream of random numbers, for example for use in another thread.
+The streams are reproducible: if this generator is given the same seed and split() is called in the same order,
+the new generators produce the same numbers.
+
+With the XOSHIRO256PP engine, the new generator gets the current state of this one and then this one jumps ahead
+by 2^128 values (see jump()), so the streams cannot overlap. The new generator has the same seed as this one.
+With the MERSENNE_TWISTER engine, which cannot jump, the new generator is seeded with a random value from this one,
+which is what getSeed() returns for it. The streams are then very unlikely, but not certain, not to overlap.
+\return The new generator. */
+CX_RandomNumberGenerator CX_RandomNumberGenerator::split(void) {
+	CX_RandomNumberGenerator child = *this;
+
+	if (_engine.getType() == CX_RandomEngine::Type::XOSHIRO256PP) {
+		_engine.xoshiro().jump();
+	} else {
+		child.setSeed((unsigned long)_engine());
+	}
+
+	return child;
+}
+
+/*! Advances this generator by 2^128 values, as if that many random numbers had been taken from it. This only works
+with the XOSHIRO256PP engine. split() is usually easier to use.
+\return `true` if the generator jumped, `false` if the engine type does not support jumping. */
+bool CX_RandomNumberGenerator::jump(void) {
+	if (_engine.getType() != CX_RandomEngine::Type::XOSHIRO256PP) {
+		Instances::Log.error("CX_RandomNumberGenerator") << "jump: Only the XOSHIRO256PP engine can jump.";
+		return false;
+	}
+	_engine.xoshiro().jump();
+	return true;
+}
+
+/*! Fills an array with deviates from a uniform distribution with the range [lowerBound_closed, upperBound_open).
+This is much faster than sampleUniformRealizations() for large numbers of values, because each value takes only
+a few operations and none of them allocate memory. The values are not the same as the ones that
+sampleUniformRealizations() would give with the same seed.
+\param dest The array to fill. It must have room for `count` values.
+\param count The number of values.
+\param lowerBound_closed The lower bound of the distribution.
+\param upperBound_open The upper bound of the distribution. */
+void CX_RandomNumberGenerator::fillUniform(float* dest, size_t count, float lowerBound_closed, float upperBound_open) {
+	if (_engine.getType() == CX_RandomEngine::Type::XOSHIRO256PP) {
+		fillUniformWith(_engine.xoshiro(), dest, count, lowerBound_closed, upperBound_open);
+	} else {
+		fillUniformWith(_engine.mersenneTwister(), dest, count, lowerBound_closed, upperBound_open);
+	}
+}
+
+/*! \copydoc fillUniform(float*, size_t, float, float) */
+void CX_RandomNumberGenerator::fillUniform(double* dest, size_t count, double lowerBound_closed, double upperBound_open) {
+	if (_engine.getType() == CX_RandomEngine::Type::XOSHIRO256PP) {
+		fillUniformWith(_engine.xoshiro(), dest, count, lowerBound_closed, upperBound_open);
+	} else {
+		fillUniformWith(_engine.mersenneTwister(), dest, count, lowerBound_closed, upperBound_open);
+	}
+}
+
+/*! Fills an array with deviates from a normal distribution with the given mean and standard deviation, using the
+Box-Muller transform. This is much faster than sampleNormalRealizations() for large numbers of values. The values
+are not the same as the ones that sampleNormalRealizations() would give with the same seed.
+\param dest The array to fill. It must have room for `count` values.
+\param count The number of values.
+\param mean The mean of the distribution.
+\param standardDeviation The standard deviation of the distribution. */
+void CX_RandomNumberGenerator::fillNormal(float* dest, size_t count, float mean, float standardDeviation) {
+	if (_engine.getType() == CX_RandomEngine::Type::XOSHIRO256PP) {
+		fillNormalWith(_engine.xoshiro(), dest, count, mean, standardDeviation);
+	} else {
+		fillNormalWith(_engine.mersenneTwister(), dest, count, mean, standardDeviation);
+	}
+}
+
+/*! \copydoc fillNormal(float*, size_t, float, float) */
+void CX_RandomNumberGenerator::fillNormal(double* dest, size_t count, double mean, double standardDeviation) {
+	if (_engine.getType() == CX_RandomEngine::Type::XOSHIRO256PP) {
+		fillNormalWith(_engine.xoshiro(), dest, count, mean, standardDeviation);
+	} else {
+		fillNormalWith(_engine.mersenneTwister(), dest, count, mean, standardDeviation);
+	}
 }
 
 /*!	This function works like CX_RandomNumberGenerator::sampleBlocks(),
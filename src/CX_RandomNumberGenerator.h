@@ -4,6 +4,11 @@
 #include <cmath>
 #include <vector>
 #include <set>
+#include <unordered_map>
+#include <iterator>
+#include <utility>
+#include <limits>
+#include <algorithm>
 
 #include <stdint.h>
 
@@ -25,10 +30,164 @@ namespace CX {
 	/*! \brief The type of integer returned by the CX_RandomNumberGenerator::randomInt() functions. */
 	typedef int64_t CX_RandomInt_t;
 
-	/*! This class is used for generating random values from a pseudo-random number generator. If uses
+	/*! This class is an implementation of the xoshiro256++ pseudo-random number generator by Blackman and Vigna
+	(http://prng.di.unimi.it/). It has 32 bytes of state, is several times faster than std::mt19937_64, and passes
+	the standard statistical tests. With jump(), the sequence can be split into 2^128 non-overlapping subsequences
+	of length 2^128, which is how independent streams for different threads are made.
+
+	It meets the requirements of a C++11 UniformRandomBitGenerator, so it can be used with the standard library
+	distributions, but it is usually used through CX_RandomNumberGenerator (see CX_RandomEngine::Type).
+	\ingroup randomNumberGeneration
+	*/
+	class CX_Xoshiro256pp {
+	public:
+		typedef uint64_t result_type;
+
+		static constexpr result_type min(void) { return 0; }
+		static constexpr result_type max(void) { return std::numeric_limits<result_type>::max(); }
+
+		CX_Xoshiro256pp(uint64_t seed = 0) {
+			this->seed(seed);
+		}
+
+		void seed(uint64_t seed);
+
+		/*! Returns the next 64 random bits. */
+		result_type operator()(void) {
+			const uint64_t result = _rotateLeft(_s[0] + _s[3], 23) + _s[0];
+			const uint64_t t = _s[1] << 17;
+
+			_s[2] ^= _s[0];
+			_s[3] ^= _s[1];
+			_s[1] ^= _s[2];
+			_s[0] ^= _s[3];
+			_s[2] ^= t;
+			_s[3] = _rotateLeft(_s[3], 45);
+
+			return result;
+		}
+
+		void jump(void);
+		void longJump(void);
+
+		bool operator==(const CX_Xoshiro256pp& rhs) const {
+			return std::equal(_s, _s + 4, rhs._s);
+		}
+		bool operator!=(const CX_Xoshiro256pp& rhs) const {
+			return !(*this == rhs);
+		}
+
+	private:
+		uint64_t _s[4];
+
+		static uint64_t _rotateLeft(const uint64_t x, int k) {
+			return (x << k) | (x >> (64 - k));
+		}
+
+		void _jump(const uint64_t (&table)[4]);
+	};
+
+	/*! This class is the random number engine used by CX_RandomNumberGenerator. It forwards to one of the engines
+	in CX_RandomEngine::Type, chosen with CX_RandomNumberGenerator::setEngine(). It meets the requirements of a C++11
+	UniformRandomBitGenerator, so it can be used with the standard library distributions:
+	\code{.cpp}
+	std::poisson_distribution<int> pois(4);
+	int deviate = pois(RNG.getEngine());
+	\endcode
+	\ingroup randomNumberGeneration
+	*/
+	class CX_RandomEngine {
+	public:
+		typedef uint64_t result_type;
+
+		/*! The pseudo-random number generator algorithms that can be used. */
+		enum class Type {
+			MERSENNE_TWISTER, //!< `std::mt19937_64`. This is the default, so that seeds from older experiments give the same results.
+			XOSHIRO256PP //!< CX_Xoshiro256pp. Faster, much smaller, and supports CX_RandomNumberGenerator::split() by jumping.
+		};
+
+		static constexpr result_type min(void) { return 0; }
+		static constexpr result_type max(void) { return std::numeric_limits<result_type>::max(); }
+
+		CX_RandomEngine(void) :
+			_type(Type::MERSENNE_TWISTER)
+		{}
+
+		/*! Returns the next 64 random bits from the selected engine. */
+		result_type operator()(void) {
+			return (_type == Type::XOSHIRO256PP) ? _xoshiro() : _mersenneTwister();
+		}
+
+		/*! Seeds the selected engine. */
+		void seed(uint64_t seed) {
+			if (_type == Type::XOSHIRO256PP) {
+				_xoshiro.seed(seed);
+			} else {
+				_mersenneTwister.seed(seed);
+			}
+		}
+
+		/*! Selects the engine. The newly selected engine is not reseeded. */
+		void setType(Type type) { _type = type; }
+
+		/*! Returns the selected engine type. */
+		Type getType(void) const { return _type; }
+
+		/*! The Mersenne Twister engine, which is used when the type is MERSENNE_TWISTER. */
+		std::mt19937_64& mersenneTwister(void) { return _mersenneTwister; }
+
+		/*! The xoshiro256++ engine, which is used when the type is XOSHIRO256PP. */
+		CX_Xoshiro256pp& xoshiro(void) { return _xoshiro; }
+
+	private:
+		Type _type;
+
+		std::mt19937_64 _mersenneTwister;
+		CX_Xoshiro256pp _xoshiro;
+	};
+
+	namespace Private {
+		//Detects whether values of type T can be compared with operator<, so that they can be put in a std::set.
+		template <typename T>
+		class HasLessThan {
+			template <typename U> static auto test(int) -> decltype(std::declval<const U&>() < std::declval<const U&>(), std::true_type());
+			template <typename> static std::false_type test(...);
+		public:
+			static const bool value = decltype(test<T>(0))::value;
+		};
+
+		//Returns the indices of the values that are not in exclude. If T has operator<, the excluded
+		//values are looked up in a set. Otherwise, every value is compared with every excluded value.
+		template <typename T>
+		std::vector<size_t> keptIndices(const std::vector<T>& values, const std::vector<T>& exclude, std::true_type) {
+			std::set<T> excluded(exclude.begin(), exclude.end());
+			std::vector<size_t> kept;
+			kept.reserve(values.size());
+			for (size_t i = 0; i < values.size(); i++) {
+				if (excluded.find(values[i]) == excluded.end()) {
+					kept.push_back(i);
+				}
+			}
+			return kept;
+		}
+
+		template <typename T>
+		std::vector<size_t> keptIndices(const std::vector<T>& values, const std::vector<T>& exclude, std::false_type) {
+			std::vector<size_t> kept;
+			kept.reserve(values.size());
+			for (size_t i = 0; i < values.size(); i++) {
+				if (std::find(exclude.begin(), exclude.end(), values[i]) == exclude.end()) {
+					kept.push_back(i);
+				}
+			}
+			return kept;
+		}
+	}
+
+	/*! This class is used for generating random values from a pseudo-random number generator. By default, it uses
 	a version of the Mersenne Twister algorithm, in particular std::mt19937_64 (see 
 	http://en.cppreference.com/w/cpp/numeric/random/mersenne_twister_engine for the parameters used with
-	this algorithm).
+	this algorithm). The faster xoshiro256++ algorithm can be used instead with setEngine().
 
 	When an instance of this class is constructed, it is automatically seeded from a high-entropy source.
 	In particular, a `std::random_device`. See the documentation for CX_RandomNumberGenerator::CX_RandomNumberGenerator()
@@ -49,6 +208,21 @@ namespace CX {
 	is not thread safe. If you want to use a CX_RandomNumberGenerator in a thread, that thread should have its
 	own CX_RandomNumberGenerator. You should create a new CX_RandomNumberGenerator for the thread. 
 	You may seed the thread's new CX_RandomNumberGenerator with CX::Instances::RNG, for example.
+	A reproducible, independent generator for each thread can be made with split():
+
+	\code{.cpp}
+	CX_RandomNumberGenerator rng;
+	rng.setEngine(CX_RandomEngine::Type::XOSHIRO256PP);
+	rng.setSeed(participantSeed);
+
+	std::vector<CX_RandomNumberGenerator> threadRngs;
+	for (int i = 0; i < 4; i++) {
+		threadRngs.push_back(rng.split()); //Each one gets its own stream of random numbers.
+	}
+	\endcode
+
+	For large numbers of random values, such as white noise masks, fillUniform() and fillNormal() are
+	much faster than drawing values one at a time.
 
 	\ingroup randomNumberGeneration
 	*/
@@ -69,6 +243,17 @@ namespace CX {
 
 		double randomDouble(double lowerBound_closed, double upperBound_open);
 
+		void setEngine(CX_RandomEngine::Type type);
+		CX_RandomEngine::Type getEngineType(void) const;
+
+		CX_RandomNumberGenerator split(void);
+		bool jump(void);
+
+		void fillUniform(float* dest, size_t count, float lowerBound_closed = 0, float upperBound_open = 1);
+		void fillUniform(double* dest, size_t count, double lowerBound_closed = 0, double upperBound_open = 1);
+		void fillNormal(float* dest, size_t count, float mean = 0, float standardDeviation = 1);
+		void fillNormal(double* dest, size_t count, double mean = 0, double standardDeviation = 1);
+
 		template <typename T> void shuffleVector(std::vector<T> *v);
 		template <typename T> std::vector<T> shuffleVector(std::vector<T> v);
 
@@ -81,6 +266,10 @@ namespace CX {
 		template <typename T> std::vector<T> sampleExclusive(unsigned int count, const std::vector<T>& values, const T& exclude, bool withReplacement);
 		template <typename T> std::vector<T> sampleExclusive(unsigned int count, const std::vector<T>& values, const std::vector<T>& exclude, bool withReplacement);
 
+		template <typename InputIt> std::vector<typename std::iterator_traits<InputIt>::value_type> sampleStream(unsigned int count, InputIt first, InputIt last);
+
+		std::vector<size_t> sampleIndices(size_t count, size_t populationSize);
+
 		template <typename T> std::vector<T> sampleBlocks(const std::vector<T>& values, unsigned int blocksToSample);
 		CX_DataFrame sampleBlocksDF(const CX_DataFrame& df, unsigned int blocksToSample);
 
@@ -90,11 +279,12 @@ namespace CX {
 		std::vector<unsigned int> sampleBinomialRealizations(unsigned int count, unsigned int trials, double probSuccess);
 
 		std::mt19937_64& getGenerator(void);
+		CX_RandomEngine& getEngine(void);
 
 	private:
 		unsigned long _seed;
 
-		std::mt19937_64 _mersenneTwister;
+		CX_RandomEngine _engine;
 	};
 
 	namespace Instances {
@@ -105,7 +295,7 @@ namespace CX {
 	\param v A pointer to the vector to be shuffled. */
 	template <typename T>
 	void CX_RandomNumberGenerator::shuffleVector(std::vector<T> *v) {
-		std::shuffle( v->begin(), v->end(), _mersenneTwister );
+		std::shuffle( v->begin(), v->end(), _engine );
 	}
 
 	/*! Makes a copy of the given vector, randomizes the order of its elements, and returns the shuffled copy.
@@ -113,7 +303,7 @@ namespace CX {
 	\return A shuffled copy of v. */
 	template <typename T>
 	std::vector<T> CX_RandomNumberGenerator::shuffleVector(std::vector<T> v) {
-		std::shuffle( v.begin(), v.end(), _mersenneTwister );
+		std::shuffle( v.begin(), v.end(), _engine );
 		return v;
 	}
 
@@ -135,18 +325,20 @@ namespace CX {
 		}
 
 		if (withReplacement) {
+			samples.reserve(count);
 			for (typename std::vector<T>::size_type i = 0; i < count; i++) {
 				samples.push_back(source.at((std::vector<CX_RandomInt_t>::size_type)randomInt(0, source.size() - 1)));
 			}
 		} else {
-			//Without replacement. Make a vector of indices into the source vector, shuffle them, and select count of them from the vector.
+			//Without replacement. Only the sampled values are copied, and the time taken depends on count, not on source.size().
 			if (count > source.size()) {
 				//Log a warning?
 				return samples;
 			}
-			std::vector<typename std::vector<T>::size_type> indices = shuffleVector(CX::Util::intVector<typename std::vector<T>::size_type>(0, source.size() - 1));
-			for (unsigned int i = 0; i < count; i++) {
-				samples.push_back( source[ indices[i] ] );
+			std::vector<size_t> indices = sampleIndices(count, source.size());
+			samples.reserve(count);
+			for (size_t index : indices) {
+				samples.push_back( source[ index ] );
 			}
 		}
 
@@ -180,7 +372,8 @@ namespace CX {
 	\return The sampled value.
 	\note If all of the values are excluded, an error will be logged and T() will be returned. */
 	template <typename T> T CX_RandomNumberGenerator::sampleExclusive(const std::vector<T>& values, const std::vector<T>& exclude) {
-		return this->sampleExclusive(1, values, exclude, false).front();
+		std::vector<T> sampled = this->sampleExclusive(1, values, exclude, false);
+		return sampled.empty() ? T() : sampled.front();
 	}
 
 	/*! Sample some number of random values, with or without replacement, from a vector without the possibility of getting the excluded value.
@@ -202,18 +395,79 @@ namespace CX {
 	\param exclude The vector of values to exclude from sampling.
 	\param withReplacement If true, values will be sampled with replacement (i.e. the same value can be sampled more than once).
 	\return The sampled values, of equal number to count, unless an error has occurred.
-	\note If all of the values are excluded, an error will be logged and an empty vector will be returned. */
+	\note If all of the values are excluded, an error will be logged and an empty vector will be returned.
+	\note If `T` can be compared with `operator<`, the excluded values are found with a `std::set`. Otherwise, each value
+	is compared with each excluded value with `operator==`, which is slow if there are many values and many excluded values. */
 	template <typename T> 
 	std::vector<T> CX_RandomNumberGenerator::sampleExclusive(unsigned int count, const std::vector<T>& values, const std::vector<T>& exclude, bool withReplacement) {
 
-		std::vector<T> keptValues = Util::exclude(values, exclude);
+		std::vector<size_t> kept = Private::keptIndices(values, exclude, std::integral_constant<bool, Private::HasLessThan<T>::value>());
 
-		if ((!withReplacement && (keptValues.size() < count)) || (keptValues.size() == 0)) {
+		if ((!withReplacement && (kept.size() < count)) || (kept.size() == 0)) {
 			CX::Instances::Log.error("CX_RandomNumberGenerator") << "sampleExclusive: Too many values excluded.";
 			return std::vector<T>();
 		}
 
-		return this->sample(count, keptValues, withReplacement);
+		std::vector<size_t> sampledIndices = this->sample(count, kept, withReplacement);
+
+		std::vector<T> samples;
+		samples.reserve(sampledIndices.size());
+		for (size_t index : sampledIndices) {
+			samples.push_back(values[index]);
+		}
+		return samples;
+	}
+
+	/*! Samples `count` values, without replacement, from the values in the range [`first`, `last`) using reservoir
+	sampling (Li's Algorithm L). The range is only read once, from beginning to end, and only `count` values are stored,
+	so this works with ranges that are too large to copy or that can only be read once, like lines from a file
+	(`std::istream_iterator`). The returned values are in a random order.
+	\param count The number of values to sample.
+	\param first An input iterator to the first value.
+	\param last An input iterator to the end of the values.
+	\return A vector of the sampled values. If there are fewer than `count` values in the range, all of them are returned. */
+	template <typename InputIt>
+	std::vector<typename std::iterator_traits<InputIt>::value_type> CX_RandomNumberGenerator::sampleStream(unsigned int count, InputIt first, InputIt last) {
+		std::vector<typename std::iterator_traits<InputIt>::value_type> reservoir;
+		if (count == 0) {
+			return reservoir;
+		}
+
+		reservoir.reserve(count);
+		while (first != last && reservoir.size() < count) {
+			reservoir.push_back(*first);
+			++first;
+		}
+
+		if (first != last) {
+			//Open interval (0, 1), so that the logarithms are finite.
+			auto uniform = [this](void) {
+				double u;
+				do {
+					u = this->randomDouble(0, 1);
+				} while (u == 0);
+				return u;
+			};
+
+			double w = std::exp(std::log(uniform()) / count);
+			while (true) {
+				//The number of values to skip before the next one that goes into the reservoir.
+				double skip = std::floor(std::log(uniform()) / std::log(1 - w));
+				for (double i = 0; i < skip && first != last; i++) {
+					++first;
+				}
+				if (first == last) {
+					break;
+				}
+
+				reservoir[(size_t)randomInt(0, count - 1)] = *first;
+				++first;
+				w *= std::exp(std::log(uniform()) / count);
+			}
+		}
+
+		shuffleVector(&reservoir);
+		return reservoir;
 	}
 
 	/*! Draws `count` samples from a distribution `dist` that is provided by the user.
@@ -236,7 +490,7 @@ namespace CX {
 	std::vector<typename stdDist::result_type> CX_RandomNumberGenerator::sampleRealizations(unsigned int count, stdDist dist) {
 		std::vector<typename stdDist::result_type> rval(count);
 		for (unsigned int i = 0; i < count; i++) {
-			rval[i] = dist(_mersenneTwister);
+			rval[i] = dist(_engine);
 		}
 		return rval;
 	}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+namespace CX {
+
+	/*! This class is a wait-free single-producer, single-consumer ring buffer. One thread may write
+	to the buffer while another thread reads from it, without locks and without allocating memory,
+	which makes it suitable for passing data into and out of real-time threads such as the audio
+	callback of a CX_SoundStream.
+
+	Only one thread may call the producer functions (write() and getWriteAvailable()) and only one
+	thread may call the consumer functions (read(), peek(), discard(), and getReadAvailable()). The
+	other functions must not be called while either thread is using the buffer.
+
+	\code{.cpp}
+	CX_SPSCRingBuffer<float> ring(4096);
+
+	//In the producer thread:
+	float block[256];
+	//... fill block
+	ring.write(block, 256); //Returns the number of elements that were actually written.
+
+	//In the consumer thread:
+	float data[256];
+	size_t count = ring.read(data, 256); //Returns the number of elements that were actually read.
+	\endcode
+	\ingroup utility
+	*/
+	template <typename T>
+	class CX_SPSCRingBuffer {
+	public:
+
+		CX_SPSCRingBuffer(void) :
+			_mask(0),
+			_writeIndex(0),
+			_readIndex(0),
+			_droppedCount(0)
+		{}
+
+		/*! Construct the ring buffer with room for at least `capacity` elements. See setup(). */
+		CX_SPSCRingBuffer(size_t capacity) :
+			CX_SPSCRingBuffer()
+		{
+			setup(capacity);
+		}
+
+		/*! Allocates space for at least `capacity` elements and empties the buffer. The capacity is rounded
+		up to a power of 2. This function must not be called while the buffer is in use by another thread.
+		\param capacity The minimum number of elements that the buffer should be able to hold. */
+		void setup(size_t capacity) {
+			size_t size = 1;
+			while (size < capacity) {
+				size *= 2;
+			}
+			_data.assign(size, T());
+			_mask = size - 1;
+			clear();
+		}
+
+		/*! Empties the buffer. This function must not be called while the buffer is in use by another thread. */
+		void clear(void) {
+			_writeIndex.store(0);
+			_readIndex.store(0);
+			_droppedCount.store(0);
+		}
+
+		/*! Returns the number of elements that the buffer can hold. */
+		size_t capacity(void) const {
+			return _data.size();
+		}
+
+		/*! Producer: Returns the number of elements that can be written without overwriting unread data. */
+		size_t getWriteAvailable(void) const {
+			return capacity() - (size_t)(_writeIndex.load(std::memory_order_relaxed) - _readIndex.load(std::memory_order_acquire));
+		}
+
+		/*! Consumer: Returns the number of elements that are available to be read. */
+		size_t getReadAvailable(void) const {
+			return (size_t)(_writeIndex.load(std::memory_order_acquire) - _readIndex.load(std::memory_order_relaxed));
+		}
+
+		/*! Producer: Writes up to `count` elements to the buffer. If there is not enough space for all of the elements,
+		as many as fit are written and the rest are counted as dropped (see getDroppedCount()).
+		\param data The elements to write.
+		\param count The number of elements in `data`.
+		\return The number of elements that were written. */
+		size_t write(const T* data, size_t count) {
+			uint64_t w = _writeIndex.load(std::memory_order_relaxed);
+			size_t toWrite = std::min(count, getWriteAvailable());
+
+			size_t start = (size_t)(w & _mask);
+			size_t firstPart = std::min(toWrite, capacity() - start);
+			std::copy(data, data + firstPart, _data.begin() + start);
+			std::copy(data + firstPart, data + toWrite, _data.begin());
+
+			_writeIndex.store(w + toWrite, std::memory_order_release);
+
+			if (toWrite < count) {
+				_droppedCount.fetch_add(count - toWrite, std::memory_order_relaxed);
+			}
+			return toWrite;
+		}
+
+		/*! Consumer: Copies up to `count` elements out of the buffer without removing them.
+		\param data Where to copy the elements to. Must have room for `count` elements.
+		\param count The maximum number of elements to copy.
+		\return The number of elements that were copied. */
+		size_t peek(T* data, size_t count) const {
+			uint64_t r = _readIndex.load(std::memory_order_relaxed);
+			size_t toRead = std::min(count, getReadAvailable());
+
+			size_t start = (size_t)(r & _mask);
+			size_t firstPart = std::min(toRead, capacity() - start);
+			std::copy(_data.begin() + start, _data.begin() + start + firstPart, data);
+			std::copy(_data.begin(), _data.begin() + (toRead - firstPart), data + firstPart);
+
+			return toRead;
+		}
+
+		/*! Consumer: Reads and removes up to `count` elements from the buffer.
+		\param data Where to copy the elements to. Must have room for `count` elements.
+		\param count The maximum number of elements to read.
+		\return The number of elements that were read. */
+		size_t read(T* data, size_t count) {
+			size_t n = peek(data, count);
+			_readIndex.store(_readIndex.load(std::memory_order_relaxed) + n, std::memory_order_release);
+			return n;
+		}
+
+		/*! Consumer: Removes up to `count` elements from the buffer without copying them.
+		\return The number of elements that were removed. */
+		size_t discard(size_t count) {
+			size_t n = std::min(count, getReadAvailable());
+			_readIndex.store(_readIndex.load(std::memory_order_relaxed) + n, std::memory_order_release);
+			return n;
+		}
+
+		/*! Returns the total number of elements that could not be written because the buffer was full.
+		This can be safely called from any thread. */
+		uint64_t getDroppedCount(void) const {
+			return _droppedCount.load(std::memory_order_relaxed);
+		}
+
+	private:
+		std::vector<T> _data;
+		size_t _mask;
+
+		std::atomic<uint64_t> _writeIndex;
+		std::atomic<uint64_t> _readIndex;
+		std::atomic<uint64_t> _droppedCount;
+	};
+
+}
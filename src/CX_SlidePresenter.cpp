@@ -1,14 +1,19 @@
 #include "CX_SlidePresenter.h"
 
+#include <cctype>
+
 #include "CX_Private.h"
+#include "CX_EventTrace.h"
 
 namespace CX {
 
 CX_SlidePresenter::CX_SlidePresenter(void) :
 	_hoggingStartTime(0),
 	_presentingSlides(false),
+	_capturePresentationCount(0),
 	_synchronizing(false),
 	_currentSlide(0),
+	_renderAheadDuration(0),
 	_renderingToFramebuffer(false),
 	_renderingToGarbageFramebuffer(false),
 	_frameNumberOnLastSwapCheck(0)
@@ -37,6 +42,8 @@ bool CX_SlidePresenter::setup(const CX_SlidePresenter::Configuration &config) {
 
 	_garbageFbo.allocate(1, 1);
 
+	_framebufferPool.setMemoryBudget(_config.framebufferMemoryBudget);
+
 	if (!CX::Private::glFenceSyncSupported()) {
 		_config.useFenceSync = false; //Override the setting
 		CX::Instances::Log.warning("CX_SlidePresenter") << "OpenGL fence sync not supported by the video card in this computer. This means that the slide"
@@ -57,10 +64,15 @@ bool CX_SlidePresenter::setup(const CX_SlidePresenter::Configuration &config) {
 }
 
 /*! Clears (deletes) all of the slides contained in the slide presenter and stops presentation,
-if it was in progress. */
+if it was in progress. The framebuffers of slides that were created with beginDrawingNextSlide() are
+kept for reuse by later slides (see getFramebufferPool()), so copies of them should not be kept. */
 void CX_SlidePresenter::clearSlides (void) {
 	stopSlidePresentation();
+	for (Slide& slide : _slides) {
+		_releaseFramebuffer(slide);
+	}
 	_slides.clear();
+	_slideInfo.clear();
 	_currentSlide = 0;
 }
 
@@ -109,6 +121,11 @@ bool CX_SlidePresenter::startSlidePresentation (void) {
 		_slides.at(i).presentationStatus = Slide::PresStatus::NOT_STARTED;
 	}
 
+	if (!_config.captureDirectory.empty()) {
+		ofDirectory::createDirectory(_config.captureDirectory, true, true);
+		_capturePresentationCount++;
+	}
+
 	_synchronizing = true;
 	_presentingSlides = false;
 
@@ -130,6 +147,7 @@ void CX_SlidePresenter::stopSlidePresentation(void) {
 
 	for (unsigned int i = 0; i < _slideInfo.size(); i++) {
 		_slideInfo[i].awaitingFenceSync = false;
+		_releaseRenderAhead(_slideInfo[i]);
 	}
 }
 
@@ -151,6 +169,12 @@ bool CX_SlidePresenter::presentSlides(void) {
 	while (this->isPresentingSlides()) {
 		this->update();
 		CX::Instances::Input.pollEvents();
+
+		//In multi-core mode, nothing happens until the next swap, so sleep until it happens instead of spinning.
+		//The timeout keeps input polling frequent. If sleepUntilDeadline is set, update() already does this.
+		if (_config.swappingMode == SwappingMode::MULTI_CORE && !_config.sleepUntilDeadline) {
+			_config.display->waitForBufferSwap(CX_Millis(1));
+		}
 	}
 
 	return true;
@@ -209,7 +233,7 @@ void CX_SlidePresenter::beginDrawingNextSlide(CX_Millis slideDuration, std::stri
 
 	CX::Instances::Log.verbose("CX_SlidePresenter") << "Allocating framebuffer...";
 	ofRectangle resolution = _config.display->getResolution();
-	_slides.back().framebuffer.allocate(resolution.x, resolution.y,
+	_slides.back().framebuffer = _framebufferPool.acquire(resolution.x, resolution.y,
 										GL_RGB, //Because we are always drawing over the whole display, there is no reason to have an alpha channel
 										CX::Util::getMsaaSampleCount());
 	CX::Instances::Log.verbose("CX_SlidePresenter") << "Finished allocating.";
@@ -220,6 +244,7 @@ void CX_SlidePresenter::beginDrawingNextSlide(CX_Millis slideDuration, std::stri
 	CX::Instances::Log.verbose("CX_SlidePresenter") << "Beginning to draw to framebuffer.";
 
 	_slides.back().framebuffer.begin();
+	ofClear(0, 0, 0, 255); //The framebuffer may have been used by a previous slide.
 	_renderingToFramebuffer = true;
 
 	CX::Instances::Log.verbose("CX_SlidePresenter") << "Slide #" << (_slides.size() - 1) << " (" << _slides.back().name << ") drawing begun. Frame count: " << _slides.back().intended.frameCount;
@@ -400,6 +425,41 @@ void CX_SlidePresenter::appendSlideFunction(std::function<void(void)> drawingFun
 
 }
 
+/*! Appends a slide that shows a texture from the texture loader of the display (see CX_Display::getTextureLoader()),
+centered on the display. The texture does not need to be loaded when the slide is appended, only when the slide is
+rendered, so slides can be appended while their images are still loading in the background. If the texture is not
+ready when the slide is rendered, an error is logged and only the background is drawn.
+\param textureId The id of the image, from CX_TextureLoader::load().
+\param slideDuration The amount of time to present the slide for.
+\param slideName The name of the slide.
+\param backgroundColor The color that the rest of the slide is filled with. */
+void CX_SlidePresenter::appendSlideTexture(unsigned int textureId, CX_Millis slideDuration, std::string slideName, ofColor backgroundColor) {
+	if (_config.display == nullptr) {
+		CX::Instances::Log.error("CX_SlidePresenter") << "appendSlideTexture(): The slide presenter has not been set up with a display.";
+		return;
+	}
+
+	CX_Display* display = _config.display;
+
+	appendSlideFunction([=](void) {
+		ofBackground(backgroundColor);
+
+		CX_TextureLoader& loader = display->getTextureLoader();
+		loader.update();
+		if (!loader.isReady(textureId)) {
+			CX::Instances::Log.error("CX_SlidePresenter") << "Texture " << textureId << " was not loaded in time to be rendered.";
+			return;
+		}
+
+		ofTexture& texture = loader.getTexture(textureId);
+		ofPoint center = display->getCenter();
+		ofPushStyle();
+		ofSetColor(255);
+		texture.draw(center.x - texture.getWidth() / 2, center.y - texture.getHeight() / 2);
+		ofPopStyle();
+	}, slideDuration, slideName);
+}
+
 
 /*! Get a reference to the vector of slides held by the slide presenter.
 If you modify any of the memebers of any of the slides, you do so at your
@@ -601,6 +661,12 @@ std::string CX_SlidePresenter::printLastPresentationInformation(void) const {
 		if (slide.copyToBackBufferCompleteTime > slide.actual.startTime) {
 			s << "**"; //Mark the error
 		}
+		s << endl;
+
+		s << "Slack: " << slide.slack;
+		if (slide.slack < CX_Millis(0)) {
+			s << "**";
+		}
 
 		s << endl << endl;
 	}
@@ -613,7 +679,7 @@ presentation for each slide (drawn directly from the CX_SlidePresenter struct us
 slide): name, intended and actual timing information, and copyToBackBufferCompleteTime. In 
 addition, the slide index is given.
 
-The column names are "index", "name", "copyToBackBufferCompleteTime", 
+The column names are "index", "name", "copyToBackBufferCompleteTime", "slack", "onsetTime",
 "actual.startTime", "actual.duration", "actual.startFrame", and "actual.frameCount". 
 Plus, for the intended timings, replace "actual" with "intended" for the 4 intended timings
 columns.
@@ -642,6 +708,8 @@ CX_DataFrame CX_SlidePresenter::getLastPresentationInformation(void) const {
 		df(i, "intended.frameCount") = slide.intended.frameCount;
 
 		df(i, "copyToBackBufferCompleteTime") = slide.copyToBackBufferCompleteTime;
+		df(i, "slack") = slide.slack;
+		df(i, "onsetTime") = slide.onsetTime;
 	}
 
 	return df;
@@ -651,15 +719,165 @@ CX_DataFrame CX_SlidePresenter::getLastPresentationInformation(void) const {
 update() must be called very regularly (at least once per millisecond) in order for the slide
 presenter to function. If slide presentation is stopped, you do not need to call update() */
 void CX_SlidePresenter::update(void) {
+	if (_config.display) {
+		_config.display->getTextureLoader().update();
+		_updateFrameCapture();
+	}
+
+	if (_config.sleepUntilDeadline) {
+		_sleepUntilDeadline();
+	}
+
 	_waitSyncCheck();
 
 	switch (_config.swappingMode) {
 	case SwappingMode::MULTI_CORE: 
-		return _multiCoreUpdate();
+		_multiCoreUpdate();
+		break;
 	case SwappingMode::SINGLE_CORE_BLOCKING_SWAPS: 
-		return _singleCoreBlockingUpdate();
+		_singleCoreBlockingUpdate();
+		break;
 	//case SwappingMode::SINGLE_CORE_THREADED_SWAPS: 
-	//	return _singleCoreThreadedUpdate();
+	//	_singleCoreThreadedUpdate();
+	//	break;
+	}
+
+	if (_config.renderAheadCount > 0) {
+		_renderAhead();
+	}
+}
+
+//Renders one upcoming slide into a framebuffer, if there is one that needs it and enough time before the next deadline.
+void CX_SlidePresenter::_renderAhead(void) {
+	if (!_presentingSlides) {
+		return;
+	}
+
+	//Check which slides that were rendered ahead are confirmed to be complete.
+	for (unsigned int i = _currentSlide; i < _slideInfo.size() && i <= _currentSlide + _config.renderAheadCount; i++) {
+		ExtraSlideInfo& info = _slideInfo[i];
+		if (info.awaitingRenderAheadFence) {
+			GLenum result = glClientWaitSync(info.renderAheadFence, 0, 0);
+			if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+				glDeleteSync(info.renderAheadFence);
+				info.awaitingRenderAheadFence = false;
+			}
+		}
+	}
+
+	//The next deadline is the next swap in multi-core mode or the start of CPU hogging in single-core mode.
+	CX_Millis deadline = (_config.swappingMode == SwappingMode::MULTI_CORE) ? _config.display->estimateNextSwapTime() : _hoggingStartTime;
+	if (CX::Instances::Clock.now() + _renderAheadDuration >= deadline) {
+		return;
+	}
+
+	for (unsigned int i = _currentSlide + 1; i < _slides.size() && i <= _currentSlide + _config.renderAheadCount; i++) {
+		Slide& slide = _slides[i];
+		ExtraSlideInfo& info = _slideInfo.at(i);
+
+		if (info.renderedAhead || slide.drawingFunction == nullptr || slide.presentationStatus != Slide::PresStatus::NOT_STARTED) {
+			continue;
+		}
+
+		CX_Millis startTime = CX::Instances::Clock.now();
+
+		ofRectangle resolution = _config.display->getResolution();
+		info.renderAheadFbo = _framebufferPool.acquire(resolution.x, resolution.y, GL_RGB, CX::Util::getMsaaSampleCount());
+
+		info.renderAheadFbo.begin();
+		ofClear(0, 0, 0, 255);
+		slide.drawingFunction();
+		info.renderAheadFbo.end();
+
+		if (_config.useFenceSync) {
+			info.renderAheadFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush();
+			info.awaitingRenderAheadFence = true;
+		}
+		info.renderedAhead = true;
+
+		_renderAheadDuration = std::max(_renderAheadDuration, CX::Instances::Clock.now() - startTime);
+
+		CX::Instances::Log.verbose("CX_SlidePresenter") << "Slide #" << i << " rendered ahead.";
+		return; //Only one slide per update, to keep update() short.
+	}
+}
+
+//Copying captured pixels out of their buffers takes some time for large displays, so it is not done close to a deadline.
+void CX_SlidePresenter::_updateFrameCapture(void) {
+	CX_FrameCapture& capture = _config.display->getFrameCapture();
+	if (capture.getPendingCount() == 0) {
+		return;
+	}
+
+	if (_presentingSlides) {
+		CX_Millis deadline = (_config.swappingMode == SwappingMode::MULTI_CORE) ? _config.display->estimateNextSwapTime() : _hoggingStartTime;
+		if (CX::Instances::Clock.now() + CX_Millis(2) >= deadline) {
+			return;
+		}
+	}
+
+	capture.update();
+}
+
+//This is called just before the slide is swapped in, so it must not wait for earlier captures. If every readback buffer
+//is still in use, the slide is not captured, because the back buffer will have changed by the time a buffer is free.
+void CX_SlidePresenter::_captureCurrentSlide(void) {
+	CX_FrameCapture& capture = _config.display->getFrameCapture();
+	if (!capture.hasFreeBuffer()) {
+		CX::Instances::Log.warning("CX_SlidePresenter") << "Slide #" << _currentSlide << " was not captured because every readback buffer was in use. "
+			"Use more buffers in the frame capture configuration (see CX_FrameCapture::Configuration::bufferCount).";
+		return;
+	}
+
+	std::string name = _slides.at(_currentSlide).name;
+	for (char& c : name) {
+		if (!std::isalnum((unsigned char)c) && c != '-' && c != '_') {
+			c = '_';
+		}
+	}
+
+	std::string filename = _config.captureDirectory + "/presentation" + ofToString(_capturePresentationCount) +
+		"_slide" + ofToString(_currentSlide) + "_" + name + ".png";
+	capture.saveBackBufferToFile(filename);
+}
+
+void CX_SlidePresenter::_releaseRenderAhead(ExtraSlideInfo& info) {
+	if (info.awaitingRenderAheadFence) {
+		glDeleteSync(info.renderAheadFence);
+		info.awaitingRenderAheadFence = false;
+	}
+	if (info.renderedAhead) {
+		_framebufferPool.release(info.renderAheadFbo);
+		info.renderedAhead = false;
+	}
+}
+
+//Sleeps until the slide presenter has something to do, but never for more than 1 ms.
+void CX_SlidePresenter::_sleepUntilDeadline(void) {
+	const CX_Millis maxSleep(1);
+
+	if (_config.swappingMode == SwappingMode::MULTI_CORE) {
+		//Nothing happens until the next swap. The swapping thread wakes this thread as soon as it swaps,
+		//so there is no need for a wakeup margin.
+		if (_presentingSlides || _synchronizing) {
+			_config.display->waitForBufferSwap(maxSleep);
+		}
+		return;
+	}
+
+	if (!_presentingSlides) {
+		return;
+	}
+
+	//While a slide is being rendered, the fence sync must be checked regularly, so only short sleeps are allowed.
+	//The last part of the wait is done with sleepUntil(), which wakes up at the deadline without spinning for all of it.
+	CX_Millis deadline = _hoggingStartTime - _config.sleepWakeupMargin;
+	CX_Millis remaining = deadline - CX::Instances::Clock.now();
+	if (remaining > maxSleep) {
+		CX::Instances::Clock.sleep(maxSleep);
+	} else if (remaining > CX_Millis(0)) {
+		CX::Instances::Clock.sleepUntil(deadline);
 	}
 }
 
@@ -724,7 +942,7 @@ void CX_SlidePresenter::_singleCoreBlockingUpdate(void) {
 
 				_config.display->swapBuffers();
 
-				CX_Millis slideStartTime = CX::Instances::Clock.now();
+				CX_Millis slideStartTime = _config.display->getLastSwapTime();
 
 				_postSwapSlideProcessing(_currentSlide, slideStartTime, -1);
 
@@ -805,18 +1023,29 @@ void CX_SlidePresenter::_multiCoreUpdate(void) {
 //This function does no slide rendering; each type of updating has to do that at the right time.
 //This just sets up correct state of the slide presentation and tracks timing issues.
 void CX_SlidePresenter::_postSwapSlideProcessing(unsigned int currentSlide, CX_Millis slideStartTime, unsigned int slideStartFrame) {
+	CX::Instances::EventTrace.instant(CX_EventTrace::Event::SLIDE_PRESENTED, currentSlide);
+
 	CX::Instances::Log.verbose("CX_SlidePresenter") << "Slide \"" << _slides.at(currentSlide).name <<
 		"\" in progress. Started at " << slideStartTime;
 
 	_slides.at(currentSlide).presentationStatus = Slide::PresStatus::IN_PROGRESS;
 	_slides.at(currentSlide).actual.startFrame = slideStartFrame;
 	_slides.at(currentSlide).actual.startTime = slideStartTime;
+	_slides.at(currentSlide).onsetTime = slideStartTime + _config.display->getPresentationLatency();
 
 	if (currentSlide == 0) {
 		_slides.at(0).intended.startFrame = slideStartFrame;
 		_slides.at(0).intended.startTime = slideStartTime; //This is sort of weird, but true.
 	}
 
+	//The slide was ready when rendering finished, or when the fence sync confirmed that it finished.
+	const ExtraSlideInfo& info = _slideInfo.at(currentSlide);
+	CX_Millis readyTime = info.renderCompleteTime;
+	if (_config.useFenceSync) {
+		readyTime = info.awaitingFenceSync ? slideStartTime : _slides.at(currentSlide).copyToBackBufferCompleteTime;
+	}
+	_slides.at(currentSlide).slack = _slides.at(currentSlide).intended.startTime - readyTime;
+
 	if (currentSlide > 0) {
 		_finishPreviousSlide();
 	}
@@ -845,7 +1074,7 @@ void CX_SlidePresenter::_finishPreviousSlide(void) {
 
 	if (_config.deallocateCompletedSlides) {
 		if (previousSlide.drawingFunction == nullptr) { //If there is no drawing function
-			previousSlide.framebuffer.allocate(0, 0); //"Deallocate" the framebuffer
+			_releaseFramebuffer(previousSlide);
 		}
 	}
 
@@ -907,7 +1136,7 @@ void CX_SlidePresenter::_handleFinalSlide(void) {
 		if (_config.deallocateCompletedSlides) {
 			for (unsigned int i = _currentSlide; i < _slides.size(); i++) {
 				if (_slides.at(i).drawingFunction == nullptr) { //If there is no drawing function
-					_slides.at(i).framebuffer.allocate(0, 0);
+					_releaseFramebuffer(_slides.at(i));
 				}
 			}
 		}
@@ -993,18 +1222,35 @@ void CX_SlidePresenter::_waitSyncCheck(void) {
 
 void CX_SlidePresenter::_renderCurrentSlide(void) {
 
+	CX::Instances::EventTrace.begin(CX_EventTrace::Event::SLIDE_RENDER, _currentSlide);
+
+	//A slide that was rendered ahead is only copied if its rendering is confirmed to be complete, so that the copy cannot be held up by it.
+	ExtraSlideInfo& info = _slideInfo.at(_currentSlide);
+	bool useRenderedAhead = info.renderedAhead && !info.awaitingRenderAheadFence;
+
 	_config.display->beginDrawingToBackBuffer();
-	if (_slides.at(_currentSlide).drawingFunction != nullptr) {
+	if (_slides.at(_currentSlide).drawingFunction != nullptr && !useRenderedAhead) {
 		_slides.at(_currentSlide).drawingFunction();
 	} else {
 		ofPushStyle();
 		ofDisableAlphaBlending();
 		ofSetColor(255);
-		_slides.at(_currentSlide).framebuffer.draw(0, 0);
+		if (useRenderedAhead) {
+			info.renderAheadFbo.draw(0, 0);
+		} else {
+			_slides.at(_currentSlide).framebuffer.draw(0, 0);
+		}
 		ofPopStyle();
 	}
 	_config.display->endDrawingToBackBuffer();
 
+	//The copy has been queued, so the framebuffer can be reused. OpenGL will finish the copy before anything is drawn into it again.
+	_releaseRenderAhead(info);
+
+	_slideInfo.at(_currentSlide).renderCompleteTime = CX::Instances::Clock.now();
+
+	CX::Instances::EventTrace.end(CX_EventTrace::Event::SLIDE_RENDER, _currentSlide);
+
 	CX::Instances::Log.verbose("CX_SlidePresenter") << "Slide #" << _currentSlide << " rendering started at " << CX::Instances::Clock.now();
 
 	if (_config.useFenceSync) {
@@ -1016,6 +1262,39 @@ void CX_SlidePresenter::_renderCurrentSlide(void) {
 	} else {
 		_slides.at(_currentSlide).presentationStatus = Slide::PresStatus::SWAP_PENDING;
 	}
+
+	//This comes after the fence so that the readback does not delay the confirmation that the slide is rendered.
+	if (!_config.captureDirectory.empty()) {
+		_captureCurrentSlide();
+	}
+}
+
+/*! Allocates framebuffers for slides ahead of time, so that beginDrawingNextSlide() does not need to allocate them.
+This is useful before presenting many slides (e.g. an RSVP stream), because allocating framebuffers is slow and can stall
+the video driver. Framebuffers are also reused when slides are cleared or, if \ref Configuration::deallocateCompletedSlides
+is `true`, when slides are finished.
+\param count The number of framebuffers that should be ready for use. */
+void CX_SlidePresenter::prewarmFramebuffers(unsigned int count) {
+	if (_config.display == nullptr) {
+		CX::Instances::Log.error("CX_SlidePresenter") << "prewarmFramebuffers(): Call CX_SlidePresenter::setup() before calling this function.";
+		return;
+	}
+
+	ofRectangle resolution = _config.display->getResolution();
+	_framebufferPool.prewarm(count, resolution.x, resolution.y, GL_RGB, CX::Util::getMsaaSampleCount());
+}
+
+/*! Returns the pool that the framebuffers of slides created with beginDrawingNextSlide() come from.
+This can be used to check how much video memory the slides are using. */
+CX_FboPool& CX_SlidePresenter::getFramebufferPool(void) {
+	return _framebufferPool;
+}
+
+//Framebuffers from the pool go back to it. Framebuffers that the user allocated are deallocated.
+void CX_SlidePresenter::_releaseFramebuffer(CX_SlidePresenter::Slide& slide) {
+	if (!_framebufferPool.release(slide.framebuffer)) {
+		slide.framebuffer.allocate(0, 0); //"Deallocate" the framebuffer
+	}
 }
 
 unsigned int CX_SlidePresenter::_calculateFrameCount(CX_Millis duration) {
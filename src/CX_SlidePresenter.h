@@ -9,6 +9,7 @@
 #include "CX_Utilities.h"
 #include "CX_Display.h"
 #include "CX_InputManager.h"
+#include "CX_FboPool.h"
 
 namespace CX {
 
@@ -166,7 +167,12 @@ namespace CX {
 				swappingMode(CX_SlidePresenter::SwappingMode::SINGLE_CORE_BLOCKING_SWAPS),
 				preSwapCPUHoggingDuration(2),
 				useFenceSync(true),
-				waitUntilFenceSyncComplete(false)
+				waitUntilFenceSyncComplete(false),
+				sleepUntilDeadline(false),
+				sleepWakeupMargin(1),
+				framebufferMemoryBudget(0),
+				renderAheadCount(0),
+				captureDirectory("")
 			{}
 
 			CX_Display *display; //!< A pointer to the display on which to present the slides.
@@ -203,6 +209,39 @@ namespace CX {
 			rendering has completed is delayed but the rendering has actually occurred on time.
 			Does nothing if `swappingMode` is `MULTI_CORE`. */
 			bool waitUntilFenceSyncComplete;
+
+			/*! \brief If `true`, update() sleeps instead of returning immediately when the slide presenter has nothing to do
+			until a known deadline, which greatly reduces CPU usage (e.g. on battery powered laptops). In the single core modes,
+			the deadline is the start of the CPU hogging period before the next swap (see \ref preSwapCPUHoggingDuration), so
+			the CPU still spins for that short period before the swap. In `MULTI_CORE` mode, update() sleeps until the next
+			buffer swap and is woken by the swapping thread as soon as the swap happens. update() never sleeps for longer than 1 ms, so that input can still be polled often between calls to
+			update(). Use CX_SlidePresenter::Slide::slack to check that slides are still ready on time. Defaults to `false`. */
+			bool sleepUntilDeadline;
+
+			/*! \brief Only used if \ref sleepUntilDeadline is `true`. Sleeping ends this long before the deadline, to leave
+			room for the operating system waking the thread up late. Defaults to 1 ms. */
+			CX_Millis sleepWakeupMargin;
+
+			/*! \brief The most video memory, in bytes, that the framebuffers of slides created with beginDrawingNextSlide()
+			should use, including framebuffers that are kept for reuse. 0, the default, means no limit.
+			See CX_SlidePresenter::getFramebufferPool() and CX::CX_FboPool::setMemoryBudget(). */
+			uint64_t framebufferMemoryBudget;
+
+			/*! \brief The number of upcoming slides with a \ref Slide::drawingFunction that are rendered ahead of time, into
+			framebuffers from the pool (see getFramebufferPool()), while there is time to spare between swaps. When such a slide
+			is next in line, only a copy of its framebuffer to the back buffer remains to be done, which helps to prevent late
+			copies to the back buffer with drawing functions that take a long time. If fence sync is used, each slide is only
+			copied from its framebuffer once rendering into it is confirmed to be complete; until then, it is rendered in the
+			normal way. The drawing functions are called earlier than they would otherwise be, so they should not depend on the
+			time at which they are called. 0, the default, turns rendering ahead off. */
+			unsigned int renderAheadCount;
+
+			/*! \brief If not empty, every slide that is presented is saved as a PNG file in this directory (relative to the data
+			directory), e.g. for keeping a record of exactly what was shown on each trial. The back buffer is captured right after
+			each slide is rendered into it, using the frame capture of the display (see CX_Display::getFrameCapture()), so the pixels
+			are read back asynchronously and encoded on worker threads and slide timing is not affected. The files are named
+			"presentation<N>_slide<I>_<slide name>.png", where N counts calls to startSlidePresentation(). Defaults to "". */
+			std::string captureDirectory;
 		};
 
 		/*! Contains information about the presentation timing of the slide. */
@@ -261,6 +300,16 @@ namespace CX {
 													This is pretty useful to determine if there was an error on the trial (e.g. framebuffer was copied late).
 													If this is greater than actual.startTime, the slide may not have been fully drawn at the time the
 													front and back buffers swapped. */
+
+			/*! \brief The time between when the slide was ready to be swapped in (rendering finished or, if fence sync
+			was used, confirmed) and its intended start time. Negative values mean that the slide was ready late and may have
+			been presented late. Small positive values mean that there was little room for error. */
+			CX_Millis slack;
+
+			/*! \brief The estimated time at which the slide became visible: `actual.startTime` plus the presentation latency of the
+			display (see CX_Display::setPresentationLatency()). If no presentation latency has been set, this is the same as
+			`actual.startTime`. */
+			CX_Millis onsetTime;
 		};
 
 
@@ -272,6 +321,7 @@ namespace CX {
 
 		void appendSlide(CX_SlidePresenter::Slide slide);
 		void appendSlideFunction(std::function<void(void)> drawingFunction, CX_Millis slideDuration, std::string slideName = "");
+		void appendSlideTexture(unsigned int textureId, CX_Millis slideDuration, std::string slideName = "", ofColor backgroundColor = ofColor(0));
 		void beginDrawingNextSlide(CX_Millis slideDuration, std::string slideName = "");
 		void endDrawingCurrentSlide(void);
 
@@ -293,15 +343,26 @@ namespace CX {
 		std::string printLastPresentationInformation(void) const;
 		CX_DataFrame getLastPresentationInformation(void) const;
 
+		void prewarmFramebuffers(unsigned int count);
+		CX_FboPool& getFramebufferPool(void);
+
 	private:
 
 		struct ExtraSlideInfo {
 			ExtraSlideInfo(void) :
-				awaitingFenceSync(false)
+				awaitingFenceSync(false),
+				renderedAhead(false),
+				awaitingRenderAheadFence(false)
 			{}
 
 			bool awaitingFenceSync;
 			GLsync fenceSyncObject;
+			CX_Millis renderCompleteTime;
+
+			bool renderedAhead; //The drawing function has been rendered into renderAheadFbo.
+			bool awaitingRenderAheadFence;
+			GLsync renderAheadFence;
+			ofFbo renderAheadFbo;
 		};
 
 		CX_SlidePresenter::Configuration _config;
@@ -309,12 +370,22 @@ namespace CX {
 		CX_Millis _hoggingStartTime;
 
 		bool _presentingSlides;
+		unsigned int _capturePresentationCount;
 		bool _synchronizing;
 		unsigned int _currentSlide;
 		std::vector<CX_SlidePresenter::Slide> _slides;
 		std::vector<ExtraSlideInfo> _slideInfo;
 
 		ofFbo _garbageFbo;
+		CX_FboPool _framebufferPool;
+		void _releaseFramebuffer(CX_SlidePresenter::Slide& slide);
+
+		CX_Millis _renderAheadDuration; //The longest that rendering a slide ahead has taken.
+		void _renderAhead(void);
+		void _releaseRenderAhead(ExtraSlideInfo& info);
+
+		void _updateFrameCapture(void);
+		void _captureCurrentSlide(void);
 		bool _renderingToFramebuffer;
 		bool _renderingToGarbageFramebuffer;
 
@@ -325,6 +396,7 @@ namespace CX {
 		void _multiCoreUpdate (void);
 
 		void _renderCurrentSlide(void);
+		void _sleepUntilDeadline(void);
 
 		void _waitSyncCheck(void);
 
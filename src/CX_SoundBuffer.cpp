@@ -1,10 +1,23 @@
 #include "CX_SoundBuffer.h"
 
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+
+#include "CX_SoundKernels.h"
+#include "CX_MappedFile.h"
+
 namespace CX {
 
 CX_SoundBuffer::CX_SoundBuffer(void) :
 	_successfullyLoaded(false),
-	_soundChannels(0)
+	_soundChannels(0),
+	_mappedData(nullptr),
+	_mappedSampleCount(0)
 {}
 
 /*!
@@ -17,6 +30,9 @@ If the file cannot be loaded, descriptive error messages will be logged.
 \return True if the sound given in the fileName was loaded succesffuly, false otherwise.
 */
 bool CX_SoundBuffer::loadFile(string fileName) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	_dropMapping();
 	_successfullyLoaded = true;
 
 	ofFmodSoundPlayer fmPlayer;
@@ -153,6 +169,259 @@ bool CX_SoundBuffer::loadFile(string fileName) {
 	return _successfullyLoaded;
 }
 
+/*! Loads a number of sound files at once, decoding them in parallel on several threads. This is much faster than calling
+loadFile() for each file when there are a lot of files, like a set of recorded words. See the other overload for the option
+to convert the sounds to a given format and to cache the converted sounds.
+\param fileNames The names of the files to load.
+\param threads The number of threads to use. If 0, one thread per hardware thread is used.
+\return A vector with one CX_SoundBuffer per file, in the same order as `fileNames`. Files that could not be loaded have
+buffers for which isLoadedSuccessfully() is `false`. */
+std::vector<CX_SoundBuffer> CX_SoundBuffer::loadFiles(const std::vector<std::string>& fileNames, unsigned int threads) {
+	BatchLoadConfiguration config;
+	config.threads = threads;
+	return loadFiles(fileNames, config);
+}
+
+namespace {
+
+	//FNV-1a over the contents of the file. Returns false if the file could not be read.
+	bool hashFileContents(std::string path, uint64_t& hash) {
+		std::ifstream file(ofToDataPath(path).c_str(), std::ios::in | std::ios::binary);
+		if (!file.is_open()) {
+			return false;
+		}
+
+		hash = 14695981039346656037ULL;
+		std::vector<char> block(1 << 16);
+		while (file) {
+			file.read(block.data(), block.size());
+			std::streamsize n = file.gcount();
+			for (std::streamsize i = 0; i < n; i++) {
+				hash ^= (uint8_t)block[i];
+				hash *= 1099511628211ULL;
+			}
+		}
+		return true;
+	}
+
+	void hashValue(uint64_t& hash, uint64_t value) {
+		for (int i = 0; i < 8; i++) {
+			hash ^= (value >> (i * 8)) & 0xFF;
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	const char cacheMagic[4] = { 'C', 'X', 'S', 'B' };
+	const uint32_t cacheVersion = 1;
+}
+
+/*! Loads a number of sound files at once, decoding them in parallel on several threads. Each file is decoded, resampled,
+and converted to the requested number of channels on the same thread, so the conversion is also done in parallel.
+If `config.cacheDirectory` is set, the converted sounds are stored there and loaded from there the next time the same
+files are loaded with the same target format, which skips decoding and conversion.
+
+\code{.cpp}
+CX_SoundBuffer::BatchLoadConfiguration config;
+config.sampleRate = SoundStream.getConfiguration().sampleRate;
+config.channels = SoundStream.getConfiguration().outputChannels;
+config.cacheDirectory = "soundCache";
+
+std::vector<CX_SoundBuffer> words = CX_SoundBuffer::loadFiles(wordFiles, config);
+\endcode
+
+\param fileNames The names of the files to load.
+\param config The settings to use.
+\return A vector with one CX_SoundBuffer per file, in the same order as `fileNames`. Files that could not be loaded have
+buffers for which isLoadedSuccessfully() is `false`. */
+std::vector<CX_SoundBuffer> CX_SoundBuffer::loadFiles(const std::vector<std::string>& fileNames, const BatchLoadConfiguration& config) {
+	std::vector<CX_SoundBuffer> buffers(fileNames.size());
+	if (fileNames.empty()) {
+		return buffers;
+	}
+
+	bool useCache = (config.cacheDirectory != "");
+	if (useCache && !ofDirectory::doesDirectoryExist(config.cacheDirectory) && !ofDirectory::createDirectory(config.cacheDirectory, true, true)) {
+		CX::Instances::Log.warning("CX_SoundBuffer") << "loadFiles(): The cache directory \"" << config.cacheDirectory <<
+			"\" could not be created. Sounds will not be cached.";
+		useCache = false;
+	}
+
+	//The FMOD system is set up lazily by the first sound player that loads a sound, which is not thread safe.
+	ofFmodSoundPlayer::initializeFmod();
+
+	std::atomic<size_t> nextFile(0);
+	std::atomic<size_t> cacheHits(0);
+
+	auto worker = [&](void) {
+		for (size_t i = nextFile++; i < fileNames.size(); i = nextFile++) {
+			CX_SoundBuffer& buffer = buffers[i];
+
+			std::string cachePath;
+			uint64_t hash = 0;
+			if (useCache && hashFileContents(fileNames[i], hash)) {
+				hashValue(hash, cacheVersion);
+				hashValue(hash, (uint64_t)config.sampleRate);
+				hashValue(hash, config.channels);
+				hashValue(hash, (uint64_t)config.quality);
+
+				std::ostringstream s;
+				s << config.cacheDirectory << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".cxsb";
+				cachePath = s.str();
+
+				if (buffer._readCache(cachePath)) {
+					buffer.name = fileNames[i];
+					cacheHits++;
+					continue;
+				}
+			}
+
+			if (!buffer.loadFile(fileNames[i])) {
+				continue;
+			}
+
+			buffer._convert(config);
+
+			if (cachePath != "" && !buffer._writeCache(cachePath)) {
+				CX::Instances::Log.warning("CX_SoundBuffer") << "loadFiles(): The cache file for \"" << fileNames[i] << "\" could not be written.";
+			}
+		}
+	};
+
+	unsigned int threadCount = config.threads;
+	if (threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	threadCount = std::min<size_t>(threadCount, fileNames.size());
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < threadCount; i++) {
+		threads.push_back(std::thread(worker));
+	}
+	worker();
+	for (std::thread& t : threads) {
+		t.join();
+	}
+
+	size_t failures = std::count_if(buffers.begin(), buffers.end(), [](CX_SoundBuffer& b) { return !b.isLoadedSuccessfully(); });
+	if (failures > 0) {
+		CX::Instances::Log.error("CX_SoundBuffer") << "loadFiles(): " << failures << " of " << fileNames.size() << " files could not be loaded.";
+	}
+	if (useCache) {
+		CX::Instances::Log.verbose("CX_SoundBuffer") << "loadFiles(): " << cacheHits.load() << " of " << fileNames.size() << " files were loaded from the cache.";
+	}
+
+	return buffers;
+}
+
+//Converts to the format of the configuration. Downmixing is done before resampling and upmixing after, so that
+//resampling is done on as few channels as possible.
+void CX_SoundBuffer::_convert(const BatchLoadConfiguration& config) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	bool changeChannels = (config.channels != 0 && config.channels != _soundChannels);
+	bool downmix = changeChannels && (config.channels < _soundChannels);
+
+	if (changeChannels && downmix) {
+		setChannelCount(config.channels);
+	}
+
+	if (config.sampleRate > 0) {
+		resample(config.sampleRate, config.quality);
+	}
+
+	if (changeChannels && !downmix) {
+		setChannelCount(config.channels);
+	}
+}
+
+bool CX_SoundBuffer::_readCache(std::string path) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	std::ifstream file(ofToDataPath(path).c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	char magic[4];
+	uint32_t version = 0;
+	uint32_t channels = 0;
+	float sampleRate = 0;
+	uint64_t sampleCount = 0;
+
+	file.read(magic, 4);
+	file.read((char*)&version, sizeof(version));
+	file.read((char*)&channels, sizeof(channels));
+	file.read((char*)&sampleRate, sizeof(sampleRate));
+	file.read((char*)&sampleCount, sizeof(sampleCount));
+
+	if (!file || std::memcmp(magic, cacheMagic, 4) != 0 || version != cacheVersion || channels == 0 || (sampleCount % channels) != 0) {
+		return false;
+	}
+
+	//The sample count is checked against the length of the file before allocating, so that a corrupt count cannot cause a huge allocation.
+	std::streamoff headerEnd = file.tellg();
+	file.seekg(0, std::ios::end);
+	std::streamoff remainingBytes = file.tellg() - headerEnd;
+	file.seekg(headerEnd, std::ios::beg);
+
+	if (!file || remainingBytes < 0 || sampleCount > (uint64_t)remainingBytes / sizeof(float) ||
+		sampleCount * sizeof(float) != (uint64_t)remainingBytes)
+	{
+		CX::Instances::Log.error("CX_SoundBuffer") << "_readCache(): The cache file \"" << path << "\" is corrupt: It has " << sampleCount <<
+			" samples in its header but " << remainingBytes << " bytes of sample data. The sound file will be loaded instead.";
+		return false;
+	}
+
+	_dropMapping();
+	_soundData.resize(sampleCount);
+	file.read((char*)_soundData.data(), sampleCount * sizeof(float));
+	if ((uint64_t)file.gcount() != sampleCount * sizeof(float)) {
+		_soundData.clear();
+		return false;
+	}
+
+	_soundChannels = channels;
+	_soundSampleRate = sampleRate;
+	_successfullyLoaded = true;
+	return true;
+}
+
+//The cache file is written under a temporary name and then renamed, so that a partly written file is never read.
+bool CX_SoundBuffer::_writeCache(std::string path) const {
+	std::string fullPath = ofToDataPath(path);
+	std::string tempPath = fullPath + ".tmp" + ofToString(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+	{
+		std::ofstream file(tempPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			return false;
+		}
+
+		uint32_t channels = _soundChannels;
+		uint64_t sampleCount = _soundData.size();
+
+		file.write(cacheMagic, 4);
+		file.write((const char*)&cacheVersion, sizeof(cacheVersion));
+		file.write((const char*)&channels, sizeof(channels));
+		file.write((const char*)&_soundSampleRate, sizeof(_soundSampleRate));
+		file.write((const char*)&sampleCount, sizeof(sampleCount));
+		file.write((const char*)_soundData.data(), sampleCount * sizeof(float));
+
+		if (!file) {
+			file.close();
+			std::remove(tempPath.c_str());
+			return false;
+		}
+	}
+
+	std::remove(fullPath.c_str()); //rename() does not replace existing files on Windows.
+	if (std::rename(tempPath.c_str(), fullPath.c_str()) != 0) {
+		std::remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
 /*!
 Uses loadFile(string) and addSound(CX_SoundBuffer, uint64_t) to add the given file to the current CX_SoundBuffer at the given time offset (in microseconds).
 See those functions for more information.
@@ -163,6 +432,8 @@ See those functions for more information.
 \return Returns true if the new sound was added sucessfully, false otherwise.
 */
 bool CX_SoundBuffer::addSound(std::string fileName, CX_Millis timeOffset) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
 	if (_soundData.size() == 0 || !this->_successfullyLoaded) {
 		bool loadSuccess = this->loadFile(fileName);
 		if (loadSuccess) {
@@ -174,7 +445,7 @@ bool CX_SoundBuffer::addSound(std::string fileName, CX_Millis timeOffset) {
 		if (!temp.loadFile(fileName)) {
 			return false;
 		}
-		addSound(temp, timeOffset);
+		addSound(std::move(temp), timeOffset);
 		this->_successfullyLoaded = true; //What is this doing here?
 		return true;
 	}
@@ -186,12 +457,40 @@ If the number of channels of nsb does not equal the number of channels of this,
 nsb equal to the number of channels of this CX_SoundBuffer.
 The data from `nsb` and this CX_SoundBuffer are merged by adding the amplitudes of the sounds. The result of the addition is clamped between -1 and 1.
 
+`nsb` is only copied if it has to be converted. To avoid that copy as well, give `nsb` as an rvalue (e.g. with `std::move()`),
+in which case it is converted in place. To build a sound out of many sounds, CX_SoundBufferBuilder is much faster than calling
+this function repeatedly.
+
 \param nsb A CX_SoundBuffer. Must be successfully loaded.
 \param timeOffset Time at which to add the new sound data in microseconds. Dependent on sample rate.
 
 \return True if nsb was successfully added to this CX_SoundBuffer, false otherwise.
 */
-bool CX_SoundBuffer::addSound(CX_SoundBuffer nsb, CX_Millis timeOffset) {
+bool CX_SoundBuffer::addSound(const CX_SoundBuffer& nsb, CX_Millis timeOffset) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	if (!nsb.isLoadedSuccessfully() || !this->isLoadedSuccessfully() || &nsb == this ||
+		nsb.getSampleRate() != this->getSampleRate() || nsb.getChannelCount() != this->getChannelCount())
+	{
+		//Anything other than adding a sound in the same format (or a failure) needs a copy.
+		CX_SoundBuffer copy(nsb);
+		return addSound(std::move(copy), timeOffset);
+	}
+
+	_ensureInMemory();
+	_mixIn(nsb, timeOffset);
+	return true;
+}
+
+/*! Equivalent to addSound(const CX_SoundBuffer&, CX_Millis), except that `nsb` is converted in place, if needed,
+and, if this sound buffer is empty, moved from.
+\param nsb A CX_SoundBuffer. Must be successfully loaded.
+\param timeOffset Time at which to add the new sound data.
+\return True if nsb was successfully added to this CX_SoundBuffer, false otherwise. */
+bool CX_SoundBuffer::addSound(CX_SoundBuffer&& nsb, CX_Millis timeOffset) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	_ensureInMemory();
 	if (!nsb.isLoadedSuccessfully()) {
 		CX::Instances::Log.error("CX_SoundBuffer") << "addSound: Added sound buffer not successfully loaded. It will not be added.";
 		return false;
@@ -199,7 +498,7 @@ bool CX_SoundBuffer::addSound(CX_SoundBuffer nsb, CX_Millis timeOffset) {
 
 	//This condition really should have a warning message associated with it.
 	if (!this->isLoadedSuccessfully()) {
-		*this = nsb;
+		*this = std::move(nsb);
 		this->addSilence(timeOffset, true);
 		return true;
 	}
@@ -215,26 +514,29 @@ bool CX_SoundBuffer::addSound(CX_SoundBuffer nsb, CX_Millis timeOffset) {
 		}
 	}
 
-	//Time is in microseconds, so do samples/second * seconds * channels to get the (absolute) sample at which the new sound starts.
-	unsigned int insertionSample = _soundChannels * (unsigned int)(this->getSampleRate() * timeOffset.seconds());
+	_mixIn(nsb, timeOffset);
+	return true;
+}
+
+//Adds `matched`, which has the same sample rate and number of channels as this sound buffer, at the time offset.
+//The sound data is grown, if needed, and the sum is clamped to [-1, 1].
+void CX_SoundBuffer::_mixIn(const CX_SoundBuffer& matched, CX_Millis timeOffset) {
+	MemoryUseUpdate memoryUseUpdate(this);
 
-	//Get the new data that will be merged.
-	vector<float> &newData = nsb.getRawDataReference();
+	//Samples/second * seconds * channels gives the (absolute) sample at which the new sound starts.
+	uint64_t insertionSample = (uint64_t)_soundChannels * (uint64_t)(this->getSampleRate() * timeOffset.seconds());
 
-	//If this sound isn't long enough to hold the new data, resize it to fit.
-	if (insertionSample + newData.size() > this->_soundData.size()) {
-		_soundData.resize( insertionSample + newData.size(), 0 ); //When resizing, set any new elements to silence (i.e. 0).
-	}
+	const float* newData = matched.getSampleData();
+	uint64_t newSampleCount = matched.getTotalSampleCount();
 
-	//Copy over the new data, clamping as needed.
-	for (unsigned int i = 0; i < newData.size(); i++) {
-		float newVal = _soundData[insertionSample + i] + newData[i];
-		newVal = std::max(newVal, -1.0f);
-		newVal = std::min(newVal, 1.0f);
-		_soundData[insertionSample + i] = newVal;
+	//If this sound isn't long enough to hold the new data, resize it to fit.
+	if (insertionSample + newSampleCount > this->_soundData.size()) {
+		_soundData.resize( insertionSample + newSampleCount, 0 ); //When resizing, set any new elements to silence (i.e. 0).
 	}
 
-	return true;
+	float* dest = _soundData.data() + insertionSample;
+	Private::SoundKernels::mix(dest, newData, newSampleCount);
+	Private::SoundKernels::multiplyAndClamp(dest, newSampleCount, 1, -1, 1);
 }
 
 /*! Set the contents of the sound buffer from a vector of float data.
@@ -249,11 +551,14 @@ at some rate (e.g. 48000 samples per second of waveform). `sampleRate` should be
 return True in all cases. No checking is done on any of the arguments.
 */
 bool CX_SoundBuffer::setFromVector(const std::vector<float>& data, int channels, float sampleRate) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
 	if ((data.size() % channels) != 0) {
 		CX::Instances::Log.error("CX_SoundBuffer") << "setFromVector: The size of the sample data was not evenly divisible by the number of channels.";
 		return false;
 	}
 
+	_dropMapping();
 	_soundData = data;
 	_soundChannels = channels;
 	_soundSampleRate = sampleRate;
@@ -261,6 +566,187 @@ bool CX_SoundBuffer::setFromVector(const std::vector<float>& data, int channels,
 	return true;
 }
 
+/*! Set the contents of the sound buffer by moving the samples out of `data`, which avoids copying them. This is
+useful for filling a preallocated vector with samples and then giving it to the sound buffer. See the other overload
+of this function for the meaning of the arguments.
+\return `false` if the size of `data` is not evenly divisible by `channels`, in which case `data` is not moved from. */
+bool CX_SoundBuffer::setFromVector(std::vector<float>&& data, int channels, float sampleRate) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	if ((data.size() % channels) != 0) {
+		CX::Instances::Log.error("CX_SoundBuffer") << "setFromVector: The size of the sample data was not evenly divisible by the number of channels.";
+		return false;
+	}
+
+	_dropMapping();
+	_soundData = std::move(data);
+	_soundChannels = channels;
+	_soundSampleRate = sampleRate;
+	_successfullyLoaded = true;
+	return true;
+}
+
+/*! Maps a sound file into memory instead of reading it, so that the samples are read from the file by the operating system
+only as they are used. This lets very large sounds, or libraries of many sounds, be played without holding all of their samples
+in RAM. Any pre-existing data in the CX_SoundBuffer is deleted. CX_SoundBufferPlayer prefetches the part of the file from
+the playhead to the end of a mapped sound when playback is started or queued, so that the audio callback does not wait for the disk.
+
+The samples must already be in the format that they are played in, so two kinds of files can be mapped:
+WAV files with 32-bit float samples and the cache files written by loadFiles(). Use loadFiles() with a cache directory to
+convert sounds to the format of the sound stream once and map the cache files afterwards.
+
+Copies of a mapped CX_SoundBuffer share the mapping. Functions that change the sound data, including getRawDataReference(),
+first copy the data into memory (see copyToMemory()). Functions that only read the data, like writeToFile() and getSampleData(),
+read from the mapping.
+
+\param fileName The name of the file. Relative paths are relative to the data directory.
+\return `true` if the file was mapped, `false` otherwise.
+\note On 32-bit systems, files that are larger than the free address space, which is often smaller than 2 GB, cannot be mapped.
+*/
+bool CX_SoundBuffer::mapFile(std::string fileName) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	clear();
+
+	std::shared_ptr<Private::CX_MappedFile> file = std::make_shared<Private::CX_MappedFile>();
+	if (!file->open(ofToDataPath(fileName))) {
+		return false;
+	}
+
+	const char* data = file->data();
+	size_t size = file->size();
+
+	uint32_t channels = 0;
+	float sampleRate = 0;
+	size_t dataOffset = 0;
+	size_t dataSize = 0;
+
+	auto read32 = [&](size_t offset) { uint32_t v; std::memcpy(&v, data + offset, 4); return v; };
+	auto read16 = [&](size_t offset) { uint16_t v; std::memcpy(&v, data + offset, 2); return v; };
+
+	if (size >= 24 && std::memcmp(data, cacheMagic, 4) == 0) {
+		uint64_t sampleCount = 0;
+		std::memcpy(&sampleCount, data + 16, 8);
+		if (read32(4) != cacheVersion) {
+			CX::Instances::Log.error("CX_SoundBuffer") << "mapFile(): The cache file " << fileName << " was written by a different version of CX.";
+			return false;
+		}
+		channels = read32(8);
+		std::memcpy(&sampleRate, data + 12, 4);
+		dataOffset = 24;
+		//The cache writer only writes whole sample frames at a positive sample rate, so anything else means the header is corrupt.
+		if (channels == 0 || (sampleCount % channels) != 0 || !(sampleRate > 0 && sampleRate <= 10000000)) {
+			CX::Instances::Log.error("CX_SoundBuffer") << "mapFile(): The cache file " << fileName << " has a corrupt header: " << channels <<
+				" channels, a sample rate of " << sampleRate << ", and " << sampleCount << " samples.";
+			return false;
+		}
+		if (sampleCount > (size - dataOffset) / sizeof(float)) {
+			CX::Instances::Log.error("CX_SoundBuffer") << "mapFile(): The sample data in " << fileName << " is truncated.";
+			return false;
+		}
+		dataSize = (size_t)sampleCount * sizeof(float);
+
+	} else if (size >= 12 && std::memcmp(data, "RIFF", 4) == 0 && std::memcmp(data + 8, "WAVE", 4) == 0) {
+		bool isFloat = false;
+		uint16_t bitsPerSample = 0;
+
+		size_t chunk = 12;
+		while (chunk + 8 <= size) {
+			uint32_t chunkSize = read32(chunk + 4);
+			const char* id = data + chunk;
+
+			if (std::memcmp(id, "fmt ", 4) == 0 && chunkSize >= 16) {
+				uint16_t format = read16(chunk + 8);
+				if (format == 0xFFFE && chunkSize >= 40) {
+					format = read16(chunk + 8 + 24); //The first two bytes of the subformat GUID.
+				}
+				isFloat = (format == 3);
+				channels = read16(chunk + 10);
+				sampleRate = (float)read32(chunk + 12);
+				bitsPerSample = read16(chunk + 22);
+			} else if (std::memcmp(id, "data", 4) == 0) {
+				dataOffset = chunk + 8;
+				dataSize = std::min<size_t>(chunkSize, size - dataOffset);
+				break;
+			}
+
+			if (chunkSize >= size - chunk - 8) {
+				break; //The chunk runs to the end of the file, so there is no data chunk after it.
+			}
+			chunk += 8 + chunkSize + (chunkSize & 1); //Chunks are padded to an even size.
+		}
+
+		if (dataOffset == 0 || channels == 0) {
+			CX::Instances::Log.error("CX_SoundBuffer") << "mapFile(): The WAV file " << fileName << " is missing its format or data.";
+			return false;
+		}
+		if (!isFloat || bitsPerSample != 32) {
+			CX::Instances::Log.error("CX_SoundBuffer") << "mapFile(): The WAV file " << fileName << " does not contain 32-bit float samples. "
+				"Only 32-bit float files can be mapped. Use loadFile() instead, or convert the file with loadFiles() and a cache directory.";
+			return false;
+		}
+
+	} else {
+		CX::Instances::Log.error("CX_SoundBuffer") << "mapFile(): " << fileName << " is not a WAV file or a sound cache file.";
+		return false;
+	}
+
+	//Each value is checked on its own so that the sum cannot overflow.
+	if (dataOffset > size || dataSize > size - dataOffset || (dataOffset % alignof(float)) != 0) {
+		CX::Instances::Log.error("CX_SoundBuffer") << "mapFile(): The sample data in " << fileName << " is truncated or misaligned.";
+		return false;
+	}
+
+	_mappedFile = file;
+	_mappedData = (const float*)(data + dataOffset);
+	_mappedSampleCount = (dataSize / sizeof(float)) - ((dataSize / sizeof(float)) % channels);
+	_soundChannels = channels;
+	_soundSampleRate = sampleRate;
+	_successfullyLoaded = true;
+	name = fileName;
+
+	prefetch(0, (uint64_t)sampleRate); //Start reading the first second.
+
+	return true;
+}
+
+/*! If the sound is mapped from a file (see mapFile()), copies the sound data into memory and stops using the file.
+Otherwise, this does nothing. */
+void CX_SoundBuffer::copyToMemory(void) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	if (!_mappedFile) {
+		return;
+	}
+
+	CX::Instances::Log.verbose("CX_SoundBuffer") << "Copying mapped sound " << name << " into memory.";
+	std::vector<float> data(_mappedData, _mappedData + _mappedSampleCount);
+	_dropMapping();
+	_soundData.swap(data);
+}
+
+/*! If the sound is mapped from a file (see mapFile()), asks the operating system to start reading the given part of the file,
+so that it is in memory by the time it is played. This does not wait for the data. If the sound is not mapped, this does nothing.
+\param startFrame The first sample frame to read.
+\param frameCount The number of sample frames to read. */
+void CX_SoundBuffer::prefetch(uint64_t startFrame, uint64_t frameCount) const {
+	if (!_mappedFile) {
+		return;
+	}
+
+	uint64_t dataOffset = (const char*)_mappedData - _mappedFile->data();
+	uint64_t frameBytes = _soundChannels * sizeof(float);
+	_mappedFile->prefetch((size_t)(dataOffset + startFrame * frameBytes), (size_t)(frameCount * frameBytes));
+}
+
+void CX_SoundBuffer::_dropMapping(void) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	_mappedFile.reset();
+	_mappedData = nullptr;
+	_mappedSampleCount = 0;
+}
+
 /*! Set the contents of a single channel from a vector of float data.
 \param channel The channel to set the data for. If greater than any existing channel, new channels will be created
 so that the number of stored channels is equal to `channel + 1`. If you don't want a bunch of new empty channels, make sure
@@ -272,6 +758,9 @@ If the other channels in the CX_SoundBuffer are shorter than `data`, those chann
 
 */
 void CX_SoundBuffer::setChannelData(unsigned int channel, const std::vector<float>& data) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	_ensureInMemory();
 
 	if (channel >= _soundChannels) {
 		this->setChannelCount(channel + 1, false); //average = false?
@@ -287,12 +776,15 @@ void CX_SoundBuffer::setChannelData(unsigned int channel, const std::vector<floa
 /*! Checks to see if the CX_SoundBuffer is ready to play. It basically just checks if there is sound data
 available and that the number of channels is set to a sane value. */
 bool CX_SoundBuffer::isReadyToPlay (void) {
-	return ((_soundChannels > 0) && (_soundData.size() != 0)); //_successfullyLoaded? _soundSampleRate? Remove _soundChannels?
+	return ((_soundChannels > 0) && (getTotalSampleCount() != 0)); //_successfullyLoaded? _soundSampleRate? Remove _soundChannels?
 }
 
 /*! Set the length of the sound to the specified length in microseconds. If the new length is longer than the old length,
 the new data is zeroed (i.e. set to silence). */
 void CX_SoundBuffer::setLength(CX_Millis length) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	_ensureInMemory();
 	unsigned int endOfDurationSample = _soundChannels * (unsigned int)(getSampleRate() * length.seconds());
 
 	_soundData.resize( endOfDurationSample, 0 );
@@ -300,8 +792,8 @@ void CX_SoundBuffer::setLength(CX_Millis length) {
 
 /*! Gets the length, in time, of the data stored in the sound buffer. This depends on the sample rate of the sound.
 \return The length. */
-CX_Millis CX_SoundBuffer::getLength(void) {
-	return CX_Seconds((double)_soundData.size() / (getChannelCount() * (double)getSampleRate()));
+CX_Millis CX_SoundBuffer::getLength(void) const {
+	return CX_Seconds((double)getTotalSampleCount() / (getChannelCount() * (double)getSampleRate()));
 }
 
 
@@ -309,6 +801,12 @@ CX_Millis CX_SoundBuffer::getLength(void) {
 \return The maximum amplitude.
 \note Amplitudes are between -1 and 1, inclusive. */
 float CX_SoundBuffer::getPositivePeak (void) {
+	if (isMapped()) {
+		if (_mappedSampleCount == 0) {
+			return 0;
+		}
+		return *std::max_element(_mappedData, _mappedData + _mappedSampleCount);
+	}
 	return Util::max(_soundData);
 }
 
@@ -316,6 +814,12 @@ float CX_SoundBuffer::getPositivePeak (void) {
 \return The minimum amplitude.
 \note Amplitudes are between -1 and 1, inclusive. */
 float CX_SoundBuffer::getNegativePeak (void) {
+	if (isMapped()) {
+		if (_mappedSampleCount == 0) {
+			return 0;
+		}
+		return *std::min_element(_mappedData, _mappedData + _mappedSampleCount);
+	}
 	return Util::min(_soundData);
 }
 
@@ -326,12 +830,12 @@ Should be in the interval [0,1], unless clipping is desired. Should be positive
 the waveform.
 */
 void CX_SoundBuffer::normalize(float amount) {
-	float peak = std::max(abs(getPositivePeak()), abs(getNegativePeak()));
-	float multiplier = amount / peak;
-
-	for (unsigned int i = 0; i < _soundData.size(); i++) {
-		_soundData[i] *= multiplier;
+	_ensureInMemory();
+	float peak = Private::SoundKernels::absolutePeak(_soundData.data(), _soundData.size());
+	if (peak == 0) {
+		return; //Silence can't be normalized.
 	}
+	Private::SoundKernels::multiply(_soundData.data(), _soundData.size(), amount / peak);
 }
 
 /*!
@@ -344,6 +848,9 @@ help to give a reference amplitude of which some small fraction is perceived as
 with an absolute value greater than or equal to tolerance is removed from the sound.
 */
 void CX_SoundBuffer::stripLeadingSilence (float tolerance) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	_ensureInMemory();
 	for (unsigned int sampleFrame = 0; sampleFrame < this->getSampleFrameCount(); sampleFrame++) {
 		for (unsigned int channel = 0; channel < _soundChannels; channel++) {
 			unsigned int index = (sampleFrame * _soundChannels) + channel;
@@ -363,6 +870,9 @@ so does the duration of silence.
 \param atBeginning If true, silence is added at the beginning of the CX_SoundBuffer. If false, the silence is added at the end.
 */
 void CX_SoundBuffer::addSilence(CX_Millis duration, bool atBeginning) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	_ensureInMemory();
 	//Time is in microseconds, so do samples/second * seconds * channels to get the absolute sample count for the new silence.
 	unsigned int absoluteSampleCount = _soundChannels * (unsigned int)(getSampleRate() * duration.seconds());
 
@@ -380,6 +890,9 @@ void CX_SoundBuffer::addSilence(CX_Millis duration, bool atBeginning) {
 If false, the sound is deleted from the end, toward the beginning.
 */
 void CX_SoundBuffer::deleteAmount(CX_Millis duration, bool fromBeginning) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	_ensureInMemory();
 	//Time is in microseconds, so do samples/second * seconds * channels to get the absolute sample count to delete.
 	unsigned int absoluteSampleCount = _soundChannels * (unsigned int)(getSampleRate() * duration.seconds());
 
@@ -399,24 +912,27 @@ void CX_SoundBuffer::deleteAmount(CX_Millis duration, bool fromBeginning) {
 \return `true` if there were no errors.
 */
 bool CX_SoundBuffer::deleteChannel(unsigned int channel) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	_ensureInMemory();
 	if (channel >= this->getChannelCount()) {
 		CX::Instances::Log.error("CX_SoundBuffer") << "deleteChannel(): Specified channel does not exist.";
 		return false;
 	}
 
-	std::vector<float> dataCopy;
-
-	for (unsigned int sampleFrame = 0; sampleFrame < this->getSampleFrameCount(); sampleFrame++) {
-		for (unsigned int ch = 0; ch < this->getChannelCount(); ch++) {
+	//The samples are compacted toward the start of the data in place. The write position never passes the read position.
+	uint64_t frames = getSampleFrameCount();
+	size_t write = 0;
+	for (uint64_t sampleFrame = 0; sampleFrame < frames; sampleFrame++) {
+		for (unsigned int ch = 0; ch < _soundChannels; ch++) {
 			if (ch != channel) {
-				unsigned int index = (sampleFrame * this->getChannelCount()) + ch;
-				dataCopy.push_back( this->_soundData[index] );
+				_soundData[write++] = _soundData[(sampleFrame * _soundChannels) + ch];
 			}
 		}
 	}
 
 	_soundChannels -= 1;
-	_soundData = dataCopy;
+	_soundData.resize(write);
 	return true;
 }
 
@@ -456,7 +972,9 @@ average will be added back into the `N` remaining channels. If `false` (the defa
 \return `true` if the conversion was successful, `false` if the attempted conversion is unsupported.
 */
 bool CX_SoundBuffer::setChannelCount (unsigned int newChannelCount, bool average) {
+	MemoryUseUpdate memoryUseUpdate(this);
 
+	_ensureInMemory();
 	unsigned int O = _soundChannels; //Old number of channels
 	unsigned int N = newChannelCount; //New number of channels
 
@@ -495,108 +1013,86 @@ bool CX_SoundBuffer::setChannelCount (unsigned int newChannelCount, bool average
 		return true;
 	}
 
-	if (N == 1) {
-		std::vector<float> newSoundData(this->getSampleFrameCount());
+	//The remaining cases convert the data in place. Each old sample frame is read into `frame` before the new sample
+	//frame is written, so that the new frame can overlap the old one.
+	uint64_t frameCount = this->getSampleFrameCount();
+	std::vector<float> frame(O);
 
+	if (N == 1) {
 		//Anything to mono is easy: just average all sample frames.
-		if (average) {
-			for (unsigned int outputSamp = 0; outputSamp < newSoundData.size(); outputSamp++) {
+		for (uint64_t outputSamp = 0; outputSamp < frameCount; outputSamp++) {
+			if (average) {
 				float avg = 0;
-				for (unsigned int ch = 0; ch < _soundChannels; ch++) {
-					avg += _soundData[(outputSamp * _soundChannels) + ch];
+				for (unsigned int ch = 0; ch < O; ch++) {
+					avg += _soundData[(outputSamp * O) + ch];
 				}
-				avg /= (float)_soundChannels;
-
-				newSoundData[outputSamp] = avg;
-			}
-		} else {
-			//Remove all but the first channel
-			for (unsigned int outputSamp = 0; outputSamp < newSoundData.size(); outputSamp++) {
-				newSoundData[outputSamp] = _soundData[(outputSamp * _soundChannels) + 0];
+				_soundData[outputSamp] = avg / (float)O;
+			} else {
+				//Remove all but the first channel
+				_soundData[outputSamp] = _soundData[(outputSamp * O) + 0];
 			}
-
 		}
 
 		_soundChannels = newChannelCount;
-		_soundData = newSoundData;
+		_soundData.resize(frameCount);
 		return true;
 	}
 
 	if (N > O) {
+		//The data grows, so the sample frames are moved from the end backward.
+		_soundData.resize(frameCount * N);
+
+		for (uint64_t sample = frameCount; sample-- > 0; ) {
+			float avg = 0;
+			for (unsigned int oldChannel = 0; oldChannel < O; oldChannel++) {
+				frame[oldChannel] = _soundData[(sample * O) + oldChannel];
+				avg += frame[oldChannel];
+			}
+			avg /= O;
 
-		std::vector<float> newSoundData( this->getSampleFrameCount() * newChannelCount );
-
-		if (average) {
-			//New channels set to average of existing channels
-			for (unsigned int sample = 0; sample < getSampleFrameCount(); sample++) {
-				float average = 0;
-				for (unsigned int oldChannel = 0; oldChannel < _soundChannels; oldChannel++) {
-					float samp = _soundData[ (sample * _soundChannels) + oldChannel ];
-					average += samp;
-					newSoundData[ (sample * newChannelCount) + oldChannel ] = samp;
-				}
-				average /= _soundChannels;
-
-				for (unsigned int newChannel = _soundChannels; newChannel < newChannelCount; newChannel++) {
-					newSoundData[ (sample * newChannelCount) + newChannel ] = average;
-				}
+			for (unsigned int oldChannel = 0; oldChannel < O; oldChannel++) {
+				_soundData[(sample * N) + oldChannel] = frame[oldChannel];
 			}
-		} else {
-			//Silence new channels
-			vector<float> newSoundData( this->getSampleFrameCount() * newChannelCount );
-			for (unsigned int sample = 0; sample < getSampleFrameCount(); sample++) {
-				for (unsigned int oldChannel = 0; oldChannel < _soundChannels; oldChannel++) {
-					newSoundData[ (sample * newChannelCount) + oldChannel ] = _soundData[ (sample * _soundChannels) + oldChannel ];
-				}
-				for (unsigned int newChannel = _soundChannels; newChannel < newChannelCount; newChannel++) {
-					newSoundData[ (sample * newChannelCount) + newChannel ] = 0;
-				}
+
+			//New channels are set to the average of the existing channels or silenced.
+			for (unsigned int newChannel = O; newChannel < N; newChannel++) {
+				_soundData[(sample * N) + newChannel] = average ? avg : 0;
 			}
 		}
 
 		_soundChannels = newChannelCount;
-		_soundData = newSoundData;
-
 		return true;
 	}
 
 	if (N < O) {
-		std::vector<float> newSoundData( this->getSampleFrameCount() * newChannelCount );
-
-		if (average) {
-			//the data from the `O - N` to-be-removed channels are averaged and added on to the `N` remaining channels
+		//Scaling factors, used if averaging
+		float sigma = (float)N / (float)O;
+		float gamma = 1.0 / (float)N;
 
-			//Scaling factors
-			float sigma = (float)N / (float)O;
-			float gamma = 1.0 / (float)N;
+		for (uint64_t sampleFrame = 0; sampleFrame < frameCount; sampleFrame++) {
+			std::copy(_soundData.begin() + (sampleFrame * O), _soundData.begin() + (sampleFrame * O) + O, frame.begin());
 
-			for (unsigned int sampleFrame = 0; sampleFrame < this->getSampleFrameCount(); sampleFrame++) {
-
-				//Get the sum based on the to be removed channels
+			if (average) {
+				//the data from the `O - N` to-be-removed channels are averaged and added on to the `N` remaining channels
 				float sum = 0;
-				for (unsigned int oldChannel = O - 1; oldChannel >= N; oldChannel--) {
-					sum += _soundData[ (sampleFrame * _soundChannels) + oldChannel ];
+				for (unsigned int oldChannel = N; oldChannel < O; oldChannel++) {
+					sum += frame[oldChannel];
 				}
 
 				//Add the average of the old data to the remaining channels, maintaining equal ratios
 				for (unsigned int keptChannel = 0; keptChannel < N; keptChannel++) {
-					float samp = _soundData[ (sampleFrame * _soundChannels) + keptChannel ];
-					newSoundData[ (sampleFrame * N) + keptChannel ] = (samp + (sum * gamma)) * sigma;
+					_soundData[(sampleFrame * N) + keptChannel] = (frame[keptChannel] + (sum * gamma)) * sigma;
 				}
-			}
-
-		} else {
-			//the data from the `O - N` to-be-removed channels is discarded.
-			for (unsigned int sampleFrame = 0; sampleFrame < this->getSampleFrameCount(); sampleFrame++) {
+			} else {
+				//the data from the `O - N` to-be-removed channels is discarded.
 				for (unsigned int retainedChannel = 0; retainedChannel < N; retainedChannel++) {
-					newSoundData[ (sampleFrame * N) + retainedChannel ] = _soundData[ (sampleFrame * _soundChannels) + retainedChannel ];
+					_soundData[(sampleFrame * N) + retainedChannel] = frame[retainedChannel];
 				}
 			}
 		}
 
 		_soundChannels = newChannelCount;
-		_soundData = newSoundData;
-
+		_soundData.resize(frameCount * N);
 		return true;
 	}
 	/*
@@ -610,52 +1106,49 @@ bool CX_SoundBuffer::setChannelCount (unsigned int newChannelCount, bool average
 }
 
 /*!
-Resamples the audio data stored in the CX_SoundBuffer by linear interpolation. Linear interpolation is not the ideal
-way to resample audio data; some audio fidelity is lost, more so than with other resampling techinques. It is, however,
-very fast compared to higher-quality methods both in terms of run time and programming time. It has acceptable results,
-at least when the new sample rate is similar to the old sample rate.
+Resamples the audio data stored in the CX_SoundBuffer. Except with ResamplingQuality::LINEAR, a windowed-sinc
+(polyphase) filter is used, which preserves the frequency content of the sound up to the lower of the two Nyquist
+frequencies and, when downsampling, removes content above the new Nyquist frequency rather than aliasing it. When
+both sample rates are integers with a small ratio (e.g. 44100 and 48000), the filter coefficients are computed once
+for each output phase, which is substantially faster than the general case.
 
 \param newSampleRate The requested sample rate.
+\param quality The quality of the resampling filter. See CX_SoundBuffer::ResamplingQuality.
 */
-void CX_SoundBuffer::resample(float newSampleRate) {
-	if (newSampleRate == _soundSampleRate) {
+void CX_SoundBuffer::resample(float newSampleRate, ResamplingQuality quality) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	_ensureInMemory();
+	if (newSampleRate == _soundSampleRate || newSampleRate <= 0) {
 		return;
 	}
 
 	uint64_t oldSampleCount = getSampleFrameCount();
 	uint64_t newSampleCount = (uint64_t)(getSampleFrameCount() * ((double)newSampleRate / _soundSampleRate));
 
-	vector<float> completeNewData((unsigned int)newSampleCount * _soundChannels);
-
-	for (unsigned int channel = 0; channel < _soundChannels; channel++) {
-
-		for (unsigned int sample = 0; sample < newSampleCount; sample++) {
-			double time = ((double)sample)/newSampleCount;
-
-			double oldIndex = time * oldSampleCount;
-			double oldIndexOffset = fmod( oldIndex, 1.0 );
-
-			unsigned int i1 = (unsigned int)floor(oldIndex);
-			unsigned int i2 = i1 + 1;
+	vector<float> completeNewData(newSampleCount * _soundChannels);
 
-			//There is a little fudge at the end. If the last sample would be past the end of the old data, reuse the
-			//previous sample. This is technically an error, but at the last sample it can't possibly have a meaningful effect.
-			if (i2 >= oldSampleCount) {
-				i2 = i1;
-			}
-
-			float s1 = _soundData[ (i1 * _soundChannels) + channel ];
-			float s2 = _soundData[ (i2 * _soundChannels) + channel ];
-			float linInt = s1 + (s2 - s1)*(float)oldIndexOffset;
-
-			completeNewData[(sample * _soundChannels) + channel] = linInt;
-		}
+	switch (quality) {
+	case ResamplingQuality::LINEAR:
+		Private::SoundKernels::resampleLinear(_soundData.data(), oldSampleCount, completeNewData.data(), newSampleCount, _soundChannels);
+		break;
+	case ResamplingQuality::FAST:
+		Private::SoundKernels::resampleSinc(_soundData.data(), oldSampleCount, _soundSampleRate,
+			completeNewData.data(), newSampleCount, newSampleRate, _soundChannels, 8, 6);
+		break;
+	case ResamplingQuality::MEDIUM:
+		Private::SoundKernels::resampleSinc(_soundData.data(), oldSampleCount, _soundSampleRate,
+			completeNewData.data(), newSampleCount, newSampleRate, _soundChannels, 16, 8);
+		break;
+	case ResamplingQuality::HIGH:
+		Private::SoundKernels::resampleSinc(_soundData.data(), oldSampleCount, _soundSampleRate,
+			completeNewData.data(), newSampleCount, newSampleRate, _soundChannels, 32, 10);
+		break;
 	}
 
-	_soundData = completeNewData;
+	_soundData.swap(completeNewData);
 
 	_soundSampleRate = newSampleRate;
-
 }
 
 /*! This function returns the number of sample frames in the sound data held by the CX_SoundBuffer,
@@ -664,35 +1157,38 @@ uint64_t CX_SoundBuffer::getSampleFrameCount(void) const {
 	if (_soundChannels == 0) {
 		return 0;
 	}
-	return _soundData.size() / _soundChannels; 
+	return getTotalSampleCount() / _soundChannels; 
 }
 
 /*! This function reverses the sound data stored in the CX_SoundBuffer so that if it is played, it will
 play in reverse. */
 void CX_SoundBuffer::reverse(void) {
-	vector<float> copy = _soundData;
-	unsigned int sampleFrameCount = getSampleFrameCount();
-	for (unsigned int sf = 0; sf < sampleFrameCount; sf++) {
-		unsigned int targetSampleFrame = sf*_soundChannels;
-		unsigned int sourceSampleFrame = (sampleFrameCount - 1 - sf) * _soundChannels;
+	_ensureInMemory();
+	uint64_t sampleFrameCount = getSampleFrameCount();
+	for (uint64_t sf = 0; sf < sampleFrameCount / 2; sf++) {
+		uint64_t targetSampleFrame = sf * _soundChannels;
+		uint64_t sourceSampleFrame = (sampleFrameCount - 1 - sf) * _soundChannels;
 
 		for (unsigned int ch = 0; ch < _soundChannels; ch++) {
-			_soundData[targetSampleFrame + ch] = copy[sourceSampleFrame + ch];
+			std::swap(_soundData[targetSampleFrame + ch], _soundData[sourceSampleFrame + ch]);
 		}
 	}
 }
 
 /*! This function changes the speed of the sound by some multiple.
 \param speedMultiplier Amount to multiply the speed by. Must be greater than 0.
+\param quality The quality of the resampling filter. See resample().
 \note If you would like to use a negative value to reverse the direction of playback, see reverse().
 */
-void CX_SoundBuffer::multiplySpeed(float speedMultiplier) {
+void CX_SoundBuffer::multiplySpeed(float speedMultiplier, ResamplingQuality quality) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
 	if (speedMultiplier <= 0) {
 		return;
 	}
 
 	float sampleRate = this->_soundSampleRate;
-	this->resample( this->getSampleRate() / speedMultiplier );
+	this->resample( this->getSampleRate() / speedMultiplier, quality );
 	this->_soundSampleRate = sampleRate;
 }
 
@@ -716,16 +1212,14 @@ and then clamped to be within [-1, 1].
 is less than 0, the amplitude multiplier is applied to all channels.
 */
 bool CX_SoundBuffer::multiplyAmplitudeBy(float amount, int channel) {
-
+	_ensureInMemory();
 	if (channel >= (int)_soundChannels) {
 		return false;
 	}
 
 	if (channel < 0) {
 		//Apply to all channels
-		for (unsigned int i = 0; i < _soundData.size(); i++) {
-			_soundData[i] = Util::clamp<float>(_soundData[i] * amount, -1, 1);
-		}
+		Private::SoundKernels::multiplyAndClamp(_soundData.data(), _soundData.size(), amount, -1, 1);
 
 	} else {
 		//Apply gain to the given channel
@@ -740,6 +1234,9 @@ bool CX_SoundBuffer::multiplyAmplitudeBy(float amount, int channel) {
 
 /*! Clears all data stored in the sound buffer and returns it to an uninitialized state. */
 void CX_SoundBuffer::clear(void) {
+	MemoryUseUpdate memoryUseUpdate(this);
+
+	_dropMapping();
 	_soundData.clear();
 	_successfullyLoaded = false;
 	_soundChannels = 0;
@@ -806,11 +1303,12 @@ bool CX_SoundBuffer::writeToFile(std::string filename) {
 #define WRITE_BUFF_SIZE 4096
 
 	short writeBuff[WRITE_BUFF_SIZE];
+	const float* samples = getSampleData();
 	unsigned int pos = 0;
 	while (pos < bufferSize) {
 		int len = MIN(WRITE_BUFF_SIZE, bufferSize - pos);
 		for (int i = 0; i < len; i++) {
-			writeBuff[i] = (int)(this->_soundData[pos] * 32767.f);
+			writeBuff[i] = (int)(samples[pos] * 32767.f);
 			pos++;
 		}
 		file.write((char*)writeBuff, len*bitsPerSample / 8);
@@ -820,4 +1318,142 @@ bool CX_SoundBuffer::writeToFile(std::string filename) {
 	return true;
 }
 
+///////////////////////////
+// CX_SoundBufferBuilder //
+///////////////////////////
+
+/*! Constructs a builder for a sound with the given format.
+\param sampleRate The sample rate of the sound that is built. Added sounds are resampled to this rate.
+\param channels The number of channels of the sound that is built. Added sounds are converted to this number of channels. */
+CX_SoundBufferBuilder::CX_SoundBufferBuilder(float sampleRate, unsigned int channels) :
+	_sampleRate(sampleRate),
+	_channels(std::max(channels, 1u)),
+	_end(0)
+{}
+
+/*! Adds a sound at the given time offset from the start of the result. `sound` is not copied, so it must not be
+changed or destroyed before build() is called.
+\param sound The sound. Sounds that are not successfully loaded are ignored with a warning.
+\param timeOffset The time at which the sound starts.
+\return A reference to this builder. */
+CX_SoundBufferBuilder& CX_SoundBufferBuilder::addSound(const CX_SoundBuffer& sound, CX_Millis timeOffset) {
+	if (!sound.isLoadedSuccessfully()) {
+		CX::Instances::Log.warning("CX_SoundBufferBuilder") << "addSound(): The sound is not successfully loaded. It will not be added.";
+		return *this;
+	}
+
+	Placement p;
+	p.sound = &sound;
+	p.timeOffset = timeOffset;
+	_placements.push_back(p);
+
+	_end = std::max(_end, timeOffset + sound.getLength());
+	return *this;
+}
+
+/*! Adds a sound at the given time offset from the start of the result. `sound` is moved into the builder.
+\param sound The sound. Sounds that are not successfully loaded are ignored with a warning.
+\param timeOffset The time at which the sound starts.
+\return A reference to this builder. */
+CX_SoundBufferBuilder& CX_SoundBufferBuilder::addSound(CX_SoundBuffer&& sound, CX_Millis timeOffset) {
+	if (!sound.isLoadedSuccessfully()) {
+		CX::Instances::Log.warning("CX_SoundBufferBuilder") << "addSound(): The sound is not successfully loaded. It will not be added.";
+		return *this;
+	}
+
+	Placement p;
+	p.owned = std::make_shared<CX_SoundBuffer>(std::move(sound));
+	p.sound = p.owned.get();
+	p.timeOffset = timeOffset;
+	_placements.push_back(p);
+
+	_end = std::max(_end, timeOffset + p.sound->getLength());
+	return *this;
+}
+
+/*! Adds a sound right after the end of the sounds and silence that have been added so far. See addSound().
+\param sound The sound. It must not be changed or destroyed before build() is called.
+\return A reference to this builder. */
+CX_SoundBufferBuilder& CX_SoundBufferBuilder::appendSound(const CX_SoundBuffer& sound) {
+	return addSound(sound, _end);
+}
+
+/*! Adds a sound right after the end of the sounds and silence that have been added so far. `sound` is moved into the builder.
+\param sound The sound.
+\return A reference to this builder. */
+CX_SoundBufferBuilder& CX_SoundBufferBuilder::appendSound(CX_SoundBuffer&& sound) {
+	return addSound(std::move(sound), _end);
+}
+
+/*! Extends the end of the result by `duration`, so that the next appended sound starts `duration` after the
+end of the sounds that have been added so far.
+\param duration The duration of the silence.
+\return A reference to this builder. */
+CX_SoundBufferBuilder& CX_SoundBufferBuilder::addSilence(CX_Millis duration) {
+	_end = _end + duration;
+	return *this;
+}
+
+/*! Returns the length of the sound that build() will make. */
+CX_Millis CX_SoundBufferBuilder::getLength(void) const {
+	return _end;
+}
+
+/*! Builds the sound. The result is allocated once and each sound is mixed into it. Sounds that do not have the sample
+rate and number of channels of the result are converted one at a time while mixing. The builder is not changed, so
+build() can be called again, e.g. after adding more sounds.
+\return The sound. If nothing was added, the sound contains only silence for the duration given to addSilence(). */
+CX_SoundBuffer CX_SoundBufferBuilder::build(void) const {
+	auto startFrameOf = [this](CX_Millis t) -> uint64_t {
+		return (uint64_t)(_sampleRate * t.seconds());
+	};
+
+	//The number of frames that a sound will have after it is resampled, as computed by CX_SoundBuffer::resample().
+	auto convertedFrameCount = [this](const CX_SoundBuffer& sound) -> uint64_t {
+		if (sound.getSampleRate() == _sampleRate) {
+			return sound.getSampleFrameCount();
+		}
+		return (uint64_t)(sound.getSampleFrameCount() * ((double)_sampleRate / sound.getSampleRate()));
+	};
+
+	uint64_t totalFrames = startFrameOf(_end);
+	for (const Placement& p : _placements) {
+		totalFrames = std::max(totalFrames, startFrameOf(p.timeOffset) + convertedFrameCount(*p.sound));
+	}
+
+	std::vector<float> data(totalFrames * _channels, 0);
+
+	for (const Placement& p : _placements) {
+		const CX_SoundBuffer* sound = p.sound;
+
+		CX_SoundBuffer converted;
+		if (sound->getSampleRate() != _sampleRate || (unsigned int)sound->getChannelCount() != _channels) {
+			converted = *sound;
+			converted.resample(_sampleRate);
+			if (!converted.setChannelCount(_channels)) {
+				CX::Instances::Log.error("CX_SoundBufferBuilder") << "build(): A sound could not be converted to " << _channels <<
+					" channels. It will not be added.";
+				continue;
+			}
+			sound = &converted;
+		}
+
+		uint64_t start = startFrameOf(p.timeOffset) * _channels;
+		uint64_t count = std::min<uint64_t>(sound->getTotalSampleCount(), data.size() - start);
+		Private::SoundKernels::mix(data.data() + start, sound->getSampleData(), count);
+	}
+
+	Private::SoundKernels::multiplyAndClamp(data.data(), data.size(), 1, -1, 1);
+
+	CX_SoundBuffer result;
+	result.setFromVector(std::move(data), _channels, _sampleRate);
+	return result;
+}
+
+/*! Removes all of the sounds and silence that have been added. */
+void CX_SoundBufferBuilder::clear(void) {
+	_placements.clear();
+	_end = CX_Millis(0);
+}
+
 } //namespace CX
@@ -18,31 +18,84 @@ a potentially large vector of sound samples.
 */
 
 #include <algorithm>
+#include <memory>
 
 #include "ofFmodSoundPlayer.h"
 
 #include "CX_Clock.h"
 #include "CX_Logger.h"
+#include "CX_MemoryUsage.h"
 
 namespace CX {
 
+	namespace Private {
+		class CX_MappedFile;
+	}
+
 	class CX_SoundBuffer {
 	public:
 
+		/*! The quality of the filter used by resample() and multiplySpeed(). Higher quality is slower. */
+		enum class ResamplingQuality {
+			LINEAR, //!< Linear interpolation. Very fast, but attenuates high frequencies and aliases.
+			FAST, //!< A short windowed-sinc filter (8 zero crossings per side).
+			MEDIUM, //!< A windowed-sinc filter with 16 zero crossings per side. Good enough for nearly all stimuli.
+			HIGH //!< A long windowed-sinc filter (32 zero crossings per side) with high stopband attenuation.
+		};
+
+		/*! Settings for loadFiles(). */
+		struct BatchLoadConfiguration {
+			BatchLoadConfiguration(void) :
+				threads(0),
+				sampleRate(0),
+				channels(0),
+				quality(ResamplingQuality::MEDIUM),
+				cacheDirectory("")
+			{}
+
+			unsigned int threads; //!< The number of threads that decode files. If 0, one thread per hardware thread is used.
+
+			/*! The sample rate that the sounds are resampled to. If 0, the sounds keep the sample rate of their files.
+			Usually this is the sample rate of the sound stream that will play them. */
+			float sampleRate;
+
+			/*! The number of channels that the sounds are converted to with setChannelCount(). If 0, the sounds keep the
+			channels of their files. Usually this is the number of output channels of the sound stream that will play them. */
+			unsigned int channels;
+
+			ResamplingQuality quality; //!< The quality of resampling, if the sounds are resampled.
+
+			/*! If not empty, a directory in which the converted sounds are cached. A cached sound is used if the contents of its
+			file and the target format match, so later runs of the experiment skip decoding and conversion. Relative paths are
+			relative to the data directory. */
+			std::string cacheDirectory;
+		};
+
 		CX_SoundBuffer(void);
 
 		bool loadFile(std::string fileName);
 
+		static std::vector<CX_SoundBuffer> loadFiles(const std::vector<std::string>& fileNames, unsigned int threads = 0);
+		static std::vector<CX_SoundBuffer> loadFiles(const std::vector<std::string>& fileNames, const BatchLoadConfiguration& config);
+
 		bool addSound(std::string fileName, CX_Millis timeOffset); //I'm really not sure I want to have this.
-		bool addSound(CX_SoundBuffer so, CX_Millis timeOffset);
+		bool addSound(const CX_SoundBuffer& so, CX_Millis timeOffset);
+		bool addSound(CX_SoundBuffer&& so, CX_Millis timeOffset);
 		bool setFromVector(const std::vector<float>& data, int channels, float sampleRate);
+		bool setFromVector(std::vector<float>&& data, int channels, float sampleRate);
+
+		bool mapFile(std::string fileName);
+		/*! Returns `true` if the sound data is read from a file mapped into memory with mapFile(). */
+		bool isMapped(void) const { return (bool)_mappedFile; };
+		void copyToMemory(void);
+		void prefetch(uint64_t startFrame, uint64_t frameCount) const;
 
 		void clear(void);
 
 		bool isReadyToPlay (void);
 
 		/*! Checks to see if sound data has been successfully loaded into this CX_SoundBuffer from a file. */
-		bool isLoadedSuccessfully (void) { return _successfullyLoaded; }; 
+		bool isLoadedSuccessfully (void) const { return _successfullyLoaded; }; 
 
 		bool applyGain (float gain, int channel = -1);
 		bool multiplyAmplitudeBy (float amount, int channel = -1);
@@ -52,7 +105,7 @@ namespace CX {
 		float getNegativePeak (void);
 
 		void setLength(CX_Millis length);
-		CX_Millis getLength(void);
+		CX_Millis getLength(void) const;
 
 		void stripLeadingSilence (float tolerance);
 		void addSilence(CX_Millis duration, bool atBeginning);
@@ -63,8 +116,8 @@ namespace CX {
 
 		void reverse(void);
 
-		void multiplySpeed (float speedMultiplier);
-		void resample (float newSampleRate);
+		void multiplySpeed (float speedMultiplier, ResamplingQuality quality = ResamplingQuality::MEDIUM);
+		void resample (float newSampleRate, ResamplingQuality quality = ResamplingQuality::MEDIUM);
 		//! Returns the sample rate of the sound data stored in this CX_SoundBuffer.
 		float getSampleRate (void) const { return _soundSampleRate; };
 
@@ -75,13 +128,24 @@ namespace CX {
 		
 		/*! This function returns the total number of samples in the sound data held by the CX_SoundBuffer, 
 		which is equal to the number of sample frames times the number of channels. */
-		uint64_t getTotalSampleCount (void) const { return _soundData.size(); };
+		uint64_t getTotalSampleCount (void) const { return _mappedFile ? _mappedSampleCount : _soundData.size(); };
 
 		uint64_t getSampleFrameCount(void) const;
 
-		/*! This function returns a reference to the raw data underlying the CX_SoundBuffer.
+		/*! This function returns a reference to the raw data underlying the CX_SoundBuffer. If the sound is mapped from
+		a file (see mapFile()), it is first copied into memory. To read the samples without copying them, use getSampleData().
+		If the size of the data is changed through the reference, call updateMemoryUse() afterwards so that the memory use
+		reported by Util::memoryReport() stays correct.
 		\return A reference to the data. Modify at your own risk! */
-		std::vector<float>& getRawDataReference (void) { return _soundData; };
+		std::vector<float>& getRawDataReference (void) { _ensureInMemory(); return _soundData; };
+
+		/*! Updates the memory use reported by Util::memoryReport() for this sound buffer. This only needs to be
+		called after the size of the data was changed through getRawDataReference(). */
+		void updateMemoryUse(void) { _updateMemoryUse(); };
+
+		/*! Returns a pointer to the interleaved samples, of which there are getTotalSampleCount(). This works for mapped
+		sounds without copying them into memory. The pointer is invalidated by any function that changes the sound. */
+		const float* getSampleData(void) const { return _mappedFile ? _mappedData : _soundData.data(); };
 
 		bool writeToFile(std::string path);
 
@@ -99,8 +163,82 @@ namespace CX {
 
 		std::vector<float> _soundData;
 
+		std::shared_ptr<Private::CX_MappedFile> _mappedFile; //Shared by copies of the sound buffer. The file is read only.
+		const float* _mappedData;
+		uint64_t _mappedSampleCount;
+		void _ensureInMemory(void) { if (_mappedFile) { copyToMemory(); } };
+		void _dropMapping(void);
+
+		//Counts the in-memory sample data of this sound buffer in Util::MemoryCategory::SOUND_BUFFERS.
+		Private::CX_TrackedBytes<Util::MemoryCategory::SOUND_BUFFERS> _trackedBytes;
+		void _updateMemoryUse(void) { _trackedBytes.set(_soundData.capacity() * sizeof(float)); };
+
+		//Declared at the top of functions that change _soundData so that the memory use is updated on every return path.
+		struct MemoryUseUpdate {
+			MemoryUseUpdate(CX_SoundBuffer* sb) : _sb(sb) {}
+			~MemoryUseUpdate(void) { _sb->_updateMemoryUse(); }
+			CX_SoundBuffer* _sb;
+		};
+
+		void _mixIn(const CX_SoundBuffer& matched, CX_Millis timeOffset);
+
+		void _convert(const BatchLoadConfiguration& config);
+		bool _readCache(std::string path);
+		bool _writeCache(std::string path) const;
+
 		//float _readSample (int channel, unsigned int sample);
 		//vector<float> _getChannelData (int channel);
 	};
 
+	/*! This class builds a long sound, like a stream of stimuli for a whole block of trials, out of many sounds.
+	Using CX_SoundBuffer::addSound() repeatedly for this grows and rewrites the sound buffer for every sound that is added.
+	This class only records where each sound goes. When build() is called, the length of the result is computed,
+	the result is allocated once, and each sound is mixed into it. Sounds that are given as rvalues are moved into
+	the builder, not copied. Sounds that are not rvalues are not copied either, so they must not be changed or destroyed
+	until build() is called.
+
+	Sounds with a different sample rate or number of channels than the result are converted when they are mixed in,
+	like addSound() does. Unlike with addSound(), the samples of the result are clamped to [-1, 1] only once, after
+	all of the sounds have been mixed, so overlapping sounds that cancel out are not clipped along the way.
+
+	\code{.cpp}
+	CX_SoundBuffer stream = CX_SoundBufferBuilder(48000, 2)
+		.appendSound(fixationTone)
+		.addSilence(CX_Millis(500))
+		.appendSound(word)
+		.addSound(beep, CX_Millis(250)) //Overlaps the word.
+		.build();
+	\endcode
+
+	\ingroup sound
+	*/
+	class CX_SoundBufferBuilder {
+	public:
+
+		CX_SoundBufferBuilder(float sampleRate, unsigned int channels);
+
+		CX_SoundBufferBuilder& addSound(const CX_SoundBuffer& sound, CX_Millis timeOffset);
+		CX_SoundBufferBuilder& addSound(CX_SoundBuffer&& sound, CX_Millis timeOffset);
+		CX_SoundBufferBuilder& appendSound(const CX_SoundBuffer& sound);
+		CX_SoundBufferBuilder& appendSound(CX_SoundBuffer&& sound);
+		CX_SoundBufferBuilder& addSilence(CX_Millis duration);
+
+		CX_Millis getLength(void) const;
+		CX_SoundBuffer build(void) const;
+		void clear(void);
+
+	private:
+
+		struct Placement {
+			const CX_SoundBuffer* sound; //Points to *owned if the sound was moved into the builder.
+			std::shared_ptr<CX_SoundBuffer> owned;
+			CX_Millis timeOffset;
+		};
+
+		float _sampleRate;
+		unsigned int _channels;
+		std::vector<Placement> _placements;
+		CX_Millis _end;
+	};
+
 }
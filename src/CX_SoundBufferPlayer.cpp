@@ -1,5 +1,9 @@
 #include "CX_SoundBufferPlayer.h"
 
+#include <algorithm>
+
+#include "CX_SoundKernels.h"
+
 namespace CX {
 
 CX_SoundBufferPlayer::CX_SoundBufferPlayer(void) :
@@ -9,6 +13,9 @@ CX_SoundBufferPlayer::CX_SoundBufferPlayer(void) :
 	_buffer(nullptr),
 	_withinOutputEvent(false),
 	_playing(false),
+	_amplitudeMultiplier(1),
+	_gain(0),
+	_pan(0),
 	_playbackStartQueued(false),
 	_playbackStartSampleFrame(std::numeric_limits<uint64_t>::max()),
 	_currentSampleFrame(0),
@@ -83,8 +90,9 @@ bool CX_SoundBufferPlayer::play(void) {
 	}
 
 	if ((_buffer != nullptr) && _buffer->isReadyToPlay()) {
-		_playing = true;
 		_soundPlaybackSampleFrame = 0;
+		_prefetch();
+		_playing = true;
 		return true;
 	}
 	CX::Instances::Log.error("CX_SoundBufferPlayer") << "Could not start sound playback. There was a problem with the sound "
@@ -104,7 +112,8 @@ bool CX_SoundBufferPlayer::stop(void) {
 
 The start time is adjusted by an estimate of the latency of the sound stream. This is calculated
 as (N_b - 1) * S_b / SR, where N_b is the number of buffers, S_b is the size of the buffers (in sample 
-frames), and SR is the sample rate, in sample frames per second.
+frames), and SR is the sample rate, in sample frames per second. The measured output latency offset of
+the stream (CX_SoundStream::Configuration::outputLatencyOffset, see CX_LatencyCalibration) is also subtracted.
 
 In order for this function to have any meaningful effect, the request start time, plus any latency 
 adjustments, must be in the future. If `experimentTime` plus `latencyOffset` minus the estimated 
@@ -126,7 +135,7 @@ bool CX_SoundBufferPlayer::startPlayingAt(CX_Millis experimentTime, CX_Millis la
 
 	CX_Millis partialStreamLatency = _soundStream->estimateTotalLatency() - _soundStream->estimateLatencyPerBuffer();
 
-	CX_Millis adjustedStartTime = experimentTime + latencyOffset - partialStreamLatency;
+	CX_Millis adjustedStartTime = experimentTime + latencyOffset - partialStreamLatency - _soundStream->getConfiguration().outputLatencyOffset;
 
 	if (adjustedStartTime <= CX::Instances::Clock.now()) {
 		CX::Instances::Log.warning("CX_SoundBufferPlayer") << "startPlayingAt: Desired start time has already passed. Starting immediately.";
@@ -134,12 +143,9 @@ bool CX_SoundBufferPlayer::startPlayingAt(CX_Millis experimentTime, CX_Millis la
 		return false;
 	}
 
-	CX_Millis lastSwapTime = _soundStream->getLastSwapTime(); //This is the time at which the last swap started (i.e. as soon as the fill buffer callback was called).
-	uint64_t samplesFramesSinceLastSwap = (adjustedStartTime - lastSwapTime).seconds() * this->getConfiguration().sampleRate;
-
-	uint64_t lastSwapStartSFNumber = _soundStream->getSampleFrameNumber() - this->getConfiguration().bufferSize; //Go back to the previous buffer start SF
-
-	_playbackStartSampleFrame = lastSwapStartSFNumber + samplesFramesSinceLastSwap;
+	//The stream tracks the relationship between sample frames and time, so the jitter of the audio callbacks does not affect the start time.
+	_playbackStartSampleFrame = std::max(_soundStream->timeToSampleFrame(adjustedStartTime), _soundStream->getSampleFrameNumber());
+	_prefetch();
 	_playbackStartQueued = true;
 	return true;
 }
@@ -158,6 +164,36 @@ void CX_SoundBufferPlayer::seek(CX_Millis time) {
 			;
 	}
 	_soundPlaybackSampleFrame = time.seconds() * this->getConfiguration().sampleRate;
+	_prefetch();
+}
+
+/*! Sets the gain that is applied to the sound as it is played. Unlike CX_SoundBuffer::applyGain(), the
+sound buffer is not modified, so the gain can be changed at any time, including during playback, and
+the same CX_SoundBuffer can be played by several players at different levels.
+\param decibels The gain, in decibels. 0 dB (the default) plays the sound at its recorded level. Unlike
+CX_SoundBuffer::applyGain(), the result is not clamped to [-1, 1]. */
+void CX_SoundBufferPlayer::setGain(float decibels) {
+	_gain = decibels;
+	_amplitudeMultiplier = pow(10.0f, decibels / 20.0f);
+}
+
+/*! Returns the gain, in decibels, that was set with setGain(). */
+float CX_SoundBufferPlayer::getGain(void) const {
+	return _gain;
+}
+
+/*! Sets the stereo balance of the sound as it is played. This only has an effect if the sound stream
+has at least two output channels, in which case it affects the first two channels (left and right).
+\param pan A value in the interval [-1, 1]. At -1, only the left channel is heard, at 1 only the right
+channel is heard. At 0 (the default), both channels are played at full level. Between 0 and 1, the level of 
+the left channel is reduced linearly and vice versa. */
+void CX_SoundBufferPlayer::setPan(float pan) {
+	_pan = Util::clamp<float>(pan, -1, 1);
+}
+
+/*! Returns the pan that was set with setPan(). */
+float CX_SoundBufferPlayer::getPan(void) const {
+	return _pan;
 }
 
 /*! Returns the configuration used for this CX_SoundBufferPlayer. */
@@ -233,7 +269,8 @@ CX_SoundBuffer* CX_SoundBufferPlayer::getSoundBuffer(void) {
 }
 
 bool CX_SoundBufferPlayer::_outputEventHandler(CX_SoundStream::OutputEventArgs &outputData) {
-	
+	CX_SoundStream::ListenerScope watchdog(outputData.instance, "CX_SoundBufferPlayer");
+
 	if ((!_playing && !_playbackStartQueued) || (_buffer == nullptr)) {
 		return false;
 	}
@@ -242,7 +279,8 @@ bool CX_SoundBufferPlayer::_outputEventHandler(CX_SoundStream::OutputEventArgs &
 
 	uint64_t sampleFramesToOutput = outputData.bufferSize;
 	uint64_t outputBufferOffset = 0;
-	std::vector<float> &soundData = _buffer->getRawDataReference();
+	const float* soundData = _buffer->getSampleData();
+	uint64_t soundSampleCount = _buffer->getTotalSampleCount();
 	const CX_SoundStream::Configuration &config = this->getConfiguration();
 
 	if (_playbackStartQueued) {
@@ -258,21 +296,34 @@ bool CX_SoundBufferPlayer::_outputEventHandler(CX_SoundStream::OutputEventArgs &
 		}
 	}
 
-	if (soundData.size() < ((_soundPlaybackSampleFrame + outputData.bufferSize - outputBufferOffset) * config.outputChannels)) {
+	if (soundSampleCount < ((_soundPlaybackSampleFrame + outputData.bufferSize - outputBufferOffset) * config.outputChannels)) {
 		//If there is not enough data to completely fill the sound buffer, so only use some of it.
-		sampleFramesToOutput = (soundData.size() / config.outputChannels) - _soundPlaybackSampleFrame - outputBufferOffset;
+		sampleFramesToOutput = (soundSampleCount / config.outputChannels) - _soundPlaybackSampleFrame - outputBufferOffset;
 		_playing = false;
 	}
 
 	//Copy over the data, adding to the existing data. Addition allows multiple CX_SoundBufferPlayers to play into
-	//the same sound stream at the same time.
+	//the same sound stream at the same time. Gain and pan are applied while mixing.
 	if (sampleFramesToOutput > 0) {
-		unsigned int rawSamplesToOutput = sampleFramesToOutput * config.outputChannels; //not times sizeof(float)!
-		float *rawData = soundData.data() + (_soundPlaybackSampleFrame * config.outputChannels);
-		float *dataTarget = outputData.outputBuffer + outputBufferOffset;
-
-		for (unsigned int i = 0; i < rawSamplesToOutput; i++) {
-			dataTarget[i] += rawData[i];
+		unsigned int channels = config.outputChannels;
+		const float *rawData = soundData + (_soundPlaybackSampleFrame * channels);
+		float *dataTarget = outputData.outputBuffer + (outputBufferOffset * channels);
+
+		float amplitude = _amplitudeMultiplier;
+		float pan = _pan;
+
+		if (pan == 0 || channels < 2) {
+			if (amplitude == 1) {
+				Private::SoundKernels::mix(dataTarget, rawData, sampleFramesToOutput * channels);
+			} else {
+				Private::SoundKernels::mixWithGain(dataTarget, rawData, sampleFramesToOutput * channels, amplitude);
+			}
+		} else {
+			_channelGains.resize(channels); //Only allocates the first time.
+			std::fill(_channelGains.begin(), _channelGains.end(), amplitude);
+			_channelGains[0] = amplitude * std::min(1.0f, 1.0f - pan);
+			_channelGains[1] = amplitude * std::min(1.0f, 1.0f + pan);
+			Private::SoundKernels::mixWithChannelGains(dataTarget, rawData, sampleFramesToOutput, channels, _channelGains.data());
 		}
 	}
 
@@ -281,7 +332,21 @@ bool CX_SoundBufferPlayer::_outputEventHandler(CX_SoundStream::OutputEventArgs &
 	_soundPlaybackSampleFrame += sampleFramesToOutput;
 
 	_withinOutputEvent = false;
-	return true;
+	return false; //Returning true would stop the event from reaching later listeners, like a CX_TriggerOutput on the same stream.
+}
+
+//For sounds mapped from files (see CX_SoundBuffer::mapFile()), asks for the part of the file from the playhead to the end
+//of the sound to be read in the background. This is only called on the main thread, from play(), startPlayingAt(), and seek(),
+//because asking the operating system to read the file is a system call, which the audio callback must not make.
+void CX_SoundBufferPlayer::_prefetch(void) {
+	if (_buffer == nullptr || !_buffer->isMapped()) {
+		return;
+	}
+
+	uint64_t totalFrames = _buffer->getSampleFrameCount();
+	if (_soundPlaybackSampleFrame < totalFrames) {
+		_buffer->prefetch(_soundPlaybackSampleFrame, totalFrames - _soundPlaybackSampleFrame);
+	}
 }
 
 void CX_SoundBufferPlayer::_listenForEvents(bool listen) {
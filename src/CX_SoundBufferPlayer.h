@@ -3,7 +3,7 @@
 /*! \defgroup sound Sound
 There are a few different ways to deal with sounds in CX. The thing that most people want to do is to
 play sounds, which is done with the CX_SoundBufferPlayer. See the soundBuffer tutorial for information
-on how to do that.
+on how to do that. To play many overlapping sounds with sample-accurate onsets, use the CX_SoundMixer.
 
 If you want to record sound, use the CX_SoundBufferRecorder.
 
@@ -20,6 +20,8 @@ Finally, if you want to have direct control of the data going to and from a soun
 
 #include "ofEvents.h"
 
+#include <atomic>
+
 namespace CX  {
 
 
@@ -59,6 +61,11 @@ namespace CX  {
 
 		void seek(CX_Millis time);
 
+		void setGain(float decibels);
+		float getGain(void) const;
+		void setPan(float pan);
+		float getPan(void) const;
+
 	private:
 
 		bool _outputEventHandler (CX_SoundStream::OutputEventArgs &outputData);
@@ -76,10 +83,17 @@ namespace CX  {
 
 		bool _playing;
 
+		std::atomic<float> _amplitudeMultiplier;
+		std::atomic<float> _gain;
+		std::atomic<float> _pan;
+		std::vector<float> _channelGains;
+
 		bool _playbackStartQueued;
 		uint64_t _playbackStartSampleFrame;
 		uint64_t _currentSampleFrame; //This is an absolute: It is never reset. At a sample rate of 48000 Hz, this will overflow every 12186300 years.
 		uint64_t _soundPlaybackSampleFrame;	//This is relative to the current playback of the current sound buffer.
+
+		void _prefetch(void);
 	};
 
 }
@@ -4,6 +4,17 @@ namespace CX {
 
 CX_SoundBufferRecorder::CX_SoundBufferRecorder(void) :
 	_recording(false),
+	_handlersActive(0),
+	_draining(false),
+	_readingRing(false),
+	_staging(false),
+	_storageMode(StorageMode::CONTIGUOUS),
+	_chunkDuration(CX_Seconds(10)),
+	_reservedDuration(0),
+	_freeChunkCount(0),
+	_currentChunk(nullptr),
+	_chunkSamples(0),
+	_droppedSamples(0),
 	_buffer(nullptr),
 	_soundStream(nullptr),
 	_soundStreamSelfAllocated(false),
@@ -80,10 +91,12 @@ void CX_SoundBufferRecorder::setSoundBuffer(CX_SoundBuffer* soundBuffer) {
 	_buffer->setFromVector(vector<float>(), config.inputChannels, config.sampleRate);
 }
 
-/*! This function returns a pointer to the CX_SoundBuffer that is currently in use by the CX_SoundBufferRecorder. */
+/*! This function returns a pointer to the CX_SoundBuffer that is currently in use by the CX_SoundBufferRecorder. 
+While recording, the data that is being recorded is not in the CX_SoundBuffer: It is moved into it by stop(). */
 CX_SoundBuffer* CX_SoundBufferRecorder::getSoundBuffer(void) {
 	if (_recording) {
-		CX::Instances::Log.warning("CX_SoundBufferRecorder") << "getSoundBuffer(): Sound buffer pointer accessed while recording was in progress.";
+		CX::Instances::Log.warning("CX_SoundBufferRecorder") << "getSoundBuffer(): Sound buffer pointer accessed while recording was in progress. "
+			"The sound buffer will not contain the data that is being recorded until stop() is called.";
 	}
 	return _buffer;
 }
@@ -97,15 +110,93 @@ void CX_SoundBufferRecorder::start(bool clearExistingData) {
 		CX::Instances::Log.error("CX_SoundBufferRecorder") << "start(): Unable to start recording because no CX_SoundBuffer was set.";
 		return;
 	}
+	if (_recording) {
+		return;
+	}
+
 	if (clearExistingData) {
 		_buffer->getRawDataReference().clear();
 	}
+	_recordedData.clear(); //Keeps the capacity set aside by reserve().
+
+	if (_storageMode == StorageMode::CHUNKED) {
+		const Configuration& config = _soundStream->getConfiguration();
+		_chunkSamples = std::max<size_t>((size_t)(_chunkDuration.seconds() * config.sampleRate) * config.inputChannels, 1);
+
+		size_t chunkCount = std::max<size_t>((size_t)ceil(_reservedDuration.seconds() / _chunkDuration.seconds()) + 1, 2);
+		_freeChunks.setup(std::max<size_t>(chunkCount, 16));
+		for (size_t i = 0; i < chunkCount; i++) {
+			_allocateChunk();
+		}
+		_droppedSamples = 0;
+	}
+
+	CX_SPSCRingBuffer<float>* ring = (_soundStream != nullptr) ? _soundStream->getInputRingBuffer() : nullptr;
+	_readingRing = (ring != nullptr);
+	if (ring != nullptr) {
+		_drainScratch.resize(ring->capacity());
+		ring->discard(ring->getReadAvailable()); //Throw away anything that was recorded before starting.
+	}
+
+	//Growing _recordedData in the audio thread could allocate, so the data is staged and stored by the drain thread.
+	//The drain thread empties the ring about twice per audio buffer, so a ring of at least 16 buffers (or half a second) is plenty.
+	_staging = (ring == nullptr && _storageMode == StorageMode::CONTIGUOUS);
+	if (_staging) {
+		const Configuration& config = _soundStream->getConfiguration();
+		size_t frames = std::max<size_t>((size_t)config.bufferSize * 16, (size_t)config.sampleRate / 2);
+		size_t capacity = std::max<size_t>(frames * config.inputChannels, 1);
+		if (_stagingRing.capacity() < capacity) {
+			_stagingRing.setup(capacity);
+		} else {
+			_stagingRing.clear();
+		}
+		_drainScratch.resize(_stagingRing.capacity());
+	}
+
+	if (_readingRing || _staging || _storageMode == StorageMode::CHUNKED) {
+		_draining = true;
+		_drainThread = std::thread(&CX_SoundBufferRecorder::_drainLoop, this);
+	}
+
 	_recording = true;
 }
 
-/*! \brief Stop recording sound data. */
+/*! Stop recording sound data. When this returns, all of the recorded data is in the CX_SoundBuffer. */
 void CX_SoundBufferRecorder::stop(void) {
 	_recording = false;
+	_waitForHandlers();
+
+	//Nothing is storing data after the handlers are done and the drain thread has been joined, so the data can be flushed.
+	if (_drainThread.joinable()) {
+		_draining = false;
+		_drainThread.join();
+	}
+	if (_readingRing) {
+		if (_storageMode == StorageMode::CHUNKED) {
+			_refillChunks();
+		}
+		_drainRingBuffer(); //Get whatever came in after the thread last checked.
+		_readingRing = false;
+	}
+	if (_staging) {
+		_drainRingBuffer();
+		_staging = false;
+		if (_stagingRing.getDroppedCount() > 0) {
+			CX::Instances::Log.warning("CX_SoundBufferRecorder") << "stop(): " << _stagingRing.getDroppedCount() << " samples were dropped because " <<
+				"the staging ring buffer was full.";
+		}
+	}
+
+	_moveRecordedData();
+	_flushChunks();
+}
+
+//Waits until no input event handler is using the recorded data. A handler that starts after _recording has been set to
+//false sees that it is false, because the handler counts itself as active before checking it.
+void CX_SoundBufferRecorder::_waitForHandlers(void) {
+	while (_handlersActive.load() > 0) {
+		std::this_thread::yield();
+	}
 }
 
 /*! \brief Returns `true` is currently recording. */
@@ -113,6 +204,46 @@ bool CX_SoundBufferRecorder::isRecording(void) const {
 	return _recording;
 }
 
+/*! Sets how recorded data is stored while recording is in progress. See StorageMode for the options.
+This cannot be changed while recording.
+\param mode The storage mode to use.
+\param chunkDuration If `mode` is StorageMode::CHUNKED, the duration of audio held in each chunk. */
+void CX_SoundBufferRecorder::setStorageMode(StorageMode mode, CX_Millis chunkDuration) {
+	if (_recording) {
+		CX::Instances::Log.error("CX_SoundBufferRecorder") << "setStorageMode(): The storage mode cannot be changed while recording.";
+		return;
+	}
+	_storageMode = mode;
+	_chunkDuration = chunkDuration;
+}
+
+/*! Returns the storage mode that was set with setStorageMode(). */
+CX_SoundBufferRecorder::StorageMode CX_SoundBufferRecorder::getStorageMode(void) const {
+	return _storageMode;
+}
+
+/*! Sets aside space for `expectedDuration` of audio so that, in StorageMode::CONTIGUOUS,
+the buffer does not need to grow while recording unless the recording is longer than expected. In StorageMode::CHUNKED,
+enough chunks for `expectedDuration` are allocated in start(). This should be called before start().
+\param expectedDuration The expected duration of the recording. */
+void CX_SoundBufferRecorder::reserve(CX_Millis expectedDuration) {
+	if (_buffer == nullptr || _soundStream == nullptr) {
+		CX::Instances::Log.error("CX_SoundBufferRecorder") << "reserve(): Unable to reserve space because the recorder has not been set up or no CX_SoundBuffer was set.";
+		return;
+	}
+
+	if (_recording) {
+		CX::Instances::Log.error("CX_SoundBufferRecorder") << "reserve(): Space cannot be reserved while recording.";
+		return;
+	}
+
+	const Configuration& config = _soundStream->getConfiguration();
+	size_t samples = (size_t)ceil(expectedDuration.seconds() * config.sampleRate) * config.inputChannels;
+
+	_recordedData.reserve(samples);
+	_reservedDuration = expectedDuration;
+}
+
 
 /*! Returns the configuration used for this CX_SoundBufferRecorder. */
 CX_SoundBufferRecorder::Configuration CX_SoundBufferRecorder::getConfiguration(void) {
@@ -126,19 +257,152 @@ CX_SoundBufferRecorder::Configuration CX_SoundBufferRecorder::getConfiguration(v
 
 
 bool CX_SoundBufferRecorder::_inputEventHandler(CX_SoundStream::InputEventArgs& inputData) {
-	if (!_recording) {
-		return false;
+	CX_SoundStream::ListenerScope watchdog(inputData.instance, "CX_SoundBufferRecorder");
+
+	_handlersActive++;
+	if (!_recording || _readingRing) {
+		_handlersActive--;
+		return false; //The data is taken from the ring buffer instead.
 	}
 
 	unsigned int totalNewSamples = inputData.bufferSize * inputData.inputChannels;
+	if (_staging) {
+		_stagingRing.write(inputData.inputBuffer, totalNewSamples);
+	} else {
+		_appendData(inputData.inputBuffer, totalNewSamples);
+	}
+	_handlersActive--;
+	return true;
+}
+
+void CX_SoundBufferRecorder::_appendData(const float* data, size_t count) {
+	if (_storageMode == StorageMode::CONTIGUOUS) {
+		size_t currentBufferEnd = _recordedData.size();
+		_recordedData.resize(currentBufferEnd + count);
+		memcpy(_recordedData.data() + currentBufferEnd, data, count * sizeof(float));
+		return;
+	}
+
+	_appendChunked(data, count);
+}
+
+//Stores data in the chunks that have been allocated. If there are none left, the data is dropped rather than allocating here.
+void CX_SoundBufferRecorder::_appendChunked(const float* data, size_t count) {
+	while (count > 0) {
+		if (_currentChunk == nullptr || _currentChunk->size() == _currentChunk->capacity()) {
+			std::vector<float>* next = nullptr;
+			if (!_freeChunks.pop(&next)) {
+				_currentChunk = nullptr;
+				_droppedSamples += count;
+				return;
+			}
+			_freeChunkCount--;
+			_currentChunk = next;
+		}
+
+		size_t n = std::min(count, _currentChunk->capacity() - _currentChunk->size());
+		_currentChunk->insert(_currentChunk->end(), data, data + n); //Never exceeds the capacity, so never reallocates.
+		data += n;
+		count -= n;
+	}
+}
+
+void CX_SoundBufferRecorder::_allocateChunk(void) {
+	std::unique_ptr<std::vector<float>> chunk(new std::vector<float>());
+	chunk->reserve(_chunkSamples);
+	if (_freeChunks.push(chunk.get())) {
+		_chunkStorage.push_back(std::move(chunk));
+		_freeChunkCount++;
+	}
+}
+
+//Keeps a couple of chunks ready so that the thread that stores data never runs out while the next one is allocated.
+void CX_SoundBufferRecorder::_refillChunks(void) {
+	while (_freeChunkCount.load() < 2 && _freeChunks.capacity() > _freeChunkCount.load()) {
+		_allocateChunk();
+	}
+}
+
+void CX_SoundBufferRecorder::_moveRecordedData(void) {
+	if (_recordedData.empty() || _buffer == nullptr) {
+		return;
+	}
 
 	vector<float>& soundData = _buffer->getRawDataReference();
-	unsigned int currentBufferEnd = soundData.size();
+	if (soundData.empty()) {
+		soundData.swap(_recordedData);
+	} else {
+		soundData.insert(soundData.end(), _recordedData.begin(), _recordedData.end());
+	}
+	_buffer->updateMemoryUse();
+	_recordedData.clear();
+}
+
+void CX_SoundBufferRecorder::_flushChunks(void) {
+	if (_chunkStorage.empty()) {
+		return;
+	}
 
-	soundData.resize(soundData.size() + totalNewSamples);
+	if (_buffer != nullptr) {
+		size_t total = 0;
+		for (const std::unique_ptr<std::vector<float>>& chunk : _chunkStorage) {
+			total += chunk->size();
+		}
 
-	memcpy(soundData.data() + currentBufferEnd, inputData.inputBuffer, (size_t)(totalNewSamples * sizeof(float)));
-	return true;
+		vector<float>& soundData = _buffer->getRawDataReference();
+		soundData.reserve(soundData.size() + total);
+		for (const std::unique_ptr<std::vector<float>>& chunk : _chunkStorage) {
+			soundData.insert(soundData.end(), chunk->begin(), chunk->end());
+		}
+		_buffer->updateMemoryUse();
+	}
+
+	if (_droppedSamples > 0) {
+		CX::Instances::Log.warning("CX_SoundBufferRecorder") << "stop(): " << _droppedSamples.load() << " samples were dropped because " <<
+			"no chunk was ready to store them. Use a longer chunk duration or reserve() the expected duration of the recording.";
+	}
+
+	std::vector<float>* unused = nullptr;
+	while (_freeChunks.pop(&unused))
+		;
+	_freeChunkCount = 0;
+	_currentChunk = nullptr;
+	_chunkStorage.clear();
+}
+
+void CX_SoundBufferRecorder::_drainLoop(void) {
+	//Check about twice per audio buffer, so that the ring buffer never gets close to full.
+	CX_Millis period = _soundStream->estimateLatencyPerBuffer() / 2;
+	std::chrono::microseconds sleepTime((long long)std::max(period.micros(), 500.0));
+
+	while (_draining) {
+		if (_readingRing || _staging) {
+			_drainRingBuffer();
+		}
+		if (_storageMode == StorageMode::CHUNKED) {
+			_refillChunks();
+		}
+		std::this_thread::sleep_for(sleepTime);
+	}
+}
+
+CX_SPSCRingBuffer<float>* CX_SoundBufferRecorder::_getDrainedRing(void) {
+	if (_staging) {
+		return &_stagingRing;
+	}
+	return _soundStream->getInputRingBuffer();
+}
+
+void CX_SoundBufferRecorder::_drainRingBuffer(void) {
+	CX_SPSCRingBuffer<float>* ring = _getDrainedRing();
+	if (ring == nullptr) {
+		return;
+	}
+
+	size_t count = ring->read(_drainScratch.data(), _drainScratch.size());
+	if (count > 0) {
+		_appendData(_drainScratch.data(), count);
+	}
 }
 
 void CX_SoundBufferRecorder::_listenForEvents(bool listen) {
@@ -158,6 +422,7 @@ void CX_SoundBufferRecorder::_listenForEvents(bool listen) {
 void CX_SoundBufferRecorder::_cleanUpOldSoundStream(void) {
 	//If another sound stream was connected, stop listening to it.
 	if (_soundStream != nullptr) {
+		this->stop();
 		_listenForEvents(false);
 
 		if (_soundStreamSelfAllocated) {
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <thread>
+
 #include "CX_SoundStream.h"
 #include "CX_SoundBuffer.h"
+#include "CX_MPSCQueue.h"
 
 namespace CX {
 	/*! This class is used for recording audio data from, e.g., a microphone. The recorded data is
@@ -26,12 +31,40 @@ namespace CX {
 	//Write the recording to a file
 	recording.writeToFile("recording.wav");
 	\endcode
+
+	If the CX_SoundStream has an input ring buffer (see CX_SoundStream::Configuration::inputRingBufferSize),
+	the recorder copies the data out of the ring buffer in its own thread rather than in the audio thread,
+	so that storing the data never delays the audio thread. In that case, the recorder must be the 
+	only reader of the ring buffer.
+
+	While recording, the data is stored in memory owned by the recorder, not in the CX_SoundBuffer, so the CX_SoundBuffer
+	is never touched by another thread. The recorded data is moved into the CX_SoundBuffer when stop() is called.
+
+	For long recordings, the cost of growing a single contiguous buffer can be avoided either by 
+	reserving space for the expected duration with reserve() or by using StorageMode::CHUNKED (see setStorageMode()).
 	\ingroup sound
 	*/
 	class CX_SoundBufferRecorder {
 	public:
 		typedef CX_SoundStream::Configuration Configuration; //!< This is typedef'ed to \ref CX::CX_SoundStream::Configuration.
 
+		/*! How recorded data is stored while recording is in progress. */
+		enum class StorageMode {
+			/*! Data is appended to a single buffer. When the buffer runs out of space, all of the 
+			data is copied to a larger buffer, which gets slower as the recording gets longer, unless space was 
+			set aside with reserve(). If the CX_SoundStream has no input ring buffer, the audio thread puts the data
+			into a preallocated staging ring buffer owned by the recorder and the buffer is grown by a background 
+			thread of the recorder, so the audio thread never allocates memory. */
+			CONTIGUOUS,
+
+			/*! Data is stored in a series of fixed-size chunks, so the cost of storing each new block of data 
+			does not depend on how long the recording is. The chunks are allocated ahead of time by a background
+			thread of the recorder (or all at once in start(), for the duration given to reserve()), so storing data
+			never allocates memory on the thread that delivers it. The chunks are copied into the CX_SoundBuffer when 
+			stop() is called. */
+			CHUNKED
+		};
+
 		CX_SoundBufferRecorder(void);
 		~CX_SoundBufferRecorder(void);
 
@@ -51,10 +84,48 @@ namespace CX {
 
 		bool isRecording(void) const;
 
+		void setStorageMode(StorageMode mode, CX_Millis chunkDuration = CX_Seconds(10));
+		StorageMode getStorageMode(void) const;
+		void reserve(CX_Millis expectedDuration);
+
 	private:
 		bool _inputEventHandler(CX_SoundStream::InputEventArgs& inputData);
 
-		bool _recording;
+		std::atomic<bool> _recording;
+		std::atomic<int> _handlersActive; //The number of input event handlers that are running. See stop().
+		void _waitForHandlers(void);
+
+		std::vector<float> _recordedData; //Filled while recording in StorageMode::CONTIGUOUS and moved into _buffer by stop().
+		void _moveRecordedData(void);
+
+		std::thread _drainThread;
+		std::atomic<bool> _draining;
+		std::atomic<bool> _readingRing; //If true, the data is taken from the input ring buffer instead of the input events.
+		std::atomic<bool> _staging; //If true, the input events put the data into _stagingRing instead of storing it.
+		CX_SPSCRingBuffer<float> _stagingRing;
+		CX_SPSCRingBuffer<float>* _getDrainedRing(void);
+		void _drainLoop(void);
+		void _drainRingBuffer(void);
+		std::vector<float> _drainScratch;
+
+		StorageMode _storageMode;
+		CX_Millis _chunkDuration;
+		CX_Millis _reservedDuration;
+		void _appendData(const float* data, size_t count);
+
+		//The chunks are allocated by the drain thread (or by the main thread when not recording) and handed to the thread
+		//that stores data through _freeChunks. They are used in the order in which they were allocated, so _chunkStorage
+		//holds the recording in order.
+		std::vector<std::unique_ptr<std::vector<float>>> _chunkStorage;
+		CX_MPSCQueue<std::vector<float>*> _freeChunks;
+		std::atomic<size_t> _freeChunkCount;
+		std::vector<float>* _currentChunk; //Only used by the thread that stores data.
+		size_t _chunkSamples;
+		std::atomic<uint64_t> _droppedSamples;
+		void _allocateChunk(void);
+		void _refillChunks(void);
+		void _appendChunked(const float* data, size_t count);
+		void _flushChunks(void);
 
 		CX_SoundBuffer *_buffer;
 
@@ -0,0 +1,384 @@
+#include "CX_SoundKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if !defined(CX_SOUND_NO_SIMD)
+#	if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#		define CX_SOUND_USE_SSE
+#		include <xmmintrin.h>
+#	elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#		define CX_SOUND_USE_NEON
+#		include <arm_neon.h>
+#	endif
+#endif
+
+namespace CX {
+namespace Private {
+namespace SoundKernels {
+
+/*! Adds `count` samples from `src` to `dest`. */
+void mix(float* dest, const float* src, size_t count) {
+	size_t i = 0;
+#if defined(CX_SOUND_USE_SSE)
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), _mm_loadu_ps(src + i)));
+	}
+#elif defined(CX_SOUND_USE_NEON)
+	for (; i + 4 <= count; i += 4) {
+		vst1q_f32(dest + i, vaddq_f32(vld1q_f32(dest + i), vld1q_f32(src + i)));
+	}
+#endif
+	for (; i < count; i++) {
+		dest[i] += src[i];
+	}
+}
+
+/*! Adds `count` samples from `src`, each multiplied by `gain`, to `dest`. */
+void mixWithGain(float* dest, const float* src, size_t count, float gain) {
+	size_t i = 0;
+#if defined(CX_SOUND_USE_SSE)
+	__m128 g = _mm_set1_ps(gain);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), _mm_mul_ps(_mm_loadu_ps(src + i), g)));
+	}
+#elif defined(CX_SOUND_USE_NEON)
+	float32x4_t g = vdupq_n_f32(gain);
+	for (; i + 4 <= count; i += 4) {
+		vst1q_f32(dest + i, vmlaq_f32(vld1q_f32(dest + i), vld1q_f32(src + i), g));
+	}
+#endif
+	for (; i < count; i++) {
+		dest[i] += src[i] * gain;
+	}
+}
+
+/*! Adds `frames` sample frames of interleaved data from `src` to `dest`, with each channel multiplied
+by its own gain. This is how per-channel gain (e.g. panning) is applied without modifying `src`.
+\param dest The interleaved data to add to.
+\param src The interleaved data to add.
+\param frames The number of sample frames.
+\param channels The number of channels in both `dest` and `src`.
+\param channelGains An array of `channels` gains. */
+void mixWithChannelGains(float* dest, const float* src, size_t frames, unsigned int channels, const float* channelGains) {
+	if (channels == 0) {
+		return;
+	}
+
+	size_t count = frames * channels;
+	size_t i = 0;
+
+	//With 1, 2, or 4 channels, the gains repeat every 4 samples, so 4 samples can be done at once.
+	if (channels == 1 || channels == 2 || channels == 4) {
+#if defined(CX_SOUND_USE_SSE)
+		__m128 g = _mm_setr_ps(channelGains[0], channelGains[1 % channels], channelGains[2 % channels], channelGains[3 % channels]);
+		for (; i + 4 <= count; i += 4) {
+			_mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), _mm_mul_ps(_mm_loadu_ps(src + i), g)));
+		}
+#elif defined(CX_SOUND_USE_NEON)
+		float pattern[4] = { channelGains[0], channelGains[1 % channels], channelGains[2 % channels], channelGains[3 % channels] };
+		float32x4_t g = vld1q_f32(pattern);
+		for (; i + 4 <= count; i += 4) {
+			vst1q_f32(dest + i, vmlaq_f32(vld1q_f32(dest + i), vld1q_f32(src + i), g));
+		}
+#endif
+	}
+
+	//i is a multiple of 4, and so of channels, so the tail starts on channel 0.
+	for (; i < count; i += channels) {
+		for (unsigned int c = 0; c < channels; c++) {
+			dest[i + c] += src[i + c] * channelGains[c];
+		}
+	}
+}
+
+/*! Multiplies `count` samples in `data` by `amount`. */
+void multiply(float* data, size_t count, float amount) {
+	size_t i = 0;
+#if defined(CX_SOUND_USE_SSE)
+	__m128 a = _mm_set1_ps(amount);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), a));
+	}
+#elif defined(CX_SOUND_USE_NEON)
+	float32x4_t a = vdupq_n_f32(amount);
+	for (; i + 4 <= count; i += 4) {
+		vst1q_f32(data + i, vmulq_f32(vld1q_f32(data + i), a));
+	}
+#endif
+	for (; i < count; i++) {
+		data[i] *= amount;
+	}
+}
+
+/*! Multiplies `count` samples in `data` by `amount` and clamps the results to [`low`, `high`]. */
+void multiplyAndClamp(float* data, size_t count, float amount, float low, float high) {
+	size_t i = 0;
+#if defined(CX_SOUND_USE_SSE)
+	__m128 a = _mm_set1_ps(amount);
+	__m128 lo = _mm_set1_ps(low);
+	__m128 hi = _mm_set1_ps(high);
+	for (; i + 4 <= count; i += 4) {
+		__m128 v = _mm_mul_ps(_mm_loadu_ps(data + i), a);
+		_mm_storeu_ps(data + i, _mm_min_ps(_mm_max_ps(v, lo), hi));
+	}
+#elif defined(CX_SOUND_USE_NEON)
+	float32x4_t a = vdupq_n_f32(amount);
+	float32x4_t lo = vdupq_n_f32(low);
+	float32x4_t hi = vdupq_n_f32(high);
+	for (; i + 4 <= count; i += 4) {
+		float32x4_t v = vmulq_f32(vld1q_f32(data + i), a);
+		vst1q_f32(data + i, vminq_f32(vmaxq_f32(v, lo), hi));
+	}
+#endif
+	for (; i < count; i++) {
+		data[i] = std::min(std::max(data[i] * amount, low), high);
+	}
+}
+
+/*! Returns the greatest absolute value of the `count` samples in `data`, or 0 if `count` is 0. */
+float absolutePeak(const float* data, size_t count) {
+	float peak = 0;
+	size_t i = 0;
+#if defined(CX_SOUND_USE_SSE)
+	__m128 signMask = _mm_set1_ps(-0.0f);
+	__m128 p = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4) {
+		p = _mm_max_ps(p, _mm_andnot_ps(signMask, _mm_loadu_ps(data + i)));
+	}
+	float lanes[4];
+	_mm_storeu_ps(lanes, p);
+	peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#elif defined(CX_SOUND_USE_NEON)
+	float32x4_t p = vdupq_n_f32(0);
+	for (; i + 4 <= count; i += 4) {
+		p = vmaxq_f32(p, vabsq_f32(vld1q_f32(data + i)));
+	}
+	float lanes[4];
+	vst1q_f32(lanes, p);
+	peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+	for (; i < count; i++) {
+		peak = std::max(peak, std::abs(data[i]));
+	}
+	return peak;
+}
+
+/*! Resamples interleaved data by linear interpolation between neighboring sample frames.
+\param src The data to resample.
+\param srcFrames The number of sample frames in `src`.
+\param dest Where the resampled data is stored. Must have room for `destFrames * channels` samples.
+\param destFrames The number of sample frames to produce.
+\param channels The number of interleaved channels. */
+void resampleLinear(const float* src, uint64_t srcFrames, float* dest, uint64_t destFrames, unsigned int channels) {
+	if (srcFrames == 0) {
+		std::fill(dest, dest + destFrames * channels, 0.0f);
+		return;
+	}
+
+	const double step = (double)srcFrames / destFrames;
+
+	for (uint64_t frame = 0; frame < destFrames; frame++) {
+		double position = frame * step;
+		uint64_t i1 = (uint64_t)position;
+		uint64_t i2 = std::min(i1 + 1, srcFrames - 1);
+		float offset = (float)(position - i1);
+
+		const float* s1 = src + i1 * channels;
+		const float* s2 = src + i2 * channels;
+		float* d = dest + frame * channels;
+		for (unsigned int c = 0; c < channels; c++) {
+			d[c] = s1[c] + (s2[c] - s1[c]) * offset;
+		}
+	}
+}
+
+//Zeroth order modified Bessel function of the first kind, used for the Kaiser window.
+static double besselI0(double x) {
+	double sum = 1;
+	double term = 1;
+	double halfX = x / 2;
+	for (int k = 1; k < 50; k++) {
+		term *= (halfX / k) * (halfX / k);
+		sum += term;
+		if (term < sum * 1e-12) {
+			break;
+		}
+	}
+	return sum;
+}
+
+//A table of windowed-sinc filter coefficients. Row p holds the 2 * halfTaps coefficients that are applied
+//to the input frames around an output frame that lies p / phases of the way between two input frames.
+struct SincTable {
+	SincTable(unsigned int phases_, unsigned int halfTaps_, double cutoff, double beta) :
+		phases(phases_),
+		halfTaps(halfTaps_),
+		coefficients((size_t)(phases_ + 1) * 2 * halfTaps_)
+	{
+		const double pi = 3.14159265358979323846;
+		const double i0Beta = besselI0(beta);
+		const unsigned int taps = 2 * halfTaps;
+
+		for (unsigned int p = 0; p <= phases; p++) {
+			double fraction = (double)p / phases;
+			float* row = &coefficients[(size_t)p * taps];
+			for (unsigned int k = 0; k < taps; k++) {
+				//Distance, in input frames, from the output frame to input tap k.
+				double t = (double)k - (halfTaps - 1) - fraction;
+				double x = pi * cutoff * t;
+				double sinc = (x == 0) ? 1.0 : sin(x) / x;
+
+				double r = t / halfTaps;
+				double window = (std::abs(r) >= 1) ? 0.0 : besselI0(beta * sqrt(1 - r * r)) / i0Beta;
+
+				row[k] = (float)(cutoff * sinc * window);
+			}
+		}
+	}
+
+	const float* row(unsigned int p) const { return &coefficients[(size_t)p * 2 * halfTaps]; }
+
+	unsigned int phases;
+	unsigned int halfTaps;
+	std::vector<float> coefficients;
+};
+
+//Accumulates one output frame from the input frames starting at `first` using `coefs`. Taps that fall
+//outside of the input are treated as silence.
+static inline void convolveFrame(const float* src, int64_t srcFrames, int64_t first, const float* coefs, unsigned int taps,
+								 unsigned int channels, float* d)
+{
+	std::fill(d, d + channels, 0.0f);
+
+	unsigned int kStart = 0;
+	unsigned int kEnd = taps;
+	if (first < 0) {
+		kStart = (unsigned int)std::min<int64_t>(-first, taps);
+	}
+	if (first + taps > srcFrames) {
+		kEnd = (unsigned int)std::max<int64_t>(srcFrames - first, kStart);
+	}
+
+	if (channels == 1) {
+		const float* s = src + first;
+		float acc = 0;
+		for (unsigned int k = kStart; k < kEnd; k++) {
+			acc += s[k] * coefs[k];
+		}
+		d[0] = acc;
+	} else if (channels == 2) {
+		const float* s = src + first * 2;
+		float left = 0;
+		float right = 0;
+		for (unsigned int k = kStart; k < kEnd; k++) {
+			left += s[2 * k] * coefs[k];
+			right += s[2 * k + 1] * coefs[k];
+		}
+		d[0] = left;
+		d[1] = right;
+	} else {
+		for (unsigned int k = kStart; k < kEnd; k++) {
+			const float* s = src + (first + k) * channels;
+			for (unsigned int c = 0; c < channels; c++) {
+				d[c] += s[c] * coefs[k];
+			}
+		}
+	}
+}
+
+/*! Resamples interleaved data with a Kaiser-windowed sinc filter, processing all channels of each
+sample frame together. When the ratio of the sample rates is a ratio of small integers (e.g. 44100 to
+48000 is 160/147), the filter is evaluated exactly at each of the output phases, so a table of
+coefficients is computed once and each output sample is a plain dot product. Otherwise, the coefficients
+are interpolated from a finely sampled table.
+
+When downsampling, the cutoff of the filter is lowered to the new Nyquist frequency to prevent aliasing.
+
+\param src The data to resample.
+\param srcFrames The number of sample frames in `src`.
+\param srcRate The sample rate of `src`.
+\param dest Where the resampled data is stored. Must have room for `destFrames * channels` samples.
+\param destFrames The number of sample frames to produce.
+\param destRate The sample rate of `dest`.
+\param channels The number of interleaved channels.
+\param zeroCrossings The number of zero crossings of the sinc function on each side of the filter center. More
+zero crossings give a sharper filter at the cost of speed.
+\param kaiserBeta The shape parameter of the Kaiser window. Larger values give more stopband attenuation and
+a wider transition band. */
+void resampleSinc(const float* src, uint64_t srcFrames, double srcRate, float* dest, uint64_t destFrames, double destRate,
+				  unsigned int channels, unsigned int zeroCrossings, double kaiserBeta)
+{
+	if (srcFrames == 0 || srcRate <= 0 || destRate <= 0) {
+		std::fill(dest, dest + destFrames * channels, 0.0f);
+		return;
+	}
+
+	const double cutoff = std::min(1.0, destRate / srcRate);
+	const unsigned int halfTaps = (unsigned int)ceil(zeroCrossings / cutoff);
+	const unsigned int taps = 2 * halfTaps;
+	const int64_t inFrames = (int64_t)srcFrames;
+
+	//Check for a rational ratio of small integers: destRate / srcRate == up / down.
+	uint64_t up = 0;
+	uint64_t down = 0;
+	if (srcRate == floor(srcRate) && destRate == floor(destRate)) {
+		uint64_t a = (uint64_t)destRate;
+		uint64_t b = (uint64_t)srcRate;
+		while (b != 0) {
+			uint64_t t = a % b;
+			a = b;
+			b = t;
+		}
+		up = (uint64_t)destRate / a;
+		down = (uint64_t)srcRate / a;
+	}
+
+	const size_t maxTableSize = 1 << 22;
+
+	if (up > 0 && up * taps <= maxTableSize) {
+		SincTable table((unsigned int)up, halfTaps, cutoff, kaiserBeta);
+
+		//Output frame n is at input position n * down / up. Track the integer and phase parts separately
+		//so that no floating point position accumulates error.
+		uint64_t whole = 0;
+		uint64_t phase = 0;
+		for (uint64_t frame = 0; frame < destFrames; frame++) {
+			int64_t first = (int64_t)whole - (halfTaps - 1);
+			convolveFrame(src, inFrames, first, table.row((unsigned int)phase), taps, channels, dest + frame * channels);
+
+			phase += down;
+			whole += phase / up;
+			phase %= up;
+		}
+		return;
+	}
+
+	//Irrational (or awkward) ratio: interpolate coefficients between the rows of a finely-sampled table.
+	const unsigned int phases = 512;
+	SincTable table(phases, halfTaps, cutoff, kaiserBeta);
+	std::vector<float> coefs(taps);
+
+	const double step = srcRate / destRate;
+	for (uint64_t frame = 0; frame < destFrames; frame++) {
+		double position = frame * step;
+		uint64_t whole = (uint64_t)position;
+		double phasePosition = (position - whole) * phases;
+		unsigned int p = std::min((unsigned int)phasePosition, phases - 1);
+		float blend = (float)(phasePosition - p);
+
+		const float* r1 = table.row(p);
+		const float* r2 = table.row(p + 1);
+		for (unsigned int k = 0; k < taps; k++) {
+			coefs[k] = r1[k] + (r2[k] - r1[k]) * blend;
+		}
+
+		int64_t first = (int64_t)whole - (halfTaps - 1);
+		convolveFrame(src, inFrames, first, coefs.data(), taps, channels, dest + frame * channels);
+	}
+}
+
+} //namespace SoundKernels
+} //namespace Private
+} //namespace CX
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace CX {
+namespace Private {
+
+	/*! These functions do the inner loops of sound processing: mixing, gain, peak finding, and resampling. They use
+	SSE or NEON instructions when those are available and fall back to plain loops otherwise. They are
+	shared by CX_SoundBuffer, CX_SoundBufferPlayer, and other classes that process blocks of sound data.
+	Defining CX_SOUND_NO_SIMD when compiling CX forces the plain loops to be used. */
+	namespace SoundKernels {
+
+		void mix(float* dest, const float* src, size_t count);
+		void mixWithGain(float* dest, const float* src, size_t count, float gain);
+		void mixWithChannelGains(float* dest, const float* src, size_t frames, unsigned int channels, const float* channelGains);
+
+		void multiply(float* data, size_t count, float amount);
+		void multiplyAndClamp(float* data, size_t count, float amount, float low, float high);
+
+		float absolutePeak(const float* data, size_t count);
+
+		void resampleLinear(const float* src, uint64_t srcFrames, float* dest, uint64_t destFrames, unsigned int channels);
+		void resampleSinc(const float* src, uint64_t srcFrames, double srcRate, float* dest, uint64_t destFrames, double destRate,
+						  unsigned int channels, unsigned int zeroCrossings, double kaiserBeta);
+
+	}
+
+} //namespace Private
+} //namespace CX
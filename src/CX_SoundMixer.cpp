@@ -0,0 +1,316 @@
+#include "CX_SoundMixer.h"
+
+#include <algorithm>
+
+#include "CX_SoundKernels.h"
+
+namespace CX {
+
+CX_SoundMixer::CX_SoundMixer(void) :
+	_activeVoices(0),
+	_droppedSounds(0),
+	_lateStarts(0),
+	_soundStream(nullptr),
+	_soundStreamSelfAllocated(false),
+	_listeningForEvents(false)
+{}
+
+CX_SoundMixer::~CX_SoundMixer(void) {
+	if (_soundStream != nullptr) {
+		_listenForEvents(false);
+		if (_soundStreamSelfAllocated) {
+			_soundStream->closeStream();
+			delete _soundStream;
+			_soundStreamSelfAllocated = false;
+		}
+	}
+}
+
+/*! Configures the CX_SoundMixer with the given configuration. A CX_SoundStream will be set
+up within the CX_SoundMixer and the sound stream will be started.
+\param config The configuration to use for the CX_SoundStream used internally by the CX_SoundMixer.
+\param voiceCount The maximum number of sounds that can be playing at once.
+\return `true` if the sound stream was set up and started successfully, `false` otherwise. */
+bool CX_SoundMixer::setup(Configuration config, unsigned int voiceCount) {
+	_cleanUpOldSoundStream();
+
+	_voices.assign(voiceCount, Voice());
+	_commands.setup(std::max<unsigned int>(2 * voiceCount, 64));
+	_activeVoices = 0;
+
+	_soundStream = new CX_SoundStream;
+	_soundStreamSelfAllocated = true;
+	_listenForEvents(true);
+
+	bool setupSuccessfully = _soundStream->setup((CX_SoundStream::Configuration&)config);
+	bool startedSuccessfully = _soundStream->start();
+
+	return startedSuccessfully && setupSuccessfully;
+}
+
+/*! Set up the CX_SoundMixer from an existing CX_SoundStream. The CX_SoundStream is not started automatically.
+The CX_SoundStream must exist for the lifetime of the CX_SoundMixer.
+\param ss A pointer to a fully configured CX_SoundStream.
+\param voiceCount The maximum number of sounds that can be playing at once.
+\return `true` in all cases. */
+bool CX_SoundMixer::setup(CX_SoundStream* ss, unsigned int voiceCount) {
+	_cleanUpOldSoundStream();
+
+	_voices.assign(voiceCount, Voice());
+	_commands.setup(std::max<unsigned int>(2 * voiceCount, 64));
+	_activeVoices = 0;
+
+	_soundStream = ss;
+	_soundStreamSelfAllocated = false;
+	_listenForEvents(true);
+
+	return true;
+}
+
+/*! Starts playing the sound at the beginning of the next buffer that is sent to the sound card.
+\param sound The sound to play.
+\param gain The gain to apply to the sound while playing it, in decibels. The sound buffer is not modified.
+\return `false` if the sound could not be queued, `true` otherwise. */
+bool CX_SoundMixer::play(CX_SoundBuffer* sound, float gain) {
+	if (!_checkSound(sound, "play")) {
+		return false;
+	}
+
+	Command c;
+	c.immediate = true;
+	c.data = sound->getSampleData();
+	sound->prefetch(0, sound->getSampleFrameCount()); //Only does something for mapped sounds. The audio callback never prefetches.
+	c.frameCount = sound->getSampleFrameCount();
+	c.amplitude = pow(10.0f, gain / 20.0f);
+
+	if (_commands.write(&c, 1) == 0) {
+		CX::Instances::Log.error("CX_SoundMixer") << "play(): The command queue is full. The sound will not be played.";
+		return false;
+	}
+	return true;
+}
+
+/*! Schedules the sound to start playing on the given sample frame of the sound stream.
+\param sound The sound to play.
+\param sampleFrame The sample frame of the stream on which the sound should start (see CX_SoundStream::getSampleFrameNumber()).
+If this sample frame has already been sent to the sound card by the time the command is processed, the sound starts
+at the beginning of the next buffer and the late start is counted (see getLateStartCount()).
+\param gain The gain to apply to the sound while playing it, in decibels. The sound buffer is not modified.
+\return `false` if the sound could not be queued, `true` otherwise. */
+bool CX_SoundMixer::playAt(CX_SoundBuffer* sound, uint64_t sampleFrame, float gain) {
+	if (!_checkSound(sound, "playAt")) {
+		return false;
+	}
+
+	Command c;
+	c.data = sound->getSampleData();
+	sound->prefetch(0, sound->getSampleFrameCount()); //Only does something for mapped sounds. The audio callback never prefetches.
+	c.frameCount = sound->getSampleFrameCount();
+	c.startFrame = sampleFrame;
+	c.amplitude = pow(10.0f, gain / 20.0f);
+
+	if (_commands.write(&c, 1) == 0) {
+		CX::Instances::Log.error("CX_SoundMixer") << "playAt(): The command queue is full. The sound will not be played.";
+		return false;
+	}
+	return true;
+}
+
+/*! Schedules the sound to start playing at the given experiment time. See timeToSampleFrame() for
+information about how the time is converted to a sample frame.
+\param sound The sound to play.
+\param experimentTime The time at which the sound should start playing.
+\param latencyOffset An offset that accounts for latency. See CX_SoundBufferPlayer::startPlayingAt().
+\param gain The gain to apply to the sound while playing it, in decibels.
+\return `false` if the sound could not be queued, `true` otherwise. */
+bool CX_SoundMixer::playAt(CX_SoundBuffer* sound, CX_Millis experimentTime, CX_Millis latencyOffset, float gain) {
+	if (_soundStream == nullptr) {
+		CX::Instances::Log.error("CX_SoundMixer") << "playAt(): Could not queue sound playback, the sound stream was nonexistent. Have you forgotten to call setup()?";
+		return false;
+	}
+	return playAt(sound, timeToSampleFrame(experimentTime, latencyOffset), gain);
+}
+
+/*! Stops all of the sounds that are playing, as well as sounds that are scheduled but have not yet started. */
+void CX_SoundMixer::stopAll(void) {
+	Command c;
+	c.stopAll = true;
+	if (_commands.write(&c, 1) == 0) {
+		CX::Instances::Log.error("CX_SoundMixer") << "stopAll(): The command queue is full. Sounds were not stopped.";
+	}
+}
+
+/*! Converts an experiment time to the sample frame of the sound stream that will be played at that time,
+in the same way as CX_SoundBufferPlayer::startPlayingAt().
+\param experimentTime The experiment time.
+\param latencyOffset An offset that accounts for latency.
+\return The sample frame. If the time is in the past, the next sample frame that will be sent to the sound card. */
+uint64_t CX_SoundMixer::timeToSampleFrame(CX_Millis experimentTime, CX_Millis latencyOffset) {
+	if (_soundStream == nullptr) {
+		return 0;
+	}
+
+	CX_Millis partialStreamLatency = _soundStream->estimateTotalLatency() - _soundStream->estimateLatencyPerBuffer();
+	CX_Millis adjustedStartTime = experimentTime + latencyOffset - partialStreamLatency - _soundStream->getConfiguration().outputLatencyOffset;
+
+	CX_Millis lastSwapTime = _soundStream->getLastSwapTime();
+	if (adjustedStartTime <= lastSwapTime) {
+		return _soundStream->getSampleFrameNumber();
+	}
+
+	return std::max(_soundStream->timeToSampleFrame(adjustedStartTime), _soundStream->getSampleFrameNumber());
+}
+
+/*! Returns the number of voices, i.e. the maximum number of sounds that can play at once. */
+unsigned int CX_SoundMixer::getVoiceCount(void) const {
+	return _voices.size();
+}
+
+/*! Returns the number of voices that were playing or waiting to start as of the last buffer. */
+unsigned int CX_SoundMixer::getActiveVoiceCount(void) const {
+	return _activeVoices;
+}
+
+/*! Returns the number of sounds that were not played because all of the voices were in use. */
+uint64_t CX_SoundMixer::getDroppedSoundCount(void) const {
+	return _droppedSounds;
+}
+
+/*! Returns the number of sounds scheduled with playAt() that started later than requested because
+their start sample frame had already passed when the command was processed. */
+uint64_t CX_SoundMixer::getLateStartCount(void) const {
+	return _lateStarts;
+}
+
+/*! Returns the configuration used for this CX_SoundMixer. */
+CX_SoundMixer::Configuration CX_SoundMixer::getConfiguration(void) {
+	if (_soundStream == nullptr) {
+		CX::Instances::Log.error("CX_SoundMixer") << "getConfiguration(): Could not get configuration, the sound stream was nonexistent. Have you forgotten to call setup()?";
+		return CX_SoundMixer::Configuration();
+	}
+
+	return (CX_SoundMixer::Configuration)_soundStream->getConfiguration();
+}
+
+bool CX_SoundMixer::_checkSound(CX_SoundBuffer* sound, std::string functionName) {
+	if (_soundStream == nullptr) {
+		CX::Instances::Log.error("CX_SoundMixer") << functionName << "(): The sound stream was nonexistent. Have you forgotten to call setup()?";
+		return false;
+	}
+
+	if (sound == nullptr || !sound->isReadyToPlay()) {
+		CX::Instances::Log.error("CX_SoundMixer") << functionName << "(): The sound buffer was null or not ready to play.";
+		return false;
+	}
+
+	const Configuration& config = _soundStream->getConfiguration();
+	if (sound->getChannelCount() != config.outputChannels || sound->getSampleRate() != config.sampleRate) {
+		CX::Instances::Log.error("CX_SoundMixer") << functionName << "(): The sound buffer must have the same number of channels and sample rate"
+			" as the sound stream. Use CX_SoundBuffer::setChannelCount() and CX_SoundBuffer::resample() before playing it.";
+		return false;
+	}
+
+	return true;
+}
+
+bool CX_SoundMixer::_outputEventHandler(CX_SoundStream::OutputEventArgs& outputData) {
+	CX_SoundStream::ListenerScope watchdog(outputData.instance, "CX_SoundMixer");
+
+	const uint64_t bufferStart = _soundStream->getSampleFrameNumber();
+	const uint64_t bufferEnd = bufferStart + outputData.bufferSize;
+	const unsigned int channels = outputData.outputChannels;
+
+	//Assign new sounds to free voices.
+	Command c;
+	while (_commands.read(&c, 1) == 1) {
+		if (c.stopAll) {
+			for (Voice& v : _voices) {
+				v.active = false;
+			}
+			continue;
+		}
+
+		if (c.immediate) {
+			c.startFrame = bufferStart;
+		} else if (c.startFrame < bufferStart) {
+			c.startFrame = bufferStart;
+			_lateStarts++;
+		}
+
+		auto freeVoice = std::find_if(_voices.begin(), _voices.end(), [](const Voice& v) { return !v.active; });
+		if (freeVoice == _voices.end()) {
+			_droppedSounds++;
+			continue;
+		}
+
+		freeVoice->active = true;
+		freeVoice->data = c.data;
+		freeVoice->frameCount = c.frameCount;
+		freeVoice->startFrame = c.startFrame;
+		freeVoice->amplitude = c.amplitude;
+	}
+
+	//Mix every voice that overlaps this buffer.
+	unsigned int activeCount = 0;
+	for (Voice& v : _voices) {
+		if (!v.active) {
+			continue;
+		}
+
+		if (v.startFrame >= bufferEnd) {
+			activeCount++; //Waiting to start.
+			continue;
+		}
+
+		uint64_t outputOffset = (v.startFrame > bufferStart) ? v.startFrame - bufferStart : 0;
+		uint64_t soundPosition = bufferStart + outputOffset - v.startFrame;
+		uint64_t frames = std::min<uint64_t>(outputData.bufferSize - outputOffset, v.frameCount - soundPosition);
+
+		float* target = outputData.outputBuffer + outputOffset * channels;
+		const float* source = v.data + soundPosition * channels;
+
+		if (v.amplitude == 1) {
+			Private::SoundKernels::mix(target, source, frames * channels);
+		} else {
+			Private::SoundKernels::mixWithGain(target, source, frames * channels, v.amplitude);
+		}
+
+		if (soundPosition + frames >= v.frameCount) {
+			v.active = false;
+		} else {
+			activeCount++;
+		}
+	}
+
+	_activeVoices = activeCount;
+	return false; //Returning true would stop the event from reaching later listeners, like a CX_TriggerOutput on the same stream.
+}
+
+void CX_SoundMixer::_listenForEvents(bool listen) {
+	if ((listen == _listeningForEvents) || (_soundStream == nullptr)) {
+		return;
+	}
+
+	if (listen) {
+		ofAddListener(_soundStream->outputEvent, this, &CX_SoundMixer::_outputEventHandler);
+	} else {
+		ofRemoveListener(_soundStream->outputEvent, this, &CX_SoundMixer::_outputEventHandler);
+	}
+
+	_listeningForEvents = listen;
+}
+
+void CX_SoundMixer::_cleanUpOldSoundStream(void) {
+	//If another sound stream was connected, stop listening to it.
+	if (_soundStream != nullptr) {
+		_listenForEvents(false);
+
+		if (_soundStreamSelfAllocated) {
+			delete _soundStream;
+			_soundStreamSelfAllocated = false;
+		}
+		_soundStream = nullptr;
+	}
+}
+
+} //namespace CX
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+
+#include "CX_SoundBuffer.h"
+#include "CX_SoundStream.h"
+#include "CX_SPSCRingBuffer.h"
+#include "CX_Clock.h"
+#include "CX_Logger.h"
+
+#include "ofEvents.h"
+
+namespace CX {
+
+	/*! This class plays many CX_SoundBuffers at once through a single CX_SoundStream. It has a fixed
+	pool of voices, each of which can play one sound. Sounds are scheduled to start on a particular
+	sample frame of the stream, so the onsets of sounds are sample-accurate relative to each other,
+	which is useful for dense sequences of sounds (e.g. in oddball paradigms). All of the active
+	voices are mixed in a single pass each time the sound stream needs more data.
+
+	Playback commands are passed to the audio thread through a lock-free queue, so scheduling a sound
+	never blocks. The scheduling functions (play(), playAt(), and stopAll()) must all be called from
+	the same thread.
+
+	The CX_SoundBuffers that are played must have the same sample rate and number of channels as the
+	sound stream (see CX_SoundBuffer::resample() and CX_SoundBuffer::setChannelCount()), and must not be
+	modified or destroyed while they are playing.
+
+	\code{.cpp}
+	CX_SoundMixer mixer;
+	CX_SoundMixer::Configuration config;
+	config.outputChannels = 2;
+	//Configure other settings...
+	mixer.setup(config);
+
+	CX_SoundBuffer standard; //Load these sounds...
+	CX_SoundBuffer deviant;
+
+	//Play a sequence of tones with exactly 500 ms between onsets.
+	uint64_t start = mixer.getSoundStream()->getSampleFrameNumber() + 48000;
+	uint64_t soa = mixer.getSoundStream()->getConfiguration().sampleRate / 2;
+	for (int i = 0; i < 10; i++) {
+		mixer.playAt((i == 7) ? &deviant : &standard, start + i * soa);
+	}
+	\endcode
+	\ingroup sound
+	*/
+	class CX_SoundMixer {
+	public:
+
+		typedef CX_SoundStream::Configuration Configuration; //!< This is typedef'ed to \ref CX::CX_SoundStream::Configuration.
+
+		CX_SoundMixer(void);
+		~CX_SoundMixer(void);
+
+		bool setup(Configuration config, unsigned int voiceCount = 32);
+		bool setup(CX_SoundStream* ss, unsigned int voiceCount = 32);
+
+		bool play(CX_SoundBuffer* sound, float gain = 0);
+		bool playAt(CX_SoundBuffer* sound, uint64_t sampleFrame, float gain = 0);
+		bool playAt(CX_SoundBuffer* sound, CX_Millis experimentTime, CX_Millis latencyOffset, float gain = 0);
+		void stopAll(void);
+
+		uint64_t timeToSampleFrame(CX_Millis experimentTime, CX_Millis latencyOffset);
+
+		unsigned int getVoiceCount(void) const;
+		unsigned int getActiveVoiceCount(void) const;
+		uint64_t getDroppedSoundCount(void) const;
+		uint64_t getLateStartCount(void) const;
+
+		Configuration getConfiguration(void);
+
+		/*! This function provides direct access to the CX_SoundStream used by the CX_SoundMixer. */
+		CX_SoundStream* getSoundStream(void) { return _soundStream; };
+
+	private:
+
+		struct Command {
+			Command(void) :
+				stopAll(false),
+				immediate(false),
+				data(nullptr),
+				frameCount(0),
+				startFrame(0),
+				amplitude(1)
+			{}
+
+			bool stopAll;
+			bool immediate;
+			const float* data;
+			uint64_t frameCount;
+			uint64_t startFrame;
+			float amplitude;
+		};
+
+		struct Voice {
+			Voice(void) :
+				active(false),
+				data(nullptr),
+				frameCount(0),
+				startFrame(0),
+				amplitude(1)
+			{}
+
+			bool active;
+			const float* data;
+			uint64_t frameCount;
+			uint64_t startFrame;
+			float amplitude;
+		};
+
+		bool _outputEventHandler(CX_SoundStream::OutputEventArgs& outputData);
+		bool _checkSound(CX_SoundBuffer* sound, std::string functionName);
+
+		CX_SPSCRingBuffer<Command> _commands;
+		std::vector<Voice> _voices;
+
+		std::atomic<unsigned int> _activeVoices;
+		std::atomic<uint64_t> _droppedSounds;
+		std::atomic<uint64_t> _lateStarts;
+
+		CX_SoundStream *_soundStream;
+		bool _soundStreamSelfAllocated;
+		void _cleanUpOldSoundStream(void);
+
+		void _listenForEvents(bool listen);
+		bool _listeningForEvents;
+	};
+
+}
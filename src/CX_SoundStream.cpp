@@ -1,5 +1,24 @@
 #include "CX_SoundStream.h"
 
+#include <cmath>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+
+#ifdef TARGET_WIN32
+#include <avrt.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "avrt.lib")
+#endif
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "CX_EventTrace.h"
+#include "CX_Private.h"
+#include "CX_StartupCache.h"
+
 #if OF_VERSION_MAJOR >= 0 && OF_VERSION_MINOR >= 9 && OF_VERSION_PATCH >= 0
 typedef RtAudioError RT_AUDIO_ERROR_TYPE;
 #else
@@ -33,6 +52,13 @@ ss.streamOptions.numberOfBuffers = 4
 ss.streamOptions.flags = RTAUDIO_SCHEDULE_REALTIME | RTAUDIO_MINIMIZE_LATENCY //The | is not needed,
 //but it matches the way these flags are used in code. All flags are supported.
 
+ss.inputRingBufferSize = 0 // In sample frames. 0 means no ring buffer.
+ss.outputRingBufferSize = 0
+
+ss.realTimeThreadPriority = false
+ss.listenerBudget = 0.25 // Enables the callback watchdog.
+ss.outputLatencyOffset = 3.2 // In milliseconds. See CX_LatencyCalibration.
+
 //ss.streamOptions.priority is not used in this example. It would take a positive integer.
 \endcode
 All of the configuration keys are used in this example.
@@ -92,6 +118,30 @@ bool CX_SoundStream::Configuration::setFromFile(std::string filename, std::strin
 		this->streamOptions.priority = ofFromString<int>(kv[pre + "streamOptions.priority"]);
 	}
 
+	if (kv.find(pre + "inputRingBufferSize") != kv.end()) {
+		this->inputRingBufferSize = ofFromString<unsigned int>(kv[pre + "inputRingBufferSize"]);
+	}
+	if (kv.find(pre + "outputRingBufferSize") != kv.end()) {
+		this->outputRingBufferSize = ofFromString<unsigned int>(kv[pre + "outputRingBufferSize"]);
+	}
+
+	if (kv.find(pre + "clockSyncBandwidth") != kv.end()) {
+		this->clockSyncBandwidth = ofFromString<double>(kv[pre + "clockSyncBandwidth"]);
+	}
+
+	if (kv.find(pre + "realTimeThreadPriority") != kv.end()) {
+		int result = Private::stringToBooleint(kv[pre + "realTimeThreadPriority"]);
+		if (result != -1) {
+			this->realTimeThreadPriority = (result == 1);
+		}
+	}
+	if (kv.find(pre + "listenerBudget") != kv.end()) {
+		this->listenerBudget = ofFromString<double>(kv[pre + "listenerBudget"]);
+	}
+	if (kv.find(pre + "outputLatencyOffset") != kv.end()) {
+		this->outputLatencyOffset = CX_Millis(ofFromString<double>(kv[pre + "outputLatencyOffset"]));
+	}
+
 	if (kv.find(pre + "streamOptions.flags") != kv.end()) {
 		this->streamOptions.flags = 0;
 		string flags = kv[pre + "streamOptions.flags"];
@@ -116,14 +166,74 @@ bool CX_SoundStream::Configuration::setFromFile(std::string filename, std::strin
 	return true;
 }
 
+/*! Writes the configuration to a file in the format that is read by setFromFile(). Every key that setFromFile() reads is
+written, so reading the file back gives the same configuration.
+\param filename The name of the file to write. It is overwritten if it exists.
+\param delimiter The string that separates keys from values.
+\param keyPrefix A prefix that is put at the start of every key.
+\return `true` if the file was written, `false` otherwise. */
+bool CX_SoundStream::Configuration::writeToFile(std::string filename, std::string delimiter, std::string keyPrefix) const {
+	const std::string& pre = keyPrefix; //alias
+	std::string d = " " + delimiter + " ";
+
+	std::vector<std::string> flags;
+	if (streamOptions.flags & RTAUDIO_NONINTERLEAVED) {
+		flags.push_back("RTAUDIO_NONINTERLEAVED");
+	}
+	if (streamOptions.flags & RTAUDIO_MINIMIZE_LATENCY) {
+		flags.push_back("RTAUDIO_MINIMIZE_LATENCY");
+	}
+	if (streamOptions.flags & RTAUDIO_HOG_DEVICE) {
+		flags.push_back("RTAUDIO_HOG_DEVICE");
+	}
+	if (streamOptions.flags & RTAUDIO_ALSA_USE_DEFAULT) {
+		flags.push_back("RTAUDIO_ALSA_USE_DEFAULT");
+	}
+	if (streamOptions.flags & RTAUDIO_SCHEDULE_REALTIME) {
+		flags.push_back("RTAUDIO_SCHEDULE_REALTIME");
+	}
+
+	std::stringstream out;
+	out << pre << "api" << d << CX_SoundStream::convertApiToString(api) << std::endl;
+	out << pre << "sampleRate" << d << sampleRate << std::endl;
+	out << pre << "bufferSize" << d << bufferSize << std::endl;
+	out << pre << "inputChannels" << d << inputChannels << std::endl;
+	out << pre << "inputDeviceId" << d << inputDeviceId << std::endl;
+	out << pre << "outputChannels" << d << outputChannels << std::endl;
+	out << pre << "outputDeviceId" << d << outputDeviceId << std::endl;
+	out << pre << "streamOptions.numberOfBuffers" << d << streamOptions.numberOfBuffers << std::endl;
+	out << pre << "streamOptions.priority" << d << streamOptions.priority << std::endl;
+	out << pre << "streamOptions.flags" << d << (flags.empty() ? "0" : ofJoinString(flags, " | ")) << std::endl;
+	out << pre << "inputRingBufferSize" << d << inputRingBufferSize << std::endl;
+	out << pre << "outputRingBufferSize" << d << outputRingBufferSize << std::endl;
+	out << pre << "clockSyncBandwidth" << d << clockSyncBandwidth << std::endl;
+	out << pre << "realTimeThreadPriority" << d << (realTimeThreadPriority ? "true" : "false") << std::endl;
+	out << pre << "listenerBudget" << d << listenerBudget << std::endl;
+	out << pre << "outputLatencyOffset" << d << ofToString(outputLatencyOffset.millis(), 6) << std::endl;
+
+	return CX::Util::writeToFile(filename, out.str(), false, false);
+}
+
 
 
 CX_SoundStream::CX_SoundStream (void) :
+	_watchdogSlotCount(0),
+	_listenerBudget(0),
+	_callbackBudget(0),
 	_rtAudio(nullptr),
 	_lastSwapTime(0),
 	_lastSampleNumber(0),
 	_sampleNumberAtLastCheck(0)
-{}
+{
+	_resetClockSync();
+
+	for (int i = 0; i < _maxWatchdogSlots; i++) {
+		_watchdogSlots[i].name = nullptr;
+		_resetWatchdogSlot(_watchdogSlots[i]);
+	}
+	_callbackWatchdog.name = "CX_SoundStream callback";
+	_resetWatchdogSlot(_callbackWatchdog);
+}
 
 CX_SoundStream::~CX_SoundStream (void) {
 	closeStream();
@@ -142,6 +252,8 @@ bool CX_SoundStream::setup(CX_SoundStream::Configuration &config) {
 		closeStream();
 	}
 
+	_callbackLog = CX::Instances::Log.realTimeChannel("CX_SoundStream");
+
 	try {
 		_rtAudio = std::make_shared<RtAudio>(config.api);
 	} catch (RT_AUDIO_ERROR_TYPE err) {
@@ -198,6 +310,26 @@ bool CX_SoundStream::setup(CX_SoundStream::Configuration &config) {
 
 	_config = config; //Store the updated settings.
 
+	//The audio thread is not running, so the watchdog can be reset.
+	_callbackBudget = CX_Nanos((int64_t)(1e9 * config.bufferSize / config.sampleRate));
+	_listenerBudget = CX_Nanos((int64_t)(std::max(config.listenerBudget, 0.0) * _callbackBudget.nanos()));
+	for (int i = 0; i < _maxWatchdogSlots; i++) {
+		_watchdogSlots[i].name = nullptr;
+	}
+	_watchdogSlotCount = 0;
+	resetListenerTimings();
+
+	//The ring buffers are allocated before the stream starts so that the audio thread never sees them change.
+	_inputRing.reset();
+	if (config.inputChannels > 0 && config.inputRingBufferSize > 0) {
+		_inputRing.reset(new CX_SPSCRingBuffer<float>((size_t)config.inputRingBufferSize * config.inputChannels));
+	}
+
+	_outputRing.reset();
+	if (config.outputChannels > 0 && config.outputRingBufferSize > 0) {
+		_outputRing.reset(new CX_SPSCRingBuffer<float>((size_t)config.outputRingBufferSize * config.outputChannels));
+	}
+
 	return this->start();
 }
 
@@ -220,6 +352,8 @@ bool CX_SoundStream::start(void) {
 		return true;
 	}
 
+	_resetClockSync(); //The audio thread is not running, so the filter can be reset.
+
 	try {
 		_rtAudio->startStream();
 	} catch (RT_AUDIO_ERROR_TYPE &err) {
@@ -242,6 +376,12 @@ bool CX_SoundStream::isStreamRunning(void) const {
 	return _rtAudio->isStreamRunning();
 }
 
+/*! Sets the output latency offset of the stream without setting it up again. See Configuration::outputLatencyOffset.
+\param offset The offset. */
+void CX_SoundStream::setOutputLatencyOffset(CX_Millis offset) {
+	_config.outputLatencyOffset = offset;
+}
+
 /*! Stops the stream. In order to restart the stream, CX::CX_SoundStream::start() must be called.
 If there is an error, a message will be logged.
 \return `false` if there was an error, `true` otherwise. */
@@ -285,9 +425,377 @@ bool CX_SoundStream::closeStream(void) {
  	}
 
 	_rtAudio = nullptr;
+
+	//The stream is closed, so the audio thread is no longer using the ring buffers.
+	_inputRing.reset();
+	_outputRing.reset();
+
 	return rval;
 }
 
+//Listens to the stream during autoTuneLatency(). The handlers run on the audio thread, so the interval
+//storage is allocated before the stream starts and is only read after the stream has stopped.
+struct CX_SoundStream::LatencyProbe {
+	LatencyProbe(unsigned int maxCallbacks, CX_Millis warmupEnd_, CX_Millis loadDuration_) :
+		warmupEnd(warmupEnd_),
+		loadDuration(loadDuration_),
+		xrunCount(0),
+		measuring(false)
+	{
+		callbackTimes.reserve(maxCallbacks);
+	}
+
+	CX_Millis warmupEnd;
+	CX_Millis loadDuration;
+
+	std::vector<CX_Millis> callbackTimes;
+	unsigned int xrunCount;
+	bool measuring;
+
+	void outputHandler(CX_SoundStream::OutputEventArgs& args) {
+		_callback(args.bufferUnderflow);
+	}
+
+	void inputHandler(CX_SoundStream::InputEventArgs& args) {
+		_callback(args.bufferOverflow);
+	}
+
+private:
+	void _callback(bool xrun) {
+		CX_Millis now = CX::Instances::Clock.now();
+
+		if (!measuring) {
+			measuring = (now >= warmupEnd);
+		}
+
+		if (measuring) {
+			if (callbackTimes.size() < callbackTimes.capacity()) {
+				callbackTimes.push_back(now);
+			}
+			if (xrun) {
+				xrunCount++;
+			}
+		}
+
+		//The synthetic load.
+		CX_Millis loadEnd = now + loadDuration;
+		while (CX::Instances::Clock.now() < loadEnd) {
+			;
+		}
+	}
+};
+
+/*! Finds the configuration with the lowest latency that runs reliably on this computer. Every combination of the APIs,
+devices, buffer sizes, and buffer counts in `tuningConfig` is set up in turn and run for a short time while the audio
+callback is put under a synthetic load. For each configuration, the number of buffer underflows and overflows (xruns)
+and the jitter of the time between callbacks are measured. Of the configurations that stay within
+LatencyTuningConfiguration::maxXrunsPerSecond and LatencyTuningConfiguration::maxJitterFraction, the one with the lowest
+estimated latency (see estimateTotalLatency()) is chosen, with ties broken by jitter.
+
+This takes about `testDuration + warmupDuration` per configuration, so the sweep can take a few minutes. It is meant to be run
+once on each computer, with the result saved to a file (see LatencyTuningConfiguration::filename) that is then read at the
+start of every session with Configuration::setFromFile():
+
+\code{.cpp}
+CX_SoundStream::Configuration config;
+if (!config.setFromFile("soundStreamConfig.txt")) {
+	CX_SoundStream::LatencyTuningConfiguration tuning;
+	tuning.baseConfiguration.outputChannels = 2;
+	tuning.filename = "soundStreamConfig.txt";
+	soundStream.autoTuneLatency(tuning);
+	config = soundStream.getConfiguration();
+} else {
+	soundStream.setup(config);
+}
+\endcode
+
+Any stream that was set up is closed first. The "Buffer underflow/overflow detected" errors of configurations that are
+too small are logged during the sweep; they are expected.
+
+\param tuningConfig The settings for the sweep.
+\param results If not `nullptr`, the measurements of every tested configuration are stored here, in the order they were tested.
+\return `true` if an acceptable configuration was found. In that case, the stream is left set up and running with that configuration.
+If no configuration was acceptable, `false` is returned and the stream is left closed.
+*/
+bool CX_SoundStream::autoTuneLatency(LatencyTuningConfiguration tuningConfig, std::vector<LatencyTuningResult>* results) {
+	closeStream();
+
+	const Configuration& base = tuningConfig.baseConfiguration;
+
+	if (base.inputChannels <= 0 && base.outputChannels <= 0) {
+		CX::Instances::Log.error("CX_SoundStream") << "autoTuneLatency(): The base configuration has no input or output channels.";
+		return false;
+	}
+
+	std::vector<RtAudio::Api> apis = tuningConfig.apis;
+	if (apis.empty()) {
+		for (RtAudio::Api api : getCompiledApis()) {
+			if (api != RtAudio::Api::RTAUDIO_DUMMY) {
+				apis.push_back(api);
+			}
+		}
+	}
+
+	std::vector<LatencyTuningResult> tested;
+
+	for (RtAudio::Api api : apis) {
+
+		std::vector<std::pair<int, int>> devices; //input, output
+		if (tuningConfig.allDevices) {
+			std::vector<RtAudio::DeviceInfo> deviceList = getDeviceList(api);
+			for (unsigned int i = 0; i < deviceList.size(); i++) {
+				const RtAudio::DeviceInfo& dev = deviceList[i];
+				if (dev.probed && (int)dev.inputChannels >= base.inputChannels && (int)dev.outputChannels >= base.outputChannels) {
+					devices.push_back(std::make_pair((int)i, (int)i));
+				}
+			}
+		} else {
+			devices.push_back(std::make_pair(base.inputDeviceId, base.outputDeviceId));
+		}
+
+		for (const std::pair<int, int>& device : devices) {
+			for (unsigned int bufferSize : tuningConfig.bufferSizes) {
+				for (unsigned int bufferCount : tuningConfig.bufferCounts) {
+
+					Configuration config = base;
+					config.api = api;
+					config.inputDeviceId = device.first;
+					config.outputDeviceId = device.second;
+					config.bufferSize = bufferSize;
+					config.streamOptions.numberOfBuffers = bufferCount;
+
+					LatencyTuningResult result = _measureLatency(config, tuningConfig);
+					if (result.opened) {
+						CX::Instances::Log.notice("CX_SoundStream") << "autoTuneLatency(): " << convertApiToString(api) <<
+							", output device " << result.configuration.outputDeviceId << ", input device " << result.configuration.inputDeviceId <<
+							", buffer size " << result.configuration.bufferSize << ", buffers " << result.configuration.streamOptions.numberOfBuffers <<
+							": latency " << result.latency << " ms, jitter " << result.callbackJitter << " ms, " << result.xrunCount << " xruns" <<
+							(result.acceptable ? "." : " (not acceptable).");
+					}
+					tested.push_back(result);
+				}
+			}
+		}
+	}
+
+	const LatencyTuningResult* best = nullptr;
+	for (const LatencyTuningResult& result : tested) {
+		if (!result.acceptable) {
+			continue;
+		}
+		if (best == nullptr || result.latency < best->latency ||
+			(result.latency == best->latency && result.callbackJitter < best->callbackJitter))
+		{
+			best = &result;
+		}
+	}
+
+	bool success = false;
+
+	if (best == nullptr) {
+		CX::Instances::Log.error("CX_SoundStream") << "autoTuneLatency(): None of the " << tested.size() << " tested configurations was acceptable.";
+	} else {
+		Configuration chosen = best->configuration;
+
+		CX::Instances::Log.notice("CX_SoundStream") << "autoTuneLatency(): Chose " << convertApiToString(chosen.api) <<
+			" with buffer size " << chosen.bufferSize << " and " << chosen.streamOptions.numberOfBuffers << " buffers, with an estimated latency of " <<
+			best->latency << " ms.";
+
+		if (!tuningConfig.filename.empty() && !chosen.writeToFile(tuningConfig.filename)) {
+			CX::Instances::Log.error("CX_SoundStream") << "autoTuneLatency(): The configuration could not be written to \"" << tuningConfig.filename << "\".";
+		}
+
+		success = setup(chosen);
+	}
+
+	if (results) {
+		*results = std::move(tested);
+	}
+
+	return success;
+}
+
+CX_SoundStream::LatencyTuningResult CX_SoundStream::_measureLatency(Configuration config, const LatencyTuningConfiguration& tuningConfig) {
+	LatencyTuningResult result;
+
+	if (!setup(config)) {
+		closeStream();
+		result.configuration = config;
+		return result;
+	}
+	stop(); //The probe is attached while the stream is stopped.
+
+	result.opened = true;
+	result.configuration = _config;
+	result.latency = estimateTotalLatency();
+	result.bufferPeriod = estimateLatencyPerBuffer();
+
+	double expectedCallbacks = (tuningConfig.testDuration + tuningConfig.warmupDuration) / result.bufferPeriod;
+	unsigned int maxCallbacks = (unsigned int)std::ceil(expectedCallbacks * 2) + 16;
+
+	LatencyProbe probe(maxCallbacks, CX::Instances::Clock.now() + tuningConfig.warmupDuration, result.bufferPeriod * tuningConfig.load);
+
+	//Only one handler is used, so that duplex streams are not loaded twice per callback.
+	if (_config.outputChannels > 0) {
+		ofAddListener(outputEvent, &probe, &LatencyProbe::outputHandler);
+	} else {
+		ofAddListener(inputEvent, &probe, &LatencyProbe::inputHandler);
+	}
+
+	start();
+	CX::Instances::Clock.sleep(tuningConfig.warmupDuration + tuningConfig.testDuration);
+	closeStream(); //Stopping the stream waits for the audio thread, so the probe can be read after this.
+
+	if (result.configuration.outputChannels > 0) {
+		ofRemoveListener(outputEvent, &probe, &LatencyProbe::outputHandler);
+	} else {
+		ofRemoveListener(inputEvent, &probe, &LatencyProbe::inputHandler);
+	}
+
+	const std::vector<CX_Millis>& times = probe.callbackTimes;
+	result.callbackCount = times.size();
+	result.xrunCount = probe.xrunCount;
+
+	if (times.size() >= 3) {
+		std::vector<double> intervals(times.size() - 1);
+		for (size_t i = 1; i < times.size(); i++) {
+			intervals[i - 1] = (times[i] - times[i - 1]).millis();
+		}
+
+		double mean = 0;
+		for (double interval : intervals) {
+			mean += interval;
+		}
+		mean /= intervals.size();
+
+		double variance = 0;
+		for (double interval : intervals) {
+			variance += (interval - mean) * (interval - mean);
+		}
+		variance /= (intervals.size() - 1);
+
+		result.callbackJitter = CX_Millis(std::sqrt(variance));
+		result.maxCallbackInterval = CX_Millis(*std::max_element(intervals.begin(), intervals.end()));
+
+		CX_Millis measuredTime = times.back() - times.front();
+		result.xrunsPerSecond = result.xrunCount / std::max(measuredTime.seconds(), 1e-3);
+
+		result.acceptable = (result.xrunsPerSecond <= tuningConfig.maxXrunsPerSecond) &&
+			(result.callbackJitter <= result.bufferPeriod * tuningConfig.maxJitterFraction);
+	}
+
+	return result;
+}
+
+/*! Gets the timings of the listeners that have been timed with a ListenerScope since the stream was set up or since
+resetListenerTimings() was called. This can be called from any thread while the stream is running.
+The timings are only measured if Configuration::listenerBudget is greater than 0.
+\return A vector with one entry per listener name, in the order in which the listeners were first timed. */
+std::vector<CX_SoundStream::ListenerTiming> CX_SoundStream::getListenerTimings(void) const {
+	std::vector<ListenerTiming> rval;
+	int count = _watchdogSlotCount.load(std::memory_order_acquire);
+	for (int i = 0; i < count; i++) {
+		rval.push_back(_readWatchdogSlot(_watchdogSlots[i]));
+	}
+	return rval;
+}
+
+/*! Gets the timing of the whole audio callback, including all of the listeners, in the same form as getListenerTimings().
+Callbacks that take longer than the buffer period are counted as over budget. */
+CX_SoundStream::ListenerTiming CX_SoundStream::getCallbackTiming(void) const {
+	return _readWatchdogSlot(_callbackWatchdog);
+}
+
+/*! Resets the counts and durations returned by getListenerTimings() and getCallbackTiming(). The listener names are kept. */
+void CX_SoundStream::resetListenerTimings(void) {
+	for (int i = 0; i < _maxWatchdogSlots; i++) {
+		_resetWatchdogSlot(_watchdogSlots[i]);
+	}
+	_resetWatchdogSlot(_callbackWatchdog);
+}
+
+//Only called by the audio thread, which is the only thread that claims slots.
+int CX_SoundStream::_findWatchdogSlot(const char* name) {
+	int count = _watchdogSlotCount.load(std::memory_order_relaxed);
+	for (int i = 0; i < count; i++) {
+		const char* slotName = _watchdogSlots[i].name.load(std::memory_order_relaxed);
+		if (slotName == name || std::strcmp(slotName, name) == 0) {
+			return i;
+		}
+	}
+
+	if (count == _maxWatchdogSlots) {
+		return -1;
+	}
+
+	_watchdogSlots[count].name.store(name, std::memory_order_relaxed);
+	_watchdogSlotCount.store(count + 1, std::memory_order_release);
+	return count;
+}
+
+//Returns true if the duration was over the budget.
+bool CX_SoundStream::_recordWatchdogTime(WatchdogSlot& slot, CX_Nanos duration, CX_Nanos budget) {
+	int64_t nanos = duration.nanos();
+
+	slot.callbackCount.fetch_add(1, std::memory_order_relaxed);
+	slot.totalNanos.fetch_add(nanos, std::memory_order_relaxed);
+	if (nanos > slot.maxNanos.load(std::memory_order_relaxed)) {
+		slot.maxNanos.store(nanos, std::memory_order_relaxed);
+	}
+
+	if (nanos > budget.nanos()) {
+		slot.overBudgetCount.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+CX_SoundStream::ListenerTiming CX_SoundStream::_readWatchdogSlot(const WatchdogSlot& slot) {
+	ListenerTiming rval;
+	const char* name = slot.name.load(std::memory_order_relaxed);
+	rval.name = (name == nullptr) ? "" : name;
+	rval.callbackCount = slot.callbackCount.load(std::memory_order_relaxed);
+	rval.overBudgetCount = slot.overBudgetCount.load(std::memory_order_relaxed);
+	rval.maxDuration = CX_Nanos(slot.maxNanos.load(std::memory_order_relaxed));
+	if (rval.callbackCount > 0) {
+		rval.meanDuration = CX_Nanos((int64_t)(slot.totalNanos.load(std::memory_order_relaxed) / (int64_t)rval.callbackCount));
+	}
+	return rval;
+}
+
+void CX_SoundStream::_resetWatchdogSlot(WatchdogSlot& slot) {
+	slot.callbackCount = 0;
+	slot.overBudgetCount = 0;
+	slot.totalNanos = 0;
+	slot.maxNanos = 0;
+}
+
+/*! Starts timing a listener.
+\param stream The stream that the listener is listening to, which is usually `args.instance`. If `nullptr`, nothing is timed.
+\param name The name that the listener is reported under. Must be a string literal. */
+CX_SoundStream::ListenerScope::ListenerScope(CX_SoundStream* stream, const char* name) :
+	_stream(stream),
+	_slot(-1)
+{
+	if (_stream != nullptr && _stream->_watchdogEnabled()) {
+		_slot = _stream->_findWatchdogSlot(name);
+		_start = CX::Instances::Clock.now();
+	}
+}
+
+CX_SoundStream::ListenerScope::~ListenerScope(void) {
+	if (_slot < 0) {
+		return;
+	}
+
+	CX_Nanos duration = CX::Instances::Clock.now() - _start;
+	WatchdogSlot& slot = _stream->_watchdogSlots[_slot];
+	if (_stream->_recordWatchdogTime(slot, duration, _stream->_listenerBudget)) {
+		_stream->_callbackLog.warning("Listener \"{}\" took {} ms, which is over its budget of {} ms.",
+			slot.name.load(std::memory_order_relaxed), duration, _stream->_listenerBudget);
+	}
+}
+
 /*! This function gets an estimate of the total stream latency, calculated based on the buffer size, number of buffers, and sample rate.
 The calculation is N_b * S_b / SR, where N_b is the number of buffers, S_b is the size of the buffers (in sample frames), and
 SR is the sample rate, in sample frames per second. This is a conservative upper bound on latency. Note that latency is not
@@ -329,16 +837,144 @@ void CX_SoundStream::waitForBufferSwap(void) {
 		;
 }
 
-/*! Gets the time at which the last buffer swap occurred. \return This time value can be compared with the result of CX::CX_Clock::now(). */
+/*! Gets the time at which the last buffer swap occurred, as measured at the start of the audio callback. The time of each callback
+varies somewhat, so for scheduling use sampleFrameToTime(), which filters out that variation.
+\return This time value can be compared with the result of CX::CX_Clock::now(). */
 CX_Millis CX_SoundStream::getLastSwapTime(void) const {
 	return _lastSwapTime;
 }
 
-/*! Estimate the time at which the next buffer swap will occur. The estimate is based on the buffer size
-and sample rate, not empirical measurement.
+/*! Estimate the time at which the next buffer swap will occur. The estimate comes from the filtered
+relationship between sample frames and time (see sampleFrameToTime()), so it is not affected by jitter
+in the timing of individual audio callbacks.
 \return The estimated time of next swap. This value can be compared with the result of CX::Instances::Clock.now(). */
 CX_Millis CX_SoundStream::estimateNextSwapTime(void) const {
-	return _lastSwapTime + this->estimateLatencyPerBuffer();
+	return sampleFrameToTime(_lastSampleNumber);
+}
+
+/*! Converts a sample frame number of the stream (see getSampleFrameNumber()) to the time at which the buffer
+containing it is requested from CX by the sound card, plus the time within the buffer at which the sample frame falls.
+This is the same kind of time as getLastSwapTime(), but rather than being the jittery time at which one audio
+callback started, it comes from a delay-locked loop that is updated on every callback and tracks the actual sample
+rate of the sound card relative to CX_Clock. So, for example, if the sound card's clock runs slightly fast,
+the conversion accounts for it.
+
+Before the first callback after the stream is started, the nominal sample rate is used. The filter takes roughly
+`1 / Configuration::clockSyncBandwidth` seconds to settle after the stream is started.
+
+This function can be called from any thread.
+\param sampleFrame The sample frame number. It can be in the past or the future.
+\return The time, which can be compared with the result of CX::Instances::Clock.now(). */
+CX_Millis CX_SoundStream::sampleFrameToTime(uint64_t sampleFrame) const {
+	uint64_t syncFrame;
+	double syncTime;
+	double nanosPerFrame;
+	if (!_readClockSync(&syncFrame, &syncTime, &nanosPerFrame)) {
+		nanosPerFrame = 1e9 / _config.sampleRate;
+		syncFrame = (_lastSampleNumber >= _config.bufferSize) ? _lastSampleNumber - _config.bufferSize : 0;
+		syncTime = (double)_lastSwapTime.nanos();
+	}
+
+	double frames = (sampleFrame >= syncFrame) ? (double)(sampleFrame - syncFrame) : -(double)(syncFrame - sampleFrame);
+	return CX_Nanos((cxTick_t)(syncTime + frames * nanosPerFrame));
+}
+
+/*! Converts a time to the sample frame of the stream that corresponds to it. This is the inverse of sampleFrameToTime().
+This function can be called from any thread.
+\param time The time, which can be compared with the result of CX::Instances::Clock.now().
+\return The sample frame number. If the time is before the start of the stream, 0 is returned. */
+uint64_t CX_SoundStream::timeToSampleFrame(CX_Millis time) const {
+	uint64_t syncFrame;
+	double syncTime;
+	double nanosPerFrame;
+	if (!_readClockSync(&syncFrame, &syncTime, &nanosPerFrame)) {
+		nanosPerFrame = 1e9 / _config.sampleRate;
+		syncFrame = (_lastSampleNumber >= _config.bufferSize) ? _lastSampleNumber - _config.bufferSize : 0;
+		syncTime = (double)_lastSwapTime.nanos();
+	}
+
+	double frames = ((double)time.nanos() - syncTime) / nanosPerFrame;
+	if (frames < 0 && -frames >= (double)syncFrame) {
+		return 0;
+	}
+	return (uint64_t)((int64_t)syncFrame + (int64_t)std::floor(frames));
+}
+
+//Runs in the audio thread. See "Using a DLL to filter time" by Fons Adriaensen (2005) for the filter.
+void CX_SoundStream::_updateClockSync(CX_Millis callbackTime, double streamTime, bool discontinuity) {
+	ClockSyncFilter& f = _syncFilter;
+
+	double nominalPeriod = 1e9 * (double)_config.bufferSize / _config.sampleRate;
+	double t = (double)callbackTime.nanos();
+
+	//RtAudio's stream time should advance by one buffer per callback. If it jumps, frames were
+	//skipped and the filter starts over.
+	if (f.initialized && std::abs((streamTime - f.lastStreamTime) * 1e9 - nominalPeriod) > nominalPeriod / 2) {
+		discontinuity = true;
+	}
+	f.lastStreamTime = streamTime;
+
+	double callbackNanos;
+	if (!f.initialized || discontinuity) {
+		double omega = 2 * PI * _config.clockSyncBandwidth * nominalPeriod / 1e9;
+		f.b = std::sqrt(2.0) * omega;
+		f.c = omega * omega;
+		f.period = nominalPeriod;
+		f.nextTime = t + f.period;
+		f.initialized = true;
+		callbackNanos = t;
+	} else {
+		double error = t - f.nextTime;
+		callbackNanos = f.nextTime;
+		f.nextTime += f.b * error + f.period;
+		f.period += f.c * error;
+	}
+
+	uint32_t seq = _clockSync.sequence.load(std::memory_order_relaxed);
+	_clockSync.sequence.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	_clockSync.sampleFrame.store(_lastSampleNumber, std::memory_order_relaxed);
+	_clockSync.time.store(callbackNanos, std::memory_order_relaxed);
+	_clockSync.nanosPerFrame.store(f.period / _config.bufferSize, std::memory_order_relaxed);
+
+	_clockSync.sequence.store(seq + 2, std::memory_order_release);
+}
+
+bool CX_SoundStream::_readClockSync(uint64_t* sampleFrame, double* time, double* nanosPerFrame) const {
+	while (true) {
+		uint32_t before = _clockSync.sequence.load(std::memory_order_acquire);
+		if (before == 0) {
+			return false;
+		}
+		if (before & 1) {
+			continue;
+		}
+
+		*sampleFrame = _clockSync.sampleFrame.load(std::memory_order_relaxed);
+		*time = _clockSync.time.load(std::memory_order_relaxed);
+		*nanosPerFrame = _clockSync.nanosPerFrame.load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (_clockSync.sequence.load(std::memory_order_relaxed) == before) {
+			return true;
+		}
+	}
+}
+
+//Must not be called while the audio thread is running.
+void CX_SoundStream::_resetClockSync(void) {
+	_syncFilter.initialized = false;
+	_syncFilter.nextTime = 0;
+	_syncFilter.period = 0;
+	_syncFilter.b = 0;
+	_syncFilter.c = 0;
+	_syncFilter.lastStreamTime = 0;
+
+	_clockSync.sequence.store(0);
+	_clockSync.sampleFrame.store(0);
+	_clockSync.time.store(0);
+	_clockSync.nanosPerFrame.store(0);
 }
 
 /*! This function returns a pointer to the RtAudio instance that this CX_SoundStream is using.
@@ -349,6 +985,24 @@ RtAudio* CX_SoundStream::getRtAudioInstance(void) const {
 	return _rtAudio.get();
 }
 
+/*! Gets the input ring buffer, which has all of the interleaved input data from the sound card copied
+into it by the audio thread. Only one thread may read from the ring buffer. If the reading thread does
+not keep up, new data is dropped (see CX_SPSCRingBuffer::getDroppedCount()).
+\return A pointer to the input ring buffer, or `nullptr` if the stream was not configured with an 
+input ring buffer (see Configuration::inputRingBufferSize). The pointer is invalidated by setup() and closeStream(). */
+CX_SPSCRingBuffer<float>* CX_SoundStream::getInputRingBuffer(void) {
+	return _inputRing.get();
+}
+
+/*! Gets the output ring buffer. Interleaved sound data written to the ring buffer by a single thread is
+played by the sound card. Data is taken from the ring buffer before the output event is triggered, so event
+listeners can add to that data.
+\return A pointer to the output ring buffer, or `nullptr` if the stream was not configured with an 
+output ring buffer (see Configuration::outputRingBufferSize). The pointer is invalidated by setup() and closeStream(). */
+CX_SPSCRingBuffer<float>* CX_SoundStream::getOutputRingBuffer(void) {
+	return _outputRing.get();
+}
+
 /*! Get a vector containing a list of all of the APIs for which the RtAudio driver
 has been compiled to use. If the API you want is not available, you might be able
 to get it by using a different version of RtAudio. */
@@ -573,15 +1227,31 @@ std::string CX_SoundStream::listDevices(RtAudio::Api api) {
 
 int CX_SoundStream::_rtAudioCallbackHandler(void *outputBuffer, void *inputBuffer, unsigned int bufferSize, double streamTime, RtAudioStreamStatus status) {
 
+	static thread_local bool threadNamed = false;
+	if (!threadNamed) {
+		CX::Instances::EventTrace.nameThread("CX audio callback");
+		threadNamed = true;
+	}
+
+	static thread_local bool priorityRaised = false;
+	if (_config.realTimeThreadPriority && !priorityRaised) {
+		_raiseThreadPriority();
+		priorityRaised = true;
+	}
+
+	CX_EventTrace::Scope traceScope(CX::Instances::EventTrace, CX_EventTrace::Event::AUDIO_CALLBACK, _lastSampleNumber);
+
 	_lastSwapTime = CX::Instances::Clock.now();
 
+	_updateClockSync(_lastSwapTime, streamTime, status != 0);
+
 	if (status != 0) {
-		CX::Instances::Log.error("CX_SoundStream") << "Buffer underflow/overflow detected.";
+		_callbackLog.error("Buffer underflow/overflow detected.");
 	}
 
 	//I don't think that I really need to check for this error. I will check for a while and if it never happens, I might remove the check.
 	if (_config.bufferSize != bufferSize) {
-		CX::Instances::Log.error("CX_SoundStream") << "The configuration's buffer size does not agree with the callback's buffer size. The stream is broken.";
+		_callbackLog.error("The configuration's buffer size does not agree with the callback's buffer size. The stream is broken.");
 	}
 
 	if (_config.inputChannels > 0) {
@@ -596,6 +1266,10 @@ int CX_SoundStream::_rtAudioCallbackHandler(void *outputBuffer, void *inputBuffe
 			callbackData.bufferOverflow = true;
 		}
 
+		if (_inputRing) {
+			_inputRing->write((float*)inputBuffer, bufferSize * _config.inputChannels);
+		}
+
 		ofNotifyEvent( this->inputEvent, callbackData );
 	}
 
@@ -604,6 +1278,11 @@ int CX_SoundStream::_rtAudioCallbackHandler(void *outputBuffer, void *inputBuffe
 		//Set the output to 0 so that if the event listener(s) do(es) nothing, this passes silence. This is wasteful if the event listeners do stuff.
 		memset(outputBuffer, 0, bufferSize * _config.outputChannels * sizeof(float));
 
+		//Whatever is in the output ring is played first. If there is not enough data, the rest is silence.
+		if (_outputRing) {
+			_outputRing->read((float*)outputBuffer, bufferSize * _config.outputChannels);
+		}
+
 		CX_SoundStream::OutputEventArgs callbackData;
 		callbackData.outputBuffer = (float*)outputBuffer;
 		callbackData.bufferSize = bufferSize;
@@ -620,17 +1299,85 @@ int CX_SoundStream::_rtAudioCallbackHandler(void *outputBuffer, void *inputBuffe
 
 	_lastSampleNumber += bufferSize;
 
+	if (_watchdogEnabled()) {
+		CX_Nanos duration = CX::Instances::Clock.now() - _lastSwapTime;
+		if (_recordWatchdogTime(_callbackWatchdog, duration, _callbackBudget)) {
+			_callbackLog.warning("The audio callback took {} ms, which is longer than the buffer period of {} ms.", duration, _callbackBudget);
+		}
+	}
+
 	return 0; //Return 0 to keep the stream going.
 }
 
+void CX_SoundStream::_raiseThreadPriority(void) {
+#ifdef TARGET_WIN32
+	DWORD taskIndex = 0;
+	HANDLE task = AvSetMmThreadCharacteristicsA("Pro Audio", &taskIndex);
+	if (task == NULL) {
+		_callbackLog.warning("The audio thread could not join the \"Pro Audio\" MMCSS task (error {}).", (unsigned int)GetLastError());
+		return;
+	}
+	if (!AvSetMmThreadPriority(task, AVRT_PRIORITY_HIGH)) {
+		_callbackLog.warning("The MMCSS priority of the audio thread could not be raised (error {}).", (unsigned int)GetLastError());
+	}
+#else
+	int minPriority = sched_get_priority_min(SCHED_FIFO);
+	int maxPriority = sched_get_priority_max(SCHED_FIFO);
+
+	//streamOptions.priority is 0 in a default RtAudio::StreamOptions, which is out of range. Using the maximum would put the audio thread above
+	//kernel threads (e.g. interrupt handlers) that run at high priorities, so the middle of the range is used instead.
+	sched_param param;
+	param.sched_priority = _config.streamOptions.priority;
+	if (param.sched_priority < minPriority || param.sched_priority > maxPriority) {
+		param.sched_priority = (minPriority + maxPriority) / 2;
+	}
+
+	int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if (err != 0) {
+		_callbackLog.warning("The priority of the audio thread could not be raised to {} (error {}). Check the rtprio limit.", param.sched_priority, err);
+	} else {
+		_callbackLog.notice("The audio thread is running with real-time priority {}.", param.sched_priority);
+	}
+#endif
+}
+
 int CX_SoundStream::_rtAudioCallback(void *outputBuffer, void *inputBuffer, unsigned int bufferSize, double streamTime, RtAudioStreamStatus status, void *data) {
 	return ((CX_SoundStream*)data)->_rtAudioCallbackHandler(outputBuffer, inputBuffer, bufferSize, streamTime, status);
 }
 
 //Try to pick a sample rate >= the requested sample rate for the api and device combination. 
 //If that is impossible, pick the next smallest sample rate.
+//Probing devices is slow with some apis, so the result is kept in the startup cache, if it is in use.
 unsigned int CX_SoundStream::_getBestSampleRate(unsigned int requestedSampleRate, RtAudio::Api api, int deviceId) {
 
+	//Device IDs change when devices are added or removed, so the device name is part of the key and the cached rate
+	//is only used if the device still supports it. Only this device is queried, rather than every device as in getDeviceList().
+	RtAudio::DeviceInfo info;
+	try {
+		RtAudio rt(api);
+		info = rt.getDeviceInfo(deviceId);
+	} catch (RT_AUDIO_ERROR_TYPE) {
+		return _findBestSampleRate(requestedSampleRate, api, deviceId);
+	}
+
+	std::string cacheKey = "soundStream.sampleRate." + ofToString((int)api) + "." + info.name + "." + ofToString(deviceId) + "." + ofToString(requestedSampleRate);
+	std::string cached;
+	if (Private::startupCache.get(cacheKey, cached)) {
+		unsigned int rate = ofFromString<unsigned int>(cached);
+		if (rate != 0 && std::find(info.sampleRates.begin(), info.sampleRates.end(), rate) != info.sampleRates.end()) {
+			return rate;
+		}
+	}
+
+	unsigned int bestSampleRate = _findBestSampleRate(requestedSampleRate, api, deviceId);
+	if (bestSampleRate != 0) {
+		Private::startupCache.set(cacheKey, ofToString(bestSampleRate));
+	}
+	return bestSampleRate;
+}
+
+unsigned int CX_SoundStream::_findBestSampleRate(unsigned int requestedSampleRate, RtAudio::Api api, int deviceId) {
+
 	unsigned int closestGreaterSampleRate = numeric_limits<unsigned int>::max();
 	unsigned int closestLesserSampleRate = 0;
 
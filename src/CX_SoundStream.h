@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <vector>
 
 #include "RtAudio.h"
 
@@ -11,6 +13,7 @@
 
 #include "CX_Clock.h"
 #include "CX_Logger.h"
+#include "CX_SPSCRingBuffer.h"
 
 namespace CX {
 
@@ -23,6 +26,17 @@ If the stream in configured for output, the output event will be triggered whene
 more sound data. If the stream is configured for input, the input event will be triggered whenever some
 amount of sound data has been recorded.
 
+The event listeners are called in the audio thread, so they must do very little work and must not allocate
+memory or wait on locks. As an alternative, the stream can be configured to have ring buffers for input 
+and/or output (see Configuration::inputRingBufferSize and Configuration::outputRingBufferSize). The audio
+thread copies all input data into the input ring buffer, from which a single other thread can read it
+with getInputRingBuffer(). Likewise, a single other thread can write data to the output ring buffer with
+getOutputRingBuffer(), which is copied to the sound card before the output event is triggered.
+
+To find out which listener is making the callback too slow, enable the callback watchdog with Configuration::listenerBudget.
+The listeners in CX (for example, CX_SoundBufferPlayer and the Synth stream outputs) are timed with a ListenerScope,
+and your own listeners can be too. See getListenerTimings().
+
 CX_SoundStream uses RtAudio internally, so you are having problems, you might be able to figure out what is
 going wrong by checking out the page for RtAudio: http://www.music.mcgill.ca/~gary/rtaudio/index.html
 \ingroup sound
@@ -42,7 +56,17 @@ public:
 			api(RtAudio::Api::UNSPECIFIED),
 
 			inputDeviceId(-1),
-			outputDeviceId(-1)
+			outputDeviceId(-1),
+
+			inputRingBufferSize(0),
+			outputRingBufferSize(0),
+
+			clockSyncBandwidth(0.5),
+
+			realTimeThreadPriority(false),
+			listenerBudget(0),
+
+			outputLatencyOffset(0)
 		{
 			//streamOptions.streamName = "CX_SoundStream";
 			streamOptions.numberOfBuffers = 2; //More buffers means higher latency but fewer glitches. Same applies to bufferSize.
@@ -81,10 +105,134 @@ public:
 		int inputDeviceId; //!< The ID of the desired input device. A value less than 0 will cause the system default input device to be used.
 		int outputDeviceId; //!< The ID of the desired output device. A value less than 0 will cause the system default output device to be used.
 
+		/*! The size of the input ring buffer, in sample frames. If 0, there is no input ring buffer. The ring buffer should hold
+		at least several buffers worth of data so that the reading thread does not need to read very frequently. */
+		unsigned int inputRingBufferSize;
+
+		/*! The size of the output ring buffer, in sample frames. If 0, there is no output ring buffer. Larger sizes allow
+		the writing thread to write less often, but data written to the ring buffer is delayed by the amount of data 
+		already in it. */
+		unsigned int outputRingBufferSize;
+
+		/*! The bandwidth, in Hz, of the filter that keeps track of when sample frames are sent to the sound card (see
+		sampleFrameToTime()). Lower values give a smoother estimate that takes longer to settle after the stream is
+		started. The settling time is roughly `1 / clockSyncBandwidth` seconds. */
+		double clockSyncBandwidth;
+
+		/*! If `true`, the audio callback thread raises its own priority the first time it runs. On Windows, the thread joins
+		the "Pro Audio" Multimedia Class Scheduler Service (MMCSS) task. On other systems, the thread is given the `SCHED_FIFO`
+		policy with `streamOptions.priority` as its priority, or the middle of the `SCHED_FIFO` priority range if `streamOptions.priority`
+		is out of range. On Linux, this needs the `rtprio` limit to be raised (or root). The priority that is used is logged, and if raising
+		the priority fails, a warning is logged. */
+		bool realTimeThreadPriority;
+
+		/*! If greater than 0, the callback watchdog is enabled. Every listener that is timed with a ListenerScope may spend at most
+		this fraction of the buffer period per callback; a warning is logged each time a listener goes over its budget, and the whole
+		callback is checked against the buffer period. See getListenerTimings(). For example, 0.25 allows each listener a quarter
+		of the buffer period. */
+		double listenerBudget;
+
+		/*! The measured difference between the time at which sounds are heard and the time at which they are scheduled to
+		start, after the latency estimate of the stream (see estimateTotalLatency()) is accounted for. It is subtracted from
+		the start times given to CX_SoundBufferPlayer::startPlayingAt() and CX_SoundMixer::playAt(), so that scheduled sounds are
+		heard at the time that was asked for. Positive values mean that sounds would otherwise be late. It is usually measured
+		with CX_LatencyCalibration, which can save it to a configuration file. Defaults to 0. */
+		CX_Millis outputLatencyOffset;
+
 		bool setFromFile(std::string filename, std::string delimiter = "=", bool trimWhitespace = true, std::string commentStr = "//", std::string keyPrefix = "ss.");
+		bool writeToFile(std::string filename, std::string delimiter = "=", std::string keyPrefix = "ss.") const;
 
 	};
 
+	/*! The settings used by autoTuneLatency(). */
+	struct LatencyTuningConfiguration {
+		LatencyTuningConfiguration(void) :
+			apis(),
+			allDevices(false),
+			bufferSizes({ 64, 128, 256, 512, 1024, 2048 }),
+			bufferCounts({ 2, 3, 4 }),
+			testDuration(CX_Seconds(2)),
+			warmupDuration(CX_Millis(250)),
+			load(0.5),
+			maxXrunsPerSecond(0),
+			maxJitterFraction(0.25),
+			filename("")
+		{
+			baseConfiguration.outputChannels = 2;
+		}
+
+		/*! The configuration that is tuned. The number of channels, sample rate, stream flags, ring buffer sizes, etc. are
+		taken from this configuration. The api, device IDs, `bufferSize`, and `streamOptions.numberOfBuffers` are swept. */
+		Configuration baseConfiguration;
+
+		/*! The APIs to test. If empty, every API returned by getCompiledApis() is tested, except `RTAUDIO_DUMMY`. */
+		std::vector<RtAudio::Api> apis;
+
+		/*! If `false`, only the devices given in `baseConfiguration` (or the default devices, if the IDs are negative) are tested.
+		If `true`, every device of each API with enough channels is tested, using the same device for input and output. */
+		bool allDevices;
+
+		std::vector<unsigned int> bufferSizes; //!< The buffer sizes to test, in sample frames. Rounded up to powers of 2, like in setup().
+		std::vector<unsigned int> bufferCounts; //!< The values of `streamOptions.numberOfBuffers` to test.
+
+		CX_Millis testDuration; //!< How long each configuration is measured for.
+		CX_Millis warmupDuration; //!< How long each configuration runs before measurement starts, so that startup glitches are not counted.
+
+		/*! The synthetic load put on the audio callback, as a fraction of the buffer period. The callback busy-waits for this fraction
+		of the time that a buffer lasts, which stands in for the work that the event listeners of a real experiment do. */
+		double load;
+
+		double maxXrunsPerSecond; //!< The most underflows and overflows per second that a configuration may have and still be chosen.
+
+		/*! The largest allowed standard deviation of the time between callbacks, as a fraction of the buffer period.
+		Configurations with more jitter are not chosen, because the scheduling of the audio thread is not reliable with them. */
+		double maxJitterFraction;
+
+		/*! If not empty, the chosen configuration is written to this file with Configuration::writeToFile(), so that it can be
+		read later with Configuration::setFromFile(). */
+		std::string filename;
+	};
+
+	/*! The measurements of one configuration tested by autoTuneLatency(). */
+	struct LatencyTuningResult {
+		LatencyTuningResult(void) :
+			opened(false),
+			acceptable(false),
+			callbackCount(0),
+			xrunCount(0),
+			xrunsPerSecond(0)
+		{}
+
+		Configuration configuration; //!< The configuration as it was actually used by the stream, which may differ from what was requested.
+
+		bool opened; //!< `false` if the stream could not be set up with this configuration. The other measurements are meaningless if so.
+		bool acceptable; //!< `true` if the measurements were within the limits in LatencyTuningConfiguration.
+
+		CX_Millis latency; //!< The latency of the configuration, as given by estimateTotalLatency().
+		CX_Millis bufferPeriod; //!< The amount of time that each buffer lasts.
+
+		CX_Millis callbackJitter; //!< The standard deviation of the time between callbacks.
+		CX_Millis maxCallbackInterval; //!< The longest time between two callbacks.
+
+		unsigned int callbackCount; //!< The number of callbacks that were measured.
+		unsigned int xrunCount; //!< The number of callbacks that reported an underflow or overflow.
+		double xrunsPerSecond; //!< `xrunCount` divided by the measurement time.
+	};
+
+	/*! The timing of one listener measured by the callback watchdog. See getListenerTimings(). */
+	struct ListenerTiming {
+		ListenerTiming(void) :
+			callbackCount(0),
+			overBudgetCount(0)
+		{}
+
+		std::string name; //!< The name that was given to the ListenerScope.
+		uint64_t callbackCount; //!< The number of callbacks that the listener was timed for.
+		uint64_t overBudgetCount; //!< The number of callbacks in which the listener went over its budget.
+		CX_Millis meanDuration; //!< The mean time that the listener spent per callback.
+		CX_Millis maxDuration; //!< The longest time that the listener spent in one callback.
+	};
+
 	/*! The audio output event of the CX_SoundStream sends a copy of this structure with
 	the fields filled out when the event is called. */
 	struct OutputEventArgs {
@@ -116,6 +264,30 @@ public:
 	};
 
 
+	/*! Times a listener of the outputEvent or inputEvent for the callback watchdog (see Configuration::listenerBudget).
+	Make one at the start of the event handler; the time until it is destroyed is counted against the listener.
+	If the watchdog is not enabled, it does nothing.
+
+	\code{.cpp}
+	void MyClass::outputHandler(CX_SoundStream::OutputEventArgs& args) {
+		CX_SoundStream::ListenerScope watchdog(args.instance, "MyClass");
+		//Fill the buffer...
+	}
+	\endcode
+
+	`name` must be a string literal (or otherwise outlive the stream) because it is stored without being copied, so that the
+	audio thread does not allocate. Listeners with the same name are counted together. At most 32 names are tracked per stream. */
+	class ListenerScope {
+	public:
+		ListenerScope(CX_SoundStream* stream, const char* name);
+		~ListenerScope(void);
+
+	private:
+		CX_SoundStream* _stream;
+		int _slot;
+		CX_Millis _start;
+	};
+
 	CX_SoundStream (void);
 	~CX_SoundStream (void);
 
@@ -125,7 +297,11 @@ public:
 	bool start(void);
 	bool stop(void);
 
+	bool autoTuneLatency(LatencyTuningConfiguration tuningConfig, std::vector<LatencyTuningResult>* results = nullptr);
+
 	bool isStreamRunning(void) const;
+
+	void setOutputLatencyOffset(CX_Millis offset);
 	
 	/*! Gets the configuration that was used on the last call to setup(). Because some of the configuration
 	options are only suggestions, this function allows you to check what the actual used configuration was.
@@ -146,8 +322,18 @@ public:
 	CX_Millis getLastSwapTime(void) const;
 	CX_Millis estimateNextSwapTime(void) const;
 
+	CX_Millis sampleFrameToTime(uint64_t sampleFrame) const;
+	uint64_t timeToSampleFrame(CX_Millis time) const;
+
+	std::vector<ListenerTiming> getListenerTimings(void) const;
+	ListenerTiming getCallbackTiming(void) const;
+	void resetListenerTimings(void);
+
 	RtAudio* getRtAudioInstance(void) const;
 
+	CX_SPSCRingBuffer<float>* getInputRingBuffer(void);
+	CX_SPSCRingBuffer<float>* getOutputRingBuffer(void);
+
 	static std::vector<RtAudio::Api> getCompiledApis(void);
 	static std::vector<std::string> convertApisToStrings(vector<RtAudio::Api> apis);
 	static std::string convertApisToString(std::vector<RtAudio::Api> apis, std::string delim = "\r\n");
@@ -163,18 +349,75 @@ public:
 private:
 
 	static unsigned int _getBestSampleRate(unsigned int requestedSampleRate, RtAudio::Api api, int deviceIndex);
+	static unsigned int _findBestSampleRate(unsigned int requestedSampleRate, RtAudio::Api api, int deviceIndex);
 
 	static int _rtAudioCallback(void *outputBuffer, void *inputBuffer, unsigned int bufferSize, double streamTime, RtAudioStreamStatus status, void *data);
 
 	int _rtAudioCallbackHandler (void *outputBuffer, void *inputBuffer, unsigned int bufferSize, double streamTime, RtAudioStreamStatus status);
 
+	struct LatencyProbe;
+	LatencyTuningResult _measureLatency(Configuration config, const LatencyTuningConfiguration& tuningConfig);
+
+	void _raiseThreadPriority(void);
+
+	//The callback watchdog. Slots are only claimed and written by the audio thread; other threads read them.
+	struct WatchdogSlot {
+		std::atomic<const char*> name;
+		std::atomic<uint64_t> callbackCount;
+		std::atomic<uint64_t> overBudgetCount;
+		std::atomic<int64_t> totalNanos;
+		std::atomic<int64_t> maxNanos;
+	};
+	static const int _maxWatchdogSlots = 32;
+	WatchdogSlot _watchdogSlots[_maxWatchdogSlots];
+	std::atomic<int> _watchdogSlotCount;
+	WatchdogSlot _callbackWatchdog; //The whole callback.
+	CX_Nanos _listenerBudget;
+	CX_Nanos _callbackBudget;
+
+	bool _watchdogEnabled(void) const { return _listenerBudget.nanos() > 0; };
+	int _findWatchdogSlot(const char* name);
+	bool _recordWatchdogTime(WatchdogSlot& slot, CX_Nanos duration, CX_Nanos budget);
+	static ListenerTiming _readWatchdogSlot(const WatchdogSlot& slot);
+	static void _resetWatchdogSlot(WatchdogSlot& slot);
+
 	std::shared_ptr<RtAudio> _rtAudio;
 	//RtAudio *_rtAudio;
 	Configuration _config;
 
+	std::unique_ptr<CX_SPSCRingBuffer<float>> _inputRing;
+	std::unique_ptr<CX_SPSCRingBuffer<float>> _outputRing;
+
+	CX_Logger::RealTimeChannel _callbackLog; //For messages logged from the audio callback.
+
 	CX_Millis _lastSwapTime;
 	uint64_t _lastSampleNumber;
 	uint64_t _sampleNumberAtLastCheck;
+
+	//A delay-locked loop that filters the times of the audio callbacks to find the relationship between
+	//sample frames and CX_Clock time. The state is only used by the audio thread.
+	struct ClockSyncFilter {
+		bool initialized;
+		double nextTime; //The predicted time of the next callback, in nanoseconds.
+		double period; //The filtered time between callbacks, in nanoseconds.
+		double b;
+		double c;
+		double lastStreamTime;
+	};
+	ClockSyncFilter _syncFilter;
+	void _updateClockSync(CX_Millis callbackTime, double streamTime, bool discontinuity);
+
+	//The result of the filter, which is read by other threads. The sequence number is odd while the
+	//audio thread is writing and is 0 until the first callback.
+	struct ClockSync {
+		std::atomic<uint32_t> sequence;
+		std::atomic<uint64_t> sampleFrame;
+		std::atomic<double> time;
+		std::atomic<double> nanosPerFrame;
+	};
+	ClockSync _clockSync;
+	bool _readClockSync(uint64_t* sampleFrame, double* time, double* nanosPerFrame) const;
+	void _resetClockSync(void);
 };
 
 } //namespace CX
@@ -0,0 +1,342 @@
+#include "CX_SoundStreamFileRecorder.h"
+
+#include "CX_Utilities.h"
+
+namespace CX {
+
+CX_SoundStreamFileRecorder::CX_SoundStreamFileRecorder(void) :
+	_handlersActive(0),
+	_recording(false),
+	_writing(false),
+	_activeRing(nullptr),
+	_bufferDuration(CX_Seconds(5)),
+	_headerUpdateInterval(CX_Seconds(2)),
+	_samplesWritten(0),
+	_droppedAtStart(0),
+	_channels(0),
+	_soundStream(nullptr),
+	_soundStreamSelfAllocated(false),
+	_listeningForEvents(false)
+{
+}
+
+CX_SoundStreamFileRecorder::~CX_SoundStreamFileRecorder(void) {
+	this->stop();
+	if (_soundStream != nullptr) {
+		_listenForEvents(false);
+		if (_soundStreamSelfAllocated) {
+			_soundStream->closeStream();
+			delete _soundStream;
+			_soundStreamSelfAllocated = false;
+		}
+	}
+}
+
+/*! This function sets up the CX_SoundStream that CX_SoundStreamFileRecorder uses to record audio data.
+\param config A reference to a CX_SoundStreamFileRecorder::Configuration struct that will be used to configure
+an internally-stored CX_SoundStream.
+\return `true` if configuration of the CX_SoundStream was successful, `false` otherwise.
+*/
+bool CX_SoundStreamFileRecorder::setup(CX_SoundStreamFileRecorder::Configuration& config) {
+	_cleanUpOldSoundStream();
+
+	_soundStream = new CX_SoundStream;
+	_soundStreamSelfAllocated = true;
+	_listenForEvents(true);
+
+	bool setupSuccessfully = _soundStream->setup((CX_SoundStream::Configuration&)config);
+	_allocateOwnRing();
+	bool startedSuccessfully = _soundStream->start();
+
+	return startedSuccessfully && setupSuccessfully;
+}
+
+/*! Set up the recorder from an existing CX_SoundStream. The CX_SoundStream is not started automatically.
+The CX_SoundStream must remain in scope for the lifetime of the CX_SoundStreamFileRecorder.
+\param ss A pointer to a fully configured CX_SoundStream.
+\return `true` in all cases. */
+bool CX_SoundStreamFileRecorder::setup(CX_SoundStream* ss) {
+	_cleanUpOldSoundStream();
+
+	_soundStream = ss;
+	_soundStreamSelfAllocated = false;
+	_allocateOwnRing();
+	_listenForEvents(true);
+
+	return true;
+}
+
+/*! Returns the configuration used for this CX_SoundStreamFileRecorder. */
+CX_SoundStreamFileRecorder::Configuration CX_SoundStreamFileRecorder::getConfiguration(void) {
+	if (_soundStream == nullptr) {
+		CX::Instances::Log.error("CX_SoundStreamFileRecorder") << "getConfiguration(): Could not get configuration, the sound stream was nonexistent. Have you forgotten to call setup()?";
+		return CX_SoundStreamFileRecorder::Configuration();
+	}
+
+	return (CX_SoundStreamFileRecorder::Configuration)_soundStream->getConfiguration();
+}
+
+/*! Sets the amount of audio that can be waiting to be written to disk before data is dropped. This is
+only used if the CX_SoundStream does not have an input ring buffer, in which case that ring buffer is
+used instead. The buffer is allocated when this is called after setup() or, otherwise, in setup(). This
+cannot be changed while recording.
+\param duration The duration of audio that the buffer should be able to hold. Defaults to 5 seconds. */
+void CX_SoundStreamFileRecorder::setBufferDuration(CX_Millis duration) {
+	if (_recording) {
+		CX::Instances::Log.warning("CX_SoundStreamFileRecorder") << "setBufferDuration(): The buffer duration cannot be changed while recording. Call stop() first.";
+		return;
+	}
+
+	_bufferDuration = duration;
+	_allocateOwnRing();
+}
+
+/*! Sets how often the header of the file is updated with the amount of recorded data. If the program
+crashes, data recorded since the last update may be lost. The file is also flushed at each update.
+\param interval The time between updates. Defaults to 2 seconds. */
+void CX_SoundStreamFileRecorder::setHeaderUpdateInterval(CX_Millis interval) {
+	_headerUpdateInterval = interval;
+}
+
+/*! Opens the file and begins recording to it. If the file already exists, it is overwritten.
+\param filename The name of the file. If it does not end with ".wav", ".wav" is appended. Relative paths are
+relative to the data directory.
+\return `true` if the file was opened and recording started, `false` otherwise. */
+bool CX_SoundStreamFileRecorder::start(std::string filename) {
+	if (_recording) {
+		CX::Instances::Log.warning("CX_SoundStreamFileRecorder") << "start(): Already recording. Call stop() first.";
+		return false;
+	}
+
+	if (_soundStream == nullptr) {
+		CX::Instances::Log.error("CX_SoundStreamFileRecorder") << "start(): Unable to start recording because the recorder has not been set up.";
+		return false;
+	}
+
+	const Configuration& config = _soundStream->getConfiguration();
+	if (config.inputChannels <= 0) {
+		CX::Instances::Log.error("CX_SoundStreamFileRecorder") << "start(): The sound stream has no input channels.";
+		return false;
+	}
+	_channels = config.inputChannels;
+
+	if (ofToLower(ofFilePath::getFileExt(filename)) != "wav") {
+		filename += ".wav";
+	}
+
+	CX_SPSCRingBuffer<float>* streamRing = _soundStream->getInputRingBuffer();
+	if (streamRing == nullptr && _ownRing.capacity() < (size_t)_channels) {
+		CX::Instances::Log.error("CX_SoundStreamFileRecorder") << "start(): The sound stream had no input channels when the recorder was set up, so"
+			" there is no buffer to record into. Call setup() again after configuring the sound stream.";
+		return false;
+	}
+
+	_file.open(ofToDataPath(filename).c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!_file.is_open()) {
+		CX::Instances::Log.error("CX_SoundStreamFileRecorder") << "start(): Error opening sound file \"" << filename << "\" for writing.";
+		return false;
+	}
+
+	_samplesWritten = 0;
+	_updateHeader(); //Write a header for an empty file.
+
+	_activeRing = streamRing;
+	if (_activeRing != nullptr) {
+		_activeRing->discard(_activeRing->getReadAvailable()); //Throw away anything that was recorded before starting.
+	} else {
+		//No handler is writing to the ring once the handlers from the last recording have returned, so it can be emptied.
+		_waitForHandlers();
+		_ownRing.clear();
+		_activeRing = &_ownRing;
+	}
+	_droppedAtStart = _activeRing->getDroppedCount();
+
+	_readScratch.resize(std::min<size_t>(_activeRing->capacity(), 65536));
+	_writeScratch.resize(_readScratch.size());
+
+	_writing = true;
+	_writerThread = std::thread(&CX_SoundStreamFileRecorder::_writerLoop, this);
+
+	_recording = true;
+	return true;
+}
+
+/*! Stops recording, writes any remaining data, and closes the file. */
+void CX_SoundStreamFileRecorder::stop(void) {
+	_recording = false;
+	_waitForHandlers();
+
+	if (!_writerThread.joinable()) {
+		return;
+	}
+
+	_writing = false;
+	_writerThread.join();
+
+	while (_writeAvailableData() > 0)
+		;
+
+	_updateHeader();
+	_file.close();
+
+	uint64_t dropped = getDroppedSampleFrames();
+	if (dropped > 0) {
+		CX::Instances::Log.warning("CX_SoundStreamFileRecorder") << "stop(): " << dropped << " sample frames were dropped because the"
+			" disk could not keep up. Consider using a larger buffer duration.";
+	}
+}
+
+/*! \brief Returns `true` if currently recording. */
+bool CX_SoundStreamFileRecorder::isRecording(void) const {
+	return _recording;
+}
+
+/*! Returns the number of sample frames that have been written to the file for the current (or last) recording. */
+uint64_t CX_SoundStreamFileRecorder::getRecordedSampleFrames(void) const {
+	return (_channels > 0) ? _samplesWritten.load() / _channels : 0;
+}
+
+/*! Returns the number of sample frames that were lost during the current (or last) recording
+because the background thread did not keep up with the incoming data. */
+uint64_t CX_SoundStreamFileRecorder::getDroppedSampleFrames(void) const {
+	if (_activeRing == nullptr || _channels <= 0) {
+		return 0;
+	}
+	return (_activeRing->getDroppedCount() - _droppedAtStart) / _channels;
+}
+
+bool CX_SoundStreamFileRecorder::_inputEventHandler(CX_SoundStream::InputEventArgs& inputData) {
+	CX_SoundStream::ListenerScope watchdog(inputData.instance, "CX_SoundStreamFileRecorder");
+
+	_handlersActive++;
+	//If the stream has a ring buffer, data is read from that instead.
+	if (!_recording || _activeRing != &_ownRing) {
+		_handlersActive--;
+		return false;
+	}
+
+	_ownRing.write(inputData.inputBuffer, inputData.bufferSize * inputData.inputChannels);
+	_handlersActive--;
+	return true;
+}
+
+//Waits for any input event handler that saw that the recorder was recording to return.
+void CX_SoundStreamFileRecorder::_waitForHandlers(void) {
+	while (_handlersActive.load() > 0) {
+		std::this_thread::yield();
+	}
+}
+
+//Must not be called while recording. If the sound stream has no input channels, nothing is allocated.
+void CX_SoundStreamFileRecorder::_allocateOwnRing(void) {
+	if (_soundStream == nullptr) {
+		return;
+	}
+
+	const Configuration& config = _soundStream->getConfiguration();
+	if (config.inputChannels <= 0) {
+		return;
+	}
+
+	_waitForHandlers();
+	_ownRing.setup((size_t)ceil(_bufferDuration.seconds() * config.sampleRate) * config.inputChannels);
+}
+
+void CX_SoundStreamFileRecorder::_writerLoop(void) {
+	CX_Millis period = _soundStream->estimateLatencyPerBuffer() / 2;
+	std::chrono::microseconds sleepTime((long long)std::max(period.micros(), 500.0));
+
+	CX_Millis lastHeaderUpdate = CX::Instances::Clock.now();
+
+	while (_writing) {
+		if (_writeAvailableData() == 0) {
+			std::this_thread::sleep_for(sleepTime);
+		}
+
+		if (CX::Instances::Clock.now() - lastHeaderUpdate >= _headerUpdateInterval) {
+			_updateHeader();
+			lastHeaderUpdate = CX::Instances::Clock.now();
+		}
+	}
+}
+
+//Writes up to one scratch buffer of data from the ring buffer to the file. Only whole sample frames are written.
+size_t CX_SoundStreamFileRecorder::_writeAvailableData(void) {
+	size_t available = _activeRing->getReadAvailable();
+	available -= available % _channels;
+
+	size_t count = _activeRing->read(_readScratch.data(), std::min(available, _readScratch.size() - (_readScratch.size() % _channels)));
+
+	for (size_t i = 0; i < count; i++) {
+		_writeScratch[i] = (int16_t)(CX::Util::clamp<float>(_readScratch[i], -1, 1) * 32767.f);
+	}
+
+	if (count > 0) {
+		_file.write((char*)_writeScratch.data(), count * sizeof(int16_t));
+		_samplesWritten += count;
+	}
+
+	return count;
+}
+
+//Rewrites the header at the start of the file with the current amount of data, then returns to the end.
+void CX_SoundStreamFileRecorder::_updateHeader(void) {
+	const uint32_t sampleRate = _soundStream->getConfiguration().sampleRate;
+	const uint16_t channels = _channels;
+	const uint16_t format = 1; //PCM
+	const uint16_t bitsPerSample = 16;
+	const uint32_t fmtSize = 16;
+	const uint32_t byteRate = sampleRate * channels * bitsPerSample / 8;
+	const uint16_t blockAlign = channels * bitsPerSample / 8;
+
+	//The sizes in the header are 32 bits, so very long recordings saturate at the maximum size.
+	uint64_t dataBytes = _samplesWritten.load() * (bitsPerSample / 8);
+	uint32_t dataSize = (uint32_t)std::min<uint64_t>(dataBytes, 0xFFFFFFFFull - 36);
+	uint32_t chunkSize = 36 + dataSize;
+
+	_file.seekp(0, std::ios::beg);
+	_file.write("RIFF", 4);
+	_file.write((const char*)&chunkSize, 4);
+	_file.write("WAVE", 4);
+	_file.write("fmt ", 4);
+	_file.write((const char*)&fmtSize, 4);
+	_file.write((const char*)&format, 2);
+	_file.write((const char*)&channels, 2);
+	_file.write((const char*)&sampleRate, 4);
+	_file.write((const char*)&byteRate, 4);
+	_file.write((const char*)&blockAlign, 2);
+	_file.write((const char*)&bitsPerSample, 2);
+	_file.write("data", 4);
+	_file.write((const char*)&dataSize, 4);
+	_file.seekp(0, std::ios::end);
+	_file.flush();
+}
+
+void CX_SoundStreamFileRecorder::_listenForEvents(bool listen) {
+	if ((listen == _listeningForEvents) || (_soundStream == nullptr)) {
+		return;
+	}
+
+	if (listen) {
+		ofAddListener(_soundStream->inputEvent, this, &CX_SoundStreamFileRecorder::_inputEventHandler);
+	} else {
+		ofRemoveListener(_soundStream->inputEvent, this, &CX_SoundStreamFileRecorder::_inputEventHandler);
+	}
+
+	_listeningForEvents = listen;
+}
+
+void CX_SoundStreamFileRecorder::_cleanUpOldSoundStream(void) {
+	if (_soundStream != nullptr) {
+		this->stop();
+		_listenForEvents(false);
+
+		if (_soundStreamSelfAllocated) {
+			delete _soundStream;
+			_soundStreamSelfAllocated = false;
+		}
+		_soundStream = nullptr;
+	}
+}
+
+}
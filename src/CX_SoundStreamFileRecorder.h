@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+#include "CX_SoundStream.h"
+#include "CX_SPSCRingBuffer.h"
+
+namespace CX {
+	/*! This class records audio data from a CX_SoundStream, e.g. from a microphone, directly to a wav
+	file on disk. Unlike CX_SoundBufferRecorder, the recording is never held in memory, so recordings can
+	last for a whole session without using more memory over time.
+
+	Input data is passed from the audio thread to a background thread through a fixed-size ring buffer
+	and the background thread writes it to the file. The header of the file is updated periodically (see
+	setHeaderUpdateInterval()), so if the program crashes, the file is valid up to the last update.
+	The file is written as 16-bit PCM.
+
+	If the CX_SoundStream has an input ring buffer (see CX_SoundStream::Configuration::inputRingBufferSize),
+	data is read from that ring buffer and the recorder must be its only reader. Otherwise, the recorder
+	uses its own ring buffer which is filled from the input event of the CX_SoundStream.
+
+	\code{.cpp}
+	CX_SoundStreamFileRecorder recorder;
+
+	CX_SoundStreamFileRecorder::Configuration recorderConfig;
+	recorderConfig.inputChannels = 1;
+	//You will probably need to configure more than just the number of input channels.
+	recorder.setup(recorderConfig);
+
+	recorder.start("session recording.wav");
+	//Run the experiment...
+	recorder.stop();
+	\endcode
+	\ingroup sound
+	*/
+	class CX_SoundStreamFileRecorder {
+	public:
+		typedef CX_SoundStream::Configuration Configuration; //!< This is typedef'ed to \ref CX::CX_SoundStream::Configuration.
+
+		CX_SoundStreamFileRecorder(void);
+		~CX_SoundStreamFileRecorder(void);
+
+		bool setup(Configuration& config);
+		bool setup(CX_SoundStream* ss);
+
+		Configuration getConfiguration(void);
+
+		//! Provides direct access to the CX_SoundStream used by the CX_SoundStreamFileRecorder.
+		CX_SoundStream* getSoundStream(void) { return _soundStream; };
+
+		void setBufferDuration(CX_Millis duration);
+		void setHeaderUpdateInterval(CX_Millis interval);
+
+		bool start(std::string filename);
+		void stop(void);
+
+		bool isRecording(void) const;
+		uint64_t getRecordedSampleFrames(void) const;
+		uint64_t getDroppedSampleFrames(void) const;
+
+	private:
+		bool _inputEventHandler(CX_SoundStream::InputEventArgs& inputData);
+		std::atomic<int> _handlersActive; //The number of input event handlers that are running on the audio thread.
+		void _waitForHandlers(void);
+
+		std::atomic<bool> _recording;
+		std::atomic<bool> _writing;
+		std::thread _writerThread;
+		void _writerLoop(void);
+		size_t _writeAvailableData(void);
+		void _updateHeader(void);
+
+		CX_SPSCRingBuffer<float>* _activeRing;
+		CX_SPSCRingBuffer<float> _ownRing; //Allocated in setup(), so that it is never reallocated while the audio thread might be writing to it.
+		void _allocateOwnRing(void);
+		CX_Millis _bufferDuration;
+		CX_Millis _headerUpdateInterval;
+
+		std::fstream _file;
+		std::vector<float> _readScratch;
+		std::vector<int16_t> _writeScratch;
+		std::atomic<uint64_t> _samplesWritten;
+		uint64_t _droppedAtStart;
+		int _channels;
+
+		CX_SoundStream *_soundStream;
+		bool _soundStreamSelfAllocated;
+		void _cleanUpOldSoundStream(void);
+
+		void _listenForEvents(bool listen);
+		bool _listeningForEvents;
+	};
+
+}
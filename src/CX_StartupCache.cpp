@@ -0,0 +1,114 @@
+#include "CX_StartupCache.h"
+
+#include <sstream>
+#include <iomanip>
+#include <cstdint>
+
+#include "ofFileUtils.h"
+
+#include "CX_Utilities.h"
+#include "CX_Logger.h"
+
+namespace CX {
+namespace Private {
+
+CX_StartupCache startupCache;
+
+static const std::string fingerprintKey = "fingerprint";
+
+CX_StartupCache::CX_StartupCache(void) :
+	_enabled(false)
+{}
+
+/*! Turns the cache on and reads the stored values from the given file, if it exists.
+\param filename The name of the key-value file. Relative paths are relative to the data directory.
+\param fingerprint The fingerprint of the current hardware. See hashFingerprint().
+\return `true` if the file existed and was made on the same hardware, so its values can be used. */
+bool CX_StartupCache::load(std::string filename, std::string fingerprint) {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_enabled = true;
+	_filename = filename;
+	_fingerprint = fingerprint;
+	_values.clear();
+
+	if (!ofFile::doesFileExist(filename)) {
+		CX::Instances::Log.notice("CX_StartupCache") << "The startup cache file " << filename << " does not exist yet. It will be created.";
+		return false;
+	}
+
+	std::map<std::string, std::string> kv = Util::readKeyValueFile(filename);
+	if (kv[fingerprintKey] != fingerprint) {
+		CX::Instances::Log.notice("CX_StartupCache") << "The startup cache file " << filename << " was made on different hardware " <<
+			"or with a different window configuration. Calibrations will be run again.";
+		return false;
+	}
+
+	kv.erase(fingerprintKey);
+	_values = kv;
+	return true;
+}
+
+/*! Returns `true` if load() has been called. */
+bool CX_StartupCache::isEnabled(void) const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _enabled;
+}
+
+/*! Gets a stored value.
+\param key The key of the value.
+\param value Set to the value, if it is stored.
+\return `true` if the cache is enabled and the value is stored. */
+bool CX_StartupCache::get(std::string key, std::string& value) const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _values.find(key);
+	if (!_enabled || it == _values.end()) {
+		return false;
+	}
+	value = it->second;
+	return true;
+}
+
+/*! Stores a value and writes the cache file. Does nothing if the cache is not enabled. */
+void CX_StartupCache::set(std::string key, std::string value) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_enabled) {
+		return;
+	}
+	_values[key] = value;
+	_save();
+}
+
+/*! Forgets all of the stored values and rewrites the cache file without them, so that all calibrations are run
+again the next time the experiment starts. */
+void CX_StartupCache::clear(void) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_values.clear();
+	if (_enabled) {
+		_save();
+	}
+}
+
+/*! Turns a description of the hardware and configuration into a short fingerprint (an FNV-1a hash, in hex). */
+std::string CX_StartupCache::hashFingerprint(const std::string& description) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (char c : description) {
+		hash ^= (uint8_t)c;
+		hash *= 1099511628211ULL;
+	}
+
+	std::ostringstream s;
+	s << std::hex << std::setw(16) << std::setfill('0') << hash;
+	return s.str();
+}
+
+void CX_StartupCache::_save(void) {
+	std::map<std::string, std::string> kv = _values;
+	kv[fingerprintKey] = _fingerprint;
+	if (!Util::writeKeyValueFile(kv, _filename)) {
+		CX::Instances::Log.warning("CX_StartupCache") << "The startup cache file " << _filename << " could not be written.";
+	}
+}
+
+} //namespace Private
+} //namespace CX
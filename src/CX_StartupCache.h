@@ -0,0 +1,46 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace CX {
+namespace Private {
+
+	/*! This class stores the results of slow startup calibrations (the clock implementation, the frame period,
+	sound device sample rates) in a key-value file so that they can be reused the next time the experiment
+	is started on the same computer. The file is tied to a hardware fingerprint: if the fingerprint in the
+	file does not match, the stored values are ignored and the file is rewritten as new values are set.
+
+	It is turned on with CX_InitConfiguation::startupCacheFile. The functions of this class may be called from any thread.
+
+	This class is used internally by CX and should not be used directly.
+	*/
+	class CX_StartupCache {
+	public:
+
+		CX_StartupCache(void);
+
+		bool load(std::string filename, std::string fingerprint);
+		bool isEnabled(void) const;
+
+		bool get(std::string key, std::string& value) const;
+		void set(std::string key, std::string value);
+		void clear(void);
+
+		static std::string hashFingerprint(const std::string& description);
+
+	private:
+		mutable std::mutex _mutex;
+		bool _enabled;
+		std::string _filename;
+		std::string _fingerprint;
+		std::map<std::string, std::string> _values;
+
+		void _save(void);
+	};
+
+	extern CX_StartupCache startupCache;
+
+} //namespace Private
+} //namespace CX
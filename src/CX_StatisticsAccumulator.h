@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace CX {
+namespace Private {
+
+	/*! This class calculates summary statistics of a stream of values in a single pass without storing the values.
+	The variance is updated with Welford's algorithm and the sum is accumulated with Neumaier's compensated
+	summation, so that the results stay accurate for long streams of values.
+
+	This class is used internally by CX and should not be used directly.
+	*/
+	class CX_StatisticsAccumulator {
+	public:
+
+		CX_StatisticsAccumulator(void) {
+			reset();
+		}
+
+		/*! Removes all of the values from the accumulator. */
+		void reset(void) {
+			_count = 0;
+			_mean = 0;
+			_m2 = 0;
+			_sum = 0;
+			_compensation = 0;
+			_min = std::numeric_limits<double>::infinity();
+			_max = -std::numeric_limits<double>::infinity();
+		}
+
+		/*! Adds a value to the accumulator. */
+		void add(double x) {
+			_count++;
+			double delta = x - _mean;
+			_mean += delta / _count;
+			_m2 += delta * (x - _mean);
+
+			double t = _sum + x;
+			if (std::abs(_sum) >= std::abs(x)) {
+				_compensation += (_sum - t) + x;
+			} else {
+				_compensation += (x - t) + _sum;
+			}
+			_sum = t;
+
+			_min = std::min(_min, x);
+			_max = std::max(_max, x);
+		}
+
+		/*! Adds all of the values from another accumulator to this one. */
+		void merge(const CX_StatisticsAccumulator& other) {
+			if (other._count == 0) {
+				return;
+			}
+			if (_count == 0) {
+				*this = other;
+				return;
+			}
+
+			uint64_t count = _count + other._count;
+			double delta = other._mean - _mean;
+			_mean += delta * other._count / count;
+			_m2 += other._m2 + delta * delta * ((double)_count * other._count / count);
+			_count = count;
+
+			double otherSum = other.sum();
+			double t = _sum + otherSum;
+			_compensation += (std::abs(_sum) >= std::abs(otherSum)) ? ((_sum - t) + otherSum) : ((otherSum - t) + _sum);
+			_sum = t;
+
+			_min = std::min(_min, other._min);
+			_max = std::max(_max, other._max);
+		}
+
+		uint64_t count(void) const { return _count; }
+		double sum(void) const { return _sum + _compensation; }
+
+		/*! Returns the mean of the values, or NaN if there are none. The mean is taken from the compensated sum,
+		which is more accurate than the running mean that is used for the variance. */
+		double mean(void) const { return (_count > 0) ? sum() / _count : std::numeric_limits<double>::quiet_NaN(); }
+
+		/*! Returns the sample variance (with `n - 1` in the denominator) of the values, or NaN if there are fewer than 2. */
+		double variance(void) const { return (_count > 1) ? _m2 / (_count - 1) : std::numeric_limits<double>::quiet_NaN(); }
+
+		/*! Returns the sample standard deviation of the values, or NaN if there are fewer than 2. */
+		double standardDeviation(void) const { return std::sqrt(variance()); }
+
+		/*! Returns the smallest value, or infinity if there are no values. */
+		double min(void) const { return _min; }
+
+		/*! Returns the largest value, or negative infinity if there are no values. */
+		double max(void) const { return _max; }
+
+	private:
+		uint64_t _count;
+		double _mean;
+		double _m2;
+		double _sum;
+		double _compensation;
+		double _min;
+		double _max;
+	};
+
+} //namespace Private
+} //namespace CX
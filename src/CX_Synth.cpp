@@ -1,5 +1,23 @@
 #include "CX_Synth.h"
 
+#include <exception>
+#include <mutex>
+#include <thread>
+
+//Vector instruction sets used by AdditiveSynth::processBlock() and BiquadCascade::processInterleaved(). Define CX_SYNTH_NO_SIMD to use the scalar path.
+#if !defined(CX_SYNTH_NO_SIMD)
+#	if defined(__AVX__)
+#		define CX_SYNTH_USE_AVX
+#		include <immintrin.h>
+#	elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#		define CX_SYNTH_USE_SSE2
+#		include <emmintrin.h>
+#	elif defined(__aarch64__) || defined(_M_ARM64)
+#		define CX_SYNTH_USE_NEON
+#		include <arm_neon.h>
+#	endif
+#endif
+
 namespace CX {
 namespace Synth {
 
@@ -16,6 +34,38 @@ double relativeFrequency(double f, double semitoneDifference) {
 	return f * pow(2.0, semitoneDifference / 12);
 }
 
+/*! Designs the low-pass filter used by Upsampler and Downsampler to convert between a sample rate and `factor` times that
+rate. It is a linear phase windowed-sinc (Blackman window) filter for use at the higher rate, with unity gain at 0 Hz,
+whose stopband starts at the Nyquist frequency of the lower rate.
+\param factor The ratio of the sample rates.
+\param tapsPerPhase The length of the filter is `factor * tapsPerPhase`.
+\return The coefficients of the filter. If `factor` is less than 2, the filter is a single coefficient of 1. */
+std::vector<double> designResamplingFilter(unsigned int factor, unsigned int tapsPerPhase) {
+	if (factor < 2) {
+		return std::vector<double>(1, 1.0);
+	}
+
+	unsigned int length = factor * std::max(tapsPerPhase, 2u);
+	double transitionWidth = 5.5 / length; //The approximate transition width of a Blackman windowed-sinc filter, in cycles per sample.
+	double cutoff = std::max(0.5 / factor - transitionWidth / 2, 0.25 / factor);
+
+	std::vector<double> h(length);
+	double center = (length - 1) / 2.0;
+	double sum = 0;
+	for (unsigned int n = 0; n < length; n++) {
+		double t = n - center;
+		double ideal = (t == 0) ? 2 * cutoff : sin(2 * PI * cutoff * t) / (PI * t);
+		double window = 0.42 - 0.5 * cos(2 * PI * n / (length - 1)) + 0.08 * cos(4 * PI * n / (length - 1));
+		h[n] = ideal * window;
+		sum += h[n];
+	}
+
+	for (double& c : h) {
+		c /= sum;
+	}
+	return h;
+}
+
 /*! This operator is used to connect modules together. `l` is set as the input for `r`.
 \code{.cpp}
 Oscillator osc;
@@ -44,17 +94,23 @@ fenv >> add >> osc.frequency; //Connect the envelope as the input for the freque
 void operator>>(ModuleBase& l, ModuleParameter& r) {
 	r._input = &l;
 	r._owner->_setDataIfNotSet(&l);
+	r._owner->_connectionsChanged();
 }
 
 ////////////////
 // ModuleBase //
 ////////////////
 
-ModuleBase::ModuleBase(void) {
+ModuleBase::ModuleBase(void) :
+	_scheduledBlock(nullptr),
+	_connectionVersion(std::make_shared<std::atomic<unsigned int>>(0))
+{
 	_data = new ModuleControlData_t;
 }
 
 ModuleBase::~ModuleBase(void) {
+	disconnect(); //The neighbours of this module see the change, so any PatchGraph that contains them recompiles.
+	_connectionsChanged(); //PatchGraphs that watch this module also recompile, even if it had no connections.
 	delete _data;
 }
 
@@ -64,6 +120,26 @@ double ModuleBase::getNextSample(void) {
 	return 0;
 }
 
+/*! This function fills `out` with the next `frames` samples from the module. By default, it calls 
+getNextSample() once for each sample, but derived classes should overload it if they can produce 
+many samples at once more efficiently than they can produce one sample at a time. All of the 
+built-in modules overload this function, so a chain of built-in modules only makes one virtual
+call per module per block of samples, rather than one per module per sample.
+
+If you overload this function, it must produce the same sequence of samples that getNextSample() 
+would have produced if it had been called `frames` times. When getting data from inputs or from 
+ModuleParameters, use their block functions (processBlock() and ModuleParameter::updateBlock()) 
+with the same number of frames.
+
+\param out A pointer to an array of at least `frames` floats that will be filled with samples.
+\param frames The number of samples to produce.
+*/
+void ModuleBase::processBlock(float* out, unsigned int frames) {
+	for (unsigned int i = 0; i < frames; i++) {
+		out[i] = getNextSample();
+	}
+}
+
 /*! This function sets the data needed by this module in order to function properly. Many modules need this data,
 specifically the sample rate that the synth using. If several modules are connected together, you will only need
 to set the data for one module and the change will propagate to the other connected modules automatically.
@@ -93,6 +169,7 @@ void ModuleBase::disconnectInput(ModuleBase* in) {
 	if (input != _inputs.end()) {
 		ModuleBase* inputModule = *input;
 		_inputs.erase(input);
+		_connectionsChanged();
 		inputModule->disconnectOutput(this);
 	}
 }
@@ -104,6 +181,7 @@ void ModuleBase::disconnectOutput(ModuleBase* out) {
 	if (output != _outputs.end()) {
 		ModuleBase* outputModule = *output;
 		_outputs.erase(output);
+		_connectionsChanged();
 		outputModule->disconnectInput(this);
 	}
 }
@@ -133,6 +211,7 @@ void ModuleBase::_assignInput(ModuleBase* in) {
 		}
 
 		_inputs.push_back(in);
+		_connectionsChanged();
 		_setDataIfNotSet(in);
 		_inputAssignedEvent(in);
 	}
@@ -152,11 +231,57 @@ void ModuleBase::_assignOutput(ModuleBase* out) {
 		}
 
 		_outputs.push_back(out);
+		_connectionsChanged();
 		_setDataIfNotSet(out);
 		_outputAssignedEvent(out);
 	}
 }
 
+/*! Gets a pointer to scratch space with room for at least `frames` floats that can be used
+within processBlock(). The scratch space only reallocates if more frames are requested than 
+ever before, so after the first few blocks no allocations happen.
+\param frames The number of floats needed.
+\return A pointer to the scratch space. */
+float* ModuleBase::_getBlockBuffer(unsigned int frames) {
+	if (_blockBuffer.size() < frames) {
+		_blockBuffer.resize(frames);
+	}
+	return _blockBuffer.data();
+}
+
+/*! Gets the next `frames` samples from `in`. Modules should use this instead of calling
+`in->processBlock()` directly, because if `in` is part of a PatchGraph that has already computed
+its output for the current block, that output is copied instead of being computed again.
+\param in The module to get samples from.
+\param out A pointer to an array of at least `frames` floats that will be filled with samples.
+\param frames The number of samples to get. */
+void ModuleBase::_pullBlock(ModuleBase* in, float* out, unsigned int frames) {
+	if (in->_scheduledBlock != nullptr) {
+		if (in->_scheduledBlock != out) {
+			std::copy(in->_scheduledBlock, in->_scheduledBlock + frames, out);
+		}
+	} else {
+		in->processBlock(out, frames);
+	}
+}
+
+/*! This function is called by a PatchGraph to compute the output of this module for the current block.
+By default, it just calls processBlock(). Modules that give the same block to several outputs (e.g. Splitter)
+can overload it so that they know that `scheduledOutputs` of their outputs will be fed by a single call.
+\param out A pointer to an array of at least `frames` floats that will be filled with samples.
+\param frames The number of samples to produce.
+\param scheduledOutputs The number of outputs of this module which are in the PatchGraph. */
+void ModuleBase::_processScheduledBlock(float* out, unsigned int frames, unsigned int scheduledOutputs) {
+	this->processBlock(out, frames);
+}
+
+/*! Marks that a connection of this module has changed, so that any PatchGraph that has this module
+in its schedule will recompile the schedule before processing the next block. PatchGraphs that do not
+contain this module are not affected. */
+void ModuleBase::_connectionsChanged(void) {
+	(*_connectionVersion)++;
+}
+
 /*! This function is called on a module after the data for that module has been set.
 \param caller The module that set the data for this module. */
 void ModuleBase::_dataSet(ModuleBase* caller) {
@@ -198,8 +323,9 @@ void ModuleBase::_setDataIfNotSet(ModuleBase* target) {
 		return;
 	}
 
-	if (*target->_data != *this->_data) {
-		*target->_data = *this->_data;
+	ModuleControlData_t d = target->_getDataFromNeighbour(this, this->_getDataForNeighbour(target));
+	if (*target->_data != d) {
+		*target->_data = d;
 		target->_dataSet(this);
 	}
 
@@ -249,6 +375,18 @@ void ModuleBase::_outputAssignedEvent(ModuleBase* out) {
 	return; 
 }
 
+/*! Gets the data that this module gives to `neighbour`, which is one of its inputs, outputs, or the input of one of its
+parameters. By default, it is the data of this module. Modules that change the sample rate (e.g. Downsampler) overload this. */
+ModuleControlData_t ModuleBase::_getDataForNeighbour(ModuleBase* neighbour) {
+	return *_data;
+}
+
+/*! Converts data `d` that is given to this module by `neighbour` into the data that this module uses. By default, `d` is
+used unchanged. This is the counterpart of _getDataForNeighbour(). */
+ModuleControlData_t ModuleBase::_getDataFromNeighbour(ModuleBase* neighbour, ModuleControlData_t d) {
+	return d;
+}
+
 /////////////////////
 // ModuleParameter //
 /////////////////////
@@ -304,6 +442,36 @@ bool ModuleParameter::valueUpdated(bool checkForUpdates) {
 	return false;
 }
 
+/*! Gets the next `frames` values from the input to the parameter, if any, for use with getBlockValue().
+This is the block equivalent of updateValue() and should be called once at the start of 
+ModuleBase::processBlock() with the same number of frames that the module is producing.
+\param frames The number of values to get. */
+void ModuleParameter::updateBlock(unsigned int frames) {
+	if (_input != nullptr) {
+		if (_block.size() < frames) {
+			_block.resize(frames);
+		}
+		ModuleBase::_pullBlock(_input, _block.data(), frames);
+	}
+}
+
+/*! Gets the value of the parameter at the given frame of the last block obtained with updateBlock().
+If the parameter has no input, this is just the current value. If the value differs from the previous
+value, the parameter is marked as updated, so valueUpdated(false) can be used exactly as it would be 
+following updateValue().
+\param frame The index of the frame within the block.
+\return The value of the parameter at that frame. */
+double ModuleParameter::getBlockValue(unsigned int frame) {
+	if (_input != nullptr) {
+		double temp = _block[frame];
+		if (temp != _value) {
+			_value = temp;
+			_updated = true;
+		}
+	}
+	return _value;
+}
+
 /*! Gets the current value of the parameter. */
 double& ModuleParameter::getValue(void) {
 	return _value;
@@ -318,7 +486,10 @@ ModuleParameter::operator double(void) {
 ModuleParameter& ModuleParameter::operator=(double d) {
 	_value = d;
 	_updated = true;
-	_input = nullptr; //Disconnect the input
+	if (_input != nullptr) {
+		_input = nullptr; //Disconnect the input
+		_owner->_connectionsChanged();
+	}
 	return *this;
 }
 
@@ -340,6 +511,19 @@ double Adder::getNextSample(void) {
 	return amount.getValue();
 }
 
+void Adder::processBlock(float* out, unsigned int frames) {
+	amount.updateBlock(frames);
+	if (_inputs.size() > 0) {
+		_pullBlock(_inputs.front(), out, frames);
+	} else {
+		std::fill(out, out + frames, 0.0f);
+	}
+
+	for (unsigned int i = 0; i < frames; i++) {
+		out[i] += amount.getBlockValue(i);
+	}
+}
+
 
 ///////////////////
 // AdditiveSynth //
@@ -370,6 +554,137 @@ double AdditiveSynth::getNextSample(void) {
 	return rval;
 }
 
+//The block version splits the block into runs of samples over which the fundamental is constant.
+//Long runs are rendered by _renderHarmonics(), which rotates a phasor for each harmonic rather than
+//calling sin() for each harmonic on each sample. Short runs (e.g. when the fundamental is being
+//modulated every sample) use the same per-sample calculation as getNextSample().
+void AdditiveSynth::processBlock(float* out, unsigned int frames) {
+	//Below this many samples, setting up the phasors costs more than it saves.
+	const unsigned int minimumRun = 8;
+
+	fundamental.updateBlock(frames);
+
+	unsigned int i = 0;
+	while (i < frames) {
+		double f = fundamental.getBlockValue(i);
+		if (fundamental.valueUpdated(false)) {
+			_recalculateWaveformPositions();
+		}
+
+		unsigned int end = i + 1;
+		while (end < frames && fundamental.getBlockValue(end) == f) {
+			end++;
+		}
+
+		if (end - i >= minimumRun) {
+			_renderHarmonics(out + i, end - i);
+		} else {
+			for (unsigned int j = i; j < end; j++) {
+				double rval = 0;
+				for (HarmonicInfo& h : _harmonics) {
+					h.waveformPosition = fmod(h.waveformPosition + h.positionChangePerSample, 1);
+					rval += Oscillator::sine(h.waveformPosition) * h.amplitude;
+				}
+				out[j] = rval;
+			}
+		}
+
+		i = end;
+	}
+}
+
+//Renders frames samples with the harmonic phase increments held constant. The phasors are set
+//from the waveform positions at the start and the waveform positions are advanced analytically at
+//the end, so rounding error in the rotation never accumulates beyond a single run.
+void AdditiveSynth::_renderHarmonics(float* out, unsigned int frames) {
+	const unsigned int width = 4; //Enough for the widest vector type used below.
+	unsigned int count = _harmonics.size();
+	unsigned int paddedCount = ((count + width - 1) / width) * width;
+
+	if (_phasorSin.size() != paddedCount) {
+		_phasorSin.assign(paddedCount, 0);
+		_phasorCos.assign(paddedCount, 0);
+		_rotationSin.assign(paddedCount, 0);
+		_rotationCos.assign(paddedCount, 0);
+	}
+
+	for (unsigned int h = 0; h < count; h++) {
+		const HarmonicInfo& hi = _harmonics[h];
+		_phasorSin[h] = hi.amplitude * sin(hi.waveformPosition * 2 * PI);
+		_phasorCos[h] = hi.amplitude * cos(hi.waveformPosition * 2 * PI);
+		_rotationSin[h] = sin(hi.positionChangePerSample * 2 * PI);
+		_rotationCos[h] = cos(hi.positionChangePerSample * 2 * PI);
+	}
+
+	double* ps = _phasorSin.data();
+	double* pc = _phasorCos.data();
+	const double* rs = _rotationSin.data();
+	const double* rc = _rotationCos.data();
+
+	for (unsigned int i = 0; i < frames; i++) {
+		double rval = 0;
+
+#if defined(CX_SYNTH_USE_AVX)
+		__m256d acc = _mm256_setzero_pd();
+		for (unsigned int h = 0; h < paddedCount; h += 4) {
+			__m256d s = _mm256_loadu_pd(ps + h);
+			__m256d c = _mm256_loadu_pd(pc + h);
+			__m256d ds = _mm256_loadu_pd(rs + h);
+			__m256d dc = _mm256_loadu_pd(rc + h);
+			__m256d ns = _mm256_add_pd(_mm256_mul_pd(s, dc), _mm256_mul_pd(c, ds));
+			__m256d nc = _mm256_sub_pd(_mm256_mul_pd(c, dc), _mm256_mul_pd(s, ds));
+			_mm256_storeu_pd(ps + h, ns);
+			_mm256_storeu_pd(pc + h, nc);
+			acc = _mm256_add_pd(acc, ns);
+		}
+		__m128d acc2 = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+		rval = _mm_cvtsd_f64(_mm_add_sd(acc2, _mm_unpackhi_pd(acc2, acc2)));
+#elif defined(CX_SYNTH_USE_SSE2)
+		__m128d acc = _mm_setzero_pd();
+		for (unsigned int h = 0; h < paddedCount; h += 2) {
+			__m128d s = _mm_loadu_pd(ps + h);
+			__m128d c = _mm_loadu_pd(pc + h);
+			__m128d ds = _mm_loadu_pd(rs + h);
+			__m128d dc = _mm_loadu_pd(rc + h);
+			__m128d ns = _mm_add_pd(_mm_mul_pd(s, dc), _mm_mul_pd(c, ds));
+			__m128d nc = _mm_sub_pd(_mm_mul_pd(c, dc), _mm_mul_pd(s, ds));
+			_mm_storeu_pd(ps + h, ns);
+			_mm_storeu_pd(pc + h, nc);
+			acc = _mm_add_pd(acc, ns);
+		}
+		rval = _mm_cvtsd_f64(_mm_add_sd(acc, _mm_unpackhi_pd(acc, acc)));
+#elif defined(CX_SYNTH_USE_NEON)
+		float64x2_t acc = vdupq_n_f64(0);
+		for (unsigned int h = 0; h < paddedCount; h += 2) {
+			float64x2_t s = vld1q_f64(ps + h);
+			float64x2_t c = vld1q_f64(pc + h);
+			float64x2_t ds = vld1q_f64(rs + h);
+			float64x2_t dc = vld1q_f64(rc + h);
+			float64x2_t ns = vfmaq_f64(vmulq_f64(s, dc), c, ds);
+			float64x2_t nc = vfmsq_f64(vmulq_f64(c, dc), s, ds);
+			vst1q_f64(ps + h, ns);
+			vst1q_f64(pc + h, nc);
+			acc = vaddq_f64(acc, ns);
+		}
+		rval = vaddvq_f64(acc);
+#else
+		for (unsigned int h = 0; h < paddedCount; h++) {
+			double ns = ps[h] * rc[h] + pc[h] * rs[h];
+			double nc = pc[h] * rc[h] - ps[h] * rs[h];
+			ps[h] = ns;
+			pc[h] = nc;
+			rval += ns;
+		}
+#endif
+
+		out[i] = rval;
+	}
+
+	for (HarmonicInfo& h : _harmonics) {
+		h.waveformPosition = fmod(h.waveformPosition + frames * h.positionChangePerSample, 1);
+	}
+}
+
 /*! This function sets the amplitudes of the harmonics based on the chosen type. The resulting waveform
 will only be correct if the harmonic series is the standard harmonic series (see setStandardHarmonicSeries()).
 \param a The type of wave calculate amplitudes for.
@@ -571,6 +886,395 @@ void AdditiveSynth::_dataSetEvent(void) {
 }
 
 
+///////////////////
+// BiquadCascade //
+///////////////////
+
+BiquadCascade::BiquadCascade(void) :
+cutoff(1000),
+bandwidth(50),
+_filterType(FilterType::LOW_PASS),
+_order(2),
+_hasFirstOrderSection(false),
+_designedCutoff(-1),
+_designedBandwidth(-1),
+_updateInterval(1),
+_samplesSinceUpdate(1),
+_interleavedChannels(0)
+{
+	this->_registerParameter(&cutoff);
+	this->_registerParameter(&bandwidth);
+	setup(FilterType::LOW_PASS, 2);
+}
+
+/*! Designs the filter. The state of the filter is reset.
+\param type The type of filter. Should not be FilterType::USER_DEFINED: Use setSections() for that.
+\param order For LOW_PASS and HIGH_PASS, the order of the Butterworth filter, which gives a slope of 6 dB per octave per
+order. An order of N uses N/2 sections, plus a first order section if N is odd. For BAND_PASS and NOTCH, order/2
+(at least 1) identical sections are used. */
+void BiquadCascade::setup(FilterType type, unsigned int order) {
+	if (type == FilterType::USER_DEFINED) {
+		CX::Instances::Log.error("BiquadCascade") << "setup(): FilterType::USER_DEFINED cannot be designed. Use setSections() instead.";
+		return;
+	}
+
+	_filterType = type;
+	_order = std::max(order, 1u);
+	_sectionHalfInverseQ.clear();
+	_hasFirstOrderSection = false;
+
+	unsigned int sectionCount;
+	if (_filterType == FilterType::LOW_PASS || _filterType == FilterType::HIGH_PASS) {
+		//The poles of a Butterworth filter are evenly spaced on a semicircle. The angle of each pair of poles from
+		//the negative real axis, psi, gives the Q of its section: 1/(2*Q) = cos(psi).
+		unsigned int biquadCount = _order / 2;
+		for (unsigned int k = 0; k < biquadCount; k++) {
+			double psi;
+			if (_order % 2 == 0) {
+				psi = (2 * k + 1) * PI / (2 * _order);
+			} else {
+				psi = (k + 1) * PI / _order;
+			}
+			_sectionHalfInverseQ.push_back(cos(psi));
+		}
+		_hasFirstOrderSection = (_order % 2 == 1);
+		sectionCount = biquadCount + (_hasFirstOrderSection ? 1 : 0);
+	} else {
+		sectionCount = std::max(_order / 2, 1u);
+	}
+
+	_sections.assign(sectionCount, Section());
+	reset();
+
+	_designedCutoff = -1;
+	_recalculateCoefficients();
+}
+
+/*! Sets the sections of the filter directly, for example with sections designed in another program for the
+sample rate that the synth uses. The filter type becomes FilterType::USER_DEFINED, so `cutoff` and `bandwidth` are
+ignored. The state of the filter is reset.
+\param sections The sections, in the order in which they are applied. */
+void BiquadCascade::setSections(const std::vector<Section>& sections) {
+	_filterType = FilterType::USER_DEFINED;
+	_sectionHalfInverseQ.clear();
+	_hasFirstOrderSection = false;
+	_sections = sections;
+	reset();
+}
+
+/*! Returns the sections of the filter with their current coefficients. */
+std::vector<BiquadCascade::Section> BiquadCascade::getSections(void) const {
+	return _sections;
+}
+
+/*! Returns the number of sections in the filter. */
+unsigned int BiquadCascade::getSectionCount(void) const {
+	return _sections.size();
+}
+
+/*! Sets the number of samples that must pass between updates of the coefficients when `cutoff` or `bandwidth`
+change. The default is 1, which updates the coefficients every sample that the parameters change. Larger values are
+cheaper for fast sweeps with many sections, at the cost of the sweep being done in small steps.
+\param samples The minimum number of samples between updates. At least 1. */
+void BiquadCascade::setCoefficientUpdateInterval(unsigned int samples) {
+	_updateInterval = std::max(samples, 1u);
+	_samplesSinceUpdate = _updateInterval;
+}
+
+/*! Clears the state of the filter, both for single channel use and for processInterleaved(). */
+void BiquadCascade::reset(void) {
+	_z1.assign(_sections.size(), 0);
+	_z2.assign(_sections.size(), 0);
+	_channelZ1.assign(_sections.size() * _interleavedChannels, 0);
+	_channelZ2.assign(_sections.size() * _interleavedChannels, 0);
+}
+
+double BiquadCascade::getNextSample(void) {
+	if (_inputs.size() == 0) {
+		return 0;
+	}
+
+	cutoff.updateValue();
+	bandwidth.updateValue();
+	if (_samplesSinceUpdate >= _updateInterval && _coefficientsOutdated()) {
+		_recalculateCoefficients();
+		_samplesSinceUpdate = 0;
+	}
+	_samplesSinceUpdate = std::min(_samplesSinceUpdate + 1, _updateInterval);
+
+	double x = _inputs.front()->getNextSample();
+	for (unsigned int s = 0; s < _sections.size(); s++) {
+		const Section& c = _sections[s];
+		double y = c.b0 * x + _z1[s];
+		_z1[s] = c.b1 * x - c.a1 * y + _z2[s];
+		_z2[s] = c.b2 * x - c.a2 * y;
+		x = y;
+	}
+	return x;
+}
+
+void BiquadCascade::processBlock(float* out, unsigned int frames) {
+	if (_inputs.size() == 0) {
+		std::fill(out, out + frames, 0.0f);
+		return;
+	}
+
+	_pullBlock(_inputs.front(), out, frames);
+
+	cutoff.updateBlock(frames);
+	bandwidth.updateBlock(frames);
+
+	//The block is split into runs in which the coefficients are constant, which is normally the whole block.
+	unsigned int i = 0;
+	while (i < frames) {
+		double c = cutoff.getBlockValue(i);
+		double bw = bandwidth.getBlockValue(i);
+		if (_samplesSinceUpdate >= _updateInterval && _coefficientsOutdated()) {
+			_recalculateCoefficients();
+			_samplesSinceUpdate = 0;
+		}
+
+		unsigned int end = i + 1;
+		while (end < frames) {
+			bool changed = (cutoff.getBlockValue(end) != c) || (bandwidth.getBlockValue(end) != bw);
+			if (changed && _samplesSinceUpdate + (end - i) >= _updateInterval) {
+				break;
+			}
+			end++;
+		}
+
+		_processRun(out + i, end - i);
+
+		_samplesSinceUpdate = std::min(_samplesSinceUpdate + (end - i), _updateInterval);
+		i = end;
+	}
+}
+
+/*! Filters several channels of interleaved samples in place with the same coefficients, e.g. the channels of a
+CX_SoundBuffer or several voices of a synth. Each channel has its own state, which is kept between calls, so long
+blocks of samples can be filtered a piece at a time. The state is reset if the number of channels changes.
+
+This does not use the input to this module, if any, and uses the current values of `cutoff` and `bandwidth` without
+getting new values from modules connected to them. The sample rate must have been set, e.g. with setData().
+
+\code{.cpp}
+CX_SoundBuffer sb;
+sb.loadFile("sound.wav");
+
+BiquadCascade hp;
+hp.setData(ModuleControlData_t(sb.getSampleRate()));
+hp.setup(BiquadCascade::FilterType::HIGH_PASS, 4);
+hp.cutoff = 100;
+hp.processInterleaved(sb.getRawDataReference().data(), sb.getSampleFrameCount(), sb.getChannelCount());
+\endcode
+
+\param data The samples, with the samples of each sample frame next to one another.
+\param frames The number of sample frames in `data`.
+\param channels The number of channels in `data`.
+*/
+void BiquadCascade::processInterleaved(float* data, unsigned int frames, unsigned int channels) {
+	if (channels == 0) {
+		return;
+	}
+
+	if (_coefficientsOutdated()) {
+		_recalculateCoefficients();
+	}
+
+	const unsigned int sectionCount = _sections.size();
+	if (channels != _interleavedChannels || _channelZ1.size() != sectionCount * channels) {
+		_interleavedChannels = channels;
+		_channelZ1.assign(sectionCount * channels, 0);
+		_channelZ2.assign(sectionCount * channels, 0);
+	}
+
+	const Section* sections = _sections.data();
+	double* z1 = _channelZ1.data();
+	double* z2 = _channelZ2.data();
+
+	for (unsigned int f = 0; f < frames; f++) {
+		float* x = data + (size_t)f * channels;
+		unsigned int ch = 0;
+
+#if defined(CX_SYNTH_USE_AVX)
+		for (; ch + 4 <= channels; ch += 4) {
+			__m256d v = _mm256_cvtps_pd(_mm_loadu_ps(x + ch));
+			for (unsigned int s = 0; s < sectionCount; s++) {
+				const Section& c = sections[s];
+				double* sz1 = z1 + s * channels + ch;
+				double* sz2 = z2 + s * channels + ch;
+				__m256d y = _mm256_add_pd(_mm256_mul_pd(_mm256_broadcast_sd(&c.b0), v), _mm256_loadu_pd(sz1));
+				__m256d n1 = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(_mm256_broadcast_sd(&c.b1), v), _mm256_mul_pd(_mm256_broadcast_sd(&c.a1), y)), _mm256_loadu_pd(sz2));
+				__m256d n2 = _mm256_sub_pd(_mm256_mul_pd(_mm256_broadcast_sd(&c.b2), v), _mm256_mul_pd(_mm256_broadcast_sd(&c.a2), y));
+				_mm256_storeu_pd(sz1, n1);
+				_mm256_storeu_pd(sz2, n2);
+				v = y;
+			}
+			_mm_storeu_ps(x + ch, _mm256_cvtpd_ps(v));
+		}
+#elif defined(CX_SYNTH_USE_SSE2)
+		for (; ch + 2 <= channels; ch += 2) {
+			__m128d v = _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(x + ch))));
+			for (unsigned int s = 0; s < sectionCount; s++) {
+				const Section& c = sections[s];
+				double* sz1 = z1 + s * channels + ch;
+				double* sz2 = z2 + s * channels + ch;
+				__m128d y = _mm_add_pd(_mm_mul_pd(_mm_load1_pd(&c.b0), v), _mm_loadu_pd(sz1));
+				__m128d n1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(_mm_load1_pd(&c.b1), v), _mm_mul_pd(_mm_load1_pd(&c.a1), y)), _mm_loadu_pd(sz2));
+				__m128d n2 = _mm_sub_pd(_mm_mul_pd(_mm_load1_pd(&c.b2), v), _mm_mul_pd(_mm_load1_pd(&c.a2), y));
+				_mm_storeu_pd(sz1, n1);
+				_mm_storeu_pd(sz2, n2);
+				v = y;
+			}
+			_mm_storel_epi64((__m128i*)(x + ch), _mm_castps_si128(_mm_cvtpd_ps(v)));
+		}
+#elif defined(CX_SYNTH_USE_NEON)
+		for (; ch + 2 <= channels; ch += 2) {
+			float64x2_t v = vcvt_f64_f32(vld1_f32(x + ch));
+			for (unsigned int s = 0; s < sectionCount; s++) {
+				const Section& c = sections[s];
+				double* sz1 = z1 + s * channels + ch;
+				double* sz2 = z2 + s * channels + ch;
+				float64x2_t y = vfmaq_f64(vld1q_f64(sz1), vld1q_dup_f64(&c.b0), v);
+				float64x2_t n1 = vaddq_f64(vfmsq_f64(vmulq_f64(vld1q_dup_f64(&c.b1), v), vld1q_dup_f64(&c.a1), y), vld1q_f64(sz2));
+				float64x2_t n2 = vfmsq_f64(vmulq_f64(vld1q_dup_f64(&c.b2), v), vld1q_dup_f64(&c.a2), y);
+				vst1q_f64(sz1, n1);
+				vst1q_f64(sz2, n2);
+				v = y;
+			}
+			vst1_f32(x + ch, vcvt_f32_f64(v));
+		}
+#endif
+
+		//Channels that don't fill a vector register.
+		for (; ch < channels; ch++) {
+			double v = x[ch];
+			for (unsigned int s = 0; s < sectionCount; s++) {
+				const Section& c = sections[s];
+				unsigned int k = s * channels + ch;
+				double y = c.b0 * v + z1[k];
+				z1[k] = c.b1 * v - c.a1 * y + z2[k];
+				z2[k] = c.b2 * v - c.a2 * y;
+				v = y;
+			}
+			x[ch] = v;
+		}
+	}
+}
+
+void BiquadCascade::_dataSetEvent(void) {
+	_designedCutoff = -1;
+	_recalculateCoefficients();
+}
+
+bool BiquadCascade::_coefficientsOutdated(void) {
+	switch (_filterType) {
+	case FilterType::LOW_PASS:
+	case FilterType::HIGH_PASS:
+		return cutoff.getValue() != _designedCutoff;
+	case FilterType::BAND_PASS:
+	case FilterType::NOTCH:
+		return cutoff.getValue() != _designedCutoff || bandwidth.getValue() != _designedBandwidth;
+	default:
+		return false;
+	}
+}
+
+//The sections are the bilinear transforms of analog sections (http://www.musicdsp.org/files/Audio-EQ-Cookbook.txt).
+//Only one sin() and cos() are needed for all of the sections, because they share a cutoff frequency.
+void BiquadCascade::_recalculateCoefficients(void) {
+	if (!_data->initialized || _filterType == FilterType::USER_DEFINED) {
+		return;
+	}
+
+	_designedCutoff = cutoff.getValue();
+	_designedBandwidth = bandwidth.getValue();
+
+	double frequencyDivisor = _data->sampleRate * _data->oversampling;
+
+	double f = std::min(std::max(_designedCutoff, frequencyDivisor * 1e-6), frequencyDivisor * 0.4999);
+	double w0 = 2 * PI * f / frequencyDivisor;
+	double cw = cos(w0);
+	double sw = sin(w0);
+
+	if (_filterType == FilterType::LOW_PASS || _filterType == FilterType::HIGH_PASS) {
+		bool lowPass = (_filterType == FilterType::LOW_PASS);
+
+		for (unsigned int s = 0; s < _sectionHalfInverseQ.size(); s++) {
+			double alpha = sw * _sectionHalfInverseQ[s];
+			double a0inv = 1 / (1 + alpha);
+			Section& c = _sections[s];
+			if (lowPass) {
+				c.b0 = (1 - cw) / 2 * a0inv;
+				c.b1 = (1 - cw) * a0inv;
+			} else {
+				c.b0 = (1 + cw) / 2 * a0inv;
+				c.b1 = -(1 + cw) * a0inv;
+			}
+			c.b2 = c.b0;
+			c.a1 = -2 * cw * a0inv;
+			c.a2 = (1 - alpha) * a0inv;
+		}
+
+		if (_hasFirstOrderSection) {
+			double K = sw / (1 + cw); //tan(w0/2)
+			Section& c = _sections.back();
+			if (lowPass) {
+				c.b0 = K / (1 + K);
+				c.b1 = c.b0;
+			} else {
+				c.b0 = 1 / (1 + K);
+				c.b1 = -c.b0;
+			}
+			c.b2 = 0;
+			c.a1 = (K - 1) / (K + 1);
+			c.a2 = 0;
+		}
+
+	} else {
+		//Q = f / bandwidth, so alpha = sin(w0) / (2 * Q)
+		double bw = std::max(_designedBandwidth, 1e-6);
+		double alpha = sw * bw / (2 * f);
+		double a0inv = 1 / (1 + alpha);
+
+		Section c;
+		if (_filterType == FilterType::BAND_PASS) {
+			c.b0 = alpha * a0inv;
+			c.b1 = 0;
+			c.b2 = -c.b0;
+		} else {
+			c.b0 = a0inv;
+			c.b1 = -2 * cw * a0inv;
+			c.b2 = c.b0;
+		}
+		c.a1 = -2 * cw * a0inv;
+		c.a2 = (1 - alpha) * a0inv;
+
+		std::fill(_sections.begin(), _sections.end(), c);
+	}
+}
+
+void BiquadCascade::_processRun(float* data, unsigned int frames) {
+	const unsigned int sectionCount = _sections.size();
+	const Section* sections = _sections.data();
+	double* z1 = _z1.data();
+	double* z2 = _z2.data();
+
+	for (unsigned int i = 0; i < frames; i++) {
+		double x = data[i];
+		for (unsigned int s = 0; s < sectionCount; s++) {
+			const Section& c = sections[s];
+			double y = c.b0 * x + z1[s];
+			z1[s] = c.b1 * x - c.a1 * y + z2[s];
+			z2[s] = c.b2 * x - c.a2 * y;
+			x = y;
+		}
+		data[i] = x;
+	}
+}
+
+
+
 /////////////
 // Clamper //
 /////////////
@@ -598,6 +1302,126 @@ double Clamper::getNextSample(void) {
 	return temp;
 }
 
+void Clamper::processBlock(float* out, unsigned int frames) {
+	if (_inputs.size() == 0) {
+		std::fill(out, out + frames, 0.0f);
+		return;
+	}
+
+	_pullBlock(_inputs.front(), out, frames);
+
+	high.updateBlock(frames);
+	low.updateBlock(frames);
+
+	for (unsigned int i = 0; i < frames; i++) {
+		double temp = out[i];
+		temp = std::min(temp, high.getBlockValue(i));
+		temp = std::max(temp, low.getBlockValue(i));
+		out[i] = temp;
+	}
+}
+
+
+/////////////////
+// Downsampler //
+/////////////////
+
+Downsampler::Downsampler(void) :
+	_factor(1)
+{
+	setup(2);
+}
+
+/*! Sets the oversampling factor and the length of the anti-aliasing filter. The state of the filter is reset.
+\param factor The number of times higher the sample rate of the modules that feed into this module is than the rate of
+the modules after it. 1 turns oversampling off.
+\param tapsPerPhase The length of the filter is `factor * tapsPerPhase`. More taps give a sharper cutoff at the cost
+of more computation and more latency. */
+void Downsampler::setup(unsigned int factor, unsigned int tapsPerPhase) {
+	_factor = std::max(factor, 1u);
+	_coefficients = designResamplingFilter(_factor, tapsPerPhase);
+	_history.assign(_coefficients.size() - 1 + _factor, 0);
+
+	if (_data->initialized) {
+		this->_dataSet(nullptr); //Give the new factor to the neighbours.
+	}
+}
+
+/*! Returns the oversampling factor. */
+unsigned int Downsampler::getFactor(void) const {
+	return _factor;
+}
+
+/*! Returns the delay of the anti-aliasing filter, in samples at the lower sample rate. */
+double Downsampler::getLatency(void) const {
+	//Each output is computed when the last of its _factor input samples arrives, which makes up for some of the delay.
+	return ((_coefficients.size() - 1) / 2.0 - (_factor - 1)) / _factor;
+}
+
+double Downsampler::getNextSample(void) {
+	if (_inputs.size() == 0) {
+		return 0;
+	}
+
+	float* in = _history.data() + _coefficients.size() - 1;
+	for (unsigned int i = 0; i < _factor; i++) {
+		in[i] = _inputs.front()->getNextSample();
+	}
+
+	float out;
+	_decimate(&out, 1);
+	return out;
+}
+
+void Downsampler::processBlock(float* out, unsigned int frames) {
+	if (_inputs.size() == 0) {
+		std::fill(out, out + frames, 0.0f);
+		return;
+	}
+
+	size_t historyLength = _coefficients.size() - 1;
+	if (_history.size() < historyLength + (size_t)frames * _factor) {
+		_history.resize(historyLength + (size_t)frames * _factor);
+	}
+
+	_pullBlock(_inputs.front(), _history.data() + historyLength, frames * _factor);
+	_decimate(out, frames);
+}
+
+//Filters the new input samples in _history and keeps every _factor-th output, then moves the last input
+//samples to the start of _history. Only the kept outputs are computed.
+void Downsampler::_decimate(float* out, unsigned int frames) {
+	const size_t taps = _coefficients.size();
+	const double* h = _coefficients.data(); //Symmetric, so it doesn't need to be reversed.
+	const float* x = _history.data();
+
+	for (unsigned int m = 0; m < frames; m++) {
+		const float* window = x + (size_t)m * _factor + _factor - 1; //Ends at the newest input for this output.
+		double sum = 0;
+		for (size_t k = 0; k < taps; k++) {
+			sum += h[k] * window[k];
+		}
+		out[m] = sum;
+	}
+
+	size_t used = (size_t)frames * _factor;
+	std::copy(_history.begin() + used, _history.begin() + used + taps - 1, _history.begin());
+}
+
+ModuleControlData_t Downsampler::_getDataForNeighbour(ModuleBase* neighbour) {
+	ModuleControlData_t d = *_data;
+	if (std::find(_inputs.begin(), _inputs.end(), neighbour) != _inputs.end()) {
+		d.oversampling *= _factor;
+	}
+	return d;
+}
+
+ModuleControlData_t Downsampler::_getDataFromNeighbour(ModuleBase* neighbour, ModuleControlData_t d) {
+	if (std::find(_inputs.begin(), _inputs.end(), neighbour) != _inputs.end()) {
+		d.oversampling = std::max(d.oversampling / _factor, 1u);
+	}
+	return d;
+}
 
 //////////////
 // Envelope //
@@ -642,14 +1466,85 @@ double Envelope::getNextSample(void) {
 		_r = r.getValue();
 	}
 
-	//p is the proportion of the envelope, that controls e.g. how loud the output is.
-	double p = _lastP; //In case somehow none of the cases is hit, the level is just the last level
+	double p = _calculateLevel();
 
-	switch (_stage) {
-	//Attack:
-	case 0:
-		//If within the attack time
-		if ((_timeSinceLastStage < _a) && (_a != 0)) {
+	double val;
+	if (_inputs.size() > 0) {
+		val = _inputs.front()->getNextSample();
+	} else {
+		val = 1;
+	}
+
+	return val * p;
+}
+
+//The input is only pulled once the envelope is running during the block, so a finished envelope outputs silence
+//without making its input do any work, as in getNextSample().
+void Envelope::processBlock(float* out, unsigned int frames) {
+	bool inputPulled = false;
+
+	gateInput.updateBlock(frames);
+	a.updateBlock(frames);
+	d.updateBlock(frames);
+	s.updateBlock(frames);
+	r.updateBlock(frames);
+
+	for (unsigned int i = 0; i < frames; i++) {
+		gateInput.getBlockValue(i);
+		if (gateInput.valueUpdated(false)) {
+			if (gateInput.getValue() == 1.0) {
+				this->attack();
+			} else if (gateInput.getValue() == 0.0) {
+				this->release();
+			}
+		}
+
+		if (_stage > 3) {
+			out[i] = 0;
+			continue;
+		}
+
+		if (!inputPulled) {
+			if (_inputs.size() > 0) {
+				_pullBlock(_inputs.front(), out, frames);
+			} else {
+				std::fill(out, out + frames, 1.0f);
+			}
+			std::fill(out, out + i, 0.0f); //The envelope was finished before frame i.
+			inputPulled = true;
+		}
+
+		a.getBlockValue(i);
+		if (a.valueUpdated(false)) {
+			_a = a.getValue();
+		}
+		d.getBlockValue(i);
+		if (d.valueUpdated(false)) {
+			_d = d.getValue();
+		}
+		s.getBlockValue(i);
+		if (s.valueUpdated(false)) {
+			_s = s.getValue();
+		}
+		r.getBlockValue(i);
+		if (r.valueUpdated(false)) {
+			_r = r.getValue();
+		}
+
+		out[i] *= _calculateLevel();
+	}
+}
+
+//Calculates the level of the envelope for the current sample and advances the envelope by one sample.
+double Envelope::_calculateLevel(void) {
+	//p is the proportion of the envelope, that controls e.g. how loud the output is.
+	double p = _lastP; //In case somehow none of the cases is hit, the level is just the last level
+
+	switch (_stage) {
+	//Attack:
+	case 0:
+		//If within the attack time
+		if ((_timeSinceLastStage < _a) && (_a != 0)) {
 			//The proportion is the amount of time spent in attack so far divided by the length of the attack
 			p = _timeSinceLastStage / _a;
 			break;
@@ -694,14 +1589,7 @@ double Envelope::getNextSample(void) {
 
 	_timeSinceLastStage += _timePerSample;
 
-	double val;
-	if (_inputs.size() > 0) {
-		val = _inputs.front()->getNextSample();
-	} else {
-		val = 1;
-	}
-
-	return val * p;
+	return p;
 }
 
 /*! \brief Trigger the attack of the Envelope. */
@@ -774,6 +1662,47 @@ double Filter::getNextSample(void) {
 	return y0;
 }
 
+void Filter::processBlock(float* out, unsigned int frames) {
+	if (_inputs.size() == 0) {
+		std::fill(out, out + frames, 0.0f);
+		return;
+	}
+
+	_pullBlock(_inputs.front(), out, frames);
+
+	cutoff.updateBlock(frames);
+	bandwidth.updateBlock(frames);
+
+	bool firstOrder = (_filterType == FilterType::LOW_PASS || _filterType == FilterType::HIGH_PASS);
+
+	for (unsigned int i = 0; i < frames; i++) {
+		cutoff.getBlockValue(i);
+		bandwidth.getBlockValue(i);
+		bool cutoffUpdated = cutoff.valueUpdated(false);
+		bool bandwidthUpdated = bandwidth.valueUpdated(false);
+		if (cutoffUpdated || bandwidthUpdated) {
+			_recalculateCoefficients();
+		}
+
+		double x0 = out[i];
+		double y0;
+
+		if (firstOrder) {
+			y0 = a0*x0 + a1*x1 + b1*y1;
+			y1 = y0;
+			x1 = x0;
+		} else {
+			y0 = a0*x0 + a1*x1 + a2*x2 + b1*y1 + b2*y2;
+			y2 = y1;
+			y1 = y0;
+			x2 = x1;
+			x1 = x0;
+		}
+
+		out[i] = y0;
+	}
+}
+
 void Filter::_recalculateCoefficients(void) {
 	if (!_data->initialized) {
 		return;
@@ -830,6 +1759,23 @@ double Mixer::getNextSample(void) {
 	return d;
 }
 
+void Mixer::processBlock(float* out, unsigned int frames) {
+	std::fill(out, out + frames, 0.0f);
+	if (_inputs.size() == 0) {
+		return;
+	}
+
+	_pullBlock(_inputs[0], out, frames);
+
+	float* temp = _getBlockBuffer(frames);
+	for (unsigned int in = 1; in < _inputs.size(); in++) {
+		_pullBlock(_inputs[in], temp, frames);
+		for (unsigned int i = 0; i < frames; i++) {
+			out[i] += temp[i];
+		}
+	}
+}
+
 unsigned int Mixer::_maxInputs(void) {
 	return 32;
 }
@@ -861,6 +1807,18 @@ double Multiplier::getNextSample(void) {
 	return _inputs.front()->getNextSample() * amount.getValue();
 }
 
+void Multiplier::processBlock(float* out, unsigned int frames) {
+	if (_inputs.size() == 0) {
+		std::fill(out, out + frames, 0.0f);
+		return;
+	}
+	amount.updateBlock(frames);
+	_pullBlock(_inputs.front(), out, frames);
+	for (unsigned int i = 0; i < frames; i++) {
+		out[i] *= amount.getBlockValue(i);
+	}
+}
+
 /*! Sets the `amount` of the multiplier based on gain in decibels.
 \param decibels The gain to apply. If greater than 0, `amount` will be greater than 1. If less than 0, `amount` will be less than 1.
 After calling this function, `amount` will never be negative.
@@ -869,13 +1827,179 @@ void Multiplier::setGain(double decibels) {
 	amount = sqrt(pow(10.0, decibels / 10.0));
 }
 
+////////////////////
+// NoiseGenerator //
+////////////////////
+
+/*! Constructs a NoiseGenerator that produces white noise. Its random number generator uses the
+xoshiro256++ engine and is seeded with a value from CX::Instances::RNG. */
+NoiseGenerator::NoiseGenerator(void) :
+	amplitude(1),
+	_color(Color::WHITE)
+{
+	this->_registerParameter(&amplitude);
+	_rng.setEngine(CX_RandomEngine::Type::XOSHIRO256PP);
+	setSeed((unsigned long)CX::Instances::RNG.randomInt());
+}
+
+double NoiseGenerator::getNextSample(void) {
+	amplitude.updateValue();
+	float sample;
+	_rng.fillUniform(&sample, 1, -1, 1);
+	if (_color == Color::PINK) {
+		sample = _pinkFilter(sample);
+	}
+	return sample * amplitude.getValue();
+}
+
+void NoiseGenerator::processBlock(float* out, unsigned int frames) {
+	amplitude.updateBlock(frames);
+	_rng.fillUniform(out, frames, -1, 1);
+
+	if (_color == Color::PINK) {
+		for (unsigned int i = 0; i < frames; i++) {
+			out[i] = _pinkFilter(out[i]);
+		}
+	}
+
+	for (unsigned int i = 0; i < frames; i++) {
+		out[i] *= amplitude.getBlockValue(i);
+	}
+}
+
+/*! Sets the color of the noise. The pink noise filter is reset. */
+void NoiseGenerator::setColor(Color color) {
+	_color = color;
+	std::fill(_pinkState, _pinkState + 7, 0.0f);
+}
+
+/*! Returns the color of the noise. */
+NoiseGenerator::Color NoiseGenerator::getColor(void) const {
+	return _color;
+}
+
+/*! Seeds the random number generator of the NoiseGenerator, so that the same noise is produced every time.
+The pink noise filter is reset. */
+void NoiseGenerator::setSeed(unsigned long seed) {
+	_rng.setSeed(seed);
+	std::fill(_pinkState, _pinkState + 7, 0.0f);
+}
+
+/*! Returns the random number generator of the NoiseGenerator, which can be used to get its seed or change its engine. */
+CX_RandomNumberGenerator& NoiseGenerator::getRNG(void) {
+	return _rng;
+}
+
+//Paul Kellet's refined pink noise filter (http://www.firstpr.com.au/dsp/pink-noise/). It is accurate to within
+//0.05 dB above 9.2 Hz at a 44.1 kHz sample rate. The output is scaled so that it is mostly within [-1, 1].
+float NoiseGenerator::_pinkFilter(float white) {
+	float* b = _pinkState;
+	b[0] = 0.99886f * b[0] + white * 0.0555179f;
+	b[1] = 0.99332f * b[1] + white * 0.0750759f;
+	b[2] = 0.96900f * b[2] + white * 0.1538520f;
+	b[3] = 0.86650f * b[3] + white * 0.3104856f;
+	b[4] = 0.55000f * b[4] + white * 0.5329522f;
+	b[5] = -0.7616f * b[5] - white * 0.0168980f;
+	float pink = b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6] + white * 0.5362f;
+	b[6] = white * 0.115926f;
+	return pink * 0.125f;
+}
+
 ////////////////
 // Oscillator //
 ////////////////
 
+//A band-limited wavetable for one of the built-in waveforms. Level L contains the harmonics up to 2^L (or as many as
+//fit in the table), so it can be played without aliasing at fundamental frequencies up to 1/2^(L+1) cycles per sample.
+struct Oscillator::Wavetable {
+
+	static const unsigned int tableSize = 4096; //Must be a power of 2.
+
+	//amplitude(h) is the amplitude of harmonic h in the Fourier series of the waveform, which uses sines, or cosines
+	//if cosine is true.
+	Wavetable(double (*amplitude)(unsigned int), bool cosine, unsigned int levelCount) {
+		std::vector<double> sineTable(tableSize);
+		for (unsigned int n = 0; n < tableSize; n++) {
+			sineTable[n] = sin(2 * PI * n / tableSize);
+		}
+
+		unsigned int phaseOffset = cosine ? tableSize / 4 : 0;
+		std::vector<double> sum(tableSize, 0);
+		unsigned int h = 1;
+
+		levels.resize(levelCount);
+		for (unsigned int level = 0; level < levelCount; level++) {
+			//Each level adds the harmonics of one more octave to the level before it.
+			unsigned int topHarmonic = std::min(1u << level, tableSize / 2 - 1);
+			for (; h <= topHarmonic; h++) {
+				double a = amplitude(h);
+				if (a == 0) {
+					continue;
+				}
+				for (unsigned int n = 0; n < tableSize; n++) {
+					sum[n] += a * sineTable[(h * n + phaseOffset) & (tableSize - 1)];
+				}
+			}
+
+			levels[level].assign(sum.begin(), sum.end());
+			levels[level].push_back(levels[level].front()); //For interpolation past the last sample.
+		}
+	}
+
+	unsigned int levelFor(double normalizedFrequency) const {
+		double harmonicsBelowNyquist = 0.5 / std::abs(normalizedFrequency);
+		if (!(harmonicsBelowNyquist < (1u << (levels.size() - 1)))) { //Also catches a frequency of 0.
+			return levels.size() - 1;
+		}
+		if (harmonicsBelowNyquist < 2) {
+			return 0;
+		}
+		return (unsigned int)std::log2(harmonicsBelowNyquist);
+	}
+
+	float lookup(unsigned int level, double waveformPosition) const {
+		if (waveformPosition < 0) {
+			waveformPosition += 1; //Negative frequencies give negative positions.
+		}
+		double index = waveformPosition * tableSize;
+		unsigned int i = (unsigned int)index;
+		float fraction = index - i;
+		i &= (tableSize - 1);
+
+		const float* t = levels[level].data();
+		return t[i] + fraction * (t[i + 1] - t[i]);
+	}
+
+	//Returns the wavetable of a built-in waveform, building it the first time, or nullptr for other functions.
+	static const Wavetable* forFunction(double (*f)(double)) {
+		if (f == &Oscillator::sine) {
+			static const Wavetable table([](unsigned int h) { return (h == 1) ? 1.0 : 0.0; }, false, 1);
+			return &table;
+		} else if (f == &Oscillator::saw) {
+			static const Wavetable table([](unsigned int h) { return -2 / (PI * h); }, false, 12);
+			return &table;
+		} else if (f == &Oscillator::square) {
+			static const Wavetable table([](unsigned int h) { return (h % 2 == 1) ? 4 / (PI * h) : 0.0; }, false, 12);
+			return &table;
+		} else if (f == &Oscillator::triangle) {
+			static const Wavetable table([](unsigned int h) { return (h % 2 == 1) ? -8 / (PI * PI * h * h) : 0.0; }, true, 12);
+			return &table;
+		}
+		return nullptr;
+	}
+
+	std::vector<std::vector<float>> levels; //Each level has tableSize + 1 samples.
+};
+
 Oscillator::Oscillator(void) :
 	frequency(0),
-	_waveformPos(0)
+	_frequencyDivisor(1),
+	_waveformPos(0),
+	_bandLimited(true),
+	_builtInWavetable(nullptr),
+	_wavetable(nullptr),
+	_wavetableFrequency(0),
+	_wavetableLevel(0)
 {
 	this->_registerParameter(&frequency);
 	setGeneratorFunction(Oscillator::sine);
@@ -883,13 +2007,43 @@ Oscillator::Oscillator(void) :
 
 double Oscillator::getNextSample(void) {
 	frequency.updateValue();
-	double addAmount = frequency.getValue() / _frequencyDivisor;
+	double f = frequency.getValue();
+	double addAmount = f / _frequencyDivisor;
 
 	_waveformPos = fmod(_waveformPos + addAmount, 1);
 
+	if (_wavetable) {
+		if (f != _wavetableFrequency) {
+			_updateWavetableLevel(f);
+		}
+		return _wavetable->lookup(_wavetableLevel, _waveformPos);
+	}
+
 	return _generatorFunction(_waveformPos);
 }
 
+void Oscillator::processBlock(float* out, unsigned int frames) {
+	frequency.updateBlock(frames);
+
+	if (_wavetable) {
+		for (unsigned int i = 0; i < frames; i++) {
+			double f = frequency.getBlockValue(i);
+			if (f != _wavetableFrequency) {
+				_updateWavetableLevel(f);
+			}
+			_waveformPos = fmod(_waveformPos + f / _frequencyDivisor, 1);
+			out[i] = _wavetable->lookup(_wavetableLevel, _waveformPos);
+		}
+		return;
+	}
+
+	for (unsigned int i = 0; i < frames; i++) {
+		double addAmount = frequency.getBlockValue(i) / _frequencyDivisor;
+		_waveformPos = fmod(_waveformPos + addAmount, 1);
+		out[i] = _generatorFunction(_waveformPos);
+	}
+}
+
 /*! It is very easy to make your own waveform generating functions to be used with an Oscillator.
 A waveform generating function takes a value that represents the location in the waveform at
 the current point in time. These values are in the interval [0,1).
@@ -906,10 +2060,43 @@ double sineWaveGeneratorFunction(double waveformPosition) {
 */
 void Oscillator::setGeneratorFunction(std::function<double(double)> f) {
 	_generatorFunction = f;
+
+	double (* const* functionPointer)(double) = _generatorFunction.target<double(*)(double)>();
+	_builtInWavetable = functionPointer ? Wavetable::forFunction(*functionPointer) : nullptr;
+	_selectWavetable();
+}
+
+/*! Sets whether the built-in waveforms are produced from band-limited wavetables, which is the default. If `false`,
+the generator function is called for every sample, which gives the exact waveform, but aliases. Generator functions
+other than the built-in ones are always called for every sample.
+\param bandLimited `true` to use band-limited wavetables for the built-in waveforms. */
+void Oscillator::setBandLimited(bool bandLimited) {
+	_bandLimited = bandLimited;
+	_selectWavetable();
+}
+
+/*! Returns `true` if the built-in waveforms are produced from band-limited wavetables. See setBandLimited(). */
+bool Oscillator::isBandLimited(void) const {
+	return _bandLimited;
+}
+
+void Oscillator::_selectWavetable(void) {
+	_wavetable = _bandLimited ? _builtInWavetable : nullptr;
+	if (_wavetable) {
+		_updateWavetableLevel(frequency.getValue());
+	}
+}
+
+void Oscillator::_updateWavetableLevel(double frequency) {
+	_wavetableFrequency = frequency;
+	_wavetableLevel = _wavetable->levelFor(frequency / _frequencyDivisor);
 }
 
 void Oscillator::_dataSetEvent(void) {
 	_frequencyDivisor = _data->sampleRate * _data->oversampling;
+	if (_wavetable) {
+		_updateWavetableLevel(frequency.getValue()); //The band limit depends on the sample rate.
+	}
 }
 
 /*! Produces a sawtooth wave.
@@ -960,7 +2147,8 @@ double Oscillator::triangle(double wp) {
 	}
 }
 
-/*! Produces white noise.
+/*! Produces white noise. This takes one value from CX::Instances::RNG per sample. NoiseGenerator is much faster
+and can also produce pink noise.
 \param wp This argument is ignored. 
 \return A random value in the interval [-1, 1].
 */
@@ -968,6 +2156,171 @@ double Oscillator::whiteNoise(double wp) {
 	return CX::Instances::RNG.randomDouble(-1, 1);
 }
 
+////////////////
+// PatchGraph //
+////////////////
+
+PatchGraph::PatchGraph(void) :
+	_compiled(false),
+	_valid(false),
+	_compiledVersion(0)
+{}
+
+/*! The PatchGraph has no effect on the per-sample interface: it just passes through the next sample from its input. */
+double PatchGraph::getNextSample(void) {
+	if (_inputs.size() == 0) {
+		return 0;
+	}
+	return _inputs.front()->getNextSample();
+}
+
+/*! Produces a block of samples from the root of the graph by running each module in the
+compiled schedule once. The schedule is compiled first if needsCompile() is `true`.
+\param out A pointer to an array of at least `frames` floats that will be filled with samples.
+\param frames The number of samples to produce. */
+void PatchGraph::processBlock(float* out, unsigned int frames) {
+	if (needsCompile()) {
+		compile();
+	}
+
+	if (!_valid || _schedule.empty()) {
+		std::fill(out, out + frames, 0.0f);
+		return;
+	}
+
+	for (ScheduledModule& sm : _schedule) {
+		if (sm.block.size() < frames) {
+			sm.block.resize(frames);
+		}
+		sm.module->_processScheduledBlock(sm.block.data(), frames, sm.scheduledOutputs);
+		sm.module->_scheduledBlock = sm.block.data();
+	}
+
+	_pullBlock(_inputs.front(), out, frames);
+
+	for (ScheduledModule& sm : _schedule) {
+		sm.module->_scheduledBlock = nullptr;
+	}
+}
+
+/*! Builds the execution schedule for the modules that feed into the input of this PatchGraph.
+Other PatchGraphs that are found in the patch are scheduled as single modules, but the modules
+that feed into them are not added to this graph. If there is a cycle in the patch, an error is
+logged and the graph outputs silence until the cycle is removed.
+\return `true` if the schedule was compiled successfully, `false` otherwise. */
+bool PatchGraph::compile(void) {
+	_schedule.clear();
+	_compiled = true;
+	_valid = true;
+
+	if (_inputs.size() == 0) {
+		_watched.clear();
+		_compiledVersion = _connectionVersion->load();
+		return true;
+	}
+
+	//0 = not visited, 1 = being visited, 2 = scheduled
+	std::map<ModuleBase*, int> states;
+	states[this] = 1;
+
+	if (!_visit(_inputs.front(), states)) {
+		CX::Instances::Log.error("PatchGraph") << "compile(): The patch contains a cycle. The graph will output silence.";
+		_schedule.clear();
+		_valid = false;
+		_watchVisited(states);
+		return false;
+	}
+
+	std::map<ModuleBase*, unsigned int> consumerCounts;
+	for (const ScheduledModule& sm : _schedule) {
+		for (ModuleBase* in : sm.module->_inputs) {
+			consumerCounts[in]++;
+		}
+	}
+	consumerCounts[_inputs.front()]++; //This graph consumes the root.
+
+	for (ScheduledModule& sm : _schedule) {
+		sm.scheduledOutputs = consumerCounts[sm.module];
+	}
+
+	_watchVisited(states);
+	return true;
+}
+
+bool PatchGraph::_visit(ModuleBase* m, std::map<ModuleBase*, int>& states) {
+	int& state = states[m];
+	if (state == 2) {
+		return true;
+	} else if (state == 1) {
+		return false;
+	}
+	state = 1;
+
+	//Nested graphs run their own schedules and resamplers pull their inputs at a different rate.
+	bool pullsOwnInputs = (dynamic_cast<PatchGraph*>(m) != nullptr) || (dynamic_cast<Downsampler*>(m) != nullptr) ||
+		(dynamic_cast<Upsampler*>(m) != nullptr);
+
+	if (!pullsOwnInputs) {
+		for (ModuleBase* in : m->_inputs) {
+			if (!_visit(in, states)) {
+				return false;
+			}
+		}
+
+		for (ModuleParameter* p : m->_parameters) {
+			if (p->_input != nullptr && !_visit(p->_input, states)) {
+				return false;
+			}
+		}
+	}
+
+	states[m] = 2;
+	ScheduledModule sm;
+	sm.module = m;
+	_schedule.push_back(std::move(sm));
+	return true;
+}
+
+/*! Returns `true` if modules in this graph have been connected or disconnected since the last time the schedule
+was compiled, or if the schedule has never been compiled. Connection changes in other patches, including the
+patches of other PatchGraphs, do not cause this graph to recompile. */
+bool PatchGraph::needsCompile(void) {
+	return !_compiled || _compiledVersion != _watchedConnectionVersion();
+}
+
+//Remembers the modules that were visited while compiling, which are the scheduled modules or, if there was a cycle,
+//the modules that were reached before the cycle was found, so that needsCompile() only watches this patch.
+void PatchGraph::_watchVisited(const std::map<ModuleBase*, int>& states) {
+	_watched.clear();
+	for (const auto& s : states) {
+		if (s.first != this) {
+			_watched.push_back(s.first->_connectionVersion);
+		}
+	}
+	_compiledVersion = _watchedConnectionVersion();
+}
+
+//The connection versions of the modules only ever increase, so the sum changes whenever any of them change. Every
+//connection change that can affect the schedule changes the version of this graph or of a watched module,
+//because both ends of a connection (or the owner of a parameter) are marked as changed.
+unsigned int PatchGraph::_watchedConnectionVersion(void) {
+	unsigned int sum = _connectionVersion->load();
+	for (const std::shared_ptr<std::atomic<unsigned int>>& version : _watched) {
+		sum += version->load();
+	}
+	return sum;
+}
+
+/*! Gets the modules in the compiled schedule in the order in which they are processed. The
+last module is the root of the graph. */
+std::vector<ModuleBase*> PatchGraph::getSchedule(void) {
+	std::vector<ModuleBase*> rval;
+	for (const ScheduledModule& sm : _schedule) {
+		rval.push_back(sm.module);
+	}
+	return rval;
+}
+
 ///////////////////
 // RingModulator //
 ///////////////////
@@ -983,6 +2336,21 @@ double RingModulator::getNextSample(void) {
 	return 0;
 }
 
+void RingModulator::processBlock(float* out, unsigned int frames) {
+	if (_inputs.size() == 2) {
+		_pullBlock(_inputs[0], out, frames);
+		float* temp = _getBlockBuffer(frames);
+		_pullBlock(_inputs[1], temp, frames);
+		for (unsigned int i = 0; i < frames; i++) {
+			out[i] *= temp[i];
+		}
+	} else if (_inputs.size() == 1) {
+		_pullBlock(_inputs.front(), out, frames);
+	} else {
+		std::fill(out, out + frames, 0.0f);
+	}
+}
+
 unsigned int RingModulator::_maxInputs(void) {
 	return 2;
 }
@@ -1010,6 +2378,32 @@ double Splitter::getNextSample(void) {
 	return _currentSample;
 }
 
+//The block version works like getNextSample(): The first output to ask for a block causes 
+//a block to be taken from the input, and that same block is given to the other outputs. All of
+//the outputs must ask for blocks of the same size.
+void Splitter::processBlock(float* out, unsigned int frames) {
+	if (_inputs.size() == 0) {
+		std::fill(out, out + frames, 0.0f);
+		return;
+	}
+
+	if (_fedOutputs >= _outputs.size()) {
+		_pullBlock(_inputs.front(), _getBlockBuffer(frames), frames);
+		_fedOutputs = 0;
+	}
+	++_fedOutputs;
+	std::copy(_blockBuffer.begin(), _blockBuffer.begin() + frames, out);
+}
+
+//When the splitter is run by a PatchGraph, the outputs in the graph all read the one block
+//computed here, so they count as fed.
+void Splitter::_processScheduledBlock(float* out, unsigned int frames, unsigned int scheduledOutputs) {
+	processBlock(out, frames);
+	if (scheduledOutputs > 1) {
+		_fedOutputs += scheduledOutputs - 1;
+	}
+}
+
 void Splitter::_outputAssignedEvent(ModuleBase* out) {
 	_fedOutputs = _outputs.size();
 }
@@ -1054,11 +2448,26 @@ double SoundBufferInput::getNextSample(void) {
 	if (!this->canPlay()) {
 		return 0;
 	}
-	double value = _sb->getRawDataReference().at(_currentSample);
+	double value = _sb->getSampleData()[_currentSample];
 	_currentSample += _sb->getChannelCount();
 	return value;
 }
 
+void SoundBufferInput::processBlock(float* out, unsigned int frames) {
+	unsigned int i = 0;
+	if (this->canPlay()) {
+		const float* data = _sb->getSampleData();
+		unsigned int channels = _sb->getChannelCount();
+		uint64_t totalSamples = _sb->getTotalSampleCount();
+
+		for (; i < frames && _currentSample < totalSamples; i++) {
+			out[i] = data[_currentSample];
+			_currentSample += channels;
+		}
+	}
+	std::fill(out + i, out + frames, 0.0f);
+}
+
 /*! Checks to see if the CX_SoundBuffer that is associated with this SoundBufferInput is able to play.
 It is unable to play if CX_SoundBuffer::isReadyToPlay() is false or if the whole sound has been played.*/
 bool SoundBufferInput::canPlay(void) {
@@ -1091,20 +2500,28 @@ void SoundBufferOutput::sampleData(CX::CX_Millis t) {
 
 	unsigned int samplesToTake = ceil(_data->sampleRate * t.seconds());
 
-	vector<float> tempData(samplesToTake);
+	if (sb.getTotalSampleCount() == 0) {
+		sb.setFromVector(std::vector<float>(), 1, _data->sampleRate);
+	}
+
+	//The samples are rendered directly into the end of the sound buffer.
+	std::vector<float>& data = sb.getRawDataReference();
+	size_t start = data.size();
+	data.resize(start + samplesToTake);
+	sb.updateMemoryUse();
+	float* out = data.data() + start;
 
 	ModuleBase* input = _inputs.front();
 
-	for (unsigned int i = 0; i < samplesToTake; i++) {
-		tempData[i] = CX::Util::clamp<float>((float)input->getNextSample(), -1, 1);
+	//Sample in blocks so that the scratch buffers of the modules don't grow to the size of the whole sound.
+	const unsigned int blockSize = 4096;
+	for (unsigned int i = 0; i < samplesToTake; i += blockSize) {
+		unsigned int frames = std::min(blockSize, samplesToTake - i);
+		_pullBlock(input, out + i, frames);
 	}
 
-	if (sb.getTotalSampleCount() == 0) {
-		sb.setFromVector(tempData, 1, _data->sampleRate);
-	} else {
-		for (unsigned int i = 0; i < tempData.size(); i++) {
-			sb.getRawDataReference().push_back(tempData[i]);
-		}
+	for (unsigned int i = 0; i < samplesToTake; i++) {
+		out[i] = CX::Util::clamp<float>(out[i], -1, 1);
 	}
 }
 
@@ -1131,22 +2548,198 @@ void StereoSoundBufferOutput::sampleData(CX::CX_Millis t) {
 
 	unsigned int channels = 2; //Stereo
 
-	vector<float> tempData(samplesToTake * channels);
+	if (sb.getTotalSampleCount() == 0) {
+		sb.setFromVector(std::vector<float>(), channels, left.getData().sampleRate);
+	}
 
-	for (unsigned int i = 0; i < samplesToTake; i++) {
-		tempData[(i * channels) + 0] = CX::Util::clamp<float>((float)left.getNextSample(), -1, 1);
-		tempData[(i * channels) + 1] = CX::Util::clamp<float>((float)right.getNextSample(), -1, 1);
+	//The samples are interleaved directly into the end of the sound buffer.
+	std::vector<float>& data = sb.getRawDataReference();
+	size_t offset = data.size();
+	data.resize(offset + (size_t)samplesToTake * channels);
+	sb.updateMemoryUse();
+	float* out = data.data() + offset;
+
+	const unsigned int blockSize = 4096;
+	vector<float> leftBlock(blockSize);
+	vector<float> rightBlock(blockSize);
+
+	for (unsigned int start = 0; start < samplesToTake; start += blockSize) {
+		unsigned int frames = std::min(blockSize, samplesToTake - start);
+		left.processBlock(leftBlock.data(), frames);
+		right.processBlock(rightBlock.data(), frames);
+
+		for (unsigned int i = 0; i < frames; i++) {
+			out[((start + i) * channels) + 0] = CX::Util::clamp<float>(leftBlock[i], -1, 1);
+			out[((start + i) * channels) + 1] = CX::Util::clamp<float>(rightBlock[i], -1, 1);
+		}
 	}
+}
 
-	if (sb.getTotalSampleCount() == 0) {
-		sb.setFromVector(tempData, channels, left.getData().sampleRate);
-	} else {
-		for (unsigned int i = 0; i < tempData.size(); i++) {
-			sb.getRawDataReference().push_back(tempData[i]);
+///////////////////
+// renderOffline //
+///////////////////
+
+/*! Renders many independent stimuli from a synth patch in parallel, without a sound stream, for example to
+pregenerate thousands of tone sequences at startup. Because modules are connected to each other with pointers, a
+patch cannot be copied, so each worker thread calls `makePatch` to build its own copy of the patch. Each worker then
+repeatedly takes the next stimulus that has not been rendered, calls OfflinePatch::prepare() for it, and renders the
+stimulus in blocks directly into its sound buffer, which is allocated once at the final size.
+
+The patch of each thread is only used by that thread. Modules that use shared state are not thread safe, which
+includes Oscillator::whiteNoise() (it uses CX::Instances::RNG; use a NoiseGenerator instead) and StreamInput.
+
+\code{.cpp}
+using namespace CX::Synth;
+
+std::vector<double> frequencies = { 200, 250, 300, 350 }; //Possibly thousands
+
+struct TonePatch : public OfflinePatch {
+	TonePatch(const std::vector<double>& freqs) :
+		frequencies(freqs)
+	{
+		osc.setGeneratorFunction(Oscillator::square);
+		lp.setup(BiquadCascade::FilterType::LOW_PASS, 4);
+		lp.cutoff = 4000;
+		amp.setGain(-12);
+		osc >> lp >> amp;
+	}
+
+	ModuleBase& getOutput(unsigned int channel) override {
+		return amp;
+	}
+
+	CX_Millis prepare(unsigned int stimulus) override {
+		osc.frequency = frequencies[stimulus];
+		lp.reset();
+		return CX_Millis(500);
+	}
+
+	const std::vector<double>& frequencies;
+	Oscillator osc;
+	BiquadCascade lp;
+	Multiplier amp;
+};
+
+OfflineRenderConfiguration config;
+config.sampleRate = 48000;
+
+std::vector<CX_SoundBuffer> tones = renderOffline([&](void) {
+	return std::unique_ptr<OfflinePatch>(new TonePatch(frequencies));
+}, frequencies.size(), config);
+\endcode
+
+\param makePatch A function that builds a patch. It is called once by each worker thread, possibly at the same time,
+so it must be thread safe. If it returns an empty pointer, that worker does not render anything.
+\param stimulusCount The number of stimuli to render.
+\param config The settings.
+\return A vector of `stimulusCount` sound buffers. Buffers of stimuli that could not be rendered are empty.
+\throw Any exception thrown by `makePatch` or by the patch on any of the threads. Once that happens, the other threads stop
+rendering, and the first exception is rethrown on the calling thread after all of the threads have finished.
+*/
+std::vector<CX_SoundBuffer> renderOffline(std::function<std::unique_ptr<OfflinePatch>(void)> makePatch, unsigned int stimulusCount,
+	const OfflineRenderConfiguration& config)
+{
+	std::vector<CX_SoundBuffer> buffers(stimulusCount);
+	if (stimulusCount == 0) {
+		return buffers;
+	}
+
+	const unsigned int channels = std::max(config.channels, 1u);
+	const unsigned int blockSize = std::max(config.blockSize, 1u);
+
+	std::atomic<unsigned int> nextStimulus(0);
+	std::atomic<unsigned int> rendered(0);
+
+	std::mutex errorMutex;
+	std::exception_ptr error;
+
+	auto render = [&](void) {
+		std::unique_ptr<OfflinePatch> patch = makePatch();
+		if (!patch) {
+			CX::Instances::Log.error("Synth") << "renderOffline(): The patch could not be made on one of the threads.";
+			return;
+		}
+
+		for (unsigned int c = 0; c < channels; c++) {
+			patch->getOutput(c).setData(ModuleControlData_t(config.sampleRate));
 		}
+
+		std::vector<float> channelBlock(channels > 1 ? blockSize : 0);
+
+		for (unsigned int i = nextStimulus++; i < stimulusCount; i = nextStimulus++) {
+			CX_Millis duration = patch->prepare(i);
+			uint64_t frames = (uint64_t)std::max(ceil(config.sampleRate * duration.seconds()), 0.0);
+
+			CX_SoundBuffer& sb = buffers[i];
+			sb.setFromVector(std::vector<float>(frames * channels), channels, config.sampleRate);
+			float* data = sb.getRawDataReference().data();
+
+			for (uint64_t start = 0; start < frames; start += blockSize) {
+				unsigned int n = (unsigned int)std::min<uint64_t>(blockSize, frames - start);
+
+				if (channels == 1) {
+					patch->getOutput(0).processBlock(data + start, n);
+				} else {
+					for (unsigned int c = 0; c < channels; c++) {
+						patch->getOutput(c).processBlock(channelBlock.data(), n);
+						float* frameStart = data + start * channels + c;
+						for (unsigned int j = 0; j < n; j++) {
+							frameStart[j * channels] = channelBlock[j];
+						}
+					}
+				}
+			}
+
+			if (config.clamp) {
+				for (uint64_t s = 0; s < frames * channels; s++) {
+					data[s] = CX::Util::clamp<float>(data[s], -1, 1);
+				}
+			}
+
+			rendered++;
+		}
+	};
+
+	//An exception must not escape a thread, so it is kept and rethrown once every thread has been joined.
+	auto worker = [&](void) {
+		try {
+			render();
+		} catch (...) {
+			nextStimulus = stimulusCount; //Stop the other threads from taking new stimuli.
+			std::lock_guard<std::mutex> lock(errorMutex);
+			if (!error) {
+				error = std::current_exception();
+			}
+		}
+	};
+
+	unsigned int threadCount = config.threads;
+	if (threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	threadCount = std::min(threadCount, stimulusCount);
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < threadCount; i++) {
+		threads.push_back(std::thread(worker));
+	}
+	worker();
+	for (std::thread& t : threads) {
+		t.join();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+
+	if (rendered < stimulusCount) {
+		CX::Instances::Log.error("Synth") << "renderOffline(): " << (stimulusCount - rendered) << " of " << stimulusCount << " stimuli were not rendered.";
 	}
+
+	return buffers;
 }
 
+
 ////////////////////////
 // StereoStreamOutput //
 ////////////////////////
@@ -1167,10 +2760,20 @@ void StereoStreamOutput::setup(CX::CX_SoundStream* stream) {
 }
 
 void StereoStreamOutput::_callback(CX::CX_SoundStream::OutputEventArgs& d) {
+	CX::CX_SoundStream::ListenerScope watchdog(d.instance, "Synth::StereoStreamOutput");
+
+	if (_leftBlock.size() < d.bufferSize) {
+		_leftBlock.resize(d.bufferSize);
+		_rightBlock.resize(d.bufferSize);
+	}
+
+	right.processBlock(_rightBlock.data(), d.bufferSize);
+	left.processBlock(_leftBlock.data(), d.bufferSize);
+
 	for (unsigned int sample = 0; sample < d.bufferSize; sample++) {
 		unsigned int index = sample * d.outputChannels;
-		d.outputBuffer[index + 0] += CX::Util::clamp<float>(right.getNextSample(), -1, 1); //The buffers only use float, so clamp with float.
-		d.outputBuffer[index + 1] += CX::Util::clamp<float>(left.getNextSample(), -1, 1);
+		d.outputBuffer[index + 0] += CX::Util::clamp<float>(_rightBlock[sample], -1, 1); //The buffers only use float, so clamp with float.
+		d.outputBuffer[index + 1] += CX::Util::clamp<float>(_leftBlock[sample], -1, 1);
 	}
 }
 
@@ -1192,6 +2795,7 @@ void StereoStreamOutput::_listenForEvents(bool listen) {
 /////////////////
 StreamInput::StreamInput(void) :
 _maxBufferSize(4096),
+_buffer(4 * 4096),
 _soundStream(nullptr),
 _listeningForEvents(false)
 {}
@@ -1213,35 +2817,54 @@ void StreamInput::setup(CX::CX_SoundStream* stream) {
 }
 
 double StreamInput::getNextSample(void) {
-	double rval = 0;
-	if (_maxBufferSize != 0) {
-		while (_buffer.size() > _maxBufferSize) {
-			_buffer.pop_front();
-		}
-	}
+	_discardOldSamples();
+
+	float sample = 0;
+	_buffer.read(&sample, 1);
+	return sample;
+}
+
+void StreamInput::processBlock(float* out, unsigned int frames) {
+	_discardOldSamples();
+
+	size_t available = _buffer.read(out, frames);
+	std::fill(out + available, out + frames, 0.0f);
+}
 
-	if (_buffer.size() > 0) {
-		rval = _buffer.front();
-		_buffer.pop_front();
+//Only the consumer removes samples, so that the input callback never touches the read position.
+void StreamInput::_discardOldSamples(void) {
+	if (_maxBufferSize == 0) {
+		return;
+	}
+	size_t available = _buffer.getReadAvailable();
+	if (available > _maxBufferSize) {
+		_buffer.discard(available - _maxBufferSize);
 	}
-	return rval;
 }
 
-/*! \brief Clear the contents of the input buffer. */
+/*! \brief Clear the contents of the input buffer. This must be called from the thread that pulls samples from
+this module (or while no samples are being pulled). */
 void StreamInput::clear(void) {
-	_buffer.clear();
+	_buffer.discard(_buffer.getReadAvailable());
 }
 
-/*! Set the maximum number of samples that the input buffer can contain. 
-\param size The size of the input buffer, in samples. */
+/*! Set the maximum number of samples that the input buffer can contain. The ring that holds the samples has room for
+four times this many samples, so that input that arrives between requests for samples is not lost. If that is larger
+than the current ring, a new ring is allocated, so this should be called before the sound streams are started.
+\param size The size of the input buffer, in samples. If 0, the buffer can hold as many samples as fit in the ring,
+which holds 16384 samples unless a larger maximum was set before. */
 void StreamInput::setMaximumBufferSize(unsigned int size) {
 	_maxBufferSize = size;
+	if ((size_t)size * 4 > _buffer.capacity()) {
+		_buffer.setup((size_t)size * 4);
+	}
 }
 
 void StreamInput::_callback(CX::CX_SoundStream::InputEventArgs& in) {
-	for (unsigned int sampleFrame = 0; sampleFrame < in.bufferSize; sampleFrame++) {
-		_buffer.push_back(in.inputBuffer[sampleFrame]);
-	}
+	CX::CX_SoundStream::ListenerScope watchdog(in.instance, "Synth::StreamInput");
+
+	//The stream has one input channel (see setup()), so the samples can be written as a block.
+	_buffer.write(in.inputBuffer, in.bufferSize);
 }
 
 void StreamInput::_listenForEvents(bool listen) {
@@ -1282,24 +2905,30 @@ void StreamOutput::setup(CX::CX_SoundStream* stream) {
 }
 
 void StreamOutput::_callback(CX::CX_SoundStream::OutputEventArgs& d) {
+	CX::CX_SoundStream::ListenerScope watchdog(d.instance, "Synth::StreamOutput");
+
 	if (_inputs.size() == 0) {
 		return;
 	}
 
 	ModuleBase* input = _inputs.front();
 
+	unsigned int oversampling = std::max<unsigned int>(this->_data->oversampling, 1);
+	float* block = _getBlockBuffer(d.bufferSize * oversampling);
+	_pullBlock(input, block, d.bufferSize * oversampling);
+
 	for (unsigned int sample = 0; sample < d.bufferSize; sample++) {
 		
 		float value;
-		if (this->_data->oversampling > 1) {
+		if (oversampling > 1) {
 			float sum = 0;
-			for (unsigned int oversamp = 0; oversamp < this->_data->oversampling; oversamp++) {
-				sum += input->getNextSample();
+			for (unsigned int oversamp = 0; oversamp < oversampling; oversamp++) {
+				sum += block[(sample * oversampling) + oversamp];
 			}
-			float mean = sum / this->_data->oversampling;
+			float mean = sum / oversampling;
 			value = CX::Util::clamp<float>(mean, -1, 1);
 		} else {
-			value = CX::Util::clamp<float>(input->getNextSample(), -1, 1);
+			value = CX::Util::clamp<float>(block[sample], -1, 1);
 		}
 
 		for (int ch = 0; ch < d.outputChannels; ch++) {
@@ -1340,16 +2969,161 @@ double TrivialGenerator::getNextSample(void) {
 	return value.getValue() - step;
 }
 
+void TrivialGenerator::processBlock(float* out, unsigned int frames) {
+	value.updateBlock(frames);
+	for (unsigned int i = 0; i < frames; i++) {
+		out[i] = value.getBlockValue(i);
+		value.getValue() += step;
+	}
+}
 
 
 
+
+///////////////
+// Upsampler //
+///////////////
+
+Upsampler::Upsampler(void) :
+	_factor(1),
+	_tapsPerPhase(1),
+	_latency(0),
+	_phase(0)
+{
+	setup(2);
+}
+
+/*! Sets the oversampling factor and the length of the interpolation filter. The state of the filter is reset.
+\param factor The number of times higher the sample rate of the modules after this module is than the rate of the
+modules that feed into it. 1 turns oversampling off.
+\param tapsPerPhase The number of input samples that each output sample is interpolated from. The length of the filter
+is `factor * tapsPerPhase`. More taps give a sharper cutoff at the cost of more computation and more latency. */
+void Upsampler::setup(unsigned int factor, unsigned int tapsPerPhase) {
+	_factor = std::max(factor, 1u);
+
+	std::vector<double> h = designResamplingFilter(_factor, tapsPerPhase);
+	_tapsPerPhase = (h.size() + _factor - 1) / _factor;
+	h.resize(_tapsPerPhase * _factor, 0);
+	_latency = (h.size() - 1) / (2.0 * _factor);
+
+	//Output sample n * _factor + p is the sum over j of h[p + j * _factor] * x[n - j]. The gain of _factor makes up
+	//for the zeros that are implicitly stuffed between input samples.
+	_phaseCoefficients.assign(_factor * _tapsPerPhase, 0);
+	for (unsigned int p = 0; p < _factor; p++) {
+		for (unsigned int j = 0; j < _tapsPerPhase; j++) {
+			_phaseCoefficients[p * _tapsPerPhase + (_tapsPerPhase - 1 - j)] = h[p + j * _factor] * _factor;
+		}
+	}
+
+	_history.assign(_tapsPerPhase, 0);
+	_phase = 0;
+
+	if (_data->initialized) {
+		this->_dataSet(nullptr); //Give the new factor to the neighbours.
+	}
+}
+
+/*! Returns the oversampling factor. */
+unsigned int Upsampler::getFactor(void) const {
+	return _factor;
+}
+
+/*! Returns the delay of the interpolation filter, in samples at the lower sample rate. */
+double Upsampler::getLatency(void) const {
+	return _latency;
+}
+
+double Upsampler::getNextSample(void) {
+	if (_inputs.size() == 0) {
+		return 0;
+	}
+
+	if (_phase == 0) {
+		std::copy(_history.begin() + 1, _history.begin() + _tapsPerPhase, _history.begin());
+		_history[_tapsPerPhase - 1] = _inputs.front()->getNextSample();
+	}
+
+	const double* c = _phaseCoefficients.data() + _phase * _tapsPerPhase;
+	double sum = 0;
+	for (unsigned int t = 0; t < _tapsPerPhase; t++) {
+		sum += c[t] * _history[t];
+	}
+
+	_phase = (_phase + 1) % _factor;
+	return sum;
+}
+
+void Upsampler::processBlock(float* out, unsigned int frames) {
+	if (_inputs.size() == 0) {
+		std::fill(out, out + frames, 0.0f);
+		return;
+	}
+
+	//A new input sample is needed for each output sample with phase 0.
+	unsigned int firstNewInput = (_factor - _phase) % _factor;
+	unsigned int inputCount = 0;
+	if (firstNewInput < frames) {
+		inputCount = 1 + (frames - 1 - firstNewInput) / _factor;
+	}
+
+	if (_history.size() < _tapsPerPhase + inputCount) {
+		_history.resize(_tapsPerPhase + inputCount);
+	}
+	if (inputCount > 0) {
+		_pullBlock(_inputs.front(), _history.data() + _tapsPerPhase, inputCount);
+	}
+
+	const float* x = _history.data();
+	size_t newest = _tapsPerPhase - 1;
+
+	for (unsigned int i = 0; i < frames; i++) {
+		if (_phase == 0) {
+			newest++;
+		}
+
+		const double* c = _phaseCoefficients.data() + _phase * _tapsPerPhase;
+		const float* window = x + newest + 1 - _tapsPerPhase;
+		double sum = 0;
+		for (unsigned int t = 0; t < _tapsPerPhase; t++) {
+			sum += c[t] * window[t];
+		}
+		out[i] = sum;
+
+		_phase = (_phase + 1) % _factor;
+	}
+
+	std::copy(_history.begin() + inputCount, _history.begin() + inputCount + _tapsPerPhase, _history.begin());
+}
+
+ModuleControlData_t Upsampler::_getDataForNeighbour(ModuleBase* neighbour) {
+	ModuleControlData_t d = *_data;
+	if (std::find(_outputs.begin(), _outputs.end(), neighbour) != _outputs.end()) {
+		d.oversampling *= _factor;
+	}
+	return d;
+}
+
+ModuleControlData_t Upsampler::_getDataFromNeighbour(ModuleBase* neighbour, ModuleControlData_t d) {
+	if (std::find(_outputs.begin(), _outputs.end(), neighbour) != _outputs.end()) {
+		d.oversampling = std::max(d.oversampling / _factor, 1u);
+	}
+	return d;
+}
+
 ///////////////
 // FIRFilter //
 ///////////////
 
 FIRFilter::FIRFilter(void) :
 _filterType(FilterType::LOW_PASS),
-_coefCount(-1)
+_windowType(WindowType::RECTANGULAR),
+_coefCount(-1),
+_convolutionMode(ConvolutionMode::AUTOMATIC),
+_fftActive(false),
+_partitionSize(256),
+_fftSize(0),
+_inputSpectraPosition(0),
+_chunkPosition(0)
 {}
 
 /*! Set up the FIRFilter with the given filter type and number of coefficients to use.
@@ -1374,20 +3148,50 @@ void FIRFilter::setup(FilterType filterType, unsigned int coefficientCount) {
 
 	_coefficients.assign(_coefCount, 0);
 	_inputSamples.assign(_coefCount, 0); //Fill with zeroes so that we never have to worry about not having enough input data.
+
+	_convolutionMode = ConvolutionMode::AUTOMATIC;
+	_fftActive = false;
+	_prepareConvolution();
 }
 
 /*! You can use this function to supply your own filter coefficients, which allows a great
 deal of flexibility in the use of the FIRFilter.  See the fir1 and fir2 functions from the
 //"signal" package for R for a way to design your own filter. 
 \param coefficients The filter coefficients to use.
+\param mode The method used to do the convolution. With ConvolutionMode::AUTOMATIC, FFT convolution
+is used if there are at least `fftCoefficientThreshold` coefficients.
+\param partitionSize The number of samples in each partition of the coefficients when FFT convolution is used.
+This is also the latency of the filter in FFT mode. Rounded up to a power of 2. Smaller partitions reduce latency
+but cost more per sample.
 */
-void FIRFilter::setup(std::vector<double> coefficients) {
+void FIRFilter::setup(std::vector<double> coefficients, ConvolutionMode mode, unsigned int partitionSize) {
 	_filterType = FilterType::USER_DEFINED;
 
 	_coefficients = coefficients;
 
 	_coefCount = coefficients.size();
 	_inputSamples.assign(_coefCount, 0); //Fill with zeroes so that we never have to worry about not having enough input data.
+
+	unsigned int size = 1;
+	while (size < std::max<unsigned int>(partitionSize, 1)) {
+		size *= 2;
+	}
+
+	_convolutionMode = mode;
+	_partitionSize = size;
+	_fftActive = false;
+	_prepareConvolution();
+}
+
+/*! Returns `true` if the filter is currently using FFT convolution. */
+bool FIRFilter::usingFFT(void) {
+	return _fftActive;
+}
+
+/*! Returns the number of samples by which the output of the filter is delayed by FFT convolution, 
+which is 0 if direct convolution is being used. This does not include the group delay of the filter itself. */
+unsigned int FIRFilter::getLatency(void) {
+	return _fftActive ? _partitionSize : 0;
 }
 
 /*! If using either FilterType::LOW_PASS or FilterType::HIGH_PASS, this function allows you to
@@ -1448,6 +3252,7 @@ void FIRFilter::setCutoff(double cutoff) {
 
 
 	_applyWindowToCoefs();
+	_prepareConvolution();
 }
 
 /*! Sets the upper and lower cutoffs for a band filter mode (i.e. `BAND_PASS` or `BAND_STOP`).
@@ -1501,9 +3306,16 @@ void FIRFilter::setBandCutoffs(double lower, double upper) {
 	}
 
 	_applyWindowToCoefs();
+	_prepareConvolution();
 }
 
 double FIRFilter::getNextSample(void) {
+	if (_fftActive) {
+		float x = _inputs.front()->getNextSample();
+		_convolveFFT(&x, 1);
+		return x;
+	}
+
 	//Because _inputSamples is set up to have _coefCount elements, you just always pop off an element to start.
 	_inputSamples.pop_front();
 	_inputSamples.push_back(_inputs.front()->getNextSample());
@@ -1517,6 +3329,41 @@ double FIRFilter::getNextSample(void) {
 	return y_n;
 }
 
+void FIRFilter::processBlock(float* out, unsigned int frames) {
+	if (_inputs.size() > 0) {
+		_pullBlock(_inputs.front(), out, frames);
+	} else {
+		std::fill(out, out + frames, 0.0f);
+	}
+
+	if (_coefCount <= 0 || frames == 0) {
+		return;
+	}
+
+	if (_fftActive) {
+		_convolveFFT(out, frames);
+		return;
+	}
+
+	//_inputSamples holds the last _coefCount samples. The history needs _coefCount - 1 old 
+	//samples followed by the new samples so that the convolution can be done in one pass.
+	unsigned int historyLength = _coefCount - 1;
+	_blockHistory.resize(historyLength + frames);
+	std::copy(_inputSamples.begin() + 1, _inputSamples.end(), _blockHistory.begin());
+	std::copy(out, out + frames, _blockHistory.begin() + historyLength);
+
+	for (unsigned int i = 0; i < frames; i++) {
+		const double* window = _blockHistory.data() + i;
+		double y_n = 0;
+		for (int j = 0; j < _coefCount; j++) {
+			y_n += window[j] * _coefficients[j];
+		}
+		out[i] = y_n;
+	}
+
+	std::copy(_blockHistory.end() - _coefCount, _blockHistory.end(), _inputSamples.begin());
+}
+
 double FIRFilter::_calcH(int n, double omega) {
 	if (n == 0) {
 		return omega / PI;
@@ -1541,5 +3388,153 @@ void FIRFilter::_applyWindowToCoefs(void) {
 	}
 }
 
+//Decides whether to use FFT convolution and, if so, calculates the spectra of the partitions of the 
+//impulse response. If the partitioning has not changed, the input history is kept so that coefficients
+//can be changed while the filter is running without a discontinuity.
+void FIRFilter::_prepareConvolution(void) {
+	bool useFFT = (_convolutionMode == ConvolutionMode::FFT) ||
+		(_convolutionMode == ConvolutionMode::AUTOMATIC && _coefCount >= (int)fftCoefficientThreshold);
+
+	if (!useFFT || _coefCount <= 0) {
+		_fftActive = false;
+		return;
+	}
+
+	unsigned int L = _partitionSize;
+	unsigned int N = 2 * L;
+	unsigned int bins = L + 1; //The input is real, so only the first N/2 + 1 bins are needed.
+	unsigned int partitionCount = (_coefCount + L - 1) / L;
+
+	if (_fftSize != N) {
+		_fftSize = N;
+
+		unsigned int bits = 0;
+		while ((1u << bits) < N) {
+			bits++;
+		}
+
+		_bitReverse.resize(N);
+		for (unsigned int i = 0; i < N; i++) {
+			unsigned int r = 0;
+			for (unsigned int b = 0; b < bits; b++) {
+				r |= ((i >> b) & 1) << (bits - 1 - b);
+			}
+			_bitReverse[i] = r;
+		}
+
+		_twiddles.resize(N / 2);
+		for (unsigned int k = 0; k < N / 2; k++) {
+			_twiddles[k] = std::polar(1.0, -2 * PI * k / N);
+		}
+
+		_fftWork.resize(N);
+		_fftActive = false;
+	}
+
+	if (!_fftActive || _inputSpectra.size() != partitionCount) {
+		_inputSpectra.assign(partitionCount, std::vector<std::complex<double>>(bins));
+		_inputSpectraPosition = 0;
+		_fftInput.assign(N, 0);
+		_chunkOutput.assign(L, 0);
+		_chunkPosition = 0;
+	}
+
+	//The coefficients are applied with the last coefficient multiplying the newest sample, 
+	//so the impulse response is the coefficients reversed.
+	_partitionSpectra.resize(partitionCount);
+	for (unsigned int p = 0; p < partitionCount; p++) {
+		std::fill(_fftWork.begin(), _fftWork.end(), std::complex<double>(0, 0));
+		for (unsigned int i = 0; i < L; i++) {
+			int k = p * L + i;
+			if (k < _coefCount) {
+				_fftWork[i] = _coefficients[_coefCount - 1 - k];
+			}
+		}
+		_fft(_fftWork.data(), false);
+		_partitionSpectra[p].assign(_fftWork.begin(), _fftWork.begin() + bins);
+	}
+
+	_fftActive = true;
+}
+
+//Filters data in place. Each input sample is stored in the current chunk and replaced with the output 
+//for the same position in the previous chunk, so the output is delayed by one partition.
+void FIRFilter::_convolveFFT(float* data, unsigned int frames) {
+	unsigned int L = _partitionSize;
+	for (unsigned int i = 0; i < frames; i++) {
+		_fftInput[L + _chunkPosition] = data[i];
+		data[i] = _chunkOutput[_chunkPosition];
+
+		if (++_chunkPosition == L) {
+			_processChunk();
+			_chunkPosition = 0;
+		}
+	}
+}
+
+void FIRFilter::_processChunk(void) {
+	unsigned int L = _partitionSize;
+	unsigned int N = _fftSize;
+	unsigned int bins = L + 1;
+	unsigned int partitionCount = _partitionSpectra.size();
+
+	for (unsigned int i = 0; i < N; i++) {
+		_fftWork[i] = _fftInput[i];
+	}
+	_fft(_fftWork.data(), false);
+
+	std::vector<std::complex<double>>& current = _inputSpectra[_inputSpectraPosition];
+	std::copy(_fftWork.begin(), _fftWork.begin() + bins, current.begin());
+
+	std::fill(_fftWork.begin(), _fftWork.end(), std::complex<double>(0, 0));
+	for (unsigned int p = 0; p < partitionCount; p++) {
+		unsigned int index = (_inputSpectraPosition + partitionCount - p) % partitionCount;
+		const std::complex<double>* x = _inputSpectra[index].data();
+		const std::complex<double>* h = _partitionSpectra[p].data();
+		for (unsigned int k = 0; k < bins; k++) {
+			_fftWork[k] += x[k] * h[k];
+		}
+	}
+
+	for (unsigned int k = 1; k < L; k++) {
+		_fftWork[N - k] = std::conj(_fftWork[k]);
+	}
+
+	_fft(_fftWork.data(), true);
+
+	//Overlap-save: The second half of the circular convolution is the linear convolution.
+	for (unsigned int i = 0; i < L; i++) {
+		_chunkOutput[i] = _fftWork[L + i].real() / N;
+	}
+
+	_inputSpectraPosition = (_inputSpectraPosition + 1) % partitionCount;
+	std::copy(_fftInput.begin() + L, _fftInput.end(), _fftInput.begin());
+}
+
+//In-place iterative radix-2 FFT of size _fftSize. The inverse is not scaled.
+void FIRFilter::_fft(std::complex<double>* data, bool inverse) {
+	unsigned int n = _fftSize;
+
+	for (unsigned int i = 0; i < n; i++) {
+		unsigned int j = _bitReverse[i];
+		if (i < j) {
+			std::swap(data[i], data[j]);
+		}
+	}
+
+	for (unsigned int size = 2; size <= n; size *= 2) {
+		unsigned int half = size / 2;
+		unsigned int step = n / size;
+		for (unsigned int start = 0; start < n; start += size) {
+			for (unsigned int k = 0; k < half; k++) {
+				std::complex<double> w = inverse ? std::conj(_twiddles[k * step]) : _twiddles[k * step];
+				std::complex<double> t = w * data[start + k + half];
+				data[start + k + half] = data[start + k] - t;
+				data[start + k] += t;
+			}
+		}
+	}
+}
+
 } //namespace Synth
 } //namespace CX
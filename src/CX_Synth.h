@@ -1,11 +1,18 @@
 #pragma once
 
+#include <atomic>
+#include <complex>
+#include <map>
+#include <memory>
+#include <functional>
+
 #include "ofEvents.h"
 #include "CX_SoundStream.h"
 #include "CX_SoundBuffer.h"
 
 #include "CX_RandomNumberGenerator.h" //For white noise generator
 #include "CX_Time_t.h"
+#include "CX_SPSCRingBuffer.h"
 
 /*! \namespace CX::Synth
 This namespace contains a number of classes that can be combined together to form a modular
@@ -13,13 +20,22 @@ synthesizer that can be used to procedurally generate sound stimuli. There are m
 saving the sound stimuli to a file for later use or directly outputting the sounds to sound
 hardware. There is also a way to use the data from a CX_SoundBuffer as the input to the synth.
 
-There are two types of oscillators (Oscillator and AdditiveSynth), an ADSR Envelope, two types
-of filters (Filter and FIRFilter), a Splitter and a Mixer, and some utility classes for adding,
+There are two types of oscillators (Oscillator and AdditiveSynth), a NoiseGenerator, an ADSR Envelope, three types
+of filters (Filter, BiquadCascade, and FIRFilter), a Splitter and a Mixer, and some utility classes for adding,
 multiplying, and clamping values.
 
 Making your own modules is simplified by the fact that all modules inherit from ModuleBase. You
 only need to overload one function from ModuleBase in order to have a functional module, although
-there are some other functions that can be overloaded for advanced uses.
+there are some other functions that can be overloaded for advanced uses. In particular, overloading
+ModuleBase::processBlock() allows a module to produce many samples at once, which is much more efficient
+than producing them one at a time. All of the built-in modules do this, and the output modules (e.g.
+StreamOutput) request data from their inputs in blocks.
+
+A PatchGraph can be placed at the end of a patch to compile it into a fixed schedule in which each
+module is processed exactly once per block, which is helpful for large patches with shared sub-graphs.
+
+Parts of a patch can be oversampled, e.g. to reduce aliasing from oscillators, by putting them between an
+Upsampler (or nothing, for sources like oscillators) and a Downsampler.
 
 \ingroup sound
 */
@@ -29,6 +45,7 @@ namespace Synth {
 
 	double sinc(double x);
 	double relativeFrequency(double f, double semitoneDifference);
+	std::vector<double> designResamplingFilter(unsigned int factor, unsigned int tapsPerPhase);
 
 	struct ModuleControlData_t {
 		ModuleControlData_t(void) :
@@ -67,6 +84,7 @@ namespace Synth {
 		~ModuleBase(void);
 
 		virtual double getNextSample(void);
+		virtual void processBlock(float* out, unsigned int frames);
 
 		void setData(ModuleControlData_t d);
 		ModuleControlData_t getData(void);
@@ -80,12 +98,19 @@ namespace Synth {
 
 		friend ModuleBase& operator>>(ModuleBase& l, ModuleBase& r);
 		friend void operator>>(ModuleBase& l, ModuleParameter& r);
+		friend class ModuleParameter;
+		friend class PatchGraph;
 
 		std::vector<ModuleBase*> _inputs; //!< The inputs to this module.
 		std::vector<ModuleBase*> _outputs; //!< The outputs from this module.
 		std::vector<ModuleParameter*> _parameters; //!< The ModuleParameters of this module.
 		ModuleControlData_t *_data; //!< The data for this module.
 
+		std::vector<float> _blockBuffer; //!< Scratch space for processBlock(). Use _getBlockBuffer() to access it.
+		float* _getBlockBuffer(unsigned int frames);
+
+		static void _pullBlock(ModuleBase* in, float* out, unsigned int frames);
+
 		void _dataSet(ModuleBase* caller);
 		void _setDataIfNotSet(ModuleBase* target);
 		void _registerParameter(ModuleParameter* p);
@@ -106,6 +131,24 @@ namespace Synth {
 		//These functions are called whenever an input or output has been assigned to this module.
 		virtual void _inputAssignedEvent(ModuleBase* in);
 		virtual void _outputAssignedEvent(ModuleBase* out);
+
+		//Called by a PatchGraph in place of processBlock(). scheduledOutputs is the number of outputs of this module
+		//that are in the same PatchGraph and that will read the result without calling processBlock() again.
+		virtual void _processScheduledBlock(float* out, unsigned int frames, unsigned int scheduledOutputs);
+
+		//These functions allow a module to give its neighbours different data than its own, e.g. a different
+		//oversampling factor (see Upsampler and Downsampler). By default, the data is passed along unchanged.
+		virtual ModuleControlData_t _getDataForNeighbour(ModuleBase* neighbour);
+		virtual ModuleControlData_t _getDataFromNeighbour(ModuleBase* neighbour, ModuleControlData_t d);
+
+		void _connectionsChanged(void);
+
+	private:
+
+		float* _scheduledBlock; // Set by a PatchGraph when the output of this module for the current block has already been computed.
+		//Incremented whenever an input, output, or parameter input of this module changes, and when the module is destroyed.
+		//It is shared with the PatchGraphs that watch this module, so that they can still read it after the module is gone.
+		std::shared_ptr<std::atomic<unsigned int>> _connectionVersion;
 	};
 
 	/*! This class is used to provide modules with the ability to have their control parameters change as a
@@ -126,6 +169,9 @@ namespace Synth {
 		bool valueUpdated(bool checkForUpdates = true);
 		double& getValue(void);
 
+		void updateBlock(unsigned int frames);
+		double getBlockValue(unsigned int frame);
+
 		operator double(void);
 
 		ModuleParameter& operator=(double d);
@@ -134,12 +180,15 @@ namespace Synth {
 
 	private:
 		friend class ModuleBase;
+		friend class PatchGraph;
 
 		ModuleBase* _owner; // A pointer to the module that this ModuleParameter is owned by.
 		ModuleBase* _input; // The input to the parameter. Parameters have one input and no outputs.
 
 		bool _updated;
 		double _value;
+
+		std::vector<float> _block; // The values taken from _input on the last call to updateBlock().
 	};
 
 
@@ -200,13 +249,16 @@ namespace Synth {
 		void pruneLowAmplitudeHarmonics(double tol);
 
 		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
 
 	private:
 
 		struct HarmonicInfo {
 			HarmonicInfo(void) :
 				relativeFrequency(1),
-				amplitude(0)
+				amplitude(0),
+				positionChangePerSample(0),
+				waveformPosition(0)
 			{}
 
 			//set
@@ -224,6 +276,15 @@ namespace Synth {
 
 		void _recalculateWaveformPositions(void);
 
+		//Structure-of-arrays state used by processBlock(). Each harmonic is a phasor (scaled by its amplitude)
+		//that is rotated once per sample. The arrays are padded with zeros to a multiple of the vector width.
+		std::vector<double> _phasorSin;
+		std::vector<double> _phasorCos;
+		std::vector<double> _rotationSin;
+		std::vector<double> _rotationCos;
+
+		void _renderHarmonics(float* out, unsigned int frames);
+
 		void _dataSetEvent(void) override;
 
 	};
@@ -237,10 +298,123 @@ namespace Synth {
 	public:
 		Adder(void);
 		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
 
 		ModuleParameter amount; //!< The amount that will be added to the input signal.
 	};
 
+	/*! This class is a filter made of a cascade of second order IIR sections (biquads), which is the standard way to build
+	steep, stable IIR filters. Unlike chaining several Filter modules, all of the sections are run within one module, so
+	there is one virtual call per block no matter how many sections there are. The sections are run in transposed direct
+	form II in double precision.
+
+	Butterworth low-pass and high-pass filters of any order can be designed with setup(). Band-pass and notch filters
+	are made of identical sections, each with the given `bandwidth`. Arbitrary sections, e.g. designed in another program,
+	can be given with setSections().
+
+	When `cutoff` or `bandwidth` are changed, e.g. by an envelope connected to them to make a filter sweep, only the
+	coefficients are recalculated, which costs one `sin()` and `cos()` and a few arithmetic operations per section. If
+	that is still too much, setCoefficientUpdateInterval() can be used to update the coefficients less often than every sample.
+
+	Several channels (or voices) can be filtered with the same coefficients at once with processInterleaved(), for example
+	to filter the contents of a CX_SoundBuffer. The channels are processed in parallel in the lanes of vector registers
+	(2 channels with SSE2 or NEON, 4 with AVX), unless `CX_SYNTH_NO_SIMD` is defined.
+
+	\code{.cpp}
+	using namespace CX::Synth;
+	NoiseGenerator noise;
+	BiquadCascade lp;
+	lp.setup(BiquadCascade::FilterType::LOW_PASS, 8); //8th order Butterworth, i.e. 4 sections
+	lp.cutoff = 2000;
+	noise >> lp >> output;
+	\endcode
+
+	\ingroup modSynth */
+	class BiquadCascade : public ModuleBase {
+	public:
+
+		/*! The type of filter. */
+		enum class FilterType {
+			LOW_PASS, //!< A Butterworth low-pass filter.
+			HIGH_PASS, //!< A Butterworth high-pass filter.
+			BAND_PASS, //!< A cascade of identical band-pass sections with unity gain at the center frequency.
+			NOTCH, //!< A cascade of identical notch sections.
+			USER_DEFINED //!< Sections given with setSections(). `cutoff` and `bandwidth` are ignored.
+		};
+
+		/*! One second order section. The transfer function is `(b0 + b1*z^-1 + b2*z^-2) / (1 + a1*z^-1 + a2*z^-2)`,
+		which is the same as a row of a second order sections matrix from scipy.signal or MATLAB with `a0` equal to 1.
+		A first order section has `b2` and `a2` equal to 0. */
+		struct Section {
+			Section(void) :
+				b0(1), b1(0), b2(0), a1(0), a2(0)
+			{}
+
+			Section(double b0_, double b1_, double b2_, double a1_, double a2_) :
+				b0(b0_), b1(b1_), b2(b2_), a1(a1_), a2(a2_)
+			{}
+
+			double b0;
+			double b1;
+			double b2;
+			double a1;
+			double a2;
+		};
+
+		BiquadCascade(void);
+
+		void setup(FilterType type, unsigned int order);
+		void setSections(const std::vector<Section>& sections);
+		std::vector<Section> getSections(void) const;
+		unsigned int getSectionCount(void) const;
+
+		void setCoefficientUpdateInterval(unsigned int samples);
+		void reset(void);
+
+		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
+
+		void processInterleaved(float* data, unsigned int frames, unsigned int channels);
+
+		/*! The cutoff frequency of a low-pass or high-pass filter, or the center frequency of a band-pass or notch filter, in Hz. */
+		ModuleParameter cutoff;
+
+		/*! For BAND_PASS and NOTCH filters, the width of the pass or stop band of each section, in Hz, between the points
+		at which the amplitude is sin(PI/4) (i.e. .707), approximately. Because the sections are cascaded, the band of the whole filter
+		is narrower than this when there is more than one section. */
+		ModuleParameter bandwidth;
+
+	private:
+
+		FilterType _filterType;
+		unsigned int _order;
+
+		std::vector<Section> _sections;
+
+		//For cheap updates: 1/(2*Q) of each section, which only depend on the filter type and order, and the
+		//parameter values that the coefficients were last calculated for.
+		std::vector<double> _sectionHalfInverseQ;
+		bool _hasFirstOrderSection;
+		double _designedCutoff;
+		double _designedBandwidth;
+
+		unsigned int _updateInterval;
+		unsigned int _samplesSinceUpdate;
+
+		std::vector<double> _z1; //State of each section for the single channel path
+		std::vector<double> _z2;
+
+		unsigned int _interleavedChannels;
+		std::vector<double> _channelZ1; //State for processInterleaved(), [section][channel]
+		std::vector<double> _channelZ2;
+
+		void _dataSetEvent(void) override;
+
+		bool _coefficientsOutdated(void);
+		void _recalculateCoefficients(void);
+		void _processRun(float* data, unsigned int frames);
+	};
+
 	/*! This class clamps inputs to be in the interval [`low`, `high`], where `low` and `high` are the members of this class.
 	\ingroup modSynth
 	*/
@@ -249,11 +423,62 @@ namespace Synth {
 		Clamper(void);
 
 		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
 
 		ModuleParameter low; //!< The lowest possible output value.
 		ModuleParameter high; //!< The highest possible output value.
 	};
 
+	/*! This class is the end of an oversampled region of a patch. The modules that feed into a Downsampler run at
+	`factor` times the sample rate of the modules after it, so that nonlinear modules that cause aliasing (e.g. an Oscillator
+	making square or saw waves, or a Clamper) can be run at a high sample rate without running the rest of the patch, or the
+	whole sound stream, at that rate. The Downsampler removes the frequencies above the Nyquist frequency of the lower rate
+	with a linear phase windowed-sinc FIR filter and keeps every `factor`th sample, computing only the samples that are kept.
+
+	The oversampling factor is given to the modules that feed into the Downsampler through ModuleControlData_t::oversampling,
+	which every module takes into account, so the modules in the region do not need to be configured specially. If a signal
+	from outside of the region needs to go into the region, it should go through an Upsampler with the same factor. Each module
+	can only be in one region: If the same module feeds into modules at different rates, it will be pulled at the wrong rate.
+	The data (sample rate) should be set on a module outside of the region, e.g. the output module.
+
+	\code{.cpp}
+	using namespace CX::Synth;
+	Oscillator osc;
+	Downsampler down;
+	StreamOutput output;
+
+	osc.setGeneratorFunction(Oscillator::saw);
+	osc.frequency = 3000;
+	down.setup(4); //osc runs at 4 times the sample rate of the output.
+
+	osc >> down >> output;
+	\endcode
+
+	\ingroup modSynth */
+	class Downsampler : public ModuleBase {
+	public:
+
+		Downsampler(void);
+
+		void setup(unsigned int factor, unsigned int tapsPerPhase = 32);
+		unsigned int getFactor(void) const;
+		double getLatency(void) const;
+
+		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
+
+	private:
+
+		unsigned int _factor;
+		std::vector<double> _coefficients;
+		std::vector<float> _history; //The last _coefficients.size() - 1 input samples, followed by new input samples.
+
+		void _decimate(float* out, unsigned int frames);
+
+		ModuleControlData_t _getDataForNeighbour(ModuleBase* neighbour) override;
+		ModuleControlData_t _getDataFromNeighbour(ModuleBase* neighbour, ModuleControlData_t d) override;
+	};
+
 	/*! This class is a standard ADSR envelope: http://en.wikipedia.org/wiki/Synthesizer#ADSR_envelope.
 	`s` should be in the interval [0,1]. `a`, `d`, and `r` are expressed in seconds.
 	Call attack() to start the envelope. Once the attack and decay are finished, the envelope will
@@ -270,6 +495,7 @@ namespace Synth {
 		Envelope(void);
 
 		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
 
 		void attack(void);
 		void release(void);
@@ -293,6 +519,7 @@ namespace Synth {
 		double _timeSinceLastStage;
 
 		void _dataSetEvent(void);
+		double _calculateLevel(void);
 
 		double _a;
 		double _d;
@@ -306,7 +533,7 @@ namespace Synth {
 
 	This class is based on simple IIR filters. They may not be stable at all frequencies.
 	They are computationally very efficient. They are not highly configurable. They may be chained
-	for sharper frequency response.	This class is based on this chapter: http://www.dspguide.com/ch19.htm.
+	for sharper frequency response, although a BiquadCascade is better for that.	This class is based on this chapter: http://www.dspguide.com/ch19.htm.
 	\ingroup modSynth */
 	class Filter : public ModuleBase {
 	public:
@@ -324,6 +551,7 @@ namespace Synth {
 		void setType(FilterType type);
 
 		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
 
 		/*! The cutoff frequency of the filter. */
 		ModuleParameter cutoff;
@@ -372,6 +600,17 @@ namespace Synth {
 			return f(v);
 		}
 
+		void processBlock(float* out, unsigned int frames) override {
+			if (_inputs.size() >= 1) {
+				_pullBlock(_inputs.front(), out, frames);
+			} else {
+				std::fill(out, out + frames, 0.0f);
+			}
+			for (unsigned int i = 0; i < frames; i++) {
+				out[i] = f(out[i]);
+			}
+		}
+
 		std::function<double(double)> f; //!< The user function, which will be called each time getNextSample() is called.
 	};
 
@@ -393,6 +632,26 @@ namespace Synth {
 			}
 			return sum / _data->oversampling;
 		}
+
+		void processBlock(float* out, unsigned int frames) override {
+			if (_inputs.size() == 0) {
+				std::fill(out, out + frames, 0.0f);
+				return;
+			}
+			if (_data->oversampling <= 1) {
+				_pullBlock(_inputs.front(), out, frames);
+				return;
+			}
+			float* over = _getBlockBuffer(frames * _data->oversampling);
+			_pullBlock(_inputs.front(), over, frames * _data->oversampling);
+			for (unsigned int i = 0; i < frames; i++) {
+				float sum = 0;
+				for (unsigned int j = 0; j < _data->oversampling; j++) {
+					sum += over[(i * _data->oversampling) + j];
+				}
+				out[i] = sum / _data->oversampling;
+			}
+		}
 	private:
 		unsigned int _maxOutputs(void) override { return 0; };
 		void _inputAssignedEvent(ModuleBase* in) override {
@@ -412,6 +671,7 @@ namespace Synth {
 	class Mixer : public ModuleBase {
 	public:
 		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
 	private:
 		unsigned int _maxInputs(void) override;
 	};
@@ -427,14 +687,70 @@ namespace Synth {
 		Multiplier(double amount);
 
 		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
 		void setGain(double decibels);
 
 		ModuleParameter amount; //!< The amount that the input signal will be multiplied by.
 	};
 
+	/*! This class produces white or pink noise. It has its own CX_RandomNumberGenerator, so that the noise is
+	reproducible and does not change the sequence of random numbers from CX::Instances::RNG (other than taking
+	one value from it for the seed when the NoiseGenerator is constructed). Noise is produced in blocks with
+	CX_RandomNumberGenerator::fillUniform(), which is much faster than using Oscillator::whiteNoise().
+
+	\code{.cpp}
+	using namespace CX::Synth;
+	NoiseGenerator noise;
+	noise.setColor(NoiseGenerator::Color::PINK);
+	noise.setSeed(12345); //Get the same noise every time.
+	\endcode
+	\ingroup modSynth
+	*/
+	class NoiseGenerator : public ModuleBase {
+	public:
+
+		/*! The spectrum of the noise. */
+		enum class Color {
+			WHITE, //!< Equal power at all frequencies.
+			PINK //!< Power that falls by 3 dB per octave, made by filtering white noise (Paul Kellet's refined method).
+		};
+
+		NoiseGenerator(void);
+
+		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
+
+		void setColor(Color color);
+		Color getColor(void) const;
+
+		void setSeed(unsigned long seed);
+		CX_RandomNumberGenerator& getRNG(void);
+
+		ModuleParameter amplitude; //!< The peak amplitude of the noise. White noise is uniform in [-amplitude, amplitude). Defaults to 1.
+
+	private:
+		Color _color;
+		CX_RandomNumberGenerator _rng;
+		float _pinkState[7];
+
+		float _pinkFilter(float white);
+
+		unsigned int _maxInputs(void) override { return 0; };
+	};
+
 	/*! This class provides one of the simplest ways of generating waveforms. The output
 	from an Oscillator can be filtered with a CX::Synth::Filter or used in other ways.
 
+	When one of the built-in waveforms (saw(), sine(), square(), or triangle()) is given to setGeneratorFunction(),
+	the Oscillator does not call the function, but looks up the waveform in a band-limited wavetable. The wavetables are
+	computed once, the first time that they are used, from the Fourier series of each waveform, with one table per octave
+	of fundamental frequency that only contains the harmonics that are below the Nyquist frequency for that octave.
+	The table for the current frequency is read with linear interpolation. This is several times faster than calling
+	the generator function for each sample and does not alias, which the naive waveforms do badly at high frequencies.
+	Because the waveforms are band-limited, square and saw waves overshoot [-1, 1] by about 9% (the Gibbs phenomenon).
+	If you need the exact, naive waveform (e.g. for a low frequency oscillator controlling another module), use
+	setBandLimited(false).
+
 	\code{.cpp}
 	using namespace CX::Synth;
 	//Configure the oscillator to produce a square wave with a fundamental frequency of 200 Hz.
@@ -450,9 +766,13 @@ namespace Synth {
 		Oscillator(void);
 
 		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
 
 		void setGeneratorFunction(std::function<double(double)> f);
 
+		void setBandLimited(bool bandLimited);
+		bool isBandLimited(void) const;
+
 		ModuleParameter frequency; //!< The fundamental frequency of the oscillator.
 
 		static double saw(double wp);
@@ -462,17 +782,98 @@ namespace Synth {
 		static double whiteNoise(double wp);
 
 	private:
+		struct Wavetable;
+
 		std::function<double(double)> _generatorFunction;
 		float _frequencyDivisor;
 		//float _sampleRate; //This is a slight optimization. This just needs to refer to a data member, rather than _data->sampleRate.
 		double _waveformPos;
 
+		bool _bandLimited;
+		const Wavetable* _builtInWavetable; //The wavetable of the generator function if it is a built-in waveform, else nullptr.
+		const Wavetable* _wavetable; //The wavetable in use, or nullptr to call the generator function.
+		double _wavetableFrequency; //The frequency that _wavetableLevel was chosen for.
+		unsigned int _wavetableLevel;
+
+		void _selectWavetable(void);
+		void _updateWavetableLevel(double frequency);
+
 		void _dataSetEvent(void);
 
 		unsigned int _maxInputs(void) override { return 0; };
 	};
 
 
+	/*! This class compiles a patch of connected modules into a fixed execution schedule. The PatchGraph
+	takes one input, the root of the patch, and works backward from it through the inputs and the
+	ModuleParameter inputs of each module to find every module that contributes to the root. These
+	modules are sorted so that each module comes after all of the modules that it depends on. When a
+	block is requested from the PatchGraph, each module in the schedule is processed once, in order,
+	into its own preallocated buffer, and modules that request a block from an input that has already
+	been processed get a copy of that buffer instead of another call into the input.
+
+	This means that a patch with shared sub-graphs (e.g. a Splitter feeding several modules that
+	are later mixed together) is evaluated without repeated work, and that each module is visited once
+	per block instead of being re-entered through a chain of nested calls.
+
+	The schedule is recompiled automatically the next time a block is requested after any modules 
+	are connected or disconnected. Because compiling allocates memory, you may want to call compile()
+	yourself after changing the patch rather than letting it happen in the sound callback.
+
+	\code{.cpp}
+	using namespace CX::Synth;
+	Oscillator osc;
+	Splitter sp;
+	Filter f1;
+	Filter f2;
+	Mixer mix;
+	PatchGraph graph;
+	StreamOutput output;
+
+	osc >> sp;
+	sp >> f1 >> mix;
+	sp >> f2 >> mix;
+	mix >> graph >> output; //The mixer is the root of the graph.
+
+	graph.compile(); //Optional: otherwise compiled on the first block.
+	\endcode
+	\ingroup modSynth
+	*/
+	class PatchGraph : public ModuleBase {
+	public:
+		PatchGraph(void);
+
+		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
+
+		bool compile(void);
+		bool needsCompile(void);
+		std::vector<ModuleBase*> getSchedule(void);
+
+	private:
+
+		struct ScheduledModule {
+			ScheduledModule(void) :
+				module(nullptr),
+				scheduledOutputs(0)
+			{}
+
+			ModuleBase* module;
+			unsigned int scheduledOutputs; // The number of modules in the graph that use this module as an input.
+			std::vector<float> block;
+		};
+
+		std::vector<ScheduledModule> _schedule;
+		bool _compiled;
+		bool _valid;
+		unsigned int _compiledVersion;
+
+		bool _visit(ModuleBase* m, std::map<ModuleBase*, int>& states);
+		std::vector<std::shared_ptr<std::atomic<unsigned int>>> _watched; // The connection versions of the modules visited by compile().
+		void _watchVisited(const std::map<ModuleBase*, int>& states);
+		unsigned int _watchedConnectionVersion(void);
+	};
+
 	/*! This class is an implementation of a very basic ring modulator.	Ringmods need two inputs: 
 	the source and the carrier. The order doesn't matter, for this class. If only one input is 
 	given, it will just pass that input through.
@@ -506,6 +907,7 @@ namespace Synth {
 	class RingModulator : public ModuleBase {
 	public:
 		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
 	private:
 		unsigned int _maxInputs(void) override;
 	};
@@ -536,10 +938,12 @@ namespace Synth {
 	public:
 		Splitter(void);
 		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
 
 	private:
 		void _outputAssignedEvent(ModuleBase* out) override;
 		unsigned int _maxOutputs(void) override { return 32; };
+		void _processScheduledBlock(float* out, unsigned int frames, unsigned int scheduledOutputs) override;
 
 		double _currentSample;
 		unsigned int _fedOutputs;
@@ -556,6 +960,7 @@ namespace Synth {
 		SoundBufferInput(void);
 
 		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
 
 		void setSoundBuffer(CX::CX_SoundBuffer *sb, unsigned int channel = 0);
 		void setTime(CX_Millis t);
@@ -579,6 +984,11 @@ namespace Synth {
 	the samples it gives out will be very old. For this reason, user code can configure a maximum
 	buffer size using setMaximumBufferSize(). The maximum buffer size defaults to 4096 samples.
 	User code can clear the buffer with clear().
+
+	The buffer is a fixed-capacity single-producer, single-consumer ring (CX::CX_SPSCRingBuffer), so the input callback and
+	the thread that pulls samples (normally the output callback of another stream) neither lock nor allocate memory. If the
+	ring fills up because no samples are requested, new input samples are dropped until samples are requested again, at which
+	point the oldest samples beyond the maximum buffer size are discarded.
 	*/
 	class StreamInput : public ModuleBase {
 	public:
@@ -588,13 +998,16 @@ namespace Synth {
 		void setup(CX::CX_SoundStream* stream);
 
 		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
 
 		void clear(void);
 		void setMaximumBufferSize(unsigned int size);
 	private:
 
 		unsigned int _maxBufferSize;
-		std::deque<float> _buffer;
+		CX_SPSCRingBuffer<float> _buffer;
+
+		void _discardOldSamples(void);
 
 		CX::CX_SoundStream* _soundStream;
 		bool _listeningForEvents;
@@ -664,6 +1077,9 @@ namespace Synth {
 		CX_SoundStream* _soundStream;
 		bool _listeningForEvents;
 		void _listenForEvents(bool listen);
+
+		std::vector<float> _leftBlock;
+		std::vector<float> _rightBlock;
 	};
 
 	/*! This class provides a method of capturing the output of a modular synth and storing it in a CX_SoundBuffer
@@ -724,6 +1140,47 @@ namespace Synth {
 		CX::CX_SoundBuffer sb; //!< The sound buffer that will be filled with samples with sampleData() is called.
 	};
 
+	/*! A patch that is rendered by renderOffline(). Derive a class from this that contains and connects the modules
+	of the patch, configures them for each stimulus in prepare(), and gives the module at the end of the patch
+	in getOutput(). See renderOffline() for an example.
+	\ingroup modSynth */
+	class OfflinePatch {
+	public:
+		virtual ~OfflinePatch(void) {}
+
+		/*! Returns the module whose output is rendered into `channel` of the sound buffers. The module should be the end of
+		the patch, e.g. a Multiplier or a PatchGraph: It is not connected to anything else by the renderer.
+		\param channel The channel, in [0, channels), where `channels` is OfflineRenderConfiguration::channels. */
+		virtual ModuleBase& getOutput(unsigned int channel) = 0;
+
+		/*! Configures the patch to render stimulus `stimulus` and returns the duration of that stimulus. The modules keep
+		their state between stimuli, so this should reset anything that needs to start fresh, e.g. by assigning new
+		values to parameters or calling Envelope::attack().
+		\param stimulus The index of the stimulus, in [0, stimulusCount).
+		\return The duration of the stimulus. */
+		virtual CX_Millis prepare(unsigned int stimulus) = 0;
+	};
+
+	/*! Settings for renderOffline(). */
+	struct OfflineRenderConfiguration {
+		OfflineRenderConfiguration(void) :
+			sampleRate(44100),
+			channels(1),
+			threads(0),
+			blockSize(4096),
+			clamp(true)
+		{}
+
+		float sampleRate; //!< The sample rate of the rendered sounds.
+		unsigned int channels; //!< The number of channels, each of which comes from OfflinePatch::getOutput().
+		unsigned int threads; //!< The number of worker threads, each of which builds its own patch. If 0, one thread per hardware thread is used.
+		unsigned int blockSize; //!< The number of samples that are requested from the patch at once.
+		bool clamp; //!< If `true`, samples are clamped to [-1, 1], like SoundBufferOutput does.
+	};
+
+	std::vector<CX_SoundBuffer> renderOffline(std::function<std::unique_ptr<OfflinePatch>(void)> makePatch, unsigned int stimulusCount,
+		const OfflineRenderConfiguration& config = OfflineRenderConfiguration());
+
 
 	/*! This class is used for numerically, rather than auditorily, testing other modules.
 	It produces samples starting at `value` and increasing by `step`. */
@@ -736,12 +1193,67 @@ namespace Synth {
 		ModuleParameter step; //!< The amount to change on each step.
 
 		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
+	};
+
+
+	/*! This class is the start of an oversampled region of a patch: It takes a signal at the sample rate of the modules
+	before it and interpolates it to `factor` times that rate, for use by the modules after it. The interpolation filter
+	is a linear phase windowed-sinc FIR filter in polyphase form, so only `tapsPerPhase` multiplications are done per output
+	sample. An oversampled region must end with a Downsampler with the same factor. See Downsampler for more information.
+
+	\code{.cpp}
+	using namespace CX::Synth;
+	SoundBufferInput input;
+	Upsampler up;
+	Clamper clip; //Hard clipping makes lots of harmonics.
+	Downsampler down;
+	SoundBufferOutput output;
+
+	up.setup(4);
+	down.setup(4);
+	clip.low = -0.5;
+	clip.high = 0.5;
+
+	input >> up >> clip >> down >> output;
+	\endcode
+
+	\ingroup modSynth */
+	class Upsampler : public ModuleBase {
+	public:
+
+		Upsampler(void);
+
+		void setup(unsigned int factor, unsigned int tapsPerPhase = 32);
+		unsigned int getFactor(void) const;
+		double getLatency(void) const;
+
+		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
+
+	private:
+
+		unsigned int _factor;
+		unsigned int _tapsPerPhase;
+		double _latency;
+		std::vector<double> _phaseCoefficients; //[phase][tap], with the taps of each phase reversed so that they line up with _history.
+		std::vector<float> _history; //The last _tapsPerPhase input samples, followed by new input samples.
+		unsigned int _phase; //The phase of the next output sample.
+
+		ModuleControlData_t _getDataForNeighbour(ModuleBase* neighbour) override;
+		ModuleControlData_t _getDataFromNeighbour(ModuleBase* neighbour, ModuleControlData_t d) override;
 	};
 
 
 	/*! This class is a start at implementing a Finite Impulse Response filter (http://en.wikipedia.org/wiki/Finite_impulse_response).
 	You can use it as a basic low-pass or high-pass	filter, or, if you supply your own coefficients, which cause the
 	filter to do filtering in whatever way you want. See the "signal" package for R for a method of constructing your own coefficients.
+
+	Filters with many coefficients can be very expensive to compute directly, so filters with at least 
+	FIRFilter::fftCoefficientThreshold coefficients are computed with a uniformly partitioned overlap-save 
+	FFT convolution. This produces the same output as direct convolution, but delayed by one partition 
+	(by default 256 samples). If the partition size is set to the buffer size of the sound stream the filter
+	is used with, the filter adds exactly one buffer of latency. See setup(std::vector<double>, ConvolutionMode, unsigned int).
 	\ingroup modSynth
 	*/
 	class FIRFilter : public ModuleBase{
@@ -763,15 +1275,28 @@ namespace Synth {
 			BLACKMAN
 		};
 
+		/*! The method used to perform the convolution of the input with the filter coefficients. */
+		enum class ConvolutionMode {
+			AUTOMATIC, //!< Use FFT convolution if there are at least `fftCoefficientThreshold` coefficients, otherwise direct convolution.
+			DIRECT, //!< Direct convolution. Costs one multiply-add per coefficient per sample, but adds no latency.
+			FFT //!< Partitioned overlap-save FFT convolution. Much cheaper for long filters, but adds one partition of latency.
+		};
+
+		static const unsigned int fftCoefficientThreshold = 256; //!< The number of coefficients at which ConvolutionMode::AUTOMATIC switches to FFT convolution.
+
 		FIRFilter(void);
 
 		void setup(FilterType filterType, unsigned int coefficientCount);
-		void setup(std::vector<double> coefficients);
+		void setup(std::vector<double> coefficients, ConvolutionMode mode = ConvolutionMode::AUTOMATIC, unsigned int partitionSize = 256);
+
+		bool usingFFT(void);
+		unsigned int getLatency(void);
 
 		void setCutoff(double cutoff);
 		void setBandCutoffs(double lower, double upper);
 
-		double getNextSample(void);
+		double getNextSample(void) override;
+		void processBlock(float* out, unsigned int frames) override;
 
 	private:
 
@@ -782,11 +1307,35 @@ namespace Synth {
 
 		std::vector<double> _coefficients;
 		std::deque<double> _inputSamples;
+		std::vector<double> _blockHistory; // _inputSamples followed by the samples of the current block.
 
 		double _calcH(int n, double omega);
 
 		void _applyWindowToCoefs(void);
 
+		//Partitioned FFT convolution
+		ConvolutionMode _convolutionMode;
+		bool _fftActive;
+		unsigned int _partitionSize;
+		unsigned int _fftSize;
+
+		std::vector<unsigned int> _bitReverse;
+		std::vector<std::complex<double>> _twiddles;
+		std::vector<std::complex<double>> _fftWork;
+
+		std::vector<std::vector<std::complex<double>>> _partitionSpectra; // The spectrum of each partition of the impulse response.
+		std::vector<std::vector<std::complex<double>>> _inputSpectra; // Frequency-domain delay line of the spectra of past input chunks.
+		unsigned int _inputSpectraPosition;
+
+		std::vector<double> _fftInput; // The previous and current chunks of input.
+		std::vector<float> _chunkOutput; // The output for the previous chunk of input.
+		unsigned int _chunkPosition;
+
+		void _prepareConvolution(void);
+		void _convolveFFT(float* data, unsigned int frames);
+		void _processChunk(void);
+		void _fft(std::complex<double>* data, bool inverse);
+
 	};
 
 } //namespace Synth
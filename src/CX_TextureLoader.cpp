@@ -0,0 +1,465 @@
+#include "CX_TextureLoader.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "ofImage.h"
+#include "ofGLUtils.h"
+
+#include "CX_Private.h" //glfwContext
+#include "CX_Logger.h"
+#include "CX_EventTrace.h"
+
+namespace CX {
+
+struct CX_TextureLoader::Item {
+	Item(void) :
+		id(0),
+		status(Status::QUEUED),
+		released(false),
+		textureId(0),
+		textureTarget(0),
+		fence(0)
+	{}
+
+	unsigned int id;
+	std::string filename; //Empty if the pixels were given directly.
+
+	//These are protected by the worker mutex.
+	Status status;
+	bool released;
+	ofPixels pixels;
+	GLuint textureId;
+	GLenum textureTarget;
+	GLsync fence; //Set by the worker after uploading. Waited on and deleted by the main thread.
+
+	ofTexture texture; //Only touched on the main thread.
+};
+
+struct CX_TextureLoader::Worker {
+	Worker(void) :
+		stop(false),
+		context(nullptr)
+	{}
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stop;
+
+	GLFWwindow* context; //If not null, the worker uploads textures in this context.
+
+	std::deque<std::shared_ptr<Item>> decodeQueue;
+	std::deque<std::shared_ptr<Item>> uploadQueue;
+};
+
+CX_TextureLoader::CX_TextureLoader(void) :
+	_sharedContext(nullptr),
+	_useSharedContext(false),
+	_nextId(0),
+	_pendingCount(0)
+{}
+
+CX_TextureLoader::~CX_TextureLoader(void) {
+	shutdown();
+}
+
+/*! Starts the worker thread and, if possible, makes the hidden GL context that it uploads textures with. This must
+be called from the main thread after the CX window has been opened. It is called by load() if needed.
+\return `false` if there is no GL context to share with, `true` otherwise. If the shared context could not be made, the
+loader still works, but textures are uploaded on the main thread. */
+bool CX_TextureLoader::setup(void) {
+	if (_worker) {
+		return true;
+	}
+
+	if (CX::Private::glfwContext == nullptr) {
+		CX::Instances::Log.error("CX_TextureLoader") << "setup(): There is no GL context. The texture loader must be set up after the window has been opened.";
+		return false;
+	}
+
+	_useSharedContext = false;
+	if (CX::Private::glFenceSyncSupported()) {
+		glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+		_sharedContext = glfwCreateWindow(1, 1, "", NULL, CX::Private::glfwContext);
+		glfwWindowHint(GLFW_VISIBLE, GL_TRUE);
+
+		if (_sharedContext) {
+			_useSharedContext = true;
+		} else {
+			CX::Instances::Log.warning("CX_TextureLoader") << "setup(): A shared GL context could not be made. Textures will be uploaded on the main thread.";
+		}
+	} else {
+		CX::Instances::Log.notice("CX_TextureLoader") << "setup(): Fence sync is not supported, so textures will be uploaded on the main thread.";
+	}
+
+	_worker = std::make_shared<Worker>();
+	_worker->context = _sharedContext;
+	_worker->thread = std::thread(&CX_TextureLoader::_workerLoop, this, _worker);
+
+	return true;
+}
+
+/*! Stops the worker thread, deletes all of the textures, and destroys the shared context. Images that were still being
+loaded are abandoned. */
+void CX_TextureLoader::shutdown(void) {
+	if (!_worker) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_worker->mutex);
+		_worker->stop = true;
+	}
+	_worker->condition.notify_all();
+	_worker->thread.join();
+	_worker.reset();
+
+	for (auto& it : _items) {
+		if (it.second->fence) {
+			glDeleteSync(it.second->fence);
+		}
+	}
+	_items.clear();
+	_pendingCount = 0;
+
+	if (_sharedContext) {
+		glfwDestroyWindow(_sharedContext);
+		_sharedContext = nullptr;
+	}
+	_useSharedContext = false;
+}
+
+/*! Returns `true` if setup() has been called successfully and shutdown() has not been called since. */
+bool CX_TextureLoader::isSetup(void) const {
+	return (bool)_worker;
+}
+
+/*! Returns `true` if textures are uploaded on the worker thread using a shared GL context, or `false` if they
+are uploaded on the main thread in update(). */
+bool CX_TextureLoader::usingSharedContext(void) const {
+	return _useSharedContext;
+}
+
+/*! Queues an image file to be loaded into a texture.
+\param filename The name of the file. Relative paths are relative to the data directory, as with `ofLoadImage()`.
+\return An id for the image that can be passed to the other functions of this class. */
+unsigned int CX_TextureLoader::load(std::string filename) {
+	std::shared_ptr<Item> item = std::make_shared<Item>();
+	item->filename = filename;
+	return _enqueue(item);
+}
+
+/*! Queues pixels that are already in memory, e.g. from Draw::gaborToPixels(), to be loaded into a texture.
+\param pixels The pixels, which are copied.
+\return An id for the image that can be passed to the other functions of this class. */
+unsigned int CX_TextureLoader::load(const ofPixels& pixels) {
+	std::shared_ptr<Item> item = std::make_shared<Item>();
+	item->pixels = pixels;
+	item->status = Status::DECODED;
+	return _enqueue(item);
+}
+
+unsigned int CX_TextureLoader::_enqueue(std::shared_ptr<Item> item) {
+	if (!setup()) {
+		item->status = Status::FAILED;
+	}
+
+	item->id = _nextId++;
+	_items[item->id] = item;
+
+	if (item->status == Status::FAILED) {
+		return item->id;
+	}
+
+	_pendingCount++;
+
+	if (item->status == Status::QUEUED) {
+		{
+			std::lock_guard<std::mutex> lock(_worker->mutex);
+			_worker->decodeQueue.push_back(item);
+		}
+		_worker->condition.notify_all();
+	}
+
+	return item->id;
+}
+
+/*! Moves images through the stages of loading that must happen on the main thread: allocating their textures, checking
+the fence syncs of uploads done on the worker thread and, without a shared context, uploading the pixel data. This must be
+called regularly from the main thread. It returns quickly when nothing is being loaded. */
+void CX_TextureLoader::update(void) {
+	if (!_worker || _pendingCount == 0) {
+		return;
+	}
+
+	std::vector<std::shared_ptr<Item>> toAllocate;
+	std::vector<std::shared_ptr<Item>> toCheck;
+	std::vector<unsigned int> toErase;
+
+	{
+		std::lock_guard<std::mutex> lock(_worker->mutex);
+		for (auto& it : _items) {
+			Item& item = *it.second;
+			if (item.status == Status::DECODED) {
+				toAllocate.push_back(it.second);
+			} else if (item.status == Status::UPLOADING && item.fence) {
+				toCheck.push_back(it.second);
+			} else if (item.released && (item.status == Status::READY || item.status == Status::FAILED)) {
+				toErase.push_back(it.first);
+			}
+		}
+	}
+
+	for (std::shared_ptr<Item>& item : toCheck) {
+		GLenum result = glClientWaitSync(item->fence, 0, 0);
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+			glDeleteSync(item->fence);
+
+			std::lock_guard<std::mutex> lock(_worker->mutex);
+			item->fence = 0;
+			item->status = Status::READY;
+			_pendingCount--;
+			if (item->released) {
+				toErase.push_back(item->id);
+			}
+		}
+	}
+
+	//Without a shared context, the pixel data is uploaded here. Upload at least one image per call,
+	//but stop after a couple of milliseconds so that the frame being drawn is not delayed too much.
+	CX_Millis deadline = CX::Instances::Clock.now() + CX_Millis(2);
+	bool uploadedOne = false;
+
+	for (std::shared_ptr<Item>& item : toAllocate) {
+		if (item->released) {
+			std::lock_guard<std::mutex> lock(_worker->mutex);
+			item->status = Status::FAILED;
+			_pendingCount--;
+			toErase.push_back(item->id);
+			continue;
+		}
+
+		if (!_useSharedContext) {
+			if (uploadedOne && CX::Instances::Clock.now() >= deadline) {
+				break;
+			}
+			uploadedOne = _uploadOnMainThread(*item) || uploadedOne;
+			continue;
+		}
+
+		//Only the storage is made here: allocate(const ofPixels&) would also upload the pixels, which is the worker's job.
+		item->texture.allocate(item->pixels.getWidth(), item->pixels.getHeight(), ofGetGlInternalFormat(item->pixels));
+		glFlush(); //Make sure that the texture exists before the worker context uses it.
+
+		{
+			std::lock_guard<std::mutex> lock(_worker->mutex);
+			item->textureId = item->texture.getTextureData().textureID;
+			item->textureTarget = item->texture.getTextureData().textureTarget;
+			item->status = Status::UPLOADING;
+			_worker->uploadQueue.push_back(item);
+		}
+		_worker->condition.notify_all();
+	}
+
+	for (unsigned int id : toErase) {
+		_items.erase(id);
+	}
+}
+
+bool CX_TextureLoader::_uploadOnMainThread(Item& item) {
+	item.texture.allocate(item.pixels.getWidth(), item.pixels.getHeight(), ofGetGlInternalFormat(item.pixels));
+	item.texture.loadData(item.pixels);
+
+	std::lock_guard<std::mutex> lock(_worker->mutex);
+	item.pixels.clear();
+	item.status = Status::READY;
+	_pendingCount--;
+	return true;
+}
+
+/*! Returns the status of the image with the given id. */
+CX_TextureLoader::Status CX_TextureLoader::getStatus(unsigned int id) const {
+	auto it = _items.find(id);
+	if (it == _items.end()) {
+		return Status::UNKNOWN;
+	}
+
+	if (!_worker) {
+		return it->second->status;
+	}
+
+	std::lock_guard<std::mutex> lock(_worker->mutex);
+	return it->second->status;
+}
+
+/*! Returns `true` if the texture of the image with the given id can be used. */
+bool CX_TextureLoader::isReady(unsigned int id) const {
+	return getStatus(id) == Status::READY;
+}
+
+/*! Waits until the image with the given id is loaded, calling update() while waiting. Must be called from the main thread.
+\param id The id of the image.
+\param timeout The longest time to wait.
+\return `true` if the texture is ready, `false` if the image could not be loaded or the timeout expired. */
+bool CX_TextureLoader::waitUntilReady(unsigned int id, CX_Millis timeout) {
+	CX_Millis deadline = CX::Instances::Clock.now() + timeout;
+
+	while (true) {
+		update();
+
+		Status status = getStatus(id);
+		if (status == Status::READY) {
+			return true;
+		} else if (status == Status::FAILED || status == Status::UNKNOWN) {
+			return false;
+		}
+
+		if (CX::Instances::Clock.now() >= deadline) {
+			CX::Instances::Log.warning("CX_TextureLoader") << "waitUntilReady(): Timed out waiting for image " << id << ".";
+			return false;
+		}
+		CX::Instances::Clock.sleep(CX_Millis(1));
+	}
+}
+
+/*! Waits until all of the images that have been queued are loaded or have failed to load, calling update() while waiting.
+Must be called from the main thread.
+\param timeout The longest time to wait.
+\return `true` if nothing is left to load, `false` if the timeout expired. */
+bool CX_TextureLoader::waitUntilAllReady(CX_Millis timeout) {
+	CX_Millis deadline = CX::Instances::Clock.now() + timeout;
+
+	while (true) {
+		update();
+
+		if (_pendingCount == 0) {
+			return true;
+		}
+
+		if (CX::Instances::Clock.now() >= deadline) {
+			CX::Instances::Log.warning("CX_TextureLoader") << "waitUntilAllReady(): Timed out with " << _pendingCount.load() << " images still loading.";
+			return false;
+		}
+		CX::Instances::Clock.sleep(CX_Millis(1));
+	}
+}
+
+/*! Returns the number of images that are still being loaded. This can be checked from any thread. */
+unsigned int CX_TextureLoader::getPendingCount(void) const {
+	return _pendingCount;
+}
+
+/*! Returns the texture of the image with the given id. If the texture is not ready (see isReady()), an error is logged
+and an unallocated texture is returned. */
+ofTexture& CX_TextureLoader::getTexture(unsigned int id) {
+	Status status = getStatus(id);
+	if (status != Status::READY) {
+		CX::Instances::Log.error("CX_TextureLoader") << "getTexture(): The texture for image " << id << " is not ready.";
+		return _emptyTexture;
+	}
+	return _items[id]->texture;
+}
+
+/*! Deletes the texture of the image with the given id. If the image is still being loaded, it is deleted once that is done.
+Must be called from the main thread. */
+void CX_TextureLoader::release(unsigned int id) {
+	auto it = _items.find(id);
+	if (it == _items.end()) {
+		return;
+	}
+
+	if (!_worker) {
+		_items.erase(it);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(_worker->mutex);
+	Status status = it->second->status;
+	if (status == Status::READY || status == Status::FAILED) {
+		_items.erase(it);
+	} else {
+		it->second->released = true;
+	}
+}
+
+/*! Releases all of the textures. See release(). */
+void CX_TextureLoader::clear(void) {
+	std::vector<unsigned int> ids;
+	for (auto& it : _items) {
+		ids.push_back(it.first);
+	}
+	for (unsigned int id : ids) {
+		release(id);
+	}
+}
+
+void CX_TextureLoader::_workerLoop(std::shared_ptr<Worker> worker) {
+	CX::Instances::EventTrace.nameThread("CX texture loader");
+
+	if (worker->context) {
+		glfwMakeContextCurrent(worker->context);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	}
+
+	std::unique_lock<std::mutex> lock(worker->mutex);
+	while (!worker->stop) {
+		if (worker->decodeQueue.empty() && worker->uploadQueue.empty()) {
+			worker->condition.wait(lock);
+			continue;
+		}
+
+		//Uploads are done first so that decoded pixels do not pile up in memory.
+		if (!worker->uploadQueue.empty()) {
+			std::shared_ptr<Item> item = worker->uploadQueue.front();
+			worker->uploadQueue.pop_front();
+			lock.unlock();
+
+			//The pixel data is copied by the driver before glTexSubImage2D returns, so it can be freed right away.
+			glBindTexture(item->textureTarget, item->textureId);
+			glTexSubImage2D(item->textureTarget, 0, 0, 0, item->pixels.getWidth(), item->pixels.getHeight(),
+				ofGetGlFormat(item->pixels), ofGetGlType(item->pixels), item->pixels.getPixels());
+			glBindTexture(item->textureTarget, 0);
+
+			GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush(); //The fence must be flushed or the main context may never see it signalled.
+
+			lock.lock();
+			item->pixels.clear();
+			item->fence = fence;
+			continue;
+		}
+
+		std::shared_ptr<Item> item = worker->decodeQueue.front();
+		worker->decodeQueue.pop_front();
+		if (item->released) {
+			item->status = Status::DECODED; //The main thread finishes releasing it.
+			continue;
+		}
+		lock.unlock();
+
+		ofPixels pixels;
+		bool loaded = ofLoadImage(pixels, item->filename);
+		if (!loaded) {
+			CX::Instances::Log.error("CX_TextureLoader") << "Image file \"" << item->filename << "\" could not be loaded.";
+		}
+
+		lock.lock();
+		if (loaded) {
+			item->pixels = std::move(pixels);
+			item->status = Status::DECODED;
+		} else {
+			item->status = Status::FAILED;
+			_pendingCount--;
+		}
+	}
+	lock.unlock();
+
+	if (worker->context) {
+		glFinish();
+		glfwMakeContextCurrent(NULL);
+	}
+}
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <map>
+#include <deque>
+#include <memory>
+#include <string>
+#include <atomic>
+
+#include "ofPixels.h"
+#include "ofTexture.h"
+
+#include "CX_Clock.h"
+
+struct GLFWwindow;
+
+namespace CX {
+
+	/*! This class loads images into textures on a background thread so that large sets of image stimuli can be loaded
+	while something else is being shown, like instructions, instead of stalling the main thread while each image is decoded and
+	uploaded. Images are decoded from file on a worker thread. If possible, the worker thread has its own hidden GL context
+	that shares textures with the main context, in which case the pixel data is also uploaded to video memory on the worker thread
+	and a fence sync is used to find out when the upload is complete. If a shared context cannot be made, or if fence sync is not
+	supported, the upload is done on the main thread in update(), a little at a time.
+
+	Textures are only allocated, and only become usable, on the main thread in update(), which must therefore be called regularly.
+	CX_Display::beginDrawingToBackBuffer() and CX_SlidePresenter::update() call update() for the texture loader of the display
+	(see CX_Display::getTextureLoader()), so normally you don't need to call it yourself.
+
+	\code{.cpp}
+	CX_TextureLoader& loader = Disp.getTextureLoader();
+
+	std::vector<unsigned int> ids;
+	for (std::string file : imageFiles) {
+		ids.push_back(loader.load(file));
+	}
+
+	//Show instructions while the images load...
+
+	loader.waitUntilAllReady(CX_Seconds(30));
+
+	for (unsigned int id : ids) {
+		SlidePresenter.appendSlideTexture(id, CX_Millis(500));
+	}
+	\endcode
+
+	The textures belong to the loader until they are released with release() or clear().
+	\ingroup video
+	*/
+	class CX_TextureLoader {
+	public:
+
+		/*! The status of an image that was given to load(). */
+		enum class Status {
+			QUEUED, //!< The image is waiting to be decoded.
+			DECODED, //!< The image has been decoded and is waiting for its texture to be allocated on the main thread.
+			UPLOADING, //!< The pixel data is being uploaded to the texture.
+			READY, //!< The texture can be used.
+			FAILED, //!< The image could not be loaded. The reason is logged.
+			UNKNOWN //!< The id does not belong to an image in the loader.
+		};
+
+		CX_TextureLoader(void);
+		~CX_TextureLoader(void);
+
+		bool setup(void);
+		void shutdown(void);
+		bool isSetup(void) const;
+		bool usingSharedContext(void) const;
+
+		unsigned int load(std::string filename);
+		unsigned int load(const ofPixels& pixels);
+
+		void update(void);
+
+		Status getStatus(unsigned int id) const;
+		bool isReady(unsigned int id) const;
+		bool waitUntilReady(unsigned int id, CX_Millis timeout);
+		bool waitUntilAllReady(CX_Millis timeout);
+		unsigned int getPendingCount(void) const;
+
+		ofTexture& getTexture(unsigned int id);
+
+		void release(unsigned int id);
+		void clear(void);
+
+	private:
+
+		struct Item;
+		struct Worker;
+
+		std::shared_ptr<Worker> _worker;
+		GLFWwindow* _sharedContext;
+		bool _useSharedContext;
+
+		std::map<unsigned int, std::shared_ptr<Item>> _items;
+		unsigned int _nextId;
+
+		ofTexture _emptyTexture;
+
+		std::atomic<unsigned int> _pendingCount;
+
+		unsigned int _enqueue(std::shared_ptr<Item> item);
+		void _workerLoop(std::shared_ptr<Worker> worker);
+		bool _uploadOnMainThread(Item& item);
+	};
+
+}
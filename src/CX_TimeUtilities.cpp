@@ -1,21 +1,47 @@
 #include "CX_TimeUtilities.h"
 
+#include <algorithm>
+
 namespace CX {
 namespace Util {
 
+	//Returns the `p` quantile, with p in [0, 1], of the stored durations, using the nearest rank.
+	static double storedDurationPercentile(std::vector<double> durations, double p) {
+		if (durations.empty()) {
+			return 0;
+		}
+		p = std::min(std::max(p, 0.0), 1.0);
+		size_t rank = std::max<size_t>((size_t)(p * durations.size() + 0.5), 1) - 1;
+		std::nth_element(durations.begin(), durations.begin() + rank, durations.end());
+		return durations[rank];
+	}
+
+	//In streaming mode, the histogram estimate is kept within the exactly known range of the durations.
+	static CX_Millis streamingPercentile(const Private::CX_StatisticsAccumulator& stats, const Private::CX_DurationHistogram& histogram, double p) {
+		if (stats.count() == 0) {
+			return CX_Millis(0);
+		}
+		double ms = CX_Nanos(histogram.quantile(p)).millis();
+		return CX_Millis(std::min(std::max(ms, stats.min()), stats.max()));
+	}
+
 	/////////////////
 	// CX_LapTimer //
 	/////////////////
 
 	CX_LapTimer::CX_LapTimer(void) :
+		name(""),
 		_clock(nullptr),
-		_samplesBetweenLogging(0),
-		name("")
+		_streaming(false),
+		_hasLastTimePoint(false),
+		_samplesBetweenLogging(0)
 	{}
 
 	/*! Construct and set up a CX_LapTimer. See CX_LapTimer::setup() for a description of the parameters. */
 	CX_LapTimer::CX_LapTimer(CX_Clock *clock, unsigned int logSamples) :
-		name("")
+		name(""),
+		_streaming(false),
+		_hasLastTimePoint(false)
 	{
 		setup(clock, logSamples);
 	}
@@ -36,11 +62,56 @@ namespace Util {
 	void CX_LapTimer::restart(void) {
 		_durationRecalculationRequired = true;
 		_timePoints.clear();
+		_durations.clear();
+
+		_hasLastTimePoint = false;
+		_stats.reset();
+		_histogram.reset();
+	}
+
+	/*! Sets whether the lap times are stored or summarized as they are taken.
+
+	In streaming mode, each lap time is added to a running mean, standard deviation, minimum, and maximum, and
+	is counted in a histogram from which percentiles are estimated. Only the time of the last sample is kept, so
+	the memory used does not grow however many samples are taken, and recording a sample does not allocate memory.
+	mean(), min(), max(), and stdDev() are the same as when the lap times are stored. percentile() is estimated
+	to within about 1%.
+
+	Changing the mode restarts data collection.
+	\param streaming If `true`, lap times are summarized as they are taken. If `false` (the default), they are stored. */
+	void CX_LapTimer::setStreaming(bool streaming) {
+		_streaming = streaming;
+		if (_streaming) {
+			_histogram.allocate();
+		}
+		restart();
+	}
+
+	/*! Returns `true` if the lap timer is in streaming mode. See setStreaming(). */
+	bool CX_LapTimer::isStreaming(void) const {
+		return _streaming;
 	}
 
 	/*! Take a single sample of time. If at least one previous sample has been taken, the difference 
 	between the current time and the previous time is stored as the duration of that "lap" through the code. */
 	void CX_LapTimer::takeSample(void) {
+		if (_streaming) {
+			CX_Millis now = _clock->now();
+			if (_hasLastTimePoint) {
+				CX_Millis duration = now - _lastTimePoint;
+				_stats.add(duration.millis());
+				_histogram.add(duration.nanos());
+			}
+			_lastTimePoint = now;
+			_hasLastTimePoint = true;
+
+			if ((_samplesBetweenLogging != 0) && (_stats.count() + 1 == _samplesBetweenLogging)) {
+				CX::Instances::Log.notice("CX_LapTimer") << "Stats for last " << _samplesBetweenLogging << " samples." << getStatString();
+				restart();
+			}
+			return;
+		}
+
 		_timePoints.push_back(_clock->now());
 		_durationRecalculationRequired = true;
 
@@ -52,6 +123,9 @@ namespace Util {
 
 	/*! Returns the number of lap durations that have been collected. */
 	unsigned int CX_LapTimer::collectedSamples(void) {
+		if (_streaming) {
+			return (unsigned int)_stats.count();
+		}
 		if (_timePoints.size() == 0) {
 			return 0;
 		}
@@ -69,7 +143,8 @@ namespace Util {
 		}
 
 		s << "Range: " << this->min() << ", " << this->max() << " ms" << std::endl <<
-			"Mean (SD): " << this->mean() << " (" << this->stdDev() << ") ms" << std::endl;
+			"Mean (SD): " << this->mean() << " (" << this->stdDev() << ") ms" << std::endl <<
+			"Median, 95th, 99th percentile: " << this->percentile(0.5) << ", " << this->percentile(0.95) << ", " << this->percentile(0.99) << " ms" << std::endl;
 
 		return s.str();
 	}
@@ -77,28 +152,50 @@ namespace Util {
 
 	/*! \brief Get the mean value of the stored lap times. */
 	CX_Millis CX_LapTimer::mean(void) {
+		if (_streaming) {
+			return CX_Millis(_stats.mean());
+		}
 		_calculateDurations();
 		return Util::mean(_durations);
 	}
 
 	/*! \brief Get the longest stored lap time. */
 	CX_Millis CX_LapTimer::max(void) {
+		if (_streaming) {
+			return CX_Millis(_stats.max());
+		}
 		_calculateDurations();
 		return Util::max(_durations);
 	}
 
 	/*! \brief Get the shortest stored lap time. */
 	CX_Millis CX_LapTimer::min(void) {
+		if (_streaming) {
+			return CX_Millis(_stats.min());
+		}
 		_calculateDurations();
 		return Util::min(_durations);
 	}
 
 	/*! \brief Get the standard deviation of the stored lap times. */
 	CX_Millis CX_LapTimer::stdDev(void) {
+		if (_streaming) {
+			return CX_Millis(_stats.standardDeviation());
+		}
 		_calculateDurations();
 		return CX_Millis(sqrt(Util::var(_durations)));
 	}
 
+	/*! Get a percentile of the lap times. In streaming mode, this is an estimate (see setStreaming()).
+	\param p The proportion of lap times that are shorter than the returned time, in the interval [0, 1]. For example, 0.5 gives the median. */
+	CX_Millis CX_LapTimer::percentile(double p) {
+		if (_streaming) {
+			return streamingPercentile(_stats, _histogram, p);
+		}
+		_calculateDurations();
+		return CX_Millis(storedDurationPercentile(_durations, p));
+	}
+
 	void CX_LapTimer::_calculateDurations(void) {
 		if (_timePoints.size() < 2 || !_durationRecalculationRequired) {
 			return;
@@ -116,9 +213,10 @@ namespace Util {
 	///////////////////////
 
 	CX_SegmentProfiler::CX_SegmentProfiler(void) :
+		name(""),
 		_clock(nullptr),
 		_samplesBetweenLogging(0),
-		name("")
+		_streaming(false)
 	{}
 
 	/*! Set up the CX_SegmentProfiler with the selected clock source and the number of samples to log between each automatic logging of results.
@@ -127,9 +225,10 @@ namespace Util {
 	about the last `logSamples` samples will be logged and then those samples will be cleared.
 	*/
 	CX_SegmentProfiler::CX_SegmentProfiler(CX_Clock* clock, unsigned int logSamples) :
+		name(""),
 		_clock(clock),
 		_samplesBetweenLogging(logSamples),
-		name("")
+		_streaming(false)
 	{}
 
 	/*! Set up the CX_SegmentProfiler with the selected clock source and the number of samples to log between each automatic logging of results.
@@ -152,8 +251,15 @@ namespace Util {
 	If enough samples have been collected, equal to the value of `logSamples` during setup(), a
 	summary statistics string will be automatically logged. */
 	void CX_SegmentProfiler::t2(void) {
-		_durations.push_back((_clock->now() - _t1).value());
-		if ((_samplesBetweenLogging != 0) && (_durations.size() == _samplesBetweenLogging)) {
+		CX_Millis duration = _clock->now() - _t1;
+		if (_streaming) {
+			_stats.add(duration.millis());
+			_histogram.add(duration.nanos());
+		} else {
+			_durations.push_back(duration.value());
+		}
+
+		if ((_samplesBetweenLogging != 0) && (collectedSamples() == _samplesBetweenLogging)) {
 			CX::Instances::Log.notice("CX_SegmentProfiler") << "Stats for last " << _samplesBetweenLogging << " samples." << getStatString();
 			restart();
 		}
@@ -161,34 +267,76 @@ namespace Util {
 
 	/*! \return The number of collected samples. */
 	unsigned int CX_SegmentProfiler::collectedSamples(void) {
+		if (_streaming) {
+			return (unsigned int)_stats.count();
+		}
 		return _durations.size();
 	}
 
 	/*! Restart data collection. All collected samples are cleared. */
 	void CX_SegmentProfiler::restart(void) {
 		_durations.clear();
+		_stats.reset();
+		_histogram.reset();
+	}
+
+	/*! Sets whether the segment durations are stored or summarized as they are measured. This works
+	the same way as CX_LapTimer::setStreaming(). Changing the mode restarts data collection.
+	\param streaming If `true`, durations are summarized as they are measured. If `false` (the default), they are stored. */
+	void CX_SegmentProfiler::setStreaming(bool streaming) {
+		_streaming = streaming;
+		if (_streaming) {
+			_histogram.allocate();
+		}
+		restart();
+	}
+
+	/*! Returns `true` if the profiler is in streaming mode. See setStreaming(). */
+	bool CX_SegmentProfiler::isStreaming(void) const {
+		return _streaming;
 	}
 
 	/*! \brief Get the mean of the stored segment durations. */
 	CX_Millis CX_SegmentProfiler::mean(void) {
+		if (_streaming) {
+			return CX_Millis(_stats.mean());
+		}
 		return Util::mean(_durations);
 	}
 
 	/*! \brief Get the longest of the stored segment durations. */
 	CX_Millis CX_SegmentProfiler::max(void) {
+		if (_streaming) {
+			return CX_Millis(_stats.max());
+		}
 		return Util::max(_durations);
 	}
 
 	/*! \brief Get the shortest of the stored segment durations. */
 	CX_Millis CX_SegmentProfiler::min(void) {
+		if (_streaming) {
+			return CX_Millis(_stats.min());
+		}
 		return Util::min(_durations);
 	}
 
 	/*! \brief Get the standard deviation of the stored segment durations. */
 	CX_Millis CX_SegmentProfiler::stdDev(void) {
+		if (_streaming) {
+			return CX_Millis(_stats.standardDeviation());
+		}
 		return CX_Millis(sqrt(Util::var(_durations)));
 	}
 
+	/*! Get a percentile of the segment durations. In streaming mode, this is an estimate (see CX_LapTimer::setStreaming()).
+	\param p The proportion of durations that are shorter than the returned time, in the interval [0, 1]. For example, 0.5 gives the median. */
+	CX_Millis CX_SegmentProfiler::percentile(double p) {
+		if (_streaming) {
+			return streamingPercentile(_stats, _histogram, p);
+		}
+		return CX_Millis(storedDurationPercentile(_durations, p));
+	}
+
 	/*! Get a string summarizing some basic descriptive statistics for the currently stored data.
 	\return A string containing the minimum, mean, maximum, and standard deviation, in ms, of the stored data.
 	*/
@@ -200,7 +348,8 @@ namespace Util {
 		}
 
 		s << "Range: " << this->min() << ", " << this->max() << " ms" << std::endl <<
-			"Mean (SD): " << this->mean() << " (" << this->stdDev() << ") ms" << std::endl;
+			"Mean (SD): " << this->mean() << " (" << this->stdDev() << ") ms" << std::endl <<
+			"Median, 95th, 99th percentile: " << this->percentile(0.5) << ", " << this->percentile(0.95) << ", " << this->percentile(0.99) << " ms" << std::endl;
 
 		return s.str();
 	}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "CX_Clock.h"
+#include "CX_StatisticsAccumulator.h"
+#include "CX_DurationHistogram.h"
 
 namespace CX {
 namespace Util {
@@ -24,6 +26,10 @@ namespace Util {
 
 	\endcode
 
+	By default, every lap time is stored until restart() is called. For profiling that stays on for a whole session,
+	call \ref setStreaming() "setStreaming(true)": the lap times are then summarized as they are taken, so memory use
+	does not grow and taking a sample costs about the same as reading the clock. See setStreaming() for details.
+
 	\ingroup timing
 	*/
 	class CX_LapTimer {
@@ -38,10 +44,14 @@ namespace Util {
 		void takeSample(void);
 		unsigned int collectedSamples(void);
 
+		void setStreaming(bool streaming);
+		bool isStreaming(void) const;
+
 		CX_Millis mean(void);
 		CX_Millis min(void);
 		CX_Millis max(void);
 		CX_Millis stdDev(void);
+		CX_Millis percentile(double p);
 
 		std::string getStatString(void);
 
@@ -52,6 +62,12 @@ namespace Util {
 		std::vector<CX_Millis> _timePoints;
 		std::vector<double> _durations;
 
+		bool _streaming;
+		CX_Millis _lastTimePoint;
+		bool _hasLastTimePoint;
+		Private::CX_StatisticsAccumulator _stats;
+		Private::CX_DurationHistogram _histogram;
+
 		unsigned int _samplesBetweenLogging;
 
 		void _calculateDurations(void);
@@ -82,6 +98,9 @@ namespace Util {
 	std::cout << profiler.getStatString() << std::endl;
 
 	\endcode
+
+	Like CX_LapTimer, this class can summarize the durations as they are measured instead of storing them.
+	See setStreaming().
 	\ingroup timing
 	*/
 	class CX_SegmentProfiler {
@@ -99,12 +118,16 @@ namespace Util {
 
 		void restart(void);
 
+		void setStreaming(bool streaming);
+		bool isStreaming(void) const;
+
 		std::string getStatString(void);
 
 		CX_Millis mean(void);
 		CX_Millis min(void);
 		CX_Millis max(void);
 		CX_Millis stdDev(void);
+		CX_Millis percentile(double p);
 
 		std::string name; //!< If this is set, it will be printed at the start of the string returned by getStatString() and in automatically logged messages.
 
@@ -115,6 +138,10 @@ namespace Util {
 		CX_Millis _t1;
 		std::vector<double> _durations;
 
+		bool _streaming;
+		Private::CX_StatisticsAccumulator _stats;
+		Private::CX_DurationHistogram _histogram;
+
 	};
 }
 }
\ No newline at end of file
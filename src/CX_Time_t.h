@@ -1,6 +1,11 @@
 #pragma once
 
 #include <chrono>
+#include <ratio>
+#include <limits>
+#include <cstdint>
+#include <cmath>
+#include <type_traits>
 
 namespace CX {
 
@@ -16,24 +21,33 @@ namespace CX {
 	typedef CX_Time_t<std::ratio<1, 1000000000> > CX_Nanos; //!< Nanoseconds.
 
 	namespace Private {
-		template<typename tOut, typename tIn, typename resultT>
-		inline resultT convertTimeCount(resultT countIn) {
-			return countIn * (((double)tIn::num * tOut::den) / ((double)tIn::den * tOut::num));
-		}
+		//The factor that converts a count in tIn units to a count in tOut units, reduced at compile time.
+		template<typename tOut, typename tIn>
+		struct TimeConversion {
+			typedef std::ratio_divide<tIn, tOut> ratio;
+			static constexpr cxTick_t num = ratio::num;
+			static constexpr cxTick_t den = ratio::den;
+		};
 
-		template<>
-		inline cxTick_t convertTimeCount<std::nano, std::nano, cxTick_t>(cxTick_t countIn) {
-			return countIn;
+		//Integer counts are converted with integer arithmetic only. When one side of the ratio is 1, which is
+		//the case for all of the conversions to and from nanoseconds, this is a single multiplication or division.
+		template<typename tOut, typename tIn, typename resultT>
+		constexpr typename std::enable_if<std::is_integral<resultT>::value, resultT>::type convertTimeCount(resultT countIn) {
+			return (TimeConversion<tOut, tIn>::den == 1) ? countIn * TimeConversion<tOut, tIn>::num :
+				(TimeConversion<tOut, tIn>::num == 1) ? countIn / TimeConversion<tOut, tIn>::den :
+				countIn * TimeConversion<tOut, tIn>::num / TimeConversion<tOut, tIn>::den;
 		}
 
-		template<>
-		inline cxTick_t convertTimeCount<std::micro, std::micro, cxTick_t>(cxTick_t countIn) {
-			return countIn;
+		template<typename tOut, typename tIn, typename resultT>
+		constexpr typename std::enable_if<std::is_floating_point<resultT>::value, resultT>::type convertTimeCount(resultT countIn) {
+			return (TimeConversion<tOut, tIn>::den == 1) ? countIn * TimeConversion<tOut, tIn>::num :
+				(TimeConversion<tOut, tIn>::num == 1) ? countIn / TimeConversion<tOut, tIn>::den :
+				countIn * ((resultT)TimeConversion<tOut, tIn>::num / TimeConversion<tOut, tIn>::den);
 		}
 
-		template<>
-		inline cxTick_t convertTimeCount<std::milli, std::milli, cxTick_t>(cxTick_t countIn) {
-			return countIn;
+		//Rounds to the nearest nanosecond, rather than truncating, so that e.g. CX_Millis(0.1) is exactly 100000 ns.
+		constexpr cxTick_t roundToTicks(double nanos) {
+			return (cxTick_t)(nanos < 0 ? nanos - 0.5 : nanos + 0.5);
 		}
 	}
 
@@ -51,6 +65,10 @@ namespace CX {
 	
 	CX_Time_t has at most nanosecond accuracy. The contents of any of the templated 
 	versions of CX_Time_t are all stored in nanoseconds, so conversion between time types is lossless.
+	Conversions between units are worked out at compile time and times constructed from integers, added, subtracted,
+	compared, or multiplied or divided by integers never go through floating point. Values constructed from
+	floating point numbers are rounded to the nearest nanosecond. Everything other than the assignment operators
+	is `constexpr`, so times can be used in constant expressions.
 
 	See this example for a varity of things you can do with this class.
 	\code{.cpp}
@@ -116,29 +134,29 @@ namespace CX {
 		\return A PartitionedTime struct containing whole number amounts of the components of the time.
 		*/
 		PartitionedTime getPartitionedTime(void) const {
-			CX_Time_t<TimeUnit> t = *this; //Make a copy which is then modified.
+			cxTick_t t = _nanos;
 			PartitionedTime rval;
-			rval.hours = floor(t.hours());
-			t -= CX_Hours(rval.hours);
+			rval.hours = (int)_floorDivide(t, 3600000000000LL);
+			t -= rval.hours * 3600000000000LL;
 
-			rval.minutes = floor(t.minutes());
-			t -= CX_Minutes(rval.minutes);
+			rval.minutes = (int)_floorDivide(t, 60000000000LL);
+			t -= rval.minutes * 60000000000LL;
 
-			rval.seconds = floor(t.seconds());
-			t -= CX_Seconds(rval.seconds);
+			rval.seconds = (int)_floorDivide(t, 1000000000LL);
+			t -= rval.seconds * 1000000000LL;
 
-			rval.milliseconds = floor(t.millis());
-			t -= CX_Millis(rval.milliseconds);
+			rval.milliseconds = (int)(t / 1000000);
+			t -= rval.milliseconds * 1000000LL;
 
-			rval.microseconds = floor(t.micros());
-			t -= CX_Micros(rval.microseconds);
+			rval.microseconds = (int)(t / 1000);
+			t -= rval.microseconds * 1000LL;
 
-			rval.nanoseconds = t.nanos();
+			rval.nanoseconds = (int)t;
 			return rval;
 		}
 
 		/*! Default constructor for CX_Time_t. */
-		CX_Time_t(void) :
+		constexpr CX_Time_t(void) :
 			_nanos(0)
 		{}
 
@@ -152,19 +170,19 @@ namespace CX {
 		CX_Seconds oneMinute(60); //Interpreted as 60 seconds
 		\endcode
 		*/
-		CX_Time_t(double t) {
-			_nanos = (cxTick_t)Private::convertTimeCount<std::nano, TimeUnit, double>(t);
-		}
+		constexpr CX_Time_t(double t) :
+			_nanos(Private::roundToTicks(Private::convertTimeCount<std::nano, TimeUnit, double>(t)))
+		{}
 
 		/*! \copydoc CX_Time_t::CX_Time_t(double) */
-		CX_Time_t(int t) {
-			_nanos = Private::convertTimeCount<std::nano, TimeUnit, cxTick_t>(t);
-		}
+		constexpr CX_Time_t(int t) :
+			_nanos(Private::convertTimeCount<std::nano, TimeUnit, cxTick_t>(t))
+		{}
 
 		/*! \copydoc CX_Time_t::CX_Time_t(double) */
-		CX_Time_t(cxTick_t t) {
-			_nanos = Private::convertTimeCount<std::nano, TimeUnit, cxTick_t>(t);
-		}
+		constexpr CX_Time_t(cxTick_t t) :
+			_nanos(Private::convertTimeCount<std::nano, TimeUnit, cxTick_t>(t))
+		{}
 
 		/*! Constructs a CX_Time_t based on another instance of a CX_Time_t. If the TimeUnit
 		template parameter has a different value for `t` than for the CX_Time_t being constructed,
@@ -172,79 +190,86 @@ namespace CX {
 		(i.e. CX_Minutes) containing 1 minute, and the CX_Time_t that is constructed will contain 1 minute 
 		regardless of if that minute is thought of as 1/60 of an hour or 60,000,000 microseconds. */
 		template <typename tArg>
-		CX_Time_t(const CX_Time_t<tArg>& t) {
-			this->_nanos = t.nanos();
-		}
+		constexpr CX_Time_t(const CX_Time_t<tArg>& t) :
+			_nanos(t.nanos())
+		{}
 
 		/*! Get the numerical value of the time in units of the time type. For example, if
 		you are using an instance of CX_Seconds, this will return the time value in seconds,
 		including fractional seconds. */
-		double value(void) const {
+		constexpr double value(void) const {
 			return Private::convertTimeCount<TimeUnit, std::nano, double>(_nanos);
 		}
 
 		/*! \brief Get the time stored by this CX_Time_t in hours, including fractions of an hour. */
-		double hours(void) const {
+		constexpr double hours(void) const {
 			return (double)_nanos / (1e9 * 60 * 60);
 		}
 
 		/*! \brief Get the time stored by this CX_Time_t in minutes, including fractions of a minute. */
-		double minutes(void) const {
+		constexpr double minutes(void) const {
 			return (double)_nanos / (1e9 * 60);
 		}
 
 		/*! \brief Get the time stored by this CX_Time_t in seconds, including fractions of a second. */
-		double seconds(void) const {
+		constexpr double seconds(void) const {
 			return (double)_nanos / 1e9;
 		}
 
 		/*! \brief Get the time stored by this CX_Time_t in milliseconds, including fractions of a millisecond. */
-		double millis(void) const {
+		constexpr double millis(void) const {
 			return (double)_nanos / 1e6;
 		}
 
 		/*! \brief Get the time stored by this CX_Time_t in microseconds, including fractions of a microsecond. */
-		double micros(void) const {
+		constexpr double micros(void) const {
 			return (double)_nanos / 1e3;
 		}
 
 		/*! \brief Get the time stored by this CX_Time_t in nanoseconds. */
-		cxTick_t nanos(void) const {
+		constexpr cxTick_t nanos(void) const {
 			return _nanos;
 		}
 
 		/*! \brief Adds together two times. */
 		template<typename RT>
-		CX_Time_t<TimeUnit> operator+(const CX_Time_t<RT>& rhs) const {
-			CX_Time_t<TimeUnit> temp(0);
-			temp._nanos = this->_nanos + rhs.nanos();
-			return temp;
+		constexpr CX_Time_t<TimeUnit> operator+(const CX_Time_t<RT>& rhs) const {
+			return fromNanos(this->_nanos + rhs.nanos());
 		}
 
 		/*! \brief Subtracts two times. */
 		template<typename RT>
-		CX_Time_t<TimeUnit> operator-(const CX_Time_t<RT>& rhs) const {
-			CX_Time_t<TimeUnit> temp(0);
-			temp._nanos = this->_nanos - rhs.nanos();
-			return temp;
+		constexpr CX_Time_t<TimeUnit> operator-(const CX_Time_t<RT>& rhs) const {
+			return fromNanos(this->_nanos - rhs.nanos());
+		}
+
+		/*! \brief Negates a time. */
+		constexpr CX_Time_t<TimeUnit> operator-(void) const {
+			return fromNanos(-this->_nanos);
 		}
 
 		/*! \brief Divides a CX_Time_t by another CX_Time_t, resulting in a unitless ratio. */
 		template<typename RT>
-		double operator/(const CX_Time_t<RT>& rhs) const {
-			double r = (double)this->_nanos / (double)rhs.nanos();
-			return r;
+		constexpr double operator/(const CX_Time_t<RT>& rhs) const {
+			return (double)this->_nanos / (double)rhs.nanos();
 		}
 
 		/*! \brief Divides a CX_Time_t by a unitless value, resulting in a CX_Time_t of the same type. */
-		CX_Time_t<TimeUnit> operator/(double rhs) const {
-			return CX_Nanos(_nanos / rhs);
+		constexpr CX_Time_t<TimeUnit> operator/(double rhs) const {
+			return fromNanos(Private::roundToTicks(_nanos / rhs));
+		}
+
+		/*! \brief Divides a CX_Time_t by an integer, resulting in a CX_Time_t of the same type.
+		The division is done on the stored nanoseconds with integer arithmetic. */
+		template<typename N, typename = typename std::enable_if<std::is_integral<N>::value>::type>
+		constexpr CX_Time_t<TimeUnit> operator/(N rhs) const {
+			return fromNanos(_nanos / (cxTick_t)rhs);
 		}
 
 		/*! \brief Multiplies a CX_Time_t by a unitless value, storing the result in the CX_Time_t.
 		You cannot multiply a time by another time because that would result in units of time squared. */
 		CX_Time_t<TimeUnit>& operator*=(double rhs) {
-			this->_nanos *= rhs;
+			this->_nanos = Private::roundToTicks(this->_nanos * rhs);
 			return *this;
 		}
 
@@ -266,52 +291,53 @@ namespace CX {
 
 		/*! \brief Compares two times in the expected way. */
 		template <typename RT>
-		bool operator < (const CX_Time_t<RT>& rhs) const {
+		constexpr bool operator < (const CX_Time_t<RT>& rhs) const {
 			return this->_nanos < rhs.nanos();
 		}
 
 		/*! \brief Compares two times in the expected way. */
 		template <typename RT>
-		bool operator <= (const CX_Time_t<RT>& rhs) const {
+		constexpr bool operator <= (const CX_Time_t<RT>& rhs) const {
 			return this->_nanos <= rhs.nanos();
 		}
 
 		/*! \brief Compares two times in the expected way. */
 		template <typename RT>
-		bool operator >(const CX_Time_t<RT>& rhs) const {
+		constexpr bool operator >(const CX_Time_t<RT>& rhs) const {
 			return this->_nanos > rhs.nanos();
 		}
 
 		/*! \brief Compares two times in the expected way. */
 		template <typename RT>
-		bool operator >= (const CX_Time_t<RT>& rhs) const {
+		constexpr bool operator >= (const CX_Time_t<RT>& rhs) const {
 			return this->_nanos >= rhs.nanos();
 		}
 
 		/*! \brief Compares two times in the expected way. */
 		template <typename RT>
-		bool operator == (const CX_Time_t<RT>& rhs) const {
+		constexpr bool operator == (const CX_Time_t<RT>& rhs) const {
 			return this->_nanos == rhs.nanos();
 		}
 
 		/*! \brief Compares two times in the expected way. */
 		template <typename RT>
-		bool operator != (const CX_Time_t<RT>& rhs) const {
+		constexpr bool operator != (const CX_Time_t<RT>& rhs) const {
 			return this->_nanos != rhs.nanos();
 		}
 
 		/*! \brief Get the minimum time value that can be represented with this class. */
-		static CX_Time_t<TimeUnit> min(void) {
-			CX_Time_t<TimeUnit> t(0);
-			t._nanos = std::numeric_limits<cxTick_t>::min();
-			return t;
+		static constexpr CX_Time_t<TimeUnit> min(void) {
+			return fromNanos(std::numeric_limits<cxTick_t>::min());
 		}
 
 		/*! \brief Get the maximum time value that can be represented with this class. */
-		static CX_Time_t<TimeUnit> max(void) {
-			CX_Time_t<TimeUnit> t(0);
-			t._nanos = std::numeric_limits<cxTick_t>::max();
-			return t;
+		static constexpr CX_Time_t<TimeUnit> max(void) {
+			return fromNanos(std::numeric_limits<cxTick_t>::max());
+		}
+
+		/*! \brief Makes a CX_Time_t from a count of nanoseconds, without going through a conversion. */
+		static constexpr CX_Time_t<TimeUnit> fromNanos(cxTick_t nanos) {
+			return CX_Time_t<TimeUnit>(nanos, _NanosTag());
 		}
 
 		/*! This function calculates the sample standard deviation for a vector of time values. */
@@ -331,6 +357,17 @@ namespace CX {
 		}
 
 	private:
+		struct _NanosTag {};
+
+		//Integer division that rounds toward negative infinity, like floor() of the quotient.
+		static constexpr cxTick_t _floorDivide(cxTick_t n, cxTick_t d) {
+			return (n < 0 && n % d != 0) ? n / d - 1 : n / d;
+		}
+
+		constexpr CX_Time_t(cxTick_t nanos, _NanosTag) :
+			_nanos(nanos)
+		{}
+
 		cxTick_t _nanos;
 
 	};
@@ -375,15 +412,25 @@ namespace CX {
 
 	/*! \brief Multiplies a CX_Time_t with a numeric value, resulting in a CX_Time_t in the same units as `lhs`. */
 	template<typename T>
-	CX_Time_t<T> operator*(CX_Time_t<T> lhs, double rhs) {
-		double n = lhs.nanos() * rhs;
-		return CX_Nanos(n);
+	constexpr CX_Time_t<T> operator*(CX_Time_t<T> lhs, double rhs) {
+		return CX_Time_t<T>::fromNanos(Private::roundToTicks(lhs.nanos() * rhs));
 	}
 
 	/*! \brief Multiplies a CX_Time_t with a numeric value, resulting in a CX_Time_t in the same units as `rhs`. */
 	template<typename T>
-	CX_Time_t<T> operator*(double lhs, CX_Time_t<T> rhs) {
-		double n = rhs.nanos() * lhs;
-		return CX_Nanos(n);
+	constexpr CX_Time_t<T> operator*(double lhs, CX_Time_t<T> rhs) {
+		return CX_Time_t<T>::fromNanos(Private::roundToTicks(rhs.nanos() * lhs));
+	}
+
+	/*! \brief Multiplies a CX_Time_t by an integer with integer arithmetic, resulting in a CX_Time_t in the same units as `lhs`. */
+	template<typename T, typename N, typename = typename std::enable_if<std::is_integral<N>::value>::type>
+	constexpr CX_Time_t<T> operator*(CX_Time_t<T> lhs, N rhs) {
+		return CX_Time_t<T>::fromNanos(lhs.nanos() * (cxTick_t)rhs);
+	}
+
+	/*! \brief Multiplies a CX_Time_t by an integer with integer arithmetic, resulting in a CX_Time_t in the same units as `rhs`. */
+	template<typename T, typename N, typename = typename std::enable_if<std::is_integral<N>::value>::type>
+	constexpr CX_Time_t<T> operator*(N lhs, CX_Time_t<T> rhs) {
+		return CX_Time_t<T>::fromNanos(rhs.nanos() * (cxTick_t)lhs);
 	}
 }
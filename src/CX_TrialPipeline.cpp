@@ -0,0 +1,239 @@
+#include "CX_TrialPipeline.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "CX_Logger.h"
+#include "CX_EventTrace.h"
+
+namespace CX {
+
+struct CX_TrialPipeline::Worker {
+	Worker(void) :
+		stop(false),
+		currentTrial(0)
+	{}
+
+	std::thread thread;
+	mutable std::mutex mutex;
+	std::condition_variable workCondition; //Signalled when the worker may have something new to do.
+	std::condition_variable stateCondition; //Signalled when the worker finishes preparing a trial.
+	bool stop;
+
+	unsigned int currentTrial;
+	std::map<unsigned int, TrialState> states;
+};
+
+CX_TrialPipeline::CX_TrialPipeline(void) {}
+
+CX_TrialPipeline::~CX_TrialPipeline(void) {
+	stop();
+}
+
+/*! Sets up the pipeline and starts preparing trials on the worker thread. If the pipeline was already running,
+it is stopped first and the state of all trials is forgotten.
+\param config The configuration. `config.prepare` must be set.
+\return `true` if the pipeline was started, `false` if the configuration was not valid. */
+bool CX_TrialPipeline::setup(Configuration config) {
+	stop();
+
+	if (!config.prepare) {
+		CX::Instances::Log.error("CX_TrialPipeline") << "setup(): No prepare function was given.";
+		return false;
+	}
+
+	if (config.prepareAhead == 0) {
+		CX::Instances::Log.warning("CX_TrialPipeline") << "setup(): prepareAhead must be at least 1. It was set to 1.";
+		config.prepareAhead = 1;
+	}
+
+	_config = config;
+
+	_worker = std::make_shared<Worker>();
+	_worker->currentTrial = _config.firstTrial;
+	_worker->thread = std::thread(&CX_TrialPipeline::_workerLoop, this, _worker);
+
+	return true;
+}
+
+/*! Stops the worker thread. If a trial is being prepared, this waits for `prepare` to return. */
+void CX_TrialPipeline::stop(void) {
+	if (!_worker) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_worker->mutex);
+		_worker->stop = true;
+	}
+	_worker->workCondition.notify_all();
+	_worker->stateCondition.notify_all();
+	_worker->thread.join();
+	_worker.reset();
+}
+
+/*! Returns `true` if the pipeline has been set up and not stopped. */
+bool CX_TrialPipeline::isRunning(void) const {
+	return (bool)_worker;
+}
+
+/*! Does the GL stage of preparing trials. This must be called regularly from the thread that has the GL context
+(normally the main thread), for example in the loop that presents the current trial. Each call spends at most
+`Configuration::uploadSlice` calling `upload` for trials that have been prepared on the worker thread, in order.
+If there is no `upload` function, prepared trials are just marked as ready. */
+void CX_TrialPipeline::update(void) {
+	if (!_worker) {
+		return;
+	}
+
+	CX_Millis deadline = CX::Instances::Clock.now() + _config.uploadSlice;
+
+	while (true) {
+		unsigned int trial = 0;
+		bool found = false;
+		{
+			std::lock_guard<std::mutex> lock(_worker->mutex);
+			for (auto& s : _worker->states) {
+				if (s.second == TrialState::PREPARED) {
+					if (!_config.upload) {
+						s.second = TrialState::READY;
+						continue;
+					}
+					trial = s.first;
+					found = true;
+					break;
+				}
+			}
+		}
+
+		if (!found || CX::Instances::Clock.now() >= deadline) {
+			return;
+		}
+
+		bool done = _config.upload(trial, deadline);
+
+		if (!done) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(_worker->mutex);
+		_worker->states[trial] = TrialState::READY;
+	}
+}
+
+/*! Tells the pipeline that `trial` is now the current trial, which lets the worker thread prepare
+trials up to `trial + Configuration::prepareAhead`.
+\param trial The trial that is starting. */
+void CX_TrialPipeline::beginTrial(unsigned int trial) {
+	if (!_worker) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_worker->mutex);
+		_worker->currentTrial = trial;
+	}
+	_worker->workCondition.notify_all();
+}
+
+/*! Returns the state of the given trial. If the pipeline is not running, this returns TrialState::WAITING. */
+CX_TrialPipeline::TrialState CX_TrialPipeline::getTrialState(unsigned int trial) const {
+	if (!_worker) {
+		return TrialState::WAITING;
+	}
+
+	std::lock_guard<std::mutex> lock(_worker->mutex);
+	auto it = _worker->states.find(trial);
+	return (it == _worker->states.end()) ? TrialState::WAITING : it->second;
+}
+
+/*! Returns `true` if the given trial has been fully prepared (both `prepare` and `upload` are done). */
+bool CX_TrialPipeline::isTrialReady(unsigned int trial) const {
+	return getTrialState(trial) == TrialState::READY;
+}
+
+/*! Waits until the given trial is fully prepared, calling update() while waiting so that the trial is uploaded.
+Like update(), this must be called from the thread with the GL context.
+\param trial The trial to wait for. It must be no more than `Configuration::prepareAhead` trials after the current trial
+(see beginTrial()), because later trials are not prepared.
+\param timeout The longest time to wait.
+\return `true` if the trial is ready, `false` if preparing it failed, it is not going to be prepared, or the timeout expired. */
+bool CX_TrialPipeline::waitForTrial(unsigned int trial, CX_Millis timeout) {
+	if (!_worker) {
+		CX::Instances::Log.error("CX_TrialPipeline") << "waitForTrial(): The pipeline is not running.";
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_worker->mutex);
+		if (trial > _worker->currentTrial + _config.prepareAhead) {
+			CX::Instances::Log.error("CX_TrialPipeline") << "waitForTrial(): Trial " << trial << " will not be prepared until trial " <<
+				trial - _config.prepareAhead << " has begun. See beginTrial().";
+			return false;
+		}
+	}
+
+	CX_Millis deadline = CX::Instances::Clock.now() + timeout;
+
+	while (true) {
+		update();
+
+		TrialState state = getTrialState(trial);
+		if (state == TrialState::READY) {
+			return true;
+		} else if (state == TrialState::FAILED) {
+			return false;
+		}
+
+		CX_Millis remaining = deadline - CX::Instances::Clock.now();
+		if (remaining <= CX_Millis(0)) {
+			CX::Instances::Log.warning("CX_TrialPipeline") << "waitForTrial(): Timed out waiting for trial " << trial << ".";
+			return false;
+		}
+
+		//Wake up when the worker finishes a trial, or after a short time to keep uploading in update().
+		std::unique_lock<std::mutex> lock(_worker->mutex);
+		auto it = _worker->states.find(trial);
+		if (it == _worker->states.end() || it->second != TrialState::PREPARED) {
+			_worker->stateCondition.wait_for(lock, std::chrono::nanoseconds(std::min(remaining, CX_Millis(1)).nanos()));
+		}
+	}
+}
+
+void CX_TrialPipeline::_workerLoop(std::shared_ptr<Worker> worker) {
+	CX::Instances::EventTrace.nameThread("CX trial pipeline");
+
+	unsigned int nextTrial = _config.firstTrial;
+	unsigned int endTrial = _config.firstTrial + _config.trialCount;
+
+	std::unique_lock<std::mutex> lock(worker->mutex);
+	while (!worker->stop) {
+		bool allPrepared = (_config.trialCount != 0) && (nextTrial >= endTrial);
+		if (allPrepared || nextTrial > worker->currentTrial + _config.prepareAhead) {
+			worker->workCondition.wait(lock);
+			continue;
+		}
+
+		unsigned int trial = nextTrial++;
+		worker->states[trial] = TrialState::PREPARING;
+		lock.unlock();
+
+		bool succeeded = false;
+		try {
+			_config.prepare(trial);
+			succeeded = true;
+		} catch (std::exception& e) {
+			CX::Instances::Log.error("CX_TrialPipeline") << "Preparing trial " << trial << " failed with an exception: " << e.what();
+		} catch (...) {
+			CX::Instances::Log.error("CX_TrialPipeline") << "Preparing trial " << trial << " failed with an exception.";
+		}
+
+		lock.lock();
+		worker->states[trial] = succeeded ? TrialState::PREPARED : TrialState::FAILED;
+		worker->stateCondition.notify_all();
+	}
+}
+
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <map>
+
+#include "CX_Clock.h"
+
+namespace CX {
+
+	/*! This class prepares the stimuli for upcoming trials while the current trial is running, so that the time
+	between trials is not spent building stimuli. Each trial is prepared in two stages:
+
+	1. The `prepare` function is called on a worker thread. This is where CPU work goes: synthesizing sounds, making pixels
+	with functions like Draw::gaborToPixels(), sampling random values, and so on. It must not use OpenGL, because the
+	worker thread has no GL context, and it must not use CX::Instances::RNG, which is not thread safe (give each trial
+	its own generator, for example with CX_RandomNumberGenerator::split()).
+	2. The `upload` function is called from update() on the main (GL) thread, after `prepare` has finished. This is where
+	textures are loaded and framebuffers are drawn. It is called repeatedly with a deadline until it returns `true`, so
+	long uploads can be split into small chunks that fit between frames of the current trial.
+
+	The stimuli themselves are stored by the user, for example in a vector with one element per trial. Up to
+	`Configuration::prepareAhead` trials after the current trial (the last one passed to beginTrial()) are prepared at once.
+
+	\code{.cpp}
+	struct TrialStimuli {
+		ofFloatPixels pixels;
+		ofTexture texture;
+		CX_SoundBuffer sound;
+	};
+	std::vector<TrialStimuli> stimuli(trialCount);
+
+	CX_TrialPipeline::Configuration config;
+	config.trialCount = trialCount;
+	config.prepare = [&](unsigned int trial) {
+		stimuli[trial].pixels = Draw::gaborToPixels(...);
+		//Make the sound...
+	};
+	config.upload = [&](unsigned int trial, CX_Millis deadline) {
+		stimuli[trial].texture.loadData(stimuli[trial].pixels);
+		return true; //Done in one chunk.
+	};
+
+	CX_TrialPipeline pipeline;
+	pipeline.setup(config);
+
+	for (unsigned int trial = 0; trial < trialCount; trial++) {
+		pipeline.waitForTrial(trial, CX_Seconds(10));
+		pipeline.beginTrial(trial);
+
+		while (trialIsRunning) {
+			pipeline.update(); //Uploads the next trial a little at a time.
+			//Present trial...
+		}
+	}
+	\endcode
+
+	\ingroup utility
+	*/
+	class CX_TrialPipeline {
+	public:
+
+		/*! The state of a trial in the pipeline. */
+		enum class TrialState {
+			WAITING, //!< The trial has not been prepared yet.
+			PREPARING, //!< `prepare` is running on the worker thread.
+			PREPARED, //!< `prepare` has finished, but `upload` has not.
+			READY, //!< The trial is fully prepared.
+			FAILED //!< `prepare` threw an exception. It is logged.
+		};
+
+		/*! The configuration of a CX_TrialPipeline. */
+		struct Configuration {
+			Configuration(void) :
+				trialCount(0),
+				firstTrial(0),
+				prepareAhead(1),
+				uploadSlice(2)
+			{}
+
+			/*! Prepares the CPU side of the given trial. Called on the worker thread. Required. */
+			std::function<void(unsigned int trial)> prepare;
+
+			/*! Does the GL side of preparing the given trial, on the thread that calls update(). It should do some work and return
+			before `deadline` (which can be compared to Clock.now()), returning `true` once the trial is fully uploaded. Optional. */
+			std::function<bool(unsigned int trial, CX_Millis deadline)> upload;
+
+			unsigned int trialCount; //!< The number of trials. If 0, trials are prepared until stop() is called.
+			unsigned int firstTrial; //!< The first trial to prepare.
+			unsigned int prepareAhead; //!< How many trials after the current one (see beginTrial()) can be prepared at once. At least 1.
+			CX_Millis uploadSlice; //!< The longest time that one call to update() spends in `upload`.
+		};
+
+		CX_TrialPipeline(void);
+		~CX_TrialPipeline(void);
+
+		bool setup(Configuration config);
+		void stop(void);
+		bool isRunning(void) const;
+
+		void update(void);
+
+		void beginTrial(unsigned int trial);
+
+		TrialState getTrialState(unsigned int trial) const;
+		bool isTrialReady(unsigned int trial) const;
+		bool waitForTrial(unsigned int trial, CX_Millis timeout);
+
+	private:
+		struct Worker;
+		std::shared_ptr<Worker> _worker;
+
+		Configuration _config;
+
+		void _workerLoop(std::shared_ptr<Worker> worker);
+	};
+
+}
@@ -0,0 +1,597 @@
+#include "CX_TriggerOutput.h"
+
+#include <algorithm>
+
+#ifdef TARGET_WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+#ifdef TARGET_LINUX
+#include <sys/ioctl.h>
+#include <linux/parport.h>
+#include <linux/ppdev.h>
+#endif
+
+namespace CX {
+
+////////////////////////////
+// CX_SerialTriggerDevice //
+////////////////////////////
+
+CX_SerialTriggerDevice::CX_SerialTriggerDevice(void) :
+	_handle(-1)
+{}
+
+CX_SerialTriggerDevice::~CX_SerialTriggerDevice(void) {
+	close();
+}
+
+/*! Opens a serial port.
+\param port The name of the port, e.g. "COM3" on Windows or "/dev/ttyUSB0" on Linux.
+\param baudRate The baud rate. On Linux and OS X, only the standard rates from 9600 to 230400 are supported.
+\return `true` if the port was opened, `false` otherwise. */
+bool CX_SerialTriggerDevice::open(std::string port, unsigned int baudRate) {
+	close();
+
+#ifdef TARGET_WIN32
+	std::string path = "\\\\.\\" + port;
+	HANDLE h = CreateFileA(path.c_str(), GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+	if (h == INVALID_HANDLE_VALUE) {
+		CX::Instances::Log.error("CX_SerialTriggerDevice") << "open(): The port " << port << " could not be opened (error " << GetLastError() << ").";
+		return false;
+	}
+
+	DCB dcb;
+	memset(&dcb, 0, sizeof(dcb));
+	dcb.DCBlength = sizeof(dcb);
+	GetCommState(h, &dcb);
+	dcb.BaudRate = baudRate;
+	dcb.ByteSize = 8;
+	dcb.Parity = NOPARITY;
+	dcb.StopBits = ONESTOPBIT;
+	if (!SetCommState(h, &dcb)) {
+		CX::Instances::Log.error("CX_SerialTriggerDevice") << "open(): The port " << port << " could not be configured (error " << GetLastError() << ").";
+		CloseHandle(h);
+		return false;
+	}
+	_handle = (intptr_t)h;
+#else
+	speed_t speed;
+	switch (baudRate) {
+	case 9600: speed = B9600; break;
+	case 19200: speed = B19200; break;
+	case 38400: speed = B38400; break;
+	case 57600: speed = B57600; break;
+	case 115200: speed = B115200; break;
+	case 230400: speed = B230400; break;
+	default:
+		CX::Instances::Log.error("CX_SerialTriggerDevice") << "open(): The baud rate " << baudRate << " is not supported.";
+		return false;
+	}
+
+	int fd = ::open(port.c_str(), O_WRONLY | O_NOCTTY);
+	if (fd < 0) {
+		CX::Instances::Log.error("CX_SerialTriggerDevice") << "open(): The port " << port << " could not be opened.";
+		return false;
+	}
+
+	termios tty;
+	tcgetattr(fd, &tty);
+	cfmakeraw(&tty);
+	cfsetospeed(&tty, speed);
+	cfsetispeed(&tty, speed);
+	tty.c_cflag |= CLOCAL;
+	if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+		CX::Instances::Log.error("CX_SerialTriggerDevice") << "open(): The port " << port << " could not be configured.";
+		::close(fd);
+		return false;
+	}
+	_handle = fd;
+#endif
+
+	_port = port;
+	return true;
+}
+
+/*! Closes the port, if it is open. */
+void CX_SerialTriggerDevice::close(void) {
+	if (!isOpen()) {
+		return;
+	}
+#ifdef TARGET_WIN32
+	CloseHandle((HANDLE)_handle);
+#else
+	::close((int)_handle);
+#endif
+	_handle = -1;
+}
+
+/*! \brief Returns `true` if the port is open. */
+bool CX_SerialTriggerDevice::isOpen(void) const {
+	return _handle != -1;
+}
+
+bool CX_SerialTriggerDevice::writeCode(uint8_t code) {
+	if (!isOpen()) {
+		return false;
+	}
+#ifdef TARGET_WIN32
+	DWORD written = 0;
+	return WriteFile((HANDLE)_handle, &code, 1, &written, NULL) && written == 1;
+#else
+	return ::write((int)_handle, &code, 1) == 1;
+#endif
+}
+
+std::string CX_SerialTriggerDevice::getName(void) const {
+	return "serial port " + _port;
+}
+
+//////////////////////////////////
+// CX_ParallelPortTriggerDevice //
+//////////////////////////////////
+
+CX_ParallelPortTriggerDevice::CX_ParallelPortTriggerDevice(void) :
+	_fd(-1)
+{}
+
+CX_ParallelPortTriggerDevice::~CX_ParallelPortTriggerDevice(void) {
+	close();
+}
+
+/*! Opens and claims a parallel port with the Linux `ppdev` driver. The user needs permission to open the device, which
+usually means being in the `lp` group. On other systems, this logs an error and returns `false`.
+\param device The device file of the port.
+\return `true` if the port was opened, `false` otherwise. */
+bool CX_ParallelPortTriggerDevice::open(std::string device) {
+	close();
+
+#ifdef TARGET_LINUX
+	int fd = ::open(device.c_str(), O_RDWR);
+	if (fd < 0) {
+		CX::Instances::Log.error("CX_ParallelPortTriggerDevice") << "open(): " << device << " could not be opened. Check that you have permission to use it.";
+		return false;
+	}
+
+	if (ioctl(fd, PPCLAIM) != 0) {
+		CX::Instances::Log.error("CX_ParallelPortTriggerDevice") << "open(): " << device << " could not be claimed.";
+		::close(fd);
+		return false;
+	}
+
+	_fd = fd;
+	_device = device;
+	writeCode(0);
+	return true;
+#else
+	CX::Instances::Log.error("CX_ParallelPortTriggerDevice") << "open(): Parallel ports are only supported on Linux. "
+		"On other systems, use a CX_FunctionTriggerDevice with a driver for the port.";
+	return false;
+#endif
+}
+
+/*! Releases and closes the port, if it is open. */
+void CX_ParallelPortTriggerDevice::close(void) {
+#ifdef TARGET_LINUX
+	if (_fd < 0) {
+		return;
+	}
+	ioctl(_fd, PPRELEASE);
+	::close(_fd);
+	_fd = -1;
+#endif
+}
+
+/*! \brief Returns `true` if the port is open. */
+bool CX_ParallelPortTriggerDevice::isOpen(void) const {
+	return _fd >= 0;
+}
+
+bool CX_ParallelPortTriggerDevice::writeCode(uint8_t code) {
+#ifdef TARGET_LINUX
+	if (_fd < 0) {
+		return false;
+	}
+	unsigned char data = code;
+	return ioctl(_fd, PPWDATA, &data) == 0;
+#else
+	return false;
+#endif
+}
+
+std::string CX_ParallelPortTriggerDevice::getName(void) const {
+	return "parallel port " + _device;
+}
+
+///////////////////////////////
+// CX_FunctionTriggerDevice //
+///////////////////////////////
+
+/*! \param writeFunction A function that sends the code that it is given and returns `true` on success.
+\param name A name for the device, which is used in log messages. */
+CX_FunctionTriggerDevice::CX_FunctionTriggerDevice(std::function<bool(uint8_t)> writeFunction, std::string name) :
+	_writeFunction(writeFunction),
+	_name(name)
+{}
+
+bool CX_FunctionTriggerDevice::writeCode(uint8_t code) {
+	return _writeFunction ? _writeFunction(code) : false;
+}
+
+std::string CX_FunctionTriggerDevice::getName(void) const {
+	return _name;
+}
+
+//////////////////////
+// CX_TriggerOutput //
+//////////////////////
+
+namespace {
+	//For a min-heap of scheduled codes.
+	template <typename T>
+	bool laterThan(const T& a, const T& b) {
+		return a.nanos > b.nanos;
+	}
+}
+
+CX_TriggerOutput::CX_TriggerOutput(void) :
+	_running(false),
+	_droppedCount(0),
+	_listeningForEvents(false)
+{}
+
+CX_TriggerOutput::~CX_TriggerOutput(void) {
+	close();
+}
+
+/*! Sets up the trigger output and starts the trigger thread. If it was already set up, it is closed first.
+\param config The settings.
+\return `false` if there is neither a device nor a sound stream to send codes with, `true` otherwise. */
+bool CX_TriggerOutput::setup(const Configuration& config) {
+	close();
+
+	if (config.device == nullptr && config.soundStream == nullptr) {
+		CX::Instances::Log.error("CX_TriggerOutput") << "setup(): There is neither a device nor a sound stream to send codes with.";
+		return false;
+	}
+
+	_config = config;
+	_droppedCount = 0;
+	clearSentCodes();
+
+	if (_config.device != nullptr) {
+		_scheduleQueue.setup(_config.queueCapacity);
+		_pending.clear();
+		_pending.reserve(_config.queueCapacity * 2); //Room for a reset after each code.
+
+		_running = true;
+		_triggerThread = std::thread(&CX_TriggerOutput::_triggerLoop, this);
+	}
+
+	if (_config.soundStream != nullptr) {
+		if (_config.soundStream->getConfiguration().outputChannels <= 0) {
+			CX::Instances::Log.warning("CX_TriggerOutput") << "setup(): The sound stream has no output channels, so audio pulses cannot be sent.";
+		} else {
+			_audioQueue.setup(_config.queueCapacity);
+			_audioPulses.clear();
+			_audioPulses.reserve(_config.queueCapacity);
+			_listenForEvents(true);
+		}
+	}
+
+	return true;
+}
+
+/*! Stops the trigger thread and stops listening to the sound stream. Codes that have not been sent yet are discarded. */
+void CX_TriggerOutput::close(void) {
+	_listenForEvents(false);
+
+	if (_triggerThread.joinable()) {
+		_running = false;
+		_wakeCondition.notify_one();
+		_triggerThread.join();
+	}
+}
+
+/*! \brief Returns the configuration that the trigger output was set up with. */
+const CX_TriggerOutput::Configuration& CX_TriggerOutput::getConfiguration(void) const {
+	return _config;
+}
+
+/*! Sends a code as soon as possible, on the trigger thread.
+\param code The code.
+\return `false` if the code could not be scheduled. */
+bool CX_TriggerOutput::sendCodeNow(uint8_t code) {
+	return sendCodeAt(code, CX::Instances::Clock.now());
+}
+
+/*! Schedules a code to be sent with the device at the given time. If the time has passed, the code is sent immediately.
+\param code The code.
+\param time The time, which can be compared with the result of CX::Instances::Clock.now().
+\return `false` if there is no device or the code was dropped because too many codes are scheduled. */
+bool CX_TriggerOutput::sendCodeAt(uint8_t code, CX_Millis time) {
+	if (!_triggerThread.joinable()) {
+		CX::Instances::Log.error("CX_TriggerOutput") << "sendCodeAt(): There is no device to send codes with. Have you forgotten to call setup()?";
+		return false;
+	}
+
+	ScheduledCode sc;
+	sc.code = code;
+	sc.isReset = false;
+	sc.nanos = (int64_t)time.nanos();
+	if (!_scheduleQueue.push(sc)) {
+		return false;
+	}
+	_wakeCondition.notify_one();
+	return true;
+}
+
+/*! Schedules a code for the time at which the next buffer swap of the display becomes visible, i.e.
+CX_Display::estimateNextSwapTime() plus CX_Display::getPresentationLatency(). Like CX_Display::estimateNextSwapTime(), this
+is only meaningful if the display swaps every frame, e.g. with automatic swapping or when the swap for the frame has just been
+requested. If the frame period has not been estimated, see CX_Display::estimateFramePeriod().
+\param code The code.
+\param display The display.
+\return `false` if the code could not be scheduled. */
+bool CX_TriggerOutput::sendCodeAtNextSwap(uint8_t code, const CX_Display& display) {
+	return sendCodeAt(code, display.estimateNextSwapTime() + display.getPresentationLatency());
+}
+
+/*! Schedules a code for the time at which a future frame of the display becomes visible, predicted from the last swap time
+and the frame period of the display, plus its presentation latency. This assumes that the display swaps every frame until then.
+\param code The code.
+\param frameNumber The frame number (see CX_Display::getFrameNumber()). It must be in the future.
+\param display The display.
+\return `false` if the frame is not in the future or the code could not be scheduled. */
+bool CX_TriggerOutput::sendCodeAtFrame(uint8_t code, uint64_t frameNumber, const CX_Display& display) {
+	uint64_t currentFrame = display.getFrameNumber();
+	if (frameNumber <= currentFrame) {
+		CX::Instances::Log.error("CX_TriggerOutput") << "sendCodeAtFrame(): Frame " << frameNumber << " is not in the future. The current frame is " << currentFrame << ".";
+		return false;
+	}
+
+	CX_Millis time = display.getLastSwapTime() + display.getFramePeriod() * (double)(frameNumber - currentFrame) + display.getPresentationLatency();
+	return sendCodeAt(code, time);
+}
+
+/*! Schedules an audio pulse in the output of the sound stream (see Configuration::soundStream) that will be played at the
+given time. The time is converted to a sample frame in the same way as CX_SoundMixer::playAt(). See also sendAudioPulseAtFrame().
+\param code The code, which sets the amplitude of the pulse.
+\param time The time at which the pulse should be played.
+\return `false` if there is no sound stream, or the pulse was dropped because too many pulses are scheduled. */
+bool CX_TriggerOutput::sendAudioPulseAt(uint8_t code, CX_Millis time) {
+	CX_SoundStream* ss = _config.soundStream;
+	if (!_listeningForEvents) {
+		CX::Instances::Log.error("CX_TriggerOutput") << "sendAudioPulseAt(): There is no sound stream to send audio pulses with.";
+		return false;
+	}
+
+	CX_Millis partialStreamLatency = ss->estimateTotalLatency() - ss->estimateLatencyPerBuffer();
+	CX_Millis adjustedTime = time - partialStreamLatency - ss->getConfiguration().outputLatencyOffset;
+
+	uint64_t sampleFrame = ss->getSampleFrameNumber();
+	if (adjustedTime > ss->getLastSwapTime()) {
+		sampleFrame = std::max(ss->timeToSampleFrame(adjustedTime), sampleFrame);
+	}
+
+	return sendAudioPulseAtFrame(code, sampleFrame);
+}
+
+/*! Schedules an audio pulse to start at the given sample frame of the sound stream (see CX_SoundStream::getSampleFrameNumber()).
+If the sample frame has passed, the pulse starts in the next buffer.
+\param code The code, which sets the amplitude of the pulse.
+\param sampleFrame The sample frame.
+\return `false` if there is no sound stream, or the pulse was dropped because too many pulses are scheduled. */
+bool CX_TriggerOutput::sendAudioPulseAtFrame(uint8_t code, uint64_t sampleFrame) {
+	if (!_listeningForEvents) {
+		CX::Instances::Log.error("CX_TriggerOutput") << "sendAudioPulseAtFrame(): There is no sound stream to send audio pulses with.";
+		return false;
+	}
+
+	AudioPulse pulse;
+	pulse.startFrame = sampleFrame;
+	pulse.frameCount = std::max<uint64_t>((uint64_t)(_config.pulseWidth.seconds() * _config.soundStream->getConfiguration().sampleRate), 1);
+	pulse.amplitude = _config.audioAmplitude * code / 255.0f;
+	return _audioQueue.push(pulse);
+}
+
+/*! Returns a record of every code that was sent with the device, with the time at which it was scheduled to be sent and
+the time at which it was sent. The difference between them is the timing error of the trigger thread. */
+std::vector<CX_TriggerOutput::SentCode> CX_TriggerOutput::getSentCodes(void) const {
+	std::lock_guard<std::mutex> lock(_sentMutex);
+	return _sentCodes;
+}
+
+/*! Clears the record of sent codes. */
+void CX_TriggerOutput::clearSentCodes(void) {
+	std::lock_guard<std::mutex> lock(_sentMutex);
+	_sentCodes.clear();
+}
+
+/*! \brief Returns the number of codes and audio pulses that were dropped because too many were scheduled at once,
+or that the device failed to send. */
+uint64_t CX_TriggerOutput::getDroppedCount(void) const {
+	return _droppedCount.load() + _scheduleQueue.getDroppedCount() + _audioQueue.getDroppedCount();
+}
+
+void CX_TriggerOutput::_addPending(const ScheduledCode& sc) {
+	if (_pending.size() >= _pending.capacity()) {
+		_droppedCount++;
+		return;
+	}
+	_pending.push_back(sc);
+	std::push_heap(_pending.begin(), _pending.end(), laterThan<ScheduledCode>);
+}
+
+void CX_TriggerOutput::_triggerLoop(void) {
+	if (_config.realTimeThreadPriority) {
+		_raiseThreadPriority();
+	}
+
+	while (_running) {
+		ScheduledCode sc;
+		while (_scheduleQueue.pop(&sc)) {
+			_addPending(sc);
+		}
+
+		//The thread never waits more than 1 ms, so that newly scheduled codes are seen even if a notification is missed.
+		if (_pending.empty()) {
+			std::unique_lock<std::mutex> lock(_wakeMutex);
+			_wakeCondition.wait_for(lock, std::chrono::milliseconds(1));
+			continue;
+		}
+
+		ScheduledCode next = _pending.front();
+		CX_Millis deadline = CX_Nanos(next.nanos);
+		CX_Millis untilDeadline = deadline - CX::Instances::Clock.now();
+
+		if (untilDeadline > _config.spinDuration) {
+			CX_Millis sleepDuration = std::min(untilDeadline - _config.spinDuration, CX_Millis(1));
+			std::unique_lock<std::mutex> lock(_wakeMutex);
+			_wakeCondition.wait_for(lock, std::chrono::nanoseconds((int64_t)sleepDuration.nanos()));
+			continue;
+		}
+
+		while (CX::Instances::Clock.now() < deadline)
+			;
+
+		std::pop_heap(_pending.begin(), _pending.end(), laterThan<ScheduledCode>);
+		_pending.pop_back();
+
+		bool sent = _config.device->writeCode(next.code);
+		CX_Millis sentTime = CX::Instances::Clock.now();
+
+		if (!sent) {
+			_droppedCount++;
+		}
+
+		if (next.isReset) {
+			continue;
+		}
+
+		//A reset that is still pending belongs to an earlier code, and would cut this one short.
+		auto firstReset = std::remove_if(_pending.begin(), _pending.end(), [](const ScheduledCode& p) { return p.isReset; });
+		if (firstReset != _pending.end()) {
+			_pending.erase(firstReset, _pending.end());
+			std::make_heap(_pending.begin(), _pending.end(), laterThan<ScheduledCode>);
+		}
+
+		if (_config.pulseWidth > CX_Millis(0) && next.code != 0) {
+			ScheduledCode reset;
+			reset.code = 0;
+			reset.isReset = true;
+			reset.nanos = (int64_t)(std::max(deadline, sentTime) + _config.pulseWidth).nanos();
+			_addPending(reset);
+		}
+
+		if (sent) {
+			SentCode record;
+			record.code = next.code;
+			record.scheduledTime = deadline;
+			record.sentTime = sentTime;
+
+			std::lock_guard<std::mutex> lock(_sentMutex);
+			_sentCodes.push_back(record);
+		} else {
+			CX::Instances::Log.warning("CX_TriggerOutput") << "Code " << (int)next.code << " could not be sent with " << _config.device->getName() << ".";
+		}
+	}
+}
+
+void CX_TriggerOutput::_raiseThreadPriority(void) {
+#ifdef TARGET_WIN32
+	if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+		CX::Instances::Log.warning("CX_TriggerOutput") << "The priority of the trigger thread could not be raised (error " << GetLastError() << ").";
+	}
+#else
+	//The trigger thread spins before each code, so it is kept just below the audio thread (see CX_SoundStream::Configuration::realTimeThreadPriority),
+	//which would otherwise be starved. The audio thread uses the middle of the range unless a valid priority is configured.
+	int minPriority = sched_get_priority_min(SCHED_FIFO);
+	int maxPriority = sched_get_priority_max(SCHED_FIFO);
+
+	int audioPriority = (minPriority + maxPriority) / 2;
+	if (_config.soundStream != nullptr) {
+		int configured = _config.soundStream->getConfiguration().streamOptions.priority;
+		if (configured >= minPriority && configured <= maxPriority) {
+			audioPriority = configured;
+		}
+	}
+
+	sched_param param;
+	param.sched_priority = std::max(audioPriority - 1, minPriority);
+
+	int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if (err != 0) {
+		CX::Instances::Log.warning("CX_TriggerOutput") << "The priority of the trigger thread could not be raised to " << param.sched_priority <<
+			" (error " << err << "). Check the rtprio limit.";
+	} else {
+		CX::Instances::Log.notice("CX_TriggerOutput") << "The trigger thread is running with real-time priority " << param.sched_priority << ".";
+	}
+#endif
+}
+
+bool CX_TriggerOutput::_outputEventHandler(CX_SoundStream::OutputEventArgs& outputData) {
+	CX_SoundStream::ListenerScope watchdog(outputData.instance, "CX_TriggerOutput");
+
+	const uint64_t bufferStart = _config.soundStream->getSampleFrameNumber();
+	const uint64_t bufferEnd = bufferStart + outputData.bufferSize;
+	const int channels = outputData.outputChannels;
+	const int channel = (_config.audioChannel < 0 || _config.audioChannel >= channels) ? channels - 1 : _config.audioChannel;
+
+	AudioPulse pulse;
+	while (_audioQueue.pop(&pulse)) {
+		if (_audioPulses.size() >= _audioPulses.capacity()) {
+			_droppedCount++;
+			continue;
+		}
+		pulse.startFrame = std::max(pulse.startFrame, bufferStart);
+		_audioPulses.push_back(pulse);
+	}
+
+	for (size_t i = 0; i < _audioPulses.size(); ) {
+		AudioPulse& p = _audioPulses[i];
+		if (p.startFrame >= bufferEnd) {
+			i++;
+			continue;
+		}
+
+		uint64_t pulseEnd = p.startFrame + p.frameCount;
+		uint64_t last = std::min(pulseEnd, bufferEnd);
+		for (uint64_t frame = p.startFrame; frame < last; frame++) {
+			outputData.outputBuffer[(frame - bufferStart) * channels + channel] = p.amplitude;
+		}
+
+		if (pulseEnd <= bufferEnd) {
+			_audioPulses[i] = _audioPulses.back();
+			_audioPulses.pop_back();
+		} else {
+			p.frameCount = pulseEnd - bufferEnd;
+			p.startFrame = bufferEnd;
+			i++;
+		}
+	}
+
+	return false; //Other listeners, like a CX_SoundMixer on the same stream, still need the event.
+}
+
+void CX_TriggerOutput::_listenForEvents(bool listen) {
+	if ((listen == _listeningForEvents) || (_config.soundStream == nullptr)) {
+		return;
+	}
+
+	if (listen) {
+		ofAddListener(_config.soundStream->outputEvent, this, &CX_TriggerOutput::_outputEventHandler);
+	} else {
+		ofRemoveListener(_config.soundStream->outputEvent, this, &CX_TriggerOutput::_outputEventHandler);
+	}
+
+	_listeningForEvents = listen;
+}
+
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CX_Clock.h"
+#include "CX_Display.h"
+#include "CX_MPSCQueue.h"
+#include "CX_SoundStream.h"
+
+namespace CX {
+
+	/*! The base class for devices that CX_TriggerOutput can send trigger codes with. To support another device, derive
+	from this class and implement writeCode(), or wrap the function that sends a code with CX_FunctionTriggerDevice.
+	writeCode() is called from the trigger thread of CX_TriggerOutput, so it should return as quickly as possible.
+	\ingroup timing */
+	class CX_TriggerDevice {
+	public:
+		virtual ~CX_TriggerDevice(void) {}
+
+		/*! Puts `code` on the output lines of the device.
+		\return `true` if the code was sent, `false` otherwise. */
+		virtual bool writeCode(uint8_t code) = 0;
+
+		virtual std::string getName(void) const = 0; //!< Returns a name for the device, which is used in log messages.
+	};
+
+	/*! Sends each trigger code as one byte on a serial port, which is what many USB trigger boxes expect.
+	\ingroup timing */
+	class CX_SerialTriggerDevice : public CX_TriggerDevice {
+	public:
+		CX_SerialTriggerDevice(void);
+		~CX_SerialTriggerDevice(void);
+
+		bool open(std::string port, unsigned int baudRate = 115200);
+		void close(void);
+		bool isOpen(void) const;
+
+		bool writeCode(uint8_t code) override;
+		std::string getName(void) const override;
+
+	private:
+		std::string _port;
+		intptr_t _handle;
+	};
+
+	/*! Sends trigger codes on the data lines of a parallel port. This uses the `ppdev` driver on Linux. On other systems,
+	parallel ports need a driver that gives access to the port, like InpOut32 on Windows, which can be used with
+	CX_FunctionTriggerDevice.
+	\ingroup timing */
+	class CX_ParallelPortTriggerDevice : public CX_TriggerDevice {
+	public:
+		CX_ParallelPortTriggerDevice(void);
+		~CX_ParallelPortTriggerDevice(void);
+
+		bool open(std::string device = "/dev/parport0");
+		void close(void);
+		bool isOpen(void) const;
+
+		bool writeCode(uint8_t code) override;
+		std::string getName(void) const override;
+
+	private:
+		std::string _device;
+		int _fd;
+	};
+
+	/*! Sends trigger codes with a user function, e.g. one that calls the driver library of a USB data acquisition device.
+
+	\code{.cpp}
+	CX_FunctionTriggerDevice daq([](uint8_t code) {
+		return myDaqWriteDigitalPort(0, code) == 0;
+	}, "My DAQ");
+	\endcode
+	\ingroup timing */
+	class CX_FunctionTriggerDevice : public CX_TriggerDevice {
+	public:
+		CX_FunctionTriggerDevice(std::function<bool(uint8_t)> writeFunction, std::string name = "function");
+
+		bool writeCode(uint8_t code) override;
+		std::string getName(void) const override;
+
+	private:
+		std::function<bool(uint8_t)> _writeFunction;
+		std::string _name;
+	};
+
+	/*! This class sends trigger codes, e.g. to EEG amplifiers, at scheduled times instead of whenever user code gets
+	around to it. Sending a code from user code after a `slidePresentedCallback` has been called adds milliseconds of
+	jitter. With this class, the code is scheduled ahead of time for the predicted swap time of a CX_Display (see
+	sendCodeAtNextSwap() and sendCodeAtFrame()) or for any time (see sendCodeAt()), and a dedicated high priority
+	thread sleeps until shortly before the scheduled time, then spins until the time arrives and writes the code to a
+	CX_TriggerDevice. The code is held for Configuration::pulseWidth and then set back to 0.
+
+	For sample-accurate marking, codes can also be encoded as pulses in a channel of the output of a CX_SoundStream
+	(see sendAudioPulseAt()), which can be connected to a trigger input of the amplifier, or recorded along with the
+	sounds that they mark. The pulse is written directly into the output buffer of the stream at the sample frame that
+	will be played at the scheduled time, so it has no jitter relative to sounds that are played with the same stream.
+
+	\code{.cpp}
+	CX_ParallelPortTriggerDevice port;
+	port.open("/dev/parport0");
+
+	CX_TriggerOutput triggers;
+	CX_TriggerOutput::Configuration config;
+	config.device = &port;
+	triggers.setup(config);
+
+	Disp.beginDrawingToBackBuffer();
+	//Draw the stimulus...
+	Disp.endDrawingToBackBuffer();
+	triggers.sendCodeAtNextSwap(12); //Sent when the stimulus appears.
+	Disp.swapBuffersInThread();
+	\endcode
+
+	All of the send functions can be called from any thread.
+	\ingroup timing
+	*/
+	class CX_TriggerOutput {
+	public:
+
+		/*! The settings for a CX_TriggerOutput. See CX_TriggerOutput::setup(). */
+		struct Configuration {
+			Configuration(void) :
+				device(nullptr),
+				pulseWidth(5),
+				spinDuration(2),
+				realTimeThreadPriority(true),
+				queueCapacity(256),
+				soundStream(nullptr),
+				audioChannel(-1),
+				audioAmplitude(1)
+			{}
+
+			CX_TriggerDevice* device; //!< The device to send codes with. It must outlive the CX_TriggerOutput. Can be `nullptr` if only audio pulses are used.
+
+			/*! How long each code is held before the output is set back to 0. If this is 0, codes are held until the next code is sent.
+			This is also the duration of audio pulses. */
+			CX_Millis pulseWidth;
+
+			/*! How long before the scheduled time the trigger thread wakes up and starts spinning. Larger values make the
+			timing more precise when the system is slow to wake sleeping threads, at the cost of more CPU time. */
+			CX_Millis spinDuration;
+
+			/*! If `true`, the trigger thread raises its priority. On Windows, the thread is given time critical priority.
+			On other systems, it is given the `SCHED_FIFO` policy with a priority one below that of the audio thread (see
+			CX_SoundStream::Configuration::realTimeThreadPriority), so that it does not starve the audio thread while it waits
+			for the time of a code. On Linux, this needs the `rtprio` limit to be raised (or root). If raising the priority fails,
+			a warning is logged. */
+			bool realTimeThreadPriority;
+
+			/*! The number of codes that can be scheduled at once. Codes that do not fit are dropped and counted (see getDroppedCount()). */
+			size_t queueCapacity;
+
+			/*! The sound stream to encode audio pulses into, or `nullptr` if audio pulses are not used. */
+			CX_SoundStream* soundStream;
+
+			/*! The output channel of `soundStream` that carries the pulses. The samples of this channel are replaced while a
+			pulse is playing, so nothing else should be played on it. If this is negative, the last channel is used. */
+			int audioChannel;
+
+			/*! The amplitude of a pulse for code 255. The amplitude of a pulse is proportional to its code, so that codes
+			can be told apart in a recording. */
+			float audioAmplitude;
+		};
+
+		/*! The record of a code that was sent. See getSentCodes(). */
+		struct SentCode {
+			uint8_t code; //!< The code.
+			CX_Millis scheduledTime; //!< The time at which the code was supposed to be sent.
+			CX_Millis sentTime; //!< The time at which writing the code to the device finished.
+		};
+
+		CX_TriggerOutput(void);
+		~CX_TriggerOutput(void);
+
+		bool setup(const Configuration& config);
+		void close(void);
+		const Configuration& getConfiguration(void) const;
+
+		bool sendCodeNow(uint8_t code);
+		bool sendCodeAt(uint8_t code, CX_Millis time);
+		bool sendCodeAtNextSwap(uint8_t code, const CX_Display& display = CX::Instances::Disp);
+		bool sendCodeAtFrame(uint8_t code, uint64_t frameNumber, const CX_Display& display = CX::Instances::Disp);
+
+		bool sendAudioPulseAt(uint8_t code, CX_Millis time);
+		bool sendAudioPulseAtFrame(uint8_t code, uint64_t sampleFrame);
+
+		std::vector<SentCode> getSentCodes(void) const;
+		void clearSentCodes(void);
+		uint64_t getDroppedCount(void) const;
+
+	private:
+
+		Configuration _config;
+
+		struct ScheduledCode {
+			uint8_t code;
+			bool isReset; //Resets are not recorded in the sent codes.
+			int64_t nanos;
+		};
+
+		CX_MPSCQueue<ScheduledCode> _scheduleQueue;
+		std::vector<ScheduledCode> _pending; //Only used by the trigger thread. A min-heap by time.
+
+		std::atomic<bool> _running;
+		std::thread _triggerThread;
+		std::mutex _wakeMutex;
+		std::condition_variable _wakeCondition;
+		void _triggerLoop(void);
+		void _addPending(const ScheduledCode& sc);
+		void _raiseThreadPriority(void);
+
+		mutable std::mutex _sentMutex;
+		std::vector<SentCode> _sentCodes;
+
+		std::atomic<uint64_t> _droppedCount;
+
+		struct AudioPulse {
+			uint64_t startFrame;
+			uint64_t frameCount;
+			float amplitude;
+		};
+
+		CX_MPSCQueue<AudioPulse> _audioQueue;
+		std::vector<AudioPulse> _audioPulses; //Only used by the audio thread. Has a fixed capacity so the audio thread does not allocate.
+		bool _outputEventHandler(CX_SoundStream::OutputEventArgs& outputData);
+		bool _listeningForEvents;
+		void _listenForEvents(bool listen);
+	};
+
+}
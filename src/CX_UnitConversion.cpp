@@ -1,8 +1,91 @@
 #include "CX_UnitConversion.h"
 
+#if !defined(CX_UNIT_CONVERSION_NO_SIMD)
+#	if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#		define CX_UNIT_CONVERSION_USE_SSE
+#		include <xmmintrin.h>
+#	elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#		define CX_UNIT_CONVERSION_USE_NEON
+#		include <arm_neon.h>
+#	endif
+#endif
+
 namespace CX {
 namespace Util {
 
+	//The batch conversions are done by these kernels. Defining CX_UNIT_CONVERSION_NO_SIMD when compiling CX forces the plain loops to be used.
+	namespace {
+
+		//out[i] = scale * in[i] + offset. `in` and `out` may be the same array.
+		void affineKernel(const float* in, float* out, size_t count, float scale, float offset) {
+			size_t i = 0;
+#if defined(CX_UNIT_CONVERSION_USE_SSE)
+			__m128 s = _mm_set1_ps(scale);
+			__m128 o = _mm_set1_ps(offset);
+			for (; i + 4 <= count; i += 4) {
+				_mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + i), s), o));
+			}
+#elif defined(CX_UNIT_CONVERSION_USE_NEON)
+			float32x4_t s = vdupq_n_f32(scale);
+			float32x4_t o = vdupq_n_f32(offset);
+			for (; i + 4 <= count; i += 4) {
+				vst1q_f32(out + i, vmlaq_f32(o, vld1q_f32(in + i), s));
+			}
+#endif
+			for (; i < count; i++) {
+				out[i] = scale * in[i] + offset;
+			}
+		}
+
+		//Like affineKernel(), but on interleaved x, y, z values with a different scale and offset for each axis.
+		//`points` is the number of xyz triplets.
+		void affineKernel3(const float* in, float* out, size_t points, const float* scale, const float* offset) {
+			size_t count = points * 3;
+			size_t i = 0;
+
+			//The axes repeat every 3 values, so 4 points (12 values) are 3 vectors with the axes in rotating order.
+#if defined(CX_UNIT_CONVERSION_USE_SSE)
+			__m128 s0 = _mm_setr_ps(scale[0], scale[1], scale[2], scale[0]);
+			__m128 s1 = _mm_setr_ps(scale[1], scale[2], scale[0], scale[1]);
+			__m128 s2 = _mm_setr_ps(scale[2], scale[0], scale[1], scale[2]);
+			__m128 o0 = _mm_setr_ps(offset[0], offset[1], offset[2], offset[0]);
+			__m128 o1 = _mm_setr_ps(offset[1], offset[2], offset[0], offset[1]);
+			__m128 o2 = _mm_setr_ps(offset[2], offset[0], offset[1], offset[2]);
+			for (; i + 12 <= count; i += 12) {
+				_mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + i), s0), o0));
+				_mm_storeu_ps(out + i + 4, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), s1), o1));
+				_mm_storeu_ps(out + i + 8, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 8), s2), o2));
+			}
+#elif defined(CX_UNIT_CONVERSION_USE_NEON)
+			float sp[12] = { scale[0], scale[1], scale[2], scale[0], scale[1], scale[2], scale[0], scale[1], scale[2], scale[0], scale[1], scale[2] };
+			float op[12] = { offset[0], offset[1], offset[2], offset[0], offset[1], offset[2], offset[0], offset[1], offset[2], offset[0], offset[1], offset[2] };
+			float32x4_t s0 = vld1q_f32(sp);
+			float32x4_t s1 = vld1q_f32(sp + 4);
+			float32x4_t s2 = vld1q_f32(sp + 8);
+			float32x4_t o0 = vld1q_f32(op);
+			float32x4_t o1 = vld1q_f32(op + 4);
+			float32x4_t o2 = vld1q_f32(op + 8);
+			for (; i + 12 <= count; i += 12) {
+				vst1q_f32(out + i, vmlaq_f32(o0, vld1q_f32(in + i), s0));
+				vst1q_f32(out + i + 4, vmlaq_f32(o1, vld1q_f32(in + i + 4), s1));
+				vst1q_f32(out + i + 8, vmlaq_f32(o2, vld1q_f32(in + i + 8), s2));
+			}
+#endif
+			for (; i < count; i++) {
+				out[i] = scale[i % 3] * in[i] + offset[i % 3];
+			}
+		}
+
+		void roundKernel(float* data, size_t count) {
+			for (size_t i = 0; i < count; i++) {
+				data[i] = CX::Util::round(data[i], 0, CX::Util::CX_RoundingConfiguration::ROUND_TO_NEAREST);
+			}
+		}
+
+		//ofPoint is converted as an array of floats.
+		static_assert(sizeof(ofPoint) == 3 * sizeof(float), "ofPoint must be three packed floats.");
+	}
+
 
 	/*! Returns the number of pixels needed to subtend deg degrees of visual angle. You might want to round this
 	if you want to align to pixel boundaries. However, if you are antialiasing your stimuli you
@@ -29,24 +112,51 @@ namespace Util {
 	// CX_BaseUnitConverter //
 	//////////////////////////
 
-	/*! Applies the unit conversion to a whole vector. */
+	/*! Applies the unit conversion to a whole vector. See convert(). */
 	std::vector<float> CX_BaseUnitConverter::operator() (const std::vector<float>& vx) {
 		std::vector<float> rval(vx.size());
-		for (unsigned int i = 0; i < rval.size(); i++) {
-			rval[i] = this->operator()(vx[i]);
-		}
+		convert(vx.data(), rval.data(), vx.size());
 		return rval;
 	}
 
-	/*! Applies the inverse unit conversion to a whole vector. */
+	/*! Applies the inverse unit conversion to a whole vector. See convertInverse(). */
 	std::vector<float> CX_BaseUnitConverter::inverse(const std::vector<float>& vy) {
 		std::vector<float> rval(vy.size());
-		for (unsigned int i = 0; i < rval.size(); i++) {
-			rval[i] = this->inverse(vy[i]);
-		}
+		convertInverse(vy.data(), rval.data(), vy.size());
 		return rval;
 	}
 
+	/*! Applies the unit conversion to an array of values.
+	\param in The values to convert.
+	\param out Where to put the converted values. It can be the same as `in`, to convert in place.
+	\param count The number of values. */
+	void CX_BaseUnitConverter::convert(const float* in, float* out, size_t count) {
+		float scale;
+		float offset;
+		if (getAffine(&scale, &offset)) {
+			affineKernel(in, out, count, scale, offset);
+			return;
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			out[i] = this->operator()(in[i]);
+		}
+	}
+
+	/*! Applies the inverse unit conversion to an array of values. See convert(). */
+	void CX_BaseUnitConverter::convertInverse(const float* in, float* out, size_t count) {
+		float scale;
+		float offset;
+		if (getAffine(&scale, &offset) && scale != 0) {
+			affineKernel(in, out, count, 1 / scale, -offset / scale);
+			return;
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			out[i] = this->inverse(in[i]);
+		}
+	}
+
 
 	///////////////////////////////
 	// CX_DegreeToPixelConverter //
@@ -148,6 +258,27 @@ namespace Util {
 		return deg;
 	}
 
+	/*! Converts an array of values in degrees to pixels, with the constants of the conversion computed once. See CX_BaseUnitConverter::convert(). */
+	void CX_DegreeToPixelConverter::convert(const float* in, float* out, size_t count) {
+		const float radiansPerDegree = PI / 360; //Half of the angle is used.
+		const float pixelsPerSine = 2 * _viewingDistance * _pixelsPerUnit;
+		for (size_t i = 0; i < count; i++) {
+			out[i] = pixelsPerSine * std::sin(in[i] * radiansPerDegree);
+		}
+		if (_roundResult) {
+			roundKernel(out, count);
+		}
+	}
+
+	/*! Converts an array of values in pixels to degrees. See CX_BaseUnitConverter::convertInverse(). */
+	void CX_DegreeToPixelConverter::convertInverse(const float* in, float* out, size_t count) {
+		const float sinePerPixel = 1 / (2 * _viewingDistance * _pixelsPerUnit);
+		const float degreesPerRadian = 360 / PI;
+		for (size_t i = 0; i < count; i++) {
+			out[i] = degreesPerRadian * std::asin(in[i] * sinePerPixel);
+		}
+	}
+
 	///////////////////////////////
 	// CX_LengthToPixelConverter //
 	///////////////////////////////
@@ -239,6 +370,144 @@ namespace Util {
 		return length;
 	}
 
+	/*! Converts an array of lengths to pixels. See CX_BaseUnitConverter::convert(). */
+	void CX_LengthToPixelConverter::convert(const float* in, float* out, size_t count) {
+		affineKernel(in, out, count, _pixelsPerUnit, 0);
+		if (_roundResult) {
+			roundKernel(out, count);
+		}
+	}
+
+	/*! Converts an array of pixel values to lengths. See CX_BaseUnitConverter::convertInverse(). */
+	void CX_LengthToPixelConverter::convertInverse(const float* in, float* out, size_t count) {
+		affineKernel(in, out, count, 1 / _pixelsPerUnit, 0);
+	}
+
+	/*! The conversion is affine unless the result is rounded. */
+	bool CX_LengthToPixelConverter::getAffine(float* scale, float* offset) const {
+		if (_roundResult) {
+			return false;
+		}
+		*scale = _pixelsPerUnit;
+		*offset = 0;
+		return true;
+	}
+
+	///////////////////////////
+	// CX_UnitConverterChain //
+	///////////////////////////
+
+	/*! Adds a converter to the end of the chain. Values are converted by the converters in the order in which they were appended.
+	\param converter The converter. It is not copied, so it must exist for as long as the chain is used. */
+	void CX_UnitConverterChain::append(CX_BaseUnitConverter* converter) {
+		if (converter != nullptr) {
+			_converters.push_back(converter);
+		}
+	}
+
+	/*! Removes all of the converters from the chain. An empty chain does not change values. */
+	void CX_UnitConverterChain::clear(void) {
+		_converters.clear();
+	}
+
+	/*! Returns the number of converters in the chain. */
+	size_t CX_UnitConverterChain::size(void) const {
+		return _converters.size();
+	}
+
+	/*! Applies each of the converters in order. */
+	float CX_UnitConverterChain::operator() (float x) {
+		for (CX_BaseUnitConverter* c : _converters) {
+			x = (*c)(x);
+		}
+		return x;
+	}
+
+	/*! Applies the inverse of each of the converters, in the reverse order. */
+	float CX_UnitConverterChain::inverse(float y) {
+		for (auto it = _converters.rbegin(); it != _converters.rend(); ++it) {
+			y = (*it)->inverse(y);
+		}
+		return y;
+	}
+
+	/*! Converts an array of values. Consecutive affine converters are combined, so that they are applied in one pass. */
+	void CX_UnitConverterChain::convert(const float* in, float* out, size_t count) {
+		const float* src = in;
+		float scale = 1;
+		float offset = 0;
+
+		for (CX_BaseUnitConverter* c : _converters) {
+			float s;
+			float o;
+			if (c->getAffine(&s, &o)) {
+				scale = s * scale;
+				offset = s * offset + o;
+				continue;
+			}
+
+			if (scale != 1 || offset != 0 || src != out) {
+				affineKernel(src, out, count, scale, offset);
+				src = out;
+				scale = 1;
+				offset = 0;
+			}
+			c->convert(out, out, count);
+		}
+
+		if (scale != 1 || offset != 0 || src != out) {
+			affineKernel(src, out, count, scale, offset);
+		}
+	}
+
+	/*! Converts an array of values with the inverse of the chain. See convert(). */
+	void CX_UnitConverterChain::convertInverse(const float* in, float* out, size_t count) {
+		const float* src = in;
+		float scale = 1;
+		float offset = 0;
+
+		for (auto it = _converters.rbegin(); it != _converters.rend(); ++it) {
+			float s;
+			float o;
+			if ((*it)->getAffine(&s, &o) && s != 0) {
+				//The inverse of y = s * x + o is x = (y - o) / s.
+				scale = scale / s;
+				offset = (offset - o) / s;
+				continue;
+			}
+
+			if (scale != 1 || offset != 0 || src != out) {
+				affineKernel(src, out, count, scale, offset);
+				src = out;
+				scale = 1;
+				offset = 0;
+			}
+			(*it)->convertInverse(out, out, count);
+		}
+
+		if (scale != 1 || offset != 0 || src != out) {
+			affineKernel(src, out, count, scale, offset);
+		}
+	}
+
+	/*! The chain is affine if all of its converters are. */
+	bool CX_UnitConverterChain::getAffine(float* scale, float* offset) const {
+		float totalScale = 1;
+		float totalOffset = 0;
+		for (CX_BaseUnitConverter* c : _converters) {
+			float s;
+			float o;
+			if (!c->getAffine(&s, &o)) {
+				return false;
+			}
+			totalScale = s * totalScale;
+			totalOffset = s * totalOffset + o;
+		}
+		*scale = totalScale;
+		*offset = totalOffset;
+		return true;
+	}
+
 	////////////////////////////
 	// CX_CoordinateConverter //
 	////////////////////////////
@@ -357,30 +626,106 @@ namespace Util {
 		return this->inverse(ofPoint(x, y, z));
 	}
 
-	/*! Applies the conversion on a whole vector of points at once.	
+	/*! Applies the conversion on a whole vector of points at once. See convert().
 	\param p The vector of points to convert.
 	\return The converted points.
 	*/
 	std::vector<ofPoint> CX_CoordinateConverter::operator() (const std::vector<ofPoint>& p) {
 		std::vector<ofPoint> rval(p.size());
-		for (unsigned int i = 0; i < rval.size(); i++) {
-			rval[i] = this->operator()(p[i]);
-		}
+		convert(p.data(), rval.data(), p.size());
 		return rval;
 	}
 
-	/*! Applies the inverse conversion on a whole vector of points at once.	
+	/*! Applies the inverse conversion on a whole vector of points at once. See convertInverse().
 	\param p The vector of points to inverse convert.
 	\return The inverse converted points.
 	*/
 	std::vector<ofPoint> CX_CoordinateConverter::inverse(const std::vector<ofPoint>& p) {
 		std::vector<ofPoint> rval(p.size());
-		for (unsigned int i = 0; i < rval.size(); i++) {
-			rval[i] = this->inverse(p[i]);
-		}
+		convertInverse(p.data(), rval.data(), p.size());
 		return rval;
 	}
 
+	/*! Converts an array of points from user coordinates to standard coordinates, which is the same as using operator() on each
+	point, but much faster for many points, such as the dots of a random dot kinematogram on every frame. If there is no unit
+	converter or it is affine (see CX_BaseUnitConverter::getAffine()), the whole conversion is done in one SIMD pass.
+	\param in The points to convert.
+	\param out Where to put the converted points. It can be the same as `in`, to convert in place.
+	\param count The number of points. */
+	void CX_CoordinateConverter::convert(const ofPoint* in, ofPoint* out, size_t count) {
+		const float* src = &in[0].x;
+		float* dest = &out[0].x;
+		float origin[3] = { _origin.x, _origin.y, _origin.z };
+		float scale[3] = { _multiplier * _inversionCoefficients.x, _multiplier * _inversionCoefficients.y, _multiplier * _inversionCoefficients.z };
+
+		if (count == 0) {
+			return;
+		}
+
+		float s = 1;
+		float o = 0;
+		if (_conv == nullptr || _conv->getAffine(&s, &o)) {
+			float fusedScale[3] = { s * scale[0], s * scale[1], s * scale[2] };
+			float fusedOffset[3] = { o + origin[0], o + origin[1], o + origin[2] };
+			affineKernel3(src, dest, count, fusedScale, fusedOffset);
+			return;
+		}
+
+		const float zero[3] = { 0, 0, 0 };
+		const float one[3] = { 1, 1, 1 };
+		affineKernel3(src, dest, count, scale, zero);
+		_conv->convert(dest, dest, count * 3);
+		affineKernel3(dest, dest, count, one, origin);
+	}
+
+	/*! Converts an array of points in place. See convert(const ofPoint*, ofPoint*, size_t). */
+	void CX_CoordinateConverter::convert(ofPoint* points, size_t count) {
+		convert(points, points, count);
+	}
+
+	/*! Converts an array of points from standard coordinates to user coordinates. This is the inverse of convert().
+	\param in The points to convert.
+	\param out Where to put the converted points. It can be the same as `in`, to convert in place.
+	\param count The number of points. */
+	void CX_CoordinateConverter::convertInverse(const ofPoint* in, ofPoint* out, size_t count) {
+		const float* src = &in[0].x;
+		float* dest = &out[0].x;
+		float scale[3] = {
+			1 / (_multiplier * _inversionCoefficients.x),
+			1 / (_multiplier * _inversionCoefficients.y),
+			1 / (_multiplier * _inversionCoefficients.z)
+		};
+
+		if (count == 0) {
+			return;
+		}
+
+		float s = 1;
+		float o = 0;
+		if (_conv == nullptr || (_conv->getAffine(&s, &o) && s != 0)) {
+			float fusedScale[3] = { scale[0] / s, scale[1] / s, scale[2] / s };
+			float fusedOffset[3] = {
+				-(_origin.x + o) * fusedScale[0],
+				-(_origin.y + o) * fusedScale[1],
+				-(_origin.z + o) * fusedScale[2]
+			};
+			affineKernel3(src, dest, count, fusedScale, fusedOffset);
+			return;
+		}
+
+		const float zero[3] = { 0, 0, 0 };
+		const float one[3] = { 1, 1, 1 };
+		const float negativeOrigin[3] = { -_origin.x, -_origin.y, -_origin.z };
+		affineKernel3(src, dest, count, one, negativeOrigin);
+		_conv->convertInverse(dest, dest, count * 3);
+		affineKernel3(dest, dest, count, scale, zero);
+	}
+
+	/*! Converts an array of points in place with the inverse conversion. See convertInverse(const ofPoint*, ofPoint*, size_t). */
+	void CX_CoordinateConverter::convertInverse(ofPoint* points, size_t count) {
+		convertInverse(points, points, count);
+	}
+
 	/*! Sets the unit converter that will be used when converting the coordinate system.
 	In this way you can convert both the coordinate system in use and the units used by
 	the coordinate system in one step. See CX_DegreeToPixelConverter and
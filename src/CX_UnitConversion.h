@@ -13,9 +13,16 @@ namespace Util {
 
 	/*! This class should be inherited from by any unit converters. You should override 
 	both `operator()` and `inverse()`. `inverse()` should perform the mathematical inverse of 
-	the operation performed by `operator()`. */
+	the operation performed by `operator()`.
+
+	Many values can be converted at once with convert() and convertInverse(), which work on arrays, so they can convert in
+	place and do not allocate. By default, they call `operator()` or `inverse()` for each value. Converters whose conversion
+	is affine (`y = scale * x + offset`) should say so by overriding getAffine(), which lets the batch conversions use a
+	single fused SIMD pass, including when the converter is part of a CX_UnitConverterChain or a CX_CoordinateConverter. */
 	class CX_BaseUnitConverter {
 	public:
+		virtual ~CX_BaseUnitConverter(void) {};
+
 		/*! `operator()` should perform the unit conversion. */
 		virtual float operator() (float x) {
 			return (5 * x) - 2; //y = 5x - 2
@@ -29,6 +36,17 @@ namespace Util {
 		//No need to override these functions unless your conversion does something really unusual.
 		virtual std::vector<float> operator() (const std::vector<float>& vx);
 		virtual std::vector<float> inverse(const std::vector<float>& vy);
+
+		virtual void convert(const float* in, float* out, size_t count);
+		virtual void convertInverse(const float* in, float* out, size_t count);
+
+		/*! If the conversion is affine, i.e. `operator()(x) == scale * x + offset` for all x, this should set `scale`
+		and `offset` and return `true`. Otherwise, it should return `false`, which is the default. */
+		virtual bool getAffine(float* scale, float* offset) const {
+			(void)scale;
+			(void)offset;
+			return false;
+		};
 	};
 
 	/*! This simple utility class is used for converting degrees of visual angle to pixels on a monitor.
@@ -54,6 +72,9 @@ namespace Util {
 		float operator() (float degrees) override;
 		float inverse(float pixels) override;
 
+		void convert(const float* in, float* out, size_t count) override;
+		void convertInverse(const float* in, float* out, size_t count) override;
+
 		bool configureFromFile(std::string filename, std::string delimiter = "=", bool trimWhitespace = true, std::string commentString = "//");
 
 	private:
@@ -86,6 +107,10 @@ namespace Util {
 		float operator() (float length) override;
 		float inverse(float pixels) override;
 
+		void convert(const float* in, float* out, size_t count) override;
+		void convertInverse(const float* in, float* out, size_t count) override;
+		bool getAffine(float* scale, float* offset) const override;
+
 		bool configureFromFile(std::string filename, std::string delimiter = "=", bool trimWhitespace = true, std::string commentString = "//");
 
 	private:
@@ -94,6 +119,43 @@ namespace Util {
 	};
 
 
+	/*! This class applies several unit converters one after another, so that, for example, a conversion from some
+	task-specific unit to degrees of visual angle can be followed by a conversion from degrees to pixels. If every converter
+	in the chain is affine (see CX_BaseUnitConverter::getAffine()), the chain is too, and batch conversions with convert()
+	are done with one fused pass instead of one pass per converter.
+
+	\code{.cpp}
+	CX_LengthToPixelConverter cmToPx(37.8);
+	CX_LengthToPixelConverter mmToCm(0.1);
+	CX_UnitConverterChain mmToPx;
+	mmToPx.append(&mmToCm);
+	mmToPx.append(&cmToPx);
+
+	std::vector<float> lengths = { 1, 2, 5, 10 };
+	mmToPx.convert(lengths.data(), lengths.data(), lengths.size()); //In place, in one pass.
+	\endcode
+
+	The converters are not copied, so they must exist for as long as the chain is used.
+
+	\ingroup utility */
+	class CX_UnitConverterChain : public CX_BaseUnitConverter {
+	public:
+		void append(CX_BaseUnitConverter* converter);
+		void clear(void);
+		size_t size(void) const;
+
+		float operator() (float x) override;
+		float inverse(float y) override;
+
+		void convert(const float* in, float* out, size_t count) override;
+		void convertInverse(const float* in, float* out, size_t count) override;
+		bool getAffine(float* scale, float* offset) const override;
+
+	private:
+		std::vector<CX_BaseUnitConverter*> _converters;
+	};
+
+
 	/*! This helper class is used for converting from a somewhat user-defined coordinate system into
 	the standard computer monitor coordinate system. When user coordinates are input into this class,
 	they will be converted into the standard monitor coordinate system. This lets you use coordinates 
@@ -141,6 +203,11 @@ namespace Util {
 		std::vector<ofPoint> operator() (const std::vector<ofPoint>& p);
 		std::vector<ofPoint> inverse(const std::vector<ofPoint>& p);
 
+		void convert(const ofPoint* in, ofPoint* out, size_t count);
+		void convert(ofPoint* points, size_t count);
+		void convertInverse(const ofPoint* in, ofPoint* out, size_t count);
+		void convertInverse(ofPoint* points, size_t count);
+
 	private:
 		ofPoint _origin;
 		ofPoint _inversionCoefficients;
@@ -207,55 +207,74 @@ namespace Util {
 	that each line is no more than `width` wide. The algorithm attempts to end lines
 	at whitespace, so as to avoid splitting up words. However, if there is no whitespace
 	on a line, the line will be broken just before it would exceed the width
-	and a hyphen is inserted. If the width is absurdly narrow (less than 2 characters),
-	the algorithm will break.
+	and a hyphen is inserted. If the width is absurdly narrow (less than 3 characters),
+	words are split without room for the hyphen.
+
+	To draw a long passage of wrapped text many times, see CX::Draw::TextLayout, which wraps it once.
 	\param s The string to wrap.
 	\param width The maxmimum width of each line of `s`, in pixels.
 	\param font A configured ofTrueTypeFont.
 	\return A string with newlines inserted to keep lines to be less than `width` wide.
 	*/
 	std::string wordWrap(std::string s, float width, ofTrueTypeFont& font) {
-		unsigned int lineStart = 0;
-		unsigned int lastWS = 0;
+		auto isWhitespace = [](char c) {
+			return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+		};
+		auto overflows = [&](size_t start, size_t end) {
+			return font.getStringBoundingBox(s.substr(start, end - start), 0, 0).width >= width;
+		};
+
 		std::vector<std::string> lines;
-		for (unsigned int i = 0; i < s.size(); i++) {
+		size_t lineStart = 0;
+		while (lineStart < s.size()) {
 
-			if (s[i] == ' ' || s[i] == '\t' || s[i] == '\n' || s[i] == '\r') {
-				lastWS = i;
+			if (lineStart + 1 >= s.size() || !overflows(lineStart, s.size() - 1)) {
+				// The rest of s fits, so just accept the last line.
+				lines.push_back(s.substr(lineStart));
+				break;
 			}
 
-			std::string sub = s.substr(lineStart, i - lineStart);
-			float currentW = font.getStringBoundingBox(sub, 0, 0).width;
-
-			if (currentW >= width) {
-
-				if (lastWS > lineStart) {
-					// Whitespace can be found on this line, so split at the whitespace.
-					sub = s.substr(lineStart, lastWS - lineStart + 1);
-					lineStart = lastWS + 1; // Skip the WS
-
+			// Find the first end of the line at which it is too wide. The width only grows as characters are added,
+			// so a binary search only measures a few substrings rather than measuring one substring per character.
+			size_t lo = lineStart + 1;
+			size_t hi = s.size() - 1;
+			while (lo < hi) {
+				size_t mid = lo + (hi - lo) / 2;
+				if (overflows(lineStart, mid)) {
+					hi = mid;
 				} else {
-					//If no whitespace on this line, do the gross thing and split mid-word
+					lo = mid + 1;
+				}
+			}
+			size_t i = lo;
 
-					int poppedChars = 0;
-					if (sub.length() >= 2) {
-						sub.pop_back(); //pop off two letters to 1) make the string shorter and 
-						sub.pop_back(); //2) make room for the hyphen.
-						poppedChars = 2;
-					}
+			size_t lastWS = i;
+			while (lastWS > lineStart && !isWhitespace(s[lastWS])) {
+				lastWS--;
+			}
 
-					sub += '-'; // stick in a lame hyphen
-					lineStart = i - poppedChars;
+			std::string sub;
+			if (lastWS > lineStart) {
+				// Whitespace can be found on this line, so split at the whitespace.
+				sub = s.substr(lineStart, lastWS - lineStart + 1);
+				lineStart = lastWS + 1; // Skip the WS
+
+			} else {
+				//If no whitespace on this line, do the gross thing and split mid-word
+				sub = s.substr(lineStart, i - lineStart);
+
+				size_t poppedChars = 0;
+				if (sub.length() >= 3) {
+					sub.pop_back(); //pop off two letters to 1) make the string shorter and 
+					sub.pop_back(); //2) make room for the hyphen.
+					poppedChars = 2;
 				}
 
-				i = lineStart;
-				lines.push_back(sub);
-
-			} else if (i == s.size() - 1) {
-				// At the end of s, just accept the last line.
-				sub = s.substr(lineStart);
-				lines.push_back(sub);
+				sub += '-'; // stick in a lame hyphen
+				lineStart = i - poppedChars;
 			}
+
+			lines.push_back(sub);
 		}
 
 		std::string rval = "";
@@ -1,57 +1,119 @@
 #include "CX_VideoBufferSwappingThread.h"
 
+#include <climits>
+
 #include "CX_Private.h" //glfwContext
+#include "CX_EventTrace.h"
 
 namespace CX {
 namespace Private {
 
 CX_VideoBufferSwappingThread::CX_VideoBufferSwappingThread(void) :
-	_isLocked(false),
-	_lastSwapTime(0),
+	_snapshotSequence(0),
 	_frameCount(0),
+	_lastSwapNanos(0),
 	_frameCountOnLastCheck(0),
 	_swapsBeforeStop(-1),
-	_glFinishAfterSwap(false)
+	_glFinishAfterSwap(false),
+	_presentationTimestamps(nullptr),
+	_waiterCount(0),
+	_window(nullptr),
+	_contextReady(false),
+	_requestedSwaps(0),
+	_automaticSwapping(false),
+	_requestedSwapInterval(1),
+	_appliedSwapInterval(INT_MIN),
+	_requestedSwapGroup(0),
+	_joinedSwapGroup(0),
+	_pendingSlot(-1),
+	_shownSlot(-1),
+	_windowWidth(0),
+	_windowHeight(0),
+	_readFramebuffer(0)
 {
+	for (SharedFrame& frame : _frames) {
+		frame.texture = 0;
+		frame.textureTarget = GL_TEXTURE_2D;
+		frame.width = 0;
+		frame.height = 0;
+		frame.renderedFence = nullptr;
+		frame.readFence = nullptr;
+	}
 }
 
 void CX_VideoBufferSwappingThread::threadedFunction(void) {
 
+	CX::Instances::EventTrace.nameThread("CX video buffer swapping");
+
+	GLFWwindow* window = CX::Private::glfwContext;
+	if (_window != nullptr) {
+		window = _window;
+		glfwMakeContextCurrent(_window);
+
+		//The presentation timestamps look up functions of the context, so they are set up where the context is current.
+		CX_PresentationTimestamps* timestamps = _presentationTimestamps.load(std::memory_order_acquire);
+		if (timestamps) {
+			timestamps->setup(_window);
+		}
+		_contextReady = true;
+		_notifyWaiters();
+	}
+
 	while (isThreadRunning()) {
 
-		bool glFinishAfterSwap = false;
-		if (lock()) {
-			glFinishAfterSwap = _glFinishAfterSwap;
-			unlock();
+		if (_window != nullptr && !_waitForSwapRequest()) {
+			break;
 		}
 
-		glfwSwapBuffers(CX::Private::glfwContext);
+		bool glFinishAfterSwap = _glFinishAfterSwap.load(std::memory_order_relaxed);
+
+		CX::Instances::EventTrace.begin(CX_EventTrace::Event::BUFFER_SWAP);
+
+		if (_window != nullptr) {
+			_applyWindowSettings();
+			_presentSharedFrame();
+		}
+
+		glfwSwapBuffers(window);
 		if (glFinishAfterSwap) {
 			glFinish();
 		}
 
 		CX_Millis swapTime = CX::Instances::Clock.now();
+		CX_PresentationTimestamps* timestamps = _presentationTimestamps.load(std::memory_order_acquire);
+		if (timestamps) {
+			swapTime = timestamps->getSwapTime(swapTime);
+		}
 
-		if (lock()) {
-
-			++_frameCount;
+		_publishSwap(swapTime);
 
-			_lastSwapTime = swapTime;
+		CX::Instances::EventTrace.end(CX_EventTrace::Event::BUFFER_SWAP, _frameCount.load(std::memory_order_relaxed));
 
-			bool stopSwapping = false;
-			if (_swapsBeforeStop > 0) {
-				if (--_swapsBeforeStop == 0) {
-					stopSwapping = true;
-				}
+		if (_window != nullptr) {
+			std::lock_guard<std::mutex> lock(_requestMutex);
+			if (_requestedSwaps > 0) {
+				_requestedSwaps--;
+			}
+		} else {
+			//A negative count means to swap until the thread is stopped.
+			int remainingSwaps = _swapsBeforeStop.load(std::memory_order_relaxed);
+			while (remainingSwaps > 0 && !_swapsBeforeStop.compare_exchange_weak(remainingSwaps, remainingSwaps - 1)) {
 			}
 
-			unlock();
-
-			if (stopSwapping) {
+			if (remainingSwaps == 1) {
 				this->stopThread();
 			}
 		}
+
+		_notifyWaiters();
 	}
+
+	if (_window != nullptr) {
+		glfwMakeContextCurrent(nullptr);
+	}
+
+	//Wake anyone waiting for a swap that will not come.
+	_notifyWaiters();
 }
 
 
@@ -60,73 +122,296 @@ void CX_VideoBufferSwappingThread::swapNFrames(int n) {
 		return;
 	}
 
+	if (_window != nullptr) {
+		{
+			std::lock_guard<std::mutex> lock(_requestMutex);
+			_requestedSwaps += n;
+		}
+		_requestCondition.notify_one();
+		return;
+	}
+
+	_swapsBeforeStop.store(n);
 	if (!this->isThreadRunning()) {
-		_swapsBeforeStop = n;
+		this->waitForThread(false); //A thread that stopped itself after its last swap may not have returned yet.
 		this->startThread(true);
-	} else {
-		if (_lockMutex()) {
-			_swapsBeforeStop = n;
-			_unlockMutex();
-		}
 	}
 }
 
-bool CX_VideoBufferSwappingThread::hasSwappedSinceLastCheck(void) {
-	bool rval = false;
-	if (_lockMutex()) {
-		if (_frameCount != _frameCountOnLastCheck) {
-			_frameCountOnLastCheck = _frameCount;
-			rval = true;
+//For the main window, the thread runs only while swapping automatically. A thread with its own window keeps running
+//and only starts or stops swapping every frame.
+void CX_VideoBufferSwappingThread::setAutomaticSwapping(bool autoSwap) {
+	if (_window != nullptr) {
+		{
+			std::lock_guard<std::mutex> lock(_requestMutex);
+			_automaticSwapping = autoSwap;
+		}
+		_requestCondition.notify_one();
+		return;
+	}
+
+	if (autoSwap) {
+		if (!this->isThreadRunning()) {
+			this->waitForThread(false);
+			_swapsBeforeStop.store(-1);
+			this->startThread(true);
+		}
+	} else {
+		if (this->isThreadRunning()) {
+			this->stopThread();
+			this->waitForThread();
 		}
-		_unlockMutex();
 	}
-	return rval;
 }
 
-CX_Millis CX_VideoBufferSwappingThread::getLastSwapTime(void) {
-	CX_Millis lastSwapTime = 0;
-	if (_lockMutex()) {
-		lastSwapTime = _lastSwapTime;
-		_unlockMutex();
+bool CX_VideoBufferSwappingThread::isAutomaticallySwapping(void) const {
+	if (_window != nullptr) {
+		return _automaticSwapping.load();
 	}
-	return lastSwapTime;
+	return this->isThreadRunning();
 }
 
-uint64_t CX_VideoBufferSwappingThread::getFrameNumber(void) {
-	uint64_t frameNumber = 0;
-	if (_lockMutex()) {
-		frameNumber = _frameCount;
-		_unlockMutex();
+//Stops the thread and waits for it to release the context of its window, if any.
+void CX_VideoBufferSwappingThread::stop(void) {
+	{
+		std::lock_guard<std::mutex> lock(_requestMutex);
+		this->stopThread();
 	}
-	return frameNumber;
+	_requestCondition.notify_all();
+	this->waitForThread(false);
 }
 
-void CX_VideoBufferSwappingThread::setGLFinishAfterSwap(bool finishAfterSwap) {
-	if (_lockMutex()) {
-		_glFinishAfterSwap = finishAfterSwap;
-		_unlockMutex();
+//Only for threads with their own window. Waits until the context of the window is current on the thread, which must
+//have been started. Returns false if that did not happen within the timeout.
+bool CX_VideoBufferSwappingThread::waitForContext(CX_Millis timeout) {
+	if (_contextReady) {
+		return true;
 	}
+
+	std::unique_lock<std::mutex> lock(_waitMutex);
+	_waiterCount++;
+	_swapCondition.wait_for(lock, std::chrono::nanoseconds(timeout.nanos()), [this](void) {
+		return _contextReady.load() || !isThreadRunning();
+	});
+	_waiterCount--;
+
+	return _contextReady;
 }
 
+//Sleeps until a swap is requested or automatic swapping is on. Returns false if the thread was stopped.
+bool CX_VideoBufferSwappingThread::_waitForSwapRequest(void) {
+	std::unique_lock<std::mutex> lock(_requestMutex);
+	_requestCondition.wait(lock, [this](void) {
+		return _requestedSwaps > 0 || _automaticSwapping || !isThreadRunning();
+	});
+	return isThreadRunning();
+}
 
-bool CX_VideoBufferSwappingThread::_lockMutex(void) {
-	if (_isLocked) {
+//True if the thread will not swap again without a new request.
+bool CX_VideoBufferSwappingThread::_isIdle(void) const {
+	if (!isThreadRunning()) {
 		return true;
 	}
+	return _window != nullptr && !_automaticSwapping && _requestedSwaps == 0;
+}
 
-	if (lock()) {
-		_isLocked = true;
+bool CX_VideoBufferSwappingThread::hasSwappedSinceLastCheck(void) {
+	uint64_t frameCount = _frameCount.load(std::memory_order_acquire);
+	if (frameCount != _frameCountOnLastCheck) {
+		_frameCountOnLastCheck = frameCount;
 		return true;
 	}
 	return false;
 }
 
-bool CX_VideoBufferSwappingThread::_unlockMutex(void) {
-	_isLocked = false;
-	unlock();
-	return true;
+CX_Millis CX_VideoBufferSwappingThread::getLastSwapTime(void) const {
+	return getSwapSnapshot().swapTime;
+}
+
+uint64_t CX_VideoBufferSwappingThread::getFrameNumber(void) const {
+	return _frameCount.load(std::memory_order_acquire);
+}
+
+//Reads the frame count and swap time without locking. If a swap is published while they are being read, they are read again.
+CX_VideoBufferSwappingThread::SwapSnapshot CX_VideoBufferSwappingThread::getSwapSnapshot(void) const {
+	SwapSnapshot snapshot;
+	uint64_t before;
+	uint64_t after;
+	do {
+		before = _snapshotSequence.load(std::memory_order_acquire);
+		snapshot.frameCount = _frameCount.load(std::memory_order_relaxed);
+		snapshot.swapTime = CX_Nanos(_lastSwapNanos.load(std::memory_order_relaxed));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		after = _snapshotSequence.load(std::memory_order_relaxed);
+	} while ((before & 1) || before != after);
+
+	return snapshot;
+}
+
+//Blocks until the frame count is greater than afterFrame, the thread stops swapping, or the timeout expires.
+//Returns true if the frame count is greater than afterFrame.
+bool CX_VideoBufferSwappingThread::waitForSwap(CX_Millis timeout, uint64_t afterFrame) {
+	auto swapped = [this, afterFrame](void) {
+		return _frameCount.load() > afterFrame;
+	};
+
+	if (swapped()) {
+		return true;
+	}
+
+	std::unique_lock<std::mutex> lock(_waitMutex);
+	_waiterCount++;
+	_swapCondition.wait_for(lock, std::chrono::nanoseconds(timeout.nanos()), [this, &swapped](void) {
+		return swapped() || _isIdle();
+	});
+	_waiterCount--;
+
+	return swapped();
+}
+
+void CX_VideoBufferSwappingThread::setGLFinishAfterSwap(bool finishAfterSwap) {
+	_glFinishAfterSwap.store(finishAfterSwap);
+}
+
+//The swap times are taken from `timestamps` if it is not null. It must outlive the thread.
+void CX_VideoBufferSwappingThread::setPresentationTimestamps(CX_PresentationTimestamps* timestamps) {
+	_presentationTimestamps.store(timestamps, std::memory_order_release);
+}
+
+//Makes the thread swap `window` instead of the main window. Must be called from the main thread before the thread is started.
+void CX_VideoBufferSwappingThread::setWindow(GLFWwindow* window) {
+	_window = window;
+
+	std::lock_guard<std::mutex> lock(_frameMutex);
+	glfwGetFramebufferSize(_window, &_windowWidth, &_windowHeight);
+}
+
+//Only for threads with their own window. Applied on the swapping thread before the next swap.
+void CX_VideoBufferSwappingThread::setSwapInterval(int interval) {
+	_requestedSwapInterval.store(interval);
+}
+
+//Only for threads with their own window. Group 0 leaves the current swap group.
+void CX_VideoBufferSwappingThread::setSwapGroup(unsigned int group) {
+	_requestedSwapGroup.store(group);
+}
+
+//Hands a frame that was rendered in the main context to the swapping thread, which shows it from the next swap on.
+//The frame in `slot` must not be rendered into again until the fence from takeReadFence() for that slot is waited for.
+//`windowWidth` and `windowHeight` are the current size of the framebuffer of the window, which must be read on the main thread.
+void CX_VideoBufferSwappingThread::submitFrame(unsigned int slot, GLuint texture, GLenum textureTarget, int width, int height, GLsync renderedFence,
+	int windowWidth, int windowHeight)
+{
+	std::lock_guard<std::mutex> lock(_frameMutex);
+
+	SharedFrame& frame = _frames[slot];
+	if (frame.renderedFence != nullptr) {
+		glDeleteSync(frame.renderedFence);
+	}
+	frame.texture = texture;
+	frame.textureTarget = textureTarget;
+	frame.width = width;
+	frame.height = height;
+	frame.renderedFence = renderedFence;
+
+	_windowWidth = windowWidth;
+	_windowHeight = windowHeight;
+
+	_pendingSlot = slot;
+}
+
+//Returns a fence that is signaled when the swapping thread is done reading the frame in `slot`, or nullptr if it has
+//not read it. The caller owns the fence.
+GLsync CX_VideoBufferSwappingThread::takeReadFence(unsigned int slot) {
+	std::lock_guard<std::mutex> lock(_frameMutex);
+	GLsync fence = _frames[slot].readFence;
+	_frames[slot].readFence = nullptr;
+	return fence;
+}
+
+void CX_VideoBufferSwappingThread::_applyWindowSettings(void) {
+	int interval = _requestedSwapInterval.load();
+	if (interval != _appliedSwapInterval) {
+		glfwSwapInterval(interval);
+		_appliedSwapInterval = interval;
+	}
+
+	unsigned int group = _requestedSwapGroup.load();
+	if (group != _joinedSwapGroup) {
+		if (!CX::Private::joinSwapGroup(group)) {
+			CX::Instances::Log.warning("CX_Display") << "Swap group " << group << " could not be joined. Swaps of this display are not synchronized with other displays.";
+		}
+		_joinedSwapGroup = group;
+	}
+}
+
+//Copies the newest frame into the back buffer of the window. The whole copy is done while holding the frame mutex,
+//so that the read fence of a slot always covers the last copy from it.
+void CX_VideoBufferSwappingThread::_presentSharedFrame(void) {
+	std::lock_guard<std::mutex> lock(_frameMutex);
+
+	if (_pendingSlot >= 0) {
+		SharedFrame& pending = _frames[_pendingSlot];
+		if (pending.renderedFence != nullptr) {
+			glWaitSync(pending.renderedFence, 0, GL_TIMEOUT_IGNORED);
+			glDeleteSync(pending.renderedFence);
+			pending.renderedFence = nullptr;
+		}
+		_shownSlot = _pendingSlot;
+		_pendingSlot = -1;
+	}
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glDrawBuffer(GL_BACK);
+
+	if (_shownSlot < 0) {
+		glClearColor(0, 0, 0, 1);
+		glClear(GL_COLOR_BUFFER_BIT);
+		return;
+	}
+
+	SharedFrame& frame = _frames[_shownSlot];
+
+	//Textures are shared between the contexts, but framebuffers are not, so this context needs its own to read from.
+	if (_readFramebuffer == 0) {
+		glGenFramebuffers(1, &_readFramebuffer);
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, _readFramebuffer);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, frame.textureTarget, frame.texture, 0);
+
+	//The frame is upside down in the texture, as in CX_Display::copyFboToBackBuffer().
+	glBlitFramebuffer(0, 0, frame.width, frame.height, 0, _windowHeight, _windowWidth, 0, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	if (frame.readFence != nullptr) {
+		glDeleteSync(frame.readFence);
+	}
+	frame.readFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void CX_VideoBufferSwappingThread::_publishSwap(CX_Millis swapTime) {
+	uint64_t sequence = _snapshotSequence.load(std::memory_order_relaxed);
+	_snapshotSequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	_lastSwapNanos.store(swapTime.nanos(), std::memory_order_relaxed);
+	_frameCount.store(_frameCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+	_snapshotSequence.store(sequence + 2, std::memory_order_release);
+}
+
+//The mutex is only taken if someone is waiting, so the swapping thread does not contend with the main thread when nobody is.
+void CX_VideoBufferSwappingThread::_notifyWaiters(void) {
+	//The fence keeps the frame count from being published after the waiter count is read, which could miss a waiter.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (_waiterCount.load() > 0) {
+		{
+			std::lock_guard<std::mutex> lock(_waitMutex);
+		}
+		_swapCondition.notify_all();
+	}
 }
 
 
 } //namespace Private
-} //namespace CX
\ No newline at end of file
+} //namespace CX
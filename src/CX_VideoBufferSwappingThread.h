@@ -1,8 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
 #include "ofThread.h"
 
 #include "CX_Clock.h"
+#include "CX_PresentationTimestamps.h"
+
+struct GLFWwindow;
 
 namespace CX {
 namespace Private {
@@ -10,33 +17,107 @@ namespace Private {
 	class CX_VideoBufferSwappingThread : public ofThread {
 	public:
 
+		//The frame count and the time of the swap that produced it, which are always read together.
+		struct SwapSnapshot {
+			uint64_t frameCount;
+			CX_Millis swapTime;
+		};
+
 		CX_VideoBufferSwappingThread(void);
 
 		void threadedFunction(void) override;
 
 		void swapNFrames(int n);
+		void setAutomaticSwapping(bool autoSwap);
+		bool isAutomaticallySwapping(void) const;
+		void stop(void);
+
 		bool hasSwappedSinceLastCheck(void);
-		CX_Millis getLastSwapTime(void);
-		uint64_t getFrameNumber(void);
+		CX_Millis getLastSwapTime(void) const;
+		uint64_t getFrameNumber(void) const;
+		SwapSnapshot getSwapSnapshot(void) const;
+
+		bool waitForSwap(CX_Millis timeout, uint64_t afterFrame);
 
 		void setGLFinishAfterSwap(bool finishAfterSwap);
+		void setPresentationTimestamps(CX_PresentationTimestamps* timestamps);
+
+		//For displays that have their own window (see CX_Display::setupWindow()). The context of the window is only
+		//current on this thread, so the settings that belong to the context are applied here, and frames that were
+		//rendered in the main context are copied into the back buffer of the window before each swap. The thread is
+		//started once with startThread() and runs until stop(), waiting for swap requests in between, so that the
+		//context is never current on two threads.
+		void setWindow(GLFWwindow* window);
+		bool waitForContext(CX_Millis timeout);
+		void setSwapInterval(int interval);
+		void setSwapGroup(unsigned int group);
+		void submitFrame(unsigned int slot, GLuint texture, GLenum textureTarget, int width, int height, GLsync renderedFence,
+			int windowWidth, int windowHeight);
+		GLsync takeReadFence(unsigned int slot);
 
 	private:
 
-		bool _lockMutex(void);
-		bool _unlockMutex(void);
-		bool _isLocked;
-
-		CX_Millis _lastSwapTime;
-
-		uint64_t _frameCount;
-		uint64_t _frameCountOnLastCheck;
-
-		int _swapsBeforeStop;
-
-		bool _glFinishAfterSwap;
+		//The swap snapshot is published by the swapping thread with a sequence lock, so that readers
+		//never take a mutex and never see a frame count and swap time from different swaps.
+		std::atomic<uint64_t> _snapshotSequence;
+		std::atomic<uint64_t> _frameCount;
+		std::atomic<int64_t> _lastSwapNanos;
+
+		void _publishSwap(CX_Millis swapTime);
+
+		uint64_t _frameCountOnLastCheck; //Only used by the thread that calls hasSwappedSinceLastCheck().
+
+		std::atomic<int> _swapsBeforeStop;
+		std::atomic<bool> _glFinishAfterSwap;
+		std::atomic<CX_PresentationTimestamps*> _presentationTimestamps;
+
+		//Threads that are in waitForSwap() sleep on this.
+		std::mutex _waitMutex;
+		std::condition_variable _swapCondition;
+		std::atomic<int> _waiterCount;
+
+		void _notifyWaiters(void);
+
+		GLFWwindow* _window; //nullptr for the main window.
+		std::atomic<bool> _contextReady; //Set once the context of the window is current on this thread.
+
+		//Swap requests for threads with their own window. The counts are only changed while holding the mutex.
+		std::mutex _requestMutex;
+		std::condition_variable _requestCondition;
+		std::atomic<int> _requestedSwaps;
+		std::atomic<bool> _automaticSwapping;
+
+		bool _waitForSwapRequest(void);
+		bool _isIdle(void) const;
+
+		std::atomic<int> _requestedSwapInterval;
+		int _appliedSwapInterval; //Only used by the swapping thread.
+		std::atomic<unsigned int> _requestedSwapGroup;
+		unsigned int _joinedSwapGroup; //Only used by the swapping thread.
+
+		//A frame rendered in the main context. The rendered fence is signaled when the rendering is done and
+		//the read fence is signaled when this thread is done copying the frame into the window.
+		struct SharedFrame {
+			GLuint texture;
+			GLenum textureTarget;
+			int width;
+			int height;
+			GLsync renderedFence;
+			GLsync readFence;
+		};
+
+		std::mutex _frameMutex;
+		SharedFrame _frames[2];
+		int _pendingSlot;
+		int _shownSlot;
+		int _windowWidth; //The size of the framebuffer of the window. GLFW window functions may only be called on the main thread,
+		int _windowHeight; //so it is read there and passed in with each frame.
+		GLuint _readFramebuffer; //Belongs to the context of the window, so it is only used by the swapping thread.
+
+		void _applyWindowSettings(void);
+		void _presentSharedFrame(void);
 
 	};
 
 }
-}
\ No newline at end of file
+}
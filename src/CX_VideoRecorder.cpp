@@ -0,0 +1,275 @@
+#include "CX_VideoRecorder.h"
+
+#include <cmath>
+
+#include "ofImage.h"
+#include "ofAppRunner.h"
+#include "ofFileUtils.h"
+
+#include "CX_Private.h" //glVersionAtLeast
+#include "CX_Logger.h"
+#include "CX_Display.h"
+
+#ifdef TARGET_WIN32
+#define CX_POPEN _popen
+#define CX_PCLOSE _pclose
+#define CX_POPEN_MODE "wb"
+#else
+#include <csignal>
+#define CX_POPEN popen
+#define CX_PCLOSE pclose
+#define CX_POPEN_MODE "w"
+#endif
+
+namespace CX {
+
+CX_VideoRecorder::CX_VideoRecorder(void) :
+	_recording(false),
+	_pipe(nullptr),
+	_pipeFailed(false),
+	_lastSwappedFrame(0),
+	_renderedCount(0),
+	_recordedCount(0)
+{}
+
+CX_VideoRecorder::~CX_VideoRecorder(void) {
+	stop();
+}
+
+/*! Starts recording. If the recorder was already recording, the previous recording is stopped first. Must be called from
+the main thread after the window has been opened. The size of the recorded frames is fixed when recording starts; if the
+resolution of the display changes, frames are stretched to that size.
+\param config The configuration.
+\return `true` if recording started, `false` if there was an error, which is logged. */
+bool CX_VideoRecorder::start(Configuration config) {
+	stop();
+
+	if (!CX::Private::glVersionAtLeast(3, 0)) {
+		CX::Instances::Log.error("CX_VideoRecorder") << "start(): OpenGL 3.0 or newer is needed to scale frames on the GPU.";
+		return false;
+	}
+
+	if (config.output == Output::ENCODER_PIPE && config.encoderCommand.empty()) {
+		CX::Instances::Log.error("CX_VideoRecorder") << "start(): The output is ENCODER_PIPE, but no encoderCommand was given.";
+		return false;
+	}
+
+	config.scale = std::min(std::max(config.scale, 0.01f), 1.0f);
+	config.frameInterval = std::max(config.frameInterval, 1u);
+	_config = config;
+
+	ofDirectory::createDirectory(_config.directory, true, true);
+
+	//Even sizes, because many video encoders need them.
+	int width = std::max(2, 2 * (int)std::floor(ofGetWidth() * _config.scale / 2));
+	int height = std::max(2, 2 * (int)std::floor(ofGetHeight() * _config.scale / 2));
+	_scaledFbo.allocate(width, height, GL_RGB, 0);
+
+	//A multisampled back buffer can't be scaled while it is resolved, so it is resolved into a full size framebuffer first.
+	GLint samples = 0;
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glGetIntegerv(GL_SAMPLES, &samples);
+	if (samples > 0) {
+		_resolveFbo.allocate(ofGetWidth(), ofGetHeight(), GL_RGB, 0);
+	}
+
+	CX_FrameCapture::Configuration captureConfig;
+	captureConfig.workerThreads = (_config.output == Output::ENCODER_PIPE) ? 1 : _config.encoderThreads; //One worker keeps frames in order.
+	captureConfig.maxQueuedFrames = _config.maxQueuedFrames;
+	if (!_capture.setup(captureConfig)) {
+		return false;
+	}
+
+	if (_config.output == Output::ENCODER_PIPE) {
+		double fps = 1000.0 / (CX::Instances::Disp.getFramePeriod().millis() * _config.frameInterval);
+
+		std::string command = _config.encoderCommand;
+		ofStringReplace(command, "{width}", ofToString(width));
+		ofStringReplace(command, "{height}", ofToString(height));
+		ofStringReplace(command, "{fps}", ofToString(fps, 3));
+
+#ifndef TARGET_WIN32
+		//If the encoder exits early, writing to the pipe should fail instead of killing the program.
+		std::signal(SIGPIPE, SIG_IGN);
+#endif
+		_pipe = CX_POPEN(command.c_str(), CX_POPEN_MODE);
+		if (_pipe == nullptr) {
+			CX::Instances::Log.error("CX_VideoRecorder") << "start(): The encoder could not be started with the command \"" << command << "\".";
+			_capture.shutdown();
+			return false;
+		}
+		_pipeFailed = false;
+	}
+
+	_timestamps.open(ofToDataPath(_config.directory + "/timestamps.csv").c_str(), std::ios::out | std::ios::trunc);
+	if (!_timestamps.is_open()) {
+		CX::Instances::Log.warning("CX_VideoRecorder") << "start(): The timestamps file could not be opened. Frames are still recorded.";
+	} else {
+		_timestamps << "videoFrame,displayFrame,renderTime,swapTime" << std::endl;
+	}
+
+	_pendingRows.clear();
+	_lastSwappedFrame = CX::Instances::Disp.getFrameNumber();
+	_renderedCount = 0;
+	_recordedCount = 0;
+	_recording = true;
+
+	return true;
+}
+
+/*! Stops recording, waiting for all of the recorded frames to be written and for the encoder, if any, to exit. */
+void CX_VideoRecorder::stop(void) {
+	if (!_recording) {
+		return;
+	}
+	_recording = false;
+
+	_capture.shutdown();
+	_closePipe();
+
+	for (auto& it : _pendingRows) {
+		_writeRow(it.first, it.second, false, CX_Millis(0));
+	}
+	_pendingRows.clear();
+	_timestamps.close();
+
+	_scaledFbo.allocate(0, 0); //"Deallocate" the framebuffers
+	_resolveFbo.allocate(0, 0);
+
+	if (_capture.getDroppedCount() > 0) {
+		CX::Instances::Log.warning("CX_VideoRecorder") << "stop(): " << _capture.getDroppedCount() << " frames were dropped because the encoder fell behind.";
+	}
+}
+
+/*! Returns `true` if the recorder is recording. */
+bool CX_VideoRecorder::isRecording(void) const {
+	return _recording;
+}
+
+/*! Returns the number of frames that have been recorded since recording started. It includes frames that are still being written. */
+uint64_t CX_VideoRecorder::getRecordedFrameCount(void) const {
+	return _recordedCount;
+}
+
+/*! Returns the number of frames that were dropped because the encoder fell behind. */
+uint64_t CX_VideoRecorder::getDroppedFrameCount(void) const {
+	return _capture.getDroppedCount();
+}
+
+/*! Records the frame in the back buffer, if recording and if it is one of the frames that should be recorded.
+This is called by CX_Display::endDrawingToBackBuffer(), so you should not need to call it.
+\param frameNumber The display frame number that the frame will be presented as. */
+void CX_VideoRecorder::frameRendered(uint64_t frameNumber) {
+	if (!_recording) {
+		return;
+	}
+
+	if ((_renderedCount++ % _config.frameInterval) != 0) {
+		return;
+	}
+
+	if (_pipeFailed) {
+		return;
+	}
+
+	//Scale the back buffer into the small framebuffer. This is done by the GPU and does not block.
+	GLint width = ofGetWidth();
+	GLint height = ofGetHeight();
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	if (_resolveFbo.isAllocated()) {
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _resolveFbo.getFbo());
+		glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, _resolveFbo.getFbo());
+		width = std::min<GLint>(width, _resolveFbo.getWidth());
+		height = std::min<GLint>(height, _resolveFbo.getHeight());
+	}
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _scaledFbo.getFbo());
+	glBlitFramebuffer(0, 0, width, height, 0, 0, _scaledFbo.getWidth(), _scaledFbo.getHeight(), GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+	uint64_t videoFrame = _recordedCount;
+
+	CX_FrameCapture::PixelConsumer consumer;
+	if (_config.output == Output::IMAGE_SEQUENCE) {
+		std::string path = ofToDataPath(_config.directory + "/frame_" + ofToString(videoFrame, 6, '0') + "." + _config.imageExtension);
+		consumer = [path](ofPixels& pixels, const CX_FrameCapture::FrameInfo&) {
+			pixels.mirror(true, false); //The blit keeps the bottom-up row order of the back buffer.
+			ofSaveImage(pixels, path, OF_IMAGE_QUALITY_HIGH);
+		};
+	} else {
+		consumer = [this](ofPixels& pixels, const CX_FrameCapture::FrameInfo&) {
+			if (_pipeFailed) {
+				return;
+			}
+			pixels.mirror(true, false);
+			size_t bytes = (size_t)pixels.getWidth() * pixels.getHeight() * pixels.getNumChannels();
+			if (fwrite(pixels.getPixels(), 1, bytes, _pipe) != bytes) {
+				_pipeFailed = true;
+				CX::Instances::Log.error("CX_VideoRecorder") << "Writing to the encoder failed. Recording stopped.";
+			}
+		};
+	}
+
+	if (!_capture.capture(_scaledFbo, consumer)) {
+		return;
+	}
+
+	PendingRow row;
+	row.videoFrame = videoFrame;
+	row.renderTime = CX::Instances::Clock.now();
+	_pendingRows.insert(std::make_pair(frameNumber, row));
+
+	_recordedCount++;
+}
+
+/*! Tells the recorder that a buffer swap happened, so that the swap time can be written for the frames that it presented.
+This is called by CX_Display, so you should not need to call it.
+\param frameNumber The display frame number after the swap.
+\param swapTime The time of the swap. */
+void CX_VideoRecorder::frameSwapped(uint64_t frameNumber, CX_Millis swapTime) {
+	if (!_recording || frameNumber == _lastSwappedFrame) {
+		return;
+	}
+	_lastSwappedFrame = frameNumber;
+
+	//Frames drawn for earlier swaps that were not seen are written without a swap time.
+	auto end = _pendingRows.upper_bound(frameNumber);
+	for (auto it = _pendingRows.begin(); it != end; ++it) {
+		bool swapKnown = (it->first == frameNumber);
+		_writeRow(it->first, it->second, swapKnown, swapTime);
+	}
+	_pendingRows.erase(_pendingRows.begin(), end);
+}
+
+/*! Hands recorded frames that have been read back to the encoder. This is called by CX_Display::beginDrawingToBackBuffer(),
+so you should not need to call it. */
+void CX_VideoRecorder::update(void) {
+	if (_recording) {
+		_capture.update();
+	}
+}
+
+void CX_VideoRecorder::_writeRow(uint64_t displayFrame, const PendingRow& row, bool swapKnown, CX_Millis swapTime) {
+	if (!_timestamps.is_open()) {
+		return;
+	}
+
+	_timestamps << row.videoFrame << "," << displayFrame << "," << row.renderTime.millis() << ",";
+	if (swapKnown) {
+		_timestamps << swapTime.millis();
+	}
+	_timestamps << "\n";
+}
+
+void CX_VideoRecorder::_closePipe(void) {
+	if (_pipe) {
+		int status = CX_PCLOSE(_pipe);
+		if (status != 0) {
+			CX::Instances::Log.warning("CX_VideoRecorder") << "The encoder exited with status " << status << ".";
+		}
+		_pipe = nullptr;
+	}
+}
+
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+
+#include "ofFbo.h"
+
+#include "CX_Clock.h"
+#include "CX_FrameCapture.h"
+
+namespace CX {
+
+	/*! This class records what is shown on the display, so that there is a record of exactly what participants saw.
+	Every frame that is drawn to the back buffer (or every Nth frame) is scaled down on the GPU and read back asynchronously
+	with a CX_FrameCapture, then written by worker threads, either as a sequence of image files or by piping raw frames to an
+	external encoder such as ffmpeg, which can use a hardware video encoder. The work that is left on the main thread is queuing
+	the scaled copy and the readback, then copying the small frame out of its pixel buffer a frame or two later.
+
+	Alongside the video, a file called "timestamps.csv" is written in the output directory with one row per recorded frame:
+	the number of the video frame, the display frame number (see CX_Display::getFrameNumber()) that the frame was drawn for,
+	the time at which drawing into the back buffer ended, and the time of the buffer swap that presented the frame. The swap
+	time is only known if the frame was swapped in with CX_Display::swapBuffers() or if beginDrawingToBackBuffer() was called
+	again after the swap; otherwise it is left empty.
+
+	The recorder of the display is at CX_Display::getVideoRecorder(). Frames are recorded in CX_Display::endDrawingToBackBuffer(),
+	so everything that is drawn with CX_Display, including slides from CX_SlidePresenter, is recorded.
+
+	\code{.cpp}
+	CX_VideoRecorder::Configuration config;
+	config.directory = "session_video";
+	config.scale = 0.5;
+	//Optionally, to make a video file with ffmpeg instead of images:
+	//config.output = CX_VideoRecorder::Output::ENCODER_PIPE;
+	//config.encoderCommand = "ffmpeg -y -f rawvideo -pix_fmt rgb24 -s {width}x{height} -r {fps} -i - -c:v libx264 session.mp4";
+
+	Disp.getVideoRecorder().start(config);
+	//Run the experiment...
+	Disp.getVideoRecorder().stop();
+	\endcode
+
+	\ingroup video
+	*/
+	class CX_VideoRecorder {
+	public:
+
+		/*! Where recorded frames go. */
+		enum class Output {
+			IMAGE_SEQUENCE, //!< Each frame is saved as an image file in the output directory, named "frame_<N>.<imageExtension>".
+			ENCODER_PIPE //!< Raw RGB frames, top row first, are written to the standard input of `encoderCommand`, in order.
+		};
+
+		/*! The configuration of a CX_VideoRecorder. */
+		struct Configuration {
+			Configuration(void) :
+				directory("video"),
+				output(Output::IMAGE_SEQUENCE),
+				imageExtension("jpg"),
+				encoderCommand(""),
+				scale(0.5),
+				frameInterval(1),
+				encoderThreads(2),
+				maxQueuedFrames(120)
+			{}
+
+			std::string directory; //!< The directory that the timestamps and image files are written to. Relative to the data directory.
+
+			Output output; //!< Where the frames go.
+
+			std::string imageExtension; //!< For `IMAGE_SEQUENCE`, the type of image file. "jpg" is much faster to encode than "png".
+
+			/*! For `ENCODER_PIPE`, the command that is started to encode the frames. "{width}", "{height}", and "{fps}" are replaced
+			by the size of the recorded frames and the frame rate of the recording. Relative paths in the command are relative to the
+			working directory of the program, not the output directory. */
+			std::string encoderCommand;
+
+			float scale; //!< The size of the recorded frames relative to the size of the display, in (0, 1].
+			unsigned int frameInterval; //!< Every `frameInterval`th frame is recorded. 1 records every frame.
+			unsigned int encoderThreads; //!< For `IMAGE_SEQUENCE`, the number of threads that encode images. `ENCODER_PIPE` uses one.
+			unsigned int maxQueuedFrames; //!< If the encoder falls this far behind, frames are dropped. See CX_FrameCapture::Configuration.
+		};
+
+		CX_VideoRecorder(void);
+		~CX_VideoRecorder(void);
+
+		bool start(Configuration config);
+		void stop(void);
+		bool isRecording(void) const;
+
+		uint64_t getRecordedFrameCount(void) const;
+		uint64_t getDroppedFrameCount(void) const;
+
+		void frameRendered(uint64_t frameNumber);
+		void frameSwapped(uint64_t frameNumber, CX_Millis swapTime);
+		void update(void);
+
+	private:
+
+		struct PendingRow {
+			uint64_t videoFrame;
+			CX_Millis renderTime;
+		};
+
+		Configuration _config;
+		bool _recording;
+
+		CX_FrameCapture _capture;
+		ofFbo _scaledFbo;
+		ofFbo _resolveFbo; //Only allocated if the back buffer is multisampled.
+
+		FILE* _pipe;
+		std::atomic<bool> _pipeFailed;
+
+		std::ofstream _timestamps;
+		std::multimap<uint64_t, PendingRow> _pendingRows; //Keyed by display frame number.
+		uint64_t _lastSwappedFrame;
+
+		uint64_t _renderedCount;
+		uint64_t _recordedCount;
+
+		void _writeRow(uint64_t displayFrame, const PendingRow& row, bool swapKnown, CX_Millis swapTime);
+		void _closePipe(void);
+	};
+
+}